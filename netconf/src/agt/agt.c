@@ -46,10 +46,12 @@ date         init     comment
 #include "agt_cli.h"
 #include "agt_connect.h"
 #include "agt_hello.h"
+#include "agt_journal.h"
 #include "agt_ncx.h"
 #include "agt_nmda.h"
 #include "agt_not.h"
 #include "agt_not_queue_notification_cb.h"
+#include "agt_nvstore.h"
 #include "agt_plock.h"
 #include "agt_proc.h"
 #include "agt_rpc.h"
@@ -69,6 +71,7 @@ date         init     comment
 #include "ncxconst.h"
 #include "ncxmod.h"
 #include "status.h"
+#include "tk.h"
 
 
 /********************************************************************
@@ -166,6 +169,10 @@ static void
     agt_profile.agt_accesscontrol_enum = AGT_ACMOD_ENFORCING;
     agt_profile.agt_system_sorted = AGT_DEF_SYSTEM_SORTED;
     agt_profile.agt_max_sessions = 1024;
+    agt_profile.agt_async_nvstore = FALSE;
+    agt_profile.agt_log_async = LOG_ASYNC_OFF;
+    agt_profile.agt_startup_journal = FALSE;
+    agt_profile.agt_validate_workers = 1;
 
 } /* init_server_profile */
 
@@ -582,6 +589,18 @@ status_t
     }
 
     /* loglevel and log file already set */
+    if (agt_profile.agt_log_async != LOG_ASYNC_OFF &&
+        agt_profile.agt_log_async != LOG_ASYNC_NONE &&
+        log_is_open()) {
+        res = log_async_start(agt_profile.agt_log_async,
+                              LOG_ASYNC_DEF_BUFFSIZE);
+        if (res != NO_ERR) {
+            log_warn("\nWarning: log-async not started (%s)",
+                     get_error_string(res));
+            res = NO_ERR;
+        }
+    }
+
     return res;
 
 } /* agt_init1 */
@@ -788,6 +807,30 @@ status_t
             }
         }
 
+        /* queue the module files for the tokenizer threads, if any */
+        for (val = val_find_child(clivalset, NCXMOD_NETCONFD, NCX_EL_MODULE);
+             val != NULL && tk_get_prefetch_threads() > 1;
+             val = val_find_next_child(clivalset, NCXMOD_NETCONFD,
+                                       NCX_EL_MODULE, val)) {
+            modlen = 0;
+            revision = NULL;
+            savestr = NULL;
+            savechar = '\0';
+
+            if (yang_split_filename(VAL_STR(val), &modlen)) {
+                savestr = &(VAL_STR(val)[modlen]);
+                savechar = *savestr;
+                *savestr = '\0';
+                revision = savestr + 1;
+            }
+
+            (void)ncxmod_prefetch_module(VAL_STR(val), revision);
+
+            if (savestr != NULL) {
+                *savestr = savechar;
+            }
+        }
+
         val = val_find_child(clivalset, NCXMOD_NETCONFD, NCX_EL_MODULE);
 
         /* attempt all dynamically loaded modules */
@@ -844,6 +887,8 @@ status_t
         }
     }
 
+    tk_prefetch_stop();
+
     /*** ALL INITIAL YANG MODULES SHOULD BE LOADED AT THIS POINT ***/
     if (res != NO_ERR) {
         log_error("\nError: one or more modules could not be loaded");
@@ -1143,6 +1188,10 @@ void
     if (agt_init_done) {
         log_debug3("\nServer Cleanup Starting...\n");
 
+        /* finish writing the startup config while the cfgs are valid */
+        agt_nvstore_cleanup();
+        agt_journal_cleanup();
+
         /* cleanup all the dynamically loaded modules */
         while (!dlq_empty(&agt_dynlibQ)) {
             dynlib = (agt_dynlib_cb_t *)dlq_deque(&agt_dynlibQ);
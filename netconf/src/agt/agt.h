@@ -243,7 +243,7 @@ typedef struct agt_profile_t_ {
     boolean             agt_logappend;
     boolean             agt_xmlorder;
     boolean             agt_deleteall_ok;   /* TBD: not implemented */
-    boolean             agt_stream_output;   /* d:true; no CLI support yet */
+    boolean             agt_stream_output;   /* --stream-output */
     boolean             agt_delete_empty_npcontainers;     /* d: false */
     boolean             agt_notif_sequence_id;    /* d: false */
     const xmlChar      *agt_accesscontrol;
@@ -270,6 +270,10 @@ typedef struct agt_profile_t_ {
     const xmlChar      *agt_tcp_direct_address;
     int32               agt_tcp_direct_port;
     const xmlChar      *agt_ncxserver_sockname;
+    boolean             agt_async_nvstore;      /* --async-nvstore */
+    log_async_t         agt_log_async;          /* --log-async */
+    boolean             agt_startup_journal;    /* --startup-journal */
+    uint32              agt_validate_workers;   /* --validate-workers */
 
     /****** state variables; TBD: move out of profile ******/
 
@@ -42,6 +42,7 @@ date         init     comment
 #include "agt_ses.h"
 #include "agt_util.h"
 #include "agt_val.h"
+#include "bobhash.h"
 #include "def_reg.h"
 #include "dlq.h"
 #include "ncx.h"
@@ -109,6 +110,12 @@ date         init     comment
 #define nacm_E_allowedRights_delete  (const xmlChar *)"delete"
 #define nacm_E_allowedRights_exec  (const xmlChar *)"exec"
 
+/* bits in agt_acm_objdec_t decision bytes */
+#define ACM_DEC_SET          bit0
+#define ACM_DEC_OK           bit1
+#define ACM_DEC_DATA_RULE    bit2
+#define ACM_DEC_MODULE_RULE  bit3
+
 
 /********************************************************************
 *                                                                    *
@@ -328,6 +335,215 @@ static void
 }  /* free_datarule */
 
 
+/********************************************************************
+* FUNCTION objdec_hash
+*
+* Get the hash value for an object template pointer
+*
+* INPUTS:
+*   obj == object template
+*
+* RETURNS:
+*   hash value
+*********************************************************************/
+static uint32
+    objdec_hash (const obj_template_t *obj)
+{
+    return (uint32)bobhash((const ub1 *)&obj, sizeof(obj), 0);
+
+}  /* objdec_hash */
+
+
+/********************************************************************
+* FUNCTION clean_objdecs
+*
+* Free all the cached object decisions
+*
+* INPUTS:
+*   cache == agt_acm cache to clean
+*
+*********************************************************************/
+static void
+    clean_objdecs (agt_acm_cache_t *cache)
+{
+    agt_acm_objdec_t  *objdec, *nextobjdec;
+    uint32             i;
+
+    if (!cache->objdecs) {
+        return;
+    }
+    for (i = 0; i < cache->objdecsize; i++) {
+        for (objdec = cache->objdecs[i];
+             objdec != NULL;
+             objdec = nextobjdec) {
+            nextobjdec = objdec->next;
+            m__free(objdec);
+        }
+    }
+    m__free(cache->objdecs);
+    cache->objdecs = NULL;
+    cache->objdecsize = 0;
+    cache->objdeccount = 0;
+
+}  /* clean_objdecs */
+
+
+/********************************************************************
+* FUNCTION find_objdec
+*
+* Find the cached decisions for an object template
+*
+* INPUTS:
+*   cache == agt_acm cache to use
+*   obj == object template to find
+*
+* RETURNS:
+*   pointer to the entry or NULL if not found
+*********************************************************************/
+static agt_acm_objdec_t *
+    find_objdec (agt_acm_cache_t *cache,
+                 const obj_template_t *obj)
+{
+    agt_acm_objdec_t  *objdec;
+
+    if (!cache->objdecs) {
+        return NULL;
+    }
+    for (objdec = cache->objdecs[objdec_hash(obj) & 
+                                 (cache->objdecsize - 1)];
+         objdec != NULL;
+         objdec = objdec->next) {
+        if (objdec->obj == obj) {
+            return objdec;
+        }
+    }
+    return NULL;
+
+}  /* find_objdec */
+
+
+/********************************************************************
+* FUNCTION grow_objdecs
+*
+* Double the number of buckets in the object decision table
+* The table keeps working with longer chains if
+* the malloc fails
+*
+* INPUTS:
+*   cache == agt_acm cache to use
+*
+*********************************************************************/
+static void
+    grow_objdecs (agt_acm_cache_t *cache)
+{
+    agt_acm_objdec_t  **newbuckets, *objdec, *nextobjdec;
+    uint32              newsize, i, slot;
+
+    newsize = cache->objdecsize * 2;
+    newbuckets = (agt_acm_objdec_t **)
+        m__getMem(newsize * sizeof(agt_acm_objdec_t *));
+    if (!newbuckets) {
+        return;
+    }
+    memset(newbuckets, 0x0, newsize * sizeof(agt_acm_objdec_t *));
+
+    for (i = 0; i < cache->objdecsize; i++) {
+        for (objdec = cache->objdecs[i];
+             objdec != NULL;
+             objdec = nextobjdec) {
+            nextobjdec = objdec->next;
+            slot = objdec_hash(objdec->obj) & (newsize - 1);
+            objdec->next = newbuckets[slot];
+            newbuckets[slot] = objdec;
+        }
+    }
+    m__free(cache->objdecs);
+    cache->objdecs = newbuckets;
+    cache->objdecsize = newsize;
+
+}  /* grow_objdecs */
+
+
+/********************************************************************
+* FUNCTION add_objdec
+*
+* Add an empty decision entry for an object template
+*
+* INPUTS:
+*   cache == agt_acm cache to use
+*   obj == object template to add
+*
+* RETURNS:
+*   pointer to the new entry or NULL if malloc failed
+*********************************************************************/
+static agt_acm_objdec_t *
+    add_objdec (agt_acm_cache_t *cache,
+                const obj_template_t *obj)
+{
+    agt_acm_objdec_t  *objdec;
+    uint32             slot;
+
+    if (!cache->objdecs) {
+        cache->objdecs = (agt_acm_objdec_t **)
+            m__getMem(AGT_ACM_OBJDEC_SIZE * sizeof(agt_acm_objdec_t *));
+        if (!cache->objdecs) {
+            return NULL;
+        }
+        memset(cache->objdecs, 0x0,
+               AGT_ACM_OBJDEC_SIZE * sizeof(agt_acm_objdec_t *));
+        cache->objdecsize = AGT_ACM_OBJDEC_SIZE;
+        cache->objdeccount = 0;
+    }
+
+    objdec = m__getObj(agt_acm_objdec_t);
+    if (!objdec) {
+        return NULL;
+    }
+    memset(objdec, 0x0, sizeof(agt_acm_objdec_t));
+    objdec->obj = obj;
+
+    if (cache->objdeccount >= cache->objdecsize) {
+        grow_objdecs(cache);
+    }
+    slot = objdec_hash(obj) & (cache->objdecsize - 1);
+    objdec->next = cache->objdecs[slot];
+    cache->objdecs[slot] = objdec;
+    cache->objdeccount++;
+    return objdec;
+
+}  /* add_objdec */
+
+
+/********************************************************************
+* FUNCTION clear_data_rules
+*
+* Free the cached data rules and all the object
+* decisions that were made with them
+*
+* INPUTS:
+*   cache == agt_acm cache to clear
+*
+*********************************************************************/
+static void
+    clear_data_rules (agt_acm_cache_t *cache)
+{
+    agt_acm_datarule_t   *datarule;
+    int i;
+
+    for(i=0;i<DATA_RULE_QUEUE_NUM;i++) {
+        while (!dlq_empty(&cache->dataruleQ[i])) {
+            datarule = (agt_acm_datarule_t *)
+            dlq_deque(&cache->dataruleQ[i]);
+            free_datarule(datarule);
+        }
+    }
+    clean_objdecs(cache);
+    cache->flags &= ~(FL_ACM_DATARULES_SET | FL_ACM_DATARULES_STATE);
+    cache->datarules_txid = 0;
+
+}  /* clear_data_rules */
+
+
 /********************************************************************
 * FUNCTION new_group_ptr
 *
@@ -630,8 +846,6 @@ static void
     free_acm_cache (agt_acm_cache_t  *acm_cache)
 {
     agt_acm_modrule_t    *modrule;
-    agt_acm_datarule_t   *datarule;
-    int i;
 
     while (!dlq_empty(&acm_cache->modruleQ)) {
         modrule = (agt_acm_modrule_t *)
@@ -639,13 +853,7 @@ static void
         free_modrule(modrule);
     }
 
-    for(i=0;i<DATA_RULE_QUEUE_NUM;i++) {
-        while (!dlq_empty(&acm_cache->dataruleQ[i])) {
-            datarule = (agt_acm_datarule_t *)
-            dlq_deque(&acm_cache->dataruleQ[i]);
-            free_datarule(datarule);
-        }
-    }
+    clear_data_rules(acm_cache);
 
     if (acm_cache->usergroups) {
         free_usergroups(acm_cache->usergroups);
@@ -1279,24 +1487,12 @@ static status_t
     val_value_t         *rule, *rule_list;
     val_value_t         *valroot;
     int                 i;
+    cfg_template_t      *running;
+    xpath_resnode_t     *resnode;
+    val_value_t         *resval;
 
     if (cache->flags & FL_ACM_DATARULES_SET) {
-        // datarules have already been already cached, return no error
-        //return NO_ERR;
-
-
-        /* regenerate all cached datarules since no mechanism for updating config=false rules is in place yet */
-        agt_acm_datarule_t  *freerule;
-        for(i=0;i<DATA_RULE_QUEUE_NUM;i++) {
-            while (!dlq_empty(&cache->dataruleQ[i])) {
-                freerule = (agt_acm_datarule_t *)dlq_deque(&cache->dataruleQ[i]);
-                if (freerule) {
-                    free_datarule(freerule);
-                } else {
-                    return SET_ERROR(ERR_INTERNAL_VAL);
-                }
-            }
-        }
+        clear_data_rules(cache);
     }
 
     /* the /nacm node is supposed to be a child of <config> */
@@ -1360,6 +1556,25 @@ for ( rule_list = val_find_child( nacmroot, AGT_ACM_MODULE,
                 break;
             }
 
+            if (res == NO_ERR && i == DATA_RULE_QUEUE_READ) {
+                /* the state data selected by a read rule can change
+                 * without a new running config, so the rule needs
+                 * to be evaluated again for each message
+                 */
+                resnode = xpath_get_first_resnode(result);
+                if (resnode == NULL) {
+                    cache->flags |= FL_ACM_DATARULES_STATE;
+                }
+                for (; resnode != NULL;
+                     resnode = xpath_get_next_resnode(resnode)) {
+                    resval = xpath_get_resnode_valptr(resnode);
+                    if (resval && !obj_get_config_flag_deep(resval->obj)) {
+                        cache->flags |= FL_ACM_DATARULES_STATE;
+                        break;
+                    }
+                }
+            }
+
             if ( res == NO_ERR) {
                 agt_acm_datarule_t  *datarule_cache;
                 datarule_cache = new_datarule(pcb, result, rule);
@@ -1381,27 +1596,50 @@ for ( rule_list = val_find_child( nacmroot, AGT_ACM_MODULE,
 }
     if (res == NO_ERR) {
         cache->flags |= FL_ACM_DATARULES_SET;
-    } else {
-        for(i=0;i<DATA_RULE_QUEUE_NUM;i++) {
-
-            agt_acm_datarule_t  *freerule;
-            while (!dlq_empty(&cache->dataruleQ[i])) {
-                freerule = (agt_acm_datarule_t *)dlq_deque(&cache->dataruleQ[i]);
-                if (freerule) {
-                    free_datarule(freerule);
-                } else {
-                    SET_ERROR(ERR_INTERNAL_VAL);
-                }
-            }
-            log_error("\nError: cache NACM data rules failed! (%s)",
-                      get_error_string(res));
+        running = cfg_get_config_id(NCX_CFGID_RUNNING);
+        if (running) {
+            cache->datarules_txid = running->last_txid;
         }
+    } else {
+        clear_data_rules(cache);
+        log_error("\nError: cache NACM data rules failed! (%s)",
+                  get_error_string(res));
     }
 
     return res;
 }
 
 
+/********************************************************************
+* FUNCTION check_data_rules_current
+*
+* Clear the cached data rules and object decisions if the
+* running config changed since the rules were evaluated, or if
+* a read rule depends on state data
+*
+* INPUTS:
+*    cache == agt_acm cache to check
+*
+*********************************************************************/
+static void
+    check_data_rules_current (agt_acm_cache_t *cache)
+{
+    cfg_template_t  *running;
+
+    if (!(cache->flags & FL_ACM_DATARULES_SET)) {
+        return;
+    }
+
+    running = cfg_get_config_id(NCX_CFGID_RUNNING);
+    if ((cache->flags & FL_ACM_DATARULES_STATE) ||
+        running == NULL ||
+        running->last_txid != cache->datarules_txid) {
+        clear_data_rules(cache);
+    }
+
+}  /* check_data_rules_current */
+
+
 /********************************************************************
 * FUNCTION check_data_rules
 *
@@ -1443,12 +1681,7 @@ static boolean
     *done = FALSE;
 
     /* fill the dataruleQ in the cache if needed */
-#if 0
-    if (!(cache->flags & FL_ACM_DATARULES_SET)) 
-#else
-    if (1)
-#endif
-    {
+    if (!(cache->flags & FL_ACM_DATARULES_SET)) {
         res = cache_data_rules( cache, nacmroot);
     }
 
@@ -1495,6 +1728,43 @@ static boolean
 } /* check_data_rules */
 
 
+/********************************************************************
+* FUNCTION objdec_usable
+*
+* Check if the rules decision for a value node can be
+* saved or found by its object template.  The rules compare
+* the names of the node and its ancestors, so this is only
+* true if the value node is a real schema node whose parent
+* is the value node for the parent object
+*
+* INPUTS:
+*   val == value node to check
+*
+* RETURNS:
+*   TRUE if the object decision cache can be used
+*********************************************************************/
+static boolean
+    objdec_usable (const val_value_t *val)
+{
+    const obj_template_t  *parentobj;
+
+    if (val->parent == NULL || val->parent->obj == NULL) {
+        return FALSE;
+    }
+    if (val_get_nsid(val) != obj_get_nsid(val->obj) ||
+        xml_strcmp(val->name, obj_get_name(val->obj))) {
+        return FALSE;
+    }
+
+    parentobj = obj_get_real_parent((obj_template_t *)val->obj);
+    if (obj_is_root(val->parent->obj)) {
+        return (parentobj == NULL) ? TRUE : FALSE;
+    }
+    return (parentobj == val->parent->obj) ? TRUE : FALSE;
+
+}  /* objdec_usable */
+
+
 /********************************************************************
 * FUNCTION valnode_access_allowed
 *
@@ -1631,7 +1901,26 @@ static boolean
     const xmlChar *substr = iswrite ? (const xmlChar *)"write-default" :
         (const xmlChar *)"read-default";
 
-    if (groupcnt == 0) {
+    /* check if this object was already checked against the rules */
+    uint32 access_id = get_rule_queue_access_id(access);
+    boolean usable = (groupcnt != 0) ? objdec_usable(val) : FALSE;
+    agt_acm_objdec_t *objdec = NULL;
+    uint8 decision = 0;
+    if (usable) {
+        objdec = find_objdec(cache, val->obj);
+        if (objdec) {
+            decision = objdec->decision[access_id];
+        }
+    }
+
+    if (decision & ACM_DEC_SET) {
+        retval = (decision & ACM_DEC_OK) ? TRUE : FALSE;
+        if (decision & ACM_DEC_DATA_RULE) {
+            substr = (const xmlChar *)"data-rule";
+        } else if (decision & ACM_DEC_MODULE_RULE) {
+            substr = (const xmlChar *)"module-rule";
+        }
+    } else if (groupcnt == 0) {
         /* just check the default for this RPC operation */
         retval = get_default_data_response(cache, nacmroot, val, iswrite);
         // substr set already
@@ -1643,12 +1932,14 @@ static boolean
                                       usergroups, &done);
             if (done) {
                 substr = (const xmlChar *)"data-rule";
+                decision = ACM_DEC_DATA_RULE;
             } else {
                 /* no data rule found; try a module namespace rule */
                 retval = check_module_rules(cache, nacmroot, val->obj, access,
                                             usergroups, &done);
                 if (done) {
                     substr = (const xmlChar *)"module-rule";
+                    decision = ACM_DEC_MODULE_RULE;
                 } else {
                     /* no module rule so use the default */
                     retval = get_default_data_response(cache, nacmroot, val,
@@ -1657,6 +1948,20 @@ static boolean
                 }
             }
         }
+
+        /* save the decision if the data rules are cached */
+        if (usable && (cache->flags & FL_ACM_DATARULES_SET)) {
+            if (objdec == NULL) {
+                objdec = add_objdec(cache, val->obj);
+            }
+            if (objdec) {
+                decision |= ACM_DEC_SET;
+                if (retval) {
+                    decision |= ACM_DEC_OK;
+                }
+                objdec->decision[access_id] = decision;
+            }
+        }
     }
 
     if (iswrite) {
@@ -2639,6 +2944,7 @@ status_t
 
     if (agt_acm_session_cache_valid(scb)) {
         msg->acm_cache = scb->acm_cache;
+        check_data_rules_current(msg->acm_cache);
     } else {
         if (scb->acm_cache != NULL) {
             free_acm_cache(scb->acm_cache);
@@ -20,6 +20,19 @@
 
     NETCONF Server Access Control handler
 
+  The data rule XPath expressions are evaluated against the
+  running config once, when the cache is filled.  The rules
+  match a data node by the names of the node and its ancestors,
+  so the result of the data rules, module rules and defaults
+  for a node only depends on its object template and the
+  requested access.  The decision is saved in a hash table
+  keyed by the obj_template_t, so each object is checked
+  against the rules only once.  The cached results are
+  refreshed when the running config changes, when the NACM
+  config changes (nacm_callback invalidates the session caches),
+  and for each message if a read rule selects state data or
+  no nodes at all.
+
 *********************************************************************
 *								    *
 *		   C H A N G E	 H I S T O R Y			    *
@@ -38,6 +51,10 @@ date	     init     comment
 #include "agt.h"
 #endif
 
+#ifndef _H_cfg
+#include "cfg.h"
+#endif
+
 #ifndef _H_dlq
 #include "dlq.h"
 #endif
@@ -90,6 +107,12 @@ extern "C" {
 #define FL_ACM_MODRULES_SET     bit6
 #define FL_ACM_DATARULES_SET    bit7
 #define FL_ACM_CACHE_VALID      bit8
+#define FL_ACM_DATARULES_STATE  bit9
+
+/* starting number of buckets in the object decision table;
+ * must be a power of 2
+ */
+#define AGT_ACM_OBJDEC_SIZE     64
 
 
 /********************************************************************
@@ -126,6 +149,13 @@ typedef struct agt_acm_datarule_t_ {
     val_value_t        *datarule;   /* back-ptr */
 } agt_acm_datarule_t;
 
+/* cached decisions for 1 object template, 1 byte per access */
+typedef struct agt_acm_objdec_t_ {
+    struct agt_acm_objdec_t_ *next;
+    const obj_template_t     *obj;
+    uint8                     decision[4];
+} agt_acm_objdec_t;
+
 /* NACM cache control block */
 #define DATA_RULE_QUEUE_READ 0
 #define DATA_RULE_QUEUE_UPDATE 1
@@ -142,6 +172,10 @@ typedef struct agt_acm_cache_t_ {
     agt_acmode_t          mode;
     dlq_hdr_t             modruleQ;     /* Q of agt_acm_modrule_t */
     dlq_hdr_t             dataruleQ[4];    /* Q of agt_acm_datarule_t */
+    cfg_transaction_id_t  datarules_txid;  /* running txid of dataruleQ */
+    agt_acm_objdec_t    **objdecs;      /* hash table buckets */
+    uint32                objdecsize;
+    uint32                objdeccount;
 } agt_acm_cache_t;
 
     
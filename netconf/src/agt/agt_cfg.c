@@ -866,6 +866,9 @@ void
     if (commit_test->result) {
         xpath_free_result(commit_test->result);
     }
+    if (commit_test->depobjs) {
+        m__free(commit_test->depobjs);
+    }
     m__free(commit_test);
 
 } /* agt_cfg_free_commit_test */
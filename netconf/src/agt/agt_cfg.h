@@ -204,6 +204,12 @@ typedef struct agt_cfg_commit_test_t_ {
     cfg_transaction_id_t result_txid;
     ncx_btype_t        btyp;
     uint32             testflags;  /* AGT_TEST_FL_FOO bits */
+    obj_template_t   **depobjs;    /* top objects read by must/leafref */
+    uint32             depcount;
+    uint32             depmax;
+    uint32             mustdepth;  /* levels of '..' above the node */
+    boolean            depany;     /* XPath may read any top object */
+    boolean            mustlocal;  /* musts only read mustdepth subtree */
 } agt_cfg_commit_test_t;
 
 
@@ -324,6 +324,37 @@ static void
         agt_profile->agt_max_sessions = VAL_UINT(val);
     }
 
+    /* get async-nvstore param */
+    val = val_find_child(valset, AGT_CLI_MODULE_EX, NCX_EL_ASYNC_NVSTORE);
+    if (val && val->res == NO_ERR) {
+        agt_profile->agt_async_nvstore = VAL_BOOL(val);
+    }
+
+    /* get log-async param */
+    val = val_find_child(valset, AGT_CLI_MODULE_EX, NCX_EL_LOG_ASYNC);
+    if (val && val->res == NO_ERR) {
+        agt_profile->agt_log_async = 
+            log_get_async_enum((const char *)VAL_ENUM_NAME(val));
+    }
+
+    /* get startup-journal param */
+    val = val_find_child(valset, AGT_CLI_MODULE_EX, NCX_EL_STARTUP_JOURNAL);
+    if (val && val->res == NO_ERR) {
+        agt_profile->agt_startup_journal = VAL_BOOL(val);
+    }
+
+    /* get stream-output param */
+    val = val_find_child(valset, AGT_CLI_MODULE_EX, NCX_EL_STREAM_OUTPUT);
+    if (val && val->res == NO_ERR) {
+        agt_profile->agt_stream_output = VAL_BOOL(val);
+    }
+
+    /* get validate-workers param */
+    val = val_find_child(valset, AGT_CLI_MODULE_EX, NCX_EL_VALIDATE_WORKERS);
+    if (val && val->res == NO_ERR) {
+        agt_profile->agt_validate_workers = VAL_UINT(val);
+    }
+
     val = val_find_child(valset,
                          AGT_CLI_MODULE_EX,
                          NCX_EL_TCP_DIRECT_PORT);
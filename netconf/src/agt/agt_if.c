@@ -85,6 +85,21 @@ date         init     comment
 *                                                                   *
 *********************************************************************/
 
+/* one interface line from the /proc/net/dev file */
+typedef struct if_counters_line_t_ {
+    const xmlChar        *name;
+    xmlChar              *counters;
+} if_counters_line_t;
+
+/* bulk snapshot of the /proc/net/dev file,
+ * with the lines sorted by interface name
+ */
+typedef struct if_counters_snapshot_t_ {
+    xmlChar              *buffer;
+    if_counters_line_t   *lines;
+    uint32                linecount;
+} if_counters_snapshot_t;
+
 
 /********************************************************************
 *                                                                   *
@@ -98,6 +113,8 @@ static boolean              agt_if_not_supported;
 
 static ncx_module_t         *ifmod;
 
+static obj_template_t       *ifcountersobj;
+
 
 /********************************************************************
 * FUNCTION is_interfaces_supported
@@ -290,15 +307,164 @@ static val_value_t *
 } /* make_interface_entry */
 
 
+/********************************************************************
+* FUNCTION free_if_counters_snapshot
+*
+* Free a /proc/net/dev snapshot
+*
+* INPUTS:
+*   snapshot == if_counters_snapshot_t to free
+*********************************************************************/
+static void
+    free_if_counters_snapshot (void *snapshot)
+{
+    if_counters_snapshot_t  *snap;
+
+    snap = (if_counters_snapshot_t *)snapshot;
+    if (snap->buffer) {
+        m__free(snap->buffer);
+    }
+    if (snap->lines) {
+        m__free(snap->lines);
+    }
+    m__free(snap);
+
+} /* free_if_counters_snapshot */
+
+
+/********************************************************************
+* FUNCTION compare_if_counters_lines
+*
+* qsort and bsearch compare function for the snapshot lines
+*
+* INPUTS:
+*   item1 == first if_counters_line_t to compare
+*   item2 == second if_counters_line_t to compare
+*
+* RETURNS:
+*   compare result
+*********************************************************************/
+static int
+    compare_if_counters_lines (const void *item1,
+                               const void *item2)
+{
+    const if_counters_line_t  *line1, *line2;
+
+    line1 = (const if_counters_line_t *)item1;
+    line2 = (const if_counters_line_t *)item2;
+
+    return xml_strcmp(line1->name, line2->name);
+
+} /* compare_if_counters_lines */
+
+
+/********************************************************************
+* FUNCTION get_if_counters_snapshot
+*
+* Bulk get callback for the interfaces/interface/counters node
+*
+* Read the /proc/net/dev file once and index the interface
+* lines by name, so the counters for every interface entry
+* in the same request come from one read of the file
+*
+* INPUTS:
+*    see ncx/getcb.h getcb_bulk_fn_t for details
+*
+* RETURNS:
+*    status
+*********************************************************************/
+static status_t
+    get_if_counters_snapshot (ses_cb_t *scb,
+                              obj_template_t *obj,
+                              void **snapshot)
+{
+    if_counters_snapshot_t  *snap;
+    xmlChar                 *str, *name, *eol;
+    uint32                   bufflen, linecount, maxlines;
+    status_t                 res;
+
+    (void)scb;
+    (void)obj;
+
+    snap = m__getObj(if_counters_snapshot_t);
+    if (snap == NULL) {
+        return ERR_INTERNAL_MEM;
+    }
+    memset(snap, 0x0, sizeof(if_counters_snapshot_t));
+
+    snap->buffer = agt_read_proc_file("/proc/net/dev", &bufflen, &res);
+    if (snap->buffer == NULL) {
+        free_if_counters_snapshot(snap);
+        return res;
+    }
+
+    /* there cannot be more interfaces than lines in the file */
+    maxlines = 1;
+    for (str = snap->buffer; *str; str++) {
+        if (*str == '\n') {
+            maxlines++;
+        }
+    }
+
+    snap->lines = m__getMem(maxlines * sizeof(if_counters_line_t));
+    if (snap->lines == NULL) {
+        free_if_counters_snapshot(snap);
+        return ERR_INTERNAL_MEM;
+    }
+
+    /* split the buffer into lines and terminate each name */
+    linecount = 0;
+    str = snap->buffer;
+    while (*str) {
+        eol = (xmlChar *)strchr((const char *)str, '\n');
+        if (eol) {
+            *eol = 0;
+        }
+
+        /* skip the header junk on the first 2 lines */
+        if (++linecount >= 3) {
+            while (*str && xml_isspace(*str)) {
+                str++;
+            }
+            name = str;
+            while (*str && *str != ':') {
+                str++;
+            }
+            if (*str == ':' && str != name) {
+                *str++ = 0;
+                snap->lines[snap->linecount].name = name;
+                snap->lines[snap->linecount].counters = str;
+                snap->linecount++;
+            }
+        }
+
+        if (eol == NULL) {
+            break;
+        }
+        str = eol + 1;
+    }
+
+    qsort(snap->lines,
+          snap->linecount,
+          sizeof(if_counters_line_t),
+          compare_if_counters_lines);
+
+    *snapshot = snap;
+    return NO_ERR;
+
+} /* get_if_counters_snapshot */
+
+
 /********************************************************************
 * FUNCTION fill_if_counters
 *
-* <get> operation handler for the interfaces/interface/counters node
+* Fill in the counters for one interface
 *
 * INPUTS:
 *   countersobj == object template with all the child node to use
 *   nameval == value node for the <name> key that is desired
-*   buffer == line from the /proc/net/dev file to read
+*   counters == the 16 ordered counter values from the
+*               /proc/net/dev line for this interface
 *   dstval == destination value to fill in
 *
 * OUTPUTS:
@@ -306,63 +472,24 @@ static val_value_t *
 *
 * RETURNS:
 *    status
-*    NO_ERR if this is the right line for the <name> key
-*      and everything filled in OK
-*    ERR_NCX_SKIPPED if this is the wrong line for this <name>
-*    some other error like ERR_INTERNAL_MEM
 *********************************************************************/
 static status_t 
     fill_if_counters (obj_template_t *countersobj,
                       val_value_t *nameval,
-                      xmlChar *buffer,
+                      const xmlChar *counters,
                       val_value_t  *dstval)
 {
     obj_template_t        *childobj;
     val_value_t           *childval;
-    xmlChar               *str, *name;
+    const xmlChar         *str;
     char                  *endptr;
-    status_t               res;
     uint32                 leafcount;
     uint64                 counter;
     boolean                done;
 
-    res = NO_ERR;
     leafcount = 0;
     counter = 0;
-
-    /* get the start of the interface name */
-    str = buffer;
-    while (*str && isspace(*str)) {
-        str++;
-    }
-    if (*str == '\0') {
-        /* not expecting a line with just whitespace on it */
-        return ERR_NCX_SKIPPED;
-    } else {
-        name = str++;
-    }
-
-    /* get the end of the interface name */
-    while (*str && *str != ':') {
-        str++;
-    }
-    if (*str == '\0') {
-        /* not expecting a line with just foo on it */
-        return ERR_NCX_SKIPPED;
-    }
-
-    /* is this the requested interface line? */
-    if (xml_strncmp((const xmlChar *)name,
-                    VAL_STR(nameval),
-                    (uint32)(str - name))) {
-        /* not the right interface name */
-        return ERR_NCX_SKIPPED;
-    }
-
-    /* get the str pointed at the first byte of the
-     * 16 ordered counter values
-     */
-    str++;
+    str = counters;
 
     /* get the first counter object ready */
     childobj = obj_first_child(countersobj);
@@ -375,7 +502,7 @@ static status_t
     while (!done) {
         endptr = NULL;
         counter = strtoull((const char *)str, &endptr, 10);
-        if (counter == 0 && str == (xmlChar *)endptr) {
+        if (counter == 0 && str == (const xmlChar *)endptr) {
             /* number conversion failed */
             log_error("\nError: /proc/net/dev number conversion failed");
             return ERR_NCX_OPERATION_FAILED;
@@ -391,7 +518,7 @@ static status_t
 
         leafcount++;
 
-        str = (xmlChar *)endptr;
+        str = (const xmlChar *)endptr;
         if (*str == '\0' || *str == '\n') {
             done = TRUE;
         } else {
@@ -408,7 +535,7 @@ static status_t
                    VAL_STR(nameval));
     }
 
-    return res;
+    return NO_ERR;
 
 } /* fill_if_counters */
 
@@ -430,15 +557,12 @@ static status_t
                      val_value_t *virval,
                      val_value_t  *dstval)
 {
-    FILE                  *countersfile;
-    obj_template_t        *countersobj;
-    val_value_t           *parentval, *nameval;
-    xmlChar               *buffer, *readtest;
-    boolean                done;
-    status_t               res;
-    uint32                 linecount;
+    obj_template_t          *countersobj;
+    val_value_t             *parentval, *nameval;
+    if_counters_snapshot_t  *snap;
+    if_counters_line_t       key, *line;
+    status_t                 res;
 
-    (void)scb;
     res = NO_ERR;
 
     if (cbmode != GETCB_GET_VALUE) {
@@ -463,54 +587,26 @@ static status_t
         return SET_ERROR(ERR_INTERNAL_VAL);
     }        
 
-    /* open the /proc/net/dev file for reading */
-    countersfile = fopen("/proc/net/dev", "r");
-    if (countersfile == NULL) {
-        return errno_to_status();
-    }
-
-    /* get a file read line buffer */
-    buffer = m__getMem(NCX_MAX_LINELEN);
-    if (buffer == NULL) {
-        fclose(countersfile);
-        return ERR_INTERNAL_MEM;
+    /* the /proc/net/dev file is read once per request */
+    snap = (if_counters_snapshot_t *)
+        getcb_get_snapshot(scb, countersobj, &res);
+    if (snap == NULL) {
+        return res;
     }
 
-    /* loop through the file until done */
-    res = NO_ERR;
-    done = FALSE;
-    linecount = 0;
-
-    while (!done) {
-      readtest = (xmlChar *)
-	fgets((char *)buffer, NCX_MAX_LINELEN, countersfile);
-        if (readtest == NULL) {
-            done = TRUE;
-            continue;
-        } else {
-            linecount++;
-        }
-
-        if (linecount < 3) {
-            /* skip the header junk on the first 2 lines */
-            continue;
-        } 
-
-        res = fill_if_counters(countersobj,
-                               nameval, 
-                               buffer, 
-                               dstval);
-        if (res == ERR_NCX_SKIPPED) {
-            res = NO_ERR;
-        } else {
-            done = TRUE;
-        }
+    key.name = VAL_STR(nameval);
+    key.counters = NULL;
+    line = bsearch(&key,
+                   snap->lines,
+                   snap->linecount,
+                   sizeof(if_counters_line_t),
+                   compare_if_counters_lines);
+    if (line == NULL) {
+        /* interface is gone; leave the counters empty */
+        return NO_ERR;
     }
 
-    fclose(countersfile);
-    m__free(buffer);
-
-    return res;
+    return fill_if_counters(countersobj, nameval, line->counters, dstval);
 
 } /* get_if_counters */
 
@@ -558,6 +654,16 @@ static status_t
         return SET_ERROR(ERR_NCX_DEF_NOT_FOUND);
     }
 
+    if (ifcountersobj == NULL) {
+        res = getcb_register_bulk(countersobj,
+                                  get_if_counters_snapshot,
+                                  free_if_counters_snapshot);
+        if (res != NO_ERR) {
+            return res;
+        }
+        ifcountersobj = countersobj;
+    }
+
     /* open the /proc/net/dev file for reading */
     countersfile = fopen("/proc/net/dev", "r");
     if (countersfile == NULL) {
@@ -668,6 +774,7 @@ status_t
     log_debug2("\nagt: Loading interfaces module");
 
     ifmod = NULL;
+    ifcountersobj = NULL;
     agt_if_not_supported = FALSE;
     agt_if_init_done = TRUE;
     agt_profile = agt_get_profile();
@@ -768,6 +875,10 @@ void
     agt_if_cleanup (void)
 {
     if (agt_if_init_done) {
+        if (ifcountersobj) {
+            getcb_unregister_bulk(ifcountersobj);
+            ifcountersobj = NULL;
+        }
         ifmod = NULL;
         agt_if_init_done = FALSE;
     }
@@ -0,0 +1,2057 @@
+/*  FILE: agt_journal.c
+
+   Startup config journal
+
+   The records of the transactions committed since the last
+   save are written to a memory stream until the running
+   config is saved.  If basevalid is TRUE, the startup file,
+   the journal and the pending records together are the
+   running config at transaction basetxid.  Any transaction
+   that cannot be recorded clears basevalid, so the next
+   save writes the whole config.
+
+*********************************************************************
+*                                                                   *
+*                     I N C L U D E    F I L E S                    *
+*                                                                   *
+*********************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include <libxml/xmlstring.h>
+#include <libxml/parser.h>
+#include <libxml/tree.h>
+
+#include "procdefs.h"
+#include "agt.h"
+#include "agt_cfg.h"
+#include "agt_journal.h"
+#include "agt_nvstore.h"
+#include "agt_util.h"
+#include "cfg.h"
+#include "dlq.h"
+#include "log.h"
+#include "ncx.h"
+#include "ncxconst.h"
+#include "obj.h"
+#include "op.h"
+#include "status.h"
+#include "val.h"
+#include "val_util.h"
+#include "xml_util.h"
+#include "xmlns.h"
+#include "xml_wr.h"
+
+
+/********************************************************************
+*                                                                   *
+*                       C O N S T A N T S                           *
+*                                                                   *
+*********************************************************************/
+
+#define JOURNAL_START_TAG       "<journal>"
+#define JOURNAL_END_TAG         "</journal>"
+#define TRANSACTION_END_TAG     "</transaction>"
+
+#define JOURNAL_PARSE_OPTIONS \
+    (XML_PARSE_NOBLANKS | XML_PARSE_NONET | XML_PARSE_HUGE)
+
+#define JOURNAL_A_OPERATION     (const xmlChar *)"operation"
+#define JOURNAL_A_DEPTH         (const xmlChar *)"depth"
+#define JOURNAL_A_KEYS          (const xmlChar *)"keys"
+#define JOURNAL_A_LEAF_LIST     (const xmlChar *)"leaf-list"
+
+#define JOURNAL_EL_TRANSACTION  (const xmlChar *)"transaction"
+#define JOURNAL_EL_CONFIG       (const xmlChar *)"config"
+
+#define JOURNAL_OP_REPLACE      (const xmlChar *)"replace"
+#define JOURNAL_OP_DELETE       (const xmlChar *)"delete"
+#define JOURNAL_OP_ORDER        (const xmlChar *)"order"
+
+
+/********************************************************************
+*                                                                   *
+*                       V A R I A B L E S                           *
+*                                                                   *
+*********************************************************************/
+
+/* records not saved yet */
+static FILE                  *pendingfp;
+static char                  *pendingbuff;
+static size_t                 pendingsize;
+
+/* TRUE if the journal can be used for the next save */
+static boolean                basevalid;
+static cfg_transaction_id_t   basetxid;
+
+/* size of the journal and of the last full startup file */
+static off_t                  journalsize;
+static off_t                  fullsize;
+
+/* background compaction of the journal up to rotatetxid;
+ * the old journal is kept until the whole config is written */
+static boolean                compacting;
+static xmlChar               *oldjournal;
+static cfg_transaction_id_t   rotatetxid;
+
+
+/********************************************************************
+* FUNCTION make_filespec
+*
+* Malloc a filespec with 1 or 2 suffixes added
+*
+* INPUTS:
+*    filespec == base filespec
+*    suffix1 == first suffix to add
+*    suffix2 == second suffix to add (may be NULL)
+*
+* RETURNS:
+*    malloced filespec or NULL if malloc failed
+*********************************************************************/
+static xmlChar *
+    make_filespec (const xmlChar *filespec,
+                   const char *suffix1,
+                   const char *suffix2)
+{
+    xmlChar  *buff, *str;
+    uint32    len;
+
+    len = xml_strlen(filespec) + strlen(suffix1);
+    if (suffix2) {
+        len += strlen(suffix2);
+    }
+
+    buff = m__getMem(len + 1);
+    if (buff == NULL) {
+        return NULL;
+    }
+
+    str = buff;
+    str += xml_strcpy(str, filespec);
+    str += xml_strcpy(str, (const xmlChar *)suffix1);
+    if (suffix2) {
+        xml_strcpy(str, (const xmlChar *)suffix2);
+    }
+    return buff;
+
+}  /* make_filespec */
+
+
+/********************************************************************
+* FUNCTION get_file_size
+*
+* Get the size of a file
+*
+* INPUTS:
+*    filespec == file to check
+*
+* RETURNS:
+*    size of the file or 0 if it does not exist
+*********************************************************************/
+static off_t
+    get_file_size (const xmlChar *filespec)
+{
+    struct stat  statbuff;
+
+    if (stat((const char *)filespec, &statbuff) != 0) {
+        return 0;
+    }
+    return statbuff.st_size;
+
+}  /* get_file_size */
+
+
+/********************************************************************
+* FUNCTION drop_pending
+*
+* Free the records that have not been saved
+*
+*********************************************************************/
+static void
+    drop_pending (void)
+{
+    if (pendingfp) {
+        fclose(pendingfp);
+        pendingfp = NULL;
+    }
+
+    /* malloced by open_memstream */
+    if (pendingbuff) {
+        free(pendingbuff);
+        pendingbuff = NULL;
+    }
+    pendingsize = 0;
+
+}  /* drop_pending */
+
+
+/********************************************************************
+* FUNCTION invalidate
+*
+* Stop recording until the whole config is saved
+*
+* INPUTS:
+*    reason == reason for the debug log
+*
+*********************************************************************/
+static void
+    invalidate (const char *reason)
+{
+    if (basevalid && LOGDEBUG) {
+        log_debug("\nagt_journal: %s; next save writes the "
+                  "whole config",
+                  reason);
+    }
+    basevalid = FALSE;
+    drop_pending();
+
+}  /* invalidate */
+
+
+/********************************************************************
+* FUNCTION journal_enabled
+*
+* Check if transactions on a config are recorded
+*
+* INPUTS:
+*    cfg == config to check
+*
+* RETURNS:
+*    TRUE if recorded
+*********************************************************************/
+static boolean
+    journal_enabled (const cfg_template_t *cfg)
+{
+    agt_profile_t  *profile;
+
+    profile = agt_get_profile();
+    return (profile->agt_startup_journal &&
+            !profile->agt_has_startup &&
+            cfg->cfg_id == NCX_CFGID_RUNNING) ? TRUE : FALSE;
+
+}  /* journal_enabled */
+
+
+/********************************************************************
+* FUNCTION check_compaction
+*
+* Finish a background compaction if a config written
+* after it was started has been saved
+*
+* INPUTS:
+*    filespec == startup file (may be NULL)
+*
+*********************************************************************/
+static void
+    check_compaction (const xmlChar *filespec)
+{
+    if (!compacting || agt_nvstore_get_last_txid() < rotatetxid) {
+        return;
+    }
+    compacting = FALSE;
+
+    if (filespec) {
+        fullsize = get_file_size(filespec);
+    }
+
+    if (oldjournal) {
+        if (LOGDEBUG) {
+            log_debug("\nagt_journal: compaction done, removing '%s'",
+                      oldjournal);
+        }
+        (void)unlink((const char *)oldjournal);
+        (void)agt_nvstore_sync_dir(oldjournal);
+        m__free(oldjournal);
+        oldjournal = NULL;
+    }
+
+}  /* check_compaction */
+
+
+/********************************************************************
+* FUNCTION new_skeleton_node
+*
+* Make a copy of a node with just its list keys
+*
+* INPUTS:
+*    node == node to copy
+*    res == address of return status
+*
+* OUTPUTS:
+*    *res == return status
+*
+* RETURNS:
+*    malloced value node or NULL if error
+*********************************************************************/
+static val_value_t *
+    new_skeleton_node (const val_value_t *node,
+                       status_t *res)
+{
+    val_value_t        *newval, *keyval;
+    const val_index_t  *valindex;
+
+    newval = val_new_value();
+    if (newval == NULL) {
+        *res = ERR_INTERNAL_MEM;
+        return NULL;
+    }
+    val_init_from_template(newval, node->obj);
+
+    for (valindex = val_get_first_index(node);
+         valindex != NULL;
+         valindex = val_get_next_index(valindex)) {
+        keyval = val_clone(valindex->val);
+        if (keyval == NULL) {
+            val_free_value(newval);
+            *res = ERR_INTERNAL_MEM;
+            return NULL;
+        }
+        val_add_child(keyval, newval);
+    }
+
+    *res = NO_ERR;
+    return newval;
+
+}  /* new_skeleton_node */
+
+
+/********************************************************************
+* FUNCTION add_ancestors
+*
+* Make the skeleton copies of all the ancestors of a node
+*
+* INPUTS:
+*    node == node to make the ancestors for
+*    root == address of return skeleton config root
+*    depth == address of return depth of node
+*    res == address of return status
+*
+* OUTPUTS:
+*    *root == malloced skeleton config root
+*    *depth == level of node below the config root
+*    *res == return status
+*
+* RETURNS:
+*    skeleton copy of the parent of node
+*    NULL if error; *root may still need to be freed
+*********************************************************************/
+static val_value_t *
+    add_ancestors (const val_value_t *node,
+                   val_value_t **root,
+                   uint32 *depth,
+                   status_t *res)
+{
+    val_value_t  *parent, *skelparent, *skel;
+
+    parent = node->parent;
+    if (parent == NULL) {
+        *res = SET_ERROR(ERR_INTERNAL_VAL);
+        return NULL;
+    }
+
+    if (obj_is_root(parent->obj)) {
+        *root = val_new_value();
+        if (*root == NULL) {
+            *res = ERR_INTERNAL_MEM;
+            return NULL;
+        }
+        val_init_from_template(*root, parent->obj);
+        *depth = 1;
+        *res = NO_ERR;
+        return *root;
+    }
+
+    skelparent = add_ancestors(parent, root, depth, res);
+    if (skelparent == NULL) {
+        return NULL;
+    }
+
+    skel = new_skeleton_node(parent, res);
+    if (skel == NULL) {
+        return NULL;
+    }
+    val_add_child(skel, skelparent);
+    (*depth)++;
+    return skel;
+
+}  /* add_ancestors */
+
+
+/********************************************************************
+* FUNCTION write_config
+*
+* Write 1 <config> record with its attributes to the
+* pending records and free it
+*
+* INPUTS:
+*    root == malloced skeleton config root of the record
+*    node == edit point in the running config
+*    op == record operation
+*    depth == level of the edit point below the config root
+*    testfn == test function to filter the written nodes
+*              (NULL to write all of them)
+*
+* RETURNS:
+*    status
+*********************************************************************/
+static status_t
+    write_config (val_value_t *root,
+                  const val_value_t *node,
+                  const xmlChar *op,
+                  uint32 depth,
+                  val_nodetest_fn_t testfn)
+{
+    const val_index_t  *valindex;
+    xml_attrs_t         attrs;
+    xmlChar             numbuff[NCX_MAX_NUMLEN];
+    uint32              keycount;
+    status_t            res;
+
+    xml_init_attrs(&attrs);
+    res = xml_add_attr(&attrs, 0, JOURNAL_A_OPERATION, op);
+    if (res == NO_ERR) {
+        snprintf((char *)numbuff, sizeof(numbuff), "%u", depth);
+        res = xml_add_attr(&attrs, 0, JOURNAL_A_DEPTH, numbuff);
+    }
+    if (res == NO_ERR && node->obj->objtype == OBJ_TYP_LIST) {
+        keycount = 0;
+        for (valindex = val_get_first_index(node);
+             valindex != NULL;
+             valindex = val_get_next_index(valindex)) {
+            keycount++;
+        }
+        snprintf((char *)numbuff, sizeof(numbuff), "%u", keycount);
+        res = xml_add_attr(&attrs, 0, JOURNAL_A_KEYS, numbuff);
+    }
+    if (res == NO_ERR && node->obj->objtype == OBJ_TYP_LEAF_LIST) {
+        res = xml_add_attr(&attrs, 0, JOURNAL_A_LEAF_LIST, NCX_EL_TRUE);
+    }
+
+    if (res == NO_ERR) {
+        res = xml_wr_check_open_file(pendingfp,
+                                     root,
+                                     &attrs,
+                                     XMLMODE,
+                                     FALSE,
+                                     TRUE,
+                                     0,
+                                     0,
+                                     testfn);
+        fputc('\n', pendingfp);
+    }
+
+    xml_clean_attrs(&attrs);
+    val_free_value(root);
+    return res;
+
+}  /* write_config */
+
+
+/********************************************************************
+* FUNCTION write_record
+*
+* Write 1 <config> record to the pending records
+*
+* INPUTS:
+*    node == edit point in the running config
+*    isdelete == TRUE if node is being deleted
+*                FALSE if node has its new value
+*
+* RETURNS:
+*    status; ERR_NCX_OPERATION_NOT_SUPPORTED if the edit
+*    cannot be recorded
+*********************************************************************/
+static status_t
+    write_record (val_value_t *node,
+                  boolean isdelete)
+{
+    val_value_t        *root, *parentskel, *editval;
+    uint32              depth;
+    status_t            res;
+
+    if (obj_is_root(node->obj)) {
+        return ERR_NCX_OPERATION_NOT_SUPPORTED;
+    }
+
+    /* a node the startup file leaves out is the same as
+     * a deleted node   */
+    if (!isdelete && !agt_check_save(NCX_DEF_WITHDEF, TRUE, node)) {
+        isdelete = TRUE;
+    }
+
+    root = NULL;
+    depth = 0;
+    res = NO_ERR;
+    parentskel = add_ancestors(node, &root, &depth, &res);
+    if (parentskel == NULL) {
+        if (root) {
+            val_free_value(root);
+        }
+        return res;
+    }
+
+    if (!isdelete || obj_is_leafy(node->obj)) {
+        editval = val_clone(node);
+        if (editval == NULL) {
+            res = ERR_INTERNAL_MEM;
+        } else {
+            /* xml_wr skips deleted nodes */
+            VAL_UNMARK_DELETED(editval);
+        }
+    } else {
+        editval = new_skeleton_node(node, &res);
+    }
+    if (editval == NULL) {
+        val_free_value(root);
+        return res;
+    }
+    val_add_child(editval, parentskel);
+
+    return write_config(root,
+                        node,
+                        (isdelete) ? JOURNAL_OP_DELETE : JOURNAL_OP_REPLACE,
+                        depth,
+                        (isdelete) ? NULL : agt_check_save);
+
+}  /* write_record */
+
+
+/********************************************************************
+* FUNCTION write_order_record
+*
+* Write the order of all the entries of a user ordered
+* list or leaf-list to the pending records
+*
+* INPUTS:
+*    node == new or moved entry in the running config
+*
+* RETURNS:
+*    status
+*********************************************************************/
+static status_t
+    write_order_record (val_value_t *node)
+{
+    val_value_t  *root, *parentskel, *entry, *skel;
+    uint32        depth;
+    status_t      res;
+
+    root = NULL;
+    depth = 0;
+    res = NO_ERR;
+    parentskel = add_ancestors(node, &root, &depth, &res);
+    if (parentskel == NULL) {
+        if (root) {
+            val_free_value(root);
+        }
+        return res;
+    }
+
+    /* only the keys of the list entries are needed */
+    for (entry = val_get_first_child(node->parent);
+         entry != NULL && res == NO_ERR;
+         entry = val_get_next_child(entry)) {
+        if (entry->obj != node->obj || VAL_IS_DELETED(entry)) {
+            continue;
+        }
+        if (node->obj->objtype == OBJ_TYP_LIST) {
+            skel = new_skeleton_node(entry, &res);
+        } else {
+            skel = val_clone(entry);
+            if (skel == NULL) {
+                res = ERR_INTERNAL_MEM;
+            }
+        }
+        if (skel) {
+            val_add_child(skel, parentskel);
+        }
+    }
+    if (res != NO_ERR) {
+        val_free_value(root);
+        return res;
+    }
+
+    return write_config(root, node, JOURNAL_OP_ORDER, depth, NULL);
+
+}  /* write_order_record */
+
+
+/********************************************************************
+* FUNCTION is_user_ordered
+*
+* Check if a node is an entry of a user ordered list or leaf-list
+*
+* INPUTS:
+*    node == node to check
+*
+* RETURNS:
+*    TRUE if the order of node is set by the client
+*********************************************************************/
+static boolean
+    is_user_ordered (const val_value_t *node)
+{
+    return ((node->obj->objtype == OBJ_TYP_LIST ||
+             node->obj->objtype == OBJ_TYP_LEAF_LIST) &&
+            !obj_is_system_ordered(node->obj)) ? TRUE : FALSE;
+
+}  /* is_user_ordered */
+
+
+/********************************************************************
+* FUNCTION in_config
+*
+* Check if a node is part of a config tree
+*
+* INPUTS:
+*    node == node to check
+*    cfg == config to check
+*
+* RETURNS:
+*    TRUE if node is in cfg->root and not marked deleted
+*********************************************************************/
+static boolean
+    in_config (const val_value_t *node,
+               const cfg_template_t *cfg)
+{
+    for (; node != NULL; node = node->parent) {
+        if (VAL_IS_DELETED(node)) {
+            return FALSE;
+        }
+        if (node == cfg->root) {
+            return TRUE;
+        }
+    }
+    return FALSE;
+
+}  /* in_config */
+
+
+/********************************************************************
+* FUNCTION append_journal
+*
+* Append the pending records to the journal file
+*
+* INPUTS:
+*    journal == journal filespec
+*
+* RETURNS:
+*    status
+*********************************************************************/
+static status_t
+    append_journal (const xmlChar *journal)
+{
+    struct stat  statbuff;
+    const char  *str;
+    size_t       left;
+    ssize_t      ret;
+    int          fd;
+    status_t     res;
+
+    fd = open((const char *)journal, O_WRONLY | O_APPEND | O_CREAT, 0666);
+    if (fd < 0 || fstat(fd, &statbuff) != 0) {
+        log_error("\nError: open journal '%s' failed (%s)",
+                  journal,
+                  strerror(errno));
+        if (fd >= 0) {
+            close(fd);
+        }
+        return ERR_FIL_OPEN;
+    }
+
+    res = NO_ERR;
+    str = pendingbuff;
+    left = pendingsize;
+    while (left > 0) {
+        ret = write(fd, str, left);
+        if (ret < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            log_error("\nError: write journal '%s' failed (%s)",
+                      journal,
+                      strerror(errno));
+            res = ERR_FIL_WRITE;
+            break;
+        }
+        str += ret;
+        left -= (size_t)ret;
+    }
+
+    if (res == NO_ERR && fsync(fd) != 0) {
+        res = ERR_FIL_WRITE;
+    }
+
+    if (res != NO_ERR) {
+        /* do not leave part of a transaction in the journal */
+        if (ftruncate(fd, statbuff.st_size) != 0) {
+            log_error("\nError: truncate journal '%s' failed (%s)",
+                      journal,
+                      strerror(errno));
+        }
+    } else {
+        journalsize = statbuff.st_size + (off_t)pendingsize;
+    }
+    close(fd);
+
+    if (res == NO_ERR && statbuff.st_size == 0) {
+        res = agt_nvstore_sync_dir(journal);
+    }
+    return res;
+
+}  /* append_journal */
+
+
+/********************************************************************
+* FUNCTION compact
+*
+* Write the whole config to the startup file and
+* remove the journal
+*
+* INPUTS:
+*    cfg == config to save
+*    filespec == startup file
+*
+* RETURNS:
+*    status
+*********************************************************************/
+static status_t
+    compact (cfg_template_t *cfg,
+             const xmlChar *filespec)
+{
+    agt_profile_t  *profile;
+    xmlChar        *journal, *renamed;
+    status_t        res;
+
+    profile = agt_get_profile();
+    basevalid = FALSE;
+    drop_pending();
+
+    if (LOGDEBUG) {
+        log_debug("\nagt_journal: writing the whole config to '%s'",
+                  filespec);
+    }
+
+    journal = make_filespec(filespec, AGT_JOURNAL_SUFFIX, NULL);
+    if (journal == NULL) {
+        return ERR_INTERNAL_MEM;
+    }
+
+    if (profile->agt_async_nvstore && !compacting) {
+        /* the journal is still needed until the config is
+         * written, so just move it out of the way   */
+        renamed = make_filespec(filespec, AGT_JOURNAL_SUFFIX,
+                                AGT_JOURNAL_OLD_SUFFIX);
+        if (renamed == NULL) {
+            m__free(journal);
+            return ERR_INTERNAL_MEM;
+        }
+
+        if (rename((const char *)journal, (const char *)renamed) == 0) {
+            (void)agt_nvstore_sync_dir(journal);
+            oldjournal = renamed;
+            res = NO_ERR;
+        } else if (errno == ENOENT) {
+            m__free(renamed);
+            res = NO_ERR;
+        } else {
+            log_error("\nError: rename journal '%s' failed (%s)",
+                      journal,
+                      strerror(errno));
+            m__free(renamed);
+            res = ERR_FIL_WRITE;
+        }
+
+        if (res == NO_ERR) {
+            compacting = TRUE;
+            rotatetxid = cfg->last_txid;
+            res = agt_nvstore_save_async(cfg, filespec);
+        }
+    } else {
+        res = agt_nvstore_save(cfg, filespec);
+        if (res == NO_ERR) {
+            compacting = FALSE;
+            (void)unlink((const char *)journal);
+            if (oldjournal) {
+                (void)unlink((const char *)oldjournal);
+                m__free(oldjournal);
+                oldjournal = NULL;
+            }
+            (void)agt_nvstore_sync_dir(journal);
+        }
+    }
+
+    if (res == NO_ERR && journal_enabled(cfg)) {
+        basevalid = TRUE;
+        basetxid = cfg->last_txid;
+        journalsize = 0;
+        if (!compacting) {
+            fullsize = get_file_size(filespec);
+        }
+    }
+
+    m__free(journal);
+    return res;
+
+}  /* compact */
+
+
+/********************************************************************
+* FUNCTION same_element
+*
+* Check if 2 XML nodes are elements with the same name
+*
+* INPUTS:
+*    node1 == first node
+*    node2 == second node
+*
+* RETURNS:
+*    TRUE if same element name and namespace
+*********************************************************************/
+static boolean
+    same_element (const xmlNode *node1,
+                  const xmlNode *node2)
+{
+    if (node1->type != XML_ELEMENT_NODE ||
+        node2->type != XML_ELEMENT_NODE ||
+        !xmlStrEqual(node1->name, node2->name)) {
+        return FALSE;
+    }
+
+    if (node1->ns == NULL || node2->ns == NULL) {
+        return (node1->ns == node2->ns) ? TRUE : FALSE;
+    }
+    return xmlStrEqual(node1->ns->href, node2->ns->href) ? TRUE : FALSE;
+
+}  /* same_element */
+
+
+/********************************************************************
+* FUNCTION expand_prefixes
+*
+* Replace each prefix in a QName or instance-identifier
+* string with the namespace it is bound to at an XML node,
+* so 2 strings can be compared whatever prefixes they use
+*
+* INPUTS:
+*    node == XML node with the string content
+*    str == string to expand
+*    isidref == TRUE if str is an identityref, which uses the
+*               default namespace if it has no prefix
+*    buff == buffer to write the expanded string into
+*            (NULL to get the length only)
+*
+* RETURNS:
+*    length of the expanded string
+*********************************************************************/
+static uint32
+    expand_prefixes (xmlNode *node,
+                     const xmlChar *str,
+                     boolean isidref,
+                     xmlChar *buff)
+{
+    const xmlChar  *p, *start;
+    xmlChar        *prefix;
+    xmlNs          *ns;
+    xmlChar         quote;
+    uint32          len, cnt;
+
+    len = 0;
+    if (isidref && xmlStrchr(str, ':') == NULL) {
+        ns = xmlSearchNs(node->doc, node, NULL);
+        if (ns && ns->href) {
+            len = (uint32)xmlStrlen(ns->href) + 2;
+            if (buff) {
+                buff += xml_strcpy(buff, (const xmlChar *)"{");
+                buff += xml_strcpy(buff, ns->href);
+                buff += xml_strcpy(buff, (const xmlChar *)"}");
+            }
+        }
+    }
+
+    quote = 0;
+    p = str;
+    while (*p) {
+        /* names inside the key predicate literals stay as is */
+        if (quote || *p == '\'' || *p == '"' ||
+            !ncx_valid_fname_ch(*p)) {
+            if (quote == 0 && (*p == '\'' || *p == '"')) {
+                quote = *p;
+            } else if (*p == quote) {
+                quote = 0;
+            }
+            if (buff) {
+                *buff++ = *p;
+            }
+            p++;
+            len++;
+            continue;
+        }
+
+        start = p;
+        while (ncx_valid_name_ch(*p)) {
+            p++;
+        }
+
+        ns = NULL;
+        if (*p == ':' && p[1] != ':') {
+            prefix = xmlStrndup(start, (int)(p - start));
+            if (prefix) {
+                ns = xmlSearchNs(node->doc, node, prefix);
+                xmlFree(prefix);
+            }
+        }
+
+        if (ns && ns->href) {
+            p++;
+            len += (uint32)xmlStrlen(ns->href) + 2;
+            if (buff) {
+                buff += xml_strcpy(buff, (const xmlChar *)"{");
+                buff += xml_strcpy(buff, ns->href);
+                buff += xml_strcpy(buff, (const xmlChar *)"}");
+            }
+        } else {
+            cnt = (uint32)(p - start);
+            len += cnt;
+            if (buff) {
+                memcpy(buff, start, cnt);
+                buff += cnt;
+            }
+        }
+    }
+
+    if (buff) {
+        *buff = 0;
+    }
+    return len;
+
+}  /* expand_prefixes */
+
+
+/********************************************************************
+* FUNCTION same_expanded
+*
+* Check if 2 QName or instance-identifier strings are the
+* same once their prefixes are replaced by the namespaces
+*
+* INPUTS:
+*    node1 == first XML node
+*    str1 == content of node1
+*    node2 == second XML node
+*    str2 == content of node2
+*    isidref == TRUE if the strings are identityrefs
+*
+* RETURNS:
+*    TRUE if same value
+*********************************************************************/
+static boolean
+    same_expanded (xmlNode *node1,
+                   const xmlChar *str1,
+                   xmlNode *node2,
+                   const xmlChar *str2,
+                   boolean isidref)
+{
+    xmlChar  *buff1, *buff2;
+    boolean   ret;
+
+    buff1 = m__getMem(expand_prefixes(node1, str1, isidref, NULL) + 1);
+    buff2 = m__getMem(expand_prefixes(node2, str2, isidref, NULL) + 1);
+    if (buff1 == NULL || buff2 == NULL) {
+        ret = xmlStrEqual(str1, str2) ? TRUE : FALSE;
+    } else {
+        (void)expand_prefixes(node1, str1, isidref, buff1);
+        (void)expand_prefixes(node2, str2, isidref, buff2);
+        ret = xmlStrEqual(buff1, buff2) ? TRUE : FALSE;
+    }
+    if (buff1) {
+        m__free(buff1);
+    }
+    if (buff2) {
+        m__free(buff2);
+    }
+    return ret;
+
+}  /* same_expanded */
+
+
+/********************************************************************
+* FUNCTION same_simval
+*
+* Check if 2 strings are the same value of a leaf or leaf-list
+*
+* INPUTS:
+*    obj == leaf or leaf-list object
+*    str1 == first value string
+*    str2 == second value string
+*
+* RETURNS:
+*    TRUE if same value
+*********************************************************************/
+static boolean
+    same_simval (obj_template_t *obj,
+                 const xmlChar *str1,
+                 const xmlChar *str2)
+{
+    val_value_t  *val1, *val2;
+    boolean       ret;
+
+    ret = FALSE;
+    val1 = val_new_value();
+    val2 = val_new_value();
+    if (val1 && val2) {
+        val_init_from_template(val1, obj);
+        val_init_from_template(val2, obj);
+        if (val_set_simval_obj(val1, obj, str1) == NO_ERR &&
+            val_set_simval_obj(val2, obj, str2) == NO_ERR &&
+            val_compare(val1, val2) == 0) {
+            ret = TRUE;
+        }
+    }
+    if (val1) {
+        val_free_value(val1);
+    }
+    if (val2) {
+        val_free_value(val2);
+    }
+    return ret;
+
+}  /* same_simval */
+
+
+/********************************************************************
+* FUNCTION same_value
+*
+* Check if 2 XML nodes have the same value
+*
+* INPUTS:
+*    node1 == first node
+*    node2 == second node
+*    obj == leaf or leaf-list object of the nodes
+*           (NULL to compare the text content)
+*
+* RETURNS:
+*    TRUE if same value
+*********************************************************************/
+static boolean
+    same_value (xmlNode *node1,
+                xmlNode *node2,
+                obj_template_t *obj)
+{
+    xmlChar  *str1, *str2;
+    boolean   ret;
+
+    str1 = xmlNodeGetContent(node1);
+    str2 = xmlNodeGetContent(node2);
+    if (str1 == NULL || str2 == NULL) {
+        ret = (str1 == str2) ? TRUE : FALSE;
+    } else if (obj == NULL) {
+        ret = xmlStrEqual(str1, str2) ? TRUE : FALSE;
+    } else {
+        switch (obj_get_basetype(obj)) {
+        case NCX_BT_IDREF:
+            ret = same_expanded(node1, str1, node2, str2, TRUE);
+            break;
+        case NCX_BT_INSTANCE_ID:
+            ret = same_expanded(node1, str1, node2, str2, FALSE);
+            break;
+        case NCX_BT_STRING:
+        case NCX_BT_BINARY:
+        case NCX_BT_ENUM:
+        case NCX_BT_EMPTY:
+            ret = xmlStrEqual(str1, str2) ? TRUE : FALSE;
+            break;
+        default:
+            ret = (xmlStrEqual(str1, str2) ||
+                   same_simval(obj, str1, str2)) ? TRUE : FALSE;
+        }
+    }
+    if (str1) {
+        xmlFree(str1);
+    }
+    if (str2) {
+        xmlFree(str2);
+    }
+    return ret;
+
+}  /* same_value */
+
+
+/********************************************************************
+* FUNCTION find_node_obj
+*
+* Find the object template of a startup or record node
+*
+* INPUTS:
+*    parentobj == object of the parent node
+*                 (NULL for a top-level node)
+*    node == XML node
+*
+* RETURNS:
+*    object template or NULL if not found
+*********************************************************************/
+static obj_template_t *
+    find_node_obj (obj_template_t *parentobj,
+                   const xmlNode *node)
+{
+    ncx_module_t    *mod;
+    const xmlChar   *modname;
+    xmlns_id_t       nsid;
+
+    if (node->ns == NULL || node->ns->href == NULL) {
+        return NULL;
+    }
+
+    nsid = xmlns_find_ns_by_name(node->ns->href);
+    modname = (nsid) ? xmlns_get_module(nsid) : NULL;
+    if (modname == NULL) {
+        return NULL;
+    }
+
+    if (parentobj) {
+        return obj_find_child(parentobj, modname, node->name);
+    }
+
+    mod = ncx_find_module(modname, NULL);
+    return (mod) ? obj_find_template_top(mod, modname, node->name) : NULL;
+
+}  /* find_node_obj */
+
+
+/********************************************************************
+* FUNCTION get_schema_index
+*
+* Get the position of a child object in the schema order
+* of the data nodes of its parent, looking into any choices
+*
+* INPUTS:
+*    parentobj == parent object, choice or case
+*    obj == child object to find
+*    index == address of position counter
+*
+* OUTPUTS:
+*    *index == position of obj if found
+*
+* RETURNS:
+*    TRUE if obj was found
+*********************************************************************/
+static boolean
+    get_schema_index (obj_template_t *parentobj,
+                      const obj_template_t *obj,
+                      uint32 *index)
+{
+    obj_template_t  *child;
+
+    for (child = obj_first_child(parentobj);
+         child != NULL;
+         child = obj_next_child(child)) {
+        if (child->objtype == OBJ_TYP_CHOICE ||
+            child->objtype == OBJ_TYP_CASE) {
+            if (get_schema_index(child, obj, index)) {
+                return TRUE;
+            }
+        } else if (child == obj) {
+            return TRUE;
+        } else {
+            (*index)++;
+        }
+    }
+    return FALSE;
+
+}  /* get_schema_index */
+
+
+/********************************************************************
+* FUNCTION goes_after
+*
+* Check if a new node goes after a sibling in the startup
+* document: in schema order, or in name order at the top-level
+*
+* INPUTS:
+*    parentobj == object of the parent node
+*                 (NULL for the config root)
+*    sibling == sibling node to check
+*    node == new node
+*    nodeindex == schema position of node
+*
+* RETURNS:
+*    TRUE if node goes after sibling
+*********************************************************************/
+static boolean
+    goes_after (obj_template_t *parentobj,
+                const xmlNode *sibling,
+                const xmlNode *node,
+                uint32 nodeindex)
+{
+    obj_template_t  *sibobj;
+    uint32           sibindex;
+
+    if (parentobj == NULL) {
+        return (xmlStrcmp(sibling->name, node->name) <= 0) ? TRUE : FALSE;
+    }
+
+    sibobj = find_node_obj(parentobj, sibling);
+    sibindex = 0;
+    if (sibobj == NULL || !get_schema_index(parentobj, sibobj, &sibindex)) {
+        /* leave unknown nodes in front */
+        return TRUE;
+    }
+    return (sibindex <= nodeindex) ? TRUE : FALSE;
+
+}  /* goes_after */
+
+
+/********************************************************************
+* FUNCTION add_child_sorted
+*
+* Add a new node to a startup node after all the
+* siblings it goes after; a new list or leaf-list entry
+* goes after the existing entries
+*
+* INPUTS:
+*    parent == startup node
+*    parentobj == object of parent (NULL for the config root)
+*    child == new node to add
+*    childobj == object of child (NULL if not known)
+*
+*********************************************************************/
+static void
+    add_child_sorted (xmlNode *parent,
+                      obj_template_t *parentobj,
+                      xmlNode *child,
+                      obj_template_t *childobj)
+{
+    xmlNode  *sibling, *last;
+    uint32    index;
+    boolean   after;
+
+    index = 0;
+    if (childobj == NULL ||
+        (parentobj && !get_schema_index(parentobj, childobj, &index))) {
+        xmlAddChild(parent, child);
+        return;
+    }
+
+    after = TRUE;
+    last = NULL;
+    for (sibling = parent->children; sibling != NULL; sibling = sibling->next) {
+        if (sibling->type != XML_ELEMENT_NODE) {
+            continue;
+        }
+        /* siblings of the same type all give the same answer */
+        if (last == NULL || !same_element(sibling, last)) {
+            after = goes_after(parentobj, sibling, child, index);
+        }
+        if (!after) {
+            break;
+        }
+        last = sibling;
+    }
+
+    if (sibling) {
+        xmlAddPrevSibling(sibling, child);
+    } else {
+        xmlAddChild(parent, child);
+    }
+
+}  /* add_child_sorted */
+
+
+/********************************************************************
+* FUNCTION last_element
+*
+* Get the last child element of an XML node
+*
+* INPUTS:
+*    node == parent node
+*    count == address of return number of child elements
+*
+* OUTPUTS:
+*    *count == number of child elements
+*
+* RETURNS:
+*    last child element or NULL if none
+*********************************************************************/
+static xmlNode *
+    last_element (xmlNode *node,
+                  uint32 *count)
+{
+    xmlNode  *child, *last;
+
+    *count = 0;
+    last = NULL;
+    for (child = node->children; child != NULL; child = child->next) {
+        if (child->type == XML_ELEMENT_NODE) {
+            last = child;
+            (*count)++;
+        }
+    }
+    return last;
+
+}  /* last_element */
+
+
+/********************************************************************
+* FUNCTION find_match
+*
+* Find the child of a startup node that matches a record node
+*
+* INPUTS:
+*    parent == startup node to search
+*    recnode == record node to match
+*    recobj == object of recnode (NULL if not known)
+*    keycount == number of leading child elements of recnode
+*                that are list keys
+*    byvalue == TRUE to match the leaf-list value
+*
+* RETURNS:
+*    matching child of parent or NULL if none
+*********************************************************************/
+static xmlNode *
+    find_match (xmlNode *parent,
+                xmlNode *recnode,
+                obj_template_t *recobj,
+                uint32 keycount,
+                boolean byvalue)
+{
+    xmlNode         *child, *key, *childkey;
+    obj_template_t  *keyobj;
+    uint32           i;
+    boolean          match;
+
+    for (child = parent->children; child != NULL; child = child->next) {
+        if (!same_element(child, recnode)) {
+            continue;
+        }
+
+        if (byvalue) {
+            if (same_value(child, recnode, recobj)) {
+                return child;
+            }
+            continue;
+        }
+
+        match = TRUE;
+        i = 0;
+        for (key = recnode->children;
+             key != NULL && i < keycount && match;
+             key = key->next) {
+            if (key->type != XML_ELEMENT_NODE) {
+                continue;
+            }
+            i++;
+            for (childkey = child->children;
+                 childkey != NULL;
+                 childkey = childkey->next) {
+                if (same_element(childkey, key)) {
+                    break;
+                }
+            }
+            keyobj = (recobj) ? find_node_obj(recobj, key) : NULL;
+            if (childkey == NULL || !same_value(childkey, key, keyobj)) {
+                match = FALSE;
+            }
+        }
+        if (match) {
+            return child;
+        }
+    }
+    return NULL;
+
+}  /* find_match */
+
+
+/********************************************************************
+* FUNCTION order_children
+*
+* Move the entries of a user ordered list or leaf-list
+* into the order given by an order record
+*
+* INPUTS:
+*    parent == startup node with the entries
+*    parentobj == object of parent (NULL for the config root)
+*    src == record node with the entries in the new order
+*    keycount == number of keys of each list entry
+*    byvalue == TRUE if the entries are leaf-list values
+*
+*********************************************************************/
+static void
+    order_children (xmlNode *parent,
+                    obj_template_t *parentobj,
+                    xmlNode *src,
+                    uint32 keycount,
+                    boolean byvalue)
+{
+    xmlNode         *srcchild, *match, *first, *prev;
+    obj_template_t  *entryobj;
+
+    entryobj = NULL;
+    prev = NULL;
+    for (srcchild = src->children; srcchild != NULL; srcchild = srcchild->next) {
+        if (srcchild->type != XML_ELEMENT_NODE) {
+            continue;
+        }
+        if (prev == NULL) {
+            entryobj = find_node_obj(parentobj, srcchild);
+        }
+
+        match = find_match(parent, srcchild, entryobj, keycount, byvalue);
+        if (match == NULL) {
+            continue;
+        }
+
+        if (prev == NULL) {
+            /* the first entry takes the place of the current first */
+            for (first = parent->children;
+                 first != NULL && !same_element(first, match);
+                 first = first->next) {
+                ;
+            }
+            if (first != match) {
+                xmlAddPrevSibling(first, match);
+            }
+        } else if (prev->next != match) {
+            xmlAddNextSibling(prev, match);
+        }
+        prev = match;
+    }
+
+}  /* order_children */
+
+
+/********************************************************************
+* FUNCTION copy_node
+*
+* Copy a journal record node into the startup document,
+* using the namespace declarations already in the document
+*
+* INPUTS:
+*    doc == startup document
+*    parent == startup node the copy will be added to
+*    src == record node to copy
+*
+* RETURNS:
+*    copied node or NULL if malloc failed
+*********************************************************************/
+static xmlNode *
+    copy_node (xmlDoc *doc,
+               xmlNode *parent,
+               xmlNode *src)
+{
+    xmlNode  *copy;
+
+    copy = NULL;
+    if (xmlDOMWrapCloneNode(NULL, src->doc, src, &copy, doc, parent,
+                            1, 0) != 0) {
+        if (copy) {
+            xmlFreeNode(copy);
+        }
+        return NULL;
+    }
+    return copy;
+
+}  /* copy_node */
+
+
+/********************************************************************
+* FUNCTION apply_record
+*
+* Apply 1 journal <config> record to the startup document
+*
+* INPUTS:
+*    doc == startup document
+*    rec == <config> record
+*
+* RETURNS:
+*    status
+*********************************************************************/
+static status_t
+    apply_record (xmlDoc *doc,
+                  xmlNode *rec)
+{
+    xmlNode         *dst, *src, *srcchild, *match, *copy;
+    obj_template_t  *dstobj, *srcobj;
+    xmlChar         *op, *depthstr, *keystr, *leaflist;
+    uint32           depth, level, count, keycount;
+    boolean          isdelete, isorder;
+    status_t         res;
+
+    op = xmlGetProp(rec, JOURNAL_A_OPERATION);
+    depthstr = xmlGetProp(rec, JOURNAL_A_DEPTH);
+    keystr = xmlGetProp(rec, JOURNAL_A_KEYS);
+    leaflist = xmlGetProp(rec, JOURNAL_A_LEAF_LIST);
+
+    res = NO_ERR;
+    isdelete = xmlStrEqual(op, JOURNAL_OP_DELETE) ? TRUE : FALSE;
+    isorder = xmlStrEqual(op, JOURNAL_OP_ORDER) ? TRUE : FALSE;
+    depth = (depthstr) ? (uint32)atoi((const char *)depthstr) : 0;
+    keycount = (keystr) ? (uint32)atoi((const char *)keystr) : 0;
+    if ((!isdelete && !isorder && !xmlStrEqual(op, JOURNAL_OP_REPLACE)) ||
+        depth == 0) {
+        res = ERR_NCX_INVALID_VALUE;
+    }
+
+    /* the objects are used to compare the keys by value and to
+     * put a new node in schema order; a node from a module that
+     * is not loaded any more is compared by text and added last */
+    dst = xmlDocGetRootElement(doc);
+    dstobj = NULL;
+    src = rec;
+    for (level = 1; res == NO_ERR && dst != NULL; level++) {
+        if (isorder && level == depth) {
+            /* src has all the entries in the new order */
+            order_children(dst, dstobj, src, keycount,
+                           (leaflist) ? TRUE : FALSE);
+            break;
+        }
+
+        srcchild = last_element(src, &count);
+        if (srcchild == NULL) {
+            res = ERR_NCX_INVALID_VALUE;
+            break;
+        }
+        srcobj = find_node_obj(dstobj, srcchild);
+
+        if (level == depth) {
+            match = find_match(dst, srcchild, srcobj, keycount,
+                               (leaflist) ? TRUE : FALSE);
+            if (isdelete) {
+                if (match) {
+                    xmlUnlinkNode(match);
+                    xmlFreeNode(match);
+                }
+            } else {
+                copy = copy_node(doc, dst, srcchild);
+                if (copy == NULL) {
+                    res = ERR_INTERNAL_MEM;
+                } else if (match) {
+                    xmlReplaceNode(match, copy);
+                    xmlFreeNode(match);
+                } else {
+                    add_child_sorted(dst, dstobj, copy, srcobj);
+                }
+            }
+            break;
+        }
+
+        /* all the child elements except the last are keys,
+         * unless the next level has the entries of an order record */
+        if (srcobj) {
+            count = (srcobj->objtype == OBJ_TYP_LIST) ?
+                obj_key_count(srcobj) : 0;
+        } else if (isorder && level + 1 == depth) {
+            break;
+        } else {
+            (void)last_element(srcchild, &count);
+            count = (count) ? count - 1 : 0;
+        }
+        match = find_match(dst, srcchild, srcobj, count, FALSE);
+        if (match == NULL) {
+            if (!isdelete && !isorder) {
+                /* the record has the ancestors of the new node */
+                copy = copy_node(doc, dst, srcchild);
+                if (copy == NULL) {
+                    res = ERR_INTERNAL_MEM;
+                } else {
+                    add_child_sorted(dst, dstobj, copy, srcobj);
+                }
+            }
+            break;
+        }
+        dst = match;
+        dstobj = srcobj;
+        src = srcchild;
+    }
+
+    if (op) {
+        xmlFree(op);
+    }
+    if (depthstr) {
+        xmlFree(depthstr);
+    }
+    if (keystr) {
+        xmlFree(keystr);
+    }
+    if (leaflist) {
+        xmlFree(leaflist);
+    }
+    return res;
+
+}  /* apply_record */
+
+
+/********************************************************************
+* FUNCTION replay_journal
+*
+* Apply all the complete transactions in a journal
+* file to the startup document
+*
+* INPUTS:
+*    doc == startup document
+*    journal == journal filespec
+*
+* RETURNS:
+*    status
+*********************************************************************/
+static status_t
+    replay_journal (xmlDoc *doc,
+                    const xmlChar *journal)
+{
+    FILE      *fil;
+    xmlDoc    *jdoc;
+    xmlNode   *txnode, *rec;
+    char      *buff, *str;
+    long       filesize;
+    size_t     len, datalen, taglen, pos;
+    uint32     txcount;
+    status_t   res;
+
+    fil = fopen((const char *)journal, "r");
+    if (fil == NULL) {
+        if (errno == ENOENT) {
+            return NO_ERR;
+        }
+        log_error("\nError: open journal '%s' failed (%s)",
+                  journal,
+                  strerror(errno));
+        return ERR_FIL_OPEN;
+    }
+
+    if (fseek(fil, 0, SEEK_END) != 0 ||
+        (filesize = ftell(fil)) < 0 ||
+        fseek(fil, 0, SEEK_SET) != 0) {
+        fclose(fil);
+        return ERR_FIL_READ;
+    }
+
+    buff = m__getMem(sizeof(JOURNAL_START_TAG) + (size_t)filesize +
+                     sizeof(JOURNAL_END_TAG));
+    if (buff == NULL) {
+        fclose(fil);
+        return ERR_INTERNAL_MEM;
+    }
+
+    str = buff + strlen(JOURNAL_START_TAG);
+    len = fread(str, 1, (size_t)filesize, fil);
+    fclose(fil);
+    memcpy(buff, JOURNAL_START_TAG, strlen(JOURNAL_START_TAG));
+    str[len] = 0;
+
+    /* drop a transaction that was only partly written */
+    datalen = len;
+    taglen = strlen(TRANSACTION_END_TAG);
+    while (len >= taglen &&
+           strncmp(&str[len - taglen], TRANSACTION_END_TAG, taglen)) {
+        len--;
+    }
+    if (len < taglen) {
+        len = 0;
+    }
+    for (pos = len; pos < datalen; pos++) {
+        if (!xml_isspace((uint32)str[pos])) {
+            log_warn("\nWarning: ignoring incomplete transaction at "
+                     "end of journal '%s'",
+                     journal);
+            break;
+        }
+    }
+    strcpy(&str[len], JOURNAL_END_TAG);
+
+    jdoc = xmlReadMemory(buff, (int)strlen(buff), (const char *)journal,
+                         NULL, JOURNAL_PARSE_OPTIONS);
+    m__free(buff);
+    if (jdoc == NULL) {
+        log_error("\nError: parse journal '%s' failed", journal);
+        return ERR_NCX_INVALID_VALUE;
+    }
+
+    res = NO_ERR;
+    txcount = 0;
+    for (txnode = xmlDocGetRootElement(jdoc)->children;
+         txnode != NULL && res == NO_ERR;
+         txnode = txnode->next) {
+        if (txnode->type != XML_ELEMENT_NODE ||
+            !xmlStrEqual(txnode->name, JOURNAL_EL_TRANSACTION)) {
+            continue;
+        }
+        txcount++;
+        for (rec = txnode->children;
+             rec != NULL && res == NO_ERR;
+             rec = rec->next) {
+            if (rec->type == XML_ELEMENT_NODE &&
+                xmlStrEqual(rec->name, JOURNAL_EL_CONFIG)) {
+                res = apply_record(doc, rec);
+            }
+        }
+    }
+    xmlFreeDoc(jdoc);
+
+    if (res != NO_ERR) {
+        log_error("\nError: invalid record in journal '%s'", journal);
+    } else if (LOGINFO) {
+        log_info("\nReplayed %u transactions from journal '%s'",
+                 txcount,
+                 journal);
+    }
+    return res;
+
+}  /* replay_journal */
+
+
+/*************** E X T E R N A L    F U N C T I O N S  *************/
+
+
+/********************************************************************
+* FUNCTION agt_journal_start_commit
+*
+* Record the nodes deleted by a transaction on the running
+* config; called after the SIL commit callbacks accepted the
+* transaction, before the deleted nodes are freed
+*
+* INPUTS:
+*    txcb == transaction in progress
+*    target == config being changed
+*
+*********************************************************************/
+void
+    agt_journal_start_commit (agt_cfg_transaction_t *txcb,
+                              cfg_template_t *target)
+{
+    agt_cfg_undo_rec_t  *undo;
+    agt_cfg_nodeptr_t   *nodeptr;
+    status_t             res;
+
+    if (!basevalid || !journal_enabled(target)) {
+        return;
+    }
+
+    /* a load does not have an undo record for each edit */
+    for (undo = (agt_cfg_undo_rec_t *)dlq_firstEntry(&txcb->undoQ);
+         undo != NULL;
+         undo = (agt_cfg_undo_rec_t *)dlq_nextEntry(undo)) {
+        if (undo->editop == OP_EDITOP_LOAD) {
+            invalidate("config loaded");
+            return;
+        }
+    }
+
+    if (target->last_txid != basetxid) {
+        invalidate("transaction not recorded");
+        return;
+    }
+
+    if (pendingfp == NULL) {
+        pendingfp = open_memstream(&pendingbuff, &pendingsize);
+        if (pendingfp == NULL) {
+            invalidate("open_memstream failed");
+            return;
+        }
+    }
+
+    fprintf(pendingfp, "<transaction txid=\"%llu\">\n",
+            (unsigned long long)txcb->txid);
+
+    res = NO_ERR;
+    for (nodeptr = (agt_cfg_nodeptr_t *)dlq_firstEntry(&txcb->deadnodeQ);
+         nodeptr != NULL && res == NO_ERR;
+         nodeptr = (agt_cfg_nodeptr_t *)dlq_nextEntry(nodeptr)) {
+        res = write_record(nodeptr->node, TRUE);
+    }
+
+    for (undo = (agt_cfg_undo_rec_t *)dlq_firstEntry(&txcb->undoQ);
+         undo != NULL && res == NO_ERR;
+         undo = (agt_cfg_undo_rec_t *)dlq_nextEntry(undo)) {
+
+        if (undo->editop == OP_EDITOP_DELETE ||
+            undo->editop == OP_EDITOP_REMOVE) {
+            if (undo->curnode) {
+                res = write_record(undo->curnode, TRUE);
+            } else {
+                res = ERR_NCX_OPERATION_NOT_SUPPORTED;
+            }
+        }
+
+        /* nodes from other cases of a choice */
+        for (nodeptr = (agt_cfg_nodeptr_t *)
+                 dlq_firstEntry(&undo->extra_deleteQ);
+             nodeptr != NULL && res == NO_ERR;
+             nodeptr = (agt_cfg_nodeptr_t *)dlq_nextEntry(nodeptr)) {
+            res = write_record(nodeptr->node, TRUE);
+        }
+    }
+
+    if (res != NO_ERR) {
+        invalidate("deleted node not recorded");
+    }
+
+}  /* agt_journal_start_commit */
+
+
+/********************************************************************
+* FUNCTION agt_journal_finish_commit
+*
+* Record the new and changed nodes of a transaction on
+* the running config; called after all the edits are done
+*
+* INPUTS:
+*    txcb == transaction in progress
+*    target == config being changed
+*
+*********************************************************************/
+void
+    agt_journal_finish_commit (agt_cfg_transaction_t *txcb,
+                               cfg_template_t *target)
+{
+    agt_cfg_undo_rec_t  *undo;
+    agt_cfg_nodeptr_t   *nodeptr;
+    val_value_t         *node;
+    dlq_hdr_t            orderQ;
+    status_t             res;
+
+    if (!basevalid || pendingfp == NULL || !journal_enabled(target)) {
+        return;
+    }
+
+    /* 1 entry of each user ordered list or leaf-list changed */
+    dlq_createSQue(&orderQ);
+
+    res = NO_ERR;
+    for (undo = (agt_cfg_undo_rec_t *)dlq_firstEntry(&txcb->undoQ);
+         undo != NULL && res == NO_ERR;
+         undo = (agt_cfg_undo_rec_t *)dlq_nextEntry(undo)) {
+
+        if (undo->editop == OP_EDITOP_DELETE ||
+            undo->editop == OP_EDITOP_REMOVE) {
+            continue;
+        }
+
+        /* a merged leaf stays in the running config;
+         * a new or replaced node is moved into it  */
+        if (undo->newnode && in_config(undo->newnode, target)) {
+            node = undo->newnode;
+        } else if (undo->curnode && in_config(undo->curnode, target)) {
+            node = undo->curnode;
+        } else {
+            res = ERR_NCX_OPERATION_NOT_SUPPORTED;
+            break;
+        }
+        res = write_record(node, FALSE);
+
+        if (res == NO_ERR && is_user_ordered(node)) {
+            for (nodeptr = (agt_cfg_nodeptr_t *)dlq_firstEntry(&orderQ);
+                 nodeptr != NULL;
+                 nodeptr = (agt_cfg_nodeptr_t *)dlq_nextEntry(nodeptr)) {
+                if (nodeptr->node->parent == node->parent &&
+                    nodeptr->node->obj == node->obj) {
+                    break;
+                }
+            }
+            if (nodeptr == NULL) {
+                nodeptr = agt_cfg_new_nodeptr(node);
+                if (nodeptr == NULL) {
+                    res = ERR_INTERNAL_MEM;
+                } else {
+                    dlq_enque(nodeptr, &orderQ);
+                }
+            }
+        }
+    }
+
+    /* the entries are replayed in schema order, so the new
+     * order of each user ordered list is recorded after all
+     * the entries are in place */
+    while (!dlq_empty(&orderQ)) {
+        nodeptr = (agt_cfg_nodeptr_t *)dlq_deque(&orderQ);
+        if (res == NO_ERR) {
+            res = write_order_record(nodeptr->node);
+        }
+        agt_cfg_free_nodeptr(nodeptr);
+    }
+
+    if (res != NO_ERR) {
+        invalidate("edit not recorded");
+        return;
+    }
+
+    fputs(TRANSACTION_END_TAG "\n", pendingfp);
+    basetxid = txcb->txid;
+
+}  /* agt_journal_finish_commit */
+
+
+/********************************************************************
+* FUNCTION agt_journal_save
+*
+* Save the running config to the startup file by appending
+* the recorded transactions to the journal.  The whole config
+* is written instead if any transaction since the last save
+* was not recorded, or if the journal is too big
+*
+* INPUTS:
+*    cfg == running config to save
+*    filespec == startup file
+*
+* RETURNS:
+*    status
+*********************************************************************/
+status_t
+    agt_journal_save (cfg_template_t *cfg,
+                      const xmlChar *filespec)
+{
+    xmlChar   *journal;
+    status_t   res;
+
+    check_compaction(filespec);
+
+    if (!basevalid || !journal_enabled(cfg) || basetxid != cfg->last_txid) {
+        return compact(cfg, filespec);
+    }
+
+    if (pendingfp == NULL) {
+        /* nothing changed since the last save */
+        return NO_ERR;
+    }
+
+    if (fflush(pendingfp) != 0) {
+        return compact(cfg, filespec);
+    }
+
+    journal = make_filespec(filespec, AGT_JOURNAL_SUFFIX, NULL);
+    if (journal == NULL) {
+        return ERR_INTERNAL_MEM;
+    }
+
+    if (LOGDEBUG) {
+        log_debug("\nagt_journal: appending %u bytes to '%s' (txid %llu)",
+                  (uint32)pendingsize,
+                  journal,
+                  (unsigned long long)basetxid);
+    }
+
+    res = append_journal(journal);
+    m__free(journal);
+    drop_pending();
+
+    if (res != NO_ERR) {
+        return compact(cfg, filespec);
+    }
+
+    /* rewriting the startup file when the journal is as big as it
+     * keeps the amortized write cost proportional to the edits */
+    if (!compacting && journalsize > fullsize) {
+        return compact(cfg, filespec);
+    }
+
+    return NO_ERR;
+
+}  /* agt_journal_save */
+
+
+/********************************************************************
+* FUNCTION agt_journal_replay
+*
+* Merge any journal left for a startup file into it
+* Called at boot, before the startup file is loaded
+*
+* INPUTS:
+*    filespec == startup file
+*
+* RETURNS:
+*    status
+*********************************************************************/
+status_t
+    agt_journal_replay (const xmlChar *filespec)
+{
+    xmlDoc    *doc;
+    xmlChar   *journal, *renamed, *tempfile;
+    status_t   res;
+
+    journal = make_filespec(filespec, AGT_JOURNAL_SUFFIX, NULL);
+    renamed = make_filespec(filespec, AGT_JOURNAL_SUFFIX,
+                            AGT_JOURNAL_OLD_SUFFIX);
+    tempfile = make_filespec(filespec, AGT_NVSTORE_TEMP_SUFFIX, NULL);
+    if (journal == NULL || renamed == NULL || tempfile == NULL) {
+        res = ERR_INTERNAL_MEM;
+    } else if (access((const char *)journal, F_OK) != 0 &&
+               access((const char *)renamed, F_OK) != 0) {
+        res = NO_ERR;
+    } else {
+        log_info("\nMerging journal into startup config file '%s'",
+                 filespec);
+
+        doc = xmlReadFile((const char *)filespec, NULL,
+                          JOURNAL_PARSE_OPTIONS);
+        if (doc == NULL || xmlDocGetRootElement(doc) == NULL) {
+            log_error("\nError: parse startup config '%s' failed",
+                      filespec);
+            res = ERR_XML_READER_START_FAILED;
+        } else {
+            /* the old journal is from before the new one was started */
+            res = replay_journal(doc, renamed);
+            if (res == NO_ERR) {
+                res = replay_journal(doc, journal);
+            }
+            if (res == NO_ERR &&
+                xmlSaveFormatFileEnc((const char *)tempfile, doc,
+                                     "UTF-8", 1) < 0) {
+                (void)unlink((const char *)tempfile);
+                res = ERR_FIL_WRITE;
+            }
+            if (res == NO_ERR) {
+                res = agt_nvstore_install_file(tempfile, filespec);
+            }
+            if (res == NO_ERR) {
+                (void)unlink((const char *)renamed);
+                (void)unlink((const char *)journal);
+                (void)agt_nvstore_sync_dir(journal);
+            }
+        }
+        if (doc) {
+            xmlFreeDoc(doc);
+        }
+    }
+
+    if (journal) {
+        m__free(journal);
+    }
+    if (renamed) {
+        m__free(renamed);
+    }
+    if (tempfile) {
+        m__free(tempfile);
+    }
+    return res;
+
+}  /* agt_journal_replay */
+
+
+/********************************************************************
+* FUNCTION agt_journal_cleanup
+*
+* Drop any transactions that were never saved
+*
+*********************************************************************/
+void
+    agt_journal_cleanup (void)
+{
+    check_compaction(NULL);
+
+    if (oldjournal) {
+        m__free(oldjournal);
+        oldjournal = NULL;
+    }
+    compacting = FALSE;
+
+    drop_pending();
+    basevalid = FALSE;
+    basetxid = 0;
+    journalsize = 0;
+    fullsize = 0;
+
+}  /* agt_journal_cleanup */
+
+
+/* END file agt_journal.c */
@@ -0,0 +1,163 @@
+#ifndef _H_agt_journal
+#define _H_agt_journal
+
+/*  FILE: agt_journal.h
+*********************************************************************
+*								    *
+*			 P U R P O S E				    *
+*								    *
+*********************************************************************
+
+    Startup config journal
+
+  If --startup-journal=true and there is no distinct startup
+  datastore, saving the running config only appends the edits
+  of the transactions committed since the last save to the
+  file <startup>.journal, instead of writing the whole config.
+
+  Each committed transaction is written as a <transaction>
+  element holding 1 <config> record per edit point.  A record
+  contains the ancestors of the edit point, with just their
+  key leafs, and then either the complete new subtree
+  (operation="replace") or just enough of the node to find
+  it (operation="delete").  The depth attribute gives the
+  level of the edit point below <config>; at each level above
+  it, the last child element is the next ancestor and any
+  other child elements are list keys.
+
+  The journal is merged into the startup file (compacted)
+  when it gets bigger than the startup file, and on the
+  next boot, before the startup file is loaded.  Records
+  only ever set a node to its committed value, so replaying
+  a record that is already in the startup file has no effect.
+  This makes it safe to crash after the startup file is
+  replaced but before the journal is removed.
+
+  If --async-nvstore=true, compaction renames the journal to
+  <startup>.journal.old and writes the startup file in the
+  background; the old journal is removed once a config written
+  after the rename has been saved.
+
+*/
+
+#include <libxml/xmlstring.h>
+
+#ifndef _H_agt_cfg
+#include "agt_cfg.h"
+#endif
+
+#ifndef _H_cfg
+#include "cfg.h"
+#endif
+
+#ifndef _H_status
+#include "status.h"
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/********************************************************************
+*								    *
+*			 C O N S T A N T S			    *
+*								    *
+*********************************************************************/
+
+/* suffix added to the startup filespec for the journal */
+#define AGT_JOURNAL_SUFFIX       ".journal"
+
+/* suffix added to the journal filespec while it is compacted */
+#define AGT_JOURNAL_OLD_SUFFIX   ".old"
+
+
+/********************************************************************
+*								    *
+*			F U N C T I O N S			    *
+*								    *
+*********************************************************************/
+
+
+/********************************************************************
+* FUNCTION agt_journal_start_commit
+*
+* Record the nodes deleted by a transaction on the running
+* config; called after the SIL commit callbacks accepted the
+* transaction, before the deleted nodes are freed
+*
+* INPUTS:
+*    txcb == transaction in progress
+*    target == config being changed
+*
+*********************************************************************/
+extern void
+    agt_journal_start_commit (agt_cfg_transaction_t *txcb,
+                              cfg_template_t *target);
+
+
+/********************************************************************
+* FUNCTION agt_journal_finish_commit
+*
+* Record the new and changed nodes of a transaction on
+* the running config; called after all the edits are done
+*
+* INPUTS:
+*    txcb == transaction in progress
+*    target == config being changed
+*
+*********************************************************************/
+extern void
+    agt_journal_finish_commit (agt_cfg_transaction_t *txcb,
+                               cfg_template_t *target);
+
+
+/********************************************************************
+* FUNCTION agt_journal_save
+*
+* Save the running config to the startup file by appending
+* the recorded transactions to the journal.  The whole config
+* is written instead if any transaction since the last save
+* was not recorded, or if the journal is too big
+*
+* INPUTS:
+*    cfg == running config to save
+*    filespec == startup file
+*
+* RETURNS:
+*    status
+*********************************************************************/
+extern status_t
+    agt_journal_save (cfg_template_t *cfg,
+                      const xmlChar *filespec);
+
+
+/********************************************************************
+* FUNCTION agt_journal_replay
+*
+* Merge any journal left for a startup file into it
+* Called at boot, before the startup file is loaded
+*
+* INPUTS:
+*    filespec == startup file
+*
+* RETURNS:
+*    status
+*********************************************************************/
+extern status_t
+    agt_journal_replay (const xmlChar *filespec);
+
+
+/********************************************************************
+* FUNCTION agt_journal_cleanup
+*
+* Drop any transactions that were never saved
+*
+*********************************************************************/
+extern void
+    agt_journal_cleanup (void);
+
+#ifdef __cplusplus
+}  /* end extern 'C' */
+#endif
+
+#endif	    /* _H_agt_journal */
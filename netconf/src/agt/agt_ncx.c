@@ -37,8 +37,10 @@ date         init     comment
 #include "agt_cb.h"
 #include "agt_cfg.h"
 #include "agt_cli.h"
+#include "agt_journal.h"
 #include "agt_ncx.h"
 #include "agt_nmda.h"
+#include "agt_nvstore.h"
 #include "agt_rpc.h"
 #include "agt_rpcerr.h"
 #include "agt_ses.h"
@@ -3596,6 +3598,12 @@ status_t
         if (!cfg->src_url) {
             res = ERR_INTERNAL_MEM;
         } else {
+            /* merge the edits saved after the last full write */
+            res = agt_journal_replay(cfgparm);
+            if (res != NO_ERR) {
+                return res;
+            }
+
             /* the cfgparm should be a filespec of an XML config file */
             res = agt_rpc_load_config_file(cfgparm, cfg, TRUE, 0);
             if (res == NO_ERR && 
@@ -3655,7 +3663,6 @@ status_t
     xmlChar           *filebuffer;
     agt_profile_t     *profile;
     status_t           res;
-    xml_attrs_t        attrs;
 
 #ifdef DEBUG
     if (!cfg) {
@@ -3703,21 +3710,17 @@ status_t
                               cfg->name,
                               filebuffer);
                 }
-                /* write the new startup config */
-                xml_init_attrs(&attrs);
-
-                /* output to the specified file or STDOUT */
-                res = xml_wr_check_file(filebuffer,
-                                        cfg->root,
-                                        &attrs,
-                                        XMLMODE,
-                                        WITHHDR,
-                                        TRUE,
-                                        0,
-                                        profile->agt_indent,
-                                        agt_check_save);
-
-                xml_clean_attrs(&attrs);
+                /* write the new startup config; the reply does not
+                 * wait for the file if there is no startup datastore
+                 * that has to match it
+                 */
+                if (startup == NULL && profile->agt_startup_journal) {
+                    res = agt_journal_save(cfg, filebuffer);
+                } else if (startup == NULL && profile->agt_async_nvstore) {
+                    res = agt_nvstore_save_async(cfg, filebuffer);
+                } else {
+                    res = agt_nvstore_save(cfg, filebuffer);
+                }
 
                 if (res == NO_ERR && startup != NULL) {
                     /* toss the old startup and save the new one */
@@ -43,10 +43,21 @@ date         init     comment
 #include <arpa/inet.h>
 #include <netdb.h>
 
+/* The epoll loop is used on Linux unless AGT_NCXSERVER_SELECT
+ * is defined; the select loop is limited to FD_SETSIZE
+ * file descriptors
+ */
+#if defined(LINUX) && !defined(AGT_NCXSERVER_SELECT)
+#define AGT_NCXSERVER_EPOLL 1
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#endif
+
 #include "procdefs.h"
 #include "agt.h"
 #include "agt_ncxserver.h"
 #include "agt_not.h"
+#include "agt_nvstore.h"
 #include "agt_rpc.h"
 #include "agt_ses.h"
 #include "agt_timer.h"
@@ -58,6 +69,7 @@ date         init     comment
 #include "ses.h"
 #include "ses_msg.h"
 #include "status.h"
+#include "uptime.h"
 #include "xmlns.h"
 
 
@@ -73,10 +85,26 @@ date         init     comment
 /* number of notifications to send out in 1 timeout interval */
 #define MAX_NOTIFICATION_BURST  10
 
+/* length of the pending connection queue for the ncxserver socket */
+#define AGT_NCXSERVER_BACKLOG  SOMAXCONN
+
+/* max number of epoll events handled per wakeup */
+#define AGT_NCXSERVER_MAX_EVENTS  64
+
+
+/********************************************************************
+ *                                                                   *
+ *                       V A R I A B L E S                           *
+ *                                                                   *
+ *********************************************************************/
 
+#ifdef AGT_NCXSERVER_EPOLL
+static int epoll_fd = -1;
+#else
 static fd_set active_fd_set;
 static fd_set read_fd_set;
 static fd_set write_fd_set;
+#endif
 
 
 /********************************************************************
@@ -243,66 +271,487 @@ static void
 
 
 
-/***********     E X P O R T E D   F U N C T I O N S   *************/
+/********************************************************************
+ * FUNCTION send_session_output
+ * 
+ * Try to send 1 packet worth of buffers for a session
+ * 
+ * INPUTS:
+ *    scb == session control block with output to send
+ *
+ * RETURNS:
+ *    scb if the session is still open
+ *    NULL if the session was killed
+ *********************************************************************/
+static ses_cb_t *
+    send_session_output (ses_cb_t *scb)
+{
+    status_t  res;
+
+    /* check if anything to write */
+    if (dlq_empty(&scb->outQ)) {
+        return scb;
+    }
+
+    res = ses_msg_send_buffs(scb);
+    if (res != NO_ERR) {
+        if (LOGINFO) {
+            log_info("\nagt_ncxserver write failed; "
+                     "closing session %d ", 
+                     scb->sid);
+        }
+        agt_ses_kill_session(scb, 
+                             scb->sid,
+                             SES_TR_OTHER);
+        return NULL;
+    }
+
+    if (scb->state == SES_ST_SHUTDOWN_REQ &&
+        dlq_empty(&scb->outQ)) {
+        /* close-session reply sent, now kill ses */
+        agt_ses_kill_session(scb, 
+                             scb->killedbysid,
+                             scb->termreason);
+        return NULL;
+    }
+
+    return scb;
+
+} /* send_session_output */
 
 
 /********************************************************************
- * FUNCTION agt_ncxserver_run
+ * FUNCTION read_session_input
  * 
- * IO server loop for the ncxserver socket
+ * Read input for a session and queue any complete messages
+ * If the input fails, an error reply is sent or the
+ * session is killed
  * 
+ * INPUTS:
+ *    scb == session control block with input pending
+ *
  * RETURNS:
- *   status
+ *    status of the ses_accept_input call
  *********************************************************************/
-status_t
-    agt_ncxserver_run (void)
+static status_t
+    read_session_input (ses_cb_t *scb)
+{
+    status_t  res;
+
+    res = ses_accept_input(scb);
+    if (res != NO_ERR) {
+        if (res != ERR_NCX_SESSION_CLOSED) {
+            if (LOGINFO) {
+                log_info("\nagt_ncxserver: input failed"
+                         " for session %d (%s)",
+                         scb->sid, 
+                         get_error_string(res));
+            }
+            /* send an error reply instead of
+             * killing the session right now
+             */
+            agt_rpc_send_error_reply(scb, res);
+            agt_ses_request_close(scb, 
+                                  0, 
+                                  SES_TR_OTHER);
+        } else {
+            /* connection already closed
+             * so kill session right now
+             */
+            agt_ses_kill_session(scb,
+                                 scb->sid,
+                                 SES_TR_DROPPED);
+        }
+    }
+    return res;
+
+} /* read_session_input */
+
+
+/********************************************************************
+ * FUNCTION accept_new_session
+ * 
+ * Accept a connection request on the ncxserver socket
+ * and create a new session for it
+ * 
+ * INPUTS:
+ *    ncxsock == ncxserver socket
+ *
+ * RETURNS:
+ *    FD of the new session or -1 if none was created
+ *********************************************************************/
+static int
+    accept_new_session (int ncxsock)
 {
-    ses_cb_t              *scb;
-    agt_profile_t         *profile;
-    int                    ncxsock, maxwrnum, maxrdnum;
-    int                    i, new, ret;
     struct sockaddr_un     clientname;
-    struct timeval         timeout;
     socklen_t              size;
-    status_t               res;
-    boolean                done, done2, stream_output;
-    val_value_t            *clivalset;
-    val_value_t            *val;
+    int                    new, flags;
+
+    /* Connection request on original socket. */
+    size = (socklen_t)sizeof(clientname);
+    new = accept(ncxsock,
+                 (struct sockaddr *)&clientname,
+                 &size);
+    if (new < 0) {
+        if (LOGINFO && errno != EAGAIN && errno != EWOULDBLOCK) {
+            log_info("\nagt_ncxserver accept "
+                     "connection failed (%d)",
+                     new);
+        }
+        return -1;
+    }
 
-    profile = agt_get_profile();
-    if (profile == NULL) {
-        return SET_ERROR(ERR_INTERNAL_VAL);
+    /* get a new session control block */
+    if (!agt_ses_new_session(SES_TRANSPORT_SSH, new)) {
+        close(new);
+        if (LOGINFO) {
+            log_info("\nagt_ncxserver new "
+                     "session failed (%d)", 
+                     new);
+        }
+        return -1;
     }
 
-    if(profile->agt_tcp_direct_port!=-1) {
-        res = make_tcp_socket(profile->agt_tcp_direct_address, profile->agt_tcp_direct_port, &ncxsock);
-        if (res != NO_ERR) {
-            log_error("\n*** Cannot connect to ncxserver socket listen tcp port: %d\n",profile->agt_tcp_direct_port);
-            return res;
+    /* set non-blocking IO; the output that does not fit in
+     * the socket stays in the outQ until the socket is writable
+     */
+    flags = fcntl(new, F_GETFL);
+    if (flags < 0 || fcntl(new, F_SETFL, flags | O_NONBLOCK) != 0) {
+        if (LOGINFO) {
+            log_info("\nfnctl failed");
         }
-    } else {
-        res = make_named_socket(profile->agt_ncxserver_sockname, &ncxsock);
-        if (res != NO_ERR) {
-            log_error("\n*** Cannot connect to ncxserver socket"
-                      "\n*** If no other instances of netconfd are running,"
-                      "\n*** try deleting %s\n",profile->agt_ncxserver_sockname);
-            return res;
+    }
+    return new;
+
+} /* accept_new_session */
+
+
+/********************************************************************
+ * FUNCTION process_ready_sessions
+ * 
+ * Drain the ready queue before accepting new input
+ * 
+ * RETURNS:
+ *    TRUE if a shutdown was requested
+ *    FALSE otherwise
+ *********************************************************************/
+static boolean
+    process_ready_sessions (void)
+{
+    while (agt_ses_process_first_ready()) {
+        if (agt_shutdown_requested()) {
+            return TRUE;
         }
+        send_some_notifications();
     }
+    return FALSE;
 
-    stream_output = profile->agt_stream_output;
+} /* process_ready_sessions */
 
-    if (listen(ncxsock, 1) < 0) {
-        log_error("\nError: listen failed");
+
+#ifdef AGT_NCXSERVER_EPOLL
+/********************************************************************
+ * FUNCTION set_session_events
+ * 
+ * Set the epoll events to wait for on a session socket
+ * 
+ * INPUTS:
+ *    fd == session file descriptor
+ *    op == EPOLL_CTL_ADD or EPOLL_CTL_MOD
+ *    wantwrite == TRUE to wait for write readiness as well
+ *
+ * RETURNS:
+ *    status
+ *********************************************************************/
+static status_t
+    set_session_events (int fd,
+                        int op,
+                        boolean wantwrite)
+{
+    struct epoll_event  ev;
+
+    memset(&ev, 0x0, sizeof(ev));
+    ev.events = (wantwrite) ? (EPOLLIN | EPOLLOUT) : EPOLLIN;
+    ev.data.fd = fd;
+
+    if (epoll_ctl(epoll_fd, op, fd, &ev) != 0) {
+        log_error("\nError: agt_ncxserver epoll_ctl failed "
+                  "for fd %d (%s)", 
+                  fd,
+                  strerror(errno));
         return ERR_NCX_OPERATION_FAILED;
     }
-     
+    return NO_ERR;
+
+} /* set_session_events */
+
+
+/********************************************************************
+ * FUNCTION make_timer
+ * 
+ * Create the timerfd that drives the polling callbacks
+ * once every AGT_NCXSERVER_TIMEOUT seconds
+ * 
+ * INPUTS:
+ *    timerfd == ptr to return value
+ *
+ * OUTPUTS:
+ *    *timerfd == the FD for the timer if return ok
+ *
+ * RETURNS:
+ *    status
+ *********************************************************************/
+static status_t
+    make_timer (int *timerfd)
+{
+    struct itimerspec  spec;
+
+    *timerfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
+    if (*timerfd < 0) {
+        perror ("timerfd_create");
+        return ERR_NCX_OPERATION_FAILED;
+    }
+
+    memset(&spec, 0x0, sizeof(spec));
+    spec.it_value.tv_sec = AGT_NCXSERVER_TIMEOUT;
+    spec.it_interval.tv_sec = AGT_NCXSERVER_TIMEOUT;
+    if (timerfd_settime(*timerfd, 0, &spec, NULL) != 0) {
+        perror ("timerfd_settime");
+        close(*timerfd);
+        *timerfd = -1;
+        return ERR_NCX_OPERATION_FAILED;
+    }
+    return NO_ERR;
+
+} /* make_timer */
+
+
+/********************************************************************
+ * FUNCTION run_epoll_loop
+ * 
+ * IO server loop for the ncxserver socket, using epoll
+ *
+ * Each session socket is registered for input when it
+ * is accepted.  Write events are only requested while
+ * the session has buffers in its outQ, which includes
+ * the end of a streamed message the client was not ready
+ * for.  The polling callbacks are run from a timerfd
+ * 
+ * INPUTS:
+ *    ncxsock == ncxserver socket
+ *
+ * RETURNS:
+ *   status
+ *********************************************************************/
+static status_t
+    run_epoll_loop (int ncxsock)
+{
+    struct epoll_event     events[AGT_NCXSERVER_MAX_EVENTS];
+    ses_cb_t              *scb;
+    int                    timerfd, new, fd, ret, i;
+    uint64                 expirations;
+    status_t               res;
+    boolean                done, accepting, timeout, deferred;
+
+    timerfd = -1;
+    epoll_fd = epoll_create1(0);
+    if (epoll_fd < 0) {
+        perror ("epoll_create1");
+        return ERR_NCX_OPERATION_FAILED;
+    }
+
+    /* the ncxserver socket is drained of connection
+     * requests each time it becomes readable
+     */
+    res = NO_ERR;
+    if (fcntl(ncxsock, F_SETFL, O_NONBLOCK) != 0) {
+        perror ("fcntl");
+        res = ERR_NCX_OPERATION_FAILED;
+    }
+    if (res == NO_ERR) {
+        res = make_timer(&timerfd);
+    }
+    if (res == NO_ERR) {
+        res = set_session_events(ncxsock, EPOLL_CTL_ADD, FALSE);
+    }
+    if (res == NO_ERR) {
+        res = set_session_events(timerfd, EPOLL_CTL_ADD, FALSE);
+    }
+
+    done = (res != NO_ERR);
+    while (!done) {
+
+        /* check exit program */
+        if (agt_shutdown_requested()) {
+            done = TRUE;
+            continue;
+        }
+
+        /* request write events for the sessions that
+         * have queued output since the last wakeup
+         */
+        while ((scb = agt_ses_get_first_outready()) != NULL) {
+            (void)set_session_events(scb->fd, EPOLL_CTL_MOD, TRUE);
+        }
+
+        /* Block until input arrives on one or more active sockets,
+         * a session socket can be written, the polling timer
+         * expires or the next agt_timer is due
+         */
+        ret = epoll_wait(epoll_fd, 
+                         events, 
+                         AGT_NCXSERVER_MAX_EVENTS, 
+                         agt_timer_get_timeout());
+
+        /* check exit program */
+        if (agt_shutdown_requested()) {
+            done = TRUE;
+            continue;
+        }
+
+        if (ret < 0) {
+            if (errno == EINTR || errno == EAGAIN) {
+                continue;
+            }
+            log_error("\nncxserver epoll_wait failed (%s)", 
+                      strerror(errno));
+            agt_request_shutdown(NCX_SHUT_EXIT);
+            done = TRUE;
+            continue;
+        }
+
+        /* Service all the sockets with input and/or output pending.
+         * New connections are accepted after the other events so
+         * an FD that is closed and reused in this pass is not
+         * confused with the new session
+         */
+        accepting = FALSE;
+        timeout = FALSE;
+        for (i = 0; i < ret; i++) {
+            fd = events[i].data.fd;
+            if (fd == ncxsock) {
+                accepting = TRUE;
+                continue;
+            }
+            if (fd == timerfd) {
+                timeout = TRUE;
+                continue;
+            }
+
+            scb = def_reg_find_scb(fd);
+
+            /* check write output to client sessions */
+            if (scb && (events[i].events & EPOLLOUT)) {
+                scb = send_session_output(scb);
+                if (scb && dlq_empty(&scb->outQ)) {
+                    (void)set_session_events(fd, EPOLL_CTL_MOD, FALSE);
+                }
+            }
+
+            /* check read input from client sessions */
+            if (scb && 
+                (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))) {
+                (void)read_session_input(scb);
+            }
+        }
+
+        if (accepting) {
+            while ((new = accept_new_session(ncxsock)) >= 0) {
+                if (set_session_events(new, EPOLL_CTL_ADD, FALSE) 
+                    != NO_ERR) {
+                    scb = def_reg_find_scb(new);
+                    if (scb) {
+                        agt_ses_kill_session(scb, 
+                                             scb->sid, 
+                                             SES_TR_OTHER);
+                    }
+                }
+            }
+        }
+
+        if (timeout) {
+            /* !! put all polling callbacks here for now !! */
+            (void)read(timerfd, &expirations, sizeof(expirations));
+            agt_ses_check_timeouts();
+            agt_nvstore_check();
+            send_some_notifications();
+        }
+
+        /* run the agt_timer callbacks that are due */
+        agt_timer_handler();
+
+        /* drain the ready queue before accepting new input
+         * input defered until the previous message is
+         * processed (e.g. <rpc> trailing <hello>) is
+         * accepted once the ready queue is empty
+         */
+        deferred = TRUE;
+        while (!done && deferred) {
+            if (process_ready_sessions()) {
+                done = TRUE;
+                continue;
+            }
+            deferred = FALSE;
+            for (i = 0; i < ret; i++) {
+                fd = events[i].data.fd;
+                if (fd == ncxsock || fd == timerfd) {
+                    continue;
+                }
+                scb = def_reg_find_scb(fd);
+                if (scb && scb->indefer_len > 0) {
+                    log_debug3("\nagt_ncxserver: deferred trailing "
+                               "input processing.");
+                    deferred = TRUE;
+                    (void)read_session_input(scb);
+                }
+            }
+        }
+    }  /* end epoll loop */
+
+    if (timerfd >= 0) {
+        close(timerfd);
+    }
+    close(epoll_fd);
+    epoll_fd = -1;
+    return res;
+
+}  /* run_epoll_loop */
+
+#else
+
+/********************************************************************
+ * FUNCTION run_select_loop
+ * 
+ * IO server loop for the ncxserver socket, using select
+ *
+ * The select timeout is shortened if an agt_timer is due
+ * sooner, but the polling callbacks are only run once
+ * per AGT_NCXSERVER_TIMEOUT seconds
+ * 
+ * INPUTS:
+ *    ncxsock == ncxserver socket
+ *
+ * RETURNS:
+ *   status
+ *********************************************************************/
+static status_t
+    run_select_loop (int ncxsock)
+{
+    ses_cb_t              *scb;
+    int                    maxwrnum, maxrdnum;
+    int                    i, new, ret;
+    struct timeval         timeout;
+    time_t                 lasttick, timenow;
+    int32                  timerms;
+    boolean                done, done2;
+
     /* Initialize the set of active sockets. */
     FD_ZERO(&read_fd_set);
     FD_ZERO(&write_fd_set);
     FD_ZERO(&active_fd_set);
     FD_SET(ncxsock, &active_fd_set);
     maxwrnum = maxrdnum = ncxsock;
+    (void)uptime(&lasttick);
 
     done = FALSE;
     while (!done) {
@@ -321,6 +770,13 @@ status_t
             timeout.tv_sec = AGT_NCXSERVER_TIMEOUT;
             timeout.tv_usec = 0;
 
+            /* wake up early if the next agt_timer is due sooner */
+            timerms = agt_timer_get_timeout();
+            if (timerms >= 0 && timerms < AGT_NCXSERVER_TIMEOUT * 1000) {
+                timeout.tv_sec = timerms / 1000;
+                timeout.tv_usec = (timerms % 1000) * 1000;
+            }
+
             /* Block until input arrives on one or more active sockets. 
              * or the timer expires
              */
@@ -339,10 +795,19 @@ status_t
                 /* should only happen if a timeout occurred */
                 if (agt_shutdown_requested()) {
                     done2 = TRUE; 
+                    continue;
+                }
+
+                (void)uptime(&timenow);
+                if (difftime(timenow, lasttick) < AGT_NCXSERVER_TIMEOUT) {
+                    /* early wakeup for an agt_timer */
+                    agt_timer_handler();
                 } else {
                     /* !! put all polling callbacks here for now !! */
+                    lasttick = timenow;
                     agt_ses_check_timeouts();
                     agt_timer_handler();
+                    agt_nvstore_check();
                     send_some_notifications();
                 }
             } else {
@@ -359,7 +824,6 @@ status_t
 
         /* check select return status for non-recoverable error */
         if (ret < 0) {
-            res = ERR_NCX_OPERATION_FAILED;
             log_error("\nncxserver select failed (%s)", 
                       strerror(errno));
             agt_request_shutdown(NCX_SHUT_EXIT);
@@ -372,33 +836,11 @@ status_t
         for (i = 0; i < max(maxrdnum+1, maxwrnum+1) && !done2; i++) {
             scb=NULL;
             /* check write output to client sessions */
-            if (!stream_output && FD_ISSET(i, &write_fd_set)) {
+            if (FD_ISSET(i, &write_fd_set)) {
                 /* try to send 1 packet worth of buffers for a session */
                 scb = def_reg_find_scb(i);
                 if (scb) {
-                    /* check if anything to write */
-                    if (!dlq_empty(&scb->outQ)) {
-                        res = ses_msg_send_buffs(scb);
-                        if (res != NO_ERR) {
-                            if (LOGINFO) {
-                                log_info("\nagt_ncxserver write failed; "
-                                         "closing session %d ", 
-                                         scb->sid);
-                            }
-                        }
-                        if (res != NO_ERR) {
-                            agt_ses_kill_session(scb, 
-                                                 scb->sid,
-                                                 SES_TR_OTHER);
-                            scb = NULL;
-                        } else if (scb->state == SES_ST_SHUTDOWN_REQ) {
-                            /* close-session reply sent, now kill ses */
-                            agt_ses_kill_session(scb, 
-                                                 scb->killedbysid,
-                                                 scb->termreason);
-                            scb = NULL;
-                        }
-                    }
+                    scb = send_session_output(scb);
 
                     /* check if any buffers left over for next loop */
                     if (scb && !dlq_empty(&scb->outQ)) {
@@ -410,35 +852,8 @@ status_t
             /* check read input from client sessions */
             if (FD_ISSET(i, &read_fd_set)) {
                 if (i == ncxsock) {
-                    /* Connection request on original socket. */
-                    size = (socklen_t)sizeof(clientname);
-                    new = accept(ncxsock,
-                                 (struct sockaddr *)&clientname,
-                                 &size);
-                    if (new < 0) {
-                        if (LOGINFO) {
-                            log_info("\nagt_ncxserver accept "
-                                     "connection failed (%d)",
-                                     new);
-                        }
-                        continue;
-                    }
-
-                    /* get a new session control block */
-                    if (!agt_ses_new_session(SES_TRANSPORT_SSH, new)) {
-                        close(new);
-                        if (LOGINFO) {
-                            log_info("\nagt_ncxserver new "
-                                     "session failed (%d)", 
-                                     new);
-                        }
-                    } else {
-                        /* set non-blocking IO */
-                        if (fcntl(new, F_SETFD, O_NONBLOCK)) {
-                            if (LOGINFO) {
-                                log_info("\nfnctl failed");
-                            }
-                        }
+                    new = accept_new_session(ncxsock);
+                    if (new >= 0) {
                         FD_SET(new, &active_fd_set);
                         if (new > maxrdnum) {
                             maxrdnum = new;
@@ -452,52 +867,23 @@ status_t
 
 ses_accept_defered_input:
                     if (scb != NULL) {
-                        res = ses_accept_input(scb);
-                        if (res != NO_ERR) {
-                            if (i >= maxrdnum) {
-                                maxrdnum = i-1;
-                            }
-                            if (res != ERR_NCX_SESSION_CLOSED) {
-                                if (LOGINFO) {
-                                    log_info("\nagt_ncxserver: input failed"
-                                             " for session %d (%s)",
-                                             scb->sid, 
-                                             get_error_string(res));
-                                }
-                                /* send an error reply instead of
-                                 * killing the session right now
-                                 */
-                                agt_rpc_send_error_reply(scb, res);
-                                agt_ses_request_close(scb, 
-                                                      0, 
-                                                      SES_TR_OTHER);
-                            } else {
-                                /* connection already closed
-                                 * so kill session right now
-                                 */
-                                agt_ses_kill_session(scb,
-                                                     scb->sid,
-                                                     SES_TR_DROPPED);
-                            }
+                        if (read_session_input(scb) != NO_ERR &&
+                            i >= maxrdnum) {
+                            maxrdnum = i-1;
                         }
                     }
                 }
             }
         }
 
+        /* run the agt_timer callbacks that are due */
+        agt_timer_handler();
+
         /* drain the ready queue before accepting new input */
         if (!done) {
-            done2 = FALSE;
-            while (!done2) {
-                if (!agt_ses_process_first_ready()) {
-                    done2 = TRUE;
-                } else if (agt_shutdown_requested()) {
-                    done = done2 = TRUE;
-                } else {
-                    send_some_notifications();
-                }
-            }
-            if(scb && scb->indefer_len>0) {
+            if (process_ready_sessions()) {
+                done = TRUE;
+            } else if (scb && scb->indefer_len>0) {
                 /*
                  * input defered until previous message
                  * is processed e.g. <rpc> trailing <hello>
@@ -509,12 +895,69 @@ ses_accept_defered_input:
         }
     }  /* end select loop */
 
+    return NO_ERR;
+
+}  /* run_select_loop */
+#endif
+
+
+
+/***********     E X P O R T E D   F U N C T I O N S   *************/
+
+
+/********************************************************************
+ * FUNCTION agt_ncxserver_run
+ * 
+ * IO server loop for the ncxserver socket
+ * 
+ * RETURNS:
+ *   status
+ *********************************************************************/
+status_t
+    agt_ncxserver_run (void)
+{
+    agt_profile_t         *profile;
+    int                    ncxsock;
+    status_t               res;
+
+    profile = agt_get_profile();
+    if (profile == NULL) {
+        return SET_ERROR(ERR_INTERNAL_VAL);
+    }
+
+    if(profile->agt_tcp_direct_port!=-1) {
+        res = make_tcp_socket(profile->agt_tcp_direct_address, profile->agt_tcp_direct_port, &ncxsock);
+        if (res != NO_ERR) {
+            log_error("\n*** Cannot connect to ncxserver socket listen tcp port: %d\n",profile->agt_tcp_direct_port);
+            return res;
+        }
+    } else {
+        res = make_named_socket(profile->agt_ncxserver_sockname, &ncxsock);
+        if (res != NO_ERR) {
+            log_error("\n*** Cannot connect to ncxserver socket"
+                      "\n*** If no other instances of netconfd are running,"
+                      "\n*** try deleting %s\n",profile->agt_ncxserver_sockname);
+            return res;
+        }
+    }
+
+    if (listen(ncxsock, AGT_NCXSERVER_BACKLOG) < 0) {
+        log_error("\nError: listen failed");
+        return ERR_NCX_OPERATION_FAILED;
+    }
+
+#ifdef AGT_NCXSERVER_EPOLL
+    res = run_epoll_loop(ncxsock);
+#else
+    res = run_select_loop(ncxsock);
+#endif
+
     /* all open client sockets will be closed as the sessions are
      * torn down, but the original ncxserver socket needs to be closed now
      */
     close(ncxsock);
     unlink(NCXSERVER_SOCKNAME);
-    return NO_ERR;
+    return res;
 
 }  /* agt_ncxserver_run */
 
@@ -522,7 +965,7 @@ ses_accept_defered_input:
 /********************************************************************
  * FUNCTION agt_ncxserver_clear_fd
  * 
- * Clear a dead session from the select loop
+ * Clear a dead session from the ncxserver loop
  * 
  * INPUTS:
  *   fd == file descriptor number for the socket to clear
@@ -530,7 +973,13 @@ ses_accept_defered_input:
 void
     agt_ncxserver_clear_fd (int fd)
 {
+#ifdef AGT_NCXSERVER_EPOLL
+    if (epoll_fd >= 0) {
+        (void)epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+    }
+#else
     FD_CLR(fd, &active_fd_set);
+#endif
 
 } /* agt_ncxserver_clear_fd */
 
@@ -538,4 +987,3 @@ void
 /* END agt_ncxserver.c */
 
 
-
@@ -74,7 +74,7 @@ extern status_t
 /********************************************************************
  * FUNCTION agt_ncxserver_clear_fd
  * 
- * Clear a dead session from the select loop
+ * Clear a dead session from the ncxserver loop
  * 
  * INPUTS:
  *   fd == file descriptor number for the socket to clear
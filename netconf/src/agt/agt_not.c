@@ -54,6 +54,7 @@ date         init     comment
 #include "agt_cap.h"
 #include "agt_cb.h"
 #include "agt_not.h"
+#include "agt_not_log.h"
 #include "agt_rpc.h"
 #include "agt_ses.h"
 #include "agt_tree.h"
@@ -143,13 +144,13 @@ static ncx_module_t         *ncnotifmod;
  */
 static dlq_hdr_t             subscriptionQ;
 
-/* Q of agt_not_msg_t 
+/* replay log of agt_not_msg_t
  * these are the messages that represent the replay buffer
- * only system-wide notifications are stored in this Q
+ * only system-wide notifications are stored in this log
  * the replayComplete and notificationComplete events are
  * generated special-case, and not stored for replay
  */
-static dlq_hdr_t             notificationQ;
+static agt_not_log_t         notificationlog;
 
 /* cached pointer to the <notification> element template */
 static obj_template_t *notificationobj;
@@ -172,9 +173,6 @@ static boolean               anySubscriptions;
 /* auto-increment message index */
 static uint32                msgid;
 
-/* keep track of eventlog size */
-static uint32                notification_count;
-
 /********************************************************************
 * FUNCTION free_subscription
 *
@@ -609,9 +607,7 @@ static status_t
                                 xml_node_t *methnode)
 {
     agt_not_subscription_t *sub;
-    agt_not_msg_t          *not, *nextnot;
-    int                     ret;
-    boolean                 done;
+    agt_not_msg_t          *not;
 
     (void)scb;
     (void)methnode;
@@ -619,31 +615,23 @@ static status_t
 
     if (sub->startTime) {
         /* this subscription has requested replay
-         * go through the notificationQ and set
-         * the start replay pointer
+         * find the start replay position in the log
          */
         sub->state = AGT_NOT_STATE_REPLAY;
-        done = FALSE;
-        for (not = (agt_not_msg_t *)
-                 dlq_firstEntry(&notificationQ);
-             not != NULL && !done;
-             not = (agt_not_msg_t *)dlq_nextEntry(not)) {
-
-            ret = xml_strcmp(sub->startTime, not->eventTime);
-            if (ret <= 0) {
-                sub->firstreplaymsg = not;
-                sub->firstreplaymsgid = not->msgid;
-                done = TRUE;
-            }
-        }
-
-        if (!done) {
+        sub->firstreplayseq = 
+            agt_not_log_find_time(&notificationlog, 
+                                  sub->startTime, 
+                                  FALSE);
+        sub->nextseq = sub->firstreplayseq;
+        not = agt_not_log_get(&notificationlog, sub->firstreplayseq);
+
+        if (not == NULL) {
             /* the startTime is after the last available
              * notification eventTime, so replay is over
              */
             sub->flags |= AGT_NOT_FL_RC_READY;
         } else if (sub->stopTime) {
-            /* the sub->firstreplaymsg was set;
+            /* the sub->firstreplayseq was set;
              * the subscription has requested to be
              * terminated after a specific time
              */
@@ -651,66 +639,33 @@ static status_t
                 /* just use the last replay buffer entry
                  * as the end-of-replay marker
                  */
-                sub->lastreplaymsg = (agt_not_msg_t *)
-                    dlq_lastEntry(&notificationQ);
-                sub->lastreplaymsgid = 
-                    sub->lastreplaymsg->msgid;
+                sub->lastreplayseq = 
+                    agt_not_log_end_seq(&notificationlog) - 1;
+                sub->flags |= AGT_NOT_FL_LASTREPLAY;
+            } else if (xml_strcmp(sub->stopTime, not->eventTime) <= 0) {
+                /* the start notification is already past
+                 * the requested stopTime
+                 */
+                sub->flags |= AGT_NOT_FL_RC_READY;
             } else {
-                /* first check that the start notification
-                 * is not already past the requested stopTime
+                /* the last replay is the one before the
+                 * first notification after the stopTime
                  */
-                ret = xml_strcmp(sub->stopTime,
-                                 sub->firstreplaymsg->eventTime);
-                if (ret <= 0) {
-                    sub->firstreplaymsg = NULL;
-                    sub->firstreplaymsgid = 0;
-                    sub->flags |= AGT_NOT_FL_RC_READY;
-                } else {
-                    /* check the notifications after the
-                     * start replay node, to find out
-                     * which one should be the last replay 
-                     */
-                    done = FALSE;
-                    for (not = sub->firstreplaymsg;
-                         not != NULL && !done;
-                         not = nextnot) {
-                 
-                        nextnot = (agt_not_msg_t *)dlq_nextEntry(not);
-                        if (nextnot) {
-                            ret = xml_strcmp(sub->stopTime, 
-                                             nextnot->eventTime);
-                        } else {
-                            ret = -1;
-                        }
-                        if (ret < 0) {
-                            /* the previous one checked was the winner */
-                            sub->lastreplaymsg = not;
-                            sub->lastreplaymsgid = not->msgid;
-                            done = TRUE;
-                        }
-                    }
-
-                    if (!done) {
-                        sub->lastreplaymsg = (agt_not_msg_t *)
-                            dlq_lastEntry(&notificationQ);
-                        sub->lastreplaymsgid = 
-                            sub->lastreplaymsg->msgid;
-                    }
-                }                       
+                sub->lastreplayseq = 
+                    agt_not_log_find_time(&notificationlog, 
+                                          sub->stopTime, 
+                                          TRUE) - 1;
+                sub->flags |= AGT_NOT_FL_LASTREPLAY;
             }
         }
     } else {
         /* setup live subscription by setting the
-         * lastmsg to the end of the replayQ
+         * next message to the end of the replay log
          * so none of the buffered notifications
          * are send to this subscription
          */
         sub->state = AGT_NOT_STATE_LIVE;
-        sub->lastmsg = (agt_not_msg_t *)
-            dlq_lastEntry(&notificationQ);
-        if (sub->lastmsg) {
-            sub->lastmsgid = sub->lastmsg->msgid;
-        }
+        sub->nextseq = agt_not_log_end_seq(&notificationlog);
     }
 
     dlq_enque(sub, &subscriptionQ);
@@ -758,34 +713,35 @@ static void
 
 
 /********************************************************************
-* FUNCTION get_entry_after
+* FUNCTION get_next_entry
 *
-* Get the entry after the specified msgid
+* Get the next replay log entry to send to a subscription
+* If the entries the subscription has not seen yet have
+* been deleted, then the oldest entry in the log is used
 *
 * INPUTS:
-*    thismsgid == get the first msg with an ID higher than this value
+*    sub == subscription to check
+*
+* OUTPUTS:
+*    sub->nextseq is moved past any deleted entries
 *
 * RETURNS:
 *    pointer to an notification to use
 *    NULL if none found
 *********************************************************************/
 static agt_not_msg_t *
-    get_entry_after (uint32 thismsgid)
+    get_next_entry (agt_not_subscription_t *sub)
 {
-    agt_not_msg_t *not;
+    uint64  firstseq;
 
-    for (not = (agt_not_msg_t *)dlq_firstEntry(&notificationQ);
-         not != NULL;
-         not = (agt_not_msg_t *)dlq_nextEntry(not)) {
-
-        if (not->msgid > thismsgid) {
-            return not;
-        }
+    firstseq = agt_not_log_first_seq(&notificationlog);
+    if (sub->nextseq < firstseq) {
+        sub->nextseq = firstseq;
     }
 
-    return NULL;
+    return agt_not_log_get(&notificationlog, sub->nextseq);
 
-} /* get_entry_after */
+} /* get_next_entry */
 
 
 /********************************************************************
@@ -956,43 +912,24 @@ static status_t
 /********************************************************************
 * FUNCTION delete_oldest_notification
 *
-* Clean and free a subscription control block
-*
-* INPUTS:
-*    sub == subscription to delete
+* Remove and free the oldest notification in the replay log
 *
 *********************************************************************/
 static void
     delete_oldest_notification (void)
 {
     agt_not_msg_t            *msg;
-    agt_not_subscription_t   *sub;
 
-    /* get the oldest message in the replay buffer */
-    msg = (agt_not_msg_t *)dlq_deque(&notificationQ);
+    /* get the oldest message in the replay buffer
+     * the subscriptions track their position by log
+     * sequence number, so they do not need to be updated
+     */
+    msg = agt_not_log_remove_first(&notificationlog);
     if (msg == NULL) {
+        SET_ERROR(ERR_INTERNAL_VAL);
         return;
     }
 
-    /* make sure none of the subscriptions are pointing
-     * to this message in tracking the replay progress
-     */
-    for (sub = (agt_not_subscription_t *)
-             dlq_firstEntry(&subscriptionQ);
-         sub != NULL;
-         sub = (agt_not_subscription_t *)dlq_nextEntry(sub)) {
-
-        if (sub->firstreplaymsg == msg) {
-            sub->firstreplaymsg = NULL;
-        }
-        if (sub->lastreplaymsg == msg) {
-            sub->lastreplaymsg = NULL;
-        }
-        if (sub->lastmsg == msg) {
-            sub->lastmsg = NULL;
-        }
-    }
-
     if (LOGDEBUG2) {
         log_debug2("\nDeleting oldest notification (id: %u)",
                    msg->msgid);
@@ -1000,12 +937,6 @@ static void
 
     agt_not_free_notification(msg);
 
-    if (notification_count > 0) {
-        notification_count--;
-    } else {
-        SET_ERROR(ERR_INTERNAL_VAL);
-    }
-
 }  /* delete_oldest_notification */
 
 
@@ -1128,7 +1059,6 @@ static void
     sequenceidobj = NULL;
     anySubscriptions = FALSE;
     msgid = 0;
-    notification_count = 0;
 
 } /* init_static_vars */
 
@@ -1162,7 +1092,7 @@ status_t
     agt_profile = agt_get_profile();
 
     dlq_createSQue(&subscriptionQ);
-    dlq_createSQue(&notificationQ);
+    agt_not_log_init(&notificationlog);
     init_static_vars();
     agt_not_init_done = TRUE;
 
@@ -1413,7 +1343,6 @@ void
     agt_not_cleanup (void)
 {
     agt_not_subscription_t *sub;
-    agt_not_msg_t          *msg;
 
     if (agt_not_init_done) {
         init_static_vars();
@@ -1428,11 +1357,8 @@ void
             free_subscription(sub);
         }
 
-        /* clear the notificationQ */
-        while (!dlq_empty(&notificationQ)) {
-            msg = (agt_not_msg_t *)dlq_deque(&notificationQ);
-            agt_not_free_notification(msg);
-        }
+        /* clear the replay log */
+        agt_not_log_clean(&notificationlog);
 
         agt_not_init_done = FALSE;
     }
@@ -1531,21 +1457,7 @@ uint32
                 /* still sending replay notifications
                  * figure out which one to send next
                  */
-                if (sub->lastmsg) {
-                    not = (agt_not_msg_t *)
-                        dlq_nextEntry(sub->lastmsg);
-                } else if (sub->lastmsgid) {
-                    /* use ID, back-ptr was cleared */
-                    not = get_entry_after(sub->lastmsgid);
-                } else {
-                    /* this is the first replay being sent */
-                    if (sub->firstreplaymsg) {
-                        not = sub->firstreplaymsg;
-                    } else {
-                        /* use ID, back-ptr was cleared */
-                        not = get_entry_after(sub->firstreplaymsgid);
-                    }
-                }
+                not = get_next_entry(sub);
                 if (not) {
                     /* found a replay entry to send */
                     if (!agt_acm_notif_allowed(sub->scb->username,
@@ -1564,16 +1476,12 @@ uint32
                         sub->state = AGT_NOT_STATE_SHUTDOWN;
                     } else {
                         /* msg sent OK; set up next loop through fn */
-                        sub->lastmsg = not;
-                        sub->lastmsgid = not->msgid;
-                        if (sub->lastreplaymsg == not) {
-                            /* this was the last replay to send */
-                            sub->flags |= AGT_NOT_FL_RC_READY;
-                        } else if (sub->lastreplaymsgid &&
-                                   sub->lastreplaymsgid <= not->msgid) {
+                        if ((sub->flags & AGT_NOT_FL_LASTREPLAY) &&
+                            sub->lastreplayseq <= sub->nextseq) {
                             /* this was the last replay to send */
                             sub->flags |= AGT_NOT_FL_RC_READY;
                         }
+                        sub->nextseq++;
                     }
                 } else {
                     /* nothing left in the replay buffer */
@@ -1600,20 +1508,11 @@ uint32
             }
             break;
         case AGT_NOT_STATE_TIMED:
-            if (sub->lastmsg) {
-                not = (agt_not_msg_t *)dlq_nextEntry(sub->lastmsg);
-            } else if (sub->lastmsgid) {
-                /* use ID, back-ptr was cleared */
-                not = get_entry_after(sub->lastmsgid);
-            } else {
-                /* this is the first notification sent */
-                not = (agt_not_msg_t *)dlq_firstEntry(&notificationQ);
-            }
+            not = get_next_entry(sub);
 
             res = NO_ERR;
             if (not) {
-                sub->lastmsg = not;
-                sub->lastmsgid = not->msgid;
+                sub->nextseq++;
 
                 ret = xml_strcmp(sub->stopTime, not->eventTime);
 
@@ -1648,18 +1547,9 @@ uint32
             } /* else stopTime still in the future */
             break;
         case AGT_NOT_STATE_LIVE:
-            if (sub->lastmsg) {
-                not = (agt_not_msg_t *)dlq_nextEntry(sub->lastmsg);
-            } else if (sub->lastmsgid) {
-                /* use ID, back-ptr was cleared */
-                not = get_entry_after(sub->lastmsgid);
-            } else {
-                /* this is the first notification sent */
-                not = (agt_not_msg_t *)dlq_firstEntry(&notificationQ);
-            }
+            not = get_next_entry(sub);
             if (not) {
-                sub->lastmsg = not;
-                sub->lastmsgid = not->msgid;
+                sub->nextseq++;
 
                 if (!agt_acm_notif_allowed(sub->scb->username,
                                            not->notobj)) {
@@ -1715,9 +1605,8 @@ void
 {
     const agt_profile_t     *agt_profile;
     agt_not_subscription_t  *sub;
-    agt_not_msg_t           *msg, *nextmsg;
-
-    uint32                   lowestmsgid;
+    agt_not_msg_t           *msg;
+    uint64                   lowestseq;
 
 
     agt_profile = agt_get_profile();
@@ -1726,47 +1615,25 @@ void
         return;
     }
 
-    if (!anySubscriptions) {
-        /* zap everything in the Q, since there
-         * are no subscriptions right now
-         */
-        while (!dlq_empty(&notificationQ)) {
-            msg = (agt_not_msg_t *)dlq_deque(&notificationQ);
-            agt_not_free_notification(msg);
-        }
-        return;
-    }
-
-    /* find the lowest msgid that has been delivered
-     * to all the sessions, and any messages in the Q
-     * that are lower than that can be deleted
+    /* find the lowest log position that has not been
+     * delivered to all the sessions; any messages in the log
+     * before that can be deleted.  If there are no
+     * subscriptions right now, everything is deleted
      */
-    lowestmsgid = NCX_MAX_UINT;
+    lowestseq = agt_not_log_end_seq(&notificationlog);
     for (sub = (agt_not_subscription_t *)
              dlq_firstEntry(&subscriptionQ);
          sub != NULL;
          sub = (agt_not_subscription_t *)dlq_nextEntry(sub)) {
 
-        if (sub->lastmsgid && sub->lastmsgid < lowestmsgid) {
-            lowestmsgid = sub->lastmsgid;
+        if (sub->nextseq < lowestseq) {
+            lowestseq = sub->nextseq;
         }
     }
 
-    /* keep deleting the oldest entries until the
-     * lowest msg ID is passed yb in the buffer
-     */
-    for (msg = (agt_not_msg_t *)dlq_firstEntry(&notificationQ);
-         msg != NULL;
-         msg = nextmsg) {
-
-         nextmsg = (agt_not_msg_t *)dlq_nextEntry(msg);
-
-         if (msg->msgid < lowestmsgid) {
-             dlq_remove(msg);
-             agt_not_free_notification(msg);
-         } else {
-             return;
-         }
+    while (agt_not_log_first_seq(&notificationlog) < lowestseq) {
+        msg = agt_not_log_remove_first(&notificationlog);
+        agt_not_free_notification(msg);
     }
     
 }  /* agt_not_clean_eventlog */
@@ -1918,7 +1785,7 @@ void
 *            !!! AFTER THIS CALL
 *
 * OUTPUTS:
-*   message added to the notificationQ
+*   message added to the replay log
 *
 *********************************************************************/
 void
@@ -1961,18 +1828,21 @@ void
     agt_profile = agt_get_profile();
 
     if (agt_profile->agt_eventlog_size) {
-    	assert(notification_count<=agt_profile->agt_eventlog_size);
-        if (notification_count == agt_profile->agt_eventlog_size) {
+        assert(agt_not_log_count(&notificationlog) <=
+               agt_profile->agt_eventlog_size);
+        if (agt_not_log_count(&notificationlog) == 
+            agt_profile->agt_eventlog_size) {
             delete_oldest_notification();
         }
-        notification_count++;
-        dlq_enque(notif, &notificationQ);
-    } else {
-        /* not tracking the event log size 
-         * since the entries will get deleted once 
-         * they are sent to all active subscriptions
-         */
-        dlq_enque(notif, &notificationQ);
+    } /* else not tracking the event log size 
+       * since the entries will get deleted once 
+       * they are sent to all active subscriptions
+       */
+
+    if (agt_not_log_add(&notificationlog, notif) != NO_ERR) {
+        log_error("\nError: malloc failed: cannot queue notification");
+        agt_not_free_notification(notif);
+        return;
     }
     agt_not_queue_notification_cb(notif);
 
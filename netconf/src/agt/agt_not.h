@@ -87,6 +87,9 @@ extern "C" {
 /* if set, notificationComplete has been sent */
 #define AGT_NOT_FL_NC_DONE     bit4
 
+/* if set, lastreplayseq is the last replay notification */
+#define AGT_NOT_FL_LASTREPLAY  bit5
+
 
 /********************************************************************
 *                                                                   *
@@ -128,7 +131,7 @@ typedef enum agt_not_stream_t_ {
 
 
 /* one notification message that will be sent to all
- * subscriptions and kept in the replay buffer (notificationQ)
+ * subscriptions and kept in the replay log (agt_not_log.h)
  */
 typedef struct agt_not_msg_t_ {
     dlq_hdr_t                qhdr;
@@ -155,12 +158,9 @@ typedef struct agt_not_subscription_t_ {
     xmlChar              *startTime;       /* converted to UTC */
     xmlChar              *stopTime;        /* converted to UTC */
     uint32                flags;
-    agt_not_msg_t        *firstreplaymsg;   /* back-ptr; could be zapped */
-    agt_not_msg_t        *lastreplaymsg;    /* back-ptr; could be zapped */
-    agt_not_msg_t        *lastmsg;          /* back-ptr; could be zapped */
-    uint32                firstreplaymsgid; /* w/firstreplaymsg is deleted */
-    uint32                lastreplaymsgid;  /* w/lastreplaymsg is deleted */
-    uint32                lastmsgid;        /* w/ lastmsg is deleted */
+    uint64                firstreplayseq;   /* replay log seq numbers */
+    uint64                lastreplayseq;    /* w/AGT_NOT_FL_LASTREPLAY */
+    uint64                nextseq;          /* next msg to send */
     agt_not_state_t       state;
 } agt_not_subscription_t;
 
@@ -0,0 +1,319 @@
+/*  FILE: agt_not_log.c
+
+   Notification replay log
+
+   The ring holds log->count entries, starting at slot
+   log->head.  The entry with sequence number seq is in
+   slot (head + (seq - firstseq)) & (size - 1).  The ring
+   grows by doubling when it is full; the caller removes
+   the oldest entries to keep the log at --eventlog-size.
+
+*********************************************************************
+*                                                                   *
+*                     I N C L U D E    F I L E S                    *
+*                                                                   *
+*********************************************************************/
+#include <stdlib.h>
+#include <memory.h>
+#include <string.h>
+
+#include <libxml/xmlstring.h>
+
+#include "procdefs.h"
+#include "agt_not.h"
+#include "agt_not_log.h"
+#include "status.h"
+#include "xml_util.h"
+
+
+/********************************************************************
+*                                                                   *
+*                         F U N C T I O N S                         *
+*                                                                   *
+*********************************************************************/
+
+
+/********************************************************************
+* FUNCTION grow_ring
+*
+* Double the size of the ring buffer
+* The entries are copied so the oldest one is in slot 0
+*
+* INPUTS:
+*    log == replay log to grow
+*
+* RETURNS:
+*    status
+*********************************************************************/
+static status_t
+    grow_ring (agt_not_log_t *log)
+{
+    agt_not_msg_t **newring;
+    uint32          newsize, i;
+
+    newsize = (log->size) ? log->size * 2 : AGT_NOT_LOG_MIN_SIZE;
+    if (newsize < log->size) {
+        return ERR_NCX_RESOURCE_DENIED;
+    }
+
+    newring = (agt_not_msg_t **)m__getMem(newsize * sizeof(agt_not_msg_t *));
+    if (newring == NULL) {
+        return ERR_INTERNAL_MEM;
+    }
+    memset(newring, 0x0, newsize * sizeof(agt_not_msg_t *));
+
+    for (i = 0; i < log->count; i++) {
+        newring[i] = log->ring[(log->head + i) & (log->size - 1)];
+    }
+
+    if (log->ring) {
+        m__free(log->ring);
+    }
+    log->ring = newring;
+    log->size = newsize;
+    log->head = 0;
+    return NO_ERR;
+
+}  /* grow_ring */
+
+
+/********************************************************************
+* FUNCTION agt_not_log_init
+*
+* Initialize an empty replay log
+*
+* INPUTS:
+*    log == replay log to initialize
+*
+*********************************************************************/
+void
+    agt_not_log_init (agt_not_log_t *log)
+{
+    memset(log, 0x0, sizeof(agt_not_log_t));
+
+}  /* agt_not_log_init */
+
+
+/********************************************************************
+* FUNCTION agt_not_log_clean
+*
+* Free all the notifications in the replay log and
+* the ring buffer itself.  The sequence numbers are
+* not reset, so the log can be used again
+*
+* INPUTS:
+*    log == replay log to clean
+*
+*********************************************************************/
+void
+    agt_not_log_clean (agt_not_log_t *log)
+{
+    agt_not_msg_t  *msg;
+
+    while ((msg = agt_not_log_remove_first(log)) != NULL) {
+        agt_not_free_notification(msg);
+    }
+
+    if (log->ring) {
+        m__free(log->ring);
+        log->ring = NULL;
+    }
+    log->size = 0;
+    log->head = 0;
+
+}  /* agt_not_log_clean */
+
+
+/********************************************************************
+* FUNCTION agt_not_log_add
+*
+* Add a notification to the end of the replay log
+*
+* INPUTS:
+*    log == replay log to use
+*    notif == notification to add
+*             !!! the log owns this memory if NO_ERR returned
+*
+* RETURNS:
+*    status
+*********************************************************************/
+status_t
+    agt_not_log_add (agt_not_log_t *log,
+                     agt_not_msg_t *notif)
+{
+    status_t  res;
+
+    if (log->count == log->size) {
+        res = grow_ring(log);
+        if (res != NO_ERR) {
+            return res;
+        }
+    }
+
+    log->ring[(log->head + log->count) & (log->size - 1)] = notif;
+    log->count++;
+    return NO_ERR;
+
+}  /* agt_not_log_add */
+
+
+/********************************************************************
+* FUNCTION agt_not_log_remove_first
+*
+* Remove the oldest notification from the replay log
+*
+* INPUTS:
+*    log == replay log to use
+*
+* RETURNS:
+*    the removed notification, which the caller must free
+*    NULL if the log is empty
+*********************************************************************/
+agt_not_msg_t *
+    agt_not_log_remove_first (agt_not_log_t *log)
+{
+    agt_not_msg_t  *msg;
+
+    if (log->count == 0) {
+        return NULL;
+    }
+
+    msg = log->ring[log->head];
+    log->ring[log->head] = NULL;
+    log->head = (log->head + 1) & (log->size - 1);
+    log->count--;
+    log->firstseq++;
+    return msg;
+
+}  /* agt_not_log_remove_first */
+
+
+/********************************************************************
+* FUNCTION agt_not_log_get
+*
+* Get the notification with the specified sequence number
+*
+* INPUTS:
+*    log == replay log to use
+*    seq == sequence number of the entry to get
+*
+* RETURNS:
+*    pointer to the notification
+*    NULL if the entry has been removed or not added yet
+*********************************************************************/
+agt_not_msg_t *
+    agt_not_log_get (const agt_not_log_t *log,
+                     uint64 seq)
+{
+    if (seq < log->firstseq || seq - log->firstseq >= log->count) {
+        return NULL;
+    }
+
+    return log->ring[(log->head + (uint32)(seq - log->firstseq))
+                     & (log->size - 1)];
+
+}  /* agt_not_log_get */
+
+
+/********************************************************************
+* FUNCTION agt_not_log_first_seq
+*
+* Get the sequence number of the oldest entry in the log
+*
+* INPUTS:
+*    log == replay log to use
+*
+* RETURNS:
+*    sequence number of the oldest entry;
+*    same as agt_not_log_end_seq if the log is empty
+*********************************************************************/
+uint64
+    agt_not_log_first_seq (const agt_not_log_t *log)
+{
+    return log->firstseq;
+
+}  /* agt_not_log_first_seq */
+
+
+/********************************************************************
+* FUNCTION agt_not_log_end_seq
+*
+* Get the sequence number the next entry added will get
+*
+* INPUTS:
+*    log == replay log to use
+*
+* RETURNS:
+*    sequence number after the newest entry
+*********************************************************************/
+uint64
+    agt_not_log_end_seq (const agt_not_log_t *log)
+{
+    return log->firstseq + log->count;
+
+}  /* agt_not_log_end_seq */
+
+
+/********************************************************************
+* FUNCTION agt_not_log_count
+*
+* Get the number of entries in the log
+*
+* INPUTS:
+*    log == replay log to use
+*
+* RETURNS:
+*    number of notifications in the log
+*********************************************************************/
+uint32
+    agt_not_log_count (const agt_not_log_t *log)
+{
+    return log->count;
+
+}  /* agt_not_log_count */
+
+
+/********************************************************************
+* FUNCTION agt_not_log_find_time
+*
+* Find the position of an eventTime in the replay log
+*
+* INPUTS:
+*    log == replay log to use
+*    eventTime == UTC date-time string to find
+*    after == FALSE to find the first entry with an eventTime
+*             equal to or later than eventTime
+*             TRUE to find the first entry with an eventTime
+*             later than eventTime
+*
+* RETURNS:
+*    sequence number of the entry found
+*    agt_not_log_end_seq if there is no such entry
+*********************************************************************/
+uint64
+    agt_not_log_find_time (const agt_not_log_t *log,
+                           const xmlChar *eventTime,
+                           boolean after)
+{
+    const agt_not_msg_t *msg;
+    uint32               lo, hi, mid;
+    int                  ret;
+
+    lo = 0;
+    hi = log->count;
+    while (lo < hi) {
+        mid = lo + (hi - lo) / 2;
+        msg = log->ring[(log->head + mid) & (log->size - 1)];
+        ret = xml_strcmp(msg->eventTime, eventTime);
+        if (ret < 0 || (after && ret == 0)) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return log->firstseq + lo;
+
+}  /* agt_not_log_find_time */
+
+
+/* END file agt_not_log.c */
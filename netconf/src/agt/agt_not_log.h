@@ -0,0 +1,226 @@
+#ifndef _H_agt_not_log
+#define _H_agt_not_log
+
+/*  FILE: agt_not_log.h
+*********************************************************************
+*								    *
+*			 P U R P O S E				    *
+*								    *
+*********************************************************************
+
+    Notification replay log
+
+  The replay log is a ring buffer of agt_not_msg_t pointers.
+  Each notification gets a log sequence number when it is
+  added; the oldest entry has the lowest number and the
+  numbers are never reused.  Subscriptions keep their
+  position in the log as a sequence number, so removing
+  the oldest entry does not need to touch any subscription:
+  a position that is lower than agt_not_log_first_seq
+  refers to an entry that has been deleted.
+
+  The entries are in eventTime order, so the replay start
+  and stop positions are found with a binary search.
+
+*/
+
+#include <libxml/xmlstring.h>
+
+#ifndef _H_agt_not
+#include "agt_not.h"
+#endif
+
+#ifndef _H_status
+#include "status.h"
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/********************************************************************
+*								    *
+*			 C O N S T A N T S			    *
+*								    *
+*********************************************************************/
+
+/* starting number of slots in the ring; must be a power of 2 */
+#define AGT_NOT_LOG_MIN_SIZE   64
+
+
+/********************************************************************
+*								    *
+*			     T Y P E S				    *
+*								    *
+*********************************************************************/
+
+/* the replay log ring buffer */
+typedef struct agt_not_log_t_ {
+    agt_not_msg_t  **ring;
+    uint32           size;       /* number of slots in the ring */
+    uint32           head;       /* slot of the oldest entry */
+    uint32           count;      /* number of entries in the log */
+    uint64           firstseq;   /* sequence number of the oldest entry */
+} agt_not_log_t;
+
+
+/********************************************************************
+*								    *
+*			F U N C T I O N S			    *
+*								    *
+*********************************************************************/
+
+
+/********************************************************************
+* FUNCTION agt_not_log_init
+*
+* Initialize an empty replay log
+*
+* INPUTS:
+*    log == replay log to initialize
+*
+*********************************************************************/
+extern void
+    agt_not_log_init (agt_not_log_t *log);
+
+
+/********************************************************************
+* FUNCTION agt_not_log_clean
+*
+* Free all the notifications in the replay log and
+* the ring buffer itself.  The sequence numbers are
+* not reset, so the log can be used again
+*
+* INPUTS:
+*    log == replay log to clean
+*
+*********************************************************************/
+extern void
+    agt_not_log_clean (agt_not_log_t *log);
+
+
+/********************************************************************
+* FUNCTION agt_not_log_add
+*
+* Add a notification to the end of the replay log
+*
+* INPUTS:
+*    log == replay log to use
+*    notif == notification to add
+*             !!! the log owns this memory if NO_ERR returned
+*
+* RETURNS:
+*    status
+*********************************************************************/
+extern status_t
+    agt_not_log_add (agt_not_log_t *log,
+                     agt_not_msg_t *notif);
+
+
+/********************************************************************
+* FUNCTION agt_not_log_remove_first
+*
+* Remove the oldest notification from the replay log
+*
+* INPUTS:
+*    log == replay log to use
+*
+* RETURNS:
+*    the removed notification, which the caller must free
+*    NULL if the log is empty
+*********************************************************************/
+extern agt_not_msg_t *
+    agt_not_log_remove_first (agt_not_log_t *log);
+
+
+/********************************************************************
+* FUNCTION agt_not_log_get
+*
+* Get the notification with the specified sequence number
+*
+* INPUTS:
+*    log == replay log to use
+*    seq == sequence number of the entry to get
+*
+* RETURNS:
+*    pointer to the notification
+*    NULL if the entry has been removed or not added yet
+*********************************************************************/
+extern agt_not_msg_t *
+    agt_not_log_get (const agt_not_log_t *log,
+                     uint64 seq);
+
+
+/********************************************************************
+* FUNCTION agt_not_log_first_seq
+*
+* Get the sequence number of the oldest entry in the log
+*
+* INPUTS:
+*    log == replay log to use
+*
+* RETURNS:
+*    sequence number of the oldest entry;
+*    same as agt_not_log_end_seq if the log is empty
+*********************************************************************/
+extern uint64
+    agt_not_log_first_seq (const agt_not_log_t *log);
+
+
+/********************************************************************
+* FUNCTION agt_not_log_end_seq
+*
+* Get the sequence number the next entry added will get
+*
+* INPUTS:
+*    log == replay log to use
+*
+* RETURNS:
+*    sequence number after the newest entry
+*********************************************************************/
+extern uint64
+    agt_not_log_end_seq (const agt_not_log_t *log);
+
+
+/********************************************************************
+* FUNCTION agt_not_log_count
+*
+* Get the number of entries in the log
+*
+* INPUTS:
+*    log == replay log to use
+*
+* RETURNS:
+*    number of notifications in the log
+*********************************************************************/
+extern uint32
+    agt_not_log_count (const agt_not_log_t *log);
+
+
+/********************************************************************
+* FUNCTION agt_not_log_find_time
+*
+* Find the position of an eventTime in the replay log
+*
+* INPUTS:
+*    log == replay log to use
+*    eventTime == UTC date-time string to find
+*    after == FALSE to find the first entry with an eventTime
+*             equal to or later than eventTime
+*             TRUE to find the first entry with an eventTime
+*             later than eventTime
+*
+* RETURNS:
+*    sequence number of the entry found
+*    agt_not_log_end_seq if there is no such entry
+*********************************************************************/
+extern uint64
+    agt_not_log_find_time (const agt_not_log_t *log,
+                           const xmlChar *eventTime,
+                           boolean after);
+
+#ifdef __cplusplus
+}  /* end extern 'C' */
+#endif
+
+#endif	    /* _H_agt_not_log */
@@ -0,0 +1,562 @@
+/*  FILE: agt_nvstore.c
+
+   Write a configuration to non-volatile storage
+
+   Only 1 background write runs at a time.  The child process
+   sends an agt_nvstore_result_t back through a pipe before it
+   exits; agt_nvstore_check reaps the child and reads it.
+
+*********************************************************************
+*                                                                   *
+*                     I N C L U D E    F I L E S                    *
+*                                                                   *
+*********************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <time.h>
+#include <libgen.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#include <libxml/xmlstring.h>
+
+#include "procdefs.h"
+#include "agt.h"
+#include "agt_nvstore.h"
+#include "agt_util.h"
+#include "cfg.h"
+#include "log.h"
+#include "status.h"
+#include "xml_util.h"
+#include "xml_wr.h"
+
+
+/********************************************************************
+*                                                                   *
+*                           T Y P E S                               *
+*                                                                   *
+*********************************************************************/
+
+/* result sent from the child process to the server */
+typedef struct agt_nvstore_result_t_ {
+    status_t  res;
+    uint32    msec;
+} agt_nvstore_result_t;
+
+
+/********************************************************************
+*                                                                   *
+*                       V A R I A B L E S                           *
+*                                                                   *
+*********************************************************************/
+
+/* child process doing the background write, or 0 if none */
+static pid_t                  savepid;
+
+/* read end of the pipe from the child process */
+static int                    savefd = -1;
+
+/* txid of the config being written by the child process */
+static cfg_transaction_id_t   savetxid;
+
+/* config and file to write when the child process is done */
+static cfg_template_t        *pendingcfg;
+static xmlChar               *pendingfile;
+
+/* results of the last write that finished */
+static cfg_transaction_id_t   last_txid;
+static uint32                 last_msec;
+
+
+/********************************************************************
+* FUNCTION elapsed_msec
+*
+* Get the number of milliseconds since a start time
+*
+* INPUTS:
+*    start == CLOCK_MONOTONIC start time
+*
+* RETURNS:
+*    milliseconds
+*********************************************************************/
+static uint32
+    elapsed_msec (const struct timespec *start)
+{
+    struct timespec  now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint32)((now.tv_sec - start->tv_sec) * 1000 +
+                    (now.tv_nsec - start->tv_nsec) / 1000000);
+
+}  /* elapsed_msec */
+
+
+/********************************************************************
+* FUNCTION sync_file
+*
+* Flush a file or directory to disk
+*
+* INPUTS:
+*    filespec == file or directory to flush
+*
+* RETURNS:
+*    status
+*********************************************************************/
+static status_t
+    sync_file (const char *filespec)
+{
+    int  fd, ret;
+
+    fd = open(filespec, O_RDONLY);
+    if (fd < 0) {
+        return ERR_FIL_OPEN;
+    }
+    ret = fsync(fd);
+    close(fd);
+    return (ret == 0) ? NO_ERR : ERR_FIL_WRITE;
+
+}  /* sync_file */
+
+
+/********************************************************************
+* FUNCTION write_config
+*
+* Write the config to a temp file and install it
+* as the real file
+*
+* INPUTS:
+*    cfg == config to write
+*    filespec == file to write
+*
+* RETURNS:
+*    status
+*********************************************************************/
+static status_t
+    write_config (cfg_template_t *cfg,
+                  const xmlChar *filespec)
+{
+    agt_profile_t  *profile;
+    xmlChar        *tempfile, *str;
+    xml_attrs_t     attrs;
+    status_t        res;
+
+    profile = agt_get_profile();
+
+    tempfile = m__getMem(xml_strlen(filespec) +
+                         sizeof(AGT_NVSTORE_TEMP_SUFFIX));
+    if (tempfile == NULL) {
+        return ERR_INTERNAL_MEM;
+    }
+    str = tempfile;
+    str += xml_strcpy(str, filespec);
+    xml_strcpy(str, (const xmlChar *)AGT_NVSTORE_TEMP_SUFFIX);
+
+    /* write the new config */
+    xml_init_attrs(&attrs);
+    res = xml_wr_check_file(tempfile,
+                            cfg->root,
+                            &attrs,
+                            XMLMODE,
+                            WITHHDR,
+                            TRUE,
+                            0,
+                            profile->agt_indent,
+                            agt_check_save);
+    xml_clean_attrs(&attrs);
+
+    if (res == NO_ERR) {
+        res = agt_nvstore_install_file(tempfile, filespec);
+    } else {
+        (void)unlink((const char *)tempfile);
+    }
+    m__free(tempfile);
+    return res;
+
+}  /* write_config */
+
+
+/********************************************************************
+* FUNCTION start_save
+*
+* Fork a child process to write the config
+*
+* INPUTS:
+*    cfg == config to save
+*    filespec == file to write
+*
+* RETURNS:
+*    status
+*********************************************************************/
+static status_t
+    start_save (cfg_template_t *cfg,
+                const xmlChar *filespec)
+{
+    agt_nvstore_result_t  result;
+    struct timespec       start;
+    int                   fds[2];
+    pid_t                 pid;
+
+    if (pipe(fds) != 0) {
+        log_error("\nError: pipe failed (%s)", strerror(errno));
+        return ERR_NCX_OPERATION_FAILED;
+    }
+
+    /* do not let the child write out the server's buffered output */
+    fflush(NULL);
+
+    pid = fork();
+    if (pid < 0) {
+        log_error("\nError: fork failed (%s)", strerror(errno));
+        close(fds[0]);
+        close(fds[1]);
+        return ERR_NCX_OPERATION_FAILED;
+    }
+
+    if (pid == 0) {
+        /* child process: write the snapshot and exit */
+        close(fds[0]);
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        result.res = write_config(cfg, filespec);
+        result.msec = elapsed_msec(&start);
+        if (write(fds[1], &result, sizeof(result)) != sizeof(result)) {
+            result.res = ERR_FIL_WRITE;
+        }
+        fflush(NULL);
+        _exit((result.res == NO_ERR) ? 0 : 1);
+    }
+
+    close(fds[1]);
+    savefd = fds[0];
+    savepid = pid;
+    savetxid = cfg->last_txid;
+
+    if (LOGDEBUG) {
+        log_debug("\nagt_nvstore: writing <%s> config (txid %llu) "
+                  "to '%s' in process %d",
+                  cfg->name,
+                  (unsigned long long)savetxid,
+                  filespec,
+                  (int)pid);
+    }
+    return NO_ERR;
+
+}  /* start_save */
+
+
+/********************************************************************
+* FUNCTION finish_save
+*
+* Wait for the child process and record its result
+*
+* INPUTS:
+*    options == waitpid options (0 or WNOHANG)
+*
+* RETURNS:
+*    TRUE if the child process is done
+*    FALSE if it is still running
+*********************************************************************/
+static boolean
+    finish_save (int options)
+{
+    agt_nvstore_result_t  result;
+    int                   status;
+    pid_t                 ret;
+
+    ret = waitpid(savepid, &status, options);
+    if (ret == 0 || (ret < 0 && errno == EINTR)) {
+        return FALSE;
+    }
+
+    memset(&result, 0x0, sizeof(result));
+    if (read(savefd, &result, sizeof(result)) != sizeof(result)) {
+        result.res = ERR_NCX_OPERATION_FAILED;
+    }
+    close(savefd);
+    savefd = -1;
+    savepid = 0;
+
+    if (result.res == NO_ERR) {
+        last_txid = savetxid;
+        last_msec = result.msec;
+        if (LOGDEBUG) {
+            log_debug("\nagt_nvstore: config txid %llu saved in %u msec",
+                      (unsigned long long)last_txid,
+                      last_msec);
+        }
+    } else {
+        log_error("\nError: background save of config txid %llu "
+                  "failed (%s)",
+                  (unsigned long long)savetxid,
+                  get_error_string(result.res));
+    }
+    return TRUE;
+
+}  /* finish_save */
+
+
+/*************** E X T E R N A L    F U N C T I O N S  *************/
+
+/********************************************************************
+* FUNCTION agt_nvstore_install_file
+*
+* Flush a completely written temp file to disk and rename
+* it over the real file, keeping the file permissions of
+* the real file if it exists
+*
+* INPUTS:
+*    tempfile == temp file to install; removed if any error
+*    filespec == file to replace
+*
+* RETURNS:
+*    status
+*********************************************************************/
+status_t
+    agt_nvstore_install_file (const xmlChar *tempfile,
+                              const xmlChar *filespec)
+{
+    struct stat  statbuff;
+    status_t     res;
+
+    res = sync_file((const char *)tempfile);
+
+    /* keep the file permissions of the old file */
+    if (res == NO_ERR && stat((const char *)filespec, &statbuff) == 0) {
+        (void)chmod((const char *)tempfile, statbuff.st_mode & 07777);
+    }
+
+    if (res == NO_ERR &&
+        rename((const char *)tempfile, (const char *)filespec) != 0) {
+        log_error("\nError: rename '%s' to '%s' failed (%s)",
+                  tempfile,
+                  filespec,
+                  strerror(errno));
+        res = ERR_FIL_WRITE;
+    }
+
+    if (res != NO_ERR) {
+        (void)unlink((const char *)tempfile);
+        return res;
+    }
+
+    /* make sure the rename is on disk too */
+    (void)agt_nvstore_sync_dir(filespec);
+    return NO_ERR;
+
+}  /* agt_nvstore_install_file */
+
+
+/********************************************************************
+* FUNCTION agt_nvstore_sync_dir
+*
+* Flush the directory entries of the directory
+* containing a file to disk
+*
+* INPUTS:
+*    filespec == file in the directory to flush
+*
+* RETURNS:
+*    status
+*********************************************************************/
+status_t
+    agt_nvstore_sync_dir (const xmlChar *filespec)
+{
+    xmlChar   *dirbuff;
+
+    dirbuff = xml_strdup(filespec);
+    if (dirbuff == NULL) {
+        return ERR_INTERNAL_MEM;
+    }
+    (void)sync_file(dirname((char *)dirbuff));
+    m__free(dirbuff);
+    return NO_ERR;
+
+}  /* agt_nvstore_sync_dir */
+
+
+
+/********************************************************************
+* FUNCTION agt_nvstore_save
+*
+* Write a config to a file and wait for the write to finish
+*
+* INPUTS:
+*    cfg == config to save
+*    filespec == file to write
+*
+* RETURNS:
+*    status
+*********************************************************************/
+status_t
+    agt_nvstore_save (cfg_template_t *cfg,
+                      const xmlChar *filespec)
+{
+    struct timespec  start;
+    status_t         res;
+
+    /* an older background write must not replace this one */
+    if (savepid) {
+        (void)finish_save(0);
+    }
+    if (pendingcfg == cfg) {
+        pendingcfg = NULL;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    res = write_config(cfg, filespec);
+    if (res == NO_ERR) {
+        last_txid = cfg->last_txid;
+        last_msec = elapsed_msec(&start);
+    }
+    return res;
+
+}  /* agt_nvstore_save */
+
+
+/********************************************************************
+* FUNCTION agt_nvstore_save_async
+*
+* Start writing a config to a file in a child process
+* If a write is already in progress, the config will be
+* written again after that write is done
+*
+* INPUTS:
+*    cfg == config to save
+*    filespec == file to write
+*
+* RETURNS:
+*    status; the status of the write itself is only logged
+*********************************************************************/
+status_t
+    agt_nvstore_save_async (cfg_template_t *cfg,
+                            const xmlChar *filespec)
+{
+    xmlChar  *newfile;
+
+    if (savepid) {
+        (void)finish_save(WNOHANG);
+    }
+
+    if (savepid == 0) {
+        if (start_save(cfg, filespec) == NO_ERR) {
+            return NO_ERR;
+        }
+        /* could not start a child process */
+        return agt_nvstore_save(cfg, filespec);
+    }
+
+    /* a write is in progress, so combine this save
+     * with any other one requested before it is done
+     */
+    if (pendingfile == NULL || xml_strcmp(pendingfile, filespec)) {
+        newfile = xml_strdup(filespec);
+        if (newfile == NULL) {
+            return ERR_INTERNAL_MEM;
+        }
+        if (pendingfile) {
+            m__free(pendingfile);
+        }
+        pendingfile = newfile;
+    }
+    pendingcfg = cfg;
+    return NO_ERR;
+
+}  /* agt_nvstore_save_async */
+
+
+/********************************************************************
+* FUNCTION agt_nvstore_check
+*
+* Check if the background write is done and start the
+* next one if a save was requested in the meantime
+* Called from the ncxserver polling loop
+*
+*********************************************************************/
+void
+    agt_nvstore_check (void)
+{
+    cfg_template_t  *cfg;
+
+    if (savepid == 0 || !finish_save(WNOHANG)) {
+        return;
+    }
+
+    if (pendingcfg) {
+        cfg = pendingcfg;
+        pendingcfg = NULL;
+        if (start_save(cfg, pendingfile) != NO_ERR) {
+            (void)agt_nvstore_save(cfg, pendingfile);
+        }
+    }
+
+}  /* agt_nvstore_check */
+
+
+/********************************************************************
+* FUNCTION agt_nvstore_get_last_txid
+*
+* Get the transaction ID of the config that was last
+* written to a file
+*
+* RETURNS:
+*    transaction ID or 0 if no config was written yet
+*********************************************************************/
+cfg_transaction_id_t
+    agt_nvstore_get_last_txid (void)
+{
+    return last_txid;
+
+}  /* agt_nvstore_get_last_txid */
+
+
+/********************************************************************
+* FUNCTION agt_nvstore_get_last_msec
+*
+* Get the time the last config write took
+*
+* RETURNS:
+*    milliseconds
+*********************************************************************/
+uint32
+    agt_nvstore_get_last_msec (void)
+{
+    return last_msec;
+
+}  /* agt_nvstore_get_last_msec */
+
+
+/********************************************************************
+* FUNCTION agt_nvstore_cleanup
+*
+* Wait for the background write and finish any
+* save that is still pending
+*
+*********************************************************************/
+void
+    agt_nvstore_cleanup (void)
+{
+    if (savepid) {
+        (void)finish_save(0);
+    }
+
+    if (pendingcfg) {
+        if (agt_nvstore_save(pendingcfg, pendingfile) != NO_ERR) {
+            log_error("\nError: could not save pending <%s> config",
+                      pendingcfg->name);
+        }
+        pendingcfg = NULL;
+    }
+
+    if (pendingfile) {
+        m__free(pendingfile);
+        pendingfile = NULL;
+    }
+
+}  /* agt_nvstore_cleanup */
+
+
+/* END file agt_nvstore.c */
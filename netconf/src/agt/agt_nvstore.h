@@ -0,0 +1,180 @@
+#ifndef _H_agt_nvstore
+#define _H_agt_nvstore
+
+/*  FILE: agt_nvstore.h
+*********************************************************************
+*								    *
+*			 P U R P O S E				    *
+*								    *
+*********************************************************************
+
+    Write a configuration to non-volatile storage
+
+  The config is written to a temporary file in the same
+  directory, which is flushed to disk and then renamed over
+  the old file, so a crash never leaves a partial file.
+
+  If --async-nvstore=true, agt_ncx_cfg_save uses
+  agt_nvstore_save_async when there is no distinct startup
+  config.  The file is written by a forked child process,
+  which works on a copy-on-write snapshot of the config tree,
+  so the server does not wait for the write.  Saves requested
+  while a child is still writing are combined into 1 write of
+  the latest config, started after the child exits.
+
+*/
+
+#include <libxml/xmlstring.h>
+
+#ifndef _H_cfg
+#include "cfg.h"
+#endif
+
+#ifndef _H_status
+#include "status.h"
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/********************************************************************
+*								    *
+*			 C O N S T A N T S			    *
+*								    *
+*********************************************************************/
+
+/* suffix of the temporary file written before the rename */
+#define AGT_NVSTORE_TEMP_SUFFIX  ".tmp"
+
+
+/********************************************************************
+*								    *
+*			F U N C T I O N S			    *
+*								    *
+*********************************************************************/
+
+
+/********************************************************************
+* FUNCTION agt_nvstore_install_file
+*
+* Flush a completely written temp file to disk and rename
+* it over the real file, keeping the file permissions of
+* the real file if it exists
+*
+* INPUTS:
+*    tempfile == temp file to install; removed if any error
+*    filespec == file to replace
+*
+* RETURNS:
+*    status
+*********************************************************************/
+extern status_t
+    agt_nvstore_install_file (const xmlChar *tempfile,
+                              const xmlChar *filespec);
+
+
+/********************************************************************
+* FUNCTION agt_nvstore_sync_dir
+*
+* Flush the directory entries of the directory
+* containing a file to disk
+*
+* INPUTS:
+*    filespec == file in the directory to flush
+*
+* RETURNS:
+*    status
+*********************************************************************/
+extern status_t
+    agt_nvstore_sync_dir (const xmlChar *filespec);
+
+
+/********************************************************************
+* FUNCTION agt_nvstore_save
+*
+* Write a config to a file and wait for the write to finish
+*
+* INPUTS:
+*    cfg == config to save
+*    filespec == file to write
+*
+* RETURNS:
+*    status
+*********************************************************************/
+extern status_t
+    agt_nvstore_save (cfg_template_t *cfg,
+                      const xmlChar *filespec);
+
+
+/********************************************************************
+* FUNCTION agt_nvstore_save_async
+*
+* Start writing a config to a file in a child process
+* If a write is already in progress, the config will be
+* written again after that write is done
+*
+* INPUTS:
+*    cfg == config to save
+*    filespec == file to write
+*
+* RETURNS:
+*    status; the status of the write itself is only logged
+*********************************************************************/
+extern status_t
+    agt_nvstore_save_async (cfg_template_t *cfg,
+                            const xmlChar *filespec);
+
+
+/********************************************************************
+* FUNCTION agt_nvstore_check
+*
+* Check if the background write is done and start the
+* next one if a save was requested in the meantime
+* Called from the ncxserver polling loop
+*
+*********************************************************************/
+extern void
+    agt_nvstore_check (void);
+
+
+/********************************************************************
+* FUNCTION agt_nvstore_get_last_txid
+*
+* Get the transaction ID of the config that was last
+* written to a file
+*
+* RETURNS:
+*    transaction ID or 0 if no config was written yet
+*********************************************************************/
+extern cfg_transaction_id_t
+    agt_nvstore_get_last_txid (void);
+
+
+/********************************************************************
+* FUNCTION agt_nvstore_get_last_msec
+*
+* Get the time the last config write took
+*
+* RETURNS:
+*    milliseconds
+*********************************************************************/
+extern uint32
+    agt_nvstore_get_last_msec (void);
+
+
+/********************************************************************
+* FUNCTION agt_nvstore_cleanup
+*
+* Wait for the background write and finish any
+* save that is still pending
+*
+*********************************************************************/
+extern void
+    agt_nvstore_cleanup (void);
+
+#ifdef __cplusplus
+}  /* end extern 'C' */
+#endif
+
+#endif	    /* _H_agt_nvstore */
@@ -82,6 +82,14 @@ date         init     comment
 *                                                                   *
 *********************************************************************/
 
+/* bulk snapshot of the /proc/meminfo file,
+ * with each line zero-terminated
+ */
+typedef struct proc_meminfo_snapshot_t_ {
+    char                 *buffer;
+    uint32                bufflen;
+} proc_meminfo_snapshot_t;
+
 
 /********************************************************************
 *                                                                   *
@@ -97,6 +105,8 @@ static val_value_t          *myprocval;
 
 static obj_template_t       *myprocobj;
 
+static obj_template_t       *mymeminfoobj;
+
 
 /********************************************************************
 * FUNCTION is_proc_supported
@@ -430,6 +440,79 @@ static status_t
 }  /* add_cpuinfo */
 
 
+/********************************************************************
+* FUNCTION free_meminfo_snapshot
+*
+* Free a /proc/meminfo snapshot
+*
+* INPUTS:
+*   snapshot == proc_meminfo_snapshot_t to free
+*********************************************************************/
+static void
+    free_meminfo_snapshot (void *snapshot)
+{
+    proc_meminfo_snapshot_t  *snap;
+
+    snap = (proc_meminfo_snapshot_t *)snapshot;
+    if (snap->buffer) {
+        m__free(snap->buffer);
+    }
+    m__free(snap);
+
+} /* free_meminfo_snapshot */
+
+
+/********************************************************************
+* FUNCTION get_meminfo_snapshot
+*
+* Bulk get callback for the meminfo NP container
+*
+* Read the /proc/meminfo file once per request and split
+* it into zero-terminated lines
+*
+* INPUTS:
+*    see ncx/getcb.h getcb_bulk_fn_t for details
+*
+* RETURNS:
+*    status
+*********************************************************************/
+static status_t
+    get_meminfo_snapshot (ses_cb_t *scb,
+                          obj_template_t *obj,
+                          void **snapshot)
+{
+    proc_meminfo_snapshot_t  *snap;
+    char                     *str;
+    status_t                  res;
+
+    (void)scb;
+    (void)obj;
+
+    snap = m__getObj(proc_meminfo_snapshot_t);
+    if (snap == NULL) {
+        return ERR_INTERNAL_MEM;
+    }
+    memset(snap, 0x0, sizeof(proc_meminfo_snapshot_t));
+
+    snap->buffer = (char *)
+        agt_read_proc_file("/proc/meminfo", &snap->bufflen, &res);
+    if (snap->buffer == NULL) {
+        free_meminfo_snapshot(snap);
+        return res;
+    }
+
+    for (str = snap->buffer; *str; str++) {
+        if (*str == '\n') {
+            *str = '\0';
+        }
+    }
+
+    *snapshot = snap;
+    return NO_ERR;
+
+} /* get_meminfo_snapshot */
+
+
 /********************************************************************
 * FUNCTION get_meminfo
 *
@@ -447,14 +530,12 @@ static status_t
                  val_value_t *virval,
                  val_value_t  *dstval)
 {
-    FILE                  *meminfofile;
-    obj_template_t        *meminfoobj;
-    val_value_t           *parmval;
-    char                  *buffer, *readtest;
-    boolean                done;
-    status_t               res;
+    obj_template_t           *meminfoobj;
+    val_value_t              *parmval;
+    proc_meminfo_snapshot_t  *snap;
+    char                     *line, *end;
+    status_t                  res;
 
-    (void)scb;
     res = NO_ERR;
 
     if (cbmode != GETCB_GET_VALUE) {
@@ -463,43 +544,27 @@ static status_t
 
     meminfoobj = virval->obj;
 
-    /* open the /proc/meminfo file for reading */
-    meminfofile = fopen("/proc/meminfo", "r");
-    if (meminfofile == NULL) {
-        return errno_to_status();
-    }
-
-    /* get a file read line buffer */
-    buffer = m__getMem(NCX_MAX_LINELEN);
-    if (buffer == NULL) {
-        fclose(meminfofile);
-        return ERR_INTERNAL_MEM;
+    /* the /proc/meminfo file is read once per request */
+    snap = (proc_meminfo_snapshot_t *)
+        getcb_get_snapshot(scb, meminfoobj, &res);
+    if (snap == NULL) {
+        return res;
     }
 
-    /* loop through the file until done */
-    res = NO_ERR;
-    done = FALSE;
-    while (!done) {
-        readtest = fgets(buffer, NCX_MAX_LINELEN, meminfofile);
-        if (readtest == NULL) {
-            done = TRUE;
+    /* loop through the snapshot lines */
+    end = snap->buffer + snap->bufflen;
+    for (line = snap->buffer; line < end; line += strlen(line) + 1) {
+        if (*line == '\0') {
             continue;
         }
 
-        if (strlen(buffer) == 1 && *buffer == '\n') {
-            ;
-        } else {
-            res = NO_ERR;
-            parmval = make_proc_leaf(buffer, meminfoobj, &res);
-            if (parmval) {
-                val_add_child(parmval, dstval);
-            }
+        res = NO_ERR;
+        parmval = make_proc_leaf(line, meminfoobj, &res);
+        if (parmval) {
+            val_add_child(parmval, dstval);
         }
     }
 
-    fclose(meminfofile);
-    m__free(buffer);
-
     return res;
 
 } /* get_meminfo */
@@ -522,6 +587,7 @@ static status_t
 {
     obj_template_t        *meminfoobj;
     val_value_t           *meminfoval;
+    status_t               res;
 
     /* find the meminfo object */
     meminfoobj = obj_find_child(myprocobj,
@@ -531,6 +597,14 @@ static status_t
         return ERR_NCX_DEF_NOT_FOUND;
     }
 
+    res = getcb_register_bulk(meminfoobj,
+                              get_meminfo_snapshot,
+                              free_meminfo_snapshot);
+    if (res != NO_ERR) {
+        return res;
+    }
+    mymeminfoobj = meminfoobj;
+
     /* create meminfo virtual NP container */
     meminfoval = val_new_value();
     if (meminfoval == NULL) {
@@ -576,6 +650,7 @@ status_t
     procmod = NULL;
     myprocval = NULL;
     myprocobj = NULL;
+    mymeminfoobj = NULL;
     agt_proc_init_done = TRUE;
 
     /* load the netconf-state module */
@@ -669,6 +744,10 @@ void
     agt_proc_cleanup (void)
 {
     if (agt_proc_init_done) {
+        if (mymeminfoobj) {
+            getcb_unregister_bulk(mymeminfoobj);
+            mymeminfoobj = NULL;
+        }
         procmod = NULL;
         myprocval = NULL;
         myprocval = NULL;
@@ -620,7 +620,7 @@ ses_cb_t *
             scb->state = SES_ST_INIT;
             scb->fd = fd;
             scb->instate = SES_INST_IDLE;
-            scb->stream_output = TRUE;
+            scb->stream_output = agt_profile->agt_stream_output;
             res = ses_msg_new_buff(scb, TRUE, &scb->outbuff);
         } else {
             res = ERR_INTERNAL_MEM;
@@ -933,11 +933,17 @@ boolean
         uint32 vtimeout_copy = ncx_get_vtimeout_value();
         ncx123_set_vtimeout_value(scb->cache_timeout);
 
+        /* virtual nodes share the bulk get callback
+         * snapshots until the request is done
+         */
+        getcb_snapshot_begin();
+
         /* process the message
          * the scb pointer may get deleted !!!
          */
         agt_top_dispatch_msg(&scb);
 
+        getcb_snapshot_end();
         ncx123_set_vtimeout_value(vtimeout_copy);
     } else {
         if (LOGINFO) {
@@ -1150,6 +1156,35 @@ void
 
 }  /* agt_ses_fill_writeset */
 
+/********************************************************************
+* FUNCTION agt_ses_get_first_outready
+*
+* Dequeue the first session in the ses_msg outreadyQ
+* that is still allowed to send output
+* Used by the agt_ncxserver epoll loop to arm write events
+*
+* RETURNS:
+*    pointer to the session control block or NULL if
+*    the outreadyQ is empty
+*********************************************************************/
+ses_cb_t *
+    agt_ses_get_first_outready (void)
+{
+    ses_ready_t *rdy;
+    ses_cb_t    *scb;
+
+    for (rdy = ses_msg_get_first_outready();
+         rdy != NULL;
+         rdy = ses_msg_get_first_outready()) {
+        scb = agtses[rdy->sid];
+        if (scb && scb->state <= SES_ST_SHUTDOWN_REQ) {
+            return scb;
+        }
+    }
+    return NULL;
+
+}  /* agt_ses_get_first_outready */
+
 /********************************************************************
 * FUNCTION agt_ses_get_inSessions
 *
@@ -292,6 +292,21 @@ extern void
 			   int *maxfdnum);
 
 
+/********************************************************************
+* FUNCTION agt_ses_get_first_outready
+*
+* Dequeue the first session in the ses_msg outreadyQ
+* that is still allowed to send output
+* Used by the agt_ncxserver epoll loop to arm write events
+*
+* RETURNS:
+*    pointer to the session control block or NULL if
+*    the outreadyQ is empty
+*********************************************************************/
+extern ses_cb_t *
+    agt_ses_get_first_outready (void);
+
+
 /********************************************************************
 * FUNCTION agt_ses_get_inSessions
 *
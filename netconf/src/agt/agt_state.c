@@ -1604,7 +1604,7 @@ void
         if (!idval) {
             SET_ERROR(ERR_INTERNAL_VAL);
         } else if (VAL_UINT(idval) == sid) {
-            dlq_remove(sessionval);
+            val_remove_child(sessionval);
             val_free_value(sessionval);
             return;
         }
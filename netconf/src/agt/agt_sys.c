@@ -20,6 +20,10 @@ leaf /system/sysCurrentDateTime
 leaf /system/sysBootDateTime
 leaf /system/sysLogLevel
 leaf /system/sysNetconfServerId
+leaf /system/sysStartupSaveTxid
+leaf /system/sysStartupSaveTime
+leaf /system/sysLogAsync
+leaf /system/sysLogDropped
 notification /sysStartup
 leaf /sysStartup/startupSource
 list /sysStartup/bootError
@@ -96,6 +100,7 @@ date         init     comment
 #include "agt_cfg.h"
 #include "agt_cli.h"
 #include "agt_not.h"
+#include "agt_nvstore.h"
 #include "agt_rpc.h"
 #include "agt_ses.h"
 #include "agt_sys.h"
@@ -131,6 +136,10 @@ date         init     comment
 #define system_N_sysBootDateTime (const xmlChar *)"sysBootDateTime"
 #define system_N_sysLogLevel (const xmlChar *)"sysLogLevel"
 #define system_N_sysNetconfServerId (const xmlChar *)"sysNetconfServerId"
+#define system_N_sysStartupSaveTxid (const xmlChar *)"sysStartupSaveTxid"
+#define system_N_sysStartupSaveTime (const xmlChar *)"sysStartupSaveTime"
+#define system_N_sysLogAsync (const xmlChar *)"sysLogAsync"
+#define system_N_sysLogDropped (const xmlChar *)"sysLogDropped"
 #define system_N_sysNetconfServerCLI (const xmlChar *)"sysNetconfServerCLI"
 
 #define system_N_sysStartup (const xmlChar *)"sysStartup"
@@ -302,6 +311,126 @@ static status_t
 } /* get_currentLogLevel */
 
 
+/********************************************************************
+* FUNCTION get_startupSaveTxid
+*
+* <get> operation handler for the sysStartupSaveTxid leaf
+*
+* INPUTS:
+*    see ncx/getcb.h getcb_fn_t for details
+*
+* RETURNS:
+*    status
+*********************************************************************/
+static status_t 
+    get_startupSaveTxid (ses_cb_t *scb,
+                         getcb_mode_t cbmode,
+                         const val_value_t *virval,
+                         val_value_t  *dstval)
+{
+    (void)scb;
+    (void)virval;
+
+    if (cbmode == GETCB_GET_VALUE) {
+        VAL_ULONG(dstval) = agt_nvstore_get_last_txid();
+        return NO_ERR;
+    } else {
+        return ERR_NCX_OPERATION_NOT_SUPPORTED;
+    }
+
+} /* get_startupSaveTxid */
+
+
+/********************************************************************
+* FUNCTION get_startupSaveTime
+*
+* <get> operation handler for the sysStartupSaveTime leaf
+*
+* INPUTS:
+*    see ncx/getcb.h getcb_fn_t for details
+*
+* RETURNS:
+*    status
+*********************************************************************/
+static status_t 
+    get_startupSaveTime (ses_cb_t *scb,
+                         getcb_mode_t cbmode,
+                         const val_value_t *virval,
+                         val_value_t  *dstval)
+{
+    (void)scb;
+    (void)virval;
+
+    if (cbmode == GETCB_GET_VALUE) {
+        VAL_UINT(dstval) = agt_nvstore_get_last_msec();
+        return NO_ERR;
+    } else {
+        return ERR_NCX_OPERATION_NOT_SUPPORTED;
+    }
+
+} /* get_startupSaveTime */
+
+
+/********************************************************************
+* FUNCTION get_logAsync
+*
+* <get> operation handler for the sysLogAsync leaf
+*
+* INPUTS:
+*    see ncx/getcb.h getcb_fn_t for details
+*
+* RETURNS:
+*    status
+*********************************************************************/
+static status_t 
+    get_logAsync (ses_cb_t *scb,
+                  getcb_mode_t cbmode,
+                  const val_value_t *virval,
+                  val_value_t  *dstval)
+{
+    (void)scb;
+    (void)virval;
+
+    if (cbmode == GETCB_GET_VALUE) {
+        return ncx_set_enum(log_get_async_string(log_get_async_mode()),
+                            VAL_ENU(dstval));
+    } else {
+        return ERR_NCX_OPERATION_NOT_SUPPORTED;
+    }
+
+} /* get_logAsync */
+
+
+/********************************************************************
+* FUNCTION get_logDropped
+*
+* <get> operation handler for the sysLogDropped leaf
+*
+* INPUTS:
+*    see ncx/getcb.h getcb_fn_t for details
+*
+* RETURNS:
+*    status
+*********************************************************************/
+static status_t 
+    get_logDropped (ses_cb_t *scb,
+                    getcb_mode_t cbmode,
+                    const val_value_t *virval,
+                    val_value_t  *dstval)
+{
+    (void)scb;
+    (void)virval;
+
+    if (cbmode == GETCB_GET_VALUE) {
+        VAL_ULONG(dstval) = log_get_async_dropped();
+        return NO_ERR;
+    } else {
+        return ERR_NCX_OPERATION_NOT_SUPPORTED;
+    }
+
+} /* get_logDropped */
+
+
 /********************************************************************
 * FUNCTION set_log_level_invoke
 *
@@ -746,6 +875,42 @@ status_t
     }
     buffer = NULL;
 
+    /* add /system-state/yuma/sysStartupSaveTxid */
+    childval = agt_make_virtual_leaf(yuma_system_obj, system_N_sysStartupSaveTxid,
+                                     get_startupSaveTxid, &res);
+    if (childval) {
+        val_add_child(childval, yuma_system_val);
+    } else {
+        return res;
+    }
+
+    /* add /system-state/yuma/sysStartupSaveTime */
+    childval = agt_make_virtual_leaf(yuma_system_obj, system_N_sysStartupSaveTime,
+                                     get_startupSaveTime, &res);
+    if (childval) {
+        val_add_child(childval, yuma_system_val);
+    } else {
+        return res;
+    }
+
+    /* add /system-state/yuma/sysLogAsync */
+    childval = agt_make_virtual_leaf(yuma_system_obj, system_N_sysLogAsync,
+                                     get_logAsync, &res);
+    if (childval) {
+        val_add_child(childval, yuma_system_val);
+    } else {
+        return res;
+    }
+
+    /* add /system-state/yuma/sysLogDropped */
+    childval = agt_make_virtual_leaf(yuma_system_obj, system_N_sysLogDropped,
+                                     get_logDropped, &res);
+    if (childval) {
+        val_add_child(childval, yuma_system_val);
+    } else {
+        return res;
+    }
+
     /* add /system-state/yuma/sysNetconfServerCLI */
     tempval = val_clone(agt_cli_get_valset());
     if (tempval == NULL) {
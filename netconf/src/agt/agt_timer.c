@@ -51,7 +51,14 @@ date         init     comment
 *                                                                   *
 *********************************************************************/
 
-#define AGT_TIMER_SKIP_COUNT 1
+/* number of hash buckets for finding a timer by ID */
+#define AGT_TIMER_BUCKETS     1024
+
+/* initial number of slots in the timer heap */
+#define AGT_TIMER_HEAP_INIT   64
+
+/* timer_heapidx value for a timer that is not in the heap */
+#define AGT_TIMER_NO_HEAPIDX  NCX_MAX_UINT
 
 /********************************************************************
 *                                                                   *
@@ -61,21 +68,244 @@ date         init     comment
 
 static boolean agt_timer_init_done = FALSE;
 
-static dlq_hdr_t   timer_cbQ;
+/* hash buckets of agt_timer_cb_t, by timer ID */
+static dlq_hdr_t   timer_cbQ[AGT_TIMER_BUCKETS];
+
+static uint32      timer_count;
 
 static uint32      next_id;
 
-static uint32      skip_count;
+/* binary min-heap of the active timers, by timer_deadline */
+static agt_timer_cb_t **timer_heap;
+
+static uint32      timer_heap_len;
+
+static uint32      timer_heap_max;
+
+/* timer whose callback is running, if any */
+static agt_timer_cb_t *running_timer_cb;
+
 
 /********************************************************************
-* FUNCTION get_timer_id
+* FUNCTION get_msec_now
 *
-* Allocate a timer ID
+* Get the current monotonic time
+*
+* RETURNS:
+*   number of milliseconds on the CLOCK_MONOTONIC clock
+*********************************************************************/
+static uint64
+    get_msec_now (void)
+{
+    struct timespec  tp;
+    int              ret;
+
+    ret = clock_gettime(CLOCK_MONOTONIC, &tp);
+    assert(ret == 0);
+    return (uint64)tp.tv_sec * 1000 + (uint64)(tp.tv_nsec / 1000000);
+
+} /* get_msec_now */
+
+
+/********************************************************************
+* FUNCTION heap_set
+*
+* Put a timer in a heap slot
 *
 * INPUTS:
-*   none
+*   idx == heap slot to use
+*   timer_cb == timer to put in the slot
+*********************************************************************/
+static void
+    heap_set (uint32 idx,
+              agt_timer_cb_t *timer_cb)
+{
+    timer_heap[idx] = timer_cb;
+    timer_cb->timer_heapidx = idx;
+
+} /* heap_set */
+
+
+/********************************************************************
+* FUNCTION heap_sift_up
+*
+* Move a timer towards the top of the heap until its
+* parent does not expire later
+*
+* INPUTS:
+*   idx == heap slot of the timer to move
+*********************************************************************/
+static void
+    heap_sift_up (uint32 idx)
+{
+    agt_timer_cb_t  *timer_cb;
+    uint32           parent;
+
+    timer_cb = timer_heap[idx];
+    while (idx > 0) {
+        parent = (idx - 1) / 2;
+        if (timer_heap[parent]->timer_deadline <= timer_cb->timer_deadline) {
+            break;
+        }
+        heap_set(idx, timer_heap[parent]);
+        idx = parent;
+    }
+    heap_set(idx, timer_cb);
+
+} /* heap_sift_up */
+
+
+/********************************************************************
+* FUNCTION heap_sift_down
+*
+* Move a timer towards the bottom of the heap until
+* neither child expires earlier
+*
+* INPUTS:
+*   idx == heap slot of the timer to move
+*********************************************************************/
+static void
+    heap_sift_down (uint32 idx)
+{
+    agt_timer_cb_t  *timer_cb;
+    uint32           child;
+
+    timer_cb = timer_heap[idx];
+    for (;;) {
+        child = 2 * idx + 1;
+        if (child >= timer_heap_len) {
+            break;
+        }
+        if (child + 1 < timer_heap_len &&
+            timer_heap[child + 1]->timer_deadline <
+            timer_heap[child]->timer_deadline) {
+            child++;
+        }
+        if (timer_cb->timer_deadline <= timer_heap[child]->timer_deadline) {
+            break;
+        }
+        heap_set(idx, timer_heap[child]);
+        idx = child;
+    }
+    heap_set(idx, timer_cb);
+
+} /* heap_sift_down */
+
+
+/********************************************************************
+* FUNCTION heap_insert
+*
+* Add a timer to the heap
+*
+* INPUTS:
+*   timer_cb == timer to add; timer_deadline must be set
+*
 * RETURNS:
-*   timer_id or zero if none available
+*   status
+*********************************************************************/
+static status_t
+    heap_insert (agt_timer_cb_t *timer_cb)
+{
+    agt_timer_cb_t  **newheap;
+    uint32            newmax;
+
+    if (timer_heap_len == timer_heap_max) {
+        newmax = (timer_heap_max) ? timer_heap_max * 2 : AGT_TIMER_HEAP_INIT;
+        newheap = m__getMem(newmax * sizeof(agt_timer_cb_t *));
+        if (newheap == NULL) {
+            return ERR_INTERNAL_MEM;
+        }
+        if (timer_heap) {
+            memcpy(newheap, timer_heap,
+                   timer_heap_len * sizeof(agt_timer_cb_t *));
+            m__free(timer_heap);
+        }
+        timer_heap = newheap;
+        timer_heap_max = newmax;
+    }
+
+    heap_set(timer_heap_len++, timer_cb);
+    heap_sift_up(timer_cb->timer_heapidx);
+    return NO_ERR;
+
+} /* heap_insert */
+
+
+/********************************************************************
+* FUNCTION heap_remove
+*
+* Remove a timer from the heap, if it is in the heap
+*
+* INPUTS:
+*   timer_cb == timer to remove
+*********************************************************************/
+static void
+    heap_remove (agt_timer_cb_t *timer_cb)
+{
+    uint32  idx;
+
+    idx = timer_cb->timer_heapidx;
+    if (idx == AGT_TIMER_NO_HEAPIDX) {
+        return;
+    }
+    timer_cb->timer_heapidx = AGT_TIMER_NO_HEAPIDX;
+
+    if (idx == --timer_heap_len) {
+        return;
+    }
+
+    /* fill the hole with the last timer and restore the heap */
+    heap_set(idx, timer_heap[timer_heap_len]);
+    if (idx > 0 && 
+        timer_heap[(idx - 1) / 2]->timer_deadline > 
+        timer_heap[idx]->timer_deadline) {
+        heap_sift_up(idx);
+    } else {
+        heap_sift_down(idx);
+    }
+
+} /* heap_remove */
+
+
+/********************************************************************
+* FUNCTION start_timer
+*
+* Set the deadline of a timer and put it in the heap
+*
+* INPUTS:
+*   timer_cb == timer to start
+*   msec == number of milliseconds until the timer expires
+*
+* RETURNS:
+*   status
+*********************************************************************/
+static status_t
+    start_timer (agt_timer_cb_t *timer_cb,
+                 uint32 msec)
+{
+    heap_remove(timer_cb);
+
+    timer_cb->timer_interval = msec;
+    timer_cb->timer_deadline = get_msec_now() + msec;
+
+    /* keep the old 1 second resolution fields up to date */
+    (void)uptime(&timer_cb->timer_start_time);
+    timer_cb->timer_duration = (msec + 999) / 1000;
+
+    return heap_insert(timer_cb);
+
+} /* start_timer */
+
+
+/********************************************************************
+* FUNCTION find_timer_cb
+*
+* Find a timer control block
+*
+* INPUTS:
+*   timer_id == timer ID to find
+* RETURNS:
+*   pointer to the timer or NULL if not found
 *********************************************************************/
 static agt_timer_cb_t *
     find_timer_cb (uint32 timer_id)
@@ -83,7 +313,7 @@ static agt_timer_cb_t *
     agt_timer_cb_t *timer_cb;
 
     for (timer_cb = (agt_timer_cb_t *)
-             dlq_firstEntry(&timer_cbQ);
+             dlq_firstEntry(&timer_cbQ[timer_id % AGT_TIMER_BUCKETS]);
          timer_cb != NULL;
          timer_cb = (agt_timer_cb_t *)
              dlq_nextEntry(timer_cb)) {
@@ -116,7 +346,7 @@ static uint32
         return next_id++;
     }
 
-    if (dlq_empty(&timer_cbQ)) {
+    if (timer_count == 0) {
         next_id = 1;
         return next_id++;
     }
@@ -154,6 +384,7 @@ static agt_timer_cb_t *
         return NULL;
     }
     memset(timer_cb, 0x0, sizeof(agt_timer_cb_t));
+    timer_cb->timer_heapidx = AGT_TIMER_NO_HEAPIDX;
     return timer_cb;
 
 } /* new_timer_cb */
@@ -177,6 +408,26 @@ static void
 } /* free_timer_cb */
 
 
+/********************************************************************
+* FUNCTION remove_timer_cb
+*
+* Remove a timer from the heap and the ID hash and free it
+*
+* INPUTS:
+*   timer_cb == control block to remove
+*
+*********************************************************************/
+static void
+    remove_timer_cb (agt_timer_cb_t *timer_cb)
+{
+    heap_remove(timer_cb);
+    dlq_remove(timer_cb);
+    timer_count--;
+    free_timer_cb(timer_cb);
+
+} /* remove_timer_cb */
+
+
 /********************************************************************
 * FUNCTION agt_timer_init
 *
@@ -190,10 +441,18 @@ static void
 void
     agt_timer_init (void)
 {
+    uint32  i;
+
     if (!agt_timer_init_done) {
-        dlq_createSQue(&timer_cbQ);
+        for (i = 0; i < AGT_TIMER_BUCKETS; i++) {
+            dlq_createSQue(&timer_cbQ[i]);
+        }
+        timer_count = 0;
         next_id = 1;
-        skip_count = 0;
+        timer_heap = NULL;
+        timer_heap_len = 0;
+        timer_heap_max = 0;
+        running_timer_cb = NULL;
         agt_timer_init_done = TRUE;
     }
 
@@ -210,12 +469,22 @@ void
     agt_timer_cleanup (void)
 {
     agt_timer_cb_t *timer_cb;
+    uint32          i;
 
     if (agt_timer_init_done) {
-        while (!dlq_empty(&timer_cbQ)) {
-            timer_cb = (agt_timer_cb_t *)dlq_deque(&timer_cbQ);
-            free_timer_cb(timer_cb);
+        for (i = 0; i < AGT_TIMER_BUCKETS; i++) {
+            while (!dlq_empty(&timer_cbQ[i])) {
+                timer_cb = (agt_timer_cb_t *)dlq_deque(&timer_cbQ[i]);
+                free_timer_cb(timer_cb);
+            }
+        }
+        if (timer_heap) {
+            m__free(timer_heap);
+            timer_heap = NULL;
         }
+        timer_heap_len = 0;
+        timer_heap_max = 0;
+        timer_count = 0;
         agt_timer_init_done = FALSE;
     }
 
@@ -228,46 +497,67 @@ void
 * Handle an incoming agent timer polling interval
 * main routine called by agt_signal_handler
 *
+* Run the callbacks of all the timers that have expired.
+* This can be called as often as needed; see
+* agt_timer_get_timeout for the time of the next call
+*
 *********************************************************************/
 void 
     agt_timer_handler (void)
 {
-    agt_timer_cb_t  *timer_cb, *next_timer_cb;
-    time_t           timenow;
-    double           timediff;
+    agt_timer_cb_t  *timer_cb;
+    uint64           msecnow;
     int              retval;
 
-    if (skip_count < AGT_TIMER_SKIP_COUNT) {
-        skip_count++;
+    if (!agt_timer_init_done) {
         return;
-    } else {
-        skip_count = 0;
     }
 
-    (void)uptime(&timenow);
+    /* timers restarted by a callback are not run again
+     * until the next call, even if they are already due
+     */
+    msecnow = get_msec_now();
 
-    for (timer_cb = (agt_timer_cb_t *)dlq_firstEntry(&timer_cbQ);
-         timer_cb != NULL;
-         timer_cb = next_timer_cb) {
+    while (timer_heap_len > 0 &&
+           timer_heap[0]->timer_deadline <= msecnow) {
 
-        next_timer_cb = (agt_timer_cb_t *)dlq_nextEntry(timer_cb);
+        timer_cb = timer_heap[0];
+        heap_remove(timer_cb);
 
-        timediff = difftime(timenow, timer_cb->timer_start_time);
-        if (timediff >= (double)timer_cb->timer_duration) {
-            if (LOGDEBUG3) {
-                log_debug3("\nagt_timer: timer %u popped",
-                           timer_cb->timer_id);
-            }
+        if (LOGDEBUG3) {
+            log_debug3("\nagt_timer: timer %u popped",
+                       timer_cb->timer_id);
+        }
 
-            retval = (*timer_cb->timer_cbfn)(timer_cb->timer_id,
-                                             timer_cb->timer_cookie);
-            if (retval != 0 || !timer_cb->timer_periodic) {
-                /* destroy this timer */
-                dlq_remove(timer_cb);
-                free_timer_cb(timer_cb);
-            } else {
-                /* reset this periodic timer */
-                (void)uptime(&timer_cb->timer_start_time);
+        running_timer_cb = timer_cb;
+        retval = (*timer_cb->timer_cbfn)(timer_cb->timer_id,
+                                         timer_cb->timer_cookie);
+        running_timer_cb = NULL;
+
+        if (timer_cb->timer_deleted || retval != 0) {
+            /* destroy this timer */
+            remove_timer_cb(timer_cb);
+        } else if (timer_cb->timer_heapidx != AGT_TIMER_NO_HEAPIDX) {
+            /* restarted by the callback */
+            ;
+        } else if (!timer_cb->timer_periodic) {
+            /* 1-shot timer is done */
+            remove_timer_cb(timer_cb);
+        } else {
+            /* reset this periodic timer; keep the period
+             * unless the callbacks are running late
+             */
+            timer_cb->timer_deadline += timer_cb->timer_interval;
+            if (timer_cb->timer_deadline <= msecnow) {
+                timer_cb->timer_deadline = 
+                    msecnow + timer_cb->timer_interval;
+            }
+            (void)uptime(&timer_cb->timer_start_time);
+            if (heap_insert(timer_cb) != NO_ERR) {
+                log_error("\nError: agt_timer: no memory to restart "
+                          "timer %u",
+                          timer_cb->timer_id);
+                remove_timer_cb(timer_cb);
             }
         }
     }
@@ -275,6 +565,39 @@ void
 } /* agt_timer_handler */
 
 
+/********************************************************************
+* FUNCTION agt_timer_get_timeout
+*
+* Get the time until the next timer expires
+* Used by the server IO loop to set its wait timeout
+*
+* RETURNS:
+*   number of milliseconds until agt_timer_handler needs
+*   to be called; 0 if a timer has already expired
+*   -1 if there are no timers
+*********************************************************************/
+int32
+    agt_timer_get_timeout (void)
+{
+    uint64  msecnow, deadline;
+
+    if (!agt_timer_init_done || timer_heap_len == 0) {
+        return -1;
+    }
+
+    msecnow = get_msec_now();
+    deadline = timer_heap[0]->timer_deadline;
+    if (deadline <= msecnow) {
+        return 0;
+    }
+    if (deadline - msecnow > NCX_MAX_INT) {
+        return NCX_MAX_INT;
+    }
+    return (int32)(deadline - msecnow);
+
+} /* agt_timer_get_timeout */
+
+
 /********************************************************************
 * FUNCTION agt_timer_create
 *
@@ -302,15 +625,64 @@ status_t
                       agt_timer_fn_t  timer_fn,
                       void *cookie,
                       uint32 *ret_timer_id)
+{
+#ifdef DEBUG
+    if (seconds == 0) {
+        return SET_ERROR(ERR_INTERNAL_VAL);
+    }
+#endif
+
+    if (seconds > NCX_MAX_UINT / 1000) {
+        seconds = NCX_MAX_UINT / 1000;
+    }
+
+    return agt_timer_create_ms(seconds * 1000,
+                               is_periodic,
+                               timer_fn,
+                               cookie,
+                               ret_timer_id);
+
+} /* agt_timer_create */
+
+
+/********************************************************************
+* FUNCTION agt_timer_create_ms
+*
+* Malloc and start a new timer control block
+* with a timeout in milliseconds
+*
+* INPUTS:
+*   msec == number of milliseconds to wait between polls
+*   is_periodic == TRUE if periodic timer
+*                  FALSE if a 1-event timer
+*   timer_fn == address of callback function to invoke when
+*               the timer poll event occurs
+*   cookie == address of user cookie to pass to the timer_fn
+*   ret_timer_id == address of return timer ID
+*
+* OUTPUTS:
+*  *ret_timer_id == timer ID for the allocated timer, 
+*    if the return value is NO_ERR
+*
+* RETURNS:
+*   status
+*********************************************************************/
+status_t
+    agt_timer_create_ms (uint32 msec,
+                         boolean is_periodic,
+                         agt_timer_fn_t  timer_fn,
+                         void *cookie,
+                         uint32 *ret_timer_id)
 {
     agt_timer_cb_t *timer_cb;
     uint32          timer_id;
+    status_t        res;
 
 #ifdef DEBUG
     if (timer_fn == NULL || ret_timer_id == NULL) {
         return SET_ERROR(ERR_INTERNAL_PTR);
     }
-    if (seconds == 0) {
+    if (msec == 0) {
         return SET_ERROR(ERR_INTERNAL_VAL);
     }
 #endif
@@ -326,18 +698,23 @@ status_t
         return ERR_INTERNAL_MEM;
     }
 
-    *ret_timer_id = timer_id;
     timer_cb->timer_id = timer_id;
     timer_cb->timer_periodic = is_periodic;
     timer_cb->timer_cbfn = timer_fn;
-    (void)uptime(&timer_cb->timer_start_time);
-    timer_cb->timer_duration = seconds;
     timer_cb->timer_cookie = cookie;
 
-    dlq_enque(timer_cb, &timer_cbQ);
+    res = start_timer(timer_cb, msec);
+    if (res != NO_ERR) {
+        free_timer_cb(timer_cb);
+        return res;
+    }
+
+    dlq_enque(timer_cb, &timer_cbQ[timer_id % AGT_TIMER_BUCKETS]);
+    timer_count++;
+    *ret_timer_id = timer_id;
     return NO_ERR;
 
-} /* agt_timer_create */
+} /* agt_timer_create_ms */
 
 
 /********************************************************************
@@ -358,25 +735,60 @@ status_t
 status_t
     agt_timer_restart (uint32 timer_id,
                        uint32 seconds)
+{
+#ifdef DEBUG
+    if (seconds == 0) {
+        return SET_ERROR(ERR_INTERNAL_VAL);
+    }
+#endif
+
+    if (seconds > NCX_MAX_UINT / 1000) {
+        seconds = NCX_MAX_UINT / 1000;
+    }
+
+    return agt_timer_restart_ms(timer_id, seconds * 1000);
+
+} /* agt_timer_restart */
+
+
+/********************************************************************
+* FUNCTION agt_timer_restart_ms
+*
+* Restart a timer with a new timeout value in milliseconds
+* If this is a periodic timer, then the interval
+* will be changed to the new value.  Otherwise
+* a 1-shot timer will just be reset to the new value
+*
+* A 1-shot timer restarted from its own callback
+* is not deleted when the callback returns
+*
+* INPUTS:
+*   timer_id == timer ID to reset
+*   msec == new timeout value
+*
+* RETURNS:
+*   status, NO_ERR if all okay,
+*********************************************************************/
+status_t
+    agt_timer_restart_ms (uint32 timer_id,
+                          uint32 msec)
 {
     agt_timer_cb_t *timer_cb;
 
 #ifdef DEBUG
-    if (seconds == 0) {
+    if (msec == 0) {
         return SET_ERROR(ERR_INTERNAL_VAL);
     }
 #endif
 
     timer_cb = find_timer_cb(timer_id);
-    if (timer_cb == NULL) {
+    if (timer_cb == NULL || timer_cb->timer_deleted) {
         return ERR_NCX_NOT_FOUND;
     }
 
-    (void)uptime(&timer_cb->timer_start_time);
-    timer_cb->timer_duration = seconds;
-    return NO_ERR;
+    return start_timer(timer_cb, msec);
 
-} /* agt_timer_restart */
+} /* agt_timer_restart_ms */
 
 
 /********************************************************************
@@ -397,18 +809,22 @@ void
     agt_timer_cb_t *timer_cb;
 
     timer_cb = find_timer_cb(timer_id);
-    if (timer_cb == NULL) {
+    if (timer_cb == NULL || timer_cb->timer_deleted) {
         log_warn("\nagt_timer: delete unknown timer '%u'",
                  timer_id);
         return;
     }
 
-    dlq_remove(timer_cb);
-    free_timer_cb(timer_cb);
+    if (timer_cb == running_timer_cb) {
+        /* freed by agt_timer_handler when the callback returns */
+        heap_remove(timer_cb);
+        timer_cb->timer_deleted = TRUE;
+        return;
+    }
+
+    remove_timer_cb(timer_cb);
 
 } /* agt_timer_delete */
 
 
 /* END file agt_timer.c */
-
-
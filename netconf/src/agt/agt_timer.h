@@ -20,6 +20,12 @@
 
     Handle timer services for the server
 
+    Timers have millisecond resolution on the monotonic clock.
+    The active timers are kept in a binary min-heap ordered by
+    deadline, so starting and deleting a timer is O(log n).
+    The server IO loop waits at most agt_timer_get_timeout()
+    milliseconds and then calls agt_timer_handler().
+
 
 *********************************************************************
 *								    *
@@ -79,6 +85,10 @@ typedef struct agt_timer_cb_t_ {
     time_t          timer_start_time;
     uint32          timer_duration;   /* seconds */
     void           *timer_cookie;
+    uint32          timer_interval;   /* milliseconds */
+    uint64          timer_deadline;   /* monotonic milliseconds */
+    uint32          timer_heapidx;
+    boolean         timer_deleted;
 } agt_timer_cb_t;
 
 
@@ -119,11 +129,30 @@ extern void
 * Handle an incoming server timer polling interval
 * main routine called by agt_signal_handler
 *
+* Run the callbacks of all the timers that have expired.
+* This can be called as often as needed; see
+* agt_timer_get_timeout for the time of the next call
+*
 *********************************************************************/
 extern void
     agt_timer_handler (void);
 
 
+/********************************************************************
+* FUNCTION agt_timer_get_timeout
+*
+* Get the time until the next timer expires
+* Used by the server IO loop to set its wait timeout
+*
+* RETURNS:
+*   number of milliseconds until agt_timer_handler needs
+*   to be called; 0 if a timer has already expired
+*   -1 if there are no timers
+*********************************************************************/
+extern int32
+    agt_timer_get_timeout (void);
+
+
 /********************************************************************
 * FUNCTION agt_timer_create
 *
@@ -153,6 +182,36 @@ extern status_t
                       uint32 *ret_timer_id);
 
 
+/********************************************************************
+* FUNCTION agt_timer_create_ms
+*
+* Malloc and start a new timer control block
+* with a timeout in milliseconds
+*
+* INPUTS:
+*   msec == number of milliseconds to wait between polls
+*   is_periodic == TRUE if periodic timer
+*                  FALSE if a 1-event timer
+*   timer_fn == address of callback function to invoke when
+*               the timer poll event occurs
+*   cookie == address of user cookie to pass to the timer_fn
+*   ret_timer_id == address of return timer ID
+*
+* OUTPUTS:
+*  *ret_timer_id == timer ID for the allocated timer, 
+*    if the return value is NO_ERR
+*
+* RETURNS:
+*   status
+*********************************************************************/
+extern status_t
+    agt_timer_create_ms (uint32 msec,
+                         boolean is_periodic,
+                         agt_timer_fn_t  timer_fn,
+                         void *cookie,
+                         uint32 *ret_timer_id);
+
+
 /********************************************************************
 * FUNCTION agt_timer_restart
 *
@@ -173,6 +232,29 @@ extern status_t
                        uint32 seconds);
 
 
+/********************************************************************
+* FUNCTION agt_timer_restart_ms
+*
+* Restart a timer with a new timeout value in milliseconds
+* If this is a periodic timer, then the interval
+* will be changed to the new value.  Otherwise
+* a 1-shot timer will just be reset to the new value
+*
+* A 1-shot timer restarted from its own callback
+* is not deleted when the callback returns
+*
+* INPUTS:
+*   timer_id == timer ID to reset
+*   msec == new timeout value
+*
+* RETURNS:
+*   status, NO_ERR if all okay,
+*********************************************************************/
+extern status_t
+    agt_timer_restart_ms (uint32 timer_id,
+                          uint32 msec);
+
+
 /********************************************************************
 * FUNCTION agt_timer_delete
 *
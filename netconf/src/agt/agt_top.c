@@ -178,8 +178,12 @@ void
         *ppscb=NULL;
 
     } else if (profile->agt_stream_output &&
-               scb->state == SES_ST_SHUTDOWN_REQ) {
-        /* session was closed */
+               scb->state == SES_ST_SHUTDOWN_REQ &&
+               dlq_empty(&scb->outQ)) {
+        /* session was closed; if the client was not ready for
+         * all of the reply, the session is killed once the
+         * rest of the reply is sent from the outQ
+         */
         agt_ses_kill_session(scb,
                              scb->killedbysid,
                              scb->termreason);
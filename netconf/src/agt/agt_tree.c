@@ -57,6 +57,13 @@
            filter value node, and output the cached node
            instances from the target, if the node is not
            marked as deleted
+
+   If the session is streaming its output (--stream-output),
+   agt_tree_stream_filter does steps 2 and 3 in a single walk
+   instead: no ncx_filptr_t tree is built, each selected node
+   is written as soon as it is found, and each virtual node is
+   freed again after its subtree has been done.  The reply is
+   never held in memory, only the path to the current node.
            
    
 *********************************************************************
@@ -116,6 +123,27 @@ date         init     comment
 *********************************************************************/
 
 
+/********************************************************************
+*                                                                   *
+*                             T Y P E S                             *
+*                                                                   *
+*********************************************************************/
+
+/* 1 level of the target value tree in a streamed filter walk
+ * The start tag is not written until a node below it is
+ * selected, so no empty ancestors are output
+ */
+typedef struct tree_frame_t_ {
+    struct tree_frame_t_ *parent;      /* NULL for the config root */
+    val_value_t          *val;
+    int32                 indent;      /* start tag indent */
+    int32                 childindent;
+    boolean               written;     /* start tag written */
+    boolean               denied;      /* read access denied */
+    ncx_filptr_t          keys;        /* selected key leafs */
+} tree_frame_t;
+
+
 /********************************************************************
 *                                                                   *
 *                       V A R I A B L E S                            *
@@ -858,6 +886,442 @@ static void
 }  /* dump_filptr_node */
 
 
+/********************************************************************
+* FUNCTION check_filter_nsids
+*
+* Fix the namespace IDs of all the nodes in a subtree filter
+* before a streamed walk, the same way process_val does
+* for each level; the walk writes output as it goes, so
+* any error has to be found before it starts
+*
+* INPUTS:
+*    scb == session control block
+*    filval == filter node to check
+*
+* RETURNS:
+*     status
+*********************************************************************/
+static status_t
+    check_filter_nsids (ses_cb_t *scb,
+                        val_value_t *filval)
+{
+    val_value_t      *filchild;
+    xmlns_id_t        ncid, wildid;
+    status_t          res;
+
+    ncid = xmlns_nc_id();
+    wildid = xmlns_wildcard_id();
+
+    for (filchild = val_get_first_child(filval);
+         filchild != NULL;
+         filchild = val_get_next_child(filchild)) {
+
+        if (filchild->nsid == ncid) {
+            filchild->nsid = 0;
+        }
+
+        if (filchild->nsid == wildid) {
+            if (ses_get_protocol(scb) == NCX_PROTO_NETCONF11) {
+                filchild->nsid = 0;
+            } else {
+                return ERR_NCX_PROTO11_NOT_ENABLED;
+            }
+        }
+
+        if (filchild->btyp == NCX_BT_CONTAINER) {
+            res = check_filter_nsids(scb, filchild);
+            if (res != NO_ERR) {
+                return res;
+            }
+        }
+    }
+
+    return NO_ERR;
+
+} /* check_filter_nsids */
+
+
+/********************************************************************
+* FUNCTION init_frame
+*
+* Initialize a streamed walk frame for a value node
+*
+* INPUTS:
+*    scb == session control block
+*    frame == frame to initialize
+*    parent == parent frame; NULL for the config root
+*    val == value node for this level
+*    indent == start tag indent amount
+*
+*********************************************************************/
+static void
+    init_frame (ses_cb_t *scb,
+                tree_frame_t *frame,
+                tree_frame_t *parent,
+                val_value_t *val,
+                int32 indent)
+{
+    memset(frame, 0x0, sizeof(tree_frame_t));
+    frame->parent = parent;
+    frame->val = val;
+    frame->indent = indent;
+    dlq_createSQue(&frame->keys.childQ);
+
+    if (parent == NULL) {
+        /* the config root itself is never written */
+        frame->written = TRUE;
+        frame->childindent = indent;
+    } else if (indent >= 0) {
+        frame->childindent = indent + ses_indent_count(scb);
+    } else {
+        frame->childindent = indent;
+    }
+
+}  /* init_frame */
+
+
+/********************************************************************
+* FUNCTION clean_frame
+*
+* Free the key records in a streamed walk frame
+*
+* INPUTS:
+*    frame == frame to clean
+*
+*********************************************************************/
+static void
+    clean_frame (tree_frame_t *frame)
+{
+    ncx_filptr_t  *filptr;
+
+    while (!dlq_empty(&frame->keys.childQ)) {
+        filptr = (ncx_filptr_t *)dlq_deque(&frame->keys.childQ);
+        ncx_free_filptr(filptr);
+    }
+
+}  /* clean_frame */
+
+
+/********************************************************************
+* FUNCTION open_frame
+*
+* Write the start tags of a frame and all its ancestors
+* that have not been written yet, checking access control
+* the same way output_node does
+*
+* INPUTS:
+*    scb == session control block
+*    msg == rpc_msg_t in progress
+*    frame == frame to open
+*
+*********************************************************************/
+static void
+    open_frame (ses_cb_t *scb,
+                rpc_msg_t *msg,
+                tree_frame_t *frame)
+{
+    val_value_t   *val;
+    xmlns_id_t     parentnsid;
+
+    if (frame->written || frame->denied) {
+        return;
+    }
+
+    open_frame(scb, msg, frame->parent);
+    if (frame->parent->denied ||
+        !agt_acm_val_read_allowed(&msg->mhdr, scb->username, frame->val)) {
+        frame->denied = TRUE;
+        return;
+    }
+
+    val = frame->val;
+    if (val->parent) {
+        parentnsid = obj_get_nsid(val->parent->obj);
+    } else {
+        parentnsid = 0;
+    }
+
+    xml_wr_begin_elem_ex(scb, 
+                         &msg->mhdr,
+                         parentnsid,
+                         obj_get_nsid(val->obj),
+                         val->name, 
+                         &val->metaQ, 
+                         FALSE, 
+                         frame->indent, 
+                         FALSE);
+    frame->written = TRUE;
+
+}  /* open_frame */
+
+
+/********************************************************************
+* FUNCTION select_node
+*
+* Output a selected node and its entire subtree
+*
+* INPUTS:
+*    scb == session control block
+*    msg == rpc_msg_t in progress
+*    frame == frame for the parent of the selected node
+*    val == selected node
+*    getop == TRUE if <get>, FALSE if <get-config>
+*
+* RETURNS:
+*    status, NO_ERR or malloc error
+*********************************************************************/
+static status_t
+    select_node (ses_cb_t *scb,
+                 rpc_msg_t *msg,
+                 tree_frame_t *frame,
+                 val_value_t *val,
+                 boolean getop)
+{
+    open_frame(scb, msg, frame);
+    if (frame->denied) {
+        return NO_ERR;
+    }
+
+    /* remember the list keys so they are not written twice */
+    if (val->index && frame->val->btyp == NCX_BT_LIST) {
+        if (!save_filptr(&frame->keys, val)) {
+            return ERR_INTERNAL_MEM;
+        }
+    }
+
+    xml_wr_full_check_val(scb, 
+                          &msg->mhdr, 
+                          val, 
+                          frame->childindent,
+                          (getop) ? agt_check_default : agt_check_config);
+    return NO_ERR;
+
+}  /* select_node */
+
+
+/********************************************************************
+* FUNCTION close_frame
+*
+* Finish a frame if its start tag was written: add any
+* list keys that were not selected and write the end tag
+*
+* INPUTS:
+*    scb == session control block
+*    msg == rpc_msg_t in progress
+*    frame == frame to close
+*    getop == TRUE if <get>, FALSE if <get-config>
+*
+*********************************************************************/
+static void
+    close_frame (ses_cb_t *scb,
+                 rpc_msg_t *msg,
+                 tree_frame_t *frame,
+                 boolean getop)
+{
+    val_index_t   *valindex;
+
+    if (!frame->written || frame->parent == NULL) {
+        return;
+    }
+
+    if (frame->val->btyp == NCX_BT_LIST) {
+        for (valindex = val_get_first_index(frame->val);
+             valindex != NULL;
+             valindex = val_get_next_index(valindex)) {
+            if (!find_filptr(&frame->keys, valindex->val)) {
+                xml_wr_full_check_val(scb, 
+                                      &msg->mhdr, 
+                                      valindex->val, 
+                                      frame->childindent,
+                                      (getop) ? agt_check_default : 
+                                      agt_check_config);
+            }
+        }
+    }
+
+    xml_wr_end_elem(scb, 
+                    &msg->mhdr, 
+                    obj_get_nsid(frame->val->obj),
+                    frame->val->name, 
+                    frame->indent);
+
+}  /* close_frame */
+
+
+/********************************************************************
+* FUNCTION stream_val
+*
+* Streamed version of process_val and output_node for <get>
+* and <get-config>: the filter is evaluated while the target
+* is walked and each selected node is written right away.
+* A virtual node is only retrieved when the walk reaches it,
+* and is freed again as soon as its subtree is done.
+*
+* The nodes are selected in the same order as process_val
+* saves them, so the output is the same as
+* agt_tree_prune_filter + agt_tree_output_filter
+*
+* INPUTS:
+*    scb == session control block
+*    msg == rpc_msg_t in progress
+*    getop == TRUE if <get>, FALSE if <get-config>
+*    filval == filter node
+*    frame == frame for the target node at the same level
+*    keepempty == address of return keepempty flag
+*
+* OUTPUTS:
+*    *keepempty is set to TRUE if all the descendants of
+*      the target node are selected; nothing was written
+*
+* RETURNS:
+*     status, NO_ERR or malloc error
+*********************************************************************/
+static status_t
+    stream_val (ses_cb_t *scb,
+                rpc_msg_t *msg,
+                boolean getop,
+                val_value_t *filval,
+                tree_frame_t *frame,
+                boolean *keepempty)
+{
+    val_value_t      *filchild, *curchild, *useval;
+    tree_frame_t      childframe;
+    boolean           test, anycon, anysel, mykeepempty;
+    status_t          res;
+
+    res = NO_ERR;
+    *keepempty = FALSE;
+    anycon = FALSE;
+    anysel = FALSE;
+
+    /* check if this is a real or a virtual value */
+    if (val_is_virtual(frame->val)) {
+        useval = val_get_virtual_value(scb, frame->val, &res);
+        if (useval == NULL) {
+            return res;
+        }
+    } else {
+        useval = frame->val;
+    }
+
+    /* check any content match nodes first
+     * they must all be true or this entire sibling
+     * set is rejected
+     */
+    for (filchild = val_get_first_child(filval);
+         filchild != NULL;
+         filchild = val_get_next_child(filchild)) {
+
+        switch (filchild->btyp) {
+        case NCX_BT_STRING:
+            break;
+        case NCX_BT_EMPTY:
+            anysel = TRUE;
+            continue;
+        case NCX_BT_CONTAINER:
+            anycon = TRUE;
+            continue;
+        default:
+            return SET_ERROR(ERR_INTERNAL_VAL);
+        }
+
+        if (val_all_whitespace(VAL_STR(filchild))) {
+            return SET_ERROR(ERR_INTERNAL_VAL);
+        }
+
+        test = FALSE;
+        for (curchild = val_first_child_qname(useval, 
+                                              filchild->nsid,
+                                              filchild->name);
+             curchild != NULL && !test;
+             curchild = val_next_child_qname(useval,
+                                             filchild->nsid,
+                                             filchild->name,
+                                             curchild)) {
+            test = content_match_test(scb, VAL_STR(filchild), curchild);
+        }
+
+        if (!test) {
+            return NO_ERR;
+        }
+    }
+
+    if (!anycon && !anysel) {
+        *keepempty = TRUE;
+        return NO_ERR;
+    }
+
+    /* select the nodes and write them in the same order
+     * as process_val would save them
+     */
+    for (filchild = val_get_first_child(filval);
+         filchild != NULL && res == NO_ERR;
+         filchild = val_get_next_child(filchild)) {
+
+        if (!getop && !agt_check_config(ses_withdef(scb), 
+                                        TRUE,
+                                        filchild)) {
+            continue;
+        }
+
+        for (curchild = val_first_child_qname(useval, 
+                                              filchild->nsid,
+                                              filchild->name);
+             curchild != NULL && res == NO_ERR;
+             curchild = val_next_child_qname(useval,
+                                             filchild->nsid,
+                                             filchild->name,
+                                             curchild)) {
+
+            if (!attr_test(filchild, curchild)) {
+                continue;
+            }
+
+            switch (filchild->btyp) {
+            case NCX_BT_STRING:
+                if (!content_match_test(scb, 
+                                        VAL_STR(filchild), 
+                                        curchild)) {
+                    break;
+                } /* else fall through and select node */
+            case NCX_BT_EMPTY:
+                res = select_node(scb, msg, frame, curchild, getop);
+                break;
+            case NCX_BT_CONTAINER:
+                if (!typ_has_children(curchild->btyp)) {
+                    break;
+                }
+
+                init_frame(scb, &childframe, frame, curchild, 
+                           frame->childindent);
+                res = stream_val(scb, 
+                                 msg, 
+                                 getop, 
+                                 filchild, 
+                                 &childframe, 
+                                 &mykeepempty);
+                if (res == NO_ERR && mykeepempty) {
+                    res = select_node(scb, msg, frame, curchild, getop);
+                } else {
+                    close_frame(scb, msg, &childframe, getop);
+                }
+                clean_frame(&childframe);
+
+                if (val_is_virtual(curchild)) {
+                    val_clear_virtual_value(curchild);
+                }
+                break;
+            default:
+                res = SET_ERROR(ERR_INTERNAL_VAL);
+            }
+        }
+    }
+
+    return res;
+
+} /* stream_val */
+
+
 /************  E X T E R N A L    F U N C T I O N S    **************/
 
 
@@ -1018,6 +1482,78 @@ void
 } /* agt_tree_output_filter */
 
 
+/********************************************************************
+* FUNCTION agt_tree_stream_filter
+*
+* get and get-config steps 1 and 2 for a streaming session
+* Evaluate the subtree filter while walking the target and
+* write each selected node to the session right away.
+* Virtual nodes are retrieved one at a time and freed after
+* they are written, so the reply is never built in memory
+*
+* INPUTS:
+*    scb == session control block
+*    msg == rpc_msg_t in progress
+*    cfg == config target to check against
+*    indent == start indent amount
+*    getop  == TRUE if this is a <get> and not a <get-config>
+*
+* RETURNS:
+*    none
+*********************************************************************/
+void
+    agt_tree_stream_filter (ses_cb_t *scb,
+                            rpc_msg_t *msg,
+                            const cfg_template_t *cfg,
+                            int32 indent,
+                            boolean getop)
+{
+    val_value_t       *filter;
+    tree_frame_t       top;
+    status_t           res;
+    boolean            keepempty;
+
+#ifdef DEBUG
+    if (!scb || !msg || !cfg || !msg->rpc_filter.op_filter) {
+        SET_ERROR(ERR_INTERNAL_PTR);
+        return;
+    }
+#endif
+
+    if (!cfg->root) {
+        return;
+    }
+
+    filter = msg->rpc_filter.op_filter;
+
+    switch (filter->btyp) {
+    case NCX_BT_EMPTY:
+    case NCX_BT_STRING:
+        /* the result is the empty set; see agt_tree_prune_filter */
+        break;
+    case NCX_BT_CONTAINER:
+        res = check_filter_nsids(scb, filter);
+        if (res != NO_ERR) {
+            break;
+        }
+
+        init_frame(scb, &top, NULL, cfg->root, indent);
+        msg->mhdr.free_virtual = TRUE;
+        res = stream_val(scb, msg, getop, filter, &top, &keepempty);
+        msg->mhdr.free_virtual = FALSE;
+        if (res != NO_ERR) {
+            log_error("\nError: subtree filter output failed (%s)",
+                      get_error_string(res));
+        }
+        clean_frame(&top);
+        break;
+    default:
+        SET_ERROR(ERR_INTERNAL_VAL);
+    }
+
+} /* agt_tree_stream_filter */
+
+
 /********************************************************************
 * FUNCTION agt_tree_test_filter
 *
@@ -131,6 +131,33 @@ extern void
 			    boolean getop);
 
 
+/********************************************************************
+* FUNCTION agt_tree_stream_filter
+*
+* get and get-config steps 1 and 2 for a streaming session
+* Evaluate the subtree filter while walking the target and
+* write each selected node to the session right away.
+* Virtual nodes are retrieved one at a time and freed after
+* they are written, so the reply is never built in memory
+*
+* INPUTS:
+*    scb == session control block
+*    msg == rpc_msg_t in progress
+*    cfg == config target to check against
+*    indent == start indent amount
+*    getop  == TRUE if this is a <get> and not a <get-config>
+*
+* RETURNS:
+*    none
+*********************************************************************/
+extern void
+    agt_tree_stream_filter (ses_cb_t *scb,
+			    rpc_msg_t *msg,
+			    const cfg_template_t *cfg,
+			    int32 indent,
+			    boolean getop);
+
+
 /********************************************************************
 * FUNCTION agt_tree_test_filter
 *
@@ -1438,6 +1438,8 @@ status_t
 
     switch (msg->rpc_filter.op_filtyp) {
     case OP_FILTER_NONE:
+        /* each virtual value is freed after it is streamed */
+        msg->mhdr.free_virtual = scb->stream_output;
         switch (msg->mhdr.withdef) {
         case NCX_WITHDEF_REPORT_ALL:
         case NCX_WITHDEF_REPORT_ALL_TAGGED:
@@ -1468,9 +1470,12 @@ status_t
         default:
             SET_ERROR(ERR_INTERNAL_VAL);
         }
+        msg->mhdr.free_virtual = FALSE;
         break;
     case OP_FILTER_SUBTREE:
-        if (source->root) {
+        if (source->root && scb->stream_output) {
+            agt_tree_stream_filter(scb, msg, source, indent, getop);
+        } else if (source->root) {
             top = agt_tree_prune_filter(scb, msg, source, getop);
             if (top) {
                 agt_tree_output_filter(scb, msg, top, indent, getop);
@@ -3373,4 +3378,92 @@ boolean
 } /* agt_apply_this_node */
 
 
+/********************************************************************
+* FUNCTION agt_read_proc_file
+*
+* Read an entire file into a malloced buffer
+* Files in /proc report a zero size, so the buffer
+* is grown until the end of file is reached
+*
+* INPUTS:
+*   filespec == file to read
+*   len == address of return length
+*   res == address of return status
+*
+* OUTPUTS:
+*   *len == number of bytes read, not including the zero byte
+*   *res == return status
+*
+* RETURNS:
+*   malloced zero-terminated buffer; must be freed by the caller
+*   NULL if some error
+*********************************************************************/
+xmlChar *
+    agt_read_proc_file (const char *filespec,
+                        uint32 *len,
+                        status_t *res)
+{
+    FILE      *fil;
+    xmlChar   *buffer, *newbuffer;
+    size_t     buffsize, bufflen;
+
+#ifdef DEBUG
+    if (!filespec || !len || !res) {
+        SET_ERROR(ERR_INTERNAL_PTR);
+        return NULL;
+    }
+#endif
+
+    *len = 0;
+    *res = NO_ERR;
+
+    fil = fopen(filespec, "r");
+    if (fil == NULL) {
+        *res = errno_to_status();
+        return NULL;
+    }
+
+    buffsize = NCX_MAX_LINELEN;
+    bufflen = 0;
+    buffer = m__getMem(buffsize + 1);
+    if (buffer == NULL) {
+        fclose(fil);
+        *res = ERR_INTERNAL_MEM;
+        return NULL;
+    }
+
+    for (;;) {
+        bufflen += fread(&buffer[bufflen], 1, buffsize - bufflen, fil);
+        if (bufflen < buffsize) {
+            break;
+        }
+
+        buffsize *= 2;
+        newbuffer = m__getMem(buffsize + 1);
+        if (newbuffer == NULL) {
+            m__free(buffer);
+            fclose(fil);
+            *res = ERR_INTERNAL_MEM;
+            return NULL;
+        }
+        memcpy(newbuffer, buffer, bufflen);
+        m__free(buffer);
+        buffer = newbuffer;
+    }
+
+    if (ferror(fil)) {
+        *res = errno_to_status();
+        m__free(buffer);
+        fclose(fil);
+        return NULL;
+    }
+
+    fclose(fil);
+    buffer[bufflen] = 0;
+    *len = (uint32)bufflen;
+    return buffer;
+
+} /* agt_read_proc_file */
+
+
 /* END file agt_util.c */
@@ -1185,6 +1185,32 @@ extern boolean
                          const val_value_t *curnode);
 
 
+/********************************************************************
+* FUNCTION agt_read_proc_file
+*
+* Read an entire file into a malloced buffer
+* Files in /proc report a zero size, so the buffer
+* is grown until the end of file is reached
+*
+* INPUTS:
+*   filespec == file to read
+*   len == address of return length
+*   res == address of return status
+*
+* OUTPUTS:
+*   *len == number of bytes read, not including the zero byte
+*   *res == return status
+*
+* RETURNS:
+*   malloced zero-terminated buffer; must be freed by the caller
+*   NULL if some error
+*********************************************************************/
+extern xmlChar *
+    agt_read_proc_file (const char *filespec,
+                        uint32 *len,
+                        status_t *res);
+
+
 #ifdef __cplusplus
 }  /* end extern 'C' */
 #endif
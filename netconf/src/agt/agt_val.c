@@ -33,6 +33,11 @@ date         init     comment
 #include <stdlib.h>
 #include <memory.h>
 #include <assert.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
 
 #include "procdefs.h"
 #include "agt.h"
@@ -41,15 +46,18 @@ date         init     comment
 #include "agt_cb.h"
 #include "agt_cfg.h"
 #include "agt_commit_complete.h"
+#include "agt_journal.h"
 #include "agt_ncx.h"
 #include "agt_util.h"
 #include "agt_val.h"
 #include "agt_val_parse.h"
+#include "bobhash.h"
 #include "cap.h"
 #include "cfg.h"
 #include "dlq.h"
 #include "log.h"
 #include "ncx.h"
+#include "ncx_num.h"
 #include "ncxconst.h"
 #include "obj.h"
 #include "op.h"
@@ -57,9 +65,11 @@ date         init     comment
 #include "rpc.h"
 #include "rpc_err.h"
 #include "status.h"
+#include "tk.h"
 #include "typ.h"
 #include "tstamp.h"
 #include "val.h"
+#include "val_child.h"
 #include "val_util.h"
 #include "xmlns.h"
 #include "xpath.h"
@@ -74,6 +84,19 @@ date         init     comment
 *                                                                   *
 *********************************************************************/
 
+/* max edits of a candidate <edit-config> compared to each
+ * instance of a local must-stmt, instead of running the test */
+#define AGT_VAL_MAX_UNDO_SCAN  32
+
+/* max --validate-workers processes */
+#define AGT_VAL_MAX_WORKERS        64
+
+/* min instances checked by each --validate-workers process */
+#define AGT_VAL_MIN_WORKER_CHECKS  512
+
+/* number of failed check indexes sent by a worker per write */
+#define AGT_VAL_WORKER_BUFFSIZE    256
+
 /* recursive callback function forward decls */
 static status_t
     invoke_btype_cb (agt_cbtyp_t cbtyp,
@@ -114,8 +137,25 @@ typedef struct unique_set_t_ {
     dlq_hdr_t  qhdr;
     dlq_hdr_t  uniqueQ;   /* Q of val_unique_t */
     val_value_t *valnode;  /* value tree back-ptr */
+    struct unique_set_t_ *hashnext;  /* next set in the hash slot */
+    uint32     hash;    /* hash of the parent node and the tuple */
 } unique_set_t;
 
+/* 1 instance or unique-stmt check queued by agt_val_root_check
+ * when the instance tests are split across worker processes */
+typedef struct root_check_t_ {
+    agt_cfg_commit_test_t *ct;
+    val_value_t *valnode;   /* NULL for the unique-stmt tests */
+    uint32       tests;
+    boolean      recheck;   /* run by the server to record errors */
+} root_check_t;
+
+typedef struct root_check_list_t_ {
+    root_check_t *checks;
+    uint32        count;
+    uint32        max;
+} root_check_list_t;
+
 
 /********************************************************************
 *                                                                   *
@@ -858,6 +898,7 @@ static status_t
                                      child->name);
             if (testval) {
                 dlq_insertAhead(child, testval);
+                val_child_index_add(child);
             } else {
                 val_add_child_sorted(child, parent);
             }
@@ -882,6 +923,7 @@ static status_t
                     } else {
                         dlq_insertAfter(child, testval);
                     }
+                    val_child_index_add(child);
                 } else {
                     SET_ERROR(ERR_NCX_INSERT_MISSING_INSTANCE);
                     val_add_child_sorted(child, parent);
@@ -1175,6 +1217,26 @@ static void
 }  /* restore_extra_deletes */
 
 
+/********************************************************************
+* FUNCTION set_top_deleted_flag
+*
+* Flag the config root if a top-level node is being deleted.
+* There is no ancestor or sibling left to mark dirty, so
+* agt_val_root_check could not see the delete otherwise
+*
+* INPUTS:
+*   val == node being deleted from a config other than running
+*********************************************************************/
+static void
+    set_top_deleted_flag (val_value_t *val)
+{
+    if (val->parent && obj_is_root(val->parent->obj)) {
+        val->parent->flags |= VAL_FL_TOP_DELETED;
+    }
+
+}  /* set_top_deleted_flag */
+
+
 /********************************************************************
 * FUNCTION finish_extra_deletes
 * 
@@ -1198,6 +1260,7 @@ static void
                 val_clear_dirty_flag(nodeptr->node);
             } else {
                 val_set_dirty_flag(nodeptr->node);
+                set_top_deleted_flag(nodeptr->node);
             }
             val_remove_child(nodeptr->node);
             val_free_value(nodeptr->node);
@@ -2630,6 +2693,9 @@ static void
             val_clear_dirty_flag(undo->curnode);
         } else {
             val_set_dirty_flag(undo->curnode);
+            if (undo->newnode == NULL) {
+                set_top_deleted_flag(undo->curnode);
+            }
         }
         if (undo->free_curnode) {
             if (VAL_IS_DELETED(undo->curnode)) {
@@ -3016,6 +3082,7 @@ static status_t
     /* all SIL commit callbacks accepted and finalized the commit
      * now go through and finalize the edit; this step should not fail 
      * first, finish deleting any false when-stmt nodes then commit edits */
+    agt_journal_start_commit(txcb, target);
     while (!dlq_empty(&txcb->deadnodeQ)) {
         agt_cfg_nodeptr_t *nodeptr = (agt_cfg_nodeptr_t *)
             dlq_deque(&txcb->deadnodeQ);
@@ -3039,6 +3106,7 @@ static status_t
     cfg_update_last_ch_time(target);
     cfg_update_last_txid(target, txcb->txid);
     cfg_set_dirty_flag(target);
+    agt_journal_finish_commit(txcb, target);
 
     agt_profile_t *profile = agt_get_profile();
     profile->agt_config_state = AGT_CFG_STATE_OK;
@@ -3346,6 +3414,121 @@ static boolean
 } /* compare_unique_testsets */
 
 
+/********************************************************************
+* FUNCTION hash_unique_value
+* 
+* Add the value of 1 unique-stmt component to a tuple hash
+* Values that compare equal in compare_unique_testsets
+* always get the same hash value
+*
+* INPUTS:
+*   val == leaf value to hash
+*   hash == hash value so far
+*
+* OUTPUTS:
+*   *hash == updated hash value
+*
+* RETURNS:
+*   status
+*********************************************************************/
+static status_t
+    hash_unique_value (val_value_t *val,
+                       uint32 *hash)
+{
+    ncx_num_t  num;
+    double     d;
+    xmlChar   *str;
+    status_t   res = NO_ERR;
+
+    if (typ_is_string(val->btyp)) {
+        str = VAL_STR(val);
+        if (str) {
+            *hash = (uint32)bobhash((const ub1 *)str, xml_strlen(str), 
+                                    *hash);
+        }
+    } else if (typ_is_number(val->btyp)) {
+        /* numbers are compared by value, not by their string form */
+        ncx_init_num(&num);
+        res = ncx_cast_num(&val->v.num, val->btyp, &num, NCX_BT_FLOAT64);
+        if (res == NO_ERR) {
+            d = num.d;
+            if (d == 0) {
+                d = 0;    /* same hash for -0 and 0 */
+            }
+            *hash = (uint32)bobhash((const ub1 *)&d, sizeof(d), *hash);
+        }
+        ncx_clean_num(NCX_BT_FLOAT64, &num);
+    } else {
+        str = val_make_sprintf_string(val);
+        if (str == NULL) {
+            return ERR_INTERNAL_MEM;
+        }
+        *hash = (uint32)bobhash((const ub1 *)str, xml_strlen(str), *hash);
+        m__free(str);
+    }
+
+    return res;
+
+} /* hash_unique_value */
+
+
+/********************************************************************
+* FUNCTION hash_unique_testset
+* 
+* Get the hash value for a unique test set
+* List entries with different parents never match,
+* so the parent node is part of the hash
+*
+* INPUTS:
+*   uset == unique test set to hash
+*
+* OUTPUTS:
+*   uset->hash is set if TRUE returned
+*
+* RETURNS:
+*   TRUE if the set was hashed
+*   FALSE if some component is not exactly 1 simple value, 
+*     so the set needs to be compared the slow way
+*********************************************************************/
+static boolean
+    hash_unique_testset (unique_set_t *uset)
+{
+    val_value_t     *parent = uset->valnode->parent;
+    uint32           hash = (uint32)bobhash((const ub1 *)&parent,
+                                            sizeof(parent), 0);
+
+    val_unique_t *unival = (val_unique_t *)dlq_firstEntry(&uset->uniqueQ);
+    for (; unival; unival = (val_unique_t *)dlq_nextEntry(unival)) {
+        xpath_resnode_t *resnode = 
+            xpath_get_first_resnode(unival->pcb->result);
+        if (resnode == NULL || xpath_get_next_resnode(resnode) != NULL) {
+            return FALSE;
+        }
+
+        val_value_t *val = xpath_get_resnode_valptr(resnode);
+        if (val == NULL || !typ_is_simple(val->btyp)) {
+            return FALSE;
+        }
+
+        if (val_is_virtual(val)) {
+            status_t res = NO_ERR;
+            val = val_get_virtual_value(NULL, val, &res);
+            if (val == NULL) {
+                return FALSE;
+            }
+        }
+
+        if (hash_unique_value(val, &hash) != NO_ERR) {
+            return FALSE;
+        }
+    }
+
+    uset->hash = hash;
+    return TRUE;
+
+} /* hash_unique_testset */
+
+
 /********************************************************************
  * FUNCTION new_unique_set
  * Malloc and init a new unique test set
@@ -3479,6 +3662,146 @@ static status_t
 } /* make_unique_testset */
 
 
+/********************************************************************
+* FUNCTION record_unique_dup
+* 
+* Record a unique-stmt violation for a list entry that has
+* the same tuple as a later entry in the same list
+*
+* INPUTS:
+*   scb == session control block (may be NULL; no session stats)
+*   msg == xml_msg_hdr t from msg in progress 
+*       == NULL MEANS NO RPC-ERRORS ARE RECORDED
+*   uset == unique test set of the entry to flag
+*
+*********************************************************************/
+static void
+    record_unique_dup (ses_cb_t *scb,
+                       xml_msg_hdr_t *msg,
+                       unique_set_t *uset)
+{
+    agt_record_unique_error(scb, msg, uset->valnode, &uset->uniqueQ);
+    uset->valnode->res = ERR_NCX_UNIQUE_TEST_FAILED;
+
+} /* record_unique_dup */
+
+
+/********************************************************************
+* FUNCTION compare_unique_sets
+* 
+* Find the list entries with the same unique-stmt tuple
+* Each entry that has the same tuple as a later entry
+* of the same list is flagged with an error, so every
+* duplicate is reported at once
+*
+* The sets are hashed and only compared to the earlier sets
+* in the same hash slot.  If some set cannot be hashed, all
+* the sets are compared to each other instead.
+*
+* INPUTS:
+*   scb == session control block (may be NULL; no session stats)
+*   msg == xml_msg_hdr t from msg in progress 
+*       == NULL MEANS NO RPC-ERRORS ARE RECORDED
+*   usetQ == Q of unique_set_t to check, in list entry order
+*
+* OUTPUTS:
+*   if msg not NULL:
+*      msg->msg_errQ may have rpc_err_rec_t structs added to it 
+*      which must be freed by the called with the 
+*      rpc_err_free_record function
+*
+* RETURNS:
+*   status of the operation, NO_ERR if no duplicates found
+*********************************************************************/
+static status_t
+    compare_unique_sets (ses_cb_t *scb,
+                         xml_msg_hdr_t *msg,
+                         dlq_hdr_t *usetQ)
+{
+    unique_set_t   **table = NULL;
+    unique_set_t    *set1, *set2;
+    uint32           count = 0, size = 16, slot;
+    boolean          hashed = TRUE;
+    status_t         retres = NO_ERR;
+
+    set2 = (unique_set_t *)dlq_firstEntry(usetQ);
+    for (; set2 && hashed; set2 = (unique_set_t *)dlq_nextEntry(set2)) {
+        hashed = hash_unique_testset(set2);
+        count++;
+    }
+
+    if (hashed) {
+        while (size < count * 2) {
+            size *= 2;
+        }
+        table = m__getMem(size * sizeof(unique_set_t *));
+    }
+
+    if (table) {
+        memset(table, 0x0, size * sizeof(unique_set_t *));
+
+        set2 = (unique_set_t *)dlq_firstEntry(usetQ);
+        for (; set2; set2 = (unique_set_t *)dlq_nextEntry(set2)) {
+            if (set2->valnode->res == ERR_NCX_UNIQUE_TEST_FAILED) {
+                /* already reported for an earlier unique-stmt */
+                continue;
+            }
+
+            /* of the earlier entries with the same tuple, all but
+             * the last one seen have been flagged already */
+            slot = set2->hash & (size - 1);
+            for (set1 = table[slot]; set1; set1 = set1->hashnext) {
+                if (set1->hash == set2->hash &&
+                    set1->valnode->parent == set2->valnode->parent &&
+                    set1->valnode->res != ERR_NCX_UNIQUE_TEST_FAILED &&
+                    compare_unique_testsets(&set1->uniqueQ, 
+                                            &set2->uniqueQ)) {
+                    record_unique_dup(scb, msg, set1);
+                    retres = ERR_NCX_UNIQUE_TEST_FAILED;
+                    break;
+                }
+            }
+
+            set2->hashnext = table[slot];
+            table[slot] = set2;
+        }
+
+        m__free(table);
+        return retres;
+    }
+
+    /* go through all the test sets and compare them to each other
+     * this is a brute force compare N to N+1 .. last moving N
+     * through the list until all entries have been compared to
+     * each other and all unique violations recorded */
+    set1 = (unique_set_t *)dlq_firstEntry(usetQ);
+    for (; set1; set1 = (unique_set_t *)dlq_nextEntry(set1)) {
+        if (set1->valnode->res == ERR_NCX_UNIQUE_TEST_FAILED) {
+            continue;
+        }
+        set2 = (unique_set_t *)dlq_nextEntry(set1);
+        for (; set2; set2 = (unique_set_t *)dlq_nextEntry(set2)) {
+            if (set2->valnode->res == ERR_NCX_UNIQUE_TEST_FAILED) {
+                // already compared this to rest of list instances
+                // if it is flagged with a unique-test failed error
+                continue;
+            }
+            if (set1->valnode->parent == set2->valnode->parent &&
+                compare_unique_testsets(&set1->uniqueQ, 
+                                        &set2->uniqueQ)) {
+                /* 2 lists have the same values so generate an error */
+                record_unique_dup(scb, msg, set1);
+                retres = ERR_NCX_UNIQUE_TEST_FAILED;
+                break;
+            }
+        }
+    }
+
+    return retres;
+
+} /* compare_unique_sets */
+
+
 /********************************************************************
 * FUNCTION one_unique_stmt_check
 * 
@@ -3569,33 +3892,7 @@ static status_t
     }
 
     if (retres == NO_ERR) {
-        /* go through all the test sets and compare them to each other
-         * this is a brute force compare N to N+1 .. last moving N
-         * through the list until all entries have been compared to
-         * each other and all unique violations recorded;
-         * As compare is done, delete old set1 since no longer needed */
-        while (!dlq_empty(&usetQ)) {
-            unique_set_t *set1 = (unique_set_t *)dlq_deque(&usetQ);
-            if (set1 && set1->valnode->res != ERR_NCX_UNIQUE_TEST_FAILED) {
-                unique_set_t *set2 = (unique_set_t *)dlq_firstEntry(&usetQ);
-                for (; set2; set2 = (unique_set_t *)dlq_nextEntry(set2)) {
-                    if (set2->valnode->res == ERR_NCX_UNIQUE_TEST_FAILED) {
-                        // already compared this to rest of list instances
-                        // if it is flagged with a unique-test failed error
-                        continue;
-                    }
-                    if (compare_unique_testsets(&set1->uniqueQ, 
-                                                &set2->uniqueQ)) {
-                        /* 2 lists have the same values so generate an error */
-                        agt_record_unique_error(scb, msg, set1->valnode,
-                                                &set1->uniqueQ);
-                        set1->valnode->res = ERR_NCX_UNIQUE_TEST_FAILED;
-                        retres = ERR_NCX_UNIQUE_TEST_FAILED;
-                    }
-                }
-            }
-            free_unique_set(set1);
-        }
+        retres = compare_unique_sets(scb, msg, &usetQ);
     }
 
     while (!dlq_empty(&usetQ)) {
@@ -4743,123 +5040,476 @@ static void
 
 
 /********************************************************************
-* FUNCTION add_obj_commit_tests
+* FUNCTION get_top_data_obj
 * 
-* Check if the specified object and all its descendants 
-* have any commit tests to record in the commit_testQ
-* Tests are added in top-down order
-* TBD: cascade XPath lookup results to nested commmit tests
-*
-* Tests done in the parent node:
-*   AGT_TEST_FL_MIN_ELEMS
-*   AGT_TEST_FL_MAX_ELEMS
-*   AGT_TEST_FL_MANDATORY
-*
-* Tests done in the object node:
-*   AGT_TEST_FL_MUST
-*   AGT_TEST_FL_UNIQUE
-*   AGT_TEST_FL_XPATH_TYPE
-*   AGT_TEST_FL_WHEN  (part of delete_dead_nodes, not this fn)
+* Get the top-level data node ancestor-or-self of an object
+* Choice and case nodes are skipped since they are not
+* in the data tree
 *
 * INPUTS:
-*  obj == object to check
-*  commit_testQ == address of queue to use to fill with
-*                  agt_cfg_commit_test_t structs
-*  rootflags == address of return root node testflags
+*   obj == object to check
 *
-* OUTPUTS:
-*  commit_testQ will contain an agt_cfg_commit_test_t struct
-*  for each descendant-or-self object found with 
-*  commit-time validation tests
-*  *rootflags will be altered if node is top-level and
-*   needs instance testing
 * RETURNS:
-*  status of the operation, NO_ERR unless internal errors found
-*  or malloc error
+*   top-level data object for obj
 *********************************************************************/
-static status_t
-    add_obj_commit_tests (obj_template_t *obj,
-			  dlq_hdr_t *commit_testQ,
-                          uint32 *rootflags)
+static obj_template_t *
+    get_top_data_obj (obj_template_t *obj)
 {
-    if (skip_obj_commit_test(obj)) {
-        return NO_ERR;
+    obj_template_t *topobj = obj;
+    obj_template_t *parent = obj->parent;
+
+    while (parent && !obj_is_root(parent)) {
+        if (!(parent->objtype == OBJ_TYP_CHOICE ||
+              parent->objtype == OBJ_TYP_CASE)) {
+            topobj = parent;
+        }
+        parent = parent->parent;
     }
+    return topobj;
 
-    status_t res = NO_ERR;
+}  /* get_top_data_obj */
 
-    /* check for tests in active config nodes, bottom-up traversal */
-    uint32 testflags = 0;
-    dlq_hdr_t *mustQ = obj_get_mustQ(obj);
-    ncx_btype_t btyp = obj_get_basetype(obj);
-    obj_template_t *chobj;
 
-    if (!(obj->objtype == OBJ_TYP_CHOICE || obj->objtype == OBJ_TYP_CASE)) {
-        if (mustQ && !dlq_empty(mustQ)) {
-            testflags |= AGT_TEST_FL_MUST;
-        }
-    
-        if (obj_has_when_stmts(obj)) {
-            testflags |= AGT_TEST_FL_WHEN;
-        }
-    }
+/********************************************************************
+* FUNCTION add_commit_test_dep
+* 
+* Add a top-level data object to the objects that the
+* XPath tests of a commit test record can read
+*
+* INPUTS:
+*   ct == commit test record to update
+*   topobj == top-level data object to add
+*
+* RETURNS:
+*   status of the operation
+*********************************************************************/
+static status_t
+    add_commit_test_dep (agt_cfg_commit_test_t *ct,
+                         obj_template_t *topobj)
+{
+    uint32 i;
 
-    obj_unique_t *unidef = obj_first_unique(obj);
-    boolean done = FALSE;
-    for (; unidef && !done; unidef = obj_next_unique(unidef)) {
-        if (unidef->isconfig) {
-            testflags |= AGT_TEST_FL_UNIQUE;
-            done = TRUE;
+    for (i = 0; i < ct->depcount; i++) {
+        if (ct->depobjs[i] == topobj) {
+            return NO_ERR;
         }
     }
 
-    if (obj_is_top(obj)) {
-        /* need to check if this is a top-level node that
-         * has instance requirements (mandatory/min/max)
-         */
-        check_parent_tests(obj, rootflags);
-    }
-
-    if (obj->objtype == OBJ_TYP_CHOICE || obj->objtype == OBJ_TYP_CASE) {
-        /* do not create a commit test record for a choice or case
-         * since they will never be in the data tree, so XPath
-         * will never find them */
-        testflags = 0;
-    } else {
-        /* set the instance or MANDATORY test bits in the parent,
-         * not in the child nodes for each commit test
-         * check all child nodes to determine if parent needs
-         * to run instance_check
-         */
-        for (chobj = obj_first_child(obj); 
-             chobj != NULL; 
-             chobj = obj_next_child(chobj)) {
-
-            if (skip_obj_commit_test(chobj)) {
-                continue;
-            }
-            check_parent_tests(chobj, &testflags);
+    if (ct->depcount == ct->depmax) {
+        uint32 newmax = (ct->depmax) ? ct->depmax * 2 : 4;
+        obj_template_t **newobjs = (obj_template_t **)
+            m__getMem(newmax * sizeof(obj_template_t *));
+        if (newobjs == NULL) {
+            return ERR_INTERNAL_MEM;
         }
-    
-        typ_def_t *typdef = obj_get_typdef(obj);
-        if (btyp == NCX_BT_LEAFREF || 
-            (btyp == NCX_BT_INSTANCE_ID && typ_get_constrained(typdef))) {
-            /* need to check XPath-based leaf to see that the referenced
-             * instance exists in the target data tree
-             */
-            testflags |= AGT_TEST_FL_XPATH_TYPE;
+        if (ct->depobjs) {
+            memcpy(newobjs, ct->depobjs, 
+                   ct->depcount * sizeof(obj_template_t *));
+            m__free(ct->depobjs);
         }
+        ct->depobjs = newobjs;
+        ct->depmax = newmax;
     }
 
-    if (testflags) {
-        /* need a commit test record for this object */
-        agt_cfg_commit_test_t *ct = agt_cfg_new_commit_test();
-        if (ct == NULL) {
-            return ERR_INTERNAL_MEM;
-        } 
+    ct->depobjs[ct->depcount++] = topobj;
+    return NO_ERR;
 
-        ct->objpcb = xpath_new_pcb(NULL, NULL);
-        if (ct->objpcb == NULL) {
+}  /* add_commit_test_dep */
+
+
+/********************************************************************
+* FUNCTION scan_commit_test_expr
+* 
+* Scan 1 node of the expression tree of a must-stmt or leafref
+* path for the data nodes it can read.  The level of each
+* relative step is tracked from the context node (level 0),
+* so a path that only reads the subtree of the top-level
+* ancestor of the object adds no deps.  Anything else sets
+* ct->depany: an absolute path, a path that climbs to the
+* docroot, '//', an axis that can leave the subtree, a
+* variable, deref(), or a path that starts from an unknown
+* node-set.  The deepest '..' level reached is kept in
+* ct->mustdepth, since the expression can only read the
+* subtree of the ancestor that many levels up
+*
+* INPUTS:
+*   ct == commit test record to update
+*   expr == expression tree node to scan
+*   level == level of the context node for expr
+*   toplevel == level of the top-level ancestor of ct->obj
+*   endlevel == address of return level
+*
+* OUTPUTS:
+*   ct->depany and ct->mustdepth may be changed
+*   *endlevel == level of the nodes in the node-set
+*                if TRUE is returned
+*
+* RETURNS:
+*   TRUE if expr is a node-set with all nodes at *endlevel
+*   FALSE if not a node-set or the level is not known
+*********************************************************************/
+static boolean
+    scan_commit_test_expr (agt_cfg_commit_test_t *ct,
+                           const xpath_expr_t *expr,
+                           int32 level,
+                           int32 toplevel,
+                           int32 *endlevel)
+{
+    const xpath_expr_t *step, *arg;
+    int32 level1 = 0, level2 = 0;
+    boolean known1, known2;
+
+    if (ct->depany) {
+        return FALSE;
+    }
+
+    switch (expr->extyp) {
+    case XP_EXTYP_OP:
+        known1 = scan_commit_test_expr(ct, expr->left, level, toplevel,
+                                       &level1);
+        known2 = scan_commit_test_expr(ct, expr->right, level, toplevel,
+                                       &level2);
+        if (expr->exop == XP_EXOP_UNION && known1 && known2 &&
+            level1 == level2) {
+            *endlevel = level1;
+            return TRUE;
+        }
+        return FALSE;
+    case XP_EXTYP_NEGATE:
+        (void)scan_commit_test_expr(ct, expr->left, level, toplevel,
+                                    &level1);
+        return FALSE;
+    case XP_EXTYP_LITERAL:
+    case XP_EXTYP_NUMBER:
+        return FALSE;
+    case XP_EXTYP_FNCALL:
+        if (!xml_strcmp(expr->fncb->name, XP_FN_CURRENT)) {
+            *endlevel = 0;
+            return TRUE;
+        }
+        if (!xml_strcmp(expr->fncb->name, XP_FN_DEREF)) {
+            ct->depany = TRUE;
+            return FALSE;
+        }
+        for (arg = (const xpath_expr_t *)dlq_firstEntry(&expr->exprQ);
+             arg != NULL;
+             arg = (const xpath_expr_t *)dlq_nextEntry(arg)) {
+            (void)scan_commit_test_expr(ct, arg, level, toplevel, &level1);
+        }
+        return FALSE;
+    case XP_EXTYP_FILTER:
+    case XP_EXTYP_PATH:
+        if (expr->left) {
+            if (!scan_commit_test_expr(ct, expr->left, level, toplevel,
+                                       &level)) {
+                /* the predicates or steps start at unknown nodes */
+                ct->depany = TRUE;
+                return FALSE;
+            }
+        }
+        if (expr->extyp == XP_EXTYP_FILTER) {
+            break;
+        }
+
+        for (step = (const xpath_expr_t *)dlq_firstEntry(&expr->exprQ);
+             step != NULL && !ct->depany;
+             step = (const xpath_expr_t *)dlq_nextEntry(step)) {
+            if (step->exop == XP_EXOP_FILTER2 ||
+                (step->exop == XP_EXOP_FILTER1 && expr->left == NULL &&
+                 step == (const xpath_expr_t *)
+                 dlq_firstEntry(&expr->exprQ))) {
+                /* '//' or an absolute path */
+                ct->depany = TRUE;
+                break;
+            }
+
+            switch (step->extyp) {
+            case XP_EXTYP_SELF:
+                break;
+            case XP_EXTYP_PARENT:
+                level--;
+                break;
+            case XP_EXTYP_STEP:
+                switch (step->axis) {
+                case XP_AX_CHILD:
+                    level++;
+                    break;
+                case XP_AX_ATTRIBUTE:
+                case XP_AX_SELF:
+                    break;
+                default:
+                    ct->depany = TRUE;
+                }
+                for (arg = (const xpath_expr_t *)
+                         dlq_firstEntry(&step->exprQ);
+                     arg != NULL && !ct->depany;
+                     arg = (const xpath_expr_t *)dlq_nextEntry(arg)) {
+                    (void)scan_commit_test_expr(ct, arg, level, toplevel,
+                                                &level1);
+                }
+                break;
+            default:
+                ct->depany = TRUE;
+            }
+
+            if (level < toplevel) {
+                /* reached the docroot */
+                ct->depany = TRUE;
+            } else if (level < 0 && (uint32)(-level) > ct->mustdepth) {
+                ct->mustdepth = (uint32)(-level);
+            }
+        }
+        break;
+    default:
+        ct->depany = TRUE;
+    }
+
+    if (ct->depany) {
+        return FALSE;
+    }
+
+    if (expr->extyp == XP_EXTYP_FILTER) {
+        for (arg = (const xpath_expr_t *)dlq_firstEntry(&expr->exprQ);
+             arg != NULL;
+             arg = (const xpath_expr_t *)dlq_nextEntry(arg)) {
+            (void)scan_commit_test_expr(ct, arg, level, toplevel, &level1);
+        }
+    }
+
+    *endlevel = level;
+    return TRUE;
+
+}  /* scan_commit_test_expr */
+
+
+/********************************************************************
+* FUNCTION scan_commit_test_deps
+* 
+* Scan the expression tree of 1 must-stmt or leafref path
+* for the data nodes it can read
+* An expression without a tree sets ct->depany
+*
+* INPUTS:
+*   ct == commit test record to update
+*   pcb == parsed XPath expression to scan
+*   toplevel == level of the top-level ancestor of ct->obj
+*
+* OUTPUTS:
+*   ct->depany, ct->mustdepth and ct->mustlocal may be changed
+*********************************************************************/
+static void
+    scan_commit_test_deps (agt_cfg_commit_test_t *ct,
+                           xpath_pcb_t *pcb,
+                           int32 toplevel)
+{
+    const xpath_expr_t *expr = xpath1_get_expr_tree(pcb);
+    int32 endlevel = 0;
+
+    if (expr == NULL) {
+        ct->depany = TRUE;
+    } else {
+        (void)scan_commit_test_expr(ct, expr, 0, toplevel, &endlevel);
+    }
+
+    if (ct->depany) {
+        ct->mustlocal = FALSE;
+    }
+
+}  /* scan_commit_test_deps */
+
+
+/********************************************************************
+* FUNCTION set_commit_test_deps
+* 
+* Find the top-level data nodes that the must-stmt and leafref
+* tests of a commit test record can read, so agt_val_root_check
+* can skip these tests if none of them has been edited
+* Only the top-level ancestor of the object itself is added;
+* any test that can read other nodes sets ct->depany
+*
+* INPUTS:
+*   ct == commit test record to update
+*
+* OUTPUTS:
+*   ct->depobjs, ct->depany, ct->mustdepth and ct->mustlocal set
+*   ct->depobjs[0] is the top-level ancestor of ct->obj
+*
+* RETURNS:
+*   status of the operation
+*********************************************************************/
+static status_t
+    set_commit_test_deps (agt_cfg_commit_test_t *ct)
+{
+    /* the instance itself is always read */
+    status_t res = add_commit_test_dep(ct, get_top_data_obj(ct->obj));
+
+    /* level of the top-level ancestor, from the object (level 0) */
+    int32 toplevel = 0;
+    obj_template_t *parent = ct->obj->parent;
+    for (; parent && !obj_is_root(parent); parent = parent->parent) {
+        if (!(parent->objtype == OBJ_TYP_CHOICE ||
+              parent->objtype == OBJ_TYP_CASE)) {
+            toplevel--;
+        }
+    }
+
+    ct->mustlocal = (ct->testflags & AGT_TEST_FL_MUST) ? TRUE : FALSE;
+    if (res == NO_ERR && (ct->testflags & AGT_TEST_FL_MUST)) {
+        xpath_pcb_t *must = (xpath_pcb_t *)
+            dlq_firstEntry(obj_get_mustQ(ct->obj));
+        for (; must != NULL; 
+             must = (xpath_pcb_t *)dlq_nextEntry(must)) {
+            scan_commit_test_deps(ct, must, toplevel);
+        }
+    }
+
+    if (res == NO_ERR && (ct->testflags & AGT_TEST_FL_XPATH_TYPE)) {
+        xpath_pcb_t *pcb = NULL;
+        if (ct->btyp == NCX_BT_LEAFREF) {
+            pcb = typ_get_leafref_pcb(obj_get_typdef(ct->obj));
+        }
+        if (pcb) {
+            /* the leafref path is not part of the must-stmt scope */
+            boolean mustlocal = ct->mustlocal;
+            uint32 mustdepth = ct->mustdepth;
+            scan_commit_test_deps(ct, pcb, toplevel);
+            ct->mustlocal = mustlocal;
+            ct->mustdepth = mustdepth;
+        } else {
+            /* instance-identifier can point anywhere */
+            ct->depany = TRUE;
+        }
+    }
+
+    if (LOGDEBUG4) {
+        log_debug4("\ncommit_test deps for %s: %u top-level%s%s",
+                   ct->objpcb->exprstr, ct->depcount,
+                   (ct->depany) ? " (any)" : "",
+                   (ct->mustlocal) ? " (local must)" : "");
+    }
+    return res;
+
+}  /* set_commit_test_deps */
+
+
+/********************************************************************
+* FUNCTION add_obj_commit_tests
+* 
+* Check if the specified object and all its descendants 
+* have any commit tests to record in the commit_testQ
+* Tests are added in top-down order
+* TBD: cascade XPath lookup results to nested commmit tests
+*
+* Tests done in the parent node:
+*   AGT_TEST_FL_MIN_ELEMS
+*   AGT_TEST_FL_MAX_ELEMS
+*   AGT_TEST_FL_MANDATORY
+*
+* Tests done in the object node:
+*   AGT_TEST_FL_MUST
+*   AGT_TEST_FL_UNIQUE
+*   AGT_TEST_FL_XPATH_TYPE
+*   AGT_TEST_FL_WHEN  (part of delete_dead_nodes, not this fn)
+*
+* INPUTS:
+*  obj == object to check
+*  commit_testQ == address of queue to use to fill with
+*                  agt_cfg_commit_test_t structs
+*  rootflags == address of return root node testflags
+*
+* OUTPUTS:
+*  commit_testQ will contain an agt_cfg_commit_test_t struct
+*  for each descendant-or-self object found with 
+*  commit-time validation tests
+*  *rootflags will be altered if node is top-level and
+*   needs instance testing
+* RETURNS:
+*  status of the operation, NO_ERR unless internal errors found
+*  or malloc error
+*********************************************************************/
+static status_t
+    add_obj_commit_tests (obj_template_t *obj,
+			  dlq_hdr_t *commit_testQ,
+                          uint32 *rootflags)
+{
+    if (skip_obj_commit_test(obj)) {
+        return NO_ERR;
+    }
+
+    status_t res = NO_ERR;
+
+    /* check for tests in active config nodes, bottom-up traversal */
+    uint32 testflags = 0;
+    dlq_hdr_t *mustQ = obj_get_mustQ(obj);
+    ncx_btype_t btyp = obj_get_basetype(obj);
+    obj_template_t *chobj;
+
+    if (!(obj->objtype == OBJ_TYP_CHOICE || obj->objtype == OBJ_TYP_CASE)) {
+        if (mustQ && !dlq_empty(mustQ)) {
+            testflags |= AGT_TEST_FL_MUST;
+        }
+    
+        if (obj_has_when_stmts(obj)) {
+            testflags |= AGT_TEST_FL_WHEN;
+        }
+    }
+
+    obj_unique_t *unidef = obj_first_unique(obj);
+    boolean done = FALSE;
+    for (; unidef && !done; unidef = obj_next_unique(unidef)) {
+        if (unidef->isconfig) {
+            testflags |= AGT_TEST_FL_UNIQUE;
+            done = TRUE;
+        }
+    }
+
+    if (obj_is_top(obj)) {
+        /* need to check if this is a top-level node that
+         * has instance requirements (mandatory/min/max)
+         */
+        check_parent_tests(obj, rootflags);
+    }
+
+    if (obj->objtype == OBJ_TYP_CHOICE || obj->objtype == OBJ_TYP_CASE) {
+        /* do not create a commit test record for a choice or case
+         * since they will never be in the data tree, so XPath
+         * will never find them */
+        testflags = 0;
+    } else {
+        /* set the instance or MANDATORY test bits in the parent,
+         * not in the child nodes for each commit test
+         * check all child nodes to determine if parent needs
+         * to run instance_check
+         */
+        for (chobj = obj_first_child(obj); 
+             chobj != NULL; 
+             chobj = obj_next_child(chobj)) {
+
+            if (skip_obj_commit_test(chobj)) {
+                continue;
+            }
+            check_parent_tests(chobj, &testflags);
+        }
+    
+        typ_def_t *typdef = obj_get_typdef(obj);
+        if (btyp == NCX_BT_LEAFREF || 
+            (btyp == NCX_BT_INSTANCE_ID && typ_get_constrained(typdef))) {
+            /* need to check XPath-based leaf to see that the referenced
+             * instance exists in the target data tree
+             */
+            testflags |= AGT_TEST_FL_XPATH_TYPE;
+        }
+    }
+
+    if (testflags) {
+        /* need a commit test record for this object */
+        agt_cfg_commit_test_t *ct = agt_cfg_new_commit_test();
+        if (ct == NULL) {
+            return ERR_INTERNAL_MEM;
+        } 
+
+        ct->objpcb = xpath_new_pcb(NULL, NULL);
+        if (ct->objpcb == NULL) {
             agt_cfg_free_commit_test(ct);
             return ERR_INTERNAL_MEM;
         }
@@ -4873,6 +5523,11 @@ static status_t
         ct->obj = obj;
         ct->btyp = btyp;
         ct->testflags = testflags;
+        res = set_commit_test_deps(ct);
+        if (res != NO_ERR) {
+            agt_cfg_free_commit_test(ct);
+            return res;
+        }
         dlq_enque(ct, commit_testQ);
         if (LOGDEBUG4) {
             log_debug4("\nAdded commit_test record for %s testflags=0x%08X",
@@ -4894,6 +5549,43 @@ static status_t
 } /* add_obj_commit_tests */
 
 
+/********************************************************************
+* FUNCTION check_dirty_top_obj
+* 
+* Check if any instance of a top-level object is marked dirty
+* in the specified config root
+*
+* INPUTS:
+*    topobj == top-level data object to check
+*    rootval == config root to check
+* RETURNS:
+*    TRUE if any instance may have been changed; FALSE if not
+*********************************************************************/
+static boolean
+    check_dirty_top_obj (obj_template_t *topobj,
+                         val_value_t *rootval)
+{
+    val_value_t *testval = val_find_child(rootval, obj_get_mod_name(topobj),
+                                          obj_get_name(topobj));
+    while (testval) {
+        if (val_dirty_subtree(testval)) {
+            return TRUE;
+        }
+        switch (topobj->objtype) {
+        case OBJ_TYP_LEAF:
+        case OBJ_TYP_ANYXML:
+        case OBJ_TYP_CONTAINER:
+            return FALSE;
+        default:
+            testval = val_find_next_child(rootval, obj_get_mod_name(topobj),
+                                          obj_get_name(topobj), testval);
+        }
+    }
+    return FALSE;
+
+} /* check_dirty_top_obj */
+
+
 /********************************************************************
 * FUNCTION check_prune_obj
 * 
@@ -4912,10 +5604,10 @@ static uint32
                      val_value_t *rootval,
                      uint32 curflags)
 {
-    /* for now just check the top level object to see if
-     * this subtree could have possibly changed;
-     * TBD: come up with fast way to check more, that does
-     * take as much time as just using XPath to get these objects  */
+    /* just check the top level object to see if this subtree
+     * could have possibly changed; must-stmt and leafref tests
+     * that read other subtrees are checked with the commit
+     * test deps instead   */
     boolean done = FALSE;
     obj_template_t *testobj = obj;
     while (!done) {
@@ -4926,35 +5618,9 @@ static uint32
         }
     }
 
-    /* find this object in the rootval */
-    val_value_t *testval = val_find_child(rootval, obj_get_mod_name(testobj),
-                                          obj_get_name(testobj));
-    if (testval) {
-        switch (testobj->objtype) {
-        case OBJ_TYP_LEAF:
-        case OBJ_TYP_ANYXML:
-        case OBJ_TYP_CONTAINER:
-            if (val_dirty_subtree(testval)) {
-                /* do not skip this node */
-                return curflags;
-            }
-            break;
-        default:
-            done = FALSE;
-            while (!done) {
-                if (val_dirty_subtree(testval)) {
-                    /* do not skip this node */
-                    return curflags;
-                } else {
-                    testval = 
-                        val_find_next_child(rootval, obj_get_mod_name(testobj),
-                                            obj_get_name(testobj), testval);
-                    if (testval == NULL) {
-                        done = TRUE;
-                    }
-                }
-            }
-        }
+    if (check_dirty_top_obj(testobj, rootval)) {
+        /* do not skip this node */
+        return curflags;
     }
 
     /* skip this node for all tests, since no instances of
@@ -4963,70 +5629,292 @@ static uint32
      * the root node (on the top-level YANG data nodes, so
      * any instance or mandatory tests on the top-node will
      * always be done     */
-    //return 0;
+    return 0;
+
+} /* check_prune_obj */
+
+
+/********************************************************************
+* FUNCTION check_no_prune_curedit
+* 
+* Check if the specified object test is needed from the current 
+* commit test, based on the current edit in the undo record
+*
+* INPUTS:
+*   undo == edit operation to check
+*   obj == commit test object to check; must not be root!
+* RETURNS:
+*  TRUE if found and test needed; FALSE if not found
+*********************************************************************/
+static boolean
+    check_no_prune_curedit (agt_cfg_undo_rec_t *undo,
+                            obj_template_t *obj)
+{
+    obj_template_t *editobj = (undo->newnode) ? undo->newnode->obj :
+        ((undo->curnode) ? undo->curnode->obj : NULL);
+    if (editobj == NULL) {
+        return FALSE;
+    }
+
+    /* see if the commit test object is a descendant of
+     * the edit object, but only if not deleting the edit
+     * object; do not trigger descendant test on a delete  */
+    boolean done = (undo->editop == OP_EDITOP_DELETE);
+    obj_template_t *testobj = obj;
+    while (!done) {
+        if (editobj == testobj) {
+            return TRUE;   // do not prune this object test
+        }
+
+        if (testobj->parent && !obj_is_root(testobj->parent)) {
+            testobj = testobj->parent;
+        } else {
+            done = TRUE;
+        }
+    }
+
+    /* see if the edit object is a descendant of the commit test object */
+    done = FALSE;
+    while (!done) {
+        if (editobj == obj) {
+            return TRUE;   // do not prune this object test
+        }
+
+        if (editobj->parent && !obj_is_root(editobj->parent)) {
+            editobj = editobj->parent;
+        } else {
+            done = TRUE;
+        }
+    }
+
+    return FALSE;
+
+} /* check_no_prune_curedit */
+
+
+/********************************************************************
+* FUNCTION check_changed_deps
+* 
+* Check if any top-level data node read by the must-stmt or
+* leafref tests of a commit test might have been changed
+* The same edit records and dirty flags used to prune the
+* other tests of the object are checked for each dep
+*
+* INPUTS:
+*   txcb == transaction in progress
+*   ct == commit test record to check
+*   rootval == config root to check
+*   firstdep == 0 to check all deps; 1 to skip the top-level
+*               ancestor of the object itself
+*
+* RETURNS:
+*   TRUE if the tests are needed; FALSE if they can be skipped
+*********************************************************************/
+static boolean
+    check_changed_deps (agt_cfg_transaction_t *txcb,
+                        agt_cfg_commit_test_t *ct,
+                        val_value_t *rootval,
+                        uint32 firstdep)
+{
+    boolean useflags = FALSE, useundo = FALSE;
+
+    if (ct->depany) {
+        return TRUE;
+    }
+
+    if (txcb->cfg_id == NCX_CFGID_RUNNING) {
+        if (txcb->commitcheck) {
+            useflags = TRUE;
+        } else if (txcb->edit_type == AGT_CFG_EDIT_TYPE_PARTIAL) {
+            useundo = TRUE;
+        }
+    } else if (txcb->cfg_id == NCX_CFGID_CANDIDATE) {
+        if (txcb->edit_type == AGT_CFG_EDIT_TYPE_FULL) {
+            useflags = TRUE;
+        } else if (txcb->edit_type == AGT_CFG_EDIT_TYPE_PARTIAL) {
+            useflags = useundo = TRUE;
+        }
+    }
+
+    if (!useflags && !useundo) {
+        return TRUE;
+    }
+
+    /* a replaced root or a deleted top-level node does not leave
+     * a dirty flag on any top-level node   */
+    if (useflags && 
+        (rootval->flags & (VAL_FL_DIRTY | VAL_FL_TOP_DELETED))) {
+        return TRUE;
+    }
+
+    uint32 i;
+    for (i = firstdep; i < ct->depcount; i++) {
+        if (useflags && check_dirty_top_obj(ct->depobjs[i], rootval)) {
+            return TRUE;
+        }
+        if (!useundo) {
+            continue;
+        }
+
+        agt_cfg_undo_rec_t *undo = (agt_cfg_undo_rec_t *)
+            dlq_firstEntry(&txcb->undoQ);
+        for (; undo != NULL; 
+             undo = (agt_cfg_undo_rec_t *)dlq_nextEntry(undo)) {
+            val_value_t *editval = (undo->newnode) ? undo->newnode :
+                undo->curnode;
+            if (editval == NULL || obj_is_root(editval->obj) ||
+                get_top_data_obj(editval->obj) == ct->depobjs[i]) {
+                return TRUE;
+            }
+
+            agt_cfg_nodeptr_t *nodeptr = (agt_cfg_nodeptr_t *)
+                dlq_firstEntry(&undo->extra_deleteQ);
+            for (; nodeptr != NULL; 
+                 nodeptr = (agt_cfg_nodeptr_t *)dlq_nextEntry(nodeptr)) {
+                if (nodeptr->node &&
+                    get_top_data_obj(nodeptr->node->obj) == 
+                    ct->depobjs[i]) {
+                    return TRUE;
+                }
+            }
+        }
+    }
+
+    return FALSE;
+
+} /* check_changed_deps */
+
+
+/********************************************************************
+* FUNCTION check_edit_anchor
+* 
+* Check if an edited node is in the subtree of the ancestor
+* of an instance that a local must-stmt reads, or above it
+*
+* INPUTS:
+*   editval == edited node to check
+*   val == instance of the must-stmt object
+*   depth == number of levels from val up to its anchor
+*
+* RETURNS:
+*   TRUE if the edit may change the must-stmt result
+*********************************************************************/
+static boolean
+    check_edit_anchor (val_value_t *editval,
+                       val_value_t *val,
+                       uint32 depth)
+{
+    val_value_t *anchor = val;
+    uint32 i;
+
+    for (i = 0; i < depth; i++) {
+        anchor = anchor->parent;
+    }
+
+    /* an edit above the anchor is found from the instance;
+     * stop at the config root the instance is in */
+    for (val = val->parent; val != NULL && !obj_is_root(val->obj); 
+         val = val->parent) {
+        if (val == editval) {
+            return TRUE;
+        }
+    }
+
+    for (; editval != NULL; editval = editval->parent) {
+        if (editval == anchor) {
+            return TRUE;
+        }
+        if (obj_is_root(editval->obj)) {
+            /* an edit outside the config root is not skipped */
+            return (editval == val) ? FALSE : TRUE;
+        }
+    }
 
-    /* xpath tests can depend on any top level container */
-    return (curflags & AGT_TEST_FL_XPATH_TYPE);
+    return TRUE;
 
-} /* check_prune_obj */
+}  /* check_edit_anchor */
 
 
 /********************************************************************
-* FUNCTION check_no_prune_curedit
+* FUNCTION check_dirty_instance
 * 
-* Check if the specified object test is needed from the current 
-* commit test, based on the current edit in the undo record
+* Check if the must-stmt tests of one instance need to be run
+* again.  The tests only read the subtree of the ancestor
+* ct->mustdepth levels up, so they are not needed unless a node
+* in that subtree or an ancestor of it is marked dirty
+*
+* The edits of a candidate <edit-config> are not marked dirty
+* until after the root check, so these are found in the undoQ
 *
 * INPUTS:
-*   undo == edit operation to check
-*   obj == commit test object to check; must not be root!
+*   txcb == transaction in progress
+*   ct == commit test record with ct->mustlocal set
+*   val == instance of ct->obj to check
+*   useundo == TRUE to check the txcb->undoQ edits as well
+*
 * RETURNS:
-*  TRUE if found and test needed; FALSE if not found
+*   TRUE if the tests are needed; FALSE if they can be skipped
 *********************************************************************/
 static boolean
-    check_no_prune_curedit (agt_cfg_undo_rec_t *undo,
-                            obj_template_t *obj)
+    check_dirty_instance (agt_cfg_transaction_t *txcb,
+                          agt_cfg_commit_test_t *ct,
+                          val_value_t *val,
+                          boolean useundo)
 {
-    obj_template_t *editobj = (undo->newnode) ? undo->newnode->obj :
-        ((undo->curnode) ? undo->curnode->obj : NULL);
-    if (editobj == NULL) {
-        return FALSE;
-    }
+    val_value_t *anchor = val;
+    uint32 i;
 
-    /* see if the commit test object is a descendant of
-     * the edit object, but only if not deleting the edit
-     * object; do not trigger descendant test on a delete  */
-    boolean done = (undo->editop == OP_EDITOP_DELETE);
-    obj_template_t *testobj = obj;
-    while (!done) {
-        if (editobj == testobj) {
-            return TRUE;   // do not prune this object test
+    for (i = 0; i < ct->mustdepth; i++) {
+        anchor = anchor->parent;
+        if (anchor == NULL || obj_is_root(anchor->obj)) {
+            return TRUE;
         }
+    }
 
-        if (testobj->parent && !obj_is_root(testobj->parent)) {
-            testobj = testobj->parent;
-        } else {
-            done = TRUE;
+    if (val_dirty_subtree(anchor)) {
+        return TRUE;
+    }
+
+    /* a new or replaced ancestor only has its own dirty flag set */
+    for (anchor = anchor->parent; 
+         anchor != NULL && !obj_is_root(anchor->obj);
+         anchor = anchor->parent) {
+        if (val_get_dirty_flag(anchor)) {
+            return TRUE;
         }
     }
 
-    /* see if the edit object is a descendant of the commit test object */
-    done = FALSE;
-    while (!done) {
-        if (editobj == obj) {
-            return TRUE;   // do not prune this object test
+    if (!useundo) {
+        return FALSE;
+    }
+
+    /* check if any edit is in the anchor subtree or above it */
+    agt_cfg_undo_rec_t *undo = (agt_cfg_undo_rec_t *)
+        dlq_firstEntry(&txcb->undoQ);
+    for (; undo != NULL; undo = (agt_cfg_undo_rec_t *)dlq_nextEntry(undo)) {
+        /* a merged leaf is changed in place and the new node is
+         * put back in the PDU, so use the current node if set */
+        val_value_t *editval = (undo->curnode) ? undo->curnode :
+            undo->newnode;
+        if (editval == NULL || 
+            check_edit_anchor(editval, val, ct->mustdepth)) {
+            return TRUE;
         }
 
-        if (editobj->parent && !obj_is_root(editobj->parent)) {
-            editobj = editobj->parent;
-        } else {
-            done = TRUE;
+        agt_cfg_nodeptr_t *nodeptr = (agt_cfg_nodeptr_t *)
+            dlq_firstEntry(&undo->extra_deleteQ);
+        for (; nodeptr != NULL; 
+             nodeptr = (agt_cfg_nodeptr_t *)dlq_nextEntry(nodeptr)) {
+            if (nodeptr->node && 
+                check_edit_anchor(nodeptr->node, val, ct->mustdepth)) {
+                return TRUE;
+            }
         }
     }
 
     return FALSE;
 
-} /* check_no_prune_curedit */
+} /* check_dirty_instance */
 
 
 /********************************************************************
@@ -5048,11 +5936,15 @@ static uint32
                             val_value_t *rootval,
                             uint32 curflags)
 {
-    if (curflags & AGT_TEST_FL_MUST) {
-        /* do not prune a must-stmt test since the XPath expression
-         * may reference any arbitrary data node    */
-        return curflags;
+    /* must-stmt and leafref tests can read nodes outside the
+     * subtree of this object; keep them if any top-level node
+     * they read might have changed   */
+    uint32 depflags = 
+        curflags & (AGT_TEST_FL_MUST | AGT_TEST_FL_XPATH_TYPE);
+    if (depflags && !check_changed_deps(txcb, ct, rootval, 0)) {
+        depflags = 0;
     }
+    curflags &= ~(AGT_TEST_FL_MUST | AGT_TEST_FL_XPATH_TYPE);
 
     agt_cfg_undo_rec_t *undo = NULL;
     if (txcb->cfg_id == NCX_CFGID_RUNNING) {
@@ -5075,7 +5967,7 @@ static uint32
                 undo = (agt_cfg_undo_rec_t *)dlq_firstEntry(&txcb->undoQ);
                 while (undo) {
                     if (check_no_prune_curedit(undo, ct->obj)) {
-                        return curflags;
+                        return curflags | depflags;
                     }
                     undo = (agt_cfg_undo_rec_t *)dlq_nextEntry(undo);
                 }
@@ -5093,7 +5985,7 @@ static uint32
             undo = (agt_cfg_undo_rec_t *)dlq_firstEntry(&txcb->undoQ);
             while (undo) {
                 if (check_no_prune_curedit(undo, ct->obj)) {
-                    return curflags;
+                    return curflags | depflags;
                 }
                 undo = (agt_cfg_undo_rec_t *)dlq_nextEntry(undo);
             }
@@ -5104,7 +5996,7 @@ static uint32
         } // else unknown edit-type! do not prune!
     } // else unknown config target! do not prune!
 
-    return curflags;
+    return curflags | depflags;
 
 } /* prune_obj_commit_tests */
 
@@ -5324,6 +6216,7 @@ static status_t
 *          == NULL MEANS NO RPC-ERRORS ARE RECORDED
 *   ct == commit test record to use (NULL == root test)
 *   root == docroot for XPath
+*   testmask == bitmask of the tests that are requested
 * OUTPUTS:
 *   if msghdr not NULL:
 *      msghdr->msg_errQ may have rpc_err_rec_t 
@@ -5337,11 +6230,12 @@ static status_t
     run_obj_unique_tests (ses_cb_t *scb,
                           xml_msg_hdr_t *msghdr,
                           agt_cfg_commit_test_t *ct,
-                          val_value_t *root)
+                          val_value_t *root,
+                          uint32 testmask)
 {
     status_t res = NO_ERR;
 
-    if (ct->testflags & AGT_TEST_FL_UNIQUE) {
+    if (ct->testflags & testmask & AGT_TEST_FL_UNIQUE) {
         log_debug2("\nrun unique tests for %s", ct->objpcb->exprstr);
         res = unique_stmt_check(scb, msghdr, ct, root);
     }
@@ -5351,6 +6245,394 @@ static status_t
 }  /* run_obj_unique_tests */
 
 
+/********************************************************************
+* FUNCTION add_root_check
+* 
+* Add a check to the end of a root check list
+*
+* INPUTS:
+*   list == list to add to
+*   ct == commit test record of the check
+*   valnode == instance to check; NULL for the unique-stmt tests
+*   tests == commit tests to run
+*
+* RETURNS:
+*   status
+*********************************************************************/
+static status_t
+    add_root_check (root_check_list_t *list,
+                    agt_cfg_commit_test_t *ct,
+                    val_value_t *valnode,
+                    uint32 tests)
+{
+    if (list->count == list->max) {
+        uint32 newmax = (list->max) ? list->max * 2 : 64;
+        root_check_t *newchecks = (root_check_t *)
+            m__getMem(newmax * sizeof(root_check_t));
+        if (newchecks == NULL) {
+            return ERR_INTERNAL_MEM;
+        }
+        if (list->checks) {
+            memcpy(newchecks, list->checks, 
+                   list->count * sizeof(root_check_t));
+            m__free(list->checks);
+        }
+        list->checks = newchecks;
+        list->max = newmax;
+    }
+
+    root_check_t *check = &list->checks[list->count++];
+    check->ct = ct;
+    check->valnode = valnode;
+    check->tests = tests;
+    check->recheck = TRUE;
+    return NO_ERR;
+
+}  /* add_root_check */
+
+
+/********************************************************************
+* FUNCTION write_check_indexes
+* 
+* Write a buffer of failed check indexes to the server
+*
+* INPUTS:
+*   fd == write end of the pipe to the server
+*   buff == buffer of indexes to write
+*   count == number of indexes in the buffer
+*
+* RETURNS:
+*   status
+*********************************************************************/
+static status_t
+    write_check_indexes (int fd,
+                         const uint32 *buff,
+                         uint32 count)
+{
+    const char *str = (const char *)buff;
+    size_t left = count * sizeof(uint32);
+
+    while (left > 0) {
+        ssize_t ret = write(fd, str, left);
+        if (ret < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return ERR_NCX_OPERATION_FAILED;
+        }
+        str += ret;
+        left -= (size_t)ret;
+    }
+    return NO_ERR;
+
+}  /* write_check_indexes */
+
+
+/********************************************************************
+* FUNCTION run_check_stripe
+* 
+* Run the instance checks in 1 stripe of a root check list
+* without recording any errors.  Check N is in stripe
+* (N % stripes).  The checks that fail are either marked
+* for a recheck or written to a pipe as uint32 indexes
+*
+* INPUTS:
+*   profile == agt_profile pointer
+*   scb == session control block
+*   root == root of the data tree to check
+*   list == root check list
+*   stripe == stripe to run
+*   stripes == total number of stripes
+*   fd == write end of the pipe to the server
+*      == -1 to set the recheck flags instead
+*
+* RETURNS:
+*   status of the writes to the pipe
+*********************************************************************/
+static status_t
+    run_check_stripe (agt_profile_t *profile,
+                      ses_cb_t *scb,
+                      val_value_t *root,
+                      root_check_list_t *list,
+                      uint32 stripe,
+                      uint32 stripes,
+                      int fd)
+{
+    uint32   buff[AGT_VAL_WORKER_BUFFSIZE];
+    uint32   i, count = 0;
+    status_t res = NO_ERR;
+
+    for (i = stripe; i < list->count && res == NO_ERR; i += stripes) {
+        root_check_t *check = &list->checks[i];
+        if (check->valnode == NULL) {
+            continue;
+        }
+
+        check->recheck = 
+            (run_obj_commit_tests(profile, scb, NULL, check->ct,
+                                  check->valnode, root, check->tests) 
+             != NO_ERR);
+        if (!check->recheck || fd < 0) {
+            continue;
+        }
+
+        buff[count++] = i;
+        if (count == AGT_VAL_WORKER_BUFFSIZE) {
+            res = write_check_indexes(fd, buff, count);
+            count = 0;
+        }
+    }
+
+    if (res == NO_ERR && count) {
+        res = write_check_indexes(fd, buff, count);
+    }
+    return res;
+
+}  /* run_check_stripe */
+
+
+/********************************************************************
+* FUNCTION read_check_stripe
+* 
+* Read the failed check indexes sent by a worker process
+* and wait for it to exit.  If anything goes wrong, every
+* check in its stripe is marked for a recheck
+*
+* INPUTS:
+*   list == root check list
+*   stripe == stripe run by the worker
+*   stripes == total number of stripes
+*   fd == read end of the pipe from the worker; closed
+*   pid == worker process
+*
+*********************************************************************/
+static void
+    read_check_stripe (root_check_list_t *list,
+                       uint32 stripe,
+                       uint32 stripes,
+                       int fd,
+                       pid_t pid)
+{
+    uint32   buff[AGT_VAL_WORKER_BUFFSIZE];
+    size_t   got = 0;
+    boolean  ok = TRUE;
+    int      status = 0;
+    uint32   i;
+
+    for (;;) {
+        ssize_t ret = read(fd, (char *)buff + got, sizeof(buff) - got);
+        if (ret < 0 && errno == EINTR) {
+            continue;
+        }
+        if (ret < 0) {
+            ok = FALSE;
+            break;
+        }
+        got += (size_t)ret;
+        if (ret == 0 || got == sizeof(buff)) {
+            for (i = 0; i < got / sizeof(uint32); i++) {
+                if (buff[i] < list->count) {
+                    list->checks[buff[i]].recheck = TRUE;
+                } else {
+                    ok = FALSE;
+                }
+            }
+            if (ret == 0) {
+                if (got % sizeof(uint32)) {
+                    ok = FALSE;
+                }
+                break;
+            }
+            got = 0;
+        }
+    }
+    close(fd);
+
+    while (waitpid(pid, &status, 0) < 0) {
+        if (errno != EINTR) {
+            status = -1;
+            break;
+        }
+    }
+    if (status == -1 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        ok = FALSE;
+    }
+
+    if (!ok) {
+        log_warn("\nWarning: validate worker %d failed; "
+                 "checking its nodes again", (int)pid);
+        for (i = stripe; i < list->count; i += stripes) {
+            list->checks[i].recheck = TRUE;
+        }
+    }
+
+}  /* read_check_stripe */
+
+
+/********************************************************************
+* FUNCTION run_check_workers
+* 
+* Split the instance checks of a root check list across
+* worker processes.  Each worker is forked from the server,
+* so it checks a copy-on-write snapshot of the data tree and
+* none of the global state used by XPath and the val_value_t
+* allocator is shared.  The server runs stripe 0 itself.
+* The checks that failed are marked for a recheck
+*
+* INPUTS:
+*   profile == agt_profile pointer
+*   scb == session control block
+*   root == root of the data tree to check
+*   list == root check list
+*   workers == number of stripes to split the checks into
+*
+*********************************************************************/
+static void
+    run_check_workers (agt_profile_t *profile,
+                       ses_cb_t *scb,
+                       val_value_t *root,
+                       root_check_list_t *list,
+                       uint32 workers)
+{
+    int      fds[AGT_VAL_MAX_WORKERS];
+    pid_t    pids[AGT_VAL_MAX_WORKERS];
+    uint32   i;
+
+    /* do not let a worker write out the server's buffered output */
+    fflush(NULL);
+
+    for (i = 1; i < workers; i++) {
+        int pipefds[2];
+
+        pids[i] = -1;
+        if (pipe(pipefds) != 0) {
+            log_error("\nError: pipe failed (%s)", strerror(errno));
+            continue;
+        }
+
+        pid_t pid = fork();
+        if (pid < 0) {
+            log_error("\nError: fork failed (%s)", strerror(errno));
+            close(pipefds[0]);
+            close(pipefds[1]);
+            continue;
+        }
+
+        if (pid == 0) {
+            /* worker process: check 1 stripe and exit */
+            uint32 j;
+            close(pipefds[0]);
+            for (j = 1; j < i; j++) {
+                if (pids[j] > 0) {
+                    close(fds[j]);
+                }
+            }
+            status_t res = run_check_stripe(profile, scb, root, list, i,
+                                            workers, pipefds[1]);
+            fflush(NULL);
+            _exit((res == NO_ERR) ? 0 : 1);
+        }
+
+        close(pipefds[1]);
+        fds[i] = pipefds[0];
+        pids[i] = pid;
+    }
+
+    (void)run_check_stripe(profile, scb, root, list, 0, workers, -1);
+
+    for (i = 1; i < workers; i++) {
+        if (pids[i] > 0) {
+            read_check_stripe(list, i, workers, fds[i], pids[i]);
+        }
+        /* a stripe with no worker keeps all recheck flags set */
+    }
+
+}  /* run_check_workers */
+
+
+/********************************************************************
+* FUNCTION run_root_checks
+* 
+* Run the checks in a root check list, in order.  If there
+* are enough instances, they are first checked by worker
+* processes, and only the instances that failed are checked
+* again by the server, to record the errors.  The errors are
+* the same, and in the same order, as if every check was run
+* by the server
+*
+* INPUTS:
+*   profile == agt_profile pointer
+*   scb == session control block (may be NULL; no session stats)
+*   msghdr == XML message header in progress
+*        == NULL MEANS NO RPC-ERRORS ARE RECORDED
+*   root == root of the data tree to check
+*   list == root check list
+*
+* RETURNS:
+*   status of the operation, NO_ERR if no validation errors found
+*********************************************************************/
+static status_t
+    run_root_checks (agt_profile_t *profile,
+                     ses_cb_t *scb,
+                     xml_msg_hdr_t *msghdr,
+                     val_value_t *root,
+                     root_check_list_t *list)
+{
+    status_t  res = NO_ERR, retres = NO_ERR;
+    uint32    i, instances = 0;
+
+    for (i = 0; i < list->count; i++) {
+        if (list->checks[i].valnode) {
+            list->checks[i].valnode->res = NO_ERR;
+            instances++;
+        }
+    }
+
+    uint32 workers = instances / AGT_VAL_MIN_WORKER_CHECKS;
+    if (workers > profile->agt_validate_workers) {
+        workers = profile->agt_validate_workers;
+    }
+    if (workers > AGT_VAL_MAX_WORKERS) {
+        workers = AGT_VAL_MAX_WORKERS;
+    }
+    if (workers > 1) {
+        log_debug2("\nagt_val: checking %u instances in %u processes",
+                   instances, workers);
+        run_check_workers(profile, scb, root, list, workers);
+    }
+
+    for (i = 0; i < list->count; i++) {
+        root_check_t *check = &list->checks[i];
+
+        if (check->valnode == NULL) {
+            /* the unique tests are handled all at once */
+            res = run_obj_unique_tests(scb, msghdr, check->ct, root, 
+                                       check->tests);
+            if (res != NO_ERR) {
+                profile->agt_load_rootcheck_errors = TRUE;
+                CHK_EXIT(res, retres);
+            }
+            continue;
+        }
+
+        if (!check->recheck) {
+            continue;
+        }
+
+        res = run_obj_commit_tests(profile, scb, msghdr, check->ct, 
+                                   check->valnode, root, check->tests);
+        if (res != NO_ERR) {
+            check->valnode->res = res;
+            profile->agt_load_rootcheck_errors = TRUE;
+            CHK_EXIT(res, retres);
+        }
+    }
+
+    return retres;
+
+}  /* run_root_checks */
+
+
 /******************* E X T E R N   F U N C T I O N S ***************/
 
 
@@ -5562,6 +6844,28 @@ status_t
         CHK_EXIT(res, retres);
     }
 
+    /* count the edits of a candidate <edit-config>, up to
+     * 1 more than the most that are scanned for each instance  */
+    boolean useundo = (txcb->cfg_id == NCX_CFGID_CANDIDATE &&
+                       txcb->edit_type == AGT_CFG_EDIT_TYPE_PARTIAL);
+    uint32 undocount = 0;
+    if (useundo) {
+        agt_cfg_undo_rec_t *undo = (agt_cfg_undo_rec_t *)
+            dlq_firstEntry(&txcb->undoQ);
+        for (; undo != NULL && undocount <= AGT_VAL_MAX_UNDO_SCAN;
+             undo = (agt_cfg_undo_rec_t *)dlq_nextEntry(undo)) {
+            undocount++;
+        }
+    } else {
+        undocount = AGT_VAL_MAX_UNDO_SCAN + 1;
+    }
+
+    /* with --validate-workers, the checks are queued and run
+     * after all the instances of every object have been found */
+    root_check_list_t list;
+    memset(&list, 0x0, sizeof(root_check_list_t));
+    boolean usework = (profile->agt_validate_workers > 1);
+
     /* go through all the commit test objects that might need
      * to be checked for this commit    */
     agt_cfg_commit_test_t *ct = (agt_cfg_commit_test_t *)
@@ -5575,8 +6879,22 @@ status_t
          * on the running config, because otherwise there will
          * not be any edits recorded in the txcb->undoQ or any
          * nodes marked dirty in val->flags     */
+        boolean dirtyonly = FALSE;
         if (profile->agt_config_state == AGT_CFG_STATE_OK) {
             tests = prune_obj_commit_tests(txcb, ct, root, tests);
+
+            /* a local must-stmt only needs to be run on the
+             * instances in or below an edited subtree, unless some
+             * other top-level node it reads has changed; the
+             * <commit> and candidate <validate> checks have all
+             * the edits marked with dirty flags, and a candidate
+             * <edit-config> also has the edits in the undoQ   */
+            dirtyonly = (tests & AGT_TEST_FL_MUST) && ct->mustlocal &&
+                ((txcb->cfg_id == NCX_CFGID_RUNNING && txcb->commitcheck) ||
+                 (txcb->cfg_id == NCX_CFGID_CANDIDATE &&
+                  (txcb->edit_type == AGT_CFG_EDIT_TYPE_FULL || 
+                   undocount <= AGT_VAL_MAX_UNDO_SCAN))) &&
+                !check_changed_deps(txcb, ct, root, 1);
         }
 
         if (tests == 0) {
@@ -5591,6 +6909,9 @@ status_t
 
         res = prep_commit_test_node(scb, msghdr, txcb, ct, root);
         if (res != NO_ERR) {
+            if (terminate_parse(res) && list.checks) {
+                m__free(list.checks);
+            }
             CHK_EXIT(res, retres);
             continue;
         }
@@ -5600,9 +6921,21 @@ status_t
         for (; resnode != NULL; resnode = xpath_get_next_resnode(resnode)) {
 
             val_value_t *valnode = xpath_get_resnode_valptr(resnode);
+            uint32 valtests = tests;
+            if (dirtyonly && 
+                !check_dirty_instance(txcb, ct, valnode, useundo)) {
+                valtests &= ~AGT_TEST_FL_MUST;
+            }
+            if (usework) {
+                res = add_root_check(&list, ct, valnode, valtests);
+                if (res != NO_ERR) {
+                    break;
+                }
+                continue;
+            }
             valnode->res = NO_ERR;
             res = run_obj_commit_tests(profile, scb, msghdr, ct, valnode, 
-                                       root, tests);
+                                       root, valtests);
             if (res != NO_ERR) {
                 valnode->res = res;
                 profile->agt_load_rootcheck_errors = TRUE;
@@ -5612,13 +6945,33 @@ status_t
 
         /* check if any unique tests, which are handled all at once
          * instead of one instance at a time  */
-        res = run_obj_unique_tests(scb, msghdr, ct, root);
+        if (usework) {
+            if (res == NO_ERR) {
+                res = add_root_check(&list, ct, NULL, tests);
+            }
+            if (res != NO_ERR) {
+                if (list.checks) {
+                    m__free(list.checks);
+                }
+                return res;
+            }
+            continue;
+        }
+        res = run_obj_unique_tests(scb, msghdr, ct, root, tests);
         if (res != NO_ERR) {
             profile->agt_load_rootcheck_errors = TRUE;
             CHK_EXIT(res, retres);
         }
     }
 
+    if (usework) {
+        res = run_root_checks(profile, scb, msghdr, root, &list);
+        if (list.checks) {
+            m__free(list.checks);
+        }
+        CHK_EXIT(res, retres);
+    }
+
     log_debug3("\nagt_val_root_check: end");
 
     return retres;
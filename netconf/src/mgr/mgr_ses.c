@@ -1638,6 +1638,7 @@ status_t
             }
         }
 
+        scb->outcnt--;
         ses_msg_free_buff(scb, buff);
 
         if (res == NO_ERR) {
@@ -0,0 +1,315 @@
+/*  FILE: getcb.c
+
+   Bulk get callbacks for virtual nodes
+
+   A bulk callback collects the data for all instances of
+   a list or container object at once.  The snapshot it
+   returns is shared by the get callbacks of the virtual
+   nodes until getcb_snapshot_end is called.
+
+*********************************************************************
+*                                                                   *
+*                     I N C L U D E    F I L E S                    *
+*                                                                   *
+*********************************************************************/
+#include <stdlib.h>
+#include <string.h>
+
+#include "procdefs.h"
+#include "dlq.h"
+#include "getcb.h"
+#include "log.h"
+#include "obj.h"
+#include "status.h"
+
+
+/********************************************************************
+*                                                                   *
+*                           T Y P E S                               *
+*                                                                   *
+*********************************************************************/
+
+/* one bulk callback registration and its current snapshot */
+typedef struct getcb_bulk_t_ {
+    dlq_hdr_t                 qhdr;
+    obj_template_t           *obj;
+    getcb_bulk_fn_t           bulkfn;
+    getcb_snapshot_free_fn_t  freefn;
+    void                     *snapshot;
+    boolean                   shared;
+} getcb_bulk_t;
+
+
+/********************************************************************
+*                                                                   *
+*                       V A R I A B L E S                           *
+*                                                                   *
+*********************************************************************/
+
+static boolean    getcb_init_done = FALSE;
+
+/* Q of getcb_bulk_t */
+static dlq_hdr_t  getcb_bulkQ;
+
+/* getcb_snapshot_begin nesting level */
+static uint32     getcb_snapshot_depth = 0;
+
+
+/********************************************************************
+* FUNCTION find_bulk
+*
+* Find the bulk callback registration for an object
+*
+* INPUTS:
+*   obj == object to find
+*
+* RETURNS:
+*   pointer to the registration or NULL if not found
+*********************************************************************/
+static getcb_bulk_t *
+    find_bulk (const obj_template_t *obj)
+{
+    getcb_bulk_t  *bulk;
+
+    if (!getcb_init_done) {
+        return NULL;
+    }
+
+    for (bulk = (getcb_bulk_t *)dlq_firstEntry(&getcb_bulkQ);
+         bulk != NULL;
+         bulk = (getcb_bulk_t *)dlq_nextEntry(bulk)) {
+        if (bulk->obj == obj) {
+            return bulk;
+        }
+    }
+    return NULL;
+
+}  /* find_bulk */
+
+
+/********************************************************************
+* FUNCTION free_snapshot
+*
+* Free the current snapshot of a bulk callback registration
+*
+* INPUTS:
+*   bulk == registration to use
+*********************************************************************/
+static void
+    free_snapshot (getcb_bulk_t *bulk)
+{
+    if (bulk->snapshot) {
+        (*bulk->freefn)(bulk->snapshot);
+        bulk->snapshot = NULL;
+    }
+    bulk->shared = FALSE;
+
+}  /* free_snapshot */
+
+
+/**************    E X T E R N A L   F U N C T I O N S **********/
+
+
+/********************************************************************
+* FUNCTION getcb_register_bulk
+*
+* Register a bulk collection callback for an object
+*
+* INPUTS:
+*   obj == list or container object to register for
+*   bulkfn == callback collecting the data for all instances
+*   freefn == callback freeing the returned snapshot
+*
+* RETURNS:
+*   status
+*********************************************************************/
+status_t
+    getcb_register_bulk (obj_template_t *obj,
+                         getcb_bulk_fn_t bulkfn,
+                         getcb_snapshot_free_fn_t freefn)
+{
+    getcb_bulk_t  *bulk;
+
+#ifdef DEBUG
+    if (!obj || !bulkfn || !freefn) {
+        return SET_ERROR(ERR_INTERNAL_PTR);
+    }
+#endif
+
+    if (!getcb_init_done) {
+        dlq_createSQue(&getcb_bulkQ);
+        getcb_init_done = TRUE;
+    }
+
+    if (find_bulk(obj)) {
+        return ERR_NCX_DUP_ENTRY;
+    }
+
+    bulk = m__getObj(getcb_bulk_t);
+    if (!bulk) {
+        return ERR_INTERNAL_MEM;
+    }
+    memset(bulk, 0x0, sizeof(getcb_bulk_t));
+    bulk->obj = obj;
+    bulk->bulkfn = bulkfn;
+    bulk->freefn = freefn;
+    dlq_enque(bulk, &getcb_bulkQ);
+
+    return NO_ERR;
+
+}  /* getcb_register_bulk */
+
+
+/********************************************************************
+* FUNCTION getcb_unregister_bulk
+*
+* Unregister the bulk collection callback for an object
+* and free its snapshot, if any
+*
+* INPUTS:
+*   obj == object to unregister
+*********************************************************************/
+void
+    getcb_unregister_bulk (obj_template_t *obj)
+{
+    getcb_bulk_t  *bulk;
+
+    bulk = find_bulk(obj);
+    if (bulk) {
+        dlq_remove(bulk);
+        free_snapshot(bulk);
+        m__free(bulk);
+    }
+
+}  /* getcb_unregister_bulk */
+
+
+/********************************************************************
+* FUNCTION getcb_get_snapshot
+*
+* Get the current snapshot for an object
+*
+* Between getcb_snapshot_begin and getcb_snapshot_end, the
+* bulk callback is called once and the snapshot is shared
+* by all callers.  Otherwise the bulk callback is called
+* every time, and the returned snapshot is valid until the
+* next call for the same object.
+*
+* INPUTS:
+*   scb == session that issued the get (may be NULL)
+*   obj == object registered with getcb_register_bulk
+*   res == address of return status
+*
+* OUTPUTS:
+*   *res == return status
+*
+* RETURNS:
+*   snapshot returned by the bulk callback; DO NOT FREE
+*   NULL if some error
+*********************************************************************/
+void *
+    getcb_get_snapshot (ses_cb_t *scb,
+                        obj_template_t *obj,
+                        status_t *res)
+{
+    getcb_bulk_t  *bulk;
+
+    bulk = find_bulk(obj);
+    if (!bulk) {
+        *res = SET_ERROR(ERR_NCX_DEF_NOT_FOUND);
+        return NULL;
+    }
+
+    if (bulk->shared) {
+        *res = NO_ERR;
+        return bulk->snapshot;
+    }
+
+    free_snapshot(bulk);
+
+    *res = (*bulk->bulkfn)(scb, obj, &bulk->snapshot);
+    if (*res != NO_ERR) {
+        free_snapshot(bulk);
+        return NULL;
+    }
+
+    if (getcb_snapshot_depth) {
+        bulk->shared = TRUE;
+    }
+
+    if (LOGDEBUG4) {
+        log_debug4("\ngetcb: new snapshot for '%s'", obj_get_name(obj));
+    }
+
+    return bulk->snapshot;
+
+}  /* getcb_get_snapshot */
+
+
+/********************************************************************
+* FUNCTION getcb_snapshot_begin
+*
+* Start sharing snapshots, e.g. for the duration of one request
+* Calls can be nested
+*********************************************************************/
+void
+    getcb_snapshot_begin (void)
+{
+    getcb_snapshot_depth++;
+
+}  /* getcb_snapshot_begin */
+
+
+/********************************************************************
+* FUNCTION getcb_snapshot_end
+*
+* Stop sharing snapshots started with getcb_snapshot_begin
+* All snapshots are freed after the outermost call
+*********************************************************************/
+void
+    getcb_snapshot_end (void)
+{
+    getcb_bulk_t  *bulk;
+
+    if (getcb_snapshot_depth == 0) {
+        SET_ERROR(ERR_INTERNAL_INIT_SEQ);
+        return;
+    }
+
+    if (--getcb_snapshot_depth || !getcb_init_done) {
+        return;
+    }
+
+    for (bulk = (getcb_bulk_t *)dlq_firstEntry(&getcb_bulkQ);
+         bulk != NULL;
+         bulk = (getcb_bulk_t *)dlq_nextEntry(bulk)) {
+        free_snapshot(bulk);
+    }
+
+}  /* getcb_snapshot_end */
+
+
+/********************************************************************
+* FUNCTION getcb_cleanup
+*
+* Free all bulk callback registrations and snapshots
+*********************************************************************/
+void
+    getcb_cleanup (void)
+{
+    getcb_bulk_t  *bulk;
+
+    if (getcb_init_done) {
+        while (!dlq_empty(&getcb_bulkQ)) {
+            bulk = (getcb_bulk_t *)dlq_deque(&getcb_bulkQ);
+            free_snapshot(bulk);
+            m__free(bulk);
+        }
+        getcb_init_done = FALSE;
+    }
+    getcb_snapshot_depth = 0;
+
+}  /* getcb_cleanup */
+
+
+/* END getcb.c */
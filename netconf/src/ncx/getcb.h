@@ -39,6 +39,17 @@
 
       Retrieve the simple value contents of a virtual value leaf node
 
+    Bulk callbacks:
+
+      A getcb_bulk_fn_t callback is registered for a list or
+      container object.  It collects the data for all instances
+      of that object in one call and returns it as a snapshot.
+      The get callbacks of the virtual nodes use getcb_get_snapshot
+      to share that snapshot, instead of collecting the data
+      again for every instance.  A snapshot is kept until
+      getcb_snapshot_end is called, which is done after each
+      request by the server.
+
 
 *********************************************************************
 *								    *
@@ -56,6 +67,10 @@ date	     init     comment
 #include "ncxconst.h"
 #endif
 
+#ifndef _H_obj
+#include "obj.h"
+#endif
+
 #ifndef _H_rpc
 #include "rpc.h"
 #endif
@@ -117,6 +132,136 @@ typedef status_t
 		   const val_value_t *virval,
 		   val_value_t *dstval);
 
+
+/* getcb_bulk_fn_t
+ *
+ * Bulk collection callback for a list or container object
+ * 
+ * INPUTS:
+ *   scb    == session that issued the get (may be NULL)
+ *   obj    == object the callback is registered for
+ *   snapshot == address of return snapshot
+ *
+ * OUTPUTS:
+ *   *snapshot == malloced data for all instances of obj;
+ *      freed with the registered getcb_snapshot_free_fn_t
+ *
+ * RETURNS:
+ *    status:
+ */
+typedef status_t 
+    (*getcb_bulk_fn_t) (ses_cb_t *scb,
+                        obj_template_t *obj,
+                        void **snapshot);
+
+
+/* getcb_snapshot_free_fn_t
+ *
+ * Free a snapshot returned by a getcb_bulk_fn_t callback
+ * 
+ * INPUTS:
+ *   snapshot == snapshot to free
+ */
+typedef void 
+    (*getcb_snapshot_free_fn_t) (void *snapshot);
+
+
+/********************************************************************
+*								    *
+*			F U N C T I O N S			    *
+*								    *
+*********************************************************************/
+
+
+/********************************************************************
+* FUNCTION getcb_register_bulk
+* 
+* Register a bulk collection callback for an object
+*
+* INPUTS:
+*   obj == list or container object to register for
+*   bulkfn == callback collecting the data for all instances
+*   freefn == callback freeing the returned snapshot
+*
+* RETURNS:
+*   status
+*********************************************************************/
+extern status_t
+    getcb_register_bulk (obj_template_t *obj,
+                         getcb_bulk_fn_t bulkfn,
+                         getcb_snapshot_free_fn_t freefn);
+
+
+/********************************************************************
+* FUNCTION getcb_unregister_bulk
+* 
+* Unregister the bulk collection callback for an object
+* and free its snapshot, if any
+*
+* INPUTS:
+*   obj == object to unregister
+*********************************************************************/
+extern void
+    getcb_unregister_bulk (obj_template_t *obj);
+
+
+/********************************************************************
+* FUNCTION getcb_get_snapshot
+* 
+* Get the current snapshot for an object
+*
+* Between getcb_snapshot_begin and getcb_snapshot_end, the
+* bulk callback is called once and the snapshot is shared
+* by all callers.  Otherwise the bulk callback is called
+* every time, and the returned snapshot is valid until the
+* next call for the same object.
+*
+* INPUTS:
+*   scb == session that issued the get (may be NULL)
+*   obj == object registered with getcb_register_bulk
+*   res == address of return status
+*
+* OUTPUTS:
+*   *res == return status
+*
+* RETURNS:
+*   snapshot returned by the bulk callback; DO NOT FREE
+*   NULL if some error
+*********************************************************************/
+extern void *
+    getcb_get_snapshot (ses_cb_t *scb,
+                        obj_template_t *obj,
+                        status_t *res);
+
+
+/********************************************************************
+* FUNCTION getcb_snapshot_begin
+* 
+* Start sharing snapshots, e.g. for the duration of one request
+* Calls can be nested
+*********************************************************************/
+extern void
+    getcb_snapshot_begin (void);
+
+
+/********************************************************************
+* FUNCTION getcb_snapshot_end
+* 
+* Stop sharing snapshots started with getcb_snapshot_begin
+* All snapshots are freed after the outermost call
+*********************************************************************/
+extern void
+    getcb_snapshot_end (void);
+
+
+/********************************************************************
+* FUNCTION getcb_cleanup
+* 
+* Free all bulk callback registrations and snapshots
+*********************************************************************/
+extern void
+    getcb_cleanup (void);
+
 #ifdef __cplusplus
 }  /* end extern 'C' */
 #endif
@@ -57,6 +57,27 @@ date         init     comment
 #endif
 
 
+/********************************************************************
+* FUNCTION write_json_name
+* 
+* Write the name of a JSON object member, including the ':'
+*
+* INPUTS:
+*   scb == session control block
+*   name == member name to write
+*
+*********************************************************************/
+static void
+    write_json_name (ses_cb_t *scb,
+                     const xmlChar *name)
+{
+    ses_putchar(scb, '"');
+    ses_putjstr(scb, name, -1);
+    ses_putspan(scb, (const xmlChar *)"\":", 2);
+
+} /* write_json_name */
+
+
 /********************************************************************
 * FUNCTION write_json_string_value
 * 
@@ -141,10 +162,7 @@ static status_t
             write_json_string_value(scb, out);
         } else {
             /* write the name of the node */
-            ses_putchar(scb, '"');
-            ses_putjstr(scb, out->name, -1);
-            ses_putchar(scb, '"');
-            ses_putchar(scb, ':');
+            write_json_name(scb, out->name);
 
             switch (out->btyp) {
             case NCX_BT_EXTERN:
@@ -194,10 +212,7 @@ static status_t
 
         /* render a complex type; either an object or an array */
         if (isfirstchild) {
-            ses_putchar(scb, '"');
-            ses_putjstr(scb, out->name, -1);
-            ses_putchar(scb, '"');
-            ses_putchar(scb, ':');
+            write_json_name(scb, out->name);
 
             if (!justone) {
                 ses_putchar(scb, '[');
@@ -214,11 +229,14 @@ static status_t
 
             /* JSON ignores XML namespaces, so foo:a and bar:a
              * are both encoded in the same array
+             * Only the first entry of an array needs the instance
+             * count; the rest are known to be part of an array
              */
-            uint32 childcnt = val_instance_count(out, NULL, chval->name);
             boolean firstchild = 
                 (lastch && !xml_strcmp(lastch->name, chval->name)) ?
                 FALSE : TRUE;
+            uint32 childcnt = (firstchild) ?
+                val_instance_count(out, NULL, chval->name) : 2;
 
             lastch = chval;
             nextch = val_get_next_child(chval);
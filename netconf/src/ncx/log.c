@@ -27,6 +27,10 @@ date         init     comment
 *                                                                   *
 *********************************************************************/
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <signal.h>
 
 #include "procdefs.h"
 #include "log.h"
@@ -44,6 +48,9 @@ date         init     comment
 
 /* #define LOG_DEBUG_TRACE 1 */
 
+/* records up to this size are formatted on the stack */
+#define LOG_ASYNC_RECSIZE   512
+
 /********************************************************************
 *                                                                   *
 *                       V A R I A B L E S                           *
@@ -65,6 +72,320 @@ static FILE *altlogfile = NULL;
 
 static FILE *auditlogfile = NULL;
 
+/* asynchronous logfile output
+ * The mutex protects all the log_async_ variables below.
+ * Callers hold it only to copy a formatted record into
+ * the ring buffer; the writer thread holds it only to
+ * pick up the next batch and to advance log_async_rpos.
+ * The positions are byte counts since log_async_start,
+ * so the fill level is log_async_wpos - log_async_rpos
+ */
+static pthread_mutex_t log_async_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static pthread_cond_t log_async_datacond = PTHREAD_COND_INITIALIZER;
+
+static pthread_cond_t log_async_spacecond = PTHREAD_COND_INITIALIZER;
+
+static pthread_t     log_async_thread;
+
+static log_async_t   log_async_mode = LOG_ASYNC_OFF;
+
+static boolean       log_async_stopping = FALSE;
+
+static boolean       log_async_atfork_done = FALSE;
+
+static char         *log_async_buff = NULL;
+
+static uint32        log_async_buffsize = 0;
+
+static uint64        log_async_wpos = 0;
+
+static uint64        log_async_rpos = 0;
+
+static uint64        log_async_dropped = 0;
+
+
+/********************************************************************
+* FUNCTION write_logfile
+*
+* Write a formatted record to the logfile and flush it
+*
+* INPUTS:
+*   buff == record to write
+*   len == number of bytes in buff
+*********************************************************************/
+static void
+    write_logfile (const char *buff,
+                   uint32 len)
+{
+    if (logfile) {
+        fwrite(buff, 1, len, logfile);
+        fflush(logfile);
+    }
+
+}  /* write_logfile */
+
+
+/********************************************************************
+* FUNCTION async_writer
+*
+* Writer thread started by log_async_start
+* Writes everything in the ring buffer as 1 batch,
+* then waits for more records until log_async_stop
+*
+* INPUTS:
+*   arg == not used
+*
+* RETURNS:
+*   NULL
+*********************************************************************/
+static void *
+    async_writer (void *arg)
+{
+    uint64  startpos, endpos;
+    uint32  offset, len;
+
+    (void)arg;
+
+    pthread_mutex_lock(&log_async_lock);
+    for (;;) {
+        while (log_async_wpos == log_async_rpos && !log_async_stopping) {
+            pthread_cond_wait(&log_async_datacond, &log_async_lock);
+        }
+        if (log_async_wpos == log_async_rpos) {
+            break;
+        }
+        startpos = log_async_rpos;
+        endpos = log_async_wpos;
+        pthread_mutex_unlock(&log_async_lock);
+
+        /* the ring bytes between startpos and endpos are not
+         * changed by callers until log_async_rpos moves;
+         * the FILE lock is held until the flush is done, so
+         * fork never copies a partly written stdio buffer
+         */
+        offset = (uint32)(startpos % log_async_buffsize);
+        len = (uint32)(endpos - startpos);
+        flockfile(logfile);
+        if (offset + len > log_async_buffsize) {
+            fwrite(&log_async_buff[offset], 1,
+                   log_async_buffsize - offset, logfile);
+            len -= log_async_buffsize - offset;
+            offset = 0;
+        }
+        fwrite(&log_async_buff[offset], 1, len, logfile);
+        fflush(logfile);
+        funlockfile(logfile);
+
+        pthread_mutex_lock(&log_async_lock);
+        log_async_rpos = endpos;
+        pthread_cond_broadcast(&log_async_spacecond);
+    }
+    pthread_mutex_unlock(&log_async_lock);
+
+    return NULL;
+
+}  /* async_writer */
+
+
+/********************************************************************
+* FUNCTION async_enque
+*
+* Copy a formatted record into the ring buffer
+* Writes the record right away if the writer thread is
+* not running or the record does not fit in the buffer
+*
+* INPUTS:
+*   buff == record to write
+*   len == number of bytes in buff
+*********************************************************************/
+static void
+    async_enque (const char *buff,
+                 uint32 len)
+{
+    uint32   offset, used;
+    boolean  wasempty;
+
+    pthread_mutex_lock(&log_async_lock);
+
+    if (log_async_mode == LOG_ASYNC_OFF) {
+        write_logfile(buff, len);
+        pthread_mutex_unlock(&log_async_lock);
+        return;
+    }
+
+    if (len > log_async_buffsize) {
+        /* keep the record order; write it after the buffer */
+        while (log_async_wpos != log_async_rpos) {
+            pthread_cond_wait(&log_async_spacecond, &log_async_lock);
+        }
+        write_logfile(buff, len);
+        pthread_mutex_unlock(&log_async_lock);
+        return;
+    }
+
+    while (log_async_buffsize - 
+           (uint32)(log_async_wpos - log_async_rpos) < len) {
+        if (log_async_mode == LOG_ASYNC_DROP) {
+            log_async_dropped++;
+            pthread_mutex_unlock(&log_async_lock);
+            return;
+        }
+        pthread_cond_wait(&log_async_spacecond, &log_async_lock);
+    }
+
+    wasempty = (log_async_wpos == log_async_rpos);
+    offset = (uint32)(log_async_wpos % log_async_buffsize);
+    used = 0;
+    if (offset + len > log_async_buffsize) {
+        used = log_async_buffsize - offset;
+        memcpy(&log_async_buff[offset], buff, used);
+        offset = 0;
+    }
+    memcpy(&log_async_buff[offset], &buff[used], len - used);
+    log_async_wpos += len;
+
+    /* the writer only waits when the buffer is empty */
+    if (wasempty) {
+        pthread_cond_signal(&log_async_datacond);
+    }
+
+    pthread_mutex_unlock(&log_async_lock);
+
+}  /* async_enque */
+
+
+/********************************************************************
+* FUNCTION async_write
+*
+* Format a log record and add it to the ring buffer
+*
+* INPUTS:
+*   fstr == format string in printf format
+*   args == additional arguments for printf
+*********************************************************************/
+static void
+    async_write (const char *fstr,
+                 va_list args)
+{
+    char     stackbuff[LOG_ASYNC_RECSIZE];
+    char    *buff;
+    va_list  args2;
+    int      len;
+
+    va_copy(args2, args);
+    len = vsnprintf(stackbuff, sizeof(stackbuff), fstr, args2);
+    va_end(args2);
+
+    if (len <= 0) {
+        return;
+    }
+
+    if (len < (int)sizeof(stackbuff)) {
+        async_enque(stackbuff, (uint32)len);
+        return;
+    }
+
+    buff = m__getMem((size_t)len + 1);
+    if (!buff) {
+        return;
+    }
+    vsnprintf(buff, (size_t)len + 1, fstr, args);
+    async_enque(buff, (uint32)len);
+    m__free(buff);
+
+}  /* async_write */
+
+
+/********************************************************************
+* FUNCTION write_log
+*
+* Write a log record to the logfile or STDOUT
+*
+* INPUTS:
+*   fstr == format string in printf format
+*   args == additional arguments for printf
+*********************************************************************/
+static void
+    write_log (const char *fstr,
+               va_list args)
+{
+    if (logfile) {
+        if (log_async_mode != LOG_ASYNC_OFF) {
+            async_write(fstr, args);
+        } else {
+            vfprintf(logfile, fstr, args);
+            fflush(logfile);
+        }
+    } else {
+        vprintf(fstr, args);
+        fflush(stdout);
+    }
+
+}  /* write_log */
+
+
+/********************************************************************
+* FUNCTION async_atfork_prepare
+*
+* Called before fork; waits for the writer thread to finish
+* any batch it is writing and keeps it from starting another
+*********************************************************************/
+static void
+    async_atfork_prepare (void)
+{
+    pthread_mutex_lock(&log_async_lock);
+    if (logfile) {
+        flockfile(logfile);
+    }
+
+}  /* async_atfork_prepare */
+
+
+/********************************************************************
+* FUNCTION async_atfork_parent
+*
+* Called in the parent after fork
+*********************************************************************/
+static void
+    async_atfork_parent (void)
+{
+    if (logfile) {
+        funlockfile(logfile);
+    }
+    pthread_mutex_unlock(&log_async_lock);
+
+}  /* async_atfork_parent */
+
+
+/********************************************************************
+* FUNCTION async_atfork_child
+*
+* Called in the child after fork
+* The writer thread does not exist in the child, so the
+* child writes its own records right away.  Records still
+* in the buffer are written by the parent, not the child.
+*********************************************************************/
+static void
+    async_atfork_child (void)
+{
+    if (logfile) {
+        funlockfile(logfile);
+    }
+    pthread_mutex_init(&log_async_lock, NULL);
+    pthread_cond_init(&log_async_datacond, NULL);
+    pthread_cond_init(&log_async_spacecond, NULL);
+    if (log_async_buff) {
+        m__free(log_async_buff);
+        log_async_buff = NULL;
+    }
+    log_async_buffsize = 0;
+    log_async_wpos = log_async_rpos = 0;
+    log_async_stopping = FALSE;
+    log_async_mode = LOG_ASYNC_OFF;
+
+}  /* async_atfork_child */
+
 
 /********************************************************************
 * FUNCTION log_open
@@ -141,6 +462,8 @@ void
         return;
     }
 
+    log_async_stop();
+
     if (use_tstamps) {
         tstamp_datetime(buff);
         fprintf(logfile, "\n*** log close at %s ***\n", buff);
@@ -365,13 +688,7 @@ void
 
     va_start(args, fstr);
 
-    if (logfile) {
-        vfprintf(logfile, fstr, args);
-        fflush(logfile);
-    } else {
-        vprintf(fstr, args);
-        fflush(stdout);
-    }
+    write_log(fstr, args);
 
     va_end(args);
 
@@ -472,13 +789,7 @@ void vlog_error (const char *fstr, va_list args )
         return;
     }
 
-    if (logfile) {
-        vfprintf(logfile, fstr, args);
-        fflush(logfile);
-    } else {
-        vprintf(fstr, args);
-        fflush(stdout);
-    }
+    write_log(fstr, args);
 }  /* log_error */
 
 /********************************************************************
@@ -523,13 +834,7 @@ void
 
     va_start(args, fstr);
 
-    if (logfile) {
-        vfprintf(logfile, fstr, args);
-        fflush(logfile);
-    } else {
-        vprintf(fstr, args);
-        fflush(stdout);
-    }
+    write_log(fstr, args);
 
     va_end(args);
 
@@ -557,13 +862,7 @@ void
 
     va_start(args, fstr);
 
-    if (logfile) {
-        vfprintf(logfile, fstr, args);
-        fflush(logfile);
-    } else {
-        vprintf(fstr, args);
-        fflush(stdout);
-    }
+    write_log(fstr, args);
 
     va_end(args);
 
@@ -591,13 +890,7 @@ void
 
     va_start(args, fstr);
 
-    if (logfile) {
-        vfprintf(logfile, fstr, args);
-        fflush(logfile);
-    } else {
-        vprintf(fstr, args);
-        fflush(stdout);
-    }
+    write_log(fstr, args);
 
     va_end(args);
 
@@ -625,13 +918,7 @@ void
 
     va_start(args, fstr);
 
-    if (logfile) {
-        vfprintf(logfile, fstr, args);
-        fflush(logfile);
-    } else {
-        vprintf(fstr, args);
-        fflush(stdout);
-    }
+    write_log(fstr, args);
 
     va_end(args);
 
@@ -659,13 +946,7 @@ void
 
     va_start(args, fstr);
 
-    if (logfile) {
-        vfprintf(logfile, fstr, args);
-        fflush(logfile);
-    } else {
-        vprintf(fstr, args);
-        fflush(stdout);
-    }
+    write_log(fstr, args);
 
     va_end(args);
 
@@ -693,13 +974,7 @@ void
 
     va_start(args, fstr);
 
-    if (logfile) {
-        vfprintf(logfile, fstr, args);
-        fflush(logfile);
-    } else {
-        vprintf(fstr, args);
-        fflush(stdout);
-    }
+    write_log(fstr, args);
 
     va_end(args);
 
@@ -882,13 +1157,8 @@ boolean
 void
     log_indent (int32 indentcnt)
 {
-    int32  i;
-
     if (indentcnt >= 0) {
-        log_write("\n");
-        for (i=0; i<indentcnt; i++) {
-            log_write(" ");
-        }
+        log_write("\n%*s", (int)indentcnt, "");
     }
 
 } /* log_indent */
@@ -923,6 +1193,7 @@ void
 * 
 * Get the open logfile for direct output
 * Needed by libtecla to write command line history
+* Any buffered asynchronous log records are written first
 *
 * RETURNS:
 *   pointer to open FILE if any
@@ -931,9 +1202,273 @@ void
 FILE *
     log_get_logfile (void)
 {
+    log_async_flush();
     return logfile;
 
 }  /* log_get_logfile */
 
 
+/********************************************************************
+* FUNCTION log_async_start
+* 
+* Start writing the logfile from a background thread
+* Only used if a logfile is open; STDOUT is always
+* written right away
+*
+* INPUTS:
+*    mode == LOG_ASYNC_BLOCK or LOG_ASYNC_DROP
+*    buffsize == size of the log buffer in bytes
+*
+* RETURNS:
+*    status
+*********************************************************************/
+status_t
+    log_async_start (log_async_t mode,
+                     uint32 buffsize)
+{
+    sigset_t  allsigs, oldsigs;
+    char     *buff;
+    int       ret;
+
+    if (mode != LOG_ASYNC_BLOCK && mode != LOG_ASYNC_DROP) {
+        return SET_ERROR(ERR_INTERNAL_VAL);
+    }
+    if (buffsize == 0) {
+        return ERR_NCX_INVALID_VALUE;
+    }
+    if (!logfile) {
+        return ERR_NCX_OPERATION_FAILED;
+    }
+    if (log_async_mode != LOG_ASYNC_OFF) {
+        return ERR_NCX_DATA_EXISTS;
+    }
+
+    buff = m__getMem(buffsize);
+    if (!buff) {
+        return ERR_INTERNAL_MEM;
+    }
+
+    if (!log_async_atfork_done) {
+        if (pthread_atfork(async_atfork_prepare,
+                           async_atfork_parent,
+                           async_atfork_child) != 0) {
+            m__free(buff);
+            return ERR_NCX_OPERATION_FAILED;
+        }
+        log_async_atfork_done = TRUE;
+    }
+
+    fflush(logfile);
+
+    pthread_mutex_lock(&log_async_lock);
+    log_async_buff = buff;
+    log_async_buffsize = buffsize;
+    log_async_wpos = log_async_rpos = 0;
+    log_async_stopping = FALSE;
+    log_async_mode = mode;
+    pthread_mutex_unlock(&log_async_lock);
+
+    /* signals are handled by the threads that log, not the writer */
+    sigfillset(&allsigs);
+    pthread_sigmask(SIG_SETMASK, &allsigs, &oldsigs);
+    ret = pthread_create(&log_async_thread, NULL, async_writer, NULL);
+    pthread_sigmask(SIG_SETMASK, &oldsigs, NULL);
+
+    if (ret != 0) {
+        pthread_mutex_lock(&log_async_lock);
+        log_async_mode = LOG_ASYNC_OFF;
+        log_async_buff = NULL;
+        log_async_buffsize = 0;
+        pthread_mutex_unlock(&log_async_lock);
+        m__free(buff);
+        return ERR_NCX_OPERATION_FAILED;
+    }
+
+    return NO_ERR;
+
+}  /* log_async_start */
+
+
+/********************************************************************
+* FUNCTION log_async_stop
+* 
+* Write out the log buffer and stop the writer thread
+* Called by log_close
+*
+*********************************************************************/
+void
+    log_async_stop (void)
+{
+    uint32   offset, len;
+
+    pthread_mutex_lock(&log_async_lock);
+    if (log_async_mode == LOG_ASYNC_OFF) {
+        pthread_mutex_unlock(&log_async_lock);
+        return;
+    }
+    log_async_stopping = TRUE;
+    pthread_cond_signal(&log_async_datacond);
+    pthread_mutex_unlock(&log_async_lock);
+
+    pthread_join(log_async_thread, NULL);
+
+    /* write any records added after the writer exited */
+    pthread_mutex_lock(&log_async_lock);
+    if (log_async_wpos != log_async_rpos) {
+        offset = (uint32)(log_async_rpos % log_async_buffsize);
+        len = (uint32)(log_async_wpos - log_async_rpos);
+        if (offset + len > log_async_buffsize) {
+            write_logfile(&log_async_buff[offset],
+                          log_async_buffsize - offset);
+            len -= log_async_buffsize - offset;
+            offset = 0;
+        }
+        write_logfile(&log_async_buff[offset], len);
+    }
+    if (log_async_dropped && logfile) {
+        fprintf(logfile, "\n*** %llu log records dropped ***\n",
+                (unsigned long long)log_async_dropped);
+        fflush(logfile);
+    }
+    m__free(log_async_buff);
+    log_async_buff = NULL;
+    log_async_buffsize = 0;
+    log_async_wpos = log_async_rpos = 0;
+    log_async_stopping = FALSE;
+    log_async_mode = LOG_ASYNC_OFF;
+    pthread_mutex_unlock(&log_async_lock);
+
+}  /* log_async_stop */
+
+
+/********************************************************************
+* FUNCTION log_async_flush
+* 
+* Wait until all buffered log records are written to the logfile
+*
+*********************************************************************/
+void
+    log_async_flush (void)
+{
+    if (log_async_mode == LOG_ASYNC_OFF) {
+        return;
+    }
+
+    pthread_mutex_lock(&log_async_lock);
+    while (log_async_mode != LOG_ASYNC_OFF &&
+           log_async_wpos != log_async_rpos) {
+        pthread_cond_wait(&log_async_spacecond, &log_async_lock);
+    }
+    pthread_mutex_unlock(&log_async_lock);
+
+}  /* log_async_flush */
+
+
+/********************************************************************
+* FUNCTION log_get_async_mode
+* 
+* Get the asynchronous logfile output mode in effect
+*
+* RETURNS:
+*    LOG_ASYNC_OFF if records are written right away
+*    LOG_ASYNC_BLOCK or LOG_ASYNC_DROP if the writer thread is running
+*********************************************************************/
+log_async_t
+    log_get_async_mode (void)
+{
+    return log_async_mode;
+
+}  /* log_get_async_mode */
+
+
+/********************************************************************
+* FUNCTION log_get_async_dropped
+* 
+* Get the number of log records dropped because
+* the log buffer was full
+*
+* RETURNS:
+*    drop count since the server started
+*********************************************************************/
+uint64
+    log_get_async_dropped (void)
+{
+    uint64  dropped;
+
+    pthread_mutex_lock(&log_async_lock);
+    dropped = log_async_dropped;
+    pthread_mutex_unlock(&log_async_lock);
+    return dropped;
+
+}  /* log_get_async_dropped */
+
+
+/********************************************************************
+* FUNCTION log_get_async_enum
+* 
+* Get the corresponding asynchronous output mode enum
+* for the specified string
+* 
+* INPUTS:
+*   str == string value to convert
+*
+* RETURNS:
+*   the corresponding enum for the specified mode string
+*   LOG_ASYNC_NONE if the string is not valid
+*********************************************************************/
+log_async_t
+    log_get_async_enum (const char *str)
+{
+#ifdef DEBUG
+    if (!str) {
+        SET_ERROR(ERR_INTERNAL_PTR);
+        return LOG_ASYNC_NONE;
+    }
+#endif
+
+    if (!xml_strcmp((const xmlChar *)str, LOG_ASYNC_STR_OFF)) {
+        return LOG_ASYNC_OFF;
+    } else if (!xml_strcmp((const xmlChar *)str, LOG_ASYNC_STR_BLOCK)) {
+        return LOG_ASYNC_BLOCK;
+    } else if (!xml_strcmp((const xmlChar *)str, LOG_ASYNC_STR_DROP)) {
+        return LOG_ASYNC_DROP;
+    } else {
+        return LOG_ASYNC_NONE;
+    }
+
+}  /* log_get_async_enum */
+
+
+/********************************************************************
+* FUNCTION log_get_async_string
+* 
+* Get the corresponding string for the asynchronous
+* output mode enum
+* 
+* INPUTS:
+*   mode == the enum for the mode
+*
+* RETURNS:
+*   the string value for this enum
+*********************************************************************/
+const xmlChar *
+    log_get_async_string (log_async_t mode)
+{
+    switch (mode) {
+    case LOG_ASYNC_NONE:
+    case LOG_ASYNC_OFF:
+        return LOG_ASYNC_STR_OFF;
+    case LOG_ASYNC_BLOCK:
+        return LOG_ASYNC_STR_BLOCK;
+    case LOG_ASYNC_DROP:
+        return LOG_ASYNC_STR_DROP;
+    default:
+        SET_ERROR(ERR_INTERNAL_VAL);
+        return LOG_ASYNC_STR_OFF;
+    }
+    /*NOTREACHED*/
+
+}  /* log_get_async_string */
+
+
 /* END file log.c */
@@ -19,6 +19,17 @@
 
     Logging manager
 
+    Asynchronous logfile output:
+
+    After log_async_start, log records for the logfile are
+    formatted by the caller and copied into a ring buffer.
+    A writer thread drains the buffer to the logfile in
+    batches, with 1 fflush per batch instead of 1 per record.
+    If the buffer is full, the caller either waits or the
+    record is dropped and counted, depending on the mode.
+    Output to STDOUT, the alternate logfile and the audit
+    logfile is always written and flushed right away.
+
 *********************************************************************
 *								    *
 *		   C H A N G E	 H I S T O R Y			    *
@@ -65,6 +76,13 @@ extern "C" {
 #define LOG_DEBUG_STR_DEBUG3  (const xmlChar *)"debug3"
 #define LOG_DEBUG_STR_DEBUG4  (const xmlChar *)"debug4"
 
+#define LOG_ASYNC_STR_OFF     (const xmlChar *)"off"
+#define LOG_ASYNC_STR_BLOCK   (const xmlChar *)"block"
+#define LOG_ASYNC_STR_DROP    (const xmlChar *)"drop"
+
+/* default size of the asynchronous log buffer in bytes */
+#define LOG_ASYNC_DEF_BUFFSIZE  (1024 * 1024)
+
 /********************************************************************
 *                                                                   *
 *                            T Y P E S                              *
@@ -85,6 +103,17 @@ typedef enum log_debug_t_ {
 }  log_debug_t;
 
 
+/* The asynchronous logfile output modes
+ * The mode says what happens when the log buffer is full
+ */
+typedef enum log_async_t_ {
+    LOG_ASYNC_NONE,                 /* value not set or error */
+    LOG_ASYNC_OFF,            /* write and flush every record */
+    LOG_ASYNC_BLOCK,     /* wait for the writer thread to catch up */
+    LOG_ASYNC_DROP        /* drop the record and count it */
+}  log_async_t;
+
+
 /* logging function template to switch between
  * log_stdout and log_write
  */
@@ -514,6 +543,105 @@ extern void
 extern FILE *
     log_get_logfile (void);
 
+
+/********************************************************************
+* FUNCTION log_async_start
+* 
+* Start writing the logfile from a background thread
+* Only used if a logfile is open; STDOUT is always
+* written right away
+*
+* INPUTS:
+*    mode == LOG_ASYNC_BLOCK or LOG_ASYNC_DROP
+*    buffsize == size of the log buffer in bytes
+*
+* RETURNS:
+*    status
+*********************************************************************/
+extern status_t
+    log_async_start (log_async_t mode,
+                     uint32 buffsize);
+
+
+/********************************************************************
+* FUNCTION log_async_stop
+* 
+* Write out the log buffer and stop the writer thread
+* Called by log_close
+*
+*********************************************************************/
+extern void
+    log_async_stop (void);
+
+
+/********************************************************************
+* FUNCTION log_async_flush
+* 
+* Wait until all buffered log records are written to the logfile
+*
+*********************************************************************/
+extern void
+    log_async_flush (void);
+
+
+/********************************************************************
+* FUNCTION log_get_async_mode
+* 
+* Get the asynchronous logfile output mode in effect
+*
+* RETURNS:
+*    LOG_ASYNC_OFF if records are written right away
+*    LOG_ASYNC_BLOCK or LOG_ASYNC_DROP if the writer thread is running
+*********************************************************************/
+extern log_async_t
+    log_get_async_mode (void);
+
+
+/********************************************************************
+* FUNCTION log_get_async_dropped
+* 
+* Get the number of log records dropped because
+* the log buffer was full
+*
+* RETURNS:
+*    drop count since the server started
+*********************************************************************/
+extern uint64
+    log_get_async_dropped (void);
+
+
+/********************************************************************
+* FUNCTION log_get_async_enum
+* 
+* Get the corresponding asynchronous output mode enum
+* for the specified string
+* 
+* INPUTS:
+*   str == string value to convert
+*
+* RETURNS:
+*   the corresponding enum for the specified mode string
+*   LOG_ASYNC_NONE if the string is not valid
+*********************************************************************/
+extern log_async_t
+    log_get_async_enum (const char *str);
+
+
+/********************************************************************
+* FUNCTION log_get_async_string
+* 
+* Get the corresponding string for the asynchronous
+* output mode enum
+* 
+* INPUTS:
+*   mode == the enum for the mode
+*
+* RETURNS:
+*   the string value for this enum
+*********************************************************************/
+extern const xmlChar *
+    log_get_async_string (log_async_t mode);
+
 #ifdef __cplusplus
 }  /* end extern 'C' */
 #endif
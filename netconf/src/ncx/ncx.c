@@ -57,6 +57,7 @@ date         init     comment
 #include "def_reg.h"
 #include "dlq.h"
 #include "ext.h"
+#include "getcb.h"
 #include "grp.h"
 #include "log.h"
 #include "ncx.h"
@@ -64,6 +65,7 @@ date         init     comment
 #include "ncx_feature.h"
 #include "ncx_list.h"
 #include "ncx_num.h"
+#include "ncx_regex.h"
 #include "ncxconst.h"
 #include "ncxmod.h"
 #include "obj.h"
@@ -71,6 +73,7 @@ date         init     comment
 #include "runstack.h"
 #include "status.h"
 #include "ses_msg.h"
+#include "tk.h"
 #include "typ.h"
 #include "top.h"
 #include "val.h"
@@ -1208,6 +1211,9 @@ void
     top_cleanup();
     runstack_cleanup();
     ncxmod_cleanup();
+    tk_cleanup();
+    getcb_cleanup();
+    ncx_regex_cleanup();
     xmlCleanupParser();
     status_cleanup();
 
@@ -7048,12 +7054,8 @@ const xmlChar *
 void
     ncx_write_tracefile (const char *buff, uint32 count)
 {
-    uint32 i;
-
-    if (tracefile != NULL) {
-        for (i = 0; i < count; i++) {
-            fputc((int)buff[i], tracefile);
-        }
+    if (tracefile != NULL && count) {
+        fwrite(buff, 1, count, tracefile);
     }
 }  /* ncx_write_tracefile */
 
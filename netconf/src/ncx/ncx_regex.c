@@ -0,0 +1,383 @@
+/*  FILE: ncx_regex.c
+
+   Compiled regular expression cache
+
+*********************************************************************
+*                                                                   *
+*                     I N C L U D E    F I L E S                    *
+*                                                                   *
+*********************************************************************/
+#include <stdlib.h>
+#include <string.h>
+
+#include <libxml/xmlregexp.h>
+
+#include "procdefs.h"
+#include "bobhash.h"
+#include "dlq.h"
+#include "log.h"
+#include "ncx_regex.h"
+#include "status.h"
+#include "xml_util.h"
+
+
+/********************************************************************
+*                                                                   *
+*                       C O N S T A N T S                           *
+*                                                                   *
+*********************************************************************/
+
+/* number of hash buckets in the cache */
+#define NCX_REGEX_BUCKETS        256
+
+
+/********************************************************************
+*                                                                   *
+*                           T Y P E S                               *
+*                                                                   *
+*********************************************************************/
+
+/* one compiled pattern in the cache */
+typedef struct ncx_regex_t_ {
+    dlq_hdr_t       qhdr;
+    xmlChar        *patstr;
+    xmlRegexpPtr    regex;
+    uint32          refcount;
+    uint32          lastuse;
+} ncx_regex_t;
+
+
+/********************************************************************
+*                                                                   *
+*                       V A R I A B L E S                           *
+*                                                                   *
+*********************************************************************/
+
+static boolean    ncx_regex_init_done = FALSE;
+
+/* hash buckets of ncx_regex_t */
+static dlq_hdr_t  ncx_regexQ[NCX_REGEX_BUCKETS];
+
+/* number of entries with no references */
+static uint32     ncx_regex_idlecount;
+
+/* use counter for finding the least recently used entry */
+static uint32     ncx_regex_usecount;
+
+static uint32     ncx_regex_hits;
+
+static uint32     ncx_regex_misses;
+
+
+/********************************************************************
+* FUNCTION init_cache
+*
+* Initialize the hash buckets if not done already
+*********************************************************************/
+static void
+    init_cache (void)
+{
+    uint32  i;
+
+    if (!ncx_regex_init_done) {
+        for (i = 0; i < NCX_REGEX_BUCKETS; i++) {
+            dlq_createSQue(&ncx_regexQ[i]);
+        }
+        ncx_regex_idlecount = 0;
+        ncx_regex_usecount = 0;
+        ncx_regex_hits = 0;
+        ncx_regex_misses = 0;
+        ncx_regex_init_done = TRUE;
+    }
+
+}  /* init_cache */
+
+
+/********************************************************************
+* FUNCTION get_bucket
+*
+* Get the hash bucket for a pattern string
+*
+* INPUTS:
+*   patstr == pattern string
+*
+* RETURNS:
+*   pointer to the Q of ncx_regex_t to use
+*********************************************************************/
+static dlq_hdr_t *
+    get_bucket (const xmlChar *patstr)
+{
+    return &ncx_regexQ[(uint32)bobhash((const ub1 *)patstr,
+                                        xml_strlen(patstr), 0) %
+                       NCX_REGEX_BUCKETS];
+
+}  /* get_bucket */
+
+
+/********************************************************************
+* FUNCTION find_regex
+*
+* Find a pattern string in a hash bucket
+*
+* INPUTS:
+*   que == hash bucket to check
+*   patstr == pattern string to find
+*
+* RETURNS:
+*   pointer to the cache entry or NULL if not found
+*********************************************************************/
+static ncx_regex_t *
+    find_regex (dlq_hdr_t *que,
+                const xmlChar *patstr)
+{
+    ncx_regex_t  *rx;
+
+    for (rx = (ncx_regex_t *)dlq_firstEntry(que);
+         rx != NULL;
+         rx = (ncx_regex_t *)dlq_nextEntry(rx)) {
+        if (!xml_strcmp(rx->patstr, patstr)) {
+            return rx;
+        }
+    }
+    return NULL;
+
+}  /* find_regex */
+
+
+/********************************************************************
+* FUNCTION free_regex
+*
+* Free a cache entry; it must be removed from its Q first
+*
+* INPUTS:
+*   rx == entry to free
+*********************************************************************/
+static void
+    free_regex (ncx_regex_t *rx)
+{
+    if (rx->regex) {
+        xmlRegFreeRegexp(rx->regex);
+    }
+    if (rx->patstr) {
+        m__free(rx->patstr);
+    }
+    m__free(rx);
+
+}  /* free_regex */
+
+
+/********************************************************************
+* FUNCTION evict_lru
+*
+* Free the least recently used entry with no references
+* Only called when the cache grows past NCX_REGEX_CACHE_MAX
+* idle entries, so at most once per pattern compiled
+*********************************************************************/
+static void
+    evict_lru (void)
+{
+    ncx_regex_t  *rx, *lru;
+    uint32        i;
+
+    lru = NULL;
+    for (i = 0; i < NCX_REGEX_BUCKETS; i++) {
+        for (rx = (ncx_regex_t *)dlq_firstEntry(&ncx_regexQ[i]);
+             rx != NULL;
+             rx = (ncx_regex_t *)dlq_nextEntry(rx)) {
+            if (rx->refcount == 0 &&
+                (lru == NULL ||
+                 ncx_regex_usecount - rx->lastuse >
+                 ncx_regex_usecount - lru->lastuse)) {
+                lru = rx;
+            }
+        }
+    }
+
+    if (lru) {
+        dlq_remove(lru);
+        free_regex(lru);
+        ncx_regex_idlecount--;
+    }
+
+}  /* evict_lru */
+
+
+/**************    E X T E R N A L   F U N C T I O N S **********/
+
+
+/********************************************************************
+* FUNCTION ncx_regex_get
+*
+* Get the compiled regexp for a pattern string
+* The pattern is compiled if it is not in the cache
+*
+* INPUTS:
+*   patstr == pattern string to get
+*   res == address of return status
+*
+* OUTPUTS:
+*   *res == return status
+*           ERR_NCX_INVALID_PATTERN if the pattern does not compile
+*
+* RETURNS:
+*   compiled regexp; DO NOT FREE
+*      call ncx_regex_release(patstr) when done with it
+*   NULL if some error
+*********************************************************************/
+xmlRegexpPtr
+    ncx_regex_get (const xmlChar *patstr,
+                   status_t *res)
+{
+    dlq_hdr_t    *que;
+    ncx_regex_t  *rx;
+
+#ifdef DEBUG
+    if (!patstr || !res) {
+        SET_ERROR(ERR_INTERNAL_PTR);
+        return NULL;
+    }
+#endif
+
+    init_cache();
+
+    que = get_bucket(patstr);
+    rx = find_regex(que, patstr);
+    if (rx) {
+        ncx_regex_hits++;
+        if (rx->refcount++ == 0) {
+            ncx_regex_idlecount--;
+        }
+        rx->lastuse = ++ncx_regex_usecount;
+        *res = NO_ERR;
+        return rx->regex;
+    }
+
+    ncx_regex_misses++;
+
+    rx = m__getObj(ncx_regex_t);
+    if (!rx) {
+        *res = ERR_INTERNAL_MEM;
+        return NULL;
+    }
+    memset(rx, 0x0, sizeof(ncx_regex_t));
+
+    rx->patstr = xml_strdup(patstr);
+    if (!rx->patstr) {
+        free_regex(rx);
+        *res = ERR_INTERNAL_MEM;
+        return NULL;
+    }
+
+    /* invalid patterns are not cached */
+    rx->regex = xmlRegexpCompile(patstr);
+    if (!rx->regex) {
+        free_regex(rx);
+        *res = ERR_NCX_INVALID_PATTERN;
+        return NULL;
+    }
+
+    rx->refcount = 1;
+    rx->lastuse = ++ncx_regex_usecount;
+    dlq_enque(rx, que);
+
+    *res = NO_ERR;
+    return rx->regex;
+
+}  /* ncx_regex_get */
+
+
+/********************************************************************
+* FUNCTION ncx_regex_release
+*
+* Release a regexp reference returned by ncx_regex_get
+*
+* INPUTS:
+*   patstr == pattern string used in the ncx_regex_get call
+*********************************************************************/
+void
+    ncx_regex_release (const xmlChar *patstr)
+{
+    ncx_regex_t  *rx;
+
+#ifdef DEBUG
+    if (!patstr) {
+        SET_ERROR(ERR_INTERNAL_PTR);
+        return;
+    }
+#endif
+
+    if (!ncx_regex_init_done) {
+        return;
+    }
+
+    rx = find_regex(get_bucket(patstr), patstr);
+    if (!rx || rx->refcount == 0) {
+        SET_ERROR(ERR_INTERNAL_VAL);
+        return;
+    }
+
+    if (--rx->refcount == 0) {
+        if (++ncx_regex_idlecount > NCX_REGEX_CACHE_MAX) {
+            evict_lru();
+        }
+    }
+
+}  /* ncx_regex_release */
+
+
+/********************************************************************
+* FUNCTION ncx_regex_get_stats
+*
+* Get the cache hit and miss counters
+*
+* INPUTS:
+*   hits == address of return hit count
+*   misses == address of return miss count
+*
+* OUTPUTS:
+*   *hits == number of ncx_regex_get calls found in the cache
+*   *misses == number of ncx_regex_get calls that compiled
+*********************************************************************/
+void
+    ncx_regex_get_stats (uint32 *hits,
+                         uint32 *misses)
+{
+    *hits = ncx_regex_hits;
+    *misses = ncx_regex_misses;
+
+}  /* ncx_regex_get_stats */
+
+
+/********************************************************************
+* FUNCTION ncx_regex_cleanup
+*
+* Free all cache entries
+*********************************************************************/
+void
+    ncx_regex_cleanup (void)
+{
+    ncx_regex_t  *rx;
+    uint32        i;
+
+    if (!ncx_regex_init_done) {
+        return;
+    }
+
+    if (LOGDEBUG) {
+        log_debug("\nncx_regex: %u hits, %u misses",
+                  ncx_regex_hits,
+                  ncx_regex_misses);
+    }
+
+    for (i = 0; i < NCX_REGEX_BUCKETS; i++) {
+        while (!dlq_empty(&ncx_regexQ[i])) {
+            rx = (ncx_regex_t *)dlq_deque(&ncx_regexQ[i]);
+            free_regex(rx);
+        }
+    }
+    ncx_regex_init_done = FALSE;
+
+}  /* ncx_regex_cleanup */
+
+
+/* END ncx_regex.c */
@@ -0,0 +1,122 @@
+#ifndef _H_ncx_regex
+#define _H_ncx_regex
+
+/*  FILE: ncx_regex.h
+*********************************************************************
+*								    *
+*			 P U R P O S E				    *
+*								    *
+*********************************************************************
+
+    Compiled regular expression cache
+
+  YANG pattern statements and the XPath re-match() function
+  get their compiled libxml2 regexp from this cache, keyed by
+  the pattern string, so each distinct pattern is compiled once
+  per process.
+
+  ncx_regex_get returns a compiled regexp and holds a reference
+  to it until ncx_regex_release is called with the same pattern
+  string.  Entries with no references are kept for reuse, up to
+  NCX_REGEX_CACHE_MAX entries; after that the least recently
+  used entry is freed.  Entries in use are never freed.
+
+  The cache is not thread-safe.
+
+*/
+
+#include <libxml/xmlstring.h>
+#include <libxml/xmlregexp.h>
+
+#ifndef _H_status
+#include "status.h"
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/********************************************************************
+*								    *
+*			 C O N S T A N T S			    *
+*								    *
+*********************************************************************/
+
+/* max number of unreferenced entries kept in the cache */
+#define NCX_REGEX_CACHE_MAX      256
+
+
+/********************************************************************
+*								    *
+*			F U N C T I O N S			    *
+*								    *
+*********************************************************************/
+
+
+/********************************************************************
+* FUNCTION ncx_regex_get
+*
+* Get the compiled regexp for a pattern string
+* The pattern is compiled if it is not in the cache
+*
+* INPUTS:
+*   patstr == pattern string to get
+*   res == address of return status
+*
+* OUTPUTS:
+*   *res == return status
+*           ERR_NCX_INVALID_PATTERN if the pattern does not compile
+*
+* RETURNS:
+*   compiled regexp; DO NOT FREE
+*      call ncx_regex_release(patstr) when done with it
+*   NULL if some error
+*********************************************************************/
+extern xmlRegexpPtr
+    ncx_regex_get (const xmlChar *patstr,
+                   status_t *res);
+
+
+/********************************************************************
+* FUNCTION ncx_regex_release
+*
+* Release a regexp reference returned by ncx_regex_get
+*
+* INPUTS:
+*   patstr == pattern string used in the ncx_regex_get call
+*********************************************************************/
+extern void
+    ncx_regex_release (const xmlChar *patstr);
+
+
+/********************************************************************
+* FUNCTION ncx_regex_get_stats
+*
+* Get the cache hit and miss counters
+*
+* INPUTS:
+*   hits == address of return hit count
+*   misses == address of return miss count
+*
+* OUTPUTS:
+*   *hits == number of ncx_regex_get calls found in the cache
+*   *misses == number of ncx_regex_get calls that compiled
+*********************************************************************/
+extern void
+    ncx_regex_get_stats (uint32 *hits,
+                         uint32 *misses);
+
+
+/********************************************************************
+* FUNCTION ncx_regex_cleanup
+*
+* Free all cache entries
+*********************************************************************/
+extern void
+    ncx_regex_cleanup (void);
+
+#ifdef __cplusplus
+}  /* end extern 'C' */
+#endif
+
+#endif	    /* _H_ncx_regex */
@@ -601,6 +601,7 @@ extern "C" {
 #define NCX_EL_PARMS           (const xmlChar *)"parms"
 #define NCX_EL_PASSWORD        (const xmlChar *)"password"
 #define NCX_EL_PATH            (const xmlChar *)"path"
+#define NCX_EL_PARSE_THREADS   (const xmlChar *)"parse-threads"
 #define NCX_EL_PATTERN         (const xmlChar *)"pattern"
 #define NCX_EL_PERMISSIVE      (const xmlChar *)"permissive"
 #define NCX_EL_PERSIST         (const xmlChar *)"persist"
@@ -731,6 +732,11 @@ extern "C" {
 #define NCX_EL_YIN             (const xmlChar *)"yin"
 #define NCX_EL_YUMA_HOME       (const xmlChar *)"yuma-home"
 #define NCX_EL_MAX_SESSIONS    (const xmlChar *)"max-sessions"
+#define NCX_EL_ASYNC_NVSTORE   (const xmlChar *)"async-nvstore"
+#define NCX_EL_LOG_ASYNC       (const xmlChar *)"log-async"
+#define NCX_EL_STARTUP_JOURNAL (const xmlChar *)"startup-journal"
+#define NCX_EL_STREAM_OUTPUT   (const xmlChar *)"stream-output"
+#define NCX_EL_VALIDATE_WORKERS (const xmlChar *)"validate-workers"
 
 /* bit definitions for ncx_lstr_t flags field */
 #define NCX_FL_RANGE_ERR   bit0
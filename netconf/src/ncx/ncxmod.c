@@ -40,6 +40,8 @@ date         init     comment
 #include <libxml/xmlreader.h>
 
 #include "procdefs.h"
+#include "bobhash.h"
+#include "dlq.h"
 #include "help.h"
 #include "log.h"
 #include "ncx.h"
@@ -47,6 +49,7 @@ date         init     comment
 #include "ncxtypes.h"
 #include "ncxmod.h"
 #include "status.h"
+#include "tk.h"
 #include "tstamp.h"
 #include "xml_util.h"
 #include "yangconst.h"
@@ -60,6 +63,10 @@ date         init     comment
 *********************************************************************/
 
 
+/* number of hash buckets in the module search directory index */
+#define NCXMOD_DIRINDEX_BUCKETS  256
+
+
 /* Enumeration of the basic value type classifications */
 typedef enum ncxmod_mode_t_ {
     NCXMOD_MODE_NONE,
@@ -79,6 +86,35 @@ typedef enum search_type_t_ {
 } search_type_t;
 
 
+/* one directory entry in the module search directory index */
+typedef struct ncxmod_dirent_t_ {
+    const xmlChar   *name;
+    uint32           namelen;
+    unsigned char    dtype;             /* d_type from readdir */
+} ncxmod_dirent_t;
+
+
+/* module search directory index entry
+ * Saves the readdir listing of a directory searched for
+ * module files, so search_subdirs and check_module_in_dir
+ * do not have to read the directory or stat files that
+ * are not in it each time a module is searched for.
+ * The listing is read again if the directory mtime changes.
+ */
+typedef struct ncxmod_dirindex_t_ {
+    dlq_hdr_t         qhdr;
+    xmlChar          *path;        /* directory path ending in '/' */
+    dev_t             dev;
+    ino_t             ino;
+    struct timespec   mtime;
+    boolean           listed;          /* FALSE if opendir failed */
+    uint32            entcount;
+    ncxmod_dirent_t  *ents;                      /* readdir order */
+    ncxmod_dirent_t **sorted;               /* sorted by name */
+    xmlChar          *names;           /* buffer for all names */
+} ncxmod_dirindex_t;
+
+
 /********************************************************************
 *                                                                   *
 *                       V A R I A B L E S                           *
@@ -114,6 +150,9 @@ static xmlChar *ncxmod_run_path_cli;
 
 static boolean ncxmod_subdirs;
 
+/* module search directory index; Q of ncxmod_dirindex_t */
+static dlq_hdr_t ncxmod_dirindexQ[NCXMOD_DIRINDEX_BUCKETS];
+
 
 /********************************************************************
 * FUNCTION is_yang_file
@@ -840,6 +879,277 @@ static boolean
 
 
 
+/********************************************************************
+* FUNCTION clean_dirindex
+*
+* Clean the directory listing of a directory index entry
+*
+* INPUTS:
+*    dirindex == directory index entry to clean
+*********************************************************************/
+static void
+    clean_dirindex (ncxmod_dirindex_t *dirindex)
+{
+    if (dirindex->ents) {
+        m__free(dirindex->ents);
+        dirindex->ents = NULL;
+    }
+    if (dirindex->sorted) {
+        m__free(dirindex->sorted);
+        dirindex->sorted = NULL;
+    }
+    if (dirindex->names) {
+        m__free(dirindex->names);
+        dirindex->names = NULL;
+    }
+    dirindex->entcount = 0;
+    dirindex->listed = FALSE;
+
+}  /* clean_dirindex */
+
+
+/********************************************************************
+* FUNCTION free_dirindex
+*
+* Free a directory index entry
+*
+* INPUTS:
+*    dirindex == directory index entry to free
+*********************************************************************/
+static void
+    free_dirindex (ncxmod_dirindex_t *dirindex)
+{
+    clean_dirindex(dirindex);
+    if (dirindex->path) {
+        m__free(dirindex->path);
+    }
+    m__free(dirindex);
+
+}  /* free_dirindex */
+
+
+/********************************************************************
+* FUNCTION compare_dirent
+*
+* qsort and bsearch compare function for the sorted
+* directory index entries
+*
+* INPUTS:
+*    a == address of 1st ncxmod_dirent_t pointer
+*    b == address of 2nd ncxmod_dirent_t pointer
+*
+* RETURNS:
+*    strcmp of the entry names
+*********************************************************************/
+static int
+    compare_dirent (const void *a,
+                    const void *b)
+{
+    const ncxmod_dirent_t *enta = *(const ncxmod_dirent_t * const *)a;
+    const ncxmod_dirent_t *entb = *(const ncxmod_dirent_t * const *)b;
+
+    return xml_strcmp(enta->name, entb->name);
+
+}  /* compare_dirent */
+
+
+/********************************************************************
+* FUNCTION list_dirindex
+*
+* Read the directory listing for a directory index entry
+* The listing is kept in readdir order, and sorted by name
+* for find_dirent
+*
+* INPUTS:
+*    dirindex == directory index entry to fill in;
+*                the listing must be clean
+*
+* RETURNS:
+*    status; dirindex->listed is FALSE if the directory
+*    could not be read
+*********************************************************************/
+static status_t
+    list_dirindex (ncxmod_dirindex_t *dirindex)
+{
+    DIR           *dp;
+    struct dirent *ep;
+    xmlChar       *str;
+    uint32         count, namesize, i;
+
+    /* first pass gets the entry count and name buffer size */
+    dp = opendir((const char *)dirindex->path);
+    if (!dp) {
+        return NO_ERR;
+    }
+    count = 0;
+    namesize = 0;
+    while ((ep = readdir(dp)) != NULL) {
+        count++;
+        namesize += xml_strlen((const xmlChar *)ep->d_name) + 1;
+    }
+
+    if (count) {
+        dirindex->ents = m__getMem(count * sizeof(ncxmod_dirent_t));
+        dirindex->sorted = m__getMem(count * sizeof(ncxmod_dirent_t *));
+        dirindex->names = m__getMem(namesize);
+        if (!dirindex->ents || !dirindex->sorted || !dirindex->names) {
+            (void)closedir(dp);
+            clean_dirindex(dirindex);
+            return ERR_INTERNAL_MEM;
+        }
+    }
+
+    /* second pass saves the entries; stop at the first pass
+     * count or name buffer size in case the directory changed
+     */
+    rewinddir(dp);
+    str = dirindex->names;
+    i = 0;
+    while (i < count && (ep = readdir(dp)) != NULL) {
+        dirindex->ents[i].namelen = 
+            xml_strlen((const xmlChar *)ep->d_name);
+        if ((uint32)(str - dirindex->names) + 
+            dirindex->ents[i].namelen + 1 > namesize) {
+            break;
+        }
+        xml_strcpy(str, (const xmlChar *)ep->d_name);
+        dirindex->ents[i].name = str;
+        dirindex->ents[i].dtype = ep->d_type;
+        dirindex->sorted[i] = &dirindex->ents[i];
+        str += dirindex->ents[i].namelen + 1;
+        i++;
+    }
+    (void)closedir(dp);
+
+    dirindex->entcount = i;
+    if (i) {
+        qsort(dirindex->sorted, i, sizeof(ncxmod_dirent_t *), 
+              compare_dirent);
+    }
+    dirindex->listed = TRUE;
+    return NO_ERR;
+
+}  /* list_dirindex */
+
+
+/********************************************************************
+* FUNCTION get_dirindex
+*
+* Get the directory index entry for a directory
+* The entry is created the first time the directory is searched
+* and the listing is read again if the directory has changed
+* since it was saved.  Only 1 stat call is needed if the
+* saved listing is still current.
+*
+* INPUTS:
+*    path == directory path; must end with a '/' char
+*
+* RETURNS:
+*    pointer to the directory index entry
+*    NULL if the path is not a directory or malloc error
+*********************************************************************/
+static ncxmod_dirindex_t *
+    get_dirindex (const xmlChar *path)
+{
+    ncxmod_dirindex_t  *dirindex;
+    dlq_hdr_t          *que;
+    struct stat         statbuf;
+    uint32              pathlen;
+
+    pathlen = xml_strlen(path);
+    que = &ncxmod_dirindexQ[(uint32)bobhash(path, pathlen, 0) %
+                            NCXMOD_DIRINDEX_BUCKETS];
+
+    for (dirindex = (ncxmod_dirindex_t *)dlq_firstEntry(que);
+         dirindex != NULL;
+         dirindex = (ncxmod_dirindex_t *)dlq_nextEntry(dirindex)) {
+        if (!xml_strcmp(dirindex->path, path)) {
+            break;
+        }
+    }
+
+    if (stat((const char *)path, &statbuf) != 0 ||
+        !S_ISDIR(statbuf.st_mode)) {
+        if (dirindex) {
+            dlq_remove(dirindex);
+            free_dirindex(dirindex);
+        }
+        return NULL;
+    }
+
+    if (dirindex) {
+        if (dirindex->dev == statbuf.st_dev &&
+            dirindex->ino == statbuf.st_ino &&
+            dirindex->mtime.tv_sec == statbuf.st_mtim.tv_sec &&
+            dirindex->mtime.tv_nsec == statbuf.st_mtim.tv_nsec) {
+            return dirindex;
+        }
+        clean_dirindex(dirindex);
+    } else {
+        dirindex = m__getObj(ncxmod_dirindex_t);
+        if (!dirindex) {
+            return NULL;
+        }
+        memset(dirindex, 0x0, sizeof(ncxmod_dirindex_t));
+        dirindex->path = xml_strdup(path);
+        if (!dirindex->path) {
+            m__free(dirindex);
+            return NULL;
+        }
+        dlq_enque(dirindex, que);
+    }
+
+    dirindex->dev = statbuf.st_dev;
+    dirindex->ino = statbuf.st_ino;
+    dirindex->mtime = statbuf.st_mtim;
+    if (list_dirindex(dirindex) != NO_ERR) {
+        dlq_remove(dirindex);
+        free_dirindex(dirindex);
+        return NULL;
+    }
+    return dirindex;
+
+}  /* get_dirindex */
+
+
+/********************************************************************
+* FUNCTION find_dirent
+*
+* Check if a directory index entry lists a file name
+*
+* INPUTS:
+*    dirindex == directory index entry to check
+*    name == file name to find
+*
+* RETURNS:
+*    TRUE if the name is in the listing or the directory
+*    could not be read, so the caller needs to stat the file
+*    FALSE if the file is not in the directory
+*********************************************************************/
+static boolean
+    find_dirent (const ncxmod_dirindex_t *dirindex,
+                 const xmlChar *name)
+{
+    ncxmod_dirent_t   key, *keyptr;
+
+    if (!dirindex->listed) {
+        return TRUE;
+    }
+    if (dirindex->entcount == 0) {
+        return FALSE;
+    }
+
+    key.name = name;
+    keyptr = &key;
+    return (bsearch(&keyptr, 
+                    dirindex->sorted, 
+                    dirindex->entcount,
+                    sizeof(ncxmod_dirent_t *), 
+                    compare_dirent)) ? TRUE : FALSE;
+
+}  /* find_dirent */
+
+
 /********************************************************************
 * FUNCTION check_module_in_dir
 *
@@ -854,6 +1164,8 @@ static boolean
 *            is found or an error occurs
 *    bufflen == size of buff in bytes
 *    pathlen == current end of buffer in use marker
+*    dirindex == directory index entry for the path in 'buff';
+*                files not listed in it are not checked
 *    modname == module name
 *    revision == module revision string
 *    done == address of return search done flag
@@ -869,6 +1181,7 @@ static status_t
     check_module_in_dir (xmlChar *buff, 
                          uint32 bufflen,
                          uint32 pathlen,
+                         const ncxmod_dirindex_t *dirindex,
                          const xmlChar *modname,
                          const xmlChar *revision,
                          boolean *done)
@@ -889,7 +1202,8 @@ static status_t
     if (res != NO_ERR) {
         return res;
     }
-    ret = stat((const char *)buff, &statbuf);
+    ret = (find_dirent(dirindex, &buff[pathlen])) ?
+        stat((const char *)buff, &statbuf) : -1;
     if (ret == 0) {
         *done = TRUE;
         if (S_ISREG(statbuf.st_mode)) {
@@ -908,7 +1222,8 @@ static status_t
     if (res != NO_ERR) {
         return res;
     }
-    ret = stat((const char *)buff, &statbuf);
+    ret = (find_dirent(dirindex, &buff[pathlen])) ?
+        stat((const char *)buff, &statbuf) : -1;
     if (ret == 0) {
         *done = TRUE;
         if (S_ISREG(statbuf.st_mode)) {
@@ -979,6 +1294,9 @@ static boolean is_later_revision(xmlChar* modpath_a, xmlChar* modpath_b)
 *    3) modname@revision.yang
 *    4) modname@revision.yin
 *
+* The directories are read through the module search
+* directory index, in the order readdir returned the entries
+*
 * INPUTS:
 *    buff == buffer to use for filespec construction
 *            at the start it contains the path string to use;
@@ -1004,9 +1322,9 @@ static status_t
                     const xmlChar *revision,
                     boolean *done)
 {
-    DIR           *dp;
-    struct dirent *ep;
-    uint32         pathlen, modnamelen, revisionlen, dentlen;
+    ncxmod_dirindex_t *dirindex;
+    const ncxmod_dirent_t *ep;
+    uint32         pathlen, modnamelen, revisionlen, dentlen, entnum;
     boolean        dirdone;
     status_t       res;
     boolean        done_subdir;
@@ -1035,25 +1353,31 @@ static status_t
         buff[pathlen] = 0;
     }
 
-    res = check_module_in_dir(buff, bufflen, pathlen, modname, revision, done);
+    /* get the saved listing of the buffer spec as a directory */
+    dirindex = get_dirindex(buff);
+    if (!dirindex) {
+        return NO_ERR;  /* not done yet */
+    }
+
+    res = check_module_in_dir(buff, bufflen, pathlen, dirindex,
+                              modname, revision, done);
     if (*done || res != NO_ERR) {
         return res;
     }
 
-    /* try to open the buffer spec as a directory */
-    dp = opendir((const char *)buff);
-    if (!dp) {
+    if (!dirindex->listed) {
         return NO_ERR;  /* not done yet */
     }
 
+    entnum = 0;
     dirdone = FALSE;
     while (!dirdone) {
 
-        ep = readdir(dp);
-        if (!ep) {
+        if (entnum == dirindex->entcount) {
             dirdone = TRUE;
             continue;
         }
+        ep = &dirindex->ents[entnum++];
 
         /* this field may not be present on all POSIX systems
          * according to the glibc 2.7 documentation!!
@@ -1063,22 +1387,23 @@ static status_t
          * Always skip any directory or file that starts with
          * the dot-char or is named CVS
          */
-        dentlen = xml_strlen((const xmlChar *)ep->d_name); 
+        dentlen = ep->namelen;
 
         /* this dive-first behavior is not really what is desired
          * but do not have a 'stat' function for partial filenames
          * so just going through the directory block in order
          */
-        //ep->d_type=DT_UNKNOWN; /*simulate filesystem with no d_type*/
-        if (ep->d_type == DT_DIR || ep->d_type == DT_UNKNOWN) {
-            if (*ep->d_name != '.' && strcmp(ep->d_name, "CVS")) {
+        //ep->dtype=DT_UNKNOWN; /*simulate filesystem with no d_type*/
+        if (ep->dtype == DT_DIR || ep->dtype == DT_UNKNOWN) {
+            if (*ep->name != '.' && 
+                xml_strcmp(ep->name, (const xmlChar *)"CVS")) {
                 if ((pathlen + dentlen) >= bufflen) {
                     res = ERR_BUFF_OVFL;
                     *done = TRUE;
                     dirdone = TRUE;
                 } else {
                     xml_strcpy(&buff[pathlen], 
-                               (const xmlChar *)ep->d_name);
+                               ep->name);
                     done_subdir = FALSE;
                     res = search_subdirs(buff, bufflen, modname, revision, 
                                          &done_subdir);
@@ -1094,9 +1419,9 @@ static status_t
             }
         } 
 
-        if (ep->d_type == DT_REG || ep->d_type == DT_UNKNOWN) {
+        if (ep->dtype == DT_REG || ep->dtype == DT_UNKNOWN) {
             if (!xml_strncmp(modname, 
-                             (const xmlChar *)ep->d_name,
+                             ep->name,
                              modnamelen)) {
                 /* filename is a partial match so check it out
                  * further to see if it is a pattern match;
@@ -1108,14 +1433,14 @@ static status_t
                     /* check if the at-sign is 
                      * present in the filespec 
                      */
-                    if (ep->d_name[modnamelen] != '@') {
+                    if (ep->name[modnamelen] != '@') {
                         continue;
                     }
 
                     /* check if the revision matches, if specified */
                     if (revision != NULL) {
                         if (xml_strncmp((const xmlChar *)
-                                        &ep->d_name[modnamelen+1],
+                                        &ep->name[modnamelen+1],
                                         revision, 
                                         revisionlen)) {
                             continue;
@@ -1129,10 +1454,10 @@ static status_t
                      * if the revision == NULL
                      */
                     if (!xml_strcmp((const xmlChar *)
-                                    &ep->d_name[modnamelen+12], 
+                                    &ep->name[modnamelen+12], 
                                     YANG_SUFFIX) ||
                         !xml_strcmp((const xmlChar *)
-                                    &ep->d_name[modnamelen+12], 
+                                    &ep->name[modnamelen+12], 
                                     YIN_SUFFIX)) {
                         *done = TRUE;
                         if ((pathlen + dentlen) >= bufflen) {
@@ -1140,7 +1465,7 @@ static status_t
                         } else {
                             res = NO_ERR;
                             xml_strcpy(&buff[pathlen], 
-                                       (const xmlChar *)ep->d_name);
+                                       ep->name);
                         }
                     }
                 }
@@ -1170,8 +1495,6 @@ static status_t
         free(best_match);
     }
 
-    (void)closedir(dp);
-
     return res;
 
 }  /* search_subdirs */
@@ -2754,6 +3077,7 @@ status_t
     ncxmod_init (void)
 {
     status_t   res = NO_ERR;
+    uint32     i;
 
 #ifdef DEBUG
     if (ncxmod_init_done) {
@@ -2802,6 +3126,10 @@ status_t
 
     ncxmod_subdirs = TRUE;
 
+    for (i = 0; i < NCXMOD_DIRINDEX_BUCKETS; i++) {
+        dlq_createSQue(&ncxmod_dirindexQ[i]);
+    }
+
     ncxmod_init_done = TRUE;
 
     return res;
@@ -2818,6 +3146,9 @@ status_t
 void
     ncxmod_cleanup (void)
 {
+    ncxmod_dirindex_t  *dirindex;
+    uint32              i;
+
 #ifdef DEBUG
     if (!ncxmod_init_done) {
         SET_ERROR(ERR_INTERNAL_INIT_SEQ);
@@ -2856,6 +3187,14 @@ void
         m__free(ncxmod_run_path_cli);
     }
 
+    for (i = 0; i < NCXMOD_DIRINDEX_BUCKETS; i++) {
+        while (!dlq_empty(&ncxmod_dirindexQ[i])) {
+            dirindex = (ncxmod_dirindex_t *)
+                dlq_deque(&ncxmod_dirindexQ[i]);
+            free_dirindex(dirindex);
+        }
+    }
+
     ncxmod_init_done = FALSE;
     
 }  /* ncxmod_cleanup */
@@ -2950,6 +3289,81 @@ status_t
 }  /* ncxmod_load_module */
 
 
+/********************************************************************
+* FUNCTION ncxmod_prefetch_module
+*
+* Find the YANG file for the specified module and queue it
+* to be tokenized by the token prefetch threads, so the tokens
+* are ready when the module is loaded.  Nothing is done if
+* the module is already loaded, not found, or is not a YANG file,
+* or if there are no token prefetch threads (--parse-threads)
+*
+* INPUTS:
+*   modname == module name with no path prefix or file extension,
+*              or the filespec of a YANG file
+*   revision == optional revision date of 'modname' to find
+*
+* RETURNS:
+*   status; the module is just tokenized when it is loaded
+*   if this function does not queue it
+*********************************************************************/
+status_t 
+    ncxmod_prefetch_module (const xmlChar *modname,
+                            const xmlChar *revision)
+{
+    xmlChar        *file_path;
+    xmlChar        *fspec;
+    uint32          modlen;
+    ncxmod_mode_t   mode;
+    status_t        res;
+
+    assert( modname && "modname is NULL!" );
+
+    if (tk_get_prefetch_threads() <= 1) {
+        return NO_ERR;
+    }
+
+    modlen = xml_strlen(modname);
+    mode = determine_mode(modname, modlen);
+    if (mode == NCXMOD_MODE_FILEYIN) {
+        return NO_ERR;
+    }
+
+    file_path = NULL;
+    if (mode != NCXMOD_MODE_FILEYANG) {
+        if (!ncx_valid_name(modname, modlen) ||
+            ncx_find_module(modname, revision) != NULL) {
+            return NO_ERR;
+        }
+
+        file_path = ncxmod123_find_module_filespec(modname, revision);
+        if (file_path == NULL) {
+            return NO_ERR;
+        }
+        if (determine_mode(file_path, xml_strlen(file_path)) !=
+            NCXMOD_MODE_FILEYANG) {
+            free(file_path);
+            return NO_ERR;
+        }
+    }
+
+    /* use the same expanded filespec as yang_parse_from_filespec */
+    res = NO_ERR;
+    fspec = ncx_get_source((file_path) ? file_path : modname, &res);
+    if (fspec && res == NO_ERR) {
+        res = tk_prefetch_file(fspec);
+    }
+    if (fspec) {
+        m__free(fspec);
+    }
+    if (file_path) {
+        free(file_path);
+    }
+    return res;
+
+}  /* ncxmod_prefetch_module */
+
+
 /********************************************************************
 * FUNCTION ncxmod_parse_module
 *
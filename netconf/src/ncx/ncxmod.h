@@ -331,6 +331,29 @@ extern status_t
 			ncx_module_t **retmod);
 
 
+/********************************************************************
+* FUNCTION ncxmod_prefetch_module
+*
+* Find the YANG file for the specified module and queue it
+* to be tokenized by the token prefetch threads, so the tokens
+* are ready when the module is loaded.  Nothing is done if
+* the module is already loaded, not found, or is not a YANG file,
+* or if there are no token prefetch threads (--parse-threads)
+*
+* INPUTS:
+*   modname == module name with no path prefix or file extension,
+*              or the filespec of a YANG file
+*   revision == optional revision date of 'modname' to find
+*
+* RETURNS:
+*   status; the module is just tokenized when it is loaded
+*   if this function does not queue it
+*********************************************************************/
+extern status_t 
+    ncxmod_prefetch_module (const xmlChar *modname,
+                            const xmlChar *revision);
+
+
 /********************************************************************
 * FUNCTION ncxmod_parse_module
 *
@@ -69,6 +69,16 @@ date         init     comment
 /* used by yangcli to read in between stdin polling */
 #define MAX_READ_TRIES   500
 
+/* chars that need translation in content, attribute and JSON strings */
+#define CSTR_SPECIAL_CHARS    "<>&"
+#define CSTR_NL_SPECIAL_CHARS "<>&\n"
+#define ASTR_SPECIAL_CHARS    "<>&\" \t\n\v\f\r"
+#define JSTR_SPECIAL_CHARS    "\"\\/\b\f\n\r\t"
+
+/* spaces written as one span by ses_indent */
+#define INDENT_SPACES "                                "
+#define INDENT_SPACES_LEN 32
+
 
 /********************************************************************
 *                                                                   *
@@ -85,6 +95,73 @@ date         init     comment
 static ses_total_stats_t totals;
 
 
+/********************************************************************
+* FUNCTION copy_input_span
+*
+* Copy a contiguous span of the session read buffer into
+* the buffer chain of the current incoming message
+*
+* The current buffer is filled first, then as many new
+* buffers as needed are added to msg->buffQ.  A new buffer
+* is only started when there is more data to store, so the
+* last buffer may be left completely full (buffpos at max)
+* just like the byte-oriented code in the accept_buffer
+* functions expects.
+*
+* INPUTS:
+*   scb == session control block to accept input for
+*   msg == current incoming message
+*   buff == address of current buffer pointer for 'msg'
+*   src == start of the span to copy
+*   srclen == number of bytes to copy
+*
+* OUTPUTS:
+*   *buff == last buffer written
+*
+* RETURNS:
+*   status
+*********************************************************************/
+static status_t
+    copy_input_span (ses_cb_t *scb,
+                     ses_msg_t *msg,
+                     ses_msg_buff_t **buff,
+                     const xmlChar *src,
+                     size_t srclen)
+{
+    ses_msg_buff_t *curbuff;
+    size_t          copylen;
+    status_t        res;
+
+    curbuff = *buff;
+
+    while (srclen > 0) {
+        if (curbuff->buffpos == SES_MSG_BUFFSIZE) {
+            /* current buffer is full; get a new one */
+            curbuff->buffpos = 0;
+            curbuff->bufflen = SES_MSG_BUFFSIZE;
+            res = ses_msg_new_buff(scb,
+                                   FALSE,  /* outbuff */
+                                   &curbuff);
+            if (res != NO_ERR) {
+                *buff = curbuff;
+                return res;
+            }
+            dlq_enque(curbuff, &msg->buffQ);
+        }
+
+        copylen = min(srclen, SES_MSG_BUFFSIZE - curbuff->buffpos);
+        memcpy(&curbuff->buff[curbuff->buffpos], src, copylen);
+        curbuff->buffpos += copylen;
+        src += copylen;
+        srclen -= copylen;
+    }
+
+    *buff = curbuff;
+    return NO_ERR;
+
+}  /* copy_input_span */
+
+
 /********************************************************************
 * FUNCTION accept_buffer_ssh_v10
 *
@@ -209,28 +286,44 @@ static status_t
             dlq_enque(buff, &msg->buffQ);
         }
 
-        /* get the next char in the input buffer and advance the pointer */
-        ch = scb->readbuff[count++];
-        buff->buff[buff->buffpos++] = ch;
+        /* inside the message body only the first EOM char matters;
+         * scan for it and copy everything up to and including
+         * that char in one span instead of byte by byte
+         */
+        if (scb->instate == SES_INST_IDLE ||
+            scb->instate == SES_INST_INMSG) {
+            const xmlChar *start, *eomstart;
+            size_t         spanlen;
+
+            start = &scb->readbuff[count];
+            eomstart = memchr(start, *endmatch, len - count);
+            if (eomstart) {
+                spanlen = (size_t)(eomstart - start) + 1;
+            } else {
+                spanlen = len - count;
+            }
 
-        /* handle the char in the buffer based on the input state */
-        switch (scb->instate) {
-        case SES_INST_IDLE:
-            /* check for EOM if SSH or just copy the char */
-            if (ch==*endmatch) {
+            res = copy_input_span(scb, msg, &buff, start, spanlen);
+            if (res != NO_ERR) {
+                return res;
+            }
+            count += (uint32)spanlen;
+
+            if (eomstart) {
                 scb->instate = SES_INST_INEND;
                 scb->inendpos = 1;
             } else {
                 scb->instate = SES_INST_INMSG;
             }
-            break;
-        case SES_INST_INMSG:
-            /* check for EOM if SSH or just copy the char */
-            if (ch==*endmatch) {
-                scb->instate = SES_INST_INEND;
-                scb->inendpos = 1;
-            }
-            break;
+            continue;
+        }
+
+        /* get the next char in the input buffer and advance the pointer */
+        ch = scb->readbuff[count++];
+        buff->buff[buff->buffpos++] = ch;
+
+        /* handle the char in the buffer based on the input state */
+        switch (scb->instate) {
         case SES_INST_INEND:
             /* already matched at least 1 EOM char
              * try to match the rest of the SSH EOM string 
@@ -384,7 +477,7 @@ static status_t
     uint32          count;
     boolean         done;
     xmlChar         ch;
-    size_t          chunkleft, inbuffleft, outbuffleft, copylen;
+    size_t          chunkleft, inbuffleft, copylen;
     ncx_num_t       num;
 
 #ifdef SES_DEBUG
@@ -571,7 +664,6 @@ static status_t
             count--;   /* back up count */
             chunkleft = msg->expchunksize - msg->curchunksize;
             inbuffleft = len - count;
-            outbuffleft = SES_MSG_BUFFSIZE - buff->buffpos;
             copylen = min(inbuffleft, chunkleft);
 
             /* account for the amount copied above */
@@ -583,51 +675,15 @@ static status_t
             } /* else finished the input buffer */
 
             /* copy the required input bytes to 1 or more buffers */
-            if (outbuffleft >= copylen) {
-                /* rest of chunk or input fits in rest of current buffer */
-                xml_strncpy(&buff->buff[buff->buffpos],
-                            &scb->readbuff[count],
-                            copylen);
-                buff->buffpos += copylen;
-                count += copylen;
-            } else {
-                /* rest of the current buffer not big enough;
-                 * split input across N buffers;
-                 * first finish current buffer
-                 */
-                xml_strncpy(&buff->buff[buff->buffpos],
-                            &scb->readbuff[count],
-                            outbuffleft);
-                buff->buffpos = 0;
-                buff->bufflen = SES_MSG_BUFFSIZE;
-                copylen -= outbuffleft;
-                count += outbuffleft;
-
-                /* fill N-2 full buffers and possibly
-                 * 1 final partial buffer
-                 */
-                while (copylen > 0) {
-                    size_t copy2len;
-
-                    /* get new buffer */
-                    res = ses_msg_new_buff(scb,
-                                           FALSE,  /* outbuff */
-                                           &buff);
-                    if (res != NO_ERR) {
-                        return res;
-                    }
-                    dlq_enque(buff, &msg->buffQ);
-
-                    copy2len = min(SES_MSG_BUFFSIZE, copylen);
-                    xml_strncpy(&buff->buff[buff->buffpos],
-                                &scb->readbuff[count],
-                                copy2len);
-                    buff->buffpos += copy2len;
-                    buff->bufflen = copy2len;
-                    copylen -= copy2len;
-                    count += copy2len;
-                }
+            res = copy_input_span(scb, 
+                                  msg, 
+                                  &buff,
+                                  &scb->readbuff[count],
+                                  copylen);
+            if (res != NO_ERR) {
+                return res;
             }
+            count += copylen;
             break;
         case SES_INST_INBETWEEN:
             if (scb->inendpos == 0) {
@@ -1151,6 +1207,81 @@ void
 }  /* ses_putchar */
 
 
+/********************************************************************
+* FUNCTION ses_putspan
+*
+* Write a span of chars to the session, without any translation
+*
+* The span is copied into the session output buffers with
+* memcpy, starting new buffers as needed, and the session
+* byte counters are updated once for the whole span
+*
+* THIS FUNCTION DOES NOT CHECK ANY PARAMETERS TO SAVE TIME
+*
+* INPUTS:
+*   scb == session control block to write
+*   str == start of the chars to write (need not be z-terminated)
+*   len == number of chars to write
+*
+*********************************************************************/
+void
+    ses_putspan (ses_cb_t *scb,
+                 const xmlChar *str,
+                 uint32 len)
+{
+    const xmlChar  *p;
+    uint32          cnt, total;
+    status_t        res;
+
+    if (len == 0) {
+        return;
+    }
+
+    if (scb->fd) {
+        /* Normal NETCONF session mode: */
+        res = NO_ERR;
+        total = 0;
+        while (total < len && res == NO_ERR) {
+            if (scb->outbuff == NULL) {
+                res = ses_msg_new_buff(scb, TRUE, &scb->outbuff);
+                if (scb->outbuff == NULL) {
+                    continue;
+                }
+            }
+            cnt = ses_msg_write_span(scb, 
+                                     scb->outbuff,
+                                     &str[total],
+                                     len - total);
+            if (cnt == 0) {
+                res = ses_msg_new_output_buff(scb);
+            } else {
+                total += cnt;
+            }
+        }
+
+        scb->stats.out_bytes += total;
+        totals.stats.out_bytes += total;
+    } else if (scb->fp) {
+        /* debug session, sending output to a file */
+        fwrite(str, 1, len, scb->fp);
+    } else {
+        /* debug session, sending output to the screen */
+        fwrite(str, 1, len, stdout);
+    }
+
+    /* the line length only depends on the chars after the last newline */
+    for (p = &str[len]; p > str && p[-1] != '\n'; p--) {
+        ;
+    }
+    if (p == str) {
+        scb->stats.out_line += len;
+    } else {
+        scb->stats.out_line = (uint32)(&str[len] - p);
+    }
+
+}  /* ses_putspan */
+
+
 /********************************************************************
 * FUNCTION ses_putstr
 *
@@ -1167,9 +1298,7 @@ void
     ses_putstr (ses_cb_t *scb,
                 const xmlChar *str)
 {
-    while (*str) {
-        ses_putchar(scb, *str++);
-    }
+    ses_putspan(scb, str, xml_strlen(str));
 
 }  /* ses_putstr */
 
@@ -1194,17 +1323,19 @@ void
                        const xmlChar *str,
                        int32 indent)
 {
+    size_t  runlen;
+
     ses_indent(scb, indent);
     while (*str) {
-        if (*str == '\n') {
-            if (indent < 0) {
-                ses_putchar(scb, *str++);
-            } else {
-                ses_indent(scb, indent);
-                str++;
-            }
-        } else {
+        runlen = strcspn((const char *)str, "\n");
+        if (runlen) {
+            ses_putspan(scb, str, (uint32)runlen);
+            str += runlen;
+        } else if (indent < 0) {
             ses_putchar(scb, *str++);
+        } else {
+            ses_indent(scb, indent);
+            str++;
         }
     }
 }  /* ses_putstr_indent */
@@ -1230,7 +1361,24 @@ void
                  const xmlChar *str,
                  int32 indent)
 {
+    const char *special;
+    size_t      runlen;
+
+    if (scb->mode == SES_MODE_XMLDOC || scb->mode == SES_MODE_TEXT) {
+        special = CSTR_NL_SPECIAL_CHARS;
+    } else {
+        special = CSTR_SPECIAL_CHARS;
+    }
+
     while (*str) {
+        /* write the run of chars that need no translation at once */
+        runlen = strcspn((const char *)str, special);
+        if (runlen) {
+            ses_putspan(scb, str, (uint32)runlen);
+            str += runlen;
+            continue;
+        }
+
         if (*str == '<') {
             ses_putstr(scb, LTSTR);
             str++;
@@ -1240,16 +1388,11 @@ void
         } else if (*str == '&') {
             ses_putstr(scb, AMPSTR);
             str++;
-        } else if ((scb->mode == SES_MODE_XMLDOC
-                    || scb->mode == SES_MODE_TEXT) && *str == '\n') {
-            if (indent < 0) {
-                ses_putchar(scb, *str++);
-            } else {
-                ses_indent(scb, indent);
-                str++;
-            }
-        } else {
+        } else if (indent < 0) {
             ses_putchar(scb, *str++);
+        } else {
+            ses_indent(scb, indent);
+            str++;
         }
     }
 }  /* ses_putcstr */
@@ -1273,18 +1416,22 @@ void
     ses_puthstr (ses_cb_t *scb,
                  const xmlChar *str)
 {
+    size_t  runlen;
+
     while (*str) {
-        if (*str == '<') {
+        runlen = strcspn((const char *)str, CSTR_SPECIAL_CHARS);
+        if (runlen) {
+            ses_putspan(scb, str, (uint32)runlen);
+            str += runlen;
+        } else if (*str == '<') {
             ses_putstr(scb, LTSTR);
             str++;
         } else if (*str == '>') {
             ses_putstr(scb, GTSTR);
             str++;
-        } else if (*str == '&') {
+        } else {
             ses_putstr(scb, AMPSTR);
             str++;
-        } else {
-            ses_putchar(scb, *str++);
         }
     }
 }  /* ses_puthstr */
@@ -1354,8 +1501,14 @@ void
                  const xmlChar *str,
                  int32 indent)
 {
+    size_t  runlen;
+
     while (*str) {
-        if (*str == '<') {
+        runlen = strcspn((const char *)str, ASTR_SPECIAL_CHARS);
+        if (runlen) {
+            ses_putspan(scb, str, (uint32)runlen);
+            str += runlen;
+        } else if (*str == '<') {
             ses_putstr(scb, LTSTR);
             str++;
         } else if (*str == '>') {
@@ -1408,8 +1561,17 @@ void
                  const xmlChar *str,
                  int32 indent)
 {
+    size_t  runlen;
+
     ses_indent(scb, indent);
     while (*str) {
+        runlen = strcspn((const char *)str, JSTR_SPECIAL_CHARS);
+        if (runlen) {
+            ses_putspan(scb, str, (uint32)runlen);
+            str += runlen;
+            continue;
+        }
+
         switch (*str) {
         case '"':
             ses_putchar(scb, '\\');
@@ -1471,7 +1633,7 @@ void
     ses_indent (ses_cb_t *scb,
                 int32 indent)
 {
-    int32 i;
+    int32 cnt;
 
     if (indent < 0) {
         return;
@@ -1480,8 +1642,10 @@ void
     /* set limit on indentation in case of bug */
     indent = min(indent, 255);
     ses_putchar(scb, '\n');
-    for (i=0; i<indent; i++) {
-        ses_putchar(scb, ' ');
+    while (indent > 0) {
+        cnt = min(indent, INDENT_SPACES_LEN);
+        ses_putspan(scb, (const xmlChar *)INDENT_SPACES, (uint32)cnt);
+        indent -= cnt;
     }
 
 }  /* ses_indent */
@@ -1679,6 +1843,7 @@ int
     ses_msg_t        *msg;
     ses_msg_buff_t   *buff;
     int               retlen;
+    size_t            copylen;
     boolean           done;
 
     if (len == 0) {
@@ -1755,7 +1920,12 @@ int
             continue; /* an empty buffer! */
         }
 
-        buffer[retlen++] = (char)buff->buff[buff->buffpos++];
+        /* transfer as much of this buffer as the xmlreader can take */
+        copylen = min((size_t)(len - retlen), 
+                      (size_t)(buff->bufflen - buff->buffpos));
+        memcpy(&buffer[retlen], &buff->buff[buff->buffpos], copylen);
+        buff->buffpos += copylen;
+        retlen += (int)copylen;
 
         /* check xmlreader buffer full */
         if (retlen == len) {
@@ -2048,8 +2218,8 @@ void
                     const xmlChar *fname)
 {
     FILE               *fil;
-    boolean             done;
-    int                 ch;
+    xmlChar             buff[SES_MSG_BUFFSIZE];
+    size_t              cnt;
 
     fil = fopen((const char *)fname, "r");
     if (!fil) {
@@ -2057,16 +2227,10 @@ void
         return;
     } 
 
-    done = FALSE;
-    while (!done) {
-        ch = fgetc(fil);
-        if (ch == EOF) {
-            fclose(fil);
-            done = TRUE;
-        } else {
-            ses_putchar(scb, (uint32)ch);
-        }
+    while ((cnt = fread(buff, 1, sizeof(buff), fil)) > 0) {
+        ses_putspan(scb, buff, (uint32)cnt);
     }
+    fclose(fil);
 
 } /* ses_put_extern */
 
@@ -90,11 +90,24 @@ extern "C" {
 /* max number of buffers a session is allowed to cache in its freeQ */
 #define SES_MAX_FREE_BUFFERS  32
 
-/* max number of buffers to try to send in one call to the write fn */
-#define SES_MAX_BUFFSEND   32
+/* max number of buffers to try to send in one call to the write fn
+ * must not exceed IOV_MAX since the buffers are sent with writev
+ */
+#define SES_MAX_BUFFSEND   512
 
 /* max number of bytes to try to send in one call to the write_fn */
-#define SES_MAX_BYTESEND   0xffff
+#define SES_MAX_BYTESEND   0x100000
+
+/* number of buffers a stream output session collects
+ * before they are sent with one writev call
+ */
+#define SES_STREAM_BUFFSEND  32
+
+/* max number of buffers a stream output session can queue
+ * for a client that is not reading, before the session
+ * is dropped
+ */
+#define SES_STREAM_MAXQUEUE  2048
 
 /* max desired lines size; not a hard limit */
 #define SES_DEF_LINESIZE   72
@@ -113,8 +126,11 @@ extern "C" {
 /* leave enough room at the end for EOChunks */
 #define SES_ENDCHUNK_PAD  4
 
-/* default read buffer size */
-#define SES_READBUFF_SIZE  1000
+/* default read buffer size
+ * large enough that a bulk <edit-config> is read in a few
+ * syscalls and fed to the framing code in long spans
+ */
+#define SES_READBUFF_SIZE  16384
 
 /* port number for NETCONF over TCP */
 #define SES_DEF_TCP_PORT    2023
@@ -245,6 +261,7 @@ typedef struct ses_msg_buff_t_ {
     size_t           bufflen;        /* buff actual size */
     size_t           buffpos;       /* buff cur position */
     boolean          islast;      /* T: last buff in msg */
+    boolean          framed;   /* T: base:1.1 chunk added */
     xmlChar          buff[SES_MSG_BUFFSIZE];   
 } ses_msg_buff_t;
 
@@ -312,6 +329,7 @@ typedef struct ses_cb_t_ {
     dlq_hdr_t        msgQ;              /* Q of ses_msg_t input */
     dlq_hdr_t        freeQ;              /* Q of ses_msg_buff_t */
     dlq_hdr_t        outQ;               /* Q of ses_msg_buff_t */
+    uint32           outcnt;              /* current outQ count */
     ses_msg_buff_t  *outbuff;          /* current output buffer */
     ses_ready_t      inready;            /* header for inreadyQ */
     ses_ready_t      outready;          /* header for outreadyQ */
@@ -425,6 +443,29 @@ extern void
 		 uint32    ch);
 
 
+/********************************************************************
+* FUNCTION ses_putspan
+*
+* Write a span of chars to the session, without any translation
+*
+* The span is copied into the session output buffers with
+* memcpy, starting new buffers as needed, and the session
+* byte counters are updated once for the whole span
+*
+* THIS FUNCTION DOES NOT CHECK ANY PARAMETERS TO SAVE TIME
+*
+* INPUTS:
+*   scb == session control block to write
+*   str == start of the chars to write (need not be z-terminated)
+*   len == number of chars to write
+*
+*********************************************************************/
+extern void
+    ses_putspan (ses_cb_t *scb,
+		 const xmlChar *str,
+		 uint32 len);
+
+
 /********************************************************************
 * FUNCTION ses_putstr
 *
@@ -36,11 +36,11 @@ date         init     comment
 #include  <unistd.h>
 #include  <errno.h>
 #include  <assert.h>
+#include  <sys/socket.h>
 #include  <sys/uio.h>
 
 #include  "procdefs.h"
 #include  "log.h"
-#include  "send_buff.h"
 #include  "ses.h"
 #include  "ses_msg.h"
 #include  "status.h"
@@ -107,65 +107,90 @@ static void
 } /* trace_buff */
 
 /********************************************************************
-* FUNCTION do_send_buff
+* FUNCTION write_iovs
 *
-* Send the specified buffer.
-* Add framing chars if needed for base:1.1 over SSH
+* Write some buffers to a session socket without blocking
+* A file descriptor that is not a socket is written with writev
+*
+* INPUTS:
+*   fd == session file descriptor
+*   iovs == array of buffers to write
+*   cnt == number of entries in iovs
+*
+* RETURNS:
+*   number of bytes written or -1 if errno is set
+*********************************************************************/
+static ssize_t
+    write_iovs (int fd,
+                struct iovec *iovs,
+                int cnt)
+{
+    struct msghdr  mh;
+    ssize_t        retcnt;
+
+    memset(&mh, 0x0, sizeof(mh));
+    mh.msg_iov = iovs;
+    mh.msg_iovlen = (size_t)cnt;
+
+    retcnt = sendmsg(fd, &mh, MSG_DONTWAIT);
+    if (retcnt < 0 && errno == ENOTSOCK) {
+        retcnt = writev(fd, iovs, cnt);
+    }
+    return retcnt;
+
+}  /* write_iovs */
+
+
+/********************************************************************
+* FUNCTION send_stream_buffs
+*
+* Send the buffers queued by a stream output session
+* while the message is being written
+*
+* The buffers the client is not ready for stay in the outQ
+* and are written from the event loop when the socket is ready.
+* If SES_STREAM_MAXQUEUE buffers are queued, the client is not
+* reading its replies, and the session socket is shut down so
+* the session is closed, instead of holding the message in memory.
+* The output is dropped if the send fails or the session is dropped.
 *
 * INPUTS:
 *   scb == session control block to use
-*   buff == buffer to send
 *
 * RETURNS:
 *   status
 *********************************************************************/
 static status_t
-    do_send_buff (ses_cb_t *scb,
-                  ses_msg_buff_t *buff)
+    send_stream_buffs (ses_cb_t *scb)
 {
-    status_t   res = NO_ERR;
-
-    if (scb->framing11) {
-        ses_msg_add_framing(scb, buff);
-        /* bufflen has been adjusted for buffstart */
-        if (LOGDEBUG2) {
-            log_debug2("\nses_msg send 1.1 buff:%u\n",
-                      buff->bufflen - buff->buffpos);
-            if (LOGDEBUG3) {
-                trace_buff(buff);
-            }
-        }
+    ses_msg_buff_t  *buff;
+    status_t         res;
 
-        if (buff->bufflen > 0) {
-            res = send_buff(scb->fd, 
-                            (const char *)&buff->buff[buff->buffstart], 
-                            buff->bufflen);
-        } else if (LOGDEBUG2) {
-            log_debug2("\nses: skip sending empty 1.1 buffer on sesion '%d'",
-                       scb->sid);
-        }
+    if (scb->termreason == SES_TR_DROPPED) {
+        /* the rest of the message is discarded */
+        res = ERR_NCX_RESOURCE_DENIED;
     } else {
-        if (buff->bufflen > buff->buffstart) {
-            /* send with base:1.0 framing; EOM markers in the buffer */
-            if (LOGDEBUG2) {
-                log_debug("\nses_msg send 1.0 buff:%u\n",
-                          buff->bufflen - buff->buffpos);
-                if (LOGDEBUG3) {
-                    trace_buff(buff);
-                }
-            }
-            res = send_buff(scb->fd, 
-                            (const char *)buff->buff, 
-                            buff->bufflen);
-        } else if (LOGDEBUG2) {
-            log_debug2("\nses: skip sending empty 1.0 buffer on sesion '%d'",
-                       scb->sid);
-        }
+        res = ses_msg_send_buffs(scb);
+    }
+
+    if (res == NO_ERR && scb->outcnt >= SES_STREAM_MAXQUEUE) {
+        log_error("\nError: session %d is not reading its output;"
+                  " dropping session", scb->sid);
+        (void)shutdown(scb->fd, SHUT_RDWR);
+        scb->termreason = SES_TR_DROPPED;
+        res = ERR_NCX_RESOURCE_DENIED;
     }
 
+    if (res != NO_ERR) {
+        while (!dlq_empty(&scb->outQ)) {
+            buff = (ses_msg_buff_t *)dlq_deque(&scb->outQ);
+            ses_msg_free_buff(scb, buff);
+        }
+        scb->outcnt = 0;
+    }
     return res;
 
-}  /* do_send_buff */
+}  /* send_stream_buffs */
 
 
 /********************************************************************
@@ -192,6 +217,42 @@ void
 }  /* ses_msg_init */
 
 
+/********************************************************************
+* FUNCTION frame_out_buff
+*
+* Add the base:1.1 chunk framing to a buffer queued in
+* the session outQ, so it can be sent with writev
+* like a base:1.0 buffer
+*
+* INPUTS:
+*   scb == session control block to use
+*   buff == buffer to frame
+*
+* OUTPUTS:
+*   buff->buffpos .. buff->bufflen are the framed bytes to send
+*********************************************************************/
+static void
+    frame_out_buff (ses_cb_t *scb,
+                    ses_msg_buff_t *buff)
+{
+    ses_msg_add_framing(scb, buff);
+
+    /* bufflen has been adjusted for buffstart; make it absolute */
+    buff->bufflen += buff->buffstart;
+    buff->buffpos = buff->buffstart;
+    buff->framed = TRUE;
+
+    if (LOGDEBUG2) {
+        log_debug2("\nses_msg send 1.1 buff:%u\n",
+                   buff->bufflen - buff->buffpos);
+        if (LOGDEBUG3) {
+            trace_buff(buff);
+        }
+    }
+
+}  /* frame_out_buff */
+
+
 /********************************************************************
 * FUNCTION ses_msg_cleanup
 *
@@ -483,11 +544,62 @@ status_t
 } /* ses_msg_write_buff */
 
 
+/********************************************************************
+* FUNCTION ses_msg_write_span
+*
+* Add as much of a span of text to the message buffer
+* as will fit in the space left in the buffer
+*
+* Upper layer code should never write framing chars to the
+* output buff -- that is always done in this module.
+*
+* INPUTS:
+*   scb == session control block to use
+*   buff == buffer to write to
+*   str == start of the chars to write
+*   len == number of chars to write
+*
+* RETURNS:
+*   number of chars written; 0 if the buffer is full
+*
+*********************************************************************/
+uint32
+    ses_msg_write_span (ses_cb_t *scb,
+                        ses_msg_buff_t *buff,
+                        const xmlChar *str,
+                        uint32 len)
+{
+    size_t   maxlen, copylen;
+
+    assert( scb && "scb == NULL" );
+    assert( buff && "buff == NULL" );
+
+    if (scb->framing11) {
+        maxlen = SES_MSG_BUFFSIZE - SES_ENDCHUNK_PAD;
+    } else {
+        maxlen = SES_MSG_BUFFSIZE;
+    }
+
+    if (buff->bufflen >= maxlen) {
+        return 0;
+    }
+
+    copylen = min(maxlen - buff->bufflen, (size_t)len);
+    memcpy(&buff->buff[buff->bufflen], str, copylen);
+    buff->bufflen += copylen;
+    return (uint32)copylen;
+    
+} /* ses_msg_write_span */
+
+
 /********************************************************************
 * FUNCTION ses_msg_send_buffs
 *
 * Send multiple buffers to the session client socket
-* Tries to send one packet at maximum MTU
+* Tries to send up to SES_MAX_BUFFSEND buffers or
+* SES_MAX_BYTESEND bytes in one writev call
+* The call does not block; the buffers the client is not
+* ready for are left in the outQ
 *
 * INPUTS:
 *   scb == session control block
@@ -503,7 +615,6 @@ status_t
     ssize_t          retcnt;
     int              i, cnt;
     boolean          done;
-    status_t         res;
     struct iovec     iovs[SES_MAX_BUFFSEND];
 
     assert( scb && "scb == NULL" );
@@ -543,8 +654,16 @@ status_t
     done = FALSE;
     buff = (ses_msg_buff_t *)dlq_firstEntry(&scb->outQ);
 
-    /* setup the writev call */
+    /* setup the writev call
+     * base:1.1 buffers carry their own chunk header and
+     * (if last) end-of-chunks marker once framed, so a partial
+     * write is handled the same way as for base:1.0
+     */
     for (i=0; i<SES_MAX_BUFFSEND && !done && buff; i++) {
+        if (scb->framing11 && !buff->framed) {
+            frame_out_buff(scb, buff);
+        }
+
         buffleft = buff->bufflen - buff->buffpos;
         if ((total+buffleft) > SES_MAX_BYTESEND) {
             done = TRUE;
@@ -570,65 +689,42 @@ status_t
         return SET_ERROR(ERR_NCX_OPERATION_FAILED);
     }
 
-    if (scb->framing11) {
-        /* send the 'cnt' number of buffs identified above
-         * do not use the iovs array because this function
-         * may not write the entire amount requested
-         * and that would not match the huge chunksize;
-         * so just send each buffer as a chunk
-         */
-        for (i=0; i < cnt; i++) {
-            buff = (ses_msg_buff_t *)dlq_deque(&scb->outQ);
-            if (buff == NULL) {
-                return SET_ERROR(ERR_INTERNAL_VAL);
-            }
-            res = do_send_buff(scb, buff);
-            ses_msg_free_buff(scb, buff);            
-            if (res != NO_ERR) {
-                return res;
-            }
+    /* write a packet to the session socket */
+    retcnt = write_iovs(scb->fd, iovs, cnt);
+    if (retcnt < 0) {
+        if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+            log_info("\nses msg write failed for session %d", scb->sid);
+            return errno_to_status();
         }
-        return NO_ERR;
+        /* the client is not reading; try again later */
+        retcnt = 0;
     }
 
-    /* else base:1.0 framing
-     * write a packet to the session socket 
-     */
-    retcnt = writev(scb->fd, iovs, cnt);
-    if (retcnt < 0) {
-        /* should not need retries because the select loop
-         * indicated this session was ready for output
-         */
-        log_info("\nses msg write failed for session %d", scb->sid);
-        return errno_to_status();
-    } else {
-        if (LOGDEBUG2) {
-            log_debug2("\nses wrote %d of %d bytes on session %d\n", 
-                       retcnt, 
-                       total, 
-                       scb->sid);
-        }
+    if (LOGDEBUG2) {
+        log_debug2("\nses wrote %d of %d bytes on session %d\n", 
+                   retcnt, 
+                   total, 
+                   scb->sid);
     }
 
     /* clean up the buffers that were written */
-    buff = (ses_msg_buff_t *)dlq_firstEntry(&scb->outQ);
+    for (i=0; i<cnt; i++) {
+        buff = (ses_msg_buff_t *)dlq_firstEntry(&scb->outQ);
 
-    while (retcnt && buff) {
         /* get the number of bytes written from this buffer */
         buffleft = buff->bufflen - buff->buffpos;
 
         /* free the buffer if all of it was written or just
          * bump the buffer pointer if not
          */
-        if ((uint32)retcnt >= buffleft) {
-            dlq_remove(buff);
-            ses_msg_free_buff(scb, buff);
-            retcnt -= (ssize_t)buffleft;
-            buff = (ses_msg_buff_t *)dlq_firstEntry(&scb->outQ);            
-        } else {
+        if ((uint32)retcnt < buffleft) {
             buff->buffpos += (uint32)retcnt;
-            retcnt = 0;
+            break;
         }
+        dlq_remove(buff);
+        scb->outcnt--;
+        ses_msg_free_buff(scb, buff);
+        retcnt -= (ssize_t)buffleft;
     }
 
     return NO_ERR;
@@ -648,7 +744,7 @@ status_t
 *
 * OUTPUTS:
 *   scb->outbuff, scb->outready, and scb->outQ will be changed
-*   !!! buffer will be sent if stream output mode, then buffer reused
+*   !!! queued buffers are sent now if stream output mode
 *   
 * RETURNS:
 *   status, could return malloc or buffers exceeded error
@@ -663,30 +759,32 @@ status_t ses_msg_new_output_buff (ses_cb_t *scb)
     buff = scb->outbuff;
     buff->buffpos = 0;
 
-    if (scb->stream_output) {
-        /* send this buffer right now 
+    /* save the buffer in the outQ to be sent when
+     * the main loop checks if any output pending
+     */
+    dlq_enque(buff, &scb->outQ);
+    scb->outcnt++;
+    scb->outbuff = NULL;
+
+    res = NO_ERR;
+    if (!scb->stream_output) {
+        ses_msg_make_outready(scb);
+    } else if ((scb->outcnt % SES_STREAM_BUFFSEND) == 0) {
+        /* send the queued buffers right now
          * this works because the agt_ncxserver loop and mgr_io
          * loop are single threaded and a notification cannot
          * be in the middle of being sent right now
          * If that code is changed, then make sure a notification
          * is not being streamed right now
          */
-        if (buff->bufflen) {
-            res = do_send_buff(scb, buff);
-            ses_msg_init_buff(scb, TRUE, buff);
-        } else {
-            res = SET_ERROR(ERR_INTERNAL_VAL);
-        }
+        res = send_stream_buffs(scb);
+    }
 
-        /* reuse the same outbuff again */
-    } else {
-        /* save the buffer in the message loop do be sent when
-         * the main loop checks if any output pending
-         */
-        dlq_enque(scb->outbuff, &scb->outQ);
-        ses_msg_make_outready(scb);
-        scb->outbuff = NULL;
+    /* the buffers just sent are reused from the freeQ */
+    if (res == NO_ERR) {
         res = ses_msg_new_buff(scb, TRUE, &scb->outbuff);
+    } else {
+        (void)ses_msg_new_buff(scb, TRUE, &scb->outbuff);
     }
     return res;
 
@@ -762,9 +860,13 @@ void ses_msg_unmake_outready (ses_cb_t *scb)
 /********************************************************************
 * FUNCTION ses_msg_finish_outmsg
 *
-* Put the outbuff in the outQ if non-empty
+* Put the outbuff in the outQ
 * Put the session on the outreadyQ if it is not already there
 *
+* In stream output mode the outQ is sent right away, and the
+* session is only put on the outreadyQ if the client was not
+* ready for all of it
+*
 * INPUTS:
 *   scb == session control block
 *
@@ -778,20 +880,23 @@ void ses_msg_finish_outmsg (ses_cb_t *scb)
     assert( scb && "scb is NULL" );
     assert( scb->outbuff && "scb->outbuff is NULL" );
 
+    scb->outbuff->buffpos = scb->outbuff->buffstart;
+    dlq_enque(scb->outbuff, &scb->outQ);
+    scb->outcnt++;
+    scb->outbuff = NULL;
+
     if (scb->stream_output) {
-        res = do_send_buff(scb, scb->outbuff);
-        ses_msg_init_buff(scb, TRUE, scb->outbuff);
+        res = ses_msg_send_buffs(scb);
         if (res != NO_ERR) {
             log_error("\nError: IO failed on session '%d' (%s)", 
                       scb->sid,
                       get_error_string(res));
         }
-    } else {
-        scb->outbuff->buffpos = scb->outbuff->buffstart;
-        dlq_enque(scb->outbuff, &scb->outQ);
-        scb->outbuff = NULL;
-        (void)ses_msg_new_buff(scb, TRUE, &scb->outbuff);
+    }
 
+    (void)ses_msg_new_buff(scb, TRUE, &scb->outbuff);
+
+    if (!dlq_empty(&scb->outQ)) {
         ses_msg_make_outready(scb);
     }
 
@@ -909,6 +1014,22 @@ void ses_msg_add_framing( ses_cb_t *scb, ses_msg_buff_t *buff )
     /* get the chunk size */
     char numbuff[SES_MAX_CHUNKNUM_SIZE];
     size_t buffsize = buff->bufflen - SES_STARTCHUNK_PAD;
+
+    if (buffsize == 0) {
+        /* chunk-size 0 is not allowed; an empty last buffer
+         * only carries the end-of-chunks marker
+         */
+        buff->buffstart = SES_STARTCHUNK_PAD;
+        if (buff->islast) {
+            memcpy(&buff->buff[buff->bufflen], 
+                   NC_SSH_END_CHUNKS,
+                   NC_SSH_END_CHUNKS_LEN);
+            buff->bufflen += NC_SSH_END_CHUNKS_LEN;
+        }
+        buff->bufflen -= buff->buffstart;
+        return;
+    }
+
     int32 numlen = snprintf(numbuff, sizeof(numbuff), "%zu", buffsize);
 
     /* figure out where to put the start chunks within
@@ -955,6 +1076,7 @@ void
 
     buff->buffpos = 0;
     buff->islast = FALSE;
+    buff->framed = FALSE;
     if (outbuff && scb->framing11) {
         buff->buffstart = SES_STARTCHUNK_PAD;
     } else {
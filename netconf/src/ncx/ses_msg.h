@@ -192,6 +192,29 @@ extern status_t
                         uint32 ch);
 
 
+/********************************************************************
+* FUNCTION ses_msg_write_span
+*
+* Add as much of a span of text to the message buffer
+* as will fit in the space left in the buffer
+*
+* INPUTS:
+*   scb == session control block to use
+*   buff == buffer to write to
+*   str == start of the chars to write
+*   len == number of chars to write
+*
+* RETURNS:
+*   number of chars written; 0 if the buffer is full
+*
+*********************************************************************/
+extern uint32
+    ses_msg_write_span (ses_cb_t *scb,
+                        ses_msg_buff_t *buff,
+                        const xmlChar *str,
+                        uint32 len);
+
+
 /********************************************************************
 * FUNCTION ses_msg_send_buffs
 *
@@ -37,6 +37,13 @@ date         init     comment
 #include <memory.h>
 #include <ctype.h>
 #include <assert.h>
+#include <stddef.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
 
 #include <libxml/xmlstring.h>
 
@@ -68,6 +75,21 @@ date         init     comment
 
 #define FL_ALL    (FL_YANG|FL_CONF|FL_XPATH|FL_REDO)
 
+/* size of each token arena block and the largest allocation
+ * taken from a shared block; bigger strings get their own block
+ */
+#define TK_ARENA_BLOCK_SIZE    32768
+#define TK_ARENA_MAX_SHARED    2048
+
+/* token arena allocations are aligned for the tk_token_t pointers */
+#define TK_ARENA_ALIGN(N) \
+    (((N) + sizeof(void *) - 1) & ~(sizeof(void *) - 1))
+
+/* max prefetched token chains waiting to be used, so
+ * a large batch of files is not all held in memory
+ */
+#define TK_PREFETCH_MAX_READY  32
+
 /********************************************************************
 *                                                                   *
 *                            T Y P E S                              *
@@ -83,6 +105,33 @@ typedef struct tk_ent_t_ {
     uint32          flags;
 } tk_ent_t;
 
+/* token arena block; the tokens and strings allocated
+ * from the block follow the header
+ */
+typedef struct tk_arena_t_ {
+    dlq_hdr_t       qhdr;
+    size_t          size;
+    size_t          used;
+} tk_arena_t;
+
+/* token prefetch entry states */
+typedef enum tk_prefetch_state_t_ {
+    TK_PREFETCH_QUEUED,
+    TK_PREFETCH_RUNNING,
+    TK_PREFETCH_DONE
+} tk_prefetch_state_t;
+
+/* one YANG file queued for the token prefetch threads
+ * tkc and res are set when the state is TK_PREFETCH_DONE
+ */
+typedef struct tk_prefetch_t_ {
+    dlq_hdr_t            qhdr;
+    xmlChar             *filespec;
+    tk_chain_t          *tkc;
+    status_t             res;
+    tk_prefetch_state_t  state;
+} tk_prefetch_t;
+
 /* One quick entry built-in type name lookup */
 typedef struct tk_btyp_t_ {
     ncx_btype_t     btyp;
@@ -212,6 +261,27 @@ static tk_btyp_t blist [] = {
     { NCX_BT_NONE, 4, (const xmlChar *)"NONE", 0 }
 };
 
+/* token prefetch threads; all the prefetch fields below
+ * except the thread list are protected by tk_prefetch_lock
+ */
+static uint32 tk_prefetch_count = 1;
+
+static pthread_t *tk_prefetch_threads = NULL;
+
+static uint32 tk_prefetch_running = 0;
+
+static uint32 tk_prefetch_ready = 0;
+
+static boolean tk_prefetch_done = FALSE;
+
+static dlq_hdr_t tk_prefetchQ;
+
+static pthread_mutex_t tk_prefetch_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static pthread_cond_t tk_prefetch_workcond = PTHREAD_COND_INITIALIZER;
+
+static pthread_cond_t tk_prefetch_donecond = PTHREAD_COND_INITIALIZER;
+
 
 
 /********************************************************************
@@ -320,6 +390,120 @@ static void
 } /* free_token_ptr */
 
 
+/********************************************************************
+* FUNCTION arena_alloc
+* 
+* Allocate memory from the token arena of a chain
+* The memory is freed by free_arena
+*
+* INPUTS:
+*  tkc == token chain with TK_FL_ARENA set
+*  size == number of bytes needed
+*
+* RETURNS:
+*   pointer to the memory or NULL if malloc error
+*********************************************************************/
+static void *
+    arena_alloc (tk_chain_t *tkc,
+                 size_t size)
+{
+    tk_arena_t   *arena, *last;
+    size_t        hdrsize, blocksize;
+    void         *ret;
+
+    hdrsize = TK_ARENA_ALIGN(sizeof(tk_arena_t));
+    size = TK_ARENA_ALIGN(size);
+
+    /* the last block is the one in use */
+    last = (tk_arena_t *)dlq_lastEntry(&tkc->arenaQ);
+    if (last && last->size - last->used >= size) {
+        ret = (xmlChar *)last + hdrsize + last->used;
+        last->used += size;
+        return ret;
+    }
+
+    blocksize = (size > TK_ARENA_MAX_SHARED) ? size : TK_ARENA_BLOCK_SIZE;
+    arena = (tk_arena_t *)m__getMem(hdrsize + blocksize);
+    if (!arena) {
+        return NULL;
+    }
+    arena->size = blocksize;
+    arena->used = size;
+
+    if (size > TK_ARENA_MAX_SHARED && last) {
+        /* keep using the last block for small allocations */
+        dlq_insertAhead(arena, last);
+    } else {
+        dlq_enque(arena, &tkc->arenaQ);
+    }
+    return (xmlChar *)arena + hdrsize;
+
+} /* arena_alloc */
+
+
+/********************************************************************
+* FUNCTION free_arena
+* 
+* Free all the token arena blocks of a chain
+* The tokens in the arena must not be used after this call
+*
+* INPUTS:
+*  tkc == token chain to use
+*********************************************************************/
+static void
+    free_arena (tk_chain_t *tkc)
+{
+    tk_arena_t   *arena;
+
+    while (!dlq_empty(&tkc->arenaQ)) {
+        arena = (tk_arena_t *)dlq_deque(&tkc->arenaQ);
+        m__free(arena);
+    }
+
+} /* free_arena */
+
+
+/********************************************************************
+* FUNCTION chain_strndup
+* 
+* Copy a token string for a token in a chain
+* The string is taken from the chain arena if TK_FL_ARENA is set
+* and the 'arenabit' is set in tk->arena
+*
+* INPUTS:
+*  tkc == token chain to use
+*  tk == token that will own the string
+*  arenabit == TK_ARENA_* bit for the token field
+*  str == string to copy, not z-terminated
+*  len == 'str' length
+*
+* RETURNS:
+*   z-terminated copy of 'str' or NULL if malloc error
+*********************************************************************/
+static xmlChar *
+    chain_strndup (tk_chain_t *tkc,
+                   tk_token_t *tk,
+                   uint8 arenabit,
+                   const xmlChar *str,
+                   uint32 len)
+{
+    xmlChar  *ret;
+
+    if (!(tkc->flags & TK_FL_ARENA)) {
+        return xml_strndup(str, len);
+    }
+
+    ret = (xmlChar *)arena_alloc(tkc, len+1);
+    if (ret) {
+        memcpy(ret, str, len);
+        ret[len] = 0;
+        tk->arena |= arenabit;
+    }
+    return ret;
+
+} /* chain_strndup */
+
+
 /********************************************************************
 * FUNCTION new_token
 * 
@@ -374,6 +558,55 @@ static tk_token_t *
 } /* new_token */
 
 
+/********************************************************************
+* FUNCTION new_chain_token
+* 
+* Allocatate a new token for a chain with a value string
+* that will be copied.  The token and the value are taken from
+* the chain arena if TK_FL_ARENA is set; otherwise this is
+* the same as new_token
+*
+* INPUTS:
+*  tkc == token chain that will own the token
+*  ttyp == token type
+*  tval == token value or NULL if not used
+*  tlen == token value length if used; Ignored if tval == NULL
+*
+* RETURNS:
+*   new token or NULL if some error
+*********************************************************************/
+static tk_token_t *
+    new_chain_token (tk_chain_t *tkc,
+                     tk_type_t ttyp, 
+                     const xmlChar *tval,
+                     uint32  tlen)
+{
+    tk_token_t  *tk;
+
+    if (!(tkc->flags & TK_FL_ARENA)) {
+        return new_token(ttyp, tval, tlen);
+    }
+
+    tk = (tk_token_t *)arena_alloc(tkc, sizeof(tk_token_t));
+    if (!tk) {
+        return NULL;
+    }
+    memset(tk, 0x0, sizeof(tk_token_t));
+    tk->typ = ttyp;
+    tk->arena = TK_ARENA_TOKEN;
+    if (tval) {
+        tk->len = tlen;
+        tk->val = chain_strndup(tkc, tk, TK_ARENA_VAL, tval, tlen);
+        if (!tk->val) {
+            return NULL;
+        }
+    }
+    dlq_createSQue(&tk->origstrQ);
+    return tk;
+    
+} /* new_chain_token */
+
+
 /********************************************************************
 * FUNCTION new_mtoken
 * 
@@ -445,13 +678,13 @@ static void
     }
 #endif
 
-    if (tk->mod) {
+    if (tk->mod && !(tk->arena & TK_ARENA_MOD)) {
         m__free(tk->mod);
     }
-    if (tk->val) {
+    if (tk->val && !(tk->arena & TK_ARENA_VAL)) {
         m__free(tk->val);
     }
-    if (tk->origval) {
+    if (tk->origval && !(tk->arena & TK_ARENA_ORIGVAL)) {
         m__free(tk->origval);
     }
 
@@ -460,7 +693,10 @@ static void
         free_origstr(origstr);
     }
 
-    m__free(tk);
+    /* arena tokens are freed with the chain */
+    if (!(tk->arena & TK_ARENA_TOKEN)) {
+        m__free(tk);
+    }
 
 } /* free_token */
 
@@ -473,6 +709,7 @@ static void
 *         is a prefix name in YANG
 *
 * INPUTS:
+*  tkc == token chain that will own the token
 *  ttyp == token type
 *  mod == module name string, not z-terminated
 *  modlen == 'mod' string length
@@ -483,18 +720,19 @@ static void
 *   new token or NULL if some error
 *********************************************************************/
 static tk_token_t *
-    new_token_wmod (tk_type_t ttyp, 
-                       const xmlChar *mod,
-                       uint32 modlen,
-                       const xmlChar *tval, 
-                       uint32 tlen)
+    new_token_wmod (tk_chain_t *tkc,
+                    tk_type_t ttyp, 
+                    const xmlChar *mod,
+                    uint32 modlen,
+                    const xmlChar *tval, 
+                    uint32 tlen)
 {
     tk_token_t  *ret;
 
-    ret = new_token(ttyp, tval, tlen);
+    ret = new_chain_token(tkc, ttyp, tval, tlen);
     if (ret) {
         ret->modlen = modlen;
-        ret->mod = xml_strndup(mod, modlen);
+        ret->mod = chain_strndup(tkc, ret, TK_ARENA_MOD, mod, modlen);
         if (!ret->mod) {
             free_token(ret);
             return NULL;
@@ -514,6 +752,56 @@ static tk_token_t *
 }  /* new_token_wmod */
 
 
+/********************************************************************
+* FUNCTION read_line
+* 
+* Read the next line of a file input chain into tkc->buff
+* Same as fgets except the line is copied from the mmapped
+* source if tkc->mapbuff is set
+*
+* INPUTS:
+*  tkc == token chain reading a file
+*
+* OUTPUTS:
+*  tkc->buff filled in with the z-terminated line
+*
+* RETURNS:
+*   TRUE if a line was read; FALSE at EOF or error
+*********************************************************************/
+static boolean
+    read_line (tk_chain_t *tkc)
+{
+    const xmlChar  *str, *eol;
+    size_t          len;
+
+    if (tkc->mapbuff == NULL) {
+        return (fgets((char *)tkc->buff, TK_BUFF_SIZE, tkc->fp) != NULL);
+    }
+
+    if (tkc->mappos >= tkc->maplen) {
+        return FALSE;
+    }
+
+    /* copy up to and including the newline, but no more
+     * than fgets would fit into the buffer
+     */
+    str = tkc->mapbuff + tkc->mappos;
+    len = tkc->maplen - tkc->mappos;
+    if (len > TK_BUFF_SIZE - 1) {
+        len = TK_BUFF_SIZE - 1;
+    }
+    eol = memchr(str, '\n', len);
+    if (eol) {
+        len = (size_t)(eol - str) + 1;
+    }
+    memcpy(tkc->buff, str, len);
+    tkc->buff[len] = 0;
+    tkc->mappos += len;
+    return TRUE;
+
+} /* read_line */
+
+
 /********************************************************************
 * FUNCTION add_new_token
 * 
@@ -552,10 +840,10 @@ static status_t
         return ERR_NCX_LEN_EXCEEDED;
     } else if (total == 0) {
         /* zero length value strings are allowed */
-        tk = new_token(ttyp, NULL, 0);
+        tk = new_chain_token(tkc, ttyp, NULL, 0);
     } else {
         /* normal case string -- non-zero length */
-        tk = new_token(ttyp, tkc->bptr, total);
+        tk = new_chain_token(tkc, ttyp, tkc->bptr, total);
     }
     if (!tk) {
         return ERR_INTERNAL_MEM;
@@ -906,11 +1194,28 @@ static status_t
 
     if (total == 0) {
         /* zero length value strings are allowed */
-        tk = (isdouble) ? new_token( TK_TT_QSTRING,  NULL, 0) 
-                        : new_token( TK_TT_SQSTRING, NULL, 0);
+        tk = (isdouble) ? new_chain_token( tkc, TK_TT_QSTRING,  NULL, 0) 
+                        : new_chain_token( tkc, TK_TT_SQSTRING, NULL, 0);
     } else if (!isdouble) {
         /* single quote string */
-        tk = new_token( TK_TT_SQSTRING, tkbuff, total );
+        tk = new_chain_token( tkc, TK_TT_SQSTRING, tkbuff, total );
+    } else if (tkc->flags & TK_FL_ARENA) {
+        /* double quote string converted right into the arena;
+         * no DOCMODE origval in arena mode */
+        xmlChar *buff = (xmlChar *)arena_alloc(tkc, total+1);
+        if (!buff) {
+            return ERR_INTERNAL_MEM;
+        }
+
+        copy_and_format_token_str( buff, tkbuff, endstr, 
+                                   is_xpath_string( tkc->source), startpos );
+
+        tk = new_chain_token( tkc, TK_TT_QSTRING, NULL, 0);
+        if ( tk ) {
+            tk->len = xml_strlen(buff);
+            tk->val = buff;
+            tk->arena |= TK_ARENA_VAL;
+        }
     } else {
         /* double quote normal case -- non-zero length QSTRING fill the buffer, 
          * while converting escaped chars */
@@ -1143,7 +1448,7 @@ static status_t
     /* keep saving lines in tempbuff until the QSTRING_CH is found */
     done = FALSE;
     while (!done) {
-        if (!fgets((char *)tkc->buff, TK_BUFF_SIZE, tkc->fp)) {
+        if (!read_line(tkc)) {
             /* read line failed -- assume EOF */
             m__free(tempbuff);
             return ERR_NCX_UNENDED_QSTRING;
@@ -1279,7 +1584,7 @@ static status_t
     /* keep saving lines in tempbuff until the QSTRING_CH is found */
     done = FALSE;
     while (!done) {
-        if (!fgets((char *)tkc->buff, TK_BUFF_SIZE, tkc->fp)) {
+        if (!read_line(tkc)) {
             /* read line failed -- assume EOF */
             m__free(tempbuff);
             return ERR_NCX_UNENDED_QSTRING;
@@ -1386,7 +1691,7 @@ static status_t
      */
     done = FALSE;
     while (!done) {
-        if (!fgets((char *)tkc->buff, TK_BUFF_SIZE, tkc->fp)) {
+        if (!read_line(tkc)) {
             /* read line failed -- assume EOF */
             return ERR_NCX_UNENDED_COMMENT;
         } else {
@@ -1696,14 +2001,14 @@ static status_t
 
     if (prefix) {
         /* XPath $prefix:identifier */
-        tk = new_token_wmod(TK_TT_QVARBIND,
+        tk = new_token_wmod(tkc, TK_TT_QVARBIND,
                             prefix, 
                             prelen, 
                             item, 
                             (uint32)(str - item));
     } else {
         /* XPath $identifier */
-        tk = new_token(TK_TT_VARBIND,  tkc->bptr+1, len);
+        tk = new_chain_token(tkc, TK_TT_VARBIND,  tkc->bptr+1, len);
     }
 
     if (!tk) {
@@ -1846,7 +2151,7 @@ static status_t
             if ((str - item) > NCX_MAX_Q_STRLEN) {
                 return ERR_NCX_LEN_EXCEEDED;
             }
-            tk = new_token_wmod(scoped ? TK_TT_MSSTRING : TK_TT_MSTRING,
+            tk = new_token_wmod(tkc, scoped ? TK_TT_MSSTRING : TK_TT_MSTRING,
                                 prefix, 
                                 prelen, 
                                 item, 
@@ -1855,17 +2160,18 @@ static status_t
             if ((str - tkc->bptr) > NCX_MAX_Q_STRLEN) {
                 return ERR_NCX_LEN_EXCEEDED;
             }
-            tk = new_token(scoped ? TK_TT_SSTRING : TK_TT_TSTRING,
-                           tkc->bptr, 
-                           (uint32)(str - tkc->bptr));
+            tk = new_chain_token(tkc,
+                                 scoped ? TK_TT_SSTRING : TK_TT_TSTRING,
+                                 tkc->bptr, 
+                                 (uint32)(str - tkc->bptr));
         }
     } else if (prefix) {
         if (namestar) {
             /* XPath 'prefix:*'  */
-            tk = new_token(TK_TT_NCNAME_STAR,  prefix, prelen);
+            tk = new_chain_token(tkc, TK_TT_NCNAME_STAR,  prefix, prelen);
         } else {
             /* XPath prefix:identifier */
-            tk = new_token_wmod(TK_TT_MSTRING,
+            tk = new_token_wmod(tkc, TK_TT_MSTRING,
                                 prefix, 
                                 prelen, 
                                 item, 
@@ -1873,9 +2179,9 @@ static status_t
         }
     } else {
         /* XPath identifier */
-        tk = new_token(TK_TT_TSTRING,  
-                       tkc->bptr, 
-                       (uint32)(str - tkc->bptr));
+        tk = new_chain_token(tkc, TK_TT_TSTRING,  
+                             tkc->bptr, 
+                             (uint32)(str - tkc->bptr));
     }
 
     if (!tk) {
@@ -2088,13 +2394,21 @@ static status_t
                  * is about to get changed to the entire concat string
                  */
                 first->origval = first->val;
+                if (first->arena & TK_ARENA_VAL) {
+                    first->arena &= ~TK_ARENA_VAL;
+                    first->arena |= TK_ARENA_ORIGVAL;
+                }
             } else {
                 /* the first part of a QSTRING has already been 
                  * converted so it cannot be used as 'origval'
                  * like an SQSTRING; just toss it as origval copy is
                  * already set before the conversion was done
                  */
-                m__free(first->val);
+                if (first->arena & TK_ARENA_VAL) {
+                    first->arena &= ~TK_ARENA_VAL;
+                } else {
+                    m__free(first->val);
+                }
             }
             first->val = buff;
         
@@ -2122,110 +2436,570 @@ static status_t
 }  /* concat_qstrings */
 
 
-/**************    E X T E R N A L   F U N C T I O N S **********/
-
-
 /********************************************************************
-* FUNCTION tk_new_chain
+* FUNCTION tokenize_input
 * 
-* Allocatate a new token parse chain
+* Parse the input (FILE or buffer) into tk_token_t structs
+* See tk_tokenize_input for the tkc setup
+*
+* INPUTS:
+*   tkc == token chain 
+*   mod == module in progress (NULL if not used)
+*          !!! Just used for error messages !!!
+*   report == TRUE to print error messages
+*             FALSE to just return the error status
 *
 * RETURNS:
-*  new parse chain or NULL if memory error
+*   status of the operation
 *********************************************************************/
-tk_chain_t * 
-    tk_new_chain (void)
+static status_t 
+    tokenize_input (tk_chain_t *tkc,
+                    ncx_module_t *mod,
+                    boolean report)
 {
-    tk_chain_t  *tkc;
-
-    tkc = m__getObj(tk_chain_t);
-    if (!tkc) {
-        return NULL;
-    }
-    memset(tkc, 0x0, sizeof(tk_chain_t));
-    dlq_createSQue(&tkc->tkQ);
-    tkc->cur = (tk_token_t *)&tkc->tkQ;
-    dlq_createSQue(&tkc->tkptrQ);
-    return tkc;
-           
-} /* tk_new_chain */
-
+    status_t      res;
+    boolean       done;
+    tk_token_t   *tk;
+    tk_type_t     ttyp;
 
-/********************************************************************
-* FUNCTION tk_setup_chain_conf
-* 
-* Setup a previously allocated chain for a text config file
-*
-* INPUTS
-*    tkc == token chain to setup
-*    fp == open file to use for text source
-*    filename == source filespec
-*********************************************************************/
-void
-    tk_setup_chain_conf (tk_chain_t *tkc,
-                         FILE *fp,
-                         const xmlChar *filename)
-{
 #ifdef DEBUG
     if (!tkc) {
-        SET_ERROR(ERR_INTERNAL_PTR);
-        return;
+        return SET_ERROR(ERR_INTERNAL_PTR);
     }
 #endif
 
-    tkc->fp = fp;
-    tkc->source = TK_SOURCE_CONF;
-    tkc->filename = filename;
-    tkc->flags |= TK_FL_MALLOC;
-           
-} /* tk_setup_chain_conf */
-
-
-/********************************************************************
-* FUNCTION tk_setup_chain_yang
-* 
-* Setup a previously allocated chain for a YANG file
-*
-* INPUTS
-*    tkc == token chain to setup
-*    fp == open file to use for text source
-*    filename == source filespec
-*********************************************************************/
-void
-    tk_setup_chain_yang (tk_chain_t *tkc,
-                         FILE *fp,
-                         const xmlChar *filename)
-{
-#ifdef DEBUG
-    if (!tkc) {
-        SET_ERROR(ERR_INTERNAL_PTR);
-        return;
+    /* check if a temp buffer is needed */
+    if (tkc->flags & TK_FL_MALLOC) {
+        tkc->buff = m__getMem(TK_BUFF_SIZE);
+        if (!tkc->buff) {
+            res = ERR_INTERNAL_MEM;
+            if (report) {
+                ncx_print_errormsg(tkc, mod, res);
+            }
+            return res;
+        } else {
+            memset(tkc->buff, 0x0, TK_BUFF_SIZE);
+        }
+    } else if (tkc->buff == NULL) {
+        /* tkc->buff expected to be setup already */
+        return SET_ERROR(ERR_INTERNAL_VAL);
     }
-#endif
-
-    tkc->fp = fp;
-    tkc->source = TK_SOURCE_YANG;
-    tkc->filename = filename;
-    tkc->flags |= TK_FL_MALLOC;
-           
-} /* tk_setup_chain_yang */
 
+    /* setup buffer for parsing */
+    res = NO_ERR;
+    tkc->bptr = tkc->buff;
 
-/********************************************************************
-* FUNCTION tk_setup_chain_yin
-* 
-* Setup a previously allocated chain for a YIN file
-*
-* INPUTS
-*    tkc == token chain to setup
-*    filename == source filespec
-*********************************************************************/
-void
-    tk_setup_chain_yin (tk_chain_t *tkc,
-                        const xmlChar *filename)
-{
-#ifdef DEBUG
-    if (!tkc) {
+    /* outside loop iterates per buffer full only
+     * if reading input from file
+     */
+    done = FALSE;
+    while (!done) {
+        /* get one line of input if parsing from FILE in buffer,
+         * or already have the buffer if parsing from memory
+         */
+        if (tkc->filename) {
+            if (!read_line(tkc)) {
+                /* read line failed, treating as not an error */
+                res = NO_ERR;
+                done = TRUE;
+                continue;
+            } else {
+                /* save newline token for conf file only */
+                if (tkc->source == TK_SOURCE_CONF) {
+                    tk = new_token(TK_TT_NEWLINE, NULL, 0);
+                    if (!tk) {
+                        res = ERR_INTERNAL_MEM;
+                        done = TRUE;
+                        continue;
+                    } 
+                    tk->linenum = tkc->linenum;
+                    tk->linepos = tkc->linepos;
+                    dlq_enque(tk, &tkc->tkQ);
+                }
+                tkc->linenum++;
+                tkc->linepos = 1;
+            }
+
+            /* set buffer pointer to start of buffer */
+            tkc->bptr = tkc->buff;
+
+#ifdef TK_RDLN_DEBUG
+            if (LOGDEBUG3) {
+                if (xml_strlen(tkc->buff) < 80) {
+                    log_debug3("\ntk_tokenize: read line (%s)", tkc->buff);
+                } else {
+                    log_debug3("\ntk_tokenize: read line len  (%d)", 
+                               xml_strlen(tkc->buff));
+                }
+            }
+#endif
+            ncx_check_warn_linelen(tkc, mod, tkc->buff);
+        }
+
+        /* Have some sort of input in the buffer (tkc->buff) */
+        while (*tkc->bptr && res==NO_ERR) { 
+
+            /* skip whitespace */
+            while (*tkc->bptr && (*tkc->bptr != '\n') &&
+                   xml_isspace(*tkc->bptr)) {
+                if (*tkc->bptr == '\t') {
+                    tkc->linepos += NCX_TABSIZE;
+                } else {
+                    tkc->linepos++;
+                }
+                tkc->bptr++;
+            }
+
+            /* check the first non-whitespace char found or exit */
+            if (!*tkc->bptr) {
+                continue;                 /* EOS, exit loop */
+            } else if (*tkc->bptr == '\n') {
+                /* save newline token for conf file only */
+                if (tkc->source == TK_SOURCE_CONF) {
+                    tk = new_token(TK_TT_NEWLINE, NULL, 0);
+                    if (!tk) {
+                        res = ERR_INTERNAL_MEM;
+                        done = TRUE;
+                        continue;
+                    } 
+                    tk->linenum = tkc->linenum;
+                    tk->linepos = ++tkc->linepos;
+                    dlq_enque(tk, &tkc->tkQ);
+                }
+                tkc->bptr++;
+            } else if ((tkc->source == TK_SOURCE_CONF &&
+                        *tkc->bptr == NCX_COMMENT_CH) ||
+                       (tkc->source == TK_SOURCE_YANG &&
+                        *tkc->bptr == '/' && tkc->bptr[1] == '/')) {
+                /* CONF files use the '# to eoln' comment format
+                 * YANG files use the '// to eoln' comment format
+                 * skip past the comment, make next char EOLN
+                 *
+                 * TBD: SAVE COMMENTS IN XMLDOC SESSION MODE
+                 */
+                while (*tkc->bptr && *tkc->bptr != '\n') {
+                    tkc->bptr++;
+                }
+            } else if (tkc->source == TK_SOURCE_YANG &&
+                       *tkc->bptr == '/' && tkc->bptr[1] == '*') {
+                /* found start of a C-style YANG comment */
+                res = skip_yang_cstring(tkc);
+            } else if (*tkc->bptr == NCX_QSTRING_CH) {
+                /* get a dbl-quoted string which may span multiple lines */
+                res = tokenize_qstring(tkc);
+            } else if (*tkc->bptr == NCX_SQSTRING_CH) {
+                /* get a single-quoted string which may span multiple lines */
+                res = tokenize_sqstring(tkc);
+            } else if (tkc->source == TK_SOURCE_XPATH &&
+                       *tkc->bptr == NCX_VARBIND_CH) {
+                res = tokenize_varbind_string(tkc);
+            } else if (ncx_valid_fname_ch(*tkc->bptr)) {
+                /* get some some of unquoted ID string or regular string */
+                res = tokenize_id_string(tkc);
+            } else if ((*tkc->bptr=='+' || *tkc->bptr=='-') &&
+                       isdigit(*(tkc->bptr+1)) &&
+                       (tkc->source != TK_SOURCE_YANG) &&
+                       (tkc->source != TK_SOURCE_XPATH)) {
+                /* get some sort of number 
+                 * YANG does not have +/- number sequences
+                 * so they are parsed (first pass) as a string
+                 * There are corner cases such as range 1..max
+                 * that will be parsed wrong (2nd dot).  These
+                 * strings use the tk_retokenize_cur_string fn
+                 * to break up the string into more tokens
+                 */
+                res = tokenize_number(tkc);
+            } else if (isdigit(*tkc->bptr) &&
+                       (tkc->source != TK_SOURCE_YANG)) {
+                res = tokenize_number(tkc);
+            } else {
+                /* check for a 2 char token before 1 char token */
+                ttyp = get_token_id(tkc->bptr, 2, tkc->source);
+                if (ttyp != TK_TT_NONE) {
+                    res = add_new_token(tkc, 
+                                        ttyp, 
+                                        tkc->bptr+2, 
+                                        tkc->linepos);
+                    tkc->bptr += 2;
+                    tkc->linepos += 2;
+                } else {
+                    /* not a 2-char, check for a 1-char token */
+                    ttyp = get_token_id(tkc->bptr, 1, tkc->source);
+                    if (ttyp != TK_TT_NONE) {
+                        /* got a 1 char token */
+                        res = add_new_token(tkc, 
+                                            ttyp, 
+                                            tkc->bptr+1, 
+                                            tkc->linepos);
+                        tkc->bptr++;
+                        tkc->linepos++;
+                    } else {
+                        /* ran out of token type choices 
+                         * call it a string 
+                         */
+                        res = tokenize_string(tkc);
+                    }
+                }
+            }
+        }  /* end while non-zero chars left in buff and NO_ERR */
+
+        /* finish outer loop, once through for buffer mode */
+        if (!(tkc->flags & TK_FL_MALLOC)) {
+            done = TRUE;
+        }
+    }
+
+    if (res == NO_ERR && tkc->source != TK_SOURCE_XPATH) {
+        res = concat_qstrings(tkc);
+    }
+
+    if (res == NO_ERR) {
+        /* setup the token queue current pointer */
+        tkc->cur = (tk_token_t *)&tkc->tkQ;
+    } else if (report) {
+        ncx_print_errormsg(tkc, mod, res);
+    }
+
+    return res;
+
+}  /* tokenize_input */
+
+
+/********************************************************************
+* FUNCTION tokenize_file
+* 
+* Tokenize a YANG file setup with tk_setup_chain_yang,
+* reading the source from an mmapped copy of the file
+*
+* The tokens and strings are allocated from the chain arena
+* instead of one malloc each, except in DOCMODE, where
+* the token strings are moved to the origstrQ entries
+*
+* Nothing is logged unless 'report' is TRUE, so the
+* prefetch threads can use this function
+*
+* INPUTS:
+*   tkc == token chain setup for a YANG file
+*   mod == module in progress (NULL if not used)
+*   report == TRUE to print error messages
+*
+* RETURNS:
+*   status of the operation
+*********************************************************************/
+static status_t
+    tokenize_file (tk_chain_t *tkc,
+                   ncx_module_t *mod,
+                   boolean report)
+{
+    struct stat      st;
+    void            *src;
+    status_t         res;
+
+    if (tkc->source != TK_SOURCE_YANG ||
+        tkc->filename == NULL ||
+        tkc->fp == NULL ||
+        TK_DOCMODE(tkc) ||
+        !dlq_empty(&tkc->tkQ)) {
+        return tokenize_input(tkc, mod, report);
+    }
+
+    tkc->flags |= TK_FL_ARENA;
+
+    if (fstat(fileno(tkc->fp), &st) != 0 ||
+        st.st_size == 0 ||
+        st.st_size > (off_t)NCX_MAX_UINT) {
+        return tokenize_input(tkc, mod, report);
+    }
+
+    src = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, 
+               fileno(tkc->fp), 0);
+    if (src == MAP_FAILED) {
+        return tokenize_input(tkc, mod, report);
+    }
+
+    tkc->mapbuff = (const xmlChar *)src;
+    tkc->maplen = (size_t)st.st_size;
+    tkc->mappos = 0;
+    res = tokenize_input(tkc, mod, report);
+    tkc->mapbuff = NULL;
+    tkc->maplen = 0;
+    tkc->mappos = 0;
+
+    munmap(src, (size_t)st.st_size);
+    return res;
+
+}  /* tokenize_file */
+
+
+/********************************************************************
+* FUNCTION prefetch_worker
+* 
+* Thread start function for the token prefetch threads
+* Tokenize queued files until tk_prefetch_stop is called
+*
+* INPUTS:
+*   arg == not used
+*
+* RETURNS:
+*   NULL
+*********************************************************************/
+static void *
+    prefetch_worker (void *arg)
+{
+    tk_prefetch_t  *prefetch;
+    tk_chain_t     *tkc;
+    FILE           *fp;
+    status_t        res;
+
+    (void)arg;
+
+    pthread_mutex_lock(&tk_prefetch_lock);
+    while (!tk_prefetch_done) {
+        prefetch = NULL;
+        if (tk_prefetch_ready < TK_PREFETCH_MAX_READY) {
+            for (prefetch = (tk_prefetch_t *)dlq_firstEntry(&tk_prefetchQ);
+                 prefetch != NULL;
+                 prefetch = (tk_prefetch_t *)dlq_nextEntry(prefetch)) {
+                if (prefetch->state == TK_PREFETCH_QUEUED) {
+                    break;
+                }
+            }
+        }
+        if (prefetch == NULL) {
+            pthread_cond_wait(&tk_prefetch_workcond, &tk_prefetch_lock);
+            continue;
+        }
+
+        prefetch->state = TK_PREFETCH_RUNNING;
+        pthread_mutex_unlock(&tk_prefetch_lock);
+
+        res = NO_ERR;
+        tkc = tk_new_chain();
+        if (!tkc) {
+            res = ERR_INTERNAL_MEM;
+        } else {
+            fp = fopen((const char *)prefetch->filespec, "r");
+            if (!fp) {
+                res = ERR_FIL_OPEN;
+            } else {
+                tk_setup_chain_yang(tkc, fp, prefetch->filespec);
+                res = tokenize_file(tkc, NULL, FALSE);
+                fclose(fp);
+                tkc->fp = NULL;
+            }
+        }
+
+        pthread_mutex_lock(&tk_prefetch_lock);
+        prefetch->tkc = tkc;
+        prefetch->res = res;
+        prefetch->state = TK_PREFETCH_DONE;
+        tk_prefetch_ready++;
+        pthread_cond_broadcast(&tk_prefetch_donecond);
+    }
+    pthread_mutex_unlock(&tk_prefetch_lock);
+
+    return NULL;
+
+}  /* prefetch_worker */
+
+
+/********************************************************************
+* FUNCTION free_prefetch
+* 
+* Free a token prefetch entry
+*
+* INPUTS:
+*   prefetch == entry to free
+*********************************************************************/
+static void
+    free_prefetch (tk_prefetch_t *prefetch)
+{
+    if (prefetch->tkc) {
+        tk_free_chain(prefetch->tkc);
+    }
+    if (prefetch->filespec) {
+        m__free(prefetch->filespec);
+    }
+    m__free(prefetch);
+
+}  /* free_prefetch */
+
+
+/********************************************************************
+* FUNCTION claim_prefetch
+* 
+* Get the tokens for a file from the token prefetch threads
+* Wait for the file if a thread is tokenizing it now.
+*
+* INPUTS:
+*   tkc == token chain setup for a YANG file
+*
+* OUTPUTS:
+*   tkc->tkQ filled in and tkc->linenum set if TRUE returned
+*
+* RETURNS:
+*   TRUE if the prefetched tokens were moved to 'tkc'
+*   FALSE if the file needs to be tokenized by the caller
+*********************************************************************/
+static boolean
+    claim_prefetch (tk_chain_t *tkc)
+{
+    tk_prefetch_t  *prefetch;
+    boolean         ret;
+
+    pthread_mutex_lock(&tk_prefetch_lock);
+    for (prefetch = (tk_prefetch_t *)dlq_firstEntry(&tk_prefetchQ);
+         prefetch != NULL;
+         prefetch = (tk_prefetch_t *)dlq_nextEntry(prefetch)) {
+        if (!xml_strcmp(prefetch->filespec, tkc->filename)) {
+            break;
+        }
+    }
+    if (prefetch == NULL) {
+        pthread_mutex_unlock(&tk_prefetch_lock);
+        return FALSE;
+    }
+
+    while (prefetch->state == TK_PREFETCH_RUNNING) {
+        pthread_cond_wait(&tk_prefetch_donecond, &tk_prefetch_lock);
+    }
+    dlq_remove(prefetch);
+    if (prefetch->state == TK_PREFETCH_DONE) {
+        tk_prefetch_ready--;
+        pthread_cond_signal(&tk_prefetch_workcond);
+    }
+    pthread_mutex_unlock(&tk_prefetch_lock);
+
+    ret = FALSE;
+    if (prefetch->state == TK_PREFETCH_DONE && 
+        prefetch->res == NO_ERR &&
+        dlq_empty(&tkc->tkQ)) {
+        dlq_block_enque(&prefetch->tkc->tkQ, &tkc->tkQ);
+        if (!dlq_empty(&prefetch->tkc->arenaQ)) {
+            /* the tokens are in the prefetch chain arena */
+            if (dlq_empty(&tkc->arenaQ)) {
+                dlq_block_enque(&prefetch->tkc->arenaQ, &tkc->arenaQ);
+            } else {
+                dlq_block_insertAhead(&prefetch->tkc->arenaQ,
+                                      dlq_firstEntry(&tkc->arenaQ));
+            }
+            tkc->flags |= TK_FL_ARENA;
+        }
+        tkc->linenum = prefetch->tkc->linenum;
+        tkc->cur = (tk_token_t *)&tkc->tkQ;
+        ret = TRUE;
+    }
+    free_prefetch(prefetch);
+    return ret;
+
+}  /* claim_prefetch */
+
+
+/**************    E X T E R N A L   F U N C T I O N S **********/
+
+
+/********************************************************************
+* FUNCTION tk_new_chain
+* 
+* Allocatate a new token parse chain
+*
+* RETURNS:
+*  new parse chain or NULL if memory error
+*********************************************************************/
+tk_chain_t * 
+    tk_new_chain (void)
+{
+    tk_chain_t  *tkc;
+
+    tkc = m__getObj(tk_chain_t);
+    if (!tkc) {
+        return NULL;
+    }
+    memset(tkc, 0x0, sizeof(tk_chain_t));
+    dlq_createSQue(&tkc->tkQ);
+    tkc->cur = (tk_token_t *)&tkc->tkQ;
+    dlq_createSQue(&tkc->tkptrQ);
+    dlq_createSQue(&tkc->arenaQ);
+    return tkc;
+           
+} /* tk_new_chain */
+
+
+/********************************************************************
+* FUNCTION tk_setup_chain_conf
+* 
+* Setup a previously allocated chain for a text config file
+*
+* INPUTS
+*    tkc == token chain to setup
+*    fp == open file to use for text source
+*    filename == source filespec
+*********************************************************************/
+void
+    tk_setup_chain_conf (tk_chain_t *tkc,
+                         FILE *fp,
+                         const xmlChar *filename)
+{
+#ifdef DEBUG
+    if (!tkc) {
+        SET_ERROR(ERR_INTERNAL_PTR);
+        return;
+    }
+#endif
+
+    tkc->fp = fp;
+    tkc->source = TK_SOURCE_CONF;
+    tkc->filename = filename;
+    tkc->flags |= TK_FL_MALLOC;
+           
+} /* tk_setup_chain_conf */
+
+
+/********************************************************************
+* FUNCTION tk_setup_chain_yang
+* 
+* Setup a previously allocated chain for a YANG file
+*
+* INPUTS
+*    tkc == token chain to setup
+*    fp == open file to use for text source
+*    filename == source filespec
+*********************************************************************/
+void
+    tk_setup_chain_yang (tk_chain_t *tkc,
+                         FILE *fp,
+                         const xmlChar *filename)
+{
+#ifdef DEBUG
+    if (!tkc) {
+        SET_ERROR(ERR_INTERNAL_PTR);
+        return;
+    }
+#endif
+
+    tkc->fp = fp;
+    tkc->source = TK_SOURCE_YANG;
+    tkc->filename = filename;
+    tkc->flags |= TK_FL_MALLOC;
+           
+} /* tk_setup_chain_yang */
+
+
+/********************************************************************
+* FUNCTION tk_setup_chain_yin
+* 
+* Setup a previously allocated chain for a YIN file
+*
+* INPUTS
+*    tkc == token chain to setup
+*    filename == source filespec
+*********************************************************************/
+void
+    tk_setup_chain_yin (tk_chain_t *tkc,
+                        const xmlChar *filename)
+{
+#ifdef DEBUG
+    if (!tkc) {
         SET_ERROR(ERR_INTERNAL_PTR);
         return;
     }
@@ -2298,6 +3072,7 @@ void
     if ((tkc->flags & TK_FL_MALLOC) && tkc->buff) {
         m__free(tkc->buff);
     }
+    free_arena(tkc);
     m__free(tkc);
     
 } /* tk_free_chain */
@@ -2647,245 +3422,261 @@ boolean
 
 
 /********************************************************************
-* FUNCTION tk_tokenize_input
+* FUNCTION tk_tokenize_input
+* 
+* Parse the input (FILE or buffer) into tk_token_t structs
+*
+* The tkc param must be initialized to use the internal
+* buffer to read from the specified filespec:
+*
+*    tkc->filename
+*    tkc->flags
+*    tkc->fp
+*    tkc->source
+*
+* External buffer mode:
+*
+* If no filename is provided, the the TK_FL_MALLOC 
+* flag will not be set, and the tkc->buff field 
+* must be initialized before this function is called.  
+* This function will not free the buffer,
+* but just read from it until a '0' char is reached.
+*
+* Error messages are printed by this function!!
+* Do not duplicate error messages upon error return
+*
+* INPUTS:
+*   tkc == token chain 
+*   mod == module in progress (NULL if not used)
+*          !!! Just used for error messages !!!
+*
+* RETURNS:
+*   status of the operation
+*********************************************************************/
+status_t 
+    tk_tokenize_input (tk_chain_t *tkc,
+                       ncx_module_t *mod)
+{
+    return tokenize_input(tkc, mod, TRUE);
+
+}  /* tk_tokenize_input */
+
+
+/********************************************************************
+* FUNCTION tk_tokenize_file
+* 
+* Tokenize a YANG file setup with tk_setup_chain_yang,
+* using the tokens from a prefetch thread if prefetching
+* is enabled
+*
+* INPUTS:
+*   tkc == token chain setup for a YANG file
+*   mod == module in progress (NULL if not used)
+*
+* RETURNS:
+*   status of the operation
+*********************************************************************/
+status_t
+    tk_tokenize_file (tk_chain_t *tkc,
+                      ncx_module_t *mod)
+{
+#ifdef DEBUG
+    if (!tkc) {
+        return SET_ERROR(ERR_INTERNAL_PTR);
+    }
+#endif
+
+    if (tk_prefetch_threads != NULL &&
+        tkc->filename != NULL &&
+        tkc->source == TK_SOURCE_YANG &&
+        !TK_DOCMODE(tkc) &&
+        claim_prefetch(tkc)) {
+        if (LOGDEBUG2) {
+            log_debug2("\ntk: using prefetched tokens for '%s'",
+                       tkc->filename);
+        }
+        return NO_ERR;
+    }
+
+    return tokenize_file(tkc, mod, TRUE);
+
+}  /* tk_tokenize_file */
+
+
+/********************************************************************
+* FUNCTION tk_set_prefetch_threads
 * 
-* Parse the input (FILE or buffer) into tk_token_t structs
-*
-* The tkc param must be initialized to use the internal
-* buffer to read from the specified filespec:
-*
-*    tkc->filename
-*    tkc->flags
-*    tkc->fp
-*    tkc->source
+* Set the number of threads used to tokenize YANG files
+* queued with tk_prefetch_file
 *
-* External buffer mode:
+* INPUTS:
+*   count == number of threads, including the thread that
+*            parses the modules; 1 to disable prefetching
+*********************************************************************/
+void
+    tk_set_prefetch_threads (uint32 count)
+{
+    tk_prefetch_count = count;
+
+}  /* tk_set_prefetch_threads */
+
+
+/********************************************************************
+* FUNCTION tk_get_prefetch_threads
+* 
+* Get the number of threads used to tokenize YANG files
 *
-* If no filename is provided, the the TK_FL_MALLOC 
-* flag will not be set, and the tkc->buff field 
-* must be initialized before this function is called.  
-* This function will not free the buffer,
-* but just read from it until a '0' char is reached.
+* RETURNS:
+*   number of threads set with tk_set_prefetch_threads
+*********************************************************************/
+uint32
+    tk_get_prefetch_threads (void)
+{
+    return tk_prefetch_count;
+
+}  /* tk_get_prefetch_threads */
+
+
+/********************************************************************
+* FUNCTION tk_prefetch_file
+* 
+* Queue a YANG file to be tokenized by the prefetch threads,
+* so tk_tokenize_file can use the tokens when the file is
+* parsed.  The threads are started the first time this
+* function is called.
 *
-* Error messages are printed by this function!!
-* Do not duplicate error messages upon error return
+* Prefetching is not done if there is only 1 parse thread,
+* if line length warnings or debug3 tokenizer logging are
+* enabled, or if the memory debug counters are enabled,
+* because they are not thread-safe
 *
 * INPUTS:
-*   tkc == token chain 
-*   mod == module in progress (NULL if not used)
-*          !!! Just used for error messages !!!
+*   filespec == YANG file to tokenize
 *
 * RETURNS:
-*   status of the operation
+*   status of the operation; the file is just parsed later
+*   by the caller if it is not queued
 *********************************************************************/
-status_t 
-    tk_tokenize_input (tk_chain_t *tkc,
-                       ncx_module_t *mod)
+status_t
+    tk_prefetch_file (const xmlChar *filespec)
 {
-    status_t      res;
-    boolean       done;
-    tk_token_t   *tk;
-    tk_type_t     ttyp;
+    tk_prefetch_t  *prefetch;
+    uint32          i;
 
 #ifdef DEBUG
-    if (!tkc) {
+    if (!filespec) {
         return SET_ERROR(ERR_INTERNAL_PTR);
     }
 #endif
 
-    /* check if a temp buffer is needed */
-    if (tkc->flags & TK_FL_MALLOC) {
-        tkc->buff = m__getMem(TK_BUFF_SIZE);
-        if (!tkc->buff) {
-            res = ERR_INTERNAL_MEM;
-            ncx_print_errormsg(tkc, mod, res);
-            return res;
-        } else {
-            memset(tkc->buff, 0x0, TK_BUFF_SIZE);
-        }
-    } else if (tkc->buff == NULL) {
-        /* tkc->buff expected to be setup already */
-        return SET_ERROR(ERR_INTERNAL_VAL);
-    }
+#ifdef NCX_DEBUG_MEMORY
+    return NO_ERR;
+#endif
 
-    /* setup buffer for parsing */
-    res = NO_ERR;
-    tkc->bptr = tkc->buff;
+    if (tk_prefetch_count <= 1 || 
+        tk_prefetch_done ||
+        ncx_get_warn_linelen() != 0 ||
+        LOGDEBUG3) {
+        return NO_ERR;
+    }
 
-    /* outside loop iterates per buffer full only
-     * if reading input from file
-     */
-    done = FALSE;
-    while (!done) {
-        /* get one line of input if parsing from FILE in buffer,
-         * or already have the buffer if parsing from memory
-         */
-        if (tkc->filename) {
-            if (!fgets((char *)tkc->buff, TK_BUFF_SIZE, tkc->fp)) {
-                /* read line failed, treating as not an error */
-                res = NO_ERR;
-                done = TRUE;
-                continue;
-            } else {
-                /* save newline token for conf file only */
-                if (tkc->source == TK_SOURCE_CONF) {
-                    tk = new_token(TK_TT_NEWLINE, NULL, 0);
-                    if (!tk) {
-                        res = ERR_INTERNAL_MEM;
-                        done = TRUE;
-                        continue;
-                    } 
-                    tk->linenum = tkc->linenum;
-                    tk->linepos = tkc->linepos;
-                    dlq_enque(tk, &tkc->tkQ);
-                }
-                tkc->linenum++;
-                tkc->linepos = 1;
+    if (tk_prefetch_threads == NULL) {
+        tk_prefetch_threads = 
+            m__getMem((tk_prefetch_count - 1) * sizeof(pthread_t));
+        if (!tk_prefetch_threads) {
+            return ERR_INTERNAL_MEM;
+        }
+        dlq_createSQue(&tk_prefetchQ);
+        tk_prefetch_running = 0;
+        for (i = 0; i < tk_prefetch_count - 1; i++) {
+            if (pthread_create(&tk_prefetch_threads[i], NULL,
+                               prefetch_worker, NULL) != 0) {
+                break;
             }
+            tk_prefetch_running++;
+        }
+        if (tk_prefetch_running == 0) {
+            m__free(tk_prefetch_threads);
+            tk_prefetch_threads = NULL;
+            tk_prefetch_done = TRUE;
+            return ERR_NCX_OPERATION_FAILED;
+        }
+    }
 
-            /* set buffer pointer to start of buffer */
-            tkc->bptr = tkc->buff;
+    prefetch = m__getObj(tk_prefetch_t);
+    if (!prefetch) {
+        return ERR_INTERNAL_MEM;
+    }
+    memset(prefetch, 0x0, sizeof(tk_prefetch_t));
+    prefetch->filespec = xml_strdup(filespec);
+    if (!prefetch->filespec) {
+        m__free(prefetch);
+        return ERR_INTERNAL_MEM;
+    }
+    prefetch->state = TK_PREFETCH_QUEUED;
 
-#ifdef TK_RDLN_DEBUG
-            if (LOGDEBUG3) {
-                if (xml_strlen(tkc->buff) < 80) {
-                    log_debug3("\ntk_tokenize: read line (%s)", tkc->buff);
-                } else {
-                    log_debug3("\ntk_tokenize: read line len  (%d)", 
-                               xml_strlen(tkc->buff));
-                }
-            }
-#endif
-            ncx_check_warn_linelen(tkc, mod, tkc->buff);
-        }
+    pthread_mutex_lock(&tk_prefetch_lock);
+    dlq_enque(prefetch, &tk_prefetchQ);
+    pthread_cond_signal(&tk_prefetch_workcond);
+    pthread_mutex_unlock(&tk_prefetch_lock);
 
-        /* Have some sort of input in the buffer (tkc->buff) */
-        while (*tkc->bptr && res==NO_ERR) { 
+    return NO_ERR;
 
-            /* skip whitespace */
-            while (*tkc->bptr && (*tkc->bptr != '\n') &&
-                   xml_isspace(*tkc->bptr)) {
-                if (*tkc->bptr == '\t') {
-                    tkc->linepos += NCX_TABSIZE;
-                } else {
-                    tkc->linepos++;
-                }
-                tkc->bptr++;
-            }
+}  /* tk_prefetch_file */
 
-            /* check the first non-whitespace char found or exit */
-            if (!*tkc->bptr) {
-                continue;                 /* EOS, exit loop */
-            } else if (*tkc->bptr == '\n') {
-                /* save newline token for conf file only */
-                if (tkc->source == TK_SOURCE_CONF) {
-                    tk = new_token(TK_TT_NEWLINE, NULL, 0);
-                    if (!tk) {
-                        res = ERR_INTERNAL_MEM;
-                        done = TRUE;
-                        continue;
-                    } 
-                    tk->linenum = tkc->linenum;
-                    tk->linepos = ++tkc->linepos;
-                    dlq_enque(tk, &tkc->tkQ);
-                }
-                tkc->bptr++;
-            } else if ((tkc->source == TK_SOURCE_CONF &&
-                        *tkc->bptr == NCX_COMMENT_CH) ||
-                       (tkc->source == TK_SOURCE_YANG &&
-                        *tkc->bptr == '/' && tkc->bptr[1] == '/')) {
-                /* CONF files use the '# to eoln' comment format
-                 * YANG files use the '// to eoln' comment format
-                 * skip past the comment, make next char EOLN
-                 *
-                 * TBD: SAVE COMMENTS IN XMLDOC SESSION MODE
-                 */
-                while (*tkc->bptr && *tkc->bptr != '\n') {
-                    tkc->bptr++;
-                }
-            } else if (tkc->source == TK_SOURCE_YANG &&
-                       *tkc->bptr == '/' && tkc->bptr[1] == '*') {
-                /* found start of a C-style YANG comment */
-                res = skip_yang_cstring(tkc);
-            } else if (*tkc->bptr == NCX_QSTRING_CH) {
-                /* get a dbl-quoted string which may span multiple lines */
-                res = tokenize_qstring(tkc);
-            } else if (*tkc->bptr == NCX_SQSTRING_CH) {
-                /* get a single-quoted string which may span multiple lines */
-                res = tokenize_sqstring(tkc);
-            } else if (tkc->source == TK_SOURCE_XPATH &&
-                       *tkc->bptr == NCX_VARBIND_CH) {
-                res = tokenize_varbind_string(tkc);
-            } else if (ncx_valid_fname_ch(*tkc->bptr)) {
-                /* get some some of unquoted ID string or regular string */
-                res = tokenize_id_string(tkc);
-            } else if ((*tkc->bptr=='+' || *tkc->bptr=='-') &&
-                       isdigit(*(tkc->bptr+1)) &&
-                       (tkc->source != TK_SOURCE_YANG) &&
-                       (tkc->source != TK_SOURCE_XPATH)) {
-                /* get some sort of number 
-                 * YANG does not have +/- number sequences
-                 * so they are parsed (first pass) as a string
-                 * There are corner cases such as range 1..max
-                 * that will be parsed wrong (2nd dot).  These
-                 * strings use the tk_retokenize_cur_string fn
-                 * to break up the string into more tokens
-                 */
-                res = tokenize_number(tkc);
-            } else if (isdigit(*tkc->bptr) &&
-                       (tkc->source != TK_SOURCE_YANG)) {
-                res = tokenize_number(tkc);
-            } else {
-                /* check for a 2 char token before 1 char token */
-                ttyp = get_token_id(tkc->bptr, 2, tkc->source);
-                if (ttyp != TK_TT_NONE) {
-                    res = add_new_token(tkc, 
-                                        ttyp, 
-                                        tkc->bptr+2, 
-                                        tkc->linepos);
-                    tkc->bptr += 2;
-                    tkc->linepos += 2;
-                } else {
-                    /* not a 2-char, check for a 1-char token */
-                    ttyp = get_token_id(tkc->bptr, 1, tkc->source);
-                    if (ttyp != TK_TT_NONE) {
-                        /* got a 1 char token */
-                        res = add_new_token(tkc, 
-                                            ttyp, 
-                                            tkc->bptr+1, 
-                                            tkc->linepos);
-                        tkc->bptr++;
-                        tkc->linepos++;
-                    } else {
-                        /* ran out of token type choices 
-                         * call it a string 
-                         */
-                        res = tokenize_string(tkc);
-                    }
-                }
-            }
-        }  /* end while non-zero chars left in buff and NO_ERR */
 
-        /* finish outer loop, once through for buffer mode */
-        if (!(tkc->flags & TK_FL_MALLOC)) {
-            done = TRUE;
-        }
+/********************************************************************
+* FUNCTION tk_prefetch_stop
+* 
+* Stop the token prefetch threads and free any tokens
+* that were not used.  Files queued with tk_prefetch_file
+* after this call are not prefetched.
+*
+*********************************************************************/
+void
+    tk_prefetch_stop (void)
+{
+    tk_prefetch_t  *prefetch;
+    uint32          i;
+
+    if (tk_prefetch_threads == NULL) {
+        return;
     }
 
-    if (res == NO_ERR && tkc->source != TK_SOURCE_XPATH) {
-        res = concat_qstrings(tkc);
+    pthread_mutex_lock(&tk_prefetch_lock);
+    tk_prefetch_done = TRUE;
+    pthread_cond_broadcast(&tk_prefetch_workcond);
+    pthread_mutex_unlock(&tk_prefetch_lock);
+
+    for (i = 0; i < tk_prefetch_running; i++) {
+        pthread_join(tk_prefetch_threads[i], NULL);
     }
+    m__free(tk_prefetch_threads);
+    tk_prefetch_threads = NULL;
+    tk_prefetch_running = 0;
+    tk_prefetch_ready = 0;
 
-    if (res == NO_ERR) {
-        /* setup the token queue current pointer */
-        tkc->cur = (tk_token_t *)&tkc->tkQ;
-    } else {
-        ncx_print_errormsg(tkc, mod, res);
+    while (!dlq_empty(&tk_prefetchQ)) {
+        prefetch = (tk_prefetch_t *)dlq_deque(&tk_prefetchQ);
+        free_prefetch(prefetch);
     }
 
-    return res;
+}  /* tk_prefetch_stop */
 
-}  /* tk_tokenize_input */
+
+/********************************************************************
+* FUNCTION tk_cleanup
+* 
+* Cleanup the token module static data
+*
+*********************************************************************/
+void
+    tk_cleanup (void)
+{
+    tk_prefetch_stop();
+    tk_prefetch_done = FALSE;
+
+}  /* tk_cleanup */
 
 
 /********************************************************************
@@ -3171,6 +3962,9 @@ tk_chain_t *
         token->linenum = oldtoken->linenum;
         token->linepos = oldtoken->linepos;
         token->nsid = oldtoken->nsid;
+        token->xpaxis = oldtoken->xpaxis;
+        token->xpnodetyp = oldtoken->xpnodetyp;
+        token->xpfncb = oldtoken->xpfncb;
         dlq_enque(token, &tkc->tkQ);
     }
 
@@ -3256,7 +4050,7 @@ status_t
     /* hack for YIN input, no XML line numbers */
     tkc->linenum++;
 
-    tk = new_token_wmod(TK_TT_MSTRING,
+    tk = new_token_wmod(tkc, TK_TT_MSTRING,
                         prefix, 
                         prefixlen, 
                         valstr,
@@ -180,6 +180,21 @@ extern "C" {
  */
 #define TK_FL_DOCMODE     bit2
 
+/* == 1: the tokens and token strings are allocated from
+ *       the tkc->arenaQ blocks, which are freed all at once
+ *       in tk_free_chain; not used in DOCMODE
+ * == 0: each token and string is malloced separately
+ */
+#define TK_FL_ARENA       bit3
+
+/* bits for tk_token_t arena field; set if the memory
+ * is in the token chain arena and must not be freed
+ */
+#define TK_ARENA_TOKEN    bit0
+#define TK_ARENA_VAL      bit1
+#define TK_ARENA_MOD      bit2
+#define TK_ARENA_ORIGVAL  bit3
+
 
 
 
@@ -287,6 +302,10 @@ typedef struct tk_token_t_ {
     uint32      linenum;
     uint32      linepos;
     xmlns_id_t  nsid;        /* only used for TK_TT_MSTRING tokens */
+    uint8       xpaxis;      /* XPath axis id + 1; 0 if not checked */
+    uint8       xpnodetyp;    /* XPath node type + 1; 0 if not checked */
+    uint8       arena;        /* TK_ARENA_* bits; 0 if all malloced */
+    const void *xpfncb;    /* XPath function bound to a TK_TT_TSTRING */
     dlq_hdr_t   origstrQ;  /* Q of tk_origstr_t only used in DOCMODE */
 } tk_token_t;
 
@@ -316,6 +335,10 @@ typedef struct tk_chain_t_ {
     uint32         linepos;
     uint32         flags;
     tk_source_t    source;
+    dlq_hdr_t      arenaQ;  /* Q of tk_arena_t if TK_FL_ARENA set */
+    const xmlChar *mapbuff;   /* mmapped YANG source being read */
+    size_t         maplen;
+    size_t         mappos;
 } tk_chain_t;
 
 
@@ -593,6 +616,91 @@ extern status_t
 		       ncx_module_t *mod);
 
 
+/********************************************************************
+* FUNCTION tk_tokenize_file
+* 
+* Tokenize a YANG file setup with tk_setup_chain_yang,
+* using the tokens from a prefetch thread if prefetching
+* is enabled
+*
+* INPUTS:
+*   tkc == token chain setup for a YANG file
+*   mod == module in progress (NULL if not used)
+*
+* RETURNS:
+*   status of the operation
+*********************************************************************/
+extern status_t
+    tk_tokenize_file (tk_chain_t *tkc,
+                      ncx_module_t *mod);
+
+
+/********************************************************************
+* FUNCTION tk_set_prefetch_threads
+* 
+* Set the number of threads used to tokenize YANG files
+* queued with tk_prefetch_file
+*
+* INPUTS:
+*   count == number of threads, including the thread that
+*            parses the modules; 1 to disable prefetching
+*********************************************************************/
+extern void
+    tk_set_prefetch_threads (uint32 count);
+
+
+/********************************************************************
+* FUNCTION tk_get_prefetch_threads
+* 
+* Get the number of threads used to tokenize YANG files
+*
+* RETURNS:
+*   number of threads set with tk_set_prefetch_threads
+*********************************************************************/
+extern uint32
+    tk_get_prefetch_threads (void);
+
+
+/********************************************************************
+* FUNCTION tk_prefetch_file
+* 
+* Queue a YANG file to be tokenized by the prefetch threads,
+* so tk_tokenize_file can use the tokens when the file is
+* parsed.  The threads are started the first time this
+* function is called.
+*
+* INPUTS:
+*   filespec == YANG file to tokenize
+*
+* RETURNS:
+*   status of the operation; the file is just parsed later
+*   by the caller if it is not queued
+*********************************************************************/
+extern status_t
+    tk_prefetch_file (const xmlChar *filespec);
+
+
+/********************************************************************
+* FUNCTION tk_prefetch_stop
+* 
+* Stop the token prefetch threads and free any tokens
+* that were not used
+*
+*********************************************************************/
+extern void
+    tk_prefetch_stop (void);
+
+
+/********************************************************************
+* FUNCTION tk_cleanup
+* 
+* Cleanup the token module static data
+*
+*********************************************************************/
+extern void
+    tk_cleanup (void);
+
+
 /********************************************************************
 * FUNCTION tk_retokenize_cur_string
 * 
@@ -38,6 +38,7 @@ date         init     comment
 #include "ncx.h"
 #include "ncx_appinfo.h"
 #include "ncx_num.h"
+#include "ncx_regex.h"
 #include "tk.h"
 #include "typ.h"
 #include "xml_util.h"
@@ -4096,7 +4097,7 @@ void
 #endif
 
     if (pat->pattern) {
-        xmlRegFreeRegexp(pat->pattern);
+        ncx_regex_release(pat->pat_str);
     }
     if (pat->pat_str) {
         m__free(pat->pat_str);
@@ -4111,7 +4112,7 @@ void
 /********************************************************************
 * FUNCTION typ_compile_pattern
 * 
-* Compile a pattern as into a regex_t struct
+* Get the compiled regexp for a pattern from the regex cache
 *
 * INPUTS:
 *     btyp == base type of the string
@@ -4126,6 +4127,7 @@ void
 status_t
     typ_compile_pattern (typ_pattern_t *pat)
 {
+    status_t  res;
 
 #ifdef DEBUG
     if (!pat || !pat->pat_str) {
@@ -4133,12 +4135,8 @@ status_t
     }
 #endif
 
-    pat->pattern = xmlRegexpCompile(pat->pat_str);
-    if (!pat->pattern) {
-        return ERR_NCX_INVALID_PATTERN;
-    } else {
-        return NO_ERR;
-    }
+    pat->pattern = ncx_regex_get(pat->pat_str, &res);
+    return res;
 
 }  /* typ_compile_pattern */
 
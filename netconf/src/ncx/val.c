@@ -62,6 +62,7 @@ date         init     comment
 #include "typ.h"
 #include "val.h"
 #include "val123.h"
+#include "val_child.h"
 #include "val_util.h"
 #include "xml_util.h"
 #include "xml_wr.h"
@@ -489,6 +490,8 @@ static void
         free_editvars(val);
     }
 
+    val_child_index_free(val);
+
     /* clean the val->v union, depending on base type */
     switch (btyp) {
     case NCX_BT_INT8:
@@ -803,6 +806,11 @@ static void
     typ_template_t  *listtyp;
     ncx_btype_t            listbtyp;
 
+    /* the QName may change if this node is already linked
+     * into an indexed parent
+     */
+    val_child_index_free(val->parent);
+
     val->obj = obj;
     val->typdef = obj_get_typdef(obj);
     val->btyp = btyp;
@@ -1545,6 +1553,277 @@ static val_value_t *
 }  /* clone_test */
 
 
+/********************************************************************
+* FUNCTION add_child_sorted
+* 
+*   Add a child value node to a parent value node
+*   in the proper place
+*
+* INPUTS:
+*    child == node to store in the parent
+*    parent == complex value node with a childQ
+*    scancnt == address of return number of child nodes checked
+*
+* OUTPUTS:
+*    *scancnt is incremented for each sibling node checked
+*********************************************************************/
+static void
+    add_child_sorted (val_value_t *child,
+                      val_value_t *parent,
+                      uint32 *scancnt)
+{
+    child->parent = parent;
+    dlq_hdr_t *childQ = &parent->v.childQ;
+
+    /* check new first entry */
+    if (dlq_empty(childQ)) {
+        dlq_enque(child, childQ);
+        return;
+    }
+
+    val_value_t *curval = NULL;
+    obj_template_t *newobj = child->obj;
+    xmlns_id_t parentid = val_get_nsid(parent);
+    xmlns_id_t childid = val_get_nsid(child);
+    boolean sysorder = obj_is_system_ordered(newobj);
+    int ret = 0;
+
+    /* check if the child goes after the last instance
+     * of this node type, so the siblings in front of it
+     * do not need to be checked
+     */
+    if (parent->obj->objtype != OBJ_TYP_ANYXML) {
+        curval = val_child_index_last(parent, child);
+        if (curval != NULL && curval->obj == newobj &&
+            !VAL_IS_DELETED(curval)) {
+            if (sysorder && ncx_get_system_sorted()) {
+                if (newobj->objtype == OBJ_TYP_LIST) {
+                    ret = val_index_compare(child, curval);
+                } else {
+                    ret = val_compare(child, curval);
+                }
+            } else {
+                ret = 0;
+            }
+            if (ret >= 0) {
+                dlq_insertAfter(child, curval);
+                return;
+            }
+        }
+    }
+
+    /* The current set of sibling nodes needs to
+     * be searched to determine where to insert this child
+     */
+    if (obj_is_root(parent->obj)) {
+        /* adding objects to the root is different; need
+         * to use alphabetical order, not schema order
+         * since submodules blur the top-level object
+         * order within a module namespace
+         */
+        for (curval = val_get_first_child(parent);
+             curval != NULL;
+             curval = val_get_next_child(curval)) {
+
+            (*scancnt)++;
+
+            /* check same type of sibling cornercase
+             * should only happen if the child is
+             * type list or leaf-list
+             */
+            if (newobj == curval->obj) {
+                /* make a new sorted or last one of these entries */
+                boolean syssorted = ncx_get_system_sorted();
+                boolean done = FALSE;
+
+                while (!done) {
+                    if (sysorder && syssorted) {
+                        if (newobj->objtype == OBJ_TYP_LIST) {
+                            ret = val_index_compare(child, curval);
+                        } else {
+                            ret = val_compare(child, curval);
+                        }
+                        if (ret < 0) {
+                            dlq_insertAhead(child, curval);
+                            return;
+                        }
+                    }
+                    val_value_t *nextchild = val_get_next_child(curval);
+                    if (nextchild == NULL || nextchild->obj != child->obj) {
+                        done = TRUE;
+                    } else {
+                        curval = nextchild;
+                        (*scancnt)++;
+                    }
+                }
+                dlq_insertAfter(child, curval);
+                return;
+            }
+
+            ret = xml_strcmp(child->name, curval->name);
+            if (ret < 0) {
+                dlq_insertAhead(child, curval);
+                return;
+            } else if (ret == 0) {
+                ret = xml_strcmp(val_get_mod_name(child),
+                                 val_get_mod_name(curval));
+                if (ret < 0) {
+                    dlq_insertAhead(child, curval);
+                    return;
+                    /* same name, insert in module alphabetical order */
+                }
+            }
+        }
+
+        /* make new last entry */
+        dlq_enque(child, childQ);
+    } else if (parent->obj->objtype == OBJ_TYP_ANYXML) {
+        /* there is no schema order to check, so see if this
+         * child already exists
+         */
+        curval = val_find_child(parent, val_get_mod_name(child), child->name);
+        if (curval != NULL) {
+            /* make new last instance of this child node */
+            val_value_t *saveval = NULL;
+            while (curval != NULL) {
+                saveval = curval;
+                curval = val_find_next_child(parent, val_get_mod_name(child),
+                                             child->name, curval);
+            }
+            dlq_insertAfter(child, saveval);
+        } else {
+            /* make new last child; first one of these */
+            dlq_enque(child, childQ);
+        }
+    } else {
+        /* normal container or list */
+        for (curval = val_get_first_child(parent);
+             curval != NULL;
+             curval = val_get_next_child(curval)) {
+
+            (*scancnt)++;
+
+            /* check same type of sibling cornercase
+             * should only happen if the child is
+             * type list or leaf-list
+             */
+            if (newobj == curval->obj) {
+                /* make a new last one of these entries */
+                boolean syssorted = ncx_get_system_sorted();
+                boolean done = FALSE;
+
+                while (!done) {
+                    if (sysorder && syssorted) {
+                        if (newobj->objtype == OBJ_TYP_LIST) {
+                            ret = val_index_compare(child, curval);
+                        } else {
+                            ret = val_compare(child, curval);
+                        }
+                        if (ret < 0) {
+                            dlq_insertAhead(child, curval);
+                            return;
+                        }
+                    }
+
+                    val_value_t *nextchild = val_get_next_child(curval);
+                    if (nextchild == NULL || nextchild->obj != child->obj) {
+                        done = TRUE;
+                    } else {
+                        curval = nextchild;
+                        (*scancnt)++;
+                    }              
+                }
+
+                /* make a new last instance of this node type */
+                dlq_insertAfter(child, curval);
+                return;
+            }
+
+            /* simple test; since native children
+             * will be before external augmented children;
+             * any native node will insert ahead of such 
+             * an augment node
+             */
+            if (val_get_nsid(curval) != parentid && childid == parentid) {
+                dlq_insertAhead(child, curval);
+                return;
+            }
+
+            /* new node and current node are different so
+             * check if the current object is after the
+             * new object in the schema order.  If so,
+             * then insert ahead of this node
+             *
+             * the object siblings are not numbered, so
+             * a linear search is used here
+             */
+            obj_template_t *testobj = obj_next_child_deep(child->obj);
+            for (; testobj != NULL; testobj = obj_next_child_deep(testobj)) {
+                if (testobj == curval->obj) {
+                    /* insert child ahead of this node
+                     * which occurs after it in schema order
+                     */
+                    dlq_insertAhead(child, curval);
+                    return;
+                }
+            }
+        }
+
+        /* make a new last entry */
+        dlq_enque(child, childQ);
+    }
+
+}   /* add_child_sorted */
+
+
+/********************************************************************
+* FUNCTION child_match
+* 
+* Check if a child node matches the corresponding node
+* from another tree (e.g., from a NETCONF PDU)
+*
+* INPUTS:
+*    val == child node to check
+*    child == child value to find
+*
+* RETURNS:
+*   TRUE if the child node matches
+*********************************************************************/
+static boolean
+    child_match (const val_value_t *val,
+                 const val_value_t *child)
+{
+    if (VAL_IS_DELETED(val)) {
+        return FALSE;
+    }
+
+    /* check the node if the QName matches */
+    if (val->nsid != child->nsid ||
+        xml_strcmp(val->name, child->name)) {
+        return FALSE;
+    }
+
+    if (val->btyp == NCX_BT_LIST) {
+        /* match the instance identifiers, if any */
+        return val_index_match(child, val);
+    } else if (val->obj->objtype == OBJ_TYP_LEAF_LIST) {
+        if (val->btyp == child->btyp) {
+            /* find the leaf-list with the same value */
+            return (val_compare(val, child)) ? FALSE : TRUE;
+        }
+        /* match any value; if this is a subtree
+         * filter test, it is not for a content match
+         * node
+         */
+        return TRUE;
+    }
+
+    /* can only be this one instance */
+    return TRUE;
+
+}  /* child_match */
+
+
 /*************** E X T E R N A L    F U N C T I O N S  *************/
 
 
@@ -1718,6 +1997,7 @@ void
     }
 
     /* replace the name field */
+    val_child_index_free(val->parent);
     if (val->dname) {
         m__free(val->dname);
     }
@@ -1802,6 +2082,9 @@ void
     }
 #endif
 
+    if (val->nsid != nsid) {
+        val_child_index_free(val->parent);
+    }
     val->nsid = nsid;
 
     /* check no change to name */
@@ -1811,6 +2094,7 @@ void
     }
 
     /* replace the name field */
+    val_child_index_free(val->parent);
     if (val->dname) {
         m__free(val->dname);
     }
@@ -4302,6 +4586,7 @@ status_t
     case NCX_BT_STRING:
     case NCX_BT_INSTANCE_ID:
         if (valname && !val->name) {
+            val_child_index_free(val->parent);
             if (val->dname) {
                 SET_ERROR(ERR_INTERNAL_VAL);
                 m__free(val->dname);
@@ -4526,6 +4811,11 @@ status_t
         }
     }
 
+    /* a node linked into an indexed parent may change QName */
+    if (!val->name || val->nsid != nsid) {
+        val_child_index_free(val->parent);
+    }
+
     /* only set name if it is not already set */
     if (!val->name && valname) {
         val->dname = xml_strndup(valname, valnamelen);
@@ -5304,6 +5594,7 @@ void
 
     child->parent = parent;
     dlq_enque(child, &parent->v.childQ);
+    val_child_index_add(child);
 
 }   /* val_add_child */
 
@@ -5326,176 +5617,11 @@ void
     assert( child && "child is NULL!" );
     assert( parent && "parent is NULL!" );
 
-    child->parent = parent;
-    dlq_hdr_t *childQ = &parent->v.childQ;
-
-    /* check new first entry */
-    if (dlq_empty(childQ)) {
-        dlq_enque(child, childQ);
-        return;
-    }
-
-    val_value_t *curval = NULL;
-    obj_template_t *newobj = child->obj;
-    xmlns_id_t parentid = val_get_nsid(parent);
-    xmlns_id_t childid = val_get_nsid(child);
-    boolean sysorder = obj_is_system_ordered(newobj);
-    int ret = 0;
-
-    /* The current set of sibling nodes needs to
-     * be searched to determine where to insert this child
-     */
-    if (obj_is_root(parent->obj)) {
-        /* adding objects to the root is different; need
-         * to use alphabetical order, not schema order
-         * since submodules blur the top-level object
-         * order within a module namespace
-         */
-        for (curval = val_get_first_child(parent);
-             curval != NULL;
-             curval = val_get_next_child(curval)) {
-
-            /* check same type of sibling cornercase
-             * should only happen if the child is
-             * type list or leaf-list
-             */
-            if (newobj == curval->obj) {
-                /* make a new sorted or last one of these entries */
-                boolean syssorted = ncx_get_system_sorted();
-                boolean done = FALSE;
-
-                while (!done) {
-                    if (sysorder && syssorted) {
-                        if (newobj->objtype == OBJ_TYP_LIST) {
-                            ret = val_index_compare(child, curval);
-                        } else {
-                            ret = val_compare(child, curval);
-                        }
-                        if (ret < 0) {
-                            dlq_insertAhead(child, curval);
-                            return;
-                        }
-                    }
-                    val_value_t *nextchild = val_get_next_child(curval);
-                    if (nextchild == NULL || nextchild->obj != child->obj) {
-                        done = TRUE;
-                    } else {
-                        curval = nextchild;
-                    }
-                }
-                dlq_insertAfter(child, curval);
-                return;
-            }
-
-            ret = xml_strcmp(child->name, curval->name);
-            if (ret < 0) {
-                dlq_insertAhead(child, curval);
-                return;
-            } else if (ret == 0) {
-                ret = xml_strcmp(val_get_mod_name(child),
-                                 val_get_mod_name(curval));
-                if (ret < 0) {
-                    dlq_insertAhead(child, curval);
-                    return;
-                    /* same name, insert in module alphabetical order */
-                }
-            }
-        }
-
-        /* make new last entry */
-        dlq_enque(child, childQ);
-    } else if (parent->obj->objtype == OBJ_TYP_ANYXML) {
-        /* there is no schema order to check, so see if this
-         * child already exists
-         */
-        curval = val_find_child(parent, val_get_mod_name(child), child->name);
-        if (curval != NULL) {
-            /* make new last instance of this child node */
-            val_value_t *saveval = NULL;
-            while (curval != NULL) {
-                saveval = curval;
-                curval = val_find_next_child(parent, val_get_mod_name(child),
-                                             child->name, curval);
-            }
-            dlq_insertAfter(child, saveval);
-        } else {
-            /* make new last child; first one of these */
-            dlq_enque(child, childQ);
-        }
-    } else {
-        /* normal container or list */
-        for (curval = val_get_first_child(parent);
-             curval != NULL;
-             curval = val_get_next_child(curval)) {
-
-            /* check same type of sibling cornercase
-             * should only happen if the child is
-             * type list or leaf-list
-             */
-            if (newobj == curval->obj) {
-                /* make a new last one of these entries */
-                boolean syssorted = ncx_get_system_sorted();
-                boolean done = FALSE;
-
-                while (!done) {
-                    if (sysorder && syssorted) {
-                        if (newobj->objtype == OBJ_TYP_LIST) {
-                            ret = val_index_compare(child, curval);
-                        } else {
-                            ret = val_compare(child, curval);
-                        }
-                        if (ret < 0) {
-                            dlq_insertAhead(child, curval);
-                            return;
-                        }
-                    }
-
-                    val_value_t *nextchild = val_get_next_child(curval);
-                    if (nextchild == NULL || nextchild->obj != child->obj) {
-                        done = TRUE;
-                    } else {
-                        curval = nextchild;
-                    }              
-                }
-
-                /* make a new last instance of this node type */
-                dlq_insertAfter(child, curval);
-                return;
-            }
-
-            /* simple test; since native children
-             * will be before external augmented children;
-             * any native node will insert ahead of such 
-             * an augment node
-             */
-            if (val_get_nsid(curval) != parentid && childid == parentid) {
-                dlq_insertAhead(child, curval);
-                return;
-            }
-
-            /* new node and current node are different so
-             * check if the current object is after the
-             * new object in the schema order.  If so,
-             * then insert ahead of this node
-             *
-             * the object siblings are not numbered, so
-             * a linear search is used here
-             */
-            obj_template_t *testobj = obj_next_child_deep(child->obj);
-            for (; testobj != NULL; testobj = obj_next_child_deep(testobj)) {
-                if (testobj == curval->obj) {
-                    /* insert child ahead of this node
-                     * which occurs after it in schema order
-                     */
-                    dlq_insertAhead(child, curval);
-                    return;
-                }
-            }
-        }
+    uint32 scancnt = 0;
 
-        /* make a new last entry */
-        dlq_enque(child, childQ);
-    }
+    add_child_sorted(child, parent, &scancnt);
+    val_child_index_add(child);
+    val_child_index_scanned(parent, scancnt);
 
 }   /* val_add_child_sorted */
 
@@ -5527,6 +5653,7 @@ void
     child->parent = parent;
     if (current) {
         dlq_insertAfter(child, current);
+        val_child_index_add(child);
     } else {
         val_add_child_sorted(child, parent);
     }
@@ -5553,6 +5680,7 @@ void
     }
 #endif
 
+    val_child_index_remove(child);
     dlq_remove(child);
     child->parent = NULL;
 
@@ -5583,7 +5711,9 @@ void
     newchild->parent = curchild->parent;
     newchild->getcb = curchild->getcb;
 
+    val_child_index_remove(curchild);
     dlq_swap(newchild, curchild);
+    val_child_index_add(newchild);
 
     curchild->parent = NULL;
 
@@ -5619,44 +5749,36 @@ val_value_t *
         return NULL;
     }
 
-    for (val = (val_value_t *)dlq_firstEntry(&parent->v.childQ);
-         val != NULL;
-         val = (val_value_t *)dlq_nextEntry(val)) {
-
-        if (VAL_IS_DELETED(val)) {
-            continue;
-        }
-
-        /* check the node if the QName matches */
-        if (val->nsid == child->nsid &&
-            !xml_strcmp(val->name, child->name)) {
+    /* list entries are found by their key leafs */
+    if (child->btyp == NCX_BT_LIST &&
+        val_child_index_find_entry(parent, child, &val)) {
+        return val;
+    }
 
-            if (val->btyp == NCX_BT_LIST) {
-                /* match the instance identifiers, if any */
-                if (val_index_match(child, val)) {
-                    return val;
-                }
-            } else if (val->obj->objtype == OBJ_TYP_LEAF_LIST) {
-                if (val->btyp == child->btyp) {
-                    /* find the leaf-list with the same value */
-                    if (!val_compare(val, child)) {
-                        return val;
-                    }
-                } else {
-                    /* match any value; if this is a subtree
-                     * filter test, it is not for a content match
-                     * node
-                     */
-                    return val;
-                }
-            } else {
-                /* can only be this one instance */
+    val_value_t *lastval = NULL;
+    if (val_child_index_range(parent, NULL, child->name, &val, &lastval)) {
+        for (; val != NULL; val = (val_value_t *)dlq_nextEntry(val)) {
+            if (child_match(val, child)) {
                 return val;
             }
+            if (val == lastval) {
+                break;
+            }
         }
+        return NULL;
     }
 
-    return NULL;
+    uint32 scancnt = 0;
+    for (val = (val_value_t *)dlq_firstEntry(&parent->v.childQ);
+         val != NULL;
+         val = (val_value_t *)dlq_nextEntry(val)) {
+        scancnt++;
+        if (child_match(val, child)) {
+            break;
+        }
+    }
+    val_child_index_scanned(parent, scancnt);
+    return val;
 
 }  /* val_first_child_match */
 
@@ -5695,37 +5817,8 @@ val_value_t *
     for (val = (val_value_t *)dlq_nextEntry(curmatch);
          val != NULL;
          val = (val_value_t *)dlq_nextEntry(val)) {
-
-        if (VAL_IS_DELETED(val)) {
-            continue;
-        }
-
-        /* check the node if the QName matches */
-        if (val->nsid == child->nsid &&
-            !xml_strcmp(val->name, child->name)) {
-
-            if (val->btyp == NCX_BT_LIST) {
-                /* match the instance identifiers, if any */
-                if (val_index_match(child, val)) {
-                    return val;
-                }
-            } else if (val->obj->objtype == OBJ_TYP_LEAF_LIST) {
-                if (val->btyp == child->btyp) {
-                    /* find the leaf-list with the same value */
-                    if (!val_compare(val, child)) {
-                        return val;
-                    }
-                } else {
-                    /* match any value; if this is a subtree
-                     * filter test, it is not for a content match
-                     * node
-                     */
-                    return val;
-                }
-            } else {
-                /* can only be this one instance */
-                return val;
-            }
+        if (child_match(val, child)) {
+            return val;
         }
     }
 
@@ -5842,9 +5935,15 @@ val_value_t *
         return NULL;
     }
 
+    if (val_child_index_find(parent, modname, 0, childname, &val)) {
+        return val;
+    }
+
+    uint32 scancnt = 0;
     for (val = (val_value_t *)dlq_firstEntry(&parent->v.childQ);
          val != NULL;
          val = (val_value_t *)dlq_nextEntry(val)) {
+        scancnt++;
         if (VAL_IS_DELETED(val)) {
             continue;
         }
@@ -5854,10 +5953,11 @@ val_value_t *
             continue;
         }
         if (!xml_strcmp(val->name, childname)) {
-            return val;
+            break;
         }
     }
-    return NULL;
+    val_child_index_scanned(parent, scancnt);
+    return val;
 
 }  /* val_find_child */
 
@@ -6058,22 +6158,28 @@ val_value_t *
     if (!typ_has_children(parent->btyp)) {
         return NULL;
     }
-        
+
+    if (val_child_index_find(parent, NULL, 0, name, &val)) {
+        return val;
+    }
+
+    uint32 scancnt = 0;
     for (val = (val_value_t *)dlq_firstEntry(&parent->v.childQ);
          val != NULL;
          val = (val_value_t *)dlq_nextEntry(val)) {
 
+        scancnt++;
         if (VAL_IS_DELETED(val)) {
             continue;
         }
 
         /* check the node if the name matches */
         if (!xml_strcmp(val->name, name)) {
-            return val;
+            break;
         }
     }
-
-    return NULL;
+    val_child_index_scanned(parent, scancnt);
+    return val;
 
 }  /* val_first_child_name */
 
@@ -6108,11 +6214,17 @@ val_value_t *
     if (!typ_has_children(parent->btyp)) {
         return NULL;
     }
-        
+
+    if (val_child_index_find(parent, NULL, nsid, name, &val)) {
+        return val;
+    }
+
+    uint32 scancnt = 0;
     for (val = (val_value_t *)dlq_firstEntry(&parent->v.childQ);
          val != NULL;
          val = (val_value_t *)dlq_nextEntry(val)) {
 
+        scancnt++;
         if (VAL_IS_DELETED(val)) {
             continue;
         }
@@ -6123,11 +6235,11 @@ val_value_t *
 
         /* check the node if the name matches */
         if (!xml_strcmp(val->name, name)) {
-            return val;
+            break;
         }
     }
-
-    return NULL;
+    val_child_index_scanned(parent, scancnt);
+    return val;
 
 }  /* val_first_child_qname */
 
@@ -8952,6 +9064,38 @@ val_value_t *
 }  /* val_get_virtual_value */
 
 
+/********************************************************************
+* FUNCTION val_clear_virtual_value
+* 
+* Free the value cached by val_get_virtual_value, if any
+* The next val_get_virtual_value call will invoke the
+* get callback function again
+*
+* Used for streaming output, so each virtual value only
+* exists while it is being written to the session
+*
+* INPUTS:
+*   val == virtual value node to clear
+*
+*********************************************************************/
+void
+    val_clear_virtual_value (val_value_t *val)
+{
+#ifdef DEBUG
+    if (!val) {
+        SET_ERROR(ERR_INTERNAL_PTR);
+        return;
+    }
+#endif
+
+    if (val->virtualval) {
+        val_free_value(val->virtualval);
+        val->virtualval = NULL;
+    }
+
+}  /* val_clear_virtual_value */
+
+
 /********************************************************************
 * FUNCTION val_is_default
 * 
@@ -9602,7 +9746,8 @@ void
              chval = val_get_next_child(chval)) {
             val_clean_tree(chval);
         }
-        val->flags &= ~ (VAL_FL_DIRTY | VAL_FL_SUBTREE_DIRTY);
+        val->flags &= 
+            ~ (VAL_FL_DIRTY | VAL_FL_SUBTREE_DIRTY | VAL_FL_TOP_DELETED);
         val->editop = OP_EDITOP_NONE;
         free_editvars(val);
     }
@@ -9808,6 +9953,7 @@ void
     }
 #endif
 
+    val_child_index_free(val->parent);
     val->nsid = nsid;
 
     for (child = val_get_first_child(val);
@@ -10175,6 +10321,8 @@ void
     }
 
     /* move all the entries at once */
+    val_child_index_free(srcval);
+    val_child_index_free(destval);
     dlq_block_enque(&srcval->v.childQ, &destval->v.childQ);
 
 }  /* val_move_children */
@@ -179,6 +179,11 @@ extern "C" {
  */
 #define VAL_FL_SUBTREE_DIRTY bit10
 
+/* if set in a config root, a top-level node has been deleted;
+ * Used by agt_val_root_check since no sibling is marked dirty
+ */
+#define VAL_FL_TOP_DELETED bit11
+
 /* set the virtualval lifetime to 3 seconds */
 #define VAL_VIRTUAL_CACHE_TIME   3
 
@@ -410,6 +415,11 @@ typedef struct val_value_t_ {
      * /interfaces-state/interface/statistics being filled from different SILs
      */
     dlq_hdr_t        getcbQ;                      /* Q of val_value_t */
+
+    /* complex types with a large childQ get a hash index of
+     * the child nodes; see val_child.h
+     */
+    struct val_child_index_t_ *childidx;
 } val_value_t;
 
 
@@ -2991,6 +3001,24 @@ extern val_value_t *
 			   status_t *res);
 
 
+/********************************************************************
+* FUNCTION val_clear_virtual_value
+* 
+* Free the value cached by val_get_virtual_value, if any
+* The next val_get_virtual_value call will invoke the
+* get callback function again
+*
+* Used for streaming output, so each virtual value only
+* exists while it is being written to the session
+*
+* INPUTS:
+*   val == virtual value node to clear
+*
+*********************************************************************/
+extern void
+    val_clear_virtual_value (val_value_t *val);
+
+
 /********************************************************************
 * FUNCTION val_is_default
 * 
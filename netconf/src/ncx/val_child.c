@@ -0,0 +1,1098 @@
+/*  FILE: val_child.c
+
+   Child node hash index for val_value_t containers and lists
+
+   See val_child.h for the rules the rest of the code
+   must follow to keep the index up to date.
+
+   The index has 2 hash tables:
+
+     name table: 1 entry per child QName in the childQ,
+       hashed by the local name.  The entry points at the
+       first and last instance of the QName, so all the
+       instances are found without walking other nodes
+       in front of them.
+
+     key table: 1 entry per list entry, hashed by the list
+       name and the key leaf values.  List entries are added
+       to the parent before their key leafs are parsed, so
+       this table is only built when a keyed lookup needs it.
+       Any list entry that is added or removed while the
+       key cannot be hashed just invalidates the key table.
+
+*********************************************************************
+*                                                                   *
+*                     I N C L U D E    F I L E S                    *
+*                                                                   *
+*********************************************************************/
+#include <stdlib.h>
+#include <memory.h>
+#include <string.h>
+
+#include <libxml/xmlstring.h>
+
+#include "procdefs.h"
+#include "bobhash.h"
+#include "dlq.h"
+#include "ncxtypes.h"
+#include "obj.h"
+#include "typ.h"
+#include "val.h"
+#include "val_child.h"
+#include "xml_util.h"
+#include "xmlns.h"
+
+
+/********************************************************************
+*                                                                   *
+*                       C O N S T A N T S                           *
+*                                                                   *
+*********************************************************************/
+
+/* starting number of buckets in a hash table; must be a power of 2 */
+#define VAL_CHILD_HTAB_SIZE   64
+
+
+/********************************************************************
+*                                                                   *
+*                           T Y P E S                               *
+*                                                                   *
+*********************************************************************/
+
+/* one hash table entry
+ * name table: val is the first instance, last is the last instance
+ * key table:  val is the list entry, last is not used
+ */
+typedef struct val_child_hent_t_ {
+    struct val_child_hent_t_ *next;
+    val_value_t              *val;
+    val_value_t              *last;
+    uint32                    hash;
+} val_child_hent_t;
+
+
+/* one chained hash table */
+typedef struct val_child_htab_t_ {
+    val_child_hent_t  **buckets;
+    uint32              size;
+    uint32              count;
+} val_child_htab_t;
+
+
+/* the index stored in parent->childidx */
+typedef struct val_child_index_t_ {
+    val_child_htab_t    nametab;
+    val_child_htab_t    keytab;
+    boolean             keyvalid;    /* keytab has all list entries */
+    boolean             keyfail;   /* some list key cannot be hashed */
+} val_child_index_t;
+
+
+/********************************************************************
+* FUNCTION htab_init
+*
+* Initialize an empty hash table
+*
+* INPUTS:
+*    tab == hash table to initialize
+*
+* RETURNS:
+*    status
+*********************************************************************/
+static status_t
+    htab_init (val_child_htab_t *tab)
+{
+    tab->buckets = (val_child_hent_t **)
+        m__getMem(VAL_CHILD_HTAB_SIZE * sizeof(val_child_hent_t *));
+    if (!tab->buckets) {
+        return ERR_INTERNAL_MEM;
+    }
+    memset(tab->buckets, 0x0,
+           VAL_CHILD_HTAB_SIZE * sizeof(val_child_hent_t *));
+    tab->size = VAL_CHILD_HTAB_SIZE;
+    tab->count = 0;
+    return NO_ERR;
+
+}  /* htab_init */
+
+
+/********************************************************************
+* FUNCTION htab_clean
+*
+* Free all the entries and the buckets of a hash table
+*
+* INPUTS:
+*    tab == hash table to clean
+*
+*********************************************************************/
+static void
+    htab_clean (val_child_htab_t *tab)
+{
+    val_child_hent_t  *hent, *nexthent;
+    uint32             i;
+
+    if (!tab->buckets) {
+        return;
+    }
+    for (i = 0; i < tab->size; i++) {
+        for (hent = tab->buckets[i]; hent != NULL; hent = nexthent) {
+            nexthent = hent->next;
+            m__free(hent);
+        }
+    }
+    m__free(tab->buckets);
+    tab->buckets = NULL;
+    tab->size = 0;
+    tab->count = 0;
+
+}  /* htab_clean */
+
+
+/********************************************************************
+* FUNCTION htab_grow
+*
+* Double the number of buckets in a hash table
+* The table keeps working with longer chains if
+* the malloc fails
+*
+* INPUTS:
+*    tab == hash table to grow
+*
+*********************************************************************/
+static void
+    htab_grow (val_child_htab_t *tab)
+{
+    val_child_hent_t  **newbuckets, *hent, *nexthent;
+    uint32              newsize, i, slot;
+
+    newsize = tab->size * 2;
+    newbuckets = (val_child_hent_t **)
+        m__getMem(newsize * sizeof(val_child_hent_t *));
+    if (!newbuckets) {
+        return;
+    }
+    memset(newbuckets, 0x0, newsize * sizeof(val_child_hent_t *));
+
+    for (i = 0; i < tab->size; i++) {
+        for (hent = tab->buckets[i]; hent != NULL; hent = nexthent) {
+            nexthent = hent->next;
+            slot = hent->hash & (newsize - 1);
+            hent->next = newbuckets[slot];
+            newbuckets[slot] = hent;
+        }
+    }
+    m__free(tab->buckets);
+    tab->buckets = newbuckets;
+    tab->size = newsize;
+
+}  /* htab_grow */
+
+
+/********************************************************************
+* FUNCTION htab_add
+*
+* Add a new entry to a hash table
+*
+* INPUTS:
+*    tab == hash table to use
+*    hash == hash value of the entry
+*    val == value node for the new entry
+*
+* RETURNS:
+*    pointer to the new entry or NULL if malloc failed
+*********************************************************************/
+static val_child_hent_t *
+    htab_add (val_child_htab_t *tab,
+              uint32 hash,
+              val_value_t *val)
+{
+    val_child_hent_t  *hent;
+    uint32             slot;
+
+    hent = m__getObj(val_child_hent_t);
+    if (!hent) {
+        return NULL;
+    }
+    hent->val = val;
+    hent->last = val;
+    hent->hash = hash;
+
+    if (tab->count >= tab->size) {
+        htab_grow(tab);
+    }
+    slot = hash & (tab->size - 1);
+    hent->next = tab->buckets[slot];
+    tab->buckets[slot] = hent;
+    tab->count++;
+    return hent;
+
+}  /* htab_add */
+
+
+/********************************************************************
+* FUNCTION htab_delete
+*
+* Remove an entry from a hash table and free it
+*
+* INPUTS:
+*    tab == hash table to use
+*    hent == entry to delete
+*
+*********************************************************************/
+static void
+    htab_delete (val_child_htab_t *tab,
+                 val_child_hent_t *hent)
+{
+    val_child_hent_t  **link;
+
+    for (link = &tab->buckets[hent->hash & (tab->size - 1)];
+         *link != NULL;
+         link = &(*link)->next) {
+        if (*link == hent) {
+            *link = hent->next;
+            tab->count--;
+            m__free(hent);
+            return;
+        }
+    }
+
+}  /* htab_delete */
+
+
+/********************************************************************
+* FUNCTION name_hash
+*
+* Get the hash value for a child node name
+*
+* INPUTS:
+*    name == local name to hash
+*
+* RETURNS:
+*    hash value
+*********************************************************************/
+static uint32
+    name_hash (const xmlChar *name)
+{
+    return (uint32)bobhash((const ub1 *)name, xml_strlen(name), 0);
+
+}  /* name_hash */
+
+
+/********************************************************************
+* FUNCTION same_qname
+*
+* Check if 2 value nodes have the same QName
+*
+* RETURNS:
+*    TRUE if same namespace ID and name
+*********************************************************************/
+static boolean
+    same_qname (const val_value_t *val1,
+                const val_value_t *val2)
+{
+    return (val1->nsid == val2->nsid && val1->name && val2->name &&
+            !xml_strcmp(val1->name, val2->name)) ? TRUE : FALSE;
+
+}  /* same_qname */
+
+
+/********************************************************************
+* FUNCTION is_list_entry
+*
+* Check if a child node belongs in the key table
+*
+* RETURNS:
+*    TRUE if the child node is a list entry
+*********************************************************************/
+static boolean
+    is_list_entry (const val_value_t *val)
+{
+    return (val->name && val->obj &&
+            val->obj->objtype == OBJ_TYP_LIST) ? TRUE : FALSE;
+
+}  /* is_list_entry */
+
+
+/********************************************************************
+* FUNCTION key_hash
+*
+* Get the hash value for a list entry, based on the
+* list name and the key leaf values
+*
+* Only key leafs with the base type of their object are
+* used, so 2 entries that val_index_match accepts
+* always get the same hash value.  The key leaf types
+* that are not hashed still match correctly; they just
+* share the same hash value.
+*
+* INPUTS:
+*    val == list entry to hash
+*    hash == address of return hash value
+*
+* OUTPUTS:
+*    *hash is set if TRUE is returned
+*
+* RETURNS:
+*    TRUE if all the key leafs are present and usable
+*    FALSE if the entry cannot be hashed
+*********************************************************************/
+static boolean
+    key_hash (const val_value_t *val,
+              uint32 *hash)
+{
+    const val_index_t  *in;
+    const val_value_t  *keyval;
+    ub4                 h;
+    uint32              keycnt, cnt;
+
+    if (!is_list_entry(val)) {
+        return FALSE;
+    }
+    keycnt = obj_key_count(val->obj);
+    if (keycnt == 0) {
+        return FALSE;
+    }
+
+    h = name_hash(val->name);
+    cnt = 0;
+    for (in = (const val_index_t *)dlq_firstEntry(&val->indexQ);
+         in != NULL;
+         in = (const val_index_t *)dlq_nextEntry(in)) {
+
+        keyval = in->val;
+        if (!keyval || !keyval->obj ||
+            keyval->btyp != obj_get_basetype(keyval->obj)) {
+            return FALSE;
+        }
+        cnt++;
+
+        switch (keyval->btyp) {
+        case NCX_BT_STRING:
+        case NCX_BT_INSTANCE_ID:
+        case NCX_BT_LEAFREF:
+            if (VAL_STR(keyval)) {
+                h = bobhash((const ub1 *)VAL_STR(keyval),
+                            xml_strlen(VAL_STR(keyval)), h);
+            }
+            break;
+        case NCX_BT_INT8:
+        case NCX_BT_INT16:
+        case NCX_BT_INT32:
+            h = bobhash((const ub1 *)&keyval->v.num.i,
+                        sizeof(keyval->v.num.i), h);
+            break;
+        case NCX_BT_INT64:
+            h = bobhash((const ub1 *)&keyval->v.num.l,
+                        sizeof(keyval->v.num.l), h);
+            break;
+        case NCX_BT_UINT8:
+        case NCX_BT_UINT16:
+        case NCX_BT_UINT32:
+            h = bobhash((const ub1 *)&keyval->v.num.u,
+                        sizeof(keyval->v.num.u), h);
+            break;
+        case NCX_BT_UINT64:
+            h = bobhash((const ub1 *)&keyval->v.num.ul,
+                        sizeof(keyval->v.num.ul), h);
+            break;
+        default:
+            ;
+        }
+    }
+
+    if (cnt != keycnt) {
+        return FALSE;
+    }
+    *hash = (uint32)h;
+    return TRUE;
+
+}  /* key_hash */
+
+
+/********************************************************************
+* FUNCTION find_name
+*
+* Find the name table entry for the QName of a child node
+*
+* INPUTS:
+*    idx == index to check
+*    child == child node with the QName to find
+*
+* RETURNS:
+*    pointer to the entry or NULL if not found
+*********************************************************************/
+static val_child_hent_t *
+    find_name (const val_child_index_t *idx,
+               const val_value_t *child)
+{
+    val_child_hent_t  *hent;
+    uint32             hash;
+
+    hash = name_hash(child->name);
+    for (hent = idx->nametab.buckets[hash & (idx->nametab.size - 1)];
+         hent != NULL;
+         hent = hent->next) {
+        if (hent->hash == hash && same_qname(hent->val, child)) {
+            return hent;
+        }
+    }
+    return NULL;
+
+}  /* find_name */
+
+
+/********************************************************************
+* FUNCTION add_name
+*
+* Update the name table for a child node just linked
+* into the childQ
+*
+* INPUTS:
+*    idx == index to update
+*    child == child node that was added
+*
+* RETURNS:
+*    TRUE if the name table was updated
+*    FALSE if the index cannot be kept up to date
+*********************************************************************/
+static boolean
+    add_name (val_child_index_t *idx,
+              val_value_t *child)
+{
+    val_child_hent_t  *hent;
+    val_value_t       *prev, *next;
+
+    hent = find_name(idx, child);
+    if (!hent) {
+        return (htab_add(&idx->nametab, name_hash(child->name), child))
+            ? TRUE : FALSE;
+    }
+
+    prev = (val_value_t *)dlq_prevEntry(child);
+    next = (val_value_t *)dlq_nextEntry(child);
+
+    if (prev == hent->last) {
+        hent->last = child;
+        return TRUE;
+    }
+    if (next == hent->val) {
+        hent->val = child;
+        return TRUE;
+    }
+
+    /* an instance on either side that is not the first or
+     * last instance means the child is inside the range
+     */
+    if (prev && same_qname(prev, child)) {
+        return TRUE;
+    }
+    if (next && same_qname(next, child)) {
+        return TRUE;
+    }
+
+    /* cannot tell if the child is before the first or
+     * after the last instance without walking the childQ
+     */
+    return FALSE;
+
+}  /* add_name */
+
+
+/********************************************************************
+* FUNCTION remove_name
+*
+* Update the name table for a child node that is about
+* to be unlinked from the childQ
+*
+* INPUTS:
+*    idx == index to update
+*    child == child node that will be removed
+*
+* RETURNS:
+*    TRUE if the name table was updated
+*    FALSE if the index is not consistent with the childQ
+*********************************************************************/
+static boolean
+    remove_name (val_child_index_t *idx,
+                 val_value_t *child)
+{
+    val_child_hent_t  *hent;
+    val_value_t       *cur;
+
+    hent = find_name(idx, child);
+    if (!hent) {
+        return FALSE;
+    }
+
+    if (hent->val == child && hent->last == child) {
+        htab_delete(&idx->nametab, hent);
+    } else if (hent->val == child) {
+        for (cur = (val_value_t *)dlq_nextEntry(child);
+             cur != NULL && !same_qname(cur, child);
+             cur = (val_value_t *)dlq_nextEntry(cur)) {
+            ;
+        }
+        if (!cur) {
+            return FALSE;
+        }
+        hent->val = cur;
+    } else if (hent->last == child) {
+        for (cur = (val_value_t *)dlq_prevEntry(child);
+             cur != NULL && !same_qname(cur, child);
+             cur = (val_value_t *)dlq_prevEntry(cur)) {
+            ;
+        }
+        if (!cur) {
+            return FALSE;
+        }
+        hent->last = cur;
+    }
+    return TRUE;
+
+}  /* remove_name */
+
+
+/********************************************************************
+* FUNCTION invalidate_keys
+*
+* Drop the key table; it is rebuilt by the next keyed lookup
+*
+* INPUTS:
+*    idx == index to update
+*
+*********************************************************************/
+static void
+    invalidate_keys (val_child_index_t *idx)
+{
+    htab_clean(&idx->keytab);
+    idx->keyvalid = FALSE;
+
+}  /* invalidate_keys */
+
+
+/********************************************************************
+* FUNCTION build_keys
+*
+* Build the key table for all the list entries in the childQ
+*
+* INPUTS:
+*    idx == index to update
+*    parent == parent node that owns the index
+*
+* RETURNS:
+*    TRUE if the key table is valid
+*    FALSE if some list entry cannot be hashed
+*********************************************************************/
+static boolean
+    build_keys (val_child_index_t *idx,
+                const val_value_t *parent)
+{
+    val_value_t  *child;
+    uint32        hash;
+
+    invalidate_keys(idx);
+    if (htab_init(&idx->keytab) != NO_ERR) {
+        return FALSE;
+    }
+
+    for (child = (val_value_t *)dlq_firstEntry(&parent->v.childQ);
+         child != NULL;
+         child = (val_value_t *)dlq_nextEntry(child)) {
+
+        if (!is_list_entry(child)) {
+            continue;
+        }
+        if (!key_hash(child, &hash) ||
+            !htab_add(&idx->keytab, hash, child)) {
+            invalidate_keys(idx);
+            idx->keyfail = TRUE;
+            return FALSE;
+        }
+    }
+
+    idx->keyvalid = TRUE;
+    return TRUE;
+
+}  /* build_keys */
+
+
+/********************************************************************
+* FUNCTION add_key
+*
+* Update the key table for a child node just linked
+* into the childQ
+*
+* INPUTS:
+*    idx == index to update
+*    child == child node that was added
+*
+*********************************************************************/
+static void
+    add_key (val_child_index_t *idx,
+             val_value_t *child)
+{
+    uint32  hash;
+
+    if (!is_list_entry(child)) {
+        return;
+    }
+
+    /* the entry that could not be hashed may be gone */
+    idx->keyfail = FALSE;
+
+    if (!idx->keyvalid) {
+        return;
+    }
+    if (!key_hash(child, &hash) ||
+        !htab_add(&idx->keytab, hash, child)) {
+        invalidate_keys(idx);
+    }
+
+}  /* add_key */
+
+
+/********************************************************************
+* FUNCTION remove_key
+*
+* Update the key table for a child node that is about
+* to be unlinked from the childQ
+*
+* INPUTS:
+*    idx == index to update
+*    child == child node that will be removed
+*
+*********************************************************************/
+static void
+    remove_key (val_child_index_t *idx,
+                val_value_t *child)
+{
+    val_child_hent_t  *hent;
+    uint32             hash;
+
+    if (!is_list_entry(child)) {
+        return;
+    }
+
+    idx->keyfail = FALSE;
+
+    if (!idx->keyvalid) {
+        return;
+    }
+    if (key_hash(child, &hash)) {
+        for (hent = idx->keytab.buckets[hash & (idx->keytab.size - 1)];
+             hent != NULL;
+             hent = hent->next) {
+            if (hent->val == child) {
+                htab_delete(&idx->keytab, hent);
+                return;
+            }
+        }
+    }
+
+    /* the key leafs changed after the entry was hashed */
+    invalidate_keys(idx);
+
+}  /* remove_key */
+
+
+/********************************************************************
+* FUNCTION free_index
+*
+* Free a child index struct
+*
+* INPUTS:
+*    idx == index to free
+*
+*********************************************************************/
+static void
+    free_index (val_child_index_t *idx)
+{
+    htab_clean(&idx->nametab);
+    htab_clean(&idx->keytab);
+    m__free(idx);
+
+}  /* free_index */
+
+
+/********************************************************************
+* FUNCTION build_index
+*
+* Build the name table for a parent node
+* Nothing is done if the childQ contains a node that
+* is not linked back to this parent, since the index
+* for such a childQ could not be maintained
+*
+* INPUTS:
+*    parent == parent node to index
+*
+*********************************************************************/
+static void
+    build_index (val_value_t *parent)
+{
+    val_child_index_t  *idx;
+    val_child_hent_t   *hent;
+    val_value_t        *child;
+
+    idx = m__getObj(val_child_index_t);
+    if (!idx) {
+        return;
+    }
+    memset(idx, 0x0, sizeof(val_child_index_t));
+    if (htab_init(&idx->nametab) != NO_ERR) {
+        m__free(idx);
+        return;
+    }
+
+    for (child = (val_value_t *)dlq_firstEntry(&parent->v.childQ);
+         child != NULL;
+         child = (val_value_t *)dlq_nextEntry(child)) {
+
+        if (!child->name) {
+            /* skip the deleted node markers */
+            continue;
+        }
+        if (child->parent != parent) {
+            free_index(idx);
+            return;
+        }
+
+        hent = find_name(idx, child);
+        if (hent) {
+            hent->last = child;
+        } else if (!htab_add(&idx->nametab, name_hash(child->name),
+                             child)) {
+            free_index(idx);
+            return;
+        }
+    }
+
+    parent->childidx = idx;
+
+}  /* build_index */
+
+
+/*************    E X T E R N A L   F U N C T I O N S   ************/
+
+
+/********************************************************************
+* FUNCTION val_child_index_free
+*
+* Free the child index of a parent node, if any
+* The index will be rebuilt the next time a long
+* childQ scan is done for this parent
+*
+* INPUTS:
+*    parent == parent value node to clean
+*
+*********************************************************************/
+void
+    val_child_index_free (val_value_t *parent)
+{
+    if (parent && parent->childidx) {
+        free_index(parent->childidx);
+        parent->childidx = NULL;
+    }
+
+}  /* val_child_index_free */
+
+
+/********************************************************************
+* FUNCTION val_child_index_scanned
+*
+* Report the number of childQ entries a lookup in the
+* parent node had to check.  If the parent has no index
+* yet and the count is at least VAL_CHILD_INDEX_MIN_SCAN
+* then an index is built for the parent
+*
+* The index is a cache, so this is done for const
+* parent nodes as well
+*
+* INPUTS:
+*    parent == parent value node that was searched
+*    scancnt == number of child nodes checked
+*
+*********************************************************************/
+void
+    val_child_index_scanned (const val_value_t *parent,
+                             uint32 scancnt)
+{
+    if (scancnt < VAL_CHILD_INDEX_MIN_SCAN || parent->childidx ||
+        !typ_has_children(parent->btyp)) {
+        return;
+    }
+    build_index((val_value_t *)parent);
+
+}  /* val_child_index_scanned */
+
+
+/********************************************************************
+* FUNCTION val_child_index_add
+*
+* Record a child node that was just linked into the
+* childQ of child->parent
+*
+* INPUTS:
+*    child == child node that was added
+*
+*********************************************************************/
+void
+    val_child_index_add (val_value_t *child)
+{
+    val_value_t  *parent = child->parent;
+
+    if (!parent || !parent->childidx || !child->name) {
+        return;
+    }
+    if (!add_name(parent->childidx, child)) {
+        val_child_index_free(parent);
+        return;
+    }
+    add_key(parent->childidx, child);
+
+}  /* val_child_index_add */
+
+
+/********************************************************************
+* FUNCTION val_child_index_remove
+*
+* Forget a child node that is about to be unlinked from
+* the childQ of child->parent.  The child must still
+* be in the childQ
+*
+* INPUTS:
+*    child == child node that will be removed
+*
+*********************************************************************/
+void
+    val_child_index_remove (val_value_t *child)
+{
+    val_value_t  *parent = child->parent;
+
+    if (!parent || !parent->childidx || !child->name) {
+        return;
+    }
+    if (!remove_name(parent->childidx, child)) {
+        val_child_index_free(parent);
+        return;
+    }
+    remove_key(parent->childidx, child);
+
+}  /* val_child_index_remove */
+
+
+/********************************************************************
+* FUNCTION val_child_index_range
+*
+* Get the first and last instance of the child nodes
+* with the specified name
+*
+* INPUTS:
+*    parent == parent value node to check
+*    modname == module name of the child nodes
+*               NULL to match any module
+*    name == child name to find
+*    first == address of return first instance
+*    last == address of return last instance
+*
+* OUTPUTS:
+*    *first and *last are set if TRUE is returned;
+*    all the matching child nodes are in this range
+*    of the childQ.  They are set to NULL if there
+*    are no instances of the child node
+*
+* RETURNS:
+*    TRUE if the index answered the request
+*    FALSE if there is no index or the name is used in
+*    more than one namespace; the childQ needs to be searched
+*********************************************************************/
+boolean
+    val_child_index_range (const val_value_t *parent,
+                           const xmlChar *modname,
+                           const xmlChar *name,
+                           val_value_t **first,
+                           val_value_t **last)
+{
+    const val_child_index_t  *idx = parent->childidx;
+    val_child_hent_t         *hent, *found;
+    uint32                    hash;
+
+    if (!idx) {
+        return FALSE;
+    }
+
+    found = NULL;
+    hash = name_hash(name);
+    for (hent = idx->nametab.buckets[hash & (idx->nametab.size - 1)];
+         hent != NULL;
+         hent = hent->next) {
+        if (hent->hash != hash || xml_strcmp(hent->val->name, name)) {
+            continue;
+        }
+        if (modname && hent->val->nsid &&
+            xml_strcmp(modname, val_get_mod_name(hent->val))) {
+            continue;
+        }
+        if (found) {
+            /* the order of the 2 ranges is not known */
+            return FALSE;
+        }
+        found = hent;
+    }
+
+    *first = (found) ? found->val : NULL;
+    *last = (found) ? found->last : NULL;
+    return TRUE;
+
+}  /* val_child_index_range */
+
+
+/********************************************************************
+* FUNCTION val_child_index_find
+*
+* Find the first instance of the specified child node
+* that is not marked as deleted
+*
+* INPUTS:
+*    parent == parent value node to check
+*    modname == module name of the child node
+*               NULL to match any module
+*    nsid == namespace ID of the child node; 0 for any
+*    name == child name to find
+*    retval == address of return child node
+*
+* OUTPUTS:
+*    *retval is set to the child node or NULL if
+*    not found, if TRUE is returned
+*
+* RETURNS:
+*    TRUE if the index answered the request
+*    FALSE if the childQ needs to be searched
+*********************************************************************/
+boolean
+    val_child_index_find (const val_value_t *parent,
+                          const xmlChar *modname,
+                          xmlns_id_t nsid,
+                          const xmlChar *name,
+                          val_value_t **retval)
+{
+    val_value_t  *val, *last;
+
+    if (!val_child_index_range(parent, modname, name, &val, &last)) {
+        return FALSE;
+    }
+
+    *retval = NULL;
+    for (; val != NULL; val = (val_value_t *)dlq_nextEntry(val)) {
+        if (!VAL_IS_DELETED(val) &&
+            xmlns_ids_equal(nsid, val->nsid) &&
+            !xml_strcmp(val->name, name) &&
+            (!modname || !xml_strcmp(modname, val_get_mod_name(val)))) {
+            *retval = val;
+            break;
+        }
+        if (val == last) {
+            break;
+        }
+    }
+    return TRUE;
+
+}  /* val_child_index_find */
+
+
+/********************************************************************
+* FUNCTION val_child_index_find_entry
+*
+* Find the list entry with the same QName and key leaf
+* values as the specified list node
+*
+* INPUTS:
+*    parent == parent value node to check
+*    child == list node to match (e.g., from a NETCONF PDU)
+*    retval == address of return list entry
+*
+* OUTPUTS:
+*    *retval is set to the list entry or NULL if
+*    not found, if TRUE is returned
+*
+* RETURNS:
+*    TRUE if the index answered the request
+*    FALSE if the childQ needs to be searched
+*********************************************************************/
+boolean
+    val_child_index_find_entry (const val_value_t *parent,
+                                const val_value_t *child,
+                                val_value_t **retval)
+{
+    val_child_index_t  *idx = parent->childidx;
+    val_child_hent_t   *hent;
+    val_value_t        *found;
+    uint32              hash;
+
+    if (!idx || idx->keyfail) {
+        return FALSE;
+    }
+    if (!idx->keyvalid && !build_keys(idx, parent)) {
+        return FALSE;
+    }
+    if (!key_hash(child, &hash)) {
+        return FALSE;
+    }
+
+    found = NULL;
+    for (hent = idx->keytab.buckets[hash & (idx->keytab.size - 1)];
+         hent != NULL;
+         hent = hent->next) {
+
+        if (hent->hash != hash || VAL_IS_DELETED(hent->val) ||
+            !same_qname(hent->val, child)) {
+            continue;
+        }
+        if (hent->val->obj != child->obj) {
+            /* the keys may not be comparable; let the scan decide */
+            return FALSE;
+        }
+        if (val_index_match(child, hent->val)) {
+            if (found) {
+                /* duplicate entries; let the childQ order decide */
+                return FALSE;
+            }
+            found = hent->val;
+        }
+    }
+
+    *retval = found;
+    return TRUE;
+
+}  /* val_child_index_find_entry */
+
+
+/********************************************************************
+* FUNCTION val_child_index_last
+*
+* Get the last instance of the child nodes with the
+* same QName as the specified node
+*
+* INPUTS:
+*    parent == parent value node to check
+*    child == child node with the QName to find
+*
+* RETURNS:
+*    pointer to the last instance, which may be marked as
+*    deleted, or NULL if none or there is no index
+*********************************************************************/
+val_value_t *
+    val_child_index_last (const val_value_t *parent,
+                          const val_value_t *child)
+{
+    const val_child_hent_t  *hent;
+
+    if (!parent->childidx || !child->name) {
+        return NULL;
+    }
+    hent = find_name(parent->childidx, child);
+    return (hent) ? hent->last : NULL;
+
+}  /* val_child_index_last */
+
+
+/* END val_child.c */
@@ -0,0 +1,246 @@
+#ifndef _H_val_child
+#define _H_val_child
+
+/*  FILE: val_child.h
+*********************************************************************
+*								    *
+*			 P U R P O S E				    *
+*								    *
+*********************************************************************
+
+    Child node hash index for val_value_t containers and lists
+
+  A parent value node with many children (e.g., a list with
+  thousands of entries) gets an index the first time a
+  lookup has to walk more than VAL_CHILD_INDEX_MIN_SCAN
+  nodes of its childQ.  The index is stored in parent->childidx
+  and holds:
+
+    - the first and last instance of each child QName
+    - each list entry, hashed by its key leaf values
+
+  The val_add_child*, val_insert_child, val_remove_child
+  and val_swap_child functions keep the index up to date.
+  Code that links or unlinks child nodes with the dlq
+  functions directly must call val_child_index_add or
+  val_child_index_remove, or drop the index with
+  val_child_index_free.
+
+  The key leafs of a list entry must not be changed while
+  the entry is linked into an indexed parent.
+
+*/
+
+#include <libxml/xmlstring.h>
+
+#ifndef _H_ncxtypes
+#include "ncxtypes.h"
+#endif
+
+#ifndef _H_val
+#include "val.h"
+#endif
+
+#ifndef _H_xmlns
+#include "xmlns.h"
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/********************************************************************
+*								    *
+*			 C O N S T A N T S			    *
+*								    *
+*********************************************************************/
+
+/* number of childQ entries a lookup has to walk before
+ * an index is built for the parent node
+ */
+#define VAL_CHILD_INDEX_MIN_SCAN   32
+
+
+/********************************************************************
+*								    *
+*			F U N C T I O N S			    *
+*								    *
+*********************************************************************/
+
+
+/********************************************************************
+* FUNCTION val_child_index_free
+*
+* Free the child index of a parent node, if any
+* The index will be rebuilt the next time a long
+* childQ scan is done for this parent
+*
+* INPUTS:
+*    parent == parent value node to clean
+*
+*********************************************************************/
+extern void
+    val_child_index_free (val_value_t *parent);
+
+
+/********************************************************************
+* FUNCTION val_child_index_scanned
+*
+* Report the number of childQ entries a lookup in the
+* parent node had to check.  If the parent has no index
+* yet and the count is at least VAL_CHILD_INDEX_MIN_SCAN
+* then an index is built for the parent
+*
+* The index is a cache, so this is done for const
+* parent nodes as well
+*
+* INPUTS:
+*    parent == parent value node that was searched
+*    scancnt == number of child nodes checked
+*
+*********************************************************************/
+extern void
+    val_child_index_scanned (const val_value_t *parent,
+                             uint32 scancnt);
+
+
+/********************************************************************
+* FUNCTION val_child_index_add
+*
+* Record a child node that was just linked into the
+* childQ of child->parent
+*
+* INPUTS:
+*    child == child node that was added
+*
+*********************************************************************/
+extern void
+    val_child_index_add (val_value_t *child);
+
+
+/********************************************************************
+* FUNCTION val_child_index_remove
+*
+* Forget a child node that is about to be unlinked from
+* the childQ of child->parent.  The child must still
+* be in the childQ
+*
+* INPUTS:
+*    child == child node that will be removed
+*
+*********************************************************************/
+extern void
+    val_child_index_remove (val_value_t *child);
+
+
+/********************************************************************
+* FUNCTION val_child_index_range
+*
+* Get the first and last instance of the child nodes
+* with the specified name
+*
+* INPUTS:
+*    parent == parent value node to check
+*    modname == module name of the child nodes
+*               NULL to match any module
+*    name == child name to find
+*    first == address of return first instance
+*    last == address of return last instance
+*
+* OUTPUTS:
+*    *first and *last are set if TRUE is returned;
+*    all the matching child nodes are in this range
+*    of the childQ.  They are set to NULL if there
+*    are no instances of the child node
+*
+* RETURNS:
+*    TRUE if the index answered the request
+*    FALSE if there is no index or the name is used in
+*    more than one namespace; the childQ needs to be searched
+*********************************************************************/
+extern boolean
+    val_child_index_range (const val_value_t *parent,
+                           const xmlChar *modname,
+                           const xmlChar *name,
+                           val_value_t **first,
+                           val_value_t **last);
+
+
+/********************************************************************
+* FUNCTION val_child_index_find
+*
+* Find the first instance of the specified child node
+* that is not marked as deleted
+*
+* INPUTS:
+*    parent == parent value node to check
+*    modname == module name of the child node
+*               NULL to match any module
+*    nsid == namespace ID of the child node; 0 for any
+*    name == child name to find
+*    retval == address of return child node
+*
+* OUTPUTS:
+*    *retval is set to the child node or NULL if
+*    not found, if TRUE is returned
+*
+* RETURNS:
+*    TRUE if the index answered the request
+*    FALSE if the childQ needs to be searched
+*********************************************************************/
+extern boolean
+    val_child_index_find (const val_value_t *parent,
+                          const xmlChar *modname,
+                          xmlns_id_t nsid,
+                          const xmlChar *name,
+                          val_value_t **retval);
+
+
+/********************************************************************
+* FUNCTION val_child_index_find_entry
+*
+* Find the list entry with the same QName and key leaf
+* values as the specified list node
+*
+* INPUTS:
+*    parent == parent value node to check
+*    child == list node to match (e.g., from a NETCONF PDU)
+*    retval == address of return list entry
+*
+* OUTPUTS:
+*    *retval is set to the list entry or NULL if
+*    not found, if TRUE is returned
+*
+* RETURNS:
+*    TRUE if the index answered the request
+*    FALSE if the childQ needs to be searched
+*********************************************************************/
+extern boolean
+    val_child_index_find_entry (const val_value_t *parent,
+                                const val_value_t *child,
+                                val_value_t **retval);
+
+
+/********************************************************************
+* FUNCTION val_child_index_last
+*
+* Get the last instance of the child nodes with the
+* same QName as the specified node
+*
+* INPUTS:
+*    parent == parent value node to check
+*    child == child node with the QName to find
+*
+* RETURNS:
+*    pointer to the last instance, which may be marked as
+*    deleted, or NULL if none or there is no index
+*********************************************************************/
+extern val_value_t *
+    val_child_index_last (const val_value_t *parent,
+                          const val_value_t *child);
+
+#ifdef __cplusplus
+}  /* end extern 'C' */
+#endif
+
+#endif	    /* _H_val_child */
@@ -49,8 +49,10 @@ date         init     comment
 #include "ncxmod.h"
 #include "obj.h"
 #include "status.h"
+#include "tk.h"
 #include "typ.h"
 #include "val.h"
+#include "val_child.h"
 #include "val_util.h"
 #include "xml_util.h"
 #include "xpath.h"
@@ -64,6 +66,20 @@ date         init     comment
 *********************************************************************/
 /* #define VAL_UTIL_DEBUG_CANONICAL 1 */
 
+
+/********************************************************************
+*                                                                   *
+*                           T Y P E S                               *
+*                                                                   *
+*********************************************************************/
+
+/* one list or leaf-list instance sorted by add_sorted_instances */
+typedef struct val_sort_entry_t_ {
+    val_value_t  *val;
+    uint32        seq;               /* original order in the tempQ */
+} val_sort_entry_t;
+
+
 /********************************************************************
 * FUNCTION new_index
 * 
@@ -854,6 +870,122 @@ static status_t
 } /* check_when_stmt */
 
 
+/********************************************************************
+* FUNCTION compare_sort_entries
+* 
+* qsort compare function for add_sorted_instances
+* Instances with the same value keep their original order
+*
+* INPUTS:
+*   e1 == first val_sort_entry_t to compare
+*   e2 == second val_sort_entry_t to compare
+*
+* RETURNS:
+*   -1, 0, or 1 for less than, equal, greater than
+*********************************************************************/
+static int
+    compare_sort_entries (const void *e1,
+                          const void *e2)
+{
+    const val_sort_entry_t *s1 = (const val_sort_entry_t *)e1;
+    const val_sort_entry_t *s2 = (const val_sort_entry_t *)e2;
+    int32 ret;
+
+    if (s1->val->obj->objtype == OBJ_TYP_LIST) {
+        ret = val_index_compare(s1->val, s2->val);
+    } else {
+        ret = val_compare(s1->val, s2->val);
+    }
+    if (ret < 0) {
+        return -1;
+    } else if (ret > 0) {
+        return 1;
+    }
+    return (s1->seq < s2->seq) ? -1 : 1;
+
+}  /* compare_sort_entries */
+
+
+/********************************************************************
+* FUNCTION add_sorted_instances
+* 
+* Move all the instances of a system ordered list or
+* leaf-list from the tempQ back to the parent, sorted first.
+* Then each instance is added after the last one,
+* instead of searching all the instances already added
+* for the insertion point.
+*
+* INPUTS:
+*   val == parent value node
+*   chobj == list or leaf-list object to move
+*   tempQ == Q of child nodes not moved back yet
+*
+* RETURNS:
+*   TRUE if the instances were moved
+*   FALSE if there were not enough instances to sort
+*     or malloc failed; nothing was moved
+*********************************************************************/
+static boolean
+    add_sorted_instances (val_value_t *val,
+                          obj_template_t *chobj,
+                          dlq_hdr_t *tempQ)
+{
+    const xmlChar     *modname = obj_get_mod_name(chobj);
+    const xmlChar     *name = obj_get_name(chobj);
+    val_sort_entry_t  *entries;
+    val_value_t       *chval, *nextval;
+    uint32             count, i;
+
+    count = 0;
+    for (chval = val_find_child_que(tempQ, modname, name);
+         chval != NULL;
+         chval = (val_value_t *)dlq_nextEntry(chval)) {
+        if (!VAL_IS_DELETED(chval) &&
+            !xml_strcmp(chval->name, name) &&
+            !xml_strcmp(val_get_mod_name(chval), modname)) {
+            count++;
+        }
+    }
+    if (count < 2) {
+        return FALSE;
+    }
+
+    entries = (val_sort_entry_t *)m__getMem(count * sizeof(val_sort_entry_t));
+    if (!entries) {
+        return FALSE;
+    }
+
+    i = 0;
+    for (chval = val_find_child_que(tempQ, modname, name);
+         chval != NULL;
+         chval = nextval) {
+        nextval = (val_value_t *)dlq_nextEntry(chval);
+        if (!VAL_IS_DELETED(chval) &&
+            !xml_strcmp(chval->name, name) &&
+            !xml_strcmp(val_get_mod_name(chval), modname)) {
+            dlq_remove(chval);
+            entries[i].val = chval;
+            entries[i].seq = i;
+            i++;
+        }
+    }
+
+    qsort(entries, count, sizeof(val_sort_entry_t), compare_sort_entries);
+
+    for (i = 0; i < count; i++) {
+        chval = entries[i].val;
+        val_add_child_sorted(chval, val);
+        if (chobj->objtype == OBJ_TYP_LIST) {
+            val_set_canonical_order(chval);
+        }
+    }
+
+    m__free(entries);
+    return TRUE;
+
+}  /* add_sorted_instances */
+
+
 /*************** E X T E R N A L    F U N C T I O N S  *************/
 
 
@@ -954,6 +1086,7 @@ void
 #endif
 
     /* transfer all the val->childQ nodes to the tempQ */
+    val_child_index_free(val);
     dlq_createSQue(&tempQ);
     dlq_block_enque(&val->v.childQ, &tempQ);
 
@@ -1004,6 +1137,14 @@ void
                 continue;
             }
 
+            if ((chobj->objtype == OBJ_TYP_LIST ||
+                 chobj->objtype == OBJ_TYP_LEAF_LIST) &&
+                obj_is_system_ordered(chobj) &&
+                ncx_get_system_sorted() &&
+                add_sorted_instances(val, chobj, &tempQ)) {
+                continue;
+            }
+
             chval = val_find_child_que(&tempQ, obj_get_mod_name(chobj),
                                        obj_get_name(chobj));
             while (chval) {
@@ -2475,9 +2616,12 @@ status_t
 *   --datapath
 *   --modpath
 *   --runpath
+*   --parse-threads
 *
 * Check the specified value set for the 3 path CLI parms
 * and override the environment variable setting, if any.
+* Set the number of YANG tokenizer threads if --parse-threads
+* is present.
 *
 * Not all of these parameters are supported in all programs
 * The object tree is not checked, just the value tree
@@ -2527,6 +2671,14 @@ status_t
         ncxmod_set_runpath(VAL_STR(val));
     }
 
+    /* get the parse-threads parameter */
+    val = val_find_child(parentval, 
+                         val_get_mod_name(parentval),
+                         NCX_EL_PARSE_THREADS);
+    if (val && val->res == NO_ERR) {
+        tk_set_prefetch_threads(VAL_UINT(val));
+    }
+
     return NO_ERR;
 
 }  /* val_set_path_parms */
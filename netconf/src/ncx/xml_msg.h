@@ -104,6 +104,11 @@ typedef struct xml_msg_hdr_t_ {
      */
     void                    *acm_cbfn;
 
+    /* TRUE if each virtual value is freed again after it
+     * has been written; set while a reply is streamed
+     */
+    boolean                  free_virtual;
+
 } xml_msg_hdr_t;
 
 
@@ -147,8 +147,7 @@ static void
         ses_putchar(scb, ':');
         ses_putstr(scb, pfix);
     }
-    ses_putchar(scb, '=');
-    ses_putchar(scb, '\"');
+    ses_putspan(scb, (const xmlChar *)"=\"", 2);
     ses_putstr(scb, val);      /* write the namespace URI value */
     ses_putchar(scb, '\"');
     
@@ -370,8 +369,7 @@ static void
         }
 
         ses_putstr(scb, attr_name);
-        ses_putchar(scb, '=');
-        ses_putchar(scb, '\"');
+        ses_putspan(scb, (const xmlChar *)"=\"", 2);
         if (isattrq) {
             ses_putastr(scb, attr->attr_val, -1);
         } else if (typ_is_string(val->btyp)) {
@@ -533,9 +531,10 @@ static void
 
     /* finish up the element */
     if (empty) {
-        ses_putchar(scb, '/');
+        ses_putspan(scb, (const xmlChar *)"/>", 2);
+    } else {
+        ses_putchar(scb, '>');
     }
-    ses_putchar(scb, '>');
 
     /* hack in XMLDOC mode to get more readable XSD output */
     if (empty && scb->mode==SES_MODE_XMLDOC && indent < 
@@ -1058,9 +1057,10 @@ static void
 
     /* finish up the element */
     if (empty) {
-        ses_putchar(scb, '/');
+        ses_putspan(scb, (const xmlChar *)"/>", 2);
+    } else {
+        ses_putchar(scb, '>');
     }
-    ses_putchar(scb, '>');
 
     /* hack in XMLDOC mode to get more readable XSD output */
     if (empty && scb->mode==SES_MODE_XMLDOC && indent < 
@@ -1093,14 +1093,10 @@ void
                  uint32 bufflen)
 {
 
-    uint32  i;
-
     assert( scb && "scb is NULL!" );
     assert( buff && "buff is NULL!" );
 
-    for (i=0; i<bufflen; i++) {
-        ses_putchar(scb, *buff++);
-    }
+    ses_putspan(scb, buff, bufflen);
 
 }  /* xml_wr_buff */
 
@@ -1259,8 +1255,7 @@ void
     ses_indent(scb, indent);
 
     /* start the element and write the prefix, if any */
-    ses_putchar(scb, '<');
-    ses_putchar(scb, '/');
+    ses_putspan(scb, (const xmlChar *)"</", 2);
     pfix = NULL;
     if (nsid && msg->useprefix) {
         pfix = xml_msg_get_prefix(msg, 0, nsid, NULL, &xneeded);
@@ -1554,6 +1549,13 @@ void
         val_free_value(out);
     }
 
+    /* a streamed reply does not keep the virtual value
+     * after it is written, so it is never held in memory
+     */
+    if (msg->free_virtual && val_is_virtual(val)) {
+        val_clear_virtual_value(val);
+    }
+
 }  /* xml_wr_full_check_val */
 
 
@@ -2512,6 +2512,8 @@ void xpath_free_pcb (xpath_pcb_t *pcb)
         return;
     }
 
+    xpath_free_expr(pcb->exprtree);
+
     if (pcb->tkc) {
         tk_free_chain(pcb->tkc);
     }
@@ -2687,6 +2689,64 @@ void
 }  /* xpath_clean_result */
 
 
+/********************************************************************
+* FUNCTION xpath_new_expr
+* 
+* malloc an XPath expression tree node
+*
+* INPUTS:
+*   extyp == the node type
+*
+* RETURNS:
+*   pointer to malloced struct, NULL if malloc error
+*********************************************************************/
+xpath_expr_t *
+    xpath_new_expr (xpath_extyp_t extyp)
+{
+    xpath_expr_t *expr;
+
+    expr = m__getObj(xpath_expr_t);
+    if (!expr) {
+        return NULL;
+    }
+    memset(expr, 0x0, sizeof(xpath_expr_t));
+    expr->extyp = extyp;
+    dlq_createSQue(&expr->exprQ);
+    ncx_init_num(&expr->num);
+    return expr;
+
+}  /* xpath_new_expr */
+
+
+/********************************************************************
+* FUNCTION xpath_free_expr
+* 
+* Free a malloced XPath expression tree node
+* and all the nodes below it
+*
+* INPUTS:
+*   expr == pointer to expression tree node to free
+*********************************************************************/
+void xpath_free_expr (xpath_expr_t *expr)
+{
+    xpath_expr_t *child;
+
+    if (!expr) {
+        return;
+    }
+
+    xpath_free_expr(expr->left);
+    xpath_free_expr(expr->right);
+    while (!dlq_empty(&expr->exprQ)) {
+        child = (xpath_expr_t *)dlq_deque(&expr->exprQ);
+        xpath_free_expr(child);
+    }
+    ncx_clean_num(NCX_BT_FLOAT64, &expr->num);
+    m__free(expr);
+
+}  /* xpath_free_expr */
+
+
 /********************************************************************
 * FUNCTION xpath_new_resnode
 * 
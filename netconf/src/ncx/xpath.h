@@ -85,6 +85,11 @@ extern "C" {
 /* max size of the pcb->resnode_cacheQ */
 #define XPATH_RESNODE_CACHE_MAX     64
 
+/* number of nodes in a nodeset before duplicates are
+ * found with a hash table instead of a linear search
+ */
+#define XPATH_NODEIDX_MIN_NODES     16
+
 
 /* XPath 1.0 sec 2.2 AxisName */
 #define XP_AXIS_ANCESTOR           (const xmlChar *)"ancestor"
@@ -289,6 +294,24 @@ typedef enum xpath_nodetype_t_ {
 } xpath_nodetype_t;
 
 
+/* XPath expression tree node types */
+typedef enum xpath_extyp_t_ {
+    XP_EXTYP_NONE,
+    XP_EXTYP_OP,         /* left exop right */
+    XP_EXTYP_NEGATE,     /* '-' left */
+    XP_EXTYP_LITERAL,    /* quoted string token */
+    XP_EXTYP_NUMBER,     /* number token */
+    XP_EXTYP_VARBIND,    /* '$' QName token */
+    XP_EXTYP_FNCALL,     /* fncb '(' exprQ ')' */
+    XP_EXTYP_FILTER,     /* left Predicate+ */
+    XP_EXTYP_PATH,       /* left? Step+ */
+    XP_EXTYP_STEP,       /* axis NodeTest Predicate* */
+    XP_EXTYP_SELF,       /* abbreviated step '.' */
+    XP_EXTYP_PARENT,     /* abbreviated step '..' */
+    XP_EXTYP_ROOT        /* location path '/' */
+} xpath_extyp_t;
+
+
 /* xpath_getvar_fn_t
  *
  * Callback function for retrieval of a variable binding
@@ -341,6 +364,29 @@ typedef struct xpath_result_t_ {
 } xpath_result_t;
 
 
+/* XPath expression tree node
+ * Built once from the token chain of a parsed expression,
+ * so it can be evaluated again without parsing the tokens
+ */
+typedef struct xpath_expr_t_ {
+    dlq_hdr_t              qhdr;
+    xpath_extyp_t          extyp;
+    xpath_exop_t           exop;   /* OP, or step separator:
+                                    * FILTER1 '/' or FILTER2 '//' */
+    tk_token_t            *tk;        /* for error messages */
+    struct xpath_expr_t_  *left;
+    struct xpath_expr_t_  *right;
+    dlq_hdr_t              exprQ;    /* Q of xpath_expr_t: path steps,
+                                      * function args or predicates */
+    ncx_xpath_axis_t       axis;                /* STEP only */
+    xpath_nodetype_t       nodetyp;             /* STEP only */
+    xmlns_id_t             nsid;                /* STEP only */
+    const xmlChar         *name;                /* STEP only */
+    const struct xpath_fncb_t_ *fncb;         /* FNCALL only */
+    ncx_num_t              num;               /* NUMBER only */
+} xpath_expr_t;
+
+
 /* XPath parser control block */
 typedef struct xpath_pcb_t_ {
     dlq_hdr_t            qhdr;           /* in case saved in a Q */
@@ -435,6 +481,13 @@ typedef struct xpath_pcb_t_ {
     status_t             validateres;
     status_t             valueres;
 
+    /* expression tree built by the first evaluation and
+     * walked by later ones instead of parsing the tokens again;
+     * exprdone is set once it was tried, even if it failed
+     */
+    xpath_expr_t        *exprtree;
+    boolean              exprdone;
+
     /* saved error info for the agent to process */
     ncx_error_t          tkerr;
     boolean              seen;      /* yangdiff support */
@@ -457,11 +510,30 @@ typedef struct xpath_fncb_t_ {
 } xpath_fncb_t;
 
 
+/* Hash index of the node pointers in a Q of xpath_resnode_t
+ * Only built once the Q has XPATH_NODEIDX_MIN_NODES entries;
+ * nodes must be added with the index to keep it current
+ */
+typedef struct xpath_nodeidx_t_ {
+    dlq_hdr_t         *resnodeQ;
+    xpath_resnode_t  **slots;      /* open addressing, NULL == free */
+    uint32             size;          /* 0 if the table not built */
+    uint32             count;           /* entries in resnodeQ */
+} xpath_nodeidx_t;
+
+
 /* Value or object node walker fn callback parameters */
 typedef struct xpath_walkerparms_t_ {
     dlq_hdr_t         *resnodeQ;
+    xpath_nodeidx_t    nodeidx;              /* index of resnodeQ */
     int64              callcount;
     status_t           res;
+
+    /* last value node added, to get the position of the
+     * next sibling without counting from the first child
+     */
+    val_value_t       *lastval;
+    int64              lastposition;
 } xpath_walkerparms_t;
 
 
@@ -838,6 +910,34 @@ extern void
     xpath_clean_result (xpath_result_t *result);
 
 
+/********************************************************************
+* FUNCTION xpath_new_expr
+* 
+* malloc an XPath expression tree node
+*
+* INPUTS:
+*   extyp == the node type
+*
+* RETURNS:
+*   pointer to malloced struct, NULL if malloc error
+*********************************************************************/
+extern xpath_expr_t *
+    xpath_new_expr (xpath_extyp_t extyp);
+
+
+/********************************************************************
+* FUNCTION xpath_free_expr
+* 
+* Free a malloced XPath expression tree node
+* and all the nodes below it
+*
+* INPUTS:
+*   expr == pointer to expression tree node to free
+*********************************************************************/
+extern void
+    xpath_free_expr (xpath_expr_t *expr);
+
+
 /********************************************************************
 * FUNCTION xpath_new_resnode
 * 
@@ -43,6 +43,7 @@ date         init     comment
 #include "ncx.h"
 #include "ncx_feature.h"
 #include "ncx_num.h"
+#include "ncx_regex.h"
 #include "obj.h"
 #include "val123.h"
 #include "tk.h"
@@ -63,12 +64,23 @@ date         init     comment
 
 #define TEMP_BUFFSIZE  1024
 
+/* precedence levels of the binary operators in an expression tree */
+#define EXPR_LEVEL_OR              0
+#define EXPR_LEVEL_AND             1
+#define EXPR_LEVEL_EQUALITY        2
+#define EXPR_LEVEL_RELATIONAL      3
+#define EXPR_LEVEL_ADDITIVE        4
+#define EXPR_LEVEL_MULTIPLICATIVE  5
+
 /********************************************************************
 *                                                                   *
 *           F O R W A R D   D E C L A R A T I O N S                 *
 *                                                                   *
 *********************************************************************/
 static xpath_result_t* parse_expr( xpath_pcb_t *pcb, status_t  *res); 
+static xpath_expr_t* compile_expr( xpath_pcb_t *pcb, status_t *res);
+static xpath_result_t* eval_expr( xpath_pcb_t *pcb, xpath_expr_t *expr,
+                                  status_t *res);
 static xpath_result_t* boolean_fn( xpath_pcb_t *pcb, dlq_hdr_t *parmQ, 
                                    status_t *res );
 static xpath_result_t* ceiling_fn( xpath_pcb_t *pcb, dlq_hdr_t *parmQ,
@@ -1961,6 +1973,60 @@ static xpath_nodetype_t
 } /* get_nodetype_id */
 
 
+/********************************************************************
+* FUNCTION get_token_axis_id
+* 
+* Check a string token for a match of an AxisName
+* The result is saved in the token, so the name is only
+* compared once, even if the expression is parsed again
+* every time it is evaluated
+*
+* INPUTS:
+*    tk == token to check (may be NULL)
+*
+* RETURNS:
+*   enum of axis name or XP_AX_NONE (0) if not an axis name
+*********************************************************************/
+static ncx_xpath_axis_t
+    get_token_axis_id (tk_token_t *tk)
+{
+    if (!tk) {
+        return XP_AX_NONE;
+    }
+    if (!tk->xpaxis) {
+        tk->xpaxis = (uint8)(get_axis_id(tk->val) + 1);
+    }
+    return (ncx_xpath_axis_t)(tk->xpaxis - 1);
+
+} /* get_token_axis_id */
+
+
+/********************************************************************
+* FUNCTION get_token_nodetype_id
+* 
+* Check a string token for a match of a NodeType
+* The result is saved in the token, like get_token_axis_id
+*
+* INPUTS:
+*    tk == token to check (may be NULL)
+*
+* RETURNS:
+*   enum of node type or XP_EXNT_NONE (0) if not a node type name
+*********************************************************************/
+static xpath_nodetype_t
+    get_token_nodetype_id (tk_token_t *tk)
+{
+    if (!tk) {
+        return XP_EXNT_NONE;
+    }
+    if (!tk->xpnodetyp) {
+        tk->xpnodetyp = (uint8)(get_nodetype_id(tk->val) + 1);
+    }
+    return (xpath_nodetype_t)(tk->xpnodetyp - 1);
+
+} /* get_token_nodetype_id */
+
+
 /********************************************************************
 * FUNCTION location_path_end
 * 
@@ -4566,17 +4632,41 @@ static xpath_result_t *
     xpath_result_t *result;
     xpath_result_t  *parm1, *parm2;
     xmlRegexpPtr regex;
+    const xmlChar *patstr;
+    xmlChar *cvtstr;
 
     xmlns_id_t  nsid;
     const xmlChar *name;
     xpath_resnode_t  *resnode;
 
     parm1 = (xpath_result_t *)dlq_firstEntry(parmQ);
-    parm2 = (xpath_result_t *)dlq_nextEntry(parm1);
+    parm2 = (parm1) ? (xpath_result_t *)dlq_nextEntry(parm1) : NULL;
+    if (parm1 == NULL || parm2 == NULL) {
+        /* a parm expression is not evaluated; no result processing */
+        return NULL;
+    }
     assert(parm1->restype==XP_RT_STRING || parm1->restype==XP_RT_NODESET);
-    assert(parm2->restype==XP_RT_STRING);
 
-    regex=xmlRegexpCompile(parm2->r.str);
+    /* the pattern can be any expression, e.g. string(../pattern) */
+    cvtstr = NULL;
+    if (parm2->restype == XP_RT_STRING) {
+        patstr = (parm2->r.str) ? parm2->r.str : EMPTY_STRING;
+    } else {
+        *res = xpath_cvt_string(pcb, parm2, &cvtstr);
+        if (*res != NO_ERR) {
+            return NULL;
+        }
+        patstr = cvtstr;
+    }
+
+    regex = ncx_regex_get(patstr, res);
+    if (regex == NULL && *res != ERR_NCX_INVALID_PATTERN) {
+        if (cvtstr) {
+            m__free(cvtstr);
+        }
+        return NULL;
+    }
+    *res = NO_ERR;
 
     result = new_result(pcb, XP_RT_BOOLEAN);
     assert(result);
@@ -4636,7 +4726,10 @@ static xpath_result_t *
     }
 
     if(regex) {
-        xmlRegFreeRegexp(regex);
+        ncx_regex_release(patstr);
+    }
+    if (cvtstr) {
+        m__free(cvtstr);
     }
 
     if(*res!=NO_ERR) {
@@ -5374,6 +5467,300 @@ static xpath_resnode_t *
 }  /* find_resnode_slow */
 
 
+/********************************************************************
+* FUNCTION resnode_ptr
+* 
+* Get the node pointer stored in a result node
+*
+* INPUTS:
+*    pcb == parser control block to use
+*    resnode == result node to check
+*
+* RETURNS:
+*    value or object pointer, depending on the parsing mode
+*********************************************************************/
+static const void *
+    resnode_ptr (xpath_pcb_t *pcb,
+                 const xpath_resnode_t *resnode)
+{
+    if (pcb->val) {
+        return (const void *)resnode->node.valptr;
+    } else {
+        return (const void *)resnode->node.objptr;
+    }
+
+}  /* resnode_ptr */
+
+
+/********************************************************************
+* FUNCTION nodeidx_slot
+* 
+* Get the first slot to check for a node pointer
+*
+* INPUTS:
+*    nodeidx == node index with the table built
+*    ptr == node pointer to hash
+*
+* RETURNS:
+*    slot number
+*********************************************************************/
+static uint32
+    nodeidx_slot (const xpath_nodeidx_t *nodeidx,
+                  const void *ptr)
+{
+    uint32  hash;
+
+    /* the low bits of a malloced pointer are always the same */
+    hash = (uint32)((size_t)ptr >> 4);
+    hash *= 2654435761U;
+    return (hash >> 7) & (nodeidx->size - 1);
+
+}  /* nodeidx_slot */
+
+
+/********************************************************************
+* FUNCTION nodeidx_insert
+* 
+* Add a result node to the hash table of a node index
+* There must be a free slot in the table
+*
+* INPUTS:
+*    pcb == parser control block to use
+*    nodeidx == node index with the table built
+*    resnode == result node to add
+*
+*********************************************************************/
+static void
+    nodeidx_insert (xpath_pcb_t *pcb,
+                    xpath_nodeidx_t *nodeidx,
+                    xpath_resnode_t *resnode)
+{
+    uint32  slot;
+
+    slot = nodeidx_slot(nodeidx, resnode_ptr(pcb, resnode));
+    while (nodeidx->slots[slot]) {
+        slot = (slot + 1) & (nodeidx->size - 1);
+    }
+    nodeidx->slots[slot] = resnode;
+
+}  /* nodeidx_insert */
+
+
+/********************************************************************
+* FUNCTION build_nodeidx
+* 
+* (Re)build the hash table of a node index from its Q
+*
+* INPUTS:
+*    pcb == parser control block to use
+*    nodeidx == node index to build
+*    size == number of slots to use; must be a power of 2
+*            and more than the number of nodes in the Q
+*
+* RETURNS:
+*    status; the old table is kept if malloc fails
+*********************************************************************/
+static status_t
+    build_nodeidx (xpath_pcb_t *pcb,
+                   xpath_nodeidx_t *nodeidx,
+                   uint32 size)
+{
+    xpath_resnode_t  **slots, *resnode;
+
+    slots = m__getMem(size * sizeof(xpath_resnode_t *));
+    if (!slots) {
+        return ERR_INTERNAL_MEM;
+    }
+    memset(slots, 0x0, size * sizeof(xpath_resnode_t *));
+
+    if (nodeidx->slots) {
+        m__free(nodeidx->slots);
+    }
+    nodeidx->slots = slots;
+    nodeidx->size = size;
+
+    for (resnode = (xpath_resnode_t *)
+             dlq_firstEntry(nodeidx->resnodeQ);
+         resnode != NULL;
+         resnode = (xpath_resnode_t *)dlq_nextEntry(resnode)) {
+        nodeidx_insert(pcb, nodeidx, resnode);
+    }
+    return NO_ERR;
+
+}  /* build_nodeidx */
+
+
+/********************************************************************
+* FUNCTION init_nodeidx
+* 
+* Start a node index for a Q of result nodes
+* The Q may already contain some nodes
+*
+* INPUTS:
+*    pcb == parser control block to use
+*    nodeidx == node index to initialize
+*    resnodeQ == Q of xpath_resnode_t to index
+*
+*********************************************************************/
+static void
+    init_nodeidx (xpath_pcb_t *pcb,
+                  xpath_nodeidx_t *nodeidx,
+                  dlq_hdr_t *resnodeQ)
+{
+    uint32  size;
+
+    nodeidx->resnodeQ = resnodeQ;
+    nodeidx->slots = NULL;
+    nodeidx->size = 0;
+    nodeidx->count = dlq_count(resnodeQ);
+
+    if (nodeidx->count >= XPATH_NODEIDX_MIN_NODES) {
+        size = XPATH_NODEIDX_MIN_NODES * 4;
+        while (size < nodeidx->count * 2) {
+            size *= 2;
+        }
+        /* stay with a linear search if malloc fails */
+        (void)build_nodeidx(pcb, nodeidx, size);
+    }
+
+}  /* init_nodeidx */
+
+
+/********************************************************************
+* FUNCTION clean_nodeidx
+* 
+* Free the hash table of a node index
+* The Q of result nodes is not changed
+*
+* INPUTS:
+*    nodeidx == node index to clean
+*
+*********************************************************************/
+static void
+    clean_nodeidx (xpath_nodeidx_t *nodeidx)
+{
+    if (nodeidx->slots) {
+        m__free(nodeidx->slots);
+        nodeidx->slots = NULL;
+    }
+    nodeidx->size = 0;
+    nodeidx->count = 0;
+
+}  /* clean_nodeidx */
+
+
+/********************************************************************
+* FUNCTION find_nodeidx
+* 
+* Check if the specified node ptr is already in an indexed Q
+*
+* INPUTS:
+*    pcb == parser control block to use
+*    nodeidx == node index to check
+*    ptr   == pointer value to find
+*
+* RETURNS:
+*    found resnode or NULL if not found
+*********************************************************************/
+static xpath_resnode_t *
+    find_nodeidx (xpath_pcb_t *pcb,
+                  xpath_nodeidx_t *nodeidx,
+                  const void *ptr)
+{
+    xpath_resnode_t  *resnode;
+    uint32            slot;
+
+    if (!nodeidx->size) {
+        return find_resnode(pcb, nodeidx->resnodeQ, ptr);
+    }
+
+    slot = nodeidx_slot(nodeidx, ptr);
+    while ((resnode = nodeidx->slots[slot]) != NULL) {
+        if (resnode_ptr(pcb, resnode) == ptr) {
+            return resnode;
+        }
+        slot = (slot + 1) & (nodeidx->size - 1);
+    }
+    return NULL;
+
+}  /* find_nodeidx */
+
+
+/********************************************************************
+* FUNCTION add_nodeidx
+* 
+* Add a result node to the end of an indexed Q
+* The caller has already checked it is not a duplicate
+*
+* INPUTS:
+*    pcb == parser control block to use
+*    nodeidx == node index to use
+*    resnode == result node to add
+*
+*********************************************************************/
+static void
+    add_nodeidx (xpath_pcb_t *pcb,
+                 xpath_nodeidx_t *nodeidx,
+                 xpath_resnode_t *resnode)
+{
+    dlq_enque(resnode, nodeidx->resnodeQ);
+    nodeidx->count++;
+
+    if (!nodeidx->size) {
+        if (nodeidx->count >= XPATH_NODEIDX_MIN_NODES) {
+            /* stay with a linear search if malloc fails */
+            (void)build_nodeidx(pcb, 
+                                nodeidx,
+                                XPATH_NODEIDX_MIN_NODES * 4);
+        }
+        return;
+    }
+
+    if (nodeidx->count * 2 > nodeidx->size &&
+        build_nodeidx(pcb, nodeidx, nodeidx->size * 2) == NO_ERR) {
+        /* the new node was added by the rebuild */
+        return;
+    }
+
+    if (nodeidx->count < nodeidx->size) {
+        nodeidx_insert(pcb, nodeidx, resnode);
+    } else {
+        /* table full and cannot grow; go back to a linear search */
+        m__free(nodeidx->slots);
+        nodeidx->slots = NULL;
+        nodeidx->size = 0;
+    }
+
+}  /* add_nodeidx */
+
+
+/********************************************************************
+* FUNCTION init_walkerparms
+* 
+* Initialize the parameters for value_walker_fn or
+* object_walker_fn to add nodes to the specified Q
+*
+* INPUTS:
+*    pcb == parser control block to use
+*    parms == walker parameters to initialize
+*    resnodeQ == empty Q of xpath_resnode_t to fill
+*
+*********************************************************************/
+static void
+    init_walkerparms (xpath_pcb_t *pcb,
+                      xpath_walkerparms_t *parms,
+                      dlq_hdr_t *resnodeQ)
+{
+    parms->resnodeQ = resnodeQ;
+    init_nodeidx(pcb, &parms->nodeidx, resnodeQ);
+    parms->callcount = 0;
+    parms->res = NO_ERR;
+    parms->lastval = NULL;
+    parms->lastposition = 0;
+
+}  /* init_walkerparms */
+
+
 /********************************************************************
 * FUNCTION merge_nodeset
 * 
@@ -5394,6 +5781,7 @@ static void
                    xpath_result_t *val2)
 {
     xpath_resnode_t        *resnode, *findnode;
+    xpath_nodeidx_t         nodeidx;
 
     if (!pcb->val && !pcb->obj) {
         return;
@@ -5405,19 +5793,15 @@ static void
         return;
     }
 
+    init_nodeidx(pcb, &nodeidx, &val2->r.nodeQ);
+
     while (!dlq_empty(&val1->r.nodeQ)) {
         resnode = (xpath_resnode_t *)
             dlq_deque(&val1->r.nodeQ);
 
-        if (pcb->val) {
-            findnode = find_resnode(pcb, 
-                                    &val2->r.nodeQ,
-                                    resnode->node.valptr);
-        } else {
-            findnode = find_resnode(pcb, 
-                                    &val2->r.nodeQ,
-                                    resnode->node.objptr);
-        }
+        findnode = find_nodeidx(pcb, 
+                                &nodeidx,
+                                resnode_ptr(pcb, resnode));
         if (findnode) {
             if (resnode->dblslash) {
                 findnode->dblslash = TRUE;
@@ -5425,10 +5809,12 @@ static void
             findnode->position = resnode->position;
             free_resnode(pcb, resnode);
         } else {
-            dlq_enque(resnode, &val2->r.nodeQ);
+            add_nodeidx(pcb, &nodeidx, resnode);
         }
     }
 
+    clean_nodeidx(&nodeidx);
+
 }  /* merge_nodeset */
 
 
@@ -5505,7 +5891,7 @@ static boolean
     parms = (xpath_walkerparms_t *)cookie2;
 
     /* check if this node is already in the result */
-    if (find_resnode(pcb, parms->resnodeQ, val)) {
+    if (find_nodeidx(pcb, &parms->nodeidx, val)) {
         return TRUE;
     }
 
@@ -5514,6 +5900,26 @@ static boolean
     } else {
         position = 0;
         done = FALSE;
+
+        /* the walkers usually return siblings in order, so
+         * try counting on from the last node added first
+         */
+        if (parms->lastval && parms->lastval->parent == val->parent) {
+            position = parms->lastposition;
+            for (child = parms->lastval;
+                 child != NULL && !done;
+                 child = val_get_next_child(child)) {
+                if (child == val) {
+                    done = TRUE;
+                } else {
+                    position++;
+                }
+            }
+            if (!done) {
+                position = 0;
+            }
+        }
+
         for (child = val_get_first_child(val->parent);
              child != NULL && !done;
              child = val_get_next_child(child)) {
@@ -5522,6 +5928,9 @@ static boolean
                 done = TRUE;
             }
         }
+
+        parms->lastval = val;
+        parms->lastposition = position;
     }
 
     ++parms->callcount;
@@ -5536,7 +5945,7 @@ static boolean
         return FALSE;
     }
 
-    dlq_enque(newresnode, parms->resnodeQ);
+    add_nodeidx(pcb, &parms->nodeidx, newresnode);
     return TRUE;
 
 }  /* value_walker_fn */
@@ -5575,7 +5984,7 @@ static boolean
     parms = (xpath_walkerparms_t *)cookie2;
 
     /* check if this node is already in the result */
-    if (find_resnode(pcb, parms->resnodeQ, obj)) {
+    if (find_nodeidx(pcb, &parms->nodeidx, obj)) {
         return TRUE;
     }
 
@@ -5591,7 +6000,7 @@ static boolean
         return FALSE;
     }
 
-    dlq_enque(newresnode, parms->resnodeQ);
+    add_nodeidx(pcb, &parms->nodeidx, newresnode);
     return TRUE;
 
 }  /* object_walker_fn */
@@ -5648,9 +6057,7 @@ static status_t
 
     dlq_createSQue(&resnodeQ);
 
-    walkerparms.resnodeQ = &resnodeQ;
-    walkerparms.res = NO_ERR;
-    walkerparms.callcount = 0;
+    init_walkerparms(pcb, &walkerparms, &resnodeQ);
 
     modname = (nsid) ? xmlns_get_module(nsid) : NULL;
     useroot = (pcb->flags & XP_FL_USEROOT) ? TRUE : FALSE;
@@ -5734,8 +6141,8 @@ static status_t
                 }
 
                 if (keep) {
-                    findnode = find_resnode(pcb, 
-                                            &resnodeQ, 
+                    findnode = find_nodeidx(pcb, 
+                                            &walkerparms.nodeidx,
                                             testval);
                     if (findnode) {
                         if (resnode->dblslash) {
@@ -5749,7 +6156,7 @@ static status_t
                         resnode->node.valptr = testval;
                         resnode->position = 
                             ++walkerparms.callcount;
-                        dlq_enque(resnode, &resnodeQ);
+                        add_nodeidx(pcb, &walkerparms.nodeidx, resnode);
                     }
                 } else {
                     free_resnode(pcb, resnode);
@@ -5781,8 +6188,8 @@ static status_t
                 }
 
                 if (keep) {
-                    findnode = find_resnode(pcb, 
-                                            &resnodeQ, 
+                    findnode = find_nodeidx(pcb, 
+                                            &walkerparms.nodeidx,
                                             testobj);
                     if (findnode) {
                         if (resnode->dblslash) {
@@ -5796,7 +6203,7 @@ static status_t
                         resnode->node.objptr = testobj;
                         resnode->position =
                             ++walkerparms.callcount;
-                        dlq_enque(resnode, &resnodeQ);
+                        add_nodeidx(pcb, &walkerparms.nodeidx, resnode);
                     }
                 } else {
                     if (pcb->logerrors && 
@@ -5816,6 +6223,8 @@ static status_t
         }
     }
 
+    clean_nodeidx(&walkerparms.nodeidx);
+
     /* put the resnode entries back where they belong */
     if (!dlq_empty(&resnodeQ)) {
         dlq_block_enque(&resnodeQ, &result->r.nodeQ);
@@ -5878,9 +6287,7 @@ static status_t
 
     dlq_createSQue(&resnodeQ);
 
-    walkerparms.resnodeQ = &resnodeQ;
-    walkerparms.res = NO_ERR;
-    walkerparms.callcount = 0;
+    init_walkerparms(pcb, &walkerparms, &resnodeQ);
 
     modname = (nsid) ? xmlns_get_module(nsid) : NULL;
     useroot = (pcb->flags & XP_FL_USEROOT) ? TRUE : FALSE;
@@ -5944,7 +6351,7 @@ static status_t
                     if (resnode->dblslash) {
                         /* just move this node to the result */
                         resnode->position = ++position;
-                        dlq_enque(resnode, &resnodeQ);
+                        add_nodeidx(pcb, &walkerparms.nodeidx, resnode);
                     } else {
                         /* no parent available error
                          * remove node from result 
@@ -5975,8 +6382,8 @@ static status_t
                     }
 
                     if (keep) {
-                        findnode = find_resnode(pcb, 
-                                                &resnodeQ, 
+                        findnode = find_nodeidx(pcb, 
+                                                &walkerparms.nodeidx,
                                                 testval);
                         if (findnode) {
                             /* parent already in the Q
@@ -5991,7 +6398,7 @@ static status_t
                             /* set the resnode to its parent */
                             resnode->position = ++position;
                             resnode->node.valptr = testval;
-                            dlq_enque(resnode, &resnodeQ);
+                            add_nodeidx(pcb, &walkerparms.nodeidx, resnode);
                         }
                     } else {
                         /* no parent available error
@@ -6005,15 +6412,15 @@ static status_t
                 testobj = resnode->node.objptr;
                 if (testobj == pcb->docroot) {
                     resnode->position = ++position;
-                    dlq_enque(resnode, &resnodeQ);
+                    add_nodeidx(pcb, &walkerparms.nodeidx, resnode);
                 } else if (!testobj->parent) {
                     if (!resnode->dblslash && (modname || name)) {
                         no_parent_warning(pcb);
                         free_resnode(pcb, resnode);
                     } else {
                         /* this is a databd node */
-                        findnode = find_resnode(pcb, 
-                                                &resnodeQ, 
+                        findnode = find_nodeidx(pcb, 
+                                                &walkerparms.nodeidx,
                                                 pcb->docroot);
                         if (findnode) {
                             if (resnode->dblslash) {
@@ -6024,7 +6431,7 @@ static status_t
                         } else {
                             resnode->position = ++position;
                             resnode->node.objptr = pcb->docroot;
-                            dlq_enque(resnode, &resnodeQ);
+                            add_nodeidx(pcb, &walkerparms.nodeidx, resnode);
                         }
                     }
                 } else {
@@ -6069,7 +6476,9 @@ static status_t
 
                     if (keep) {
                         /* replace this node with the useobj */
-                        findnode = find_resnode(pcb, &resnodeQ, useobj);
+                        findnode = find_nodeidx(pcb, 
+                                                &walkerparms.nodeidx,
+                                                useobj);
                         if (findnode) {
                             if (resnode->dblslash) {
                                 findnode->position = ++position;
@@ -6079,7 +6488,7 @@ static status_t
                         } else {
                             resnode->node.objptr = useobj;
                             resnode->position = ++position;
-                            dlq_enque(resnode, &resnodeQ);
+                            add_nodeidx(pcb, &walkerparms.nodeidx, resnode);
                         }
                     } else {
                         no_parent_warning(pcb);
@@ -6090,6 +6499,8 @@ static status_t
         }
     }
 
+    clean_nodeidx(&walkerparms.nodeidx);
+
     /* put the resnode entries back where they belong */
     if (!dlq_empty(&resnodeQ)) {
         dlq_block_enque(&resnodeQ, &result->r.nodeQ);
@@ -6174,9 +6585,7 @@ static status_t
         modname = NULL;
     }
 
-    walkerparms.resnodeQ = &resnodeQ;
-    walkerparms.res = NO_ERR;
-    walkerparms.callcount = 0;
+    init_walkerparms(pcb, &walkerparms, &resnodeQ);
 
     /* the resnodes need to be deleted or moved to a tempQ
      * to correctly track duplicates and remove them
@@ -6265,6 +6674,8 @@ static status_t
         free_resnode(pcb, resnode);
     }
 
+    clean_nodeidx(&walkerparms.nodeidx);
+
     /* put the resnode entries back where they belong */
     if (!dlq_empty(&resnodeQ)) {
         dlq_block_enque(&resnodeQ, &result->r.nodeQ);
@@ -6395,9 +6806,7 @@ static status_t
     modname = (nsid) ? xmlns_get_module(nsid) : NULL;
     useroot = (pcb->flags & XP_FL_USEROOT) ? TRUE : FALSE;
 
-    walkerparms.resnodeQ = &resnodeQ;
-    walkerparms.res = NO_ERR;
-    walkerparms.callcount = 0;
+    init_walkerparms(pcb, &walkerparms, &resnodeQ);
 
     /* the resnodes need to be deleted or moved to a tempQ
      * to correctly track duplicates and remove them
@@ -6465,6 +6874,8 @@ static status_t
         free_resnode(pcb, resnode);
     }
 
+    clean_nodeidx(&walkerparms.nodeidx);
+
     /* put the resnode entries back where they belong */
     if (!dlq_empty(&resnodeQ)) {
         dlq_block_enque(&resnodeQ, &result->r.nodeQ);
@@ -6536,6 +6947,7 @@ static status_t
     boolean                 cfgonly, fnresult, fncalled, orself, useroot;
     dlq_hdr_t               resnodeQ;
     xpath_walkerparms_t     walkerparms;
+    xpath_nodeidx_t         nodeidx;
 
     if (!pcb->val && !pcb->obj) {
         return NO_ERR;
@@ -6557,8 +6969,7 @@ static status_t
     useroot = (pcb->flags & XP_FL_USEROOT) ? TRUE : FALSE;
     orself = (axis == XP_AX_ANCESTOR_OR_SELF) ? TRUE : FALSE;
 
-    walkerparms.resnodeQ = &resnodeQ;
-    walkerparms.res = NO_ERR;
+    init_walkerparms(pcb, &walkerparms, &resnodeQ);
 
     /* the resnodes need to be deleted or moved to a tempQ
      * to correctly track duplicates and remove them
@@ -6607,7 +7018,9 @@ static status_t
                 continue;
             }
 
+            nodeidx = walkerparms.nodeidx;
             walkerparms.resnodeQ = &dummy->r.nodeQ;
+            init_nodeidx(pcb, &walkerparms.nodeidx, &dummy->r.nodeQ);
             if (pcb->val) {
                 fnresult = val_find_all_descendants(value_walker_fn,
                                                     pcb,
@@ -6634,6 +7047,8 @@ static status_t
                                                     TRUE,
                                                     &fncalled);
             }
+            clean_nodeidx(&walkerparms.nodeidx);
+            walkerparms.nodeidx = nodeidx;
             walkerparms.resnodeQ = &resnodeQ;
 
             if (walkerparms.res != NO_ERR) {
@@ -6653,11 +7068,12 @@ static status_t
 
                     /* It is assumed that testnode cannot NULL because the call 
                      * to dlq_empty returned false. */
-                    if (find_resnode(pcb, &resnodeQ,
-                                     (const void *)testnode->node.valptr)) {
+                    if (find_nodeidx(pcb, 
+                                     &walkerparms.nodeidx,
+                                     resnode_ptr(pcb, testnode))) {
                         free_resnode(pcb, testnode);
                     } else {
-                        dlq_enque(testnode, &resnodeQ);
+                        add_nodeidx(pcb, &walkerparms.nodeidx, testnode);
                     }
                 }
                 free_result(pcb, dummy);
@@ -6667,6 +7083,8 @@ static status_t
         free_resnode(pcb, resnode);
     }
 
+    clean_nodeidx(&walkerparms.nodeidx);
+
     /* put the resnode entries back where they belong */
     if (!dlq_empty(&resnodeQ)) {
         dlq_block_enque(&resnodeQ, &result->r.nodeQ);
@@ -6694,219 +7112,476 @@ static status_t
 }  /* set_nodeset_ancestor */
 
 
-/***********   B E G I N    E B N F    F U N C T I O N S *************/
-
-
 /********************************************************************
-* FUNCTION parse_node_test
+* FUNCTION predicate_match
 * 
-* Parse the XPath NodeTest sequence
-* It has already been tokenized
-*
-* Error messages are printed by this function!!
-* Do not duplicate error messages upon error return
-*
-* [7] NodeTest ::= NameTest
-*                  | NodeType '(' ')'
-*                  | 'processing-instruction' '(' Literal ')'
-*
-* [37] NameTest ::= '*'
-*                  | NCName ':' '*'
-*                  | QName
-*
-* [38] NodeType ::= 'comment'
-*                    | 'text'   
-*                    | 'processing-instruction'
-*                    | 'node'
+* Check if a Predicate result selects a node
 *
 * INPUTS:
-*    pcb == parser control block in progress
-*    axis  == current axis from first part of Step
-*    result == address of pointer to result struct in progress
-*
-* OUTPUTS:
-*   *result is modified
+*    val1 == result of the PredicateExpr for the node
+*    resnode == context node the predicate was evaluated for
 *
 * RETURNS:
-*   status
+*   TRUE if the node is selected, FALSE if it is removed
 *********************************************************************/
-static status_t
-    parse_node_test (xpath_pcb_t *pcb,
-                     ncx_xpath_axis_t axis,
-                     xpath_result_t **result)
+static boolean
+    predicate_match (const xpath_result_t *val1,
+                     const xpath_resnode_t *resnode)
 {
-    const xmlChar     *name;
-    tk_type_t          nexttyp;
-    xpath_nodetype_t   nodetyp;
-    status_t           res;
-    xmlns_id_t         nsid;
-    boolean            emptyresult, textmode;
+    int64  position;
 
-    nsid = 0;
-    name = NULL;
-    textmode = FALSE;
+    if (val1->restype == XP_RT_NUMBER) {
+        /* the predicate specifies a context
+         * position and this resnode is
+         * only selected if it is the Nth
+         * instance within the current context
+         */
+        if (ncx_num_is_integral(&val1->r.num, NCX_BT_FLOAT64)) {
+            position = ncx_cvt_to_int64(&val1->r.num, NCX_BT_FLOAT64);
 
-    res = TK_ADV(pcb->tkc);
-    if (res != NO_ERR) {
-        res = ERR_NCX_INVALID_XPATH_EXPR;
-        if (pcb->logerrors) {
-            log_error("\nError: token expected in XPath "
-                      "expression '%s'", pcb->exprstr);
-            ncx_print_errormsg(pcb->tkc, pcb->tkerr.mod, res);
-        } else {
-            /*** handle agent error ***/
+            /* check if the proximity position
+             * of this node matches the position
+             * value from this expression
+             */
+            return (position == resnode->position) ? TRUE : FALSE;
         }
-        return res;
+        return FALSE;
     }
+    return xpath_cvt_boolean(val1);
 
-    /* process the tokens but not the result yet */
-    switch (TK_CUR_TYP(pcb->tkc)) {
-    case TK_TT_STAR:
-        if (pcb->flags & XP_FL_INSTANCEID) {
-            invalid_instanceid_error(pcb);
-            return ERR_NCX_INVALID_INSTANCEID;
+}  /* predicate_match */
+
+
+/********************************************************************
+* FUNCTION get_varbind_result
+* 
+* Get the value of the VariableReference in the current token
+*
+* INPUTS:
+*    pcb == parser control block in progress
+*           TK_CUR(pcb->tkc) is the TK_TT_VARBIND or
+*           TK_TT_QVARBIND token
+*    res == address of result status
+*
+* OUTPUTS:
+*   *res == function result status
+*
+* RETURNS:
+*   malloced result struct or NULL if error
+*********************************************************************/
+static xpath_result_t *
+    get_varbind_result (xpath_pcb_t *pcb,
+                        status_t *res)
+{
+    xpath_result_t  *val1;
+    ncx_var_t       *varbind;
+    const xmlChar   *errstr;
+
+    val1 = NULL;
+    if (TK_CUR_TYP(pcb->tkc) == TK_TT_VARBIND) {
+        varbind = get_varbind(pcb, 
+                              NULL, 
+                              0, 
+                              TK_CUR_VAL(pcb->tkc), res);
+        errstr = TK_CUR_VAL(pcb->tkc);
+    } else {
+        varbind = get_varbind(pcb, 
+                              TK_CUR_MOD(pcb->tkc),
+                              TK_CUR_MODLEN(pcb->tkc), 
+                              TK_CUR_VAL(pcb->tkc), res);
+        errstr = TK_CUR_MOD(pcb->tkc);
+    }
+    if (!varbind || *res != NO_ERR) {
+        if (pcb->logerrors) {
+            if (*res == ERR_NCX_DEF_NOT_FOUND) {
+                log_error("\nError: unknown variable binding '%s'",
+                          errstr);
+                ncx_print_errormsg(pcb->tkc, pcb->tkerr.mod, *res);
+            } else {
+                log_error("\nError: error in variable binding '%s'",
+                          errstr);
+                ncx_print_errormsg(pcb->tkc, pcb->tkerr.mod, *res);
+            }
         }
-        break;
-    case TK_TT_NCNAME_STAR:
-        if (pcb->flags & XP_FL_INSTANCEID) {
-            invalid_instanceid_error(pcb);
-            return ERR_NCX_INVALID_INSTANCEID;
+    } else {
+        /* OK: found the variable binding */
+        val1 = cvt_from_value(pcb, varbind->val);
+        if (!val1) {
+            *res = ERR_INTERNAL_MEM;
         }
-        /* match all nodes in the namespace w/ specified prefix */
-        if (!pcb->tkc->cur->nsid) {
-            res = check_qname_prefix(pcb,
-                                     TK_CUR_VAL(pcb->tkc),
-                                     xml_strlen(TK_CUR_VAL(pcb->tkc)),
-                                     &pcb->tkc->cur->nsid);
+    }
+    return val1;
+
+}  /* get_varbind_result */
+
+
+/********************************************************************
+* FUNCTION get_number_token
+* 
+* Convert the Number in the current token
+*
+* INPUTS:
+*    pcb == parser control block in progress
+*           TK_CUR(pcb->tkc) is the TK_TT_DNUM or TK_TT_RNUM token
+*    num == address of number to set
+*
+* OUTPUTS:
+*   *num is set to the NCX_BT_FLOAT64 value
+*
+* RETURNS:
+*   status
+*********************************************************************/
+static status_t
+    get_number_token (xpath_pcb_t *pcb,
+                      ncx_num_t *num)
+{
+    ncx_numfmt_t   numfmt;
+
+    numfmt = ncx_get_numfmt(TK_CUR_VAL(pcb->tkc));
+    if (numfmt == NCX_NF_OCTAL) {
+        numfmt = NCX_NF_DEC;
+    }
+    if (numfmt == NCX_NF_DEC || numfmt == NCX_NF_REAL) {
+        return ncx_convert_num(TK_CUR_VAL(pcb->tkc),
+                               numfmt,
+                               NCX_BT_FLOAT64,
+                               num);
+    } else if (numfmt == NCX_NF_NONE) {
+        return ERR_NCX_INVALID_VALUE;
+    } else {
+        return ERR_NCX_WRONG_NUMTYP;
+    }
+
+}  /* get_number_token */
+
+
+/********************************************************************
+* FUNCTION call_function
+* 
+* Call an XPath function with its parameters
+*
+* INPUTS:
+*    pcb == parser control block in progress
+*    fncb == function to call
+*    parmQ == Q of xpath_result_t parameters
+*    res == address of result status
+*
+* OUTPUTS:
+*   *res == function result status
+*
+* RETURNS:
+*   malloced result struct or NULL if none or error
+*********************************************************************/
+static xpath_result_t *
+    call_function (xpath_pcb_t *pcb,
+                   const xpath_fncb_t *fncb,
+                   dlq_hdr_t *parmQ,
+                   status_t *res)
+{
+    xpath_result_t  *val1;
+
+    val1 = (*fncb->fn)(pcb, parmQ, res);
+
+    if (LOGDEBUG3) {
+        if (val1) {
+            log_debug3("\nXPath fn %s result:",
+                       fncb->name);
+            dump_result(pcb, val1, NULL);
+            if (pcb->val && pcb->context.node.valptr->name) {
+                log_debug3("\nXPath context val name: %s",
+                           pcb->context.node.valptr->name);
+            }
         }
-        if (res == NO_ERR) {
-            nsid = pcb->tkc->cur->nsid;
+    }
+    return val1;
+
+}  /* call_function */
+
+
+/********************************************************************
+* FUNCTION negate_result
+* 
+* Apply the unary minus operator to a result
+*
+* INPUTS:
+*    pcb == parser control block in progress
+*    val1 == operand; consumed by this function
+*    res == address of result status
+*
+* OUTPUTS:
+*   *res == function result status
+*
+* RETURNS:
+*   malloced XP_RT_NUMBER result or NULL if malloc error
+*********************************************************************/
+static xpath_result_t *
+    negate_result (xpath_pcb_t *pcb,
+                   xpath_result_t *val1,
+                   status_t *res)
+{
+    xpath_result_t  *result;
+
+    if (val1->restype == XP_RT_NUMBER) {
+        val1->r.num.d *= -1;
+        return val1;
+    }
+
+    result = new_result(pcb, XP_RT_NUMBER);
+    if (!result) {
+        *res = ERR_INTERNAL_MEM;
+        return NULL;
+    }
+    xpath_cvt_number(val1, &result->r.num);
+    result->r.num.d *= -1;
+    free_result(pcb, val1);
+    return result;
+
+}  /* negate_result */
+
+
+/********************************************************************
+* FUNCTION apply_exop
+* 
+* Apply a binary operator to 2 results
+* Used for OrExpr, AndExpr, EqualityExpr, RelationalExpr,
+* AdditiveExpr and MultiplicativeExpr
+*
+* INPUTS:
+*    pcb == parser control block in progress
+*    curop == operator to apply
+*    val2 == 1st operand
+*    val1 == 2nd operand
+*    res == address of result status
+*
+* OUTPUTS:
+*   *res == function result status
+*
+* RETURNS:
+*   malloced result struct or NULL if error;
+*   the operands are not freed
+*********************************************************************/
+static xpath_result_t *
+    apply_exop (xpath_pcb_t *pcb,
+                xpath_exop_t curop,
+                xpath_result_t *val2,
+                xpath_result_t *val1,
+                status_t *res)
+{
+    xpath_result_t  *result;
+    ncx_num_t        num1, num2;
+    boolean          cmpresult;
+
+    result = NULL;
+
+    switch (curop) {
+    case XP_EXOP_AND:
+    case XP_EXOP_OR:
+        result = new_result(pcb, XP_RT_BOOLEAN);
+        if (!result) {
+            *res = ERR_INTERNAL_MEM;
+        } else if (curop == XP_EXOP_AND) {
+            result->r.boo = (xpath_cvt_boolean(val1) &&
+                             xpath_cvt_boolean(val2)) ? TRUE : FALSE;
+        } else {
+            result->r.boo = (xpath_cvt_boolean(val1) ||
+                             xpath_cvt_boolean(val2)) ? TRUE : FALSE;
         }
         break;
-    case TK_TT_MSTRING:
-        /* match all nodes in the namespace w/ specified prefix */
-        if (!pcb->tkc->cur->nsid) {
-            res = check_qname_prefix(pcb, 
-                                     TK_CUR_MOD(pcb->tkc),
-                                     TK_CUR_MODLEN(pcb->tkc),
-                                     &pcb->tkc->cur->nsid);
+    case XP_EXOP_EQUAL:
+    case XP_EXOP_NOTEQUAL:
+        if (pcb->flags & XP_FL_INSTANCEID) {
+            *res = check_instanceid_expr(pcb, val2, val1);
+            if (*res != NO_ERR) {
+                break;
+            }
         }
-        if (res == NO_ERR) {
-            nsid = pcb->tkc->cur->nsid;
-            name = TK_CUR_VAL(pcb->tkc);
+        /* fall through */
+    case XP_EXOP_LT:
+    case XP_EXOP_GT:
+    case XP_EXOP_LEQUAL:
+    case XP_EXOP_GEQUAL:
+        cmpresult = compare_results(pcb, val2, val1, curop, res);
+        if (*res == NO_ERR) {
+            result = new_result(pcb, XP_RT_BOOLEAN);
+            if (!result) {
+                *res = ERR_INTERNAL_MEM;
+            } else {
+                result->r.boo = cmpresult;
+            }
         }
         break;
-    case TK_TT_TSTRING:
-        /* check the ID token for a NodeType name */
-        nodetyp = get_nodetype_id(TK_CUR_VAL(pcb->tkc));
-        if (nodetyp == XP_EXNT_NONE ||
-            (tk_next_typ(pcb->tkc) != TK_TT_LPAREN)) {
-            name = TK_CUR_VAL(pcb->tkc);
-            break;
+    case XP_EXOP_ADD:
+    case XP_EXOP_SUBTRACT:
+    case XP_EXOP_MULTIPLY:
+    case XP_EXOP_DIV:
+    case XP_EXOP_MOD:
+        ncx_init_num(&num1);
+        ncx_init_num(&num2);
+
+        if (val1->restype != XP_RT_NUMBER) {
+            xpath_cvt_number(val1, &num1);
+        } else {
+            *res = ncx_copy_num(&val1->r.num, &num1, NCX_BT_FLOAT64);
         }
 
-        /* get the node test left paren */
-        res = xpath_parse_token(pcb, TK_TT_LPAREN);
-        if (res != NO_ERR) {
-            return res;
+        if (val2->restype != XP_RT_NUMBER) {
+            xpath_cvt_number(val2, &num2);
+        } else {
+            *res = ncx_copy_num(&val2->r.num, &num2, NCX_BT_FLOAT64);
         }
 
-        /* check if a literal param can be present */
-        if (nodetyp == XP_EXNT_PROC_INST) {
-            /* check if a literal param is present */
-            nexttyp = tk_next_typ(pcb->tkc);
-            if (nexttyp==TK_TT_QSTRING ||
-                nexttyp==TK_TT_SQSTRING) {
-                /* temp save the literal string */
-                res = xpath_parse_token(pcb, nexttyp);
-                if (res != NO_ERR) {
-                    return res;
-                }
+        if (*res == NO_ERR) {
+            result = new_result(pcb, XP_RT_NUMBER);
+            if (!result) {
+                *res = ERR_INTERNAL_MEM;
             }
         }
 
-        /* get the node test right paren */
-        res = xpath_parse_token(pcb, TK_TT_RPAREN);
-        if (res != NO_ERR) {
-            return res;
+        if (result) {
+            switch (curop) {
+            case XP_EXOP_ADD:
+                result->r.num.d = num2.d + num1.d;
+                break;
+            case XP_EXOP_SUBTRACT:
+                result->r.num.d = num2.d - num1.d;
+                break;
+            case XP_EXOP_MULTIPLY:
+                result->r.num.d = num2.d * num1.d;
+                break;
+            case XP_EXOP_DIV:
+                if (ncx_num_zero(&num2, NCX_BT_FLOAT64)) {
+                    ncx_set_num_max(&result->r.num, NCX_BT_FLOAT64);
+                } else {
+                    result->r.num.d = num2.d / num1.d;
+                }
+                break;
+            case XP_EXOP_MOD:
+                result->r.num.d = num2.d / num1.d;
+#ifdef HAS_FLOAT
+                result->r.num.d = trunc(result->r.num.d);
+#endif
+                break;
+            default:
+                ;
+            }
         }
 
-        if (pcb->flags & XP_FL_INSTANCEID) {
-            invalid_instanceid_error(pcb);
-            return ERR_NCX_INVALID_INSTANCEID;
-        }
+        ncx_clean_num(NCX_BT_FLOAT64, &num1);
+        ncx_clean_num(NCX_BT_FLOAT64, &num2);
+        break;
+    default:
+        *res = SET_ERROR(ERR_INTERNAL_VAL);
+    }
 
-        /* process the result based on the node type test */
-        switch (nodetyp) {
-        case XP_EXNT_COMMENT:
-            /* no comments to match */
-            emptyresult = TRUE;
-            if (pcb->obj && 
-                pcb->logerrors && 
-                ncx_warning_enabled(ERR_NCX_EMPTY_XPATH_RESULT)) {
-                log_warn("\nWarning: no comment nodes available in "
-                         "XPath expr '%s'", 
-                         pcb->exprstr);
-                ncx_print_errormsg(pcb->tkc, 
-                                   pcb->tkerr.mod,
-                                   ERR_NCX_EMPTY_XPATH_RESULT);
-            } else if (pcb->objmod != NULL) {
-                ncx_inc_warnings(pcb->objmod);
-            }
+    return result;
 
-            break;
-        case XP_EXNT_TEXT:
-            /* match all leaf of leaf-list content */
-            emptyresult = FALSE;
-            textmode = TRUE;
-            break;
-        case XP_EXNT_PROC_INST:
-            /* no processing instructions to match */
-            emptyresult = TRUE;
-            if (pcb->obj && 
-                pcb->logerrors &&
-                ncx_warning_enabled(ERR_NCX_EMPTY_XPATH_RESULT)) {
-                log_warn("\nWarning: no processing instruction "
-                         "nodes available in "
-                         "XPath expr '%s'", 
-                         pcb->exprstr);
-                ncx_print_errormsg(pcb->tkc, 
-                                   pcb->tkerr.mod,
-                                   ERR_NCX_EMPTY_XPATH_RESULT);
-            } else if (pcb->objmod != NULL) {
-                ncx_inc_warnings(pcb->objmod);
-            }
-            break;
-        case XP_EXNT_NODE:
-            /* match any node */
-            emptyresult = FALSE;
-            break;
-        default:
-            emptyresult = TRUE;
-            res = SET_ERROR(ERR_INTERNAL_VAL);
+}  /* apply_exop */
+
+
+/***********   B E G I N    E B N F    F U N C T I O N S *************/
+
+
+/********************************************************************
+* FUNCTION apply_node_test
+* 
+* Apply a parsed XPath NodeTest to the result in progress
+* Used by parse_node_test and by the expression tree
+* evaluation, after the tokens have been checked
+*
+* INPUTS:
+*    pcb == parser control block in progress
+*    axis  == current axis from first part of Step
+*    nodetyp == node type test or XP_EXNT_NONE for a name test
+*    nsid == namespace ID of the name test (0 for any)
+*    name == local name of the name test (NULL for any)
+*    result == address of pointer to result struct in progress
+*
+* OUTPUTS:
+*   *result is modified
+*
+* RETURNS:
+*   status
+*********************************************************************/
+static status_t
+    apply_node_test (xpath_pcb_t *pcb,
+                     ncx_xpath_axis_t axis,
+                     xpath_nodetype_t nodetyp,
+                     xmlns_id_t nsid,
+                     const xmlChar *name,
+                     xpath_result_t **result)
+{
+    status_t           res;
+    boolean            emptyresult, textmode;
+
+    res = NO_ERR;
+    emptyresult = FALSE;
+    textmode = FALSE;
+
+    /* process the result based on the node type test */
+    switch (nodetyp) {
+    case XP_EXNT_NONE:
+        /* name test */
+        break;
+    case XP_EXNT_COMMENT:
+        /* no comments to match */
+        emptyresult = TRUE;
+        if (pcb->obj && 
+            pcb->logerrors && 
+            ncx_warning_enabled(ERR_NCX_EMPTY_XPATH_RESULT)) {
+            log_warn("\nWarning: no comment nodes available in "
+                     "XPath expr '%s'", 
+                     pcb->exprstr);
+            ncx_print_errormsg(pcb->tkc, 
+                               pcb->tkerr.mod,
+                               ERR_NCX_EMPTY_XPATH_RESULT);
+        } else if (pcb->objmod != NULL) {
+            ncx_inc_warnings(pcb->objmod);
         }
 
-        if (emptyresult) {
-            if (*result) {
-                free_result(pcb, *result);
-            }
-            *result = new_result(pcb, XP_RT_NODESET);
-            if (!*result) {
-                res = ERR_INTERNAL_MEM;
-            }
-            return res;
-        }  /* else go on to the text() or node() test */
+        break;
+    case XP_EXNT_TEXT:
+        /* match all leaf of leaf-list content */
+        emptyresult = FALSE;
+        textmode = TRUE;
+        break;
+    case XP_EXNT_PROC_INST:
+        /* no processing instructions to match */
+        emptyresult = TRUE;
+        if (pcb->obj && 
+            pcb->logerrors &&
+            ncx_warning_enabled(ERR_NCX_EMPTY_XPATH_RESULT)) {
+            log_warn("\nWarning: no processing instruction "
+                     "nodes available in "
+                     "XPath expr '%s'", 
+                     pcb->exprstr);
+            ncx_print_errormsg(pcb->tkc, 
+                               pcb->tkerr.mod,
+                               ERR_NCX_EMPTY_XPATH_RESULT);
+        } else if (pcb->objmod != NULL) {
+            ncx_inc_warnings(pcb->objmod);
+        }
+        break;
+    case XP_EXNT_NODE:
+        /* match any node */
+        emptyresult = FALSE;
         break;
     default:
-        /* wrong token type found */
-        res = ERR_NCX_WRONG_TKTYPE;
-        unexpected_error(pcb);
+        emptyresult = TRUE;
+        res = SET_ERROR(ERR_INTERNAL_VAL);
     }
 
-    /* do not care about result if fatal error occurred */
-    if (res != NO_ERR) {
+    if (emptyresult) {
+        if (*result) {
+            free_result(pcb, *result);
+        }
+        *result = new_result(pcb, XP_RT_NODESET);
+        if (!*result) {
+            res = ERR_INTERNAL_MEM;
+        }
         return res;
-    } else if (!pcb->val && !pcb->obj) {
+    }  /* else go on to the text(), node() or name test */
+
+    if (!pcb->val && !pcb->obj) {
         /* nothing to do in first pass except create
          * dummy result to flag that a location step
          * has already started
@@ -7133,6 +7808,162 @@ static status_t
 
     return res;
 
+}  /* apply_node_test */
+
+
+/********************************************************************
+* FUNCTION parse_node_test
+* 
+* Parse the XPath NodeTest sequence
+* It has already been tokenized
+*
+* Error messages are printed by this function!!
+* Do not duplicate error messages upon error return
+*
+* [7] NodeTest ::= NameTest
+*                  | NodeType '(' ')'
+*                  | 'processing-instruction' '(' Literal ')'
+*
+* [37] NameTest ::= '*'
+*                  | NCName ':' '*'
+*                  | QName
+*
+* [38] NodeType ::= 'comment'
+*                    | 'text'   
+*                    | 'processing-instruction'
+*                    | 'node'
+*
+* INPUTS:
+*    pcb == parser control block in progress
+*    axis  == current axis from first part of Step
+*    result == address of pointer to result struct in progress
+*
+* OUTPUTS:
+*   *result is modified
+*
+* RETURNS:
+*   status
+*********************************************************************/
+static status_t
+    parse_node_test (xpath_pcb_t *pcb,
+                     ncx_xpath_axis_t axis,
+                     xpath_result_t **result)
+{
+    const xmlChar     *name;
+    tk_type_t          nexttyp;
+    xpath_nodetype_t   nodetyp;
+    status_t           res;
+    xmlns_id_t         nsid;
+
+    nsid = 0;
+    name = NULL;
+    nodetyp = XP_EXNT_NONE;
+
+    res = TK_ADV(pcb->tkc);
+    if (res != NO_ERR) {
+        res = ERR_NCX_INVALID_XPATH_EXPR;
+        if (pcb->logerrors) {
+            log_error("\nError: token expected in XPath "
+                      "expression '%s'", pcb->exprstr);
+            ncx_print_errormsg(pcb->tkc, pcb->tkerr.mod, res);
+        } else {
+            /*** handle agent error ***/
+        }
+        return res;
+    }
+
+    /* process the tokens but not the result yet */
+    switch (TK_CUR_TYP(pcb->tkc)) {
+    case TK_TT_STAR:
+        if (pcb->flags & XP_FL_INSTANCEID) {
+            invalid_instanceid_error(pcb);
+            return ERR_NCX_INVALID_INSTANCEID;
+        }
+        break;
+    case TK_TT_NCNAME_STAR:
+        if (pcb->flags & XP_FL_INSTANCEID) {
+            invalid_instanceid_error(pcb);
+            return ERR_NCX_INVALID_INSTANCEID;
+        }
+        /* match all nodes in the namespace w/ specified prefix */
+        if (!pcb->tkc->cur->nsid) {
+            res = check_qname_prefix(pcb,
+                                     TK_CUR_VAL(pcb->tkc),
+                                     xml_strlen(TK_CUR_VAL(pcb->tkc)),
+                                     &pcb->tkc->cur->nsid);
+        }
+        if (res == NO_ERR) {
+            nsid = pcb->tkc->cur->nsid;
+        }
+        break;
+    case TK_TT_MSTRING:
+        /* match all nodes in the namespace w/ specified prefix */
+        if (!pcb->tkc->cur->nsid) {
+            res = check_qname_prefix(pcb, 
+                                     TK_CUR_MOD(pcb->tkc),
+                                     TK_CUR_MODLEN(pcb->tkc),
+                                     &pcb->tkc->cur->nsid);
+        }
+        if (res == NO_ERR) {
+            nsid = pcb->tkc->cur->nsid;
+            name = TK_CUR_VAL(pcb->tkc);
+        }
+        break;
+    case TK_TT_TSTRING:
+        /* check the ID token for a NodeType name */
+        nodetyp = get_token_nodetype_id(TK_CUR(pcb->tkc));
+        if (nodetyp == XP_EXNT_NONE ||
+            (tk_next_typ(pcb->tkc) != TK_TT_LPAREN)) {
+            nodetyp = XP_EXNT_NONE;
+            name = TK_CUR_VAL(pcb->tkc);
+            break;
+        }
+
+        /* get the node test left paren */
+        res = xpath_parse_token(pcb, TK_TT_LPAREN);
+        if (res != NO_ERR) {
+            return res;
+        }
+
+        /* check if a literal param can be present */
+        if (nodetyp == XP_EXNT_PROC_INST) {
+            /* check if a literal param is present */
+            nexttyp = tk_next_typ(pcb->tkc);
+            if (nexttyp==TK_TT_QSTRING ||
+                nexttyp==TK_TT_SQSTRING) {
+                /* temp save the literal string */
+                res = xpath_parse_token(pcb, nexttyp);
+                if (res != NO_ERR) {
+                    return res;
+                }
+            }
+        }
+
+        /* get the node test right paren */
+        res = xpath_parse_token(pcb, TK_TT_RPAREN);
+        if (res != NO_ERR) {
+            return res;
+        }
+
+        if (pcb->flags & XP_FL_INSTANCEID) {
+            invalid_instanceid_error(pcb);
+            return ERR_NCX_INVALID_INSTANCEID;
+        }
+
+        break;
+    default:
+        /* wrong token type found */
+        res = ERR_NCX_WRONG_TKTYPE;
+        unexpected_error(pcb);
+    }
+
+    /* do not care about result if fatal error occurred */
+    if (res != NO_ERR) {
+        return res;
+    }
+
+    return apply_node_test(pcb, axis, nodetyp, nsid, name, result);
+
 }  /* parse_node_test */
 
 
@@ -7169,7 +8000,6 @@ static status_t
     tk_token_t      *leftbrack;
     boolean          boo;
     status_t         res;
-    int64            position;
 
     res = xpath_parse_token(pcb, TK_TT_LBRACK);
     if (res != NO_ERR) {
@@ -7243,29 +8073,7 @@ static status_t
                     return res;
                 }
 
-                if (val1->restype == XP_RT_NUMBER) {
-                    /* the predicate specifies a context
-                     * position and this resnode is
-                     * only selected if it is the Nth
-                     * instance within the current context
-                     */
-                    if (ncx_num_is_integral(&val1->r.num,
-                                            NCX_BT_FLOAT64)) {
-                        position = 
-                            ncx_cvt_to_int64(&val1->r.num,
-                                             NCX_BT_FLOAT64);
-                        /* check if the proximity position
-                         * of this node matches the position
-                         * value from this expression
-                         */
-                        boo = (position == resnode->position) ?
-                            TRUE : FALSE;
-                    } else {
-                        boo = FALSE;
-                    }
-                } else {
-                    boo = xpath_cvt_boolean(val1);
-                }
+                boo = predicate_match(val1, resnode);
                 free_result(pcb, val1);
 
                 if (!boo) {
@@ -7375,7 +8183,6 @@ static status_t
     parse_step (xpath_pcb_t *pcb,
                 xpath_result_t **result)
 {
-    const xmlChar    *nextval;
     tk_type_t         nexttyp, nexttyp2;
     ncx_xpath_axis_t  axis;
     status_t          res;
@@ -7518,8 +8325,8 @@ static status_t
     case TK_TT_TSTRING:
         /* check the ID token for an axis name */
         nexttyp2 = tk_next_typ2(pcb->tkc);
-        nextval = tk_next_val(pcb->tkc);
-        axis = get_axis_id(nextval);
+        axis = get_token_axis_id((tk_token_t *)
+                                 dlq_nextEntry(TK_CUR(pcb->tkc)));
         if (axis != XP_AX_NONE && nexttyp2==TK_TT_DBLCOLON) {
             /* correct axis-name :: sequence */
             res = xpath_parse_token(pcb, TK_TT_TSTRING);
@@ -7573,38 +8380,1135 @@ static status_t
         }
     }
 
-    return res;
+    return res;
+
+}  /* parse_step */
+
+
+/********************************************************************
+* FUNCTION parse_location_path
+* 
+* Parse the Location-Path sequence
+* It has already been tokenized
+*
+* Error messages are printed by this function!!
+* Do not duplicate error messages upon error return
+*
+* [1] LocationPath  ::=  RelativeLocationPath        
+*                       | AbsoluteLocationPath        
+*
+* [2] AbsoluteLocationPath ::= '/' RelativeLocationPath?
+*                     | AbbreviatedAbsoluteLocationPath        
+*
+* [10] AbbreviatedAbsoluteLocationPath ::= '//' RelativeLocationPath
+*
+* [3] RelativeLocationPath ::= Step
+*                       | RelativeLocationPath '/' Step
+*                       | AbbreviatedRelativeLocationPath
+*
+* [11] AbbreviatedRelativeLocationPath ::= 
+*               RelativeLocationPath '//' Step
+*
+* INPUTS:
+*    pcb == parser control block in progress
+*    result == result struct in progress or NULL if none
+*    res == address of result status
+*
+* OUTPUTS:
+*   *res == function result status
+*
+* RETURNS:
+*   pointer to malloced result struct or NULL if no
+*   result processing in effect 
+*********************************************************************/
+static xpath_result_t *
+    parse_location_path (xpath_pcb_t *pcb,
+                         xpath_result_t *result,
+                         status_t *res)
+{
+    xpath_result_t     *val1;
+    tk_type_t           nexttyp;
+    boolean             done;
+
+    val1 = result;
+
+    done = FALSE;
+    while (!done && *res == NO_ERR) {
+        *res = parse_step(pcb, &val1);
+        if (*res == NO_ERR) {
+            nexttyp = tk_next_typ(pcb->tkc);
+            if (!(nexttyp == TK_TT_FSLASH ||
+                  nexttyp == TK_TT_DBLFSLASH)) {
+                done = TRUE;
+            }
+        }
+    }
+
+    return val1;
+
+}  /* parse_location_path */
+
+
+/********************************************************************
+* FUNCTION parse_function_call
+* 
+* Parse an XPath FunctionCall sequence
+* It has already been tokenized
+*
+* Error messages are printed by this function!!
+* Do not duplicate error messages upon error return
+*
+* [16] FunctionCall ::= FunctionName 
+*                        '(' ( Argument ( ',' Argument )* )? ')'
+* [17] Argument ::= Expr
+*
+* INPUTS:
+*    pcb == parser control block in progress
+*    res == address of result status
+*
+* OUTPUTS:
+*   *res == function result status
+*
+* RETURNS:
+*   pointer to malloced result struct or NULL if no
+*   result processing in effect 
+*********************************************************************/
+static xpath_result_t *
+    parse_function_call (xpath_pcb_t *pcb,
+                         status_t *res)
+{
+    xpath_result_t         *val1, *val2;
+    const xpath_fncb_t     *fncb;
+    dlq_hdr_t               parmQ;
+    tk_type_t               nexttyp;
+    int32                   parmcnt;
+    boolean                 done;
+
+    val1 = NULL;
+    parmcnt = 0;
+    dlq_createSQue(&parmQ);
+
+    /* get the function name */
+    *res = xpath_parse_token(pcb, TK_TT_TSTRING);
+    if (*res != NO_ERR) {
+        return NULL;
+    }
+
+    if (pcb->flags & XP_FL_INSTANCEID) {
+        invalid_instanceid_error(pcb);
+        *res = ERR_NCX_INVALID_INSTANCEID;
+        return NULL;
+    }
+
+    /* find the function in the library */
+    fncb = (const xpath_fncb_t *)TK_CUR(pcb->tkc)->xpfncb;
+    if (fncb == NULL && TK_CUR_VAL(pcb->tkc) != NULL) {
+        fncb = find_fncb(pcb, TK_CUR_VAL(pcb->tkc));
+        TK_CUR(pcb->tkc)->xpfncb = fncb;
+    }
+    if (fncb) {
+        /* get the mandatory left paren */
+        *res = xpath_parse_token(pcb, TK_TT_LPAREN);
+        if (*res != NO_ERR) {
+            return NULL;
+        }
+
+        /* get parms until a matching right paren is reached */
+        nexttyp = tk_next_typ(pcb->tkc);
+        done = (nexttyp == TK_TT_RPAREN) ? TRUE : FALSE;
+        while (!done && *res == NO_ERR) {
+            val1 = parse_expr(pcb, res);
+            if (*res == NO_ERR) {
+                parmcnt++;
+                if (val1) {
+                    dlq_enque(val1, &parmQ);
+                    val1 = NULL;
+                }
+
+                /* check for right paren or else should be comma */
+                nexttyp = tk_next_typ(pcb->tkc);
+                if (nexttyp == TK_TT_RPAREN) {
+                    done = TRUE;
+                } else {
+                    *res = xpath_parse_token(pcb, TK_TT_COMMA);
+                }
+            }
+        }
+
+        /* get closing right paren */
+        if (*res == NO_ERR) {
+            *res = xpath_parse_token(pcb, TK_TT_RPAREN);
+        }
+
+        /* check parameter count */
+        if (fncb->parmcnt >= 0 && fncb->parmcnt != parmcnt) {
+            *res = (parmcnt > fncb->parmcnt) ?
+                ERR_NCX_EXTRA_PARM : ERR_NCX_MISSING_PARM;
+
+            if (pcb->logerrors) {       
+                log_error("\nError: wrong number of "
+                          "parameters got %d, need %d"
+                          " for function '%s'",
+                          parmcnt, fncb->parmcnt,
+                          fncb->name);
+                ncx_print_errormsg(pcb->tkc, pcb->tkerr.mod, *res);
+            } else {
+                /*** log agent error ***/
+            }
+        } else {
+            val1 = call_function(pcb, fncb, &parmQ, res);
+        }
+    } else {
+        *res = ERR_NCX_UNKNOWN_PARM;
+
+        if (pcb->logerrors) {   
+            log_error("\nError: Invalid XPath function name '%s'",
+                      (TK_CUR_VAL(pcb->tkc) != NULL) ?
+                      TK_CUR_VAL(pcb->tkc) : EMPTY_STRING);
+            ncx_print_errormsg(pcb->tkc, pcb->tkerr.mod, *res);
+        } else {
+            /*** log agent error ***/
+        }
+    }
+
+    /* clean up any function parameters */
+    while (!dlq_empty(&parmQ)) {
+        val2 = (xpath_result_t *)dlq_deque(&parmQ);
+        free_result(pcb, val2);
+    }
+
+    return val1;
+
+} /* parse_function_call */
+
+
+/********************************************************************
+* FUNCTION parse_primary_expr
+* 
+* Parse an XPath PrimaryExpr sequence
+* It has already been tokenized
+*
+* Error messages are printed by this function!!
+* Do not duplicate error messages upon error return
+*
+* [15] PrimaryExpr ::= VariableReference
+*                       | '(' Expr ')'
+*                       | Literal
+*                       | Number
+*                       | FunctionCall
+*
+* INPUTS:
+*    pcb == parser control block in progress
+*    res == address of result status
+*
+* OUTPUTS:
+*   *res == function result status
+*
+* RETURNS:
+*   pointer to malloced result struct or NULL if no
+*   result processing in effect 
+*********************************************************************/
+static xpath_result_t *
+    parse_primary_expr (xpath_pcb_t *pcb,
+                        status_t *res)
+{
+    xpath_result_t         *val1;
+    tk_type_t               nexttyp;
+
+    val1 = NULL;
+    nexttyp = tk_next_typ(pcb->tkc);
+
+    switch (nexttyp) {
+    case TK_TT_VARBIND:
+    case TK_TT_QVARBIND:
+        *res = xpath_parse_token(pcb, nexttyp);
+
+        if (pcb->flags & XP_FL_INSTANCEID) {
+            invalid_instanceid_error(pcb);
+            *res = ERR_NCX_INVALID_INSTANCEID;
+            return NULL;
+        }
+
+        /* get QName or NCName variable reference
+         * but only if this get is a real one
+         */
+        if (*res == NO_ERR && pcb->val) {
+            val1 = get_varbind_result(pcb, res);
+        }
+        break;
+    case TK_TT_LPAREN:
+        /* get ( expr ) */
+        *res = xpath_parse_token(pcb, TK_TT_LPAREN);
+        if (*res == NO_ERR) {
+
+            if (pcb->flags & XP_FL_INSTANCEID) {
+                invalid_instanceid_error(pcb);
+                *res = ERR_NCX_INVALID_INSTANCEID;
+                return NULL;
+            }
+
+            val1 = parse_expr(pcb, res);
+            if (*res == NO_ERR) {
+                *res = xpath_parse_token(pcb, TK_TT_RPAREN);
+            }
+        }
+        break;
+    case TK_TT_DNUM:
+    case TK_TT_RNUM:
+        *res = xpath_parse_token(pcb, nexttyp);
+
+        if (pcb->flags & XP_FL_INSTANCEID) {
+            invalid_instanceid_error(pcb);
+            *res = ERR_NCX_INVALID_INSTANCEID;
+            return NULL;
+        }
+
+        /* get the Number token */
+        if (*res == NO_ERR) {
+            val1 = new_result(pcb, XP_RT_NUMBER);
+            if (!val1) {
+                *res = ERR_INTERNAL_MEM;
+                return NULL;
+            }
+            *res = get_number_token(pcb, &val1->r.num);
+        }
+        break;
+    case TK_TT_QSTRING:             /* double quoted string */
+    case TK_TT_SQSTRING:            /* single quoted string */
+        /* get the literal token */
+        *res = xpath_parse_token(pcb, nexttyp);
+
+        if (*res == NO_ERR) {
+            val1 = new_result(pcb, XP_RT_STRING);
+            if (!val1) {
+                *res = ERR_INTERNAL_MEM;
+                return NULL;
+            }
+
+            if (TK_CUR_VAL(pcb->tkc) != NULL) {
+                val1->r.str = xml_strdup(TK_CUR_VAL(pcb->tkc));
+            } else {
+                val1->r.str = xml_strdup(EMPTY_STRING);
+            }
+            if (!val1->r.str) {
+                *res = ERR_INTERNAL_MEM;
+                malloc_failed_error(pcb);
+                xpath_free_result(val1);
+                val1 = NULL;
+            }
+        }
+        break;
+    case TK_TT_TSTRING:                    /* NCName string */
+        /* get the string ID token */
+        nexttyp = tk_next_typ2(pcb->tkc);
+        if (nexttyp == TK_TT_LPAREN) {
+            val1 = parse_function_call(pcb, res);
+        } else {
+            *res = SET_ERROR(ERR_INTERNAL_VAL);
+        }
+        break;
+    case TK_TT_NONE:
+        /* unexpected end of token chain */
+        (void)TK_ADV(pcb->tkc);
+        *res = ERR_NCX_INVALID_XPATH_EXPR;
+        if (pcb->logerrors) {
+            log_error("\nError: token expected in XPath expression '%s'",
+                      pcb->exprstr);
+            /* hack to get correct error token to print */
+            pcb->tkc->curerr = &pcb->tkerr;
+            ncx_print_errormsg(pcb->tkc, pcb->tkerr.mod, *res);
+        } else {
+            ;  /**** log agent error ****/
+        }
+        break;
+    default:
+        /* unexpected token error */
+        (void)TK_ADV(pcb->tkc);
+        *res = ERR_NCX_WRONG_TKTYPE;
+        unexpected_error(pcb);
+    }
+
+    return val1;
+
+} /* parse_primary_expr */
+
+
+/********************************************************************
+* FUNCTION parse_filter_expr
+* 
+* Parse an XPath FilterExpr sequence
+* It has already been tokenized
+*
+* Error messages are printed by this function!!
+* Do not duplicate error messages upon error return
+*
+* [20] FilterExpr ::= PrimaryExpr       
+*                     | FilterExpr Predicate    
+*
+* INPUTS:
+*    pcb == parser control block in progress
+*    res == address of result status
+*
+* OUTPUTS:
+*   *res == function result status
+*
+* RETURNS:
+*   pointer to malloced result struct or NULL if no
+*   result processing in effect 
+*********************************************************************/
+static xpath_result_t *
+    parse_filter_expr (xpath_pcb_t *pcb,
+                       status_t *res)
+{
+    xpath_result_t  *val1, *dummy;
+    tk_type_t        nexttyp;
+
+    val1 = parse_primary_expr(pcb, res);
+    if (*res != NO_ERR) {
+        return val1;
+    }
+
+    /* peek ahead to check the possible next chars */
+    nexttyp = tk_next_typ(pcb->tkc);
+
+    if (val1) {
+        while (nexttyp == TK_TT_LBRACK && *res==NO_ERR) {
+            *res = parse_predicate(pcb, &val1);
+            nexttyp = tk_next_typ(pcb->tkc);
+        }
+    } else if (nexttyp==TK_TT_LBRACK) {
+        dummy = new_result(pcb, XP_RT_NODESET);
+        if (dummy) {
+            while (nexttyp == TK_TT_LBRACK && *res==NO_ERR) {
+                *res = parse_predicate(pcb, &dummy);
+                nexttyp = tk_next_typ(pcb->tkc);
+            }
+            free_result(pcb, dummy);
+        } else {
+            *res = ERR_INTERNAL_MEM;
+            return NULL;
+        }
+    }
+
+    return val1;
+
+} /* parse_filter_expr */
+
+
+/********************************************************************
+* FUNCTION parse_path_expr
+* 
+* Parse an XPath PathExpr sequence
+* It has already been tokenized
+*
+* Error messages are printed by this function!!
+* Do not duplicate error messages upon error return
+*
+* [19] PathExpr ::= LocationPath
+*                   | FilterExpr
+*                   | FilterExpr '/' RelativeLocationPath
+*                   | FilterExpr '//' RelativeLocationPath
+*
+* INPUTS:
+*    pcb == parser control block in progress
+*    res == address of result status
+*
+* OUTPUTS:
+*   *res == function result status
+*
+* RETURNS:
+*   pointer to malloced result struct or NULL if no
+*   result processing in effect 
+*********************************************************************/
+static xpath_result_t *
+    parse_path_expr (xpath_pcb_t *pcb,
+                     status_t *res)
+{
+    xpath_result_t  *val1, *val2;
+    tk_token_t      *nexttk;
+    tk_type_t        nexttyp, nexttyp2;
+    xpath_exop_t     curop;
+
+    val1 = NULL;
+    val2 = NULL;
+
+    /* peek ahead to check the possible next sequence */
+    nexttyp = tk_next_typ(pcb->tkc);
+    switch (nexttyp) {
+    case TK_TT_FSLASH:                /* abs location path */
+    case TK_TT_DBLFSLASH:     /* abbrev. abs location path */
+    case TK_TT_PERIOD:                      /* abbrev step */
+    case TK_TT_RANGESEP:                    /* abbrev step */
+    case TK_TT_ATSIGN:                 /* abbrev axis name */
+    case TK_TT_STAR:              /* rel, step, node, name */
+    case TK_TT_NCNAME_STAR:       /* rel, step, node, name */
+    case TK_TT_MSTRING:          /* rel, step, node, QName */
+        return parse_location_path(pcb, NULL, res);
+    case TK_TT_TSTRING:
+        /* some sort of identifier string to check
+         * get the value of the string and the following token type
+         */
+        nexttyp2 = tk_next_typ2(pcb->tkc);
+        nexttk = (tk_token_t *)dlq_nextEntry(TK_CUR(pcb->tkc));
+
+        /* check 'axis-name ::' sequence */
+        if (nexttyp2==TK_TT_DBLCOLON && get_token_axis_id(nexttk)) {
+            /* this is an axis name */
+            return parse_location_path(pcb, NULL, res);
+        }               
+
+        /* check 'NodeType (' sequence */
+        if (nexttyp2==TK_TT_LPAREN && get_token_nodetype_id(nexttk)) {
+            /* this is an nodetype name */
+            return parse_location_path(pcb, NULL, res);
+        }
+
+        /* check not a function call, so must be a QName */
+        if (nexttyp2 != TK_TT_LPAREN) {
+            /* this is an NameTest QName w/o a prefix */
+            return parse_location_path(pcb, NULL, res);
+        }
+        break;
+    default:
+        ;
+    }
+
+    /* if we get here, then a filter expression is expected */
+    val1 = parse_filter_expr(pcb, res);
+
+    if (*res == NO_ERR) {
+        nexttyp = tk_next_typ(pcb->tkc);
+        switch (nexttyp) {
+        case TK_TT_FSLASH:
+            curop = XP_EXOP_FILTER1;
+            break;
+        case TK_TT_DBLFSLASH:
+            curop = XP_EXOP_FILTER2;
+            break;
+        default:
+            curop = XP_EXOP_NONE;
+        }
+
+        if (curop != XP_EXOP_NONE) {
+            val2 = parse_location_path(pcb, val1, res);
+        } else {
+            val2 = val1;
+        }
+        val1 = NULL;
+    }
+
+    if (val1) {
+        free_result(pcb, val1);
+    }
+
+    return val2;
+
+} /* parse_path_expr */
+
+
+/********************************************************************
+* FUNCTION parse_union_expr
+* 
+* Parse an XPath UnionExpr sequence
+* It has already been tokenized
+*
+* Error messages are printed by this function!!
+* Do not duplicate error messages upon error return
+*
+* [18] UnionExpr ::= PathExpr
+*                    | UnionExpr '|' PathExpr
+*
+* INPUTS:
+*    pcb == parser control block in progress
+*    res == address of result status
+*
+* OUTPUTS:
+*   *res == function result status
+*
+* RETURNS:
+*   pointer to malloced result struct or NULL if no
+*   result processing in effect 
+*********************************************************************/
+static xpath_result_t *
+    parse_union_expr (xpath_pcb_t *pcb,
+                      status_t *res)
+{
+    xpath_result_t  *val1, *val2;
+    boolean          done;
+    tk_type_t        nexttyp;
+
+    val1 = NULL;
+    val2 = NULL;
+    done = FALSE;
+
+    while (!done && *res == NO_ERR) {
+        val1 = parse_path_expr(pcb, res);
+
+        if (*res == NO_ERR) {
+            if (val2) {
+                if (pcb->val || pcb->obj) {
+                    /* add all the nodes from val1 into val2
+                     * that are not already present
+                     */
+                    merge_nodeset(pcb, val1, val2);
+                    
+                    if (val1) {
+                        free_result(pcb, val1);
+                        val1 = NULL;
+                    }
+                }
+            } else {
+                val2 = val1;
+                val1 = NULL;
+            }
+
+            if (*res != NO_ERR) {
+                continue;
+            }
+
+            nexttyp = tk_next_typ(pcb->tkc);
+            if (nexttyp != TK_TT_BAR) {
+                done = TRUE;
+            } else {
+                *res = xpath_parse_token(pcb, TK_TT_BAR);
+                if (*res == NO_ERR) {
+                    if (pcb->flags & XP_FL_INSTANCEID) {
+                        invalid_instanceid_error(pcb);
+                        *res = ERR_NCX_INVALID_INSTANCEID;
+                    }
+                }
+            }
+        }
+    }
+
+    if (val1) {
+        free_result(pcb, val1);
+    }
+
+    return val2;
+
+} /* parse_union_expr */
+
+
+/********************************************************************
+* FUNCTION parse_unary_expr
+* 
+* Parse an XPath UnaryExpr sequence
+* It has already been tokenized
+*
+* Error messages are printed by this function!!
+* Do not duplicate error messages upon error return
+*
+* [27] UnaryExpr ::= UnionExpr  
+*                    | '-' UnaryExpr
+*
+* INPUTS:
+*    pcb == parser control block in progress
+*    res == address of result status
+*
+* OUTPUTS:
+*   *res == function result status
+*
+* RETURNS:
+*   pointer to malloced result struct or NULL if no
+*   result processing in effect 
+*********************************************************************/
+static xpath_result_t *
+    parse_unary_expr (xpath_pcb_t *pcb,
+                      status_t *res)
+{
+    xpath_result_t  *val1;
+    tk_type_t        nexttyp;
+    uint32           minuscnt;
+
+    val1 = NULL;
+    minuscnt = 0;
+
+    nexttyp = tk_next_typ(pcb->tkc);
+    while (nexttyp == TK_TT_MINUS) {
+        *res = xpath_parse_token(pcb, TK_TT_MINUS);
+        if (*res != NO_ERR) {
+            return NULL;
+        } else {
+            nexttyp = tk_next_typ(pcb->tkc);
+            minuscnt++;
+        }
+    }
+
+    val1 = parse_union_expr(pcb, res);
+
+    if (*res == NO_ERR && (minuscnt & 1)) {
+        if (pcb->val || pcb->obj) {
+            /* odd number of negate ops requested */
+            return negate_result(pcb, val1, res);
+        }
+    }
+
+    return val1;
+
+} /* parse_unary_expr */
+
+
+/********************************************************************
+* FUNCTION parse_multiplicative_expr
+* 
+* Parse an XPath MultiplicativeExpr sequence
+* It has already been tokenized
+*
+* Error messages are printed by this function!!
+* Do not duplicate error messages upon error return
+*
+* [26] MultiplicativeExpr ::= UnaryExpr 
+*              | MultiplicativeExpr MultiplyOperator UnaryExpr
+*              | MultiplicativeExpr 'div' UnaryExpr
+*              | MultiplicativeExpr 'mod' UnaryExpr
+*
+* INPUTS:
+*    pcb == parser control block in progress
+*    res == address of result status
+*
+* OUTPUTS:
+*   *res == function result status
+*
+* RETURNS:
+*   pointer to malloced result struct or NULL if no
+*   result processing in effect 
+*********************************************************************/
+static xpath_result_t *
+    parse_multiplicative_expr (xpath_pcb_t *pcb,
+                               status_t *res)
+{
+    xpath_result_t  *val1, *val2, *result;
+    xpath_exop_t     curop;
+    boolean          done;
+    tk_type_t        nexttyp;
+
+    val1 = NULL;
+    val2 = NULL;
+    result = NULL;
+    curop = XP_EXOP_NONE;
+    done = FALSE;
+
+    while (!done && *res == NO_ERR) {
+        val1 = parse_unary_expr(pcb, res);
+
+        if (*res == NO_ERR) {
+            if (val2) {
+                if (pcb->val || pcb->obj) {
+                    /* val2 holds the 1st operand
+                     * val1 holds the 2nd operand
+                     */
+                    result = apply_exop(pcb, curop, val2, val1, res);
+                }
+
+                if (val1) {
+                    free_result(pcb, val1);
+                    val1 = NULL;
+                }
+                if (val2) {
+                    free_result(pcb, val2);
+                    val2 = NULL;
+                }
+
+                if (result) {
+                    val2 = result;
+                    result = NULL;
+                }
+            } else {
+                val2 = val1;
+                val1 = NULL;
+            }
+
+            if (*res != NO_ERR) {
+                continue;
+            }
+
+            nexttyp = tk_next_typ(pcb->tkc);
+            switch (nexttyp) {
+            case TK_TT_STAR:
+                curop = XP_EXOP_MULTIPLY;
+                break;
+            case TK_TT_TSTRING:
+                if (match_next_token(pcb, TK_TT_TSTRING,
+                                     XP_OP_DIV)) {
+                    curop = XP_EXOP_DIV;
+                } else if (match_next_token(pcb, 
+                                            TK_TT_TSTRING,
+                                            XP_OP_MOD)) {
+                    curop = XP_EXOP_MOD;
+                } else {
+                    done = TRUE;
+                }
+                break;
+            default:
+                done = TRUE;
+            }
+            if (!done) {
+                *res = xpath_parse_token(pcb, nexttyp);
+                if (*res == NO_ERR) {
+                    if (pcb->flags & XP_FL_INSTANCEID) {
+                        invalid_instanceid_error(pcb);
+                        *res = ERR_NCX_INVALID_INSTANCEID;
+                    }
+                }
+            }
+        }
+    }
+
+    if (val1) {
+        free_result(pcb, val1);
+    }
+
+    return val2;
+
+} /* parse_multiplicative_expr */
+
+
+/********************************************************************
+* FUNCTION parse_additive_expr
+* 
+* Parse an XPath AdditiveExpr sequence
+* It has already been tokenized
+*
+* Error messages are printed by this function!!
+* Do not duplicate error messages upon error return
+*
+* [25] AdditiveExpr ::= MultiplicativeExpr
+*                | AdditiveExpr '+' MultiplicativeExpr
+*                | AdditiveExpr '-' MultiplicativeExpr
+*
+* INPUTS:
+*    pcb == parser control block in progress
+*    res == address of result status
+*
+* OUTPUTS:
+*   *res == function result status
+*
+* RETURNS:
+*   pointer to malloced result struct or NULL if no
+*   result processing in effect 
+*********************************************************************/
+static xpath_result_t *
+    parse_additive_expr (xpath_pcb_t *pcb,
+                           status_t *res)
+{
+    xpath_result_t  *val1, *val2, *result;
+    xpath_exop_t     curop;
+    boolean          done;
+    tk_type_t        nexttyp;
+
+    val1 = NULL;
+    val2 = NULL;
+    result = NULL;
+    curop = XP_EXOP_NONE;
+    done = FALSE;
+
+    while (!done && *res == NO_ERR) {
+        val1 = parse_multiplicative_expr(pcb, res);
+
+        if (*res == NO_ERR) {
+            if (val2) {
+                /* val2 holds the 1st operand
+                 * val1 holds the 2nd operand
+                 */
+
+                if (pcb->val || pcb->val) {
+                    result = apply_exop(pcb, curop, val2, val1, res);
+                }
+
+                if (val1) {
+                    free_result(pcb, val1);
+                    val1 = NULL;
+                }
+                if (val2) {
+                    free_result(pcb, val2);
+                    val2 = NULL;
+                }
+
+                if (result) {
+                    val2 = result;
+                    result = NULL;
+                }
+            } else {
+                val2 = val1;
+                val1 = NULL;
+            }
+
+            if (*res != NO_ERR) {
+                continue;
+            }
+
+            nexttyp = tk_next_typ(pcb->tkc);
+            switch (nexttyp) {
+            case TK_TT_PLUS:
+                curop = XP_EXOP_ADD;
+                break;
+            case TK_TT_MINUS:
+                curop = XP_EXOP_SUBTRACT;
+                break;
+            default:
+                done = TRUE;
+            }
+            if (!done) {
+                *res = xpath_parse_token(pcb, nexttyp);
+                if (*res == NO_ERR) {
+                    if (pcb->flags & XP_FL_INSTANCEID) {
+                        invalid_instanceid_error(pcb);
+                        *res = ERR_NCX_INVALID_INSTANCEID;
+                    }
+                }
+            }
+        }
+    }
+
+    if (val1) {
+        free_result(pcb, val1);
+    }
+
+    return val2;
+
+} /* parse_additive_expr */
+
+
+/********************************************************************
+* FUNCTION parse_relational_expr
+* 
+* Parse an XPath RelationalExpr sequence
+* It has already been tokenized
+*
+* Error messages are printed by this function!!
+* Do not duplicate error messages upon error return
+*
+* [24]  RelationalExpr ::= AdditiveExpr
+*             | RelationalExpr '<' AdditiveExpr
+*             | RelationalExpr '>' AdditiveExpr
+*             | RelationalExpr '<=' AdditiveExpr
+*             | RelationalExpr '>=' AdditiveExpr
+*
+* INPUTS:
+*    pcb == parser control block in progress
+*    res == address of result status
+*
+* OUTPUTS:
+*   *res == function result status
+*
+* RETURNS:
+*   pointer to malloced result struct or NULL if no
+*   result processing in effect 
+*********************************************************************/
+static xpath_result_t *
+    parse_relational_expr (xpath_pcb_t *pcb,
+                           status_t *res)
+{
+    xpath_result_t  *val1, *val2, *result;
+    xpath_exop_t     curop;
+    boolean          done;
+    tk_type_t        nexttyp;
+
+    val1 = NULL;
+    val2 = NULL;
+    result = NULL;
+    curop = XP_EXOP_NONE;
+    done = FALSE;
+
+    while (!done && *res == NO_ERR) {
+        val1 = parse_additive_expr(pcb, res);
+
+        if (*res == NO_ERR) {
+            if (val2) {
+                if (pcb->val || pcb->obj) {
+                    /* val2 holds the 1st operand
+                     * val1 holds the 2nd operand
+                     */
+                    result = apply_exop(pcb, curop, val2, val1, res);
+                }
+
+                if (val1) {
+                    free_result(pcb, val1);
+                    val1 = NULL;
+                }
+
+                if (val2) {
+                    free_result(pcb, val2);
+                    val2 = NULL;
+                }
+
+                if (result) {
+                    val2 = result;
+                    result = NULL;
+                }
+            } else {
+                val2 = val1;
+                val1 = NULL;
+            }
+
+            if (*res != NO_ERR) {
+                continue;
+            }
+
+            nexttyp = tk_next_typ(pcb->tkc);
+            switch (nexttyp) {
+            case TK_TT_LT:
+                curop = XP_EXOP_LT;
+                break;
+            case TK_TT_GT:
+                curop = XP_EXOP_GT;
+                break;
+            case TK_TT_LEQUAL:
+                curop = XP_EXOP_LEQUAL;
+                break;
+            case TK_TT_GEQUAL:
+                curop = XP_EXOP_GEQUAL;
+                break;
+            default:
+                done = TRUE;
+            }
+            if (!done) {
+                *res = xpath_parse_token(pcb, nexttyp);
+                if (*res == NO_ERR) {
+                    if (pcb->flags & XP_FL_INSTANCEID) {
+                        invalid_instanceid_error(pcb);
+                        *res = ERR_NCX_INVALID_INSTANCEID;
+                    }
+                }
+            }
+        }
+    }
+
+    if (val1) {
+        free_result(pcb, val1);
+    }
+
+    return val2;
+
+}  /* parse_relational_expr */
+
+
+/********************************************************************
+* FUNCTION parse_equality_expr
+* 
+* Parse an XPath EqualityExpr sequence
+* It has already been tokenized
+*
+* Error messages are printed by this function!!
+* Do not duplicate error messages upon error return
+*
+* [23] EqualityExpr  ::=   RelationalExpr        
+*                | EqualityExpr '=' RelationalExpr        
+*                | EqualityExpr '!=' RelationalExpr        
+*
+* INPUTS:
+*    pcb == parser control block in progress
+*    res == address of result status
+*
+* OUTPUTS:
+*   *res == function result status
+*
+* RETURNS:
+*   pointer to malloced result struct or NULL if no
+*   result processing in effect 
+*********************************************************************/
+static xpath_result_t *
+    parse_equality_expr (xpath_pcb_t *pcb,
+                         status_t *res)
+{
+    xpath_result_t  *val1, *val2, *result;
+    xpath_exop_t     curop;
+    boolean          done, equalsdone;
+
+    val1 = NULL;
+    val2 = NULL;
+    result = NULL;
+    curop = XP_EXOP_NONE;
+    equalsdone = FALSE;
+    done = FALSE;
+
+    while (!done && *res == NO_ERR) {
+        val1 = parse_relational_expr(pcb, res);
+
+        if (*res == NO_ERR) {
+            if (val2) {
+                if (pcb->val || pcb->obj) {
+                    /* val2 holds the 1st operand
+                     * val1 holds the 2nd operand
+                     */
+                    result = apply_exop(pcb, curop, val2, val1, res);
+                }
+
+                if (val1) {
+                    free_result(pcb, val1);
+                    val1 = NULL;
+                }
+
+                if (val2) {
+                    free_result(pcb, val2);
+                    val2 = NULL;
+                }
+
+                if (result) {
+                    val2 = result;
+                    result = NULL;
+                }
+            } else {
+                val2 = val1;
+                val1 = NULL;
+            }
+
+            if (*res != NO_ERR) {
+                continue;
+            }
+
+            if (match_next_token(pcb, TK_TT_EQUAL, NULL)) {
+                *res = xpath_parse_token(pcb, TK_TT_EQUAL);
+                if (*res == NO_ERR) {
+                    if (equalsdone) {
+                        if (pcb->flags & XP_FL_INSTANCEID) {
+                            invalid_instanceid_error(pcb);
+                            *res = ERR_NCX_INVALID_INSTANCEID;
+                        }
+                    } else {
+                        equalsdone = TRUE;
+                    }
+                }
+                curop = XP_EXOP_EQUAL;
+            } else if (match_next_token(pcb, TK_TT_NOTEQUAL, NULL)) {
+                *res = xpath_parse_token(pcb, TK_TT_NOTEQUAL);
+                if (*res == NO_ERR) {
+                    if (pcb->flags & XP_FL_INSTANCEID) {
+                        invalid_instanceid_error(pcb);
+                        *res = ERR_NCX_INVALID_INSTANCEID;
+                    }
+                }
+                curop = XP_EXOP_NOTEQUAL;
+            } else {
+                done = TRUE;
+            }
+        }
+    }
+
+    if (val1) {
+        free_result(pcb, val1);
+    }
+
+    return val2;
 
-}  /* parse_step */
+}  /* parse_equality_expr */
 
 
 /********************************************************************
-* FUNCTION parse_location_path
+* FUNCTION parse_and_expr
 * 
-* Parse the Location-Path sequence
+* Parse an XPath AndExpr sequence
 * It has already been tokenized
 *
 * Error messages are printed by this function!!
 * Do not duplicate error messages upon error return
 *
-* [1] LocationPath  ::=  RelativeLocationPath        
-*                       | AbsoluteLocationPath        
-*
-* [2] AbsoluteLocationPath ::= '/' RelativeLocationPath?
-*                     | AbbreviatedAbsoluteLocationPath        
-*
-* [10] AbbreviatedAbsoluteLocationPath ::= '//' RelativeLocationPath
-*
-* [3] RelativeLocationPath ::= Step
-*                       | RelativeLocationPath '/' Step
-*                       | AbbreviatedRelativeLocationPath
-*
-* [11] AbbreviatedRelativeLocationPath ::= 
-*               RelativeLocationPath '//' Step
+* [22] AndExpr  ::= EqualityExpr
+*                   | AndExpr 'and' EqualityExpr
 *
 * INPUTS:
 *    pcb == parser control block in progress
-*    result == result struct in progress or NULL if none
 *    res == address of result status
 *
 * OUTPUTS:
@@ -7615,45 +9519,80 @@ static status_t
 *   result processing in effect 
 *********************************************************************/
 static xpath_result_t *
-    parse_location_path (xpath_pcb_t *pcb,
-                         xpath_result_t *result,
-                         status_t *res)
+    parse_and_expr (xpath_pcb_t *pcb,
+                    status_t *res)
 {
-    xpath_result_t     *val1;
-    tk_type_t           nexttyp;
-    boolean             done;
-
-    val1 = result;
+    xpath_result_t  *val1, *val2, *result;
+    boolean          done;
 
+    val1 = NULL;
+    val2 = NULL;
+    result = NULL;
     done = FALSE;
+
     while (!done && *res == NO_ERR) {
-        *res = parse_step(pcb, &val1);
+        val1 = parse_equality_expr(pcb, res);
+
         if (*res == NO_ERR) {
-            nexttyp = tk_next_typ(pcb->tkc);
-            if (!(nexttyp == TK_TT_FSLASH ||
-                  nexttyp == TK_TT_DBLFSLASH)) {
+            if (val2) {
+                if (pcb->val || pcb->obj) {
+                    /* val2 holds the 1st operand
+                     * val1 holds the 2nd operand
+                     */
+                    result = apply_exop(pcb, XP_EXOP_AND, val2, val1, res);
+                }
+
+                if (val1) {
+                    free_result(pcb, val1);
+                    val1 = NULL;
+                }
+
+                if (val2) {
+                    free_result(pcb, val2);
+                    val2 = NULL;
+                }
+
+                if (result) {
+                    val2 = result;
+                    result = NULL;
+                }
+            } else {
+                val2 = val1;
+                val1 = NULL;
+            }
+
+            if (*res != NO_ERR) {
+                continue;
+            }
+
+            if (match_next_token(pcb, TK_TT_TSTRING, XP_OP_AND)) {
+                *res = xpath_parse_token(pcb, TK_TT_TSTRING);
+            } else {
                 done = TRUE;
             }
         }
     }
 
-    return val1;
+    if (val1) {
+        free_result(pcb, val1);
+    }
 
-}  /* parse_location_path */
+    return val2;
+
+}  /* parse_and_expr */
 
 
 /********************************************************************
-* FUNCTION parse_function_call
+* FUNCTION parse_or_expr
 * 
-* Parse an XPath FunctionCall sequence
+* Parse an XPath OrExpr sequence
 * It has already been tokenized
 *
 * Error messages are printed by this function!!
 * Do not duplicate error messages upon error return
 *
-* [16] FunctionCall ::= FunctionName 
-*                        '(' ( Argument ( ',' Argument )* )? ')'
-* [17] Argument ::= Expr
+* [21] OrExpr ::= AndExpr        
+*                 | OrExpr 'or' AndExpr
 *
 * INPUTS:
 *    pcb == parser control block in progress
@@ -7667,509 +9606,484 @@ static xpath_result_t *
 *   result processing in effect 
 *********************************************************************/
 static xpath_result_t *
-    parse_function_call (xpath_pcb_t *pcb,
-                         status_t *res)
+    parse_or_expr (xpath_pcb_t *pcb,
+                   status_t *res)
 {
-    xpath_result_t         *val1, *val2;
-    const xpath_fncb_t     *fncb;
-    dlq_hdr_t               parmQ;
-    tk_type_t               nexttyp;
-    int32                   parmcnt;
-    boolean                 done;
+    xpath_result_t  *val1, *val2, *result;
+    boolean          done;
 
     val1 = NULL;
-    parmcnt = 0;
-    dlq_createSQue(&parmQ);
-
-    /* get the function name */
-    *res = xpath_parse_token(pcb, TK_TT_TSTRING);
-    if (*res != NO_ERR) {
-        return NULL;
-    }
-
-    if (pcb->flags & XP_FL_INSTANCEID) {
-        invalid_instanceid_error(pcb);
-        *res = ERR_NCX_INVALID_INSTANCEID;
-        return NULL;
-    }
+    val2 = NULL;
+    result = NULL;
+    done = FALSE;
 
-    /* find the function in the library */
-    fncb = NULL;
-    if (TK_CUR_VAL(pcb->tkc) != NULL) {
-        fncb = find_fncb(pcb, TK_CUR_VAL(pcb->tkc));
-    }
-    if (fncb) {
-        /* get the mandatory left paren */
-        *res = xpath_parse_token(pcb, TK_TT_LPAREN);
-        if (*res != NO_ERR) {
-            return NULL;
-        }
+    while (!done && *res == NO_ERR) {
+        val1 = parse_and_expr(pcb, res);
 
-        /* get parms until a matching right paren is reached */
-        nexttyp = tk_next_typ(pcb->tkc);
-        done = (nexttyp == TK_TT_RPAREN) ? TRUE : FALSE;
-        while (!done && *res == NO_ERR) {
-            val1 = parse_expr(pcb, res);
-            if (*res == NO_ERR) {
-                parmcnt++;
+        if (*res == NO_ERR) {
+            if (val2) {
+                if (pcb->val || pcb->obj) {
+                    /* val2 holds the 1st operand
+                     * val1 holds the 2nd operand
+                     */
+                    result = apply_exop(pcb, XP_EXOP_OR, val2, val1, res);
+                }
+                    
                 if (val1) {
-                    dlq_enque(val1, &parmQ);
+                    free_result(pcb, val1);
                     val1 = NULL;
                 }
 
-                /* check for right paren or else should be comma */
-                nexttyp = tk_next_typ(pcb->tkc);
-                if (nexttyp == TK_TT_RPAREN) {
-                    done = TRUE;
-                } else {
-                    *res = xpath_parse_token(pcb, TK_TT_COMMA);
+                if (val2) {
+                    free_result(pcb, val2);
+                    val2 = NULL;
                 }
-            }
-        }
-
-        /* get closing right paren */
-        if (*res == NO_ERR) {
-            *res = xpath_parse_token(pcb, TK_TT_RPAREN);
-        }
-
-        /* check parameter count */
-        if (fncb->parmcnt >= 0 && fncb->parmcnt != parmcnt) {
-            *res = (parmcnt > fncb->parmcnt) ?
-                ERR_NCX_EXTRA_PARM : ERR_NCX_MISSING_PARM;
 
-            if (pcb->logerrors) {       
-                log_error("\nError: wrong number of "
-                          "parameters got %d, need %d"
-                          " for function '%s'",
-                          parmcnt, fncb->parmcnt,
-                          fncb->name);
-                ncx_print_errormsg(pcb->tkc, pcb->tkerr.mod, *res);
+                if (result) {
+                    val2 = result;
+                    result = NULL;
+                }
             } else {
-                /*** log agent error ***/
+                val2 = val1;
+                val1 = NULL;
             }
-        } else {
-            /* make the function call */
-            val1 = (*fncb->fn)(pcb, &parmQ, res);
 
-            if (LOGDEBUG3) {
-                if (val1) {
-                    log_debug3("\nXPath fn %s result:",
-                               fncb->name);
-                    dump_result(pcb, val1, NULL);
-                    if (pcb->val && pcb->context.node.valptr->name) {
-                        log_debug3("\nXPath context val name: %s",
-                                   pcb->context.node.valptr->name);
-                    }
-                }
+            if (*res != NO_ERR) {
+                continue;
             }
-        }
-    } else {
-        *res = ERR_NCX_UNKNOWN_PARM;
 
-        if (pcb->logerrors) {   
-            log_error("\nError: Invalid XPath function name '%s'",
-                      (TK_CUR_VAL(pcb->tkc) != NULL) ?
-                      TK_CUR_VAL(pcb->tkc) : EMPTY_STRING);
-            ncx_print_errormsg(pcb->tkc, pcb->tkerr.mod, *res);
-        } else {
-            /*** log agent error ***/
+            if (match_next_token(pcb, TK_TT_TSTRING, XP_OP_OR)) {
+                *res = xpath_parse_token(pcb, TK_TT_TSTRING);
+            } else {
+                done = TRUE;
+            }
         }
     }
 
-    /* clean up any function parameters */
-    while (!dlq_empty(&parmQ)) {
-        val2 = (xpath_result_t *)dlq_deque(&parmQ);
-        free_result(pcb, val2);
+    if (val1) {
+        free_result(pcb, val1);
     }
 
-    return val1;
+    return val2;
+
+}  /* parse_or_expr */
+
+
+/********************************************************************
+* FUNCTION parse_expr
+* 
+* Parse an XPath Expr sequence
+* It has already been tokenized
+*
+* Error messages are printed by this function!!
+* Do not duplicate error messages upon error return
+*
+* [14] Expr ::= OrExpr
+*
+* INPUTS:
+*    pcb == parser control block in progress
+*    res == address of result status
+*
+* OUTPUTS:
+*   *res == function result status
+*
+* RETURNS:
+*   pointer to malloced result struct or NULL if no
+*   result processing in effect 
+*********************************************************************/
+static xpath_result_t *
+    parse_expr (xpath_pcb_t *pcb,
+                status_t  *res)
+{
+
+    return parse_or_expr(pcb, res);
+
+}  /* parse_expr */
+
 
-} /* parse_function_call */
+/*********   E X P R E S S I O N    T R E E    F U N C T I O N S ****/
 
 
 /********************************************************************
-* FUNCTION parse_primary_expr
+* FUNCTION new_expr_node
 * 
-* Parse an XPath PrimaryExpr sequence
-* It has already been tokenized
-*
-* Error messages are printed by this function!!
-* Do not duplicate error messages upon error return
-*
-* [15] PrimaryExpr ::= VariableReference
-*                       | '(' Expr ')'
-*                       | Literal
-*                       | Number
-*                       | FunctionCall
+* Create an expression tree node for the current token
 *
 * INPUTS:
 *    pcb == parser control block in progress
+*    extyp == node type
 *    res == address of result status
 *
 * OUTPUTS:
-*   *res == function result status
+*   *res == ERR_INTERNAL_MEM if malloc failed
 *
 * RETURNS:
-*   pointer to malloced result struct or NULL if no
-*   result processing in effect 
+*   malloced node or NULL if malloc error
 *********************************************************************/
-static xpath_result_t *
-    parse_primary_expr (xpath_pcb_t *pcb,
-                        status_t *res)
+static xpath_expr_t *
+    new_expr_node (xpath_pcb_t *pcb,
+                   xpath_extyp_t extyp,
+                   status_t *res)
 {
-    xpath_result_t         *val1;
-    ncx_var_t              *varbind;
-    const xmlChar          *errstr;
-    tk_type_t               nexttyp;
-    ncx_numfmt_t            numfmt;
+    xpath_expr_t  *expr;
 
-    val1 = NULL;
-    nexttyp = tk_next_typ(pcb->tkc);
+    expr = xpath_new_expr(extyp);
+    if (!expr) {
+        *res = ERR_INTERNAL_MEM;
+        return NULL;
+    }
+    expr->tk = TK_CUR(pcb->tkc);
+    return expr;
 
-    switch (nexttyp) {
-    case TK_TT_VARBIND:
-    case TK_TT_QVARBIND:
-        *res = xpath_parse_token(pcb, nexttyp);
+}  /* new_expr_node */
 
-        if (pcb->flags & XP_FL_INSTANCEID) {
-            invalid_instanceid_error(pcb);
-            *res = ERR_NCX_INVALID_INSTANCEID;
-            return NULL;
-        }
 
-        /* get QName or NCName variable reference
-         * but only if this get is a real one
-         */
-        if (*res == NO_ERR && pcb->val) {
-            if (TK_CUR_TYP(pcb->tkc) == TK_TT_VARBIND) {
-                varbind = get_varbind(pcb, 
-                                      NULL, 
-                                      0, 
-                                      TK_CUR_VAL(pcb->tkc), res);
-                errstr = TK_CUR_VAL(pcb->tkc);
-            } else {
-                varbind = get_varbind(pcb, 
-                                      TK_CUR_MOD(pcb->tkc),
-                                      TK_CUR_MODLEN(pcb->tkc), 
-                                      TK_CUR_VAL(pcb->tkc), res);
-                errstr = TK_CUR_MOD(pcb->tkc);
-            }
-            if (!varbind || *res != NO_ERR) {
-                if (pcb->logerrors) {
-                    if (*res == ERR_NCX_DEF_NOT_FOUND) {
-                        log_error("\nError: unknown variable binding '%s'",
-                                  errstr);
-                        ncx_print_errormsg(pcb->tkc, pcb->tkerr.mod, *res);
-                    } else {
-                        log_error("\nError: error in variable binding '%s'",
-                                  errstr);
-                        ncx_print_errormsg(pcb->tkc, pcb->tkerr.mod, *res);
-                    }
-                }
-            } else {
-                /* OK: found the variable binding */
-                val1 = cvt_from_value(pcb, varbind->val);
-                if (!val1) {
-                    *res = ERR_INTERNAL_MEM;
-                }
-            }
+/********************************************************************
+* FUNCTION get_next_exop
+* 
+* Check if the next token is a binary operator
+* of the specified precedence level
+*
+* INPUTS:
+*    pcb == parser control block in progress
+*    level == EXPR_LEVEL_OR .. EXPR_LEVEL_MULTIPLICATIVE
+*
+* RETURNS:
+*   operator or XP_EXOP_NONE if the next token is not
+*   an operator of this level
+*********************************************************************/
+static xpath_exop_t
+    get_next_exop (xpath_pcb_t *pcb,
+                   uint32 level)
+{
+    switch (level) {
+    case EXPR_LEVEL_OR:
+        if (match_next_token(pcb, TK_TT_TSTRING, XP_OP_OR)) {
+            return XP_EXOP_OR;
         }
         break;
-    case TK_TT_LPAREN:
-        /* get ( expr ) */
-        *res = xpath_parse_token(pcb, TK_TT_LPAREN);
-        if (*res == NO_ERR) {
-
-            if (pcb->flags & XP_FL_INSTANCEID) {
-                invalid_instanceid_error(pcb);
-                *res = ERR_NCX_INVALID_INSTANCEID;
-                return NULL;
-            }
-
-            val1 = parse_expr(pcb, res);
-            if (*res == NO_ERR) {
-                *res = xpath_parse_token(pcb, TK_TT_RPAREN);
-            }
+    case EXPR_LEVEL_AND:
+        if (match_next_token(pcb, TK_TT_TSTRING, XP_OP_AND)) {
+            return XP_EXOP_AND;
         }
         break;
-    case TK_TT_DNUM:
-    case TK_TT_RNUM:
-        *res = xpath_parse_token(pcb, nexttyp);
-
-        if (pcb->flags & XP_FL_INSTANCEID) {
-            invalid_instanceid_error(pcb);
-            *res = ERR_NCX_INVALID_INSTANCEID;
-            return NULL;
+    case EXPR_LEVEL_EQUALITY:
+        switch (tk_next_typ(pcb->tkc)) {
+        case TK_TT_EQUAL:
+            return XP_EXOP_EQUAL;
+        case TK_TT_NOTEQUAL:
+            return XP_EXOP_NOTEQUAL;
+        default:
+            ;
         }
-
-        /* get the Number token */
-        if (*res == NO_ERR) {
-            val1 = new_result(pcb, XP_RT_NUMBER);
-            if (!val1) {
-                *res = ERR_INTERNAL_MEM;
-                return NULL;
-            }
-
-            numfmt = ncx_get_numfmt(TK_CUR_VAL(pcb->tkc));
-            if (numfmt == NCX_NF_OCTAL) {
-                numfmt = NCX_NF_DEC;
-            }
-            if (numfmt == NCX_NF_DEC || numfmt == NCX_NF_REAL) {
-                *res = ncx_convert_num(TK_CUR_VAL(pcb->tkc),
-                                       numfmt,
-                                       NCX_BT_FLOAT64,
-                                       &val1->r.num);
-            } else if (numfmt == NCX_NF_NONE) {
-                *res = ERR_NCX_INVALID_VALUE;
-            } else {
-                *res = ERR_NCX_WRONG_NUMTYP;
-            }
+        break;
+    case EXPR_LEVEL_RELATIONAL:
+        switch (tk_next_typ(pcb->tkc)) {
+        case TK_TT_LT:
+            return XP_EXOP_LT;
+        case TK_TT_GT:
+            return XP_EXOP_GT;
+        case TK_TT_LEQUAL:
+            return XP_EXOP_LEQUAL;
+        case TK_TT_GEQUAL:
+            return XP_EXOP_GEQUAL;
+        default:
+            ;
         }
         break;
-    case TK_TT_QSTRING:             /* double quoted string */
-    case TK_TT_SQSTRING:            /* single quoted string */
-        /* get the literal token */
-        *res = xpath_parse_token(pcb, nexttyp);
+    case EXPR_LEVEL_ADDITIVE:
+        switch (tk_next_typ(pcb->tkc)) {
+        case TK_TT_PLUS:
+            return XP_EXOP_ADD;
+        case TK_TT_MINUS:
+            return XP_EXOP_SUBTRACT;
+        default:
+            ;
+        }
+        break;
+    case EXPR_LEVEL_MULTIPLICATIVE:
+        if (tk_next_typ(pcb->tkc) == TK_TT_STAR) {
+            return XP_EXOP_MULTIPLY;
+        } else if (match_next_token(pcb, TK_TT_TSTRING, XP_OP_DIV)) {
+            return XP_EXOP_DIV;
+        } else if (match_next_token(pcb, TK_TT_TSTRING, XP_OP_MOD)) {
+            return XP_EXOP_MOD;
+        }
+        break;
+    default:
+        SET_ERROR(ERR_INTERNAL_VAL);
+    }
+    return XP_EXOP_NONE;
 
-        if (*res == NO_ERR) {
-            val1 = new_result(pcb, XP_RT_STRING);
-            if (!val1) {
-                *res = ERR_INTERNAL_MEM;
-                return NULL;
-            }
+}  /* get_next_exop */
 
-            if (TK_CUR_VAL(pcb->tkc) != NULL) {
-                val1->r.str = xml_strdup(TK_CUR_VAL(pcb->tkc));
-            } else {
-                val1->r.str = xml_strdup(EMPTY_STRING);
-            }
-            if (!val1->r.str) {
-                *res = ERR_INTERNAL_MEM;
-                malloc_failed_error(pcb);
-                xpath_free_result(val1);
-                val1 = NULL;
-            }
+
+/********************************************************************
+* FUNCTION compile_node_test
+* 
+* Compile the XPath NodeTest sequence into a step node
+* Follows parse_node_test
+*
+* INPUTS:
+*    pcb == parser control block in progress
+*    step == XP_EXTYP_STEP node to fill in
+*
+* RETURNS:
+*   status
+*********************************************************************/
+static status_t
+    compile_node_test (xpath_pcb_t *pcb,
+                       xpath_expr_t *step)
+{
+    tk_type_t   nexttyp;
+    status_t    res;
+
+    res = TK_ADV(pcb->tkc);
+    if (res != NO_ERR) {
+        return ERR_NCX_INVALID_XPATH_EXPR;
+    }
+    step->tk = TK_CUR(pcb->tkc);
+
+    switch (TK_CUR_TYP(pcb->tkc)) {
+    case TK_TT_STAR:
+        break;
+    case TK_TT_NCNAME_STAR:
+        if (!pcb->tkc->cur->nsid) {
+            res = check_qname_prefix(pcb,
+                                     TK_CUR_VAL(pcb->tkc),
+                                     xml_strlen(TK_CUR_VAL(pcb->tkc)),
+                                     &pcb->tkc->cur->nsid);
         }
+        step->nsid = pcb->tkc->cur->nsid;
         break;
-    case TK_TT_TSTRING:                    /* NCName string */
-        /* get the string ID token */
-        nexttyp = tk_next_typ2(pcb->tkc);
-        if (nexttyp == TK_TT_LPAREN) {
-            val1 = parse_function_call(pcb, res);
-        } else {
-            *res = SET_ERROR(ERR_INTERNAL_VAL);
+    case TK_TT_MSTRING:
+        if (!pcb->tkc->cur->nsid) {
+            res = check_qname_prefix(pcb, 
+                                     TK_CUR_MOD(pcb->tkc),
+                                     TK_CUR_MODLEN(pcb->tkc),
+                                     &pcb->tkc->cur->nsid);
         }
+        step->nsid = pcb->tkc->cur->nsid;
+        step->name = TK_CUR_VAL(pcb->tkc);
         break;
-    case TK_TT_NONE:
-        /* unexpected end of token chain */
-        (void)TK_ADV(pcb->tkc);
-        *res = ERR_NCX_INVALID_XPATH_EXPR;
-        if (pcb->logerrors) {
-            log_error("\nError: token expected in XPath expression '%s'",
-                      pcb->exprstr);
-            /* hack to get correct error token to print */
-            pcb->tkc->curerr = &pcb->tkerr;
-            ncx_print_errormsg(pcb->tkc, pcb->tkerr.mod, *res);
-        } else {
-            ;  /**** log agent error ****/
+    case TK_TT_TSTRING:
+        step->nodetyp = get_token_nodetype_id(TK_CUR(pcb->tkc));
+        if (step->nodetyp == XP_EXNT_NONE ||
+            (tk_next_typ(pcb->tkc) != TK_TT_LPAREN)) {
+            step->nodetyp = XP_EXNT_NONE;
+            step->name = TK_CUR_VAL(pcb->tkc);
+            break;
+        }
+
+        res = xpath_parse_token(pcb, TK_TT_LPAREN);
+        if (res == NO_ERR && step->nodetyp == XP_EXNT_PROC_INST) {
+            nexttyp = tk_next_typ(pcb->tkc);
+            if (nexttyp==TK_TT_QSTRING ||
+                nexttyp==TK_TT_SQSTRING) {
+                res = xpath_parse_token(pcb, nexttyp);
+            }
+        }
+        if (res == NO_ERR) {
+            res = xpath_parse_token(pcb, TK_TT_RPAREN);
         }
         break;
     default:
-        /* unexpected token error */
-        (void)TK_ADV(pcb->tkc);
-        *res = ERR_NCX_WRONG_TKTYPE;
-        unexpected_error(pcb);
+        res = ERR_NCX_WRONG_TKTYPE;
     }
 
-    return val1;
+    return res;
 
-} /* parse_primary_expr */
+}  /* compile_node_test */
 
 
 /********************************************************************
-* FUNCTION parse_filter_expr
+* FUNCTION compile_step
 * 
-* Parse an XPath FilterExpr sequence
-* It has already been tokenized
-*
-* Error messages are printed by this function!!
-* Do not duplicate error messages upon error return
-*
-* [20] FilterExpr ::= PrimaryExpr       
-*                     | FilterExpr Predicate    
+* Compile the XPath Step sequence, with the '/' or '//'
+* before it, into a step node
+* Follows parse_step
 *
 * INPUTS:
 *    pcb == parser control block in progress
+*    first == TRUE if this is the first step of a location path
+*             that does not start with a FilterExpr
 *    res == address of result status
 *
 * OUTPUTS:
 *   *res == function result status
 *
 * RETURNS:
-*   pointer to malloced result struct or NULL if no
-*   result processing in effect 
+*   malloced step node or NULL if error
 *********************************************************************/
-static xpath_result_t *
-    parse_filter_expr (xpath_pcb_t *pcb,
-                       status_t *res)
+static xpath_expr_t *
+    compile_step (xpath_pcb_t *pcb,
+                  boolean first,
+                  status_t *res)
 {
-    xpath_result_t  *val1, *dummy;
-    tk_type_t        nexttyp;
+    xpath_expr_t      *step, *pred;
+    tk_type_t          nexttyp;
+    xpath_exop_t       exop;
+    ncx_xpath_axis_t   axis;
 
-    val1 = parse_primary_expr(pcb, res);
+    exop = XP_EXOP_NONE;
+    axis = XP_AX_CHILD;
+
+    /* check start token '/' or '//' */
+    nexttyp = tk_next_typ(pcb->tkc);
+    if (nexttyp == TK_TT_DBLFSLASH) {
+        *res = xpath_parse_token(pcb, TK_TT_DBLFSLASH);
+        exop = XP_EXOP_FILTER2;
+    } else if (nexttyp == TK_TT_FSLASH) {
+        *res = xpath_parse_token(pcb, TK_TT_FSLASH);
+        exop = XP_EXOP_FILTER1;
+        if (*res == NO_ERR && first && location_path_end(pcb)) {
+            /* exprstr is simply docroot '/' */
+            step = new_expr_node(pcb, XP_EXTYP_ROOT, res);
+            if (step) {
+                step->exop = exop;
+            }
+            return step;
+        }
+    }
+    if (*res != NO_ERR) {
+        return NULL;
+    }
+
+    /* handle an abbreviated step (. or ..) or
+     * the axis-specifier for the full form step
+     */
+    nexttyp = tk_next_typ(pcb->tkc);
+    switch (nexttyp) {
+    case TK_TT_PERIOD:
+    case TK_TT_RANGESEP:
+        *res = xpath_parse_token(pcb, nexttyp);
+        if (*res != NO_ERR) {
+            return NULL;
+        }
+        step = new_expr_node(pcb, 
+                             (nexttyp == TK_TT_PERIOD) ?
+                             XP_EXTYP_SELF : XP_EXTYP_PARENT,
+                             res);
+        if (step) {
+            step->exop = exop;
+        }
+        return step;
+    case TK_TT_ATSIGN:
+        axis = XP_AX_ATTRIBUTE;
+        *res = xpath_parse_token(pcb, TK_TT_ATSIGN);
+        break;
+    case TK_TT_STAR:
+    case TK_TT_NCNAME_STAR:
+    case TK_TT_MSTRING:
+        break;
+    case TK_TT_TSTRING:
+        if (tk_next_typ2(pcb->tkc) == TK_TT_DBLCOLON) {
+            axis = get_token_axis_id((tk_token_t *)
+                                     dlq_nextEntry(TK_CUR(pcb->tkc)));
+            if (axis == XP_AX_NONE) {
+                *res = ERR_NCX_INVALID_XPATH_EXPR;
+            } else {
+                *res = xpath_parse_token(pcb, TK_TT_TSTRING);
+                if (*res == NO_ERR) {
+                    *res = xpath_parse_token(pcb, TK_TT_DBLCOLON);
+                }
+            }
+        }
+        break;
+    default:
+        *res = ERR_NCX_WRONG_TKTYPE;
+    }
     if (*res != NO_ERR) {
-        return val1;
+        return NULL;
     }
 
-    /* peek ahead to check the possible next chars */
-    nexttyp = tk_next_typ(pcb->tkc);
+    step = new_expr_node(pcb, XP_EXTYP_STEP, res);
+    if (!step) {
+        return NULL;
+    }
+    step->exop = exop;
+    step->axis = axis;
 
-    if (val1) {
-        while (nexttyp == TK_TT_LBRACK && *res==NO_ERR) {
-            *res = parse_predicate(pcb, &val1);
-            nexttyp = tk_next_typ(pcb->tkc);
+    *res = compile_node_test(pcb, step);
+
+    while (*res == NO_ERR && tk_next_typ(pcb->tkc) == TK_TT_LBRACK) {
+        *res = xpath_parse_token(pcb, TK_TT_LBRACK);
+        if (*res != NO_ERR) {
+            break;
         }
-    } else if (nexttyp==TK_TT_LBRACK) {
-        dummy = new_result(pcb, XP_RT_NODESET);
-        if (dummy) {
-            while (nexttyp == TK_TT_LBRACK && *res==NO_ERR) {
-                *res = parse_predicate(pcb, &dummy);
-                nexttyp = tk_next_typ(pcb->tkc);
-            }
-            free_result(pcb, dummy);
-        } else {
-            *res = ERR_INTERNAL_MEM;
-            return NULL;
+        pred = compile_expr(pcb, res);
+        if (!pred) {
+            break;
         }
+        dlq_enque(pred, &step->exprQ);
+        *res = xpath_parse_token(pcb, TK_TT_RBRACK);
     }
 
-    return val1;
+    if (*res != NO_ERR) {
+        xpath_free_expr(step);
+        return NULL;
+    }
+    return step;
 
-} /* parse_filter_expr */
+}  /* compile_step */
 
 
 /********************************************************************
-* FUNCTION parse_path_expr
+* FUNCTION compile_location_path
 * 
-* Parse an XPath PathExpr sequence
-* It has already been tokenized
-*
-* Error messages are printed by this function!!
-* Do not duplicate error messages upon error return
-*
-* [19] PathExpr ::= LocationPath
-*                   | FilterExpr
-*                   | FilterExpr '/' RelativeLocationPath
-*                   | FilterExpr '//' RelativeLocationPath
+* Compile the Location-Path sequence into a path node
+* Follows parse_location_path
 *
 * INPUTS:
 *    pcb == parser control block in progress
+*    filter == FilterExpr node the path starts with, or NULL;
+*              freed by this function if an error occurs
 *    res == address of result status
 *
 * OUTPUTS:
 *   *res == function result status
 *
 * RETURNS:
-*   pointer to malloced result struct or NULL if no
-*   result processing in effect 
+*   malloced path node or NULL if error
 *********************************************************************/
-static xpath_result_t *
-    parse_path_expr (xpath_pcb_t *pcb,
-                     status_t *res)
+static xpath_expr_t *
+    compile_location_path (xpath_pcb_t *pcb,
+                           xpath_expr_t *filter,
+                           status_t *res)
 {
-    xpath_result_t  *val1, *val2;
-    const xmlChar   *nextval;
-    tk_type_t        nexttyp, nexttyp2;
-    xpath_exop_t     curop;
-
-    val1 = NULL;
-    val2 = NULL;
-
-    /* peek ahead to check the possible next sequence */
-    nexttyp = tk_next_typ(pcb->tkc);
-    switch (nexttyp) {
-    case TK_TT_FSLASH:                /* abs location path */
-    case TK_TT_DBLFSLASH:     /* abbrev. abs location path */
-    case TK_TT_PERIOD:                      /* abbrev step */
-    case TK_TT_RANGESEP:                    /* abbrev step */
-    case TK_TT_ATSIGN:                 /* abbrev axis name */
-    case TK_TT_STAR:              /* rel, step, node, name */
-    case TK_TT_NCNAME_STAR:       /* rel, step, node, name */
-    case TK_TT_MSTRING:          /* rel, step, node, QName */
-        return parse_location_path(pcb, NULL, res);
-    case TK_TT_TSTRING:
-        /* some sort of identifier string to check
-         * get the value of the string and the following token type
-         */
-        nexttyp2 = tk_next_typ2(pcb->tkc);
-        nextval = tk_next_val(pcb->tkc);
-
-        /* check 'axis-name ::' sequence */
-        if (nexttyp2==TK_TT_DBLCOLON && get_axis_id(nextval)) {
-            /* this is an axis name */
-            return parse_location_path(pcb, NULL, res);
-        }               
-
-        /* check 'NodeType (' sequence */
-        if (nexttyp2==TK_TT_LPAREN && get_nodetype_id(nextval)) {
-            /* this is an nodetype name */
-            return parse_location_path(pcb, NULL, res);
-        }
+    xpath_expr_t  *path, *step;
+    tk_type_t      nexttyp;
 
-        /* check not a function call, so must be a QName */
-        if (nexttyp2 != TK_TT_LPAREN) {
-            /* this is an NameTest QName w/o a prefix */
-            return parse_location_path(pcb, NULL, res);
-        }
-        break;
-    default:
-        ;
+    path = new_expr_node(pcb, XP_EXTYP_PATH, res);
+    if (!path) {
+        xpath_free_expr(filter);
+        return NULL;
     }
+    path->left = filter;
 
-    /* if we get here, then a filter expression is expected */
-    val1 = parse_filter_expr(pcb, res);
-
-    if (*res == NO_ERR) {
-        nexttyp = tk_next_typ(pcb->tkc);
-        switch (nexttyp) {
-        case TK_TT_FSLASH:
-            curop = XP_EXOP_FILTER1;
-            break;
-        case TK_TT_DBLFSLASH:
-            curop = XP_EXOP_FILTER2;
-            break;
-        default:
-            curop = XP_EXOP_NONE;
-        }
-
-        if (curop != XP_EXOP_NONE) {
-            val2 = parse_location_path(pcb, val1, res);
-        } else {
-            val2 = val1;
+    do {
+        step = compile_step(pcb, 
+                            (!filter && dlq_empty(&path->exprQ)) ?
+                            TRUE : FALSE,
+                            res);
+        if (!step) {
+            xpath_free_expr(path);
+            return NULL;
         }
-        val1 = NULL;
-    }
-
-    if (val1) {
-        free_result(pcb, val1);
-    }
+        dlq_enque(step, &path->exprQ);
+        nexttyp = tk_next_typ(pcb->tkc);
+    } while (nexttyp == TK_TT_FSLASH || nexttyp == TK_TT_DBLFSLASH);
 
-    return val2;
+    return path;
 
-} /* parse_path_expr */
+}  /* compile_location_path */
 
 
 /********************************************************************
-* FUNCTION parse_union_expr
+* FUNCTION compile_function_call
 * 
-* Parse an XPath UnionExpr sequence
-* It has already been tokenized
-*
-* Error messages are printed by this function!!
-* Do not duplicate error messages upon error return
-*
-* [18] UnionExpr ::= PathExpr
-*                    | UnionExpr '|' PathExpr
+* Compile an XPath FunctionCall sequence into a function node
+* Follows parse_function_call
 *
 * INPUTS:
 *    pcb == parser control block in progress
@@ -8179,81 +10093,79 @@ static xpath_result_t *
 *   *res == function result status
 *
 * RETURNS:
-*   pointer to malloced result struct or NULL if no
-*   result processing in effect 
+*   malloced function node or NULL if error
 *********************************************************************/
-static xpath_result_t *
-    parse_union_expr (xpath_pcb_t *pcb,
-                      status_t *res)
+static xpath_expr_t *
+    compile_function_call (xpath_pcb_t *pcb,
+                           status_t *res)
 {
-    xpath_result_t  *val1, *val2;
-    boolean          done;
-    tk_type_t        nexttyp;
+    xpath_expr_t        *fncall, *arg;
+    const xpath_fncb_t  *fncb;
+    int32                parmcnt;
 
-    val1 = NULL;
-    val2 = NULL;
-    done = FALSE;
+    *res = xpath_parse_token(pcb, TK_TT_TSTRING);
+    if (*res != NO_ERR) {
+        return NULL;
+    }
 
-    while (!done && *res == NO_ERR) {
-        val1 = parse_path_expr(pcb, res);
+    fncb = (const xpath_fncb_t *)TK_CUR(pcb->tkc)->xpfncb;
+    if (fncb == NULL && TK_CUR_VAL(pcb->tkc) != NULL) {
+        fncb = find_fncb(pcb, TK_CUR_VAL(pcb->tkc));
+        TK_CUR(pcb->tkc)->xpfncb = fncb;
+    }
+    if (!fncb) {
+        *res = ERR_NCX_UNKNOWN_PARM;
+        return NULL;
+    }
 
-        if (*res == NO_ERR) {
-            if (val2) {
-                if (pcb->val || pcb->obj) {
-                    /* add all the nodes from val1 into val2
-                     * that are not already present
-                     */
-                    merge_nodeset(pcb, val1, val2);
-                    
-                    if (val1) {
-                        free_result(pcb, val1);
-                        val1 = NULL;
-                    }
-                }
-            } else {
-                val2 = val1;
-                val1 = NULL;
-            }
+    fncall = new_expr_node(pcb, XP_EXTYP_FNCALL, res);
+    if (!fncall) {
+        return NULL;
+    }
+    fncall->fncb = fncb;
+    parmcnt = 0;
 
-            if (*res != NO_ERR) {
-                continue;
+    *res = xpath_parse_token(pcb, TK_TT_LPAREN);
+    if (*res == NO_ERR && tk_next_typ(pcb->tkc) != TK_TT_RPAREN) {
+        for (;;) {
+            arg = compile_expr(pcb, res);
+            if (!arg) {
+                break;
             }
-
-            nexttyp = tk_next_typ(pcb->tkc);
-            if (nexttyp != TK_TT_BAR) {
-                done = TRUE;
-            } else {
-                *res = xpath_parse_token(pcb, TK_TT_BAR);
-                if (*res == NO_ERR) {
-                    if (pcb->flags & XP_FL_INSTANCEID) {
-                        invalid_instanceid_error(pcb);
-                        *res = ERR_NCX_INVALID_INSTANCEID;
-                    }
-                }
+            dlq_enque(arg, &fncall->exprQ);
+            parmcnt++;
+            if (tk_next_typ(pcb->tkc) == TK_TT_RPAREN) {
+                break;
+            }
+            *res = xpath_parse_token(pcb, TK_TT_COMMA);
+            if (*res != NO_ERR) {
+                break;
             }
         }
     }
-
-    if (val1) {
-        free_result(pcb, val1);
+    if (*res == NO_ERR) {
+        *res = xpath_parse_token(pcb, TK_TT_RPAREN);
+    }
+    if (*res == NO_ERR && 
+        fncb->parmcnt >= 0 && fncb->parmcnt != parmcnt) {
+        *res = (parmcnt > fncb->parmcnt) ?
+            ERR_NCX_EXTRA_PARM : ERR_NCX_MISSING_PARM;
     }
 
-    return val2;
+    if (*res != NO_ERR) {
+        xpath_free_expr(fncall);
+        return NULL;
+    }
+    return fncall;
 
-} /* parse_union_expr */
+}  /* compile_function_call */
 
 
 /********************************************************************
-* FUNCTION parse_unary_expr
+* FUNCTION compile_primary_expr
 * 
-* Parse an XPath UnaryExpr sequence
-* It has already been tokenized
-*
-* Error messages are printed by this function!!
-* Do not duplicate error messages upon error return
-*
-* [27] UnaryExpr ::= UnionExpr  
-*                    | '-' UnaryExpr
+* Compile an XPath PrimaryExpr sequence
+* Follows parse_primary_expr
 *
 * INPUTS:
 *    pcb == parser control block in progress
@@ -8263,72 +10175,83 @@ static xpath_result_t *
 *   *res == function result status
 *
 * RETURNS:
-*   pointer to malloced result struct or NULL if no
-*   result processing in effect 
+*   malloced node or NULL if error
 *********************************************************************/
-static xpath_result_t *
-    parse_unary_expr (xpath_pcb_t *pcb,
-                      status_t *res)
+static xpath_expr_t *
+    compile_primary_expr (xpath_pcb_t *pcb,
+                          status_t *res)
 {
-    xpath_result_t  *val1, *result;
-    tk_type_t        nexttyp;
-    uint32           minuscnt;
-
-    val1 = NULL;
-    minuscnt = 0;
+    xpath_expr_t  *expr;
+    tk_type_t      nexttyp;
 
+    expr = NULL;
     nexttyp = tk_next_typ(pcb->tkc);
-    while (nexttyp == TK_TT_MINUS) {
-        *res = xpath_parse_token(pcb, TK_TT_MINUS);
-        if (*res != NO_ERR) {
-            return NULL;
-        } else {
-            nexttyp = tk_next_typ(pcb->tkc);
-            minuscnt++;
-        }
-    }
-
-    val1 = parse_union_expr(pcb, res);
-
-    if (*res == NO_ERR && (minuscnt & 1)) {
-        if (pcb->val || pcb->obj) {
-            /* odd number of negate ops requested */
 
-            if (val1->restype == XP_RT_NUMBER) {
-                val1->r.num.d *= -1;
-                return val1;
-            } else {
-                result = new_result(pcb, XP_RT_NUMBER);
-                if (!result) {
-                    *res = ERR_INTERNAL_MEM;
-                    return NULL;
-                }
-                xpath_cvt_number(val1, &result->r.num);
-                result->r.num.d *= -1;
-                free_result(pcb, val1);
-                return result;
+    switch (nexttyp) {
+    case TK_TT_VARBIND:
+    case TK_TT_QVARBIND:
+        *res = xpath_parse_token(pcb, nexttyp);
+        if (*res == NO_ERR) {
+            expr = new_expr_node(pcb, XP_EXTYP_VARBIND, res);
+        }
+        break;
+    case TK_TT_LPAREN:
+        /* ( expr ) is just the node for expr */
+        *res = xpath_parse_token(pcb, TK_TT_LPAREN);
+        if (*res == NO_ERR) {
+            expr = compile_expr(pcb, res);
+        }
+        if (expr) {
+            *res = xpath_parse_token(pcb, TK_TT_RPAREN);
+            if (*res != NO_ERR) {
+                xpath_free_expr(expr);
+                expr = NULL;
             }
         }
+        break;
+    case TK_TT_DNUM:
+    case TK_TT_RNUM:
+        /* the number is only converted once */
+        *res = xpath_parse_token(pcb, nexttyp);
+        if (*res == NO_ERR) {
+            expr = new_expr_node(pcb, XP_EXTYP_NUMBER, res);
+        }
+        if (expr) {
+            *res = get_number_token(pcb, &expr->num);
+            if (*res != NO_ERR) {
+                xpath_free_expr(expr);
+                expr = NULL;
+            }
+        }
+        break;
+    case TK_TT_QSTRING:
+    case TK_TT_SQSTRING:
+        *res = xpath_parse_token(pcb, nexttyp);
+        if (*res == NO_ERR) {
+            expr = new_expr_node(pcb, XP_EXTYP_LITERAL, res);
+        }
+        break;
+    case TK_TT_TSTRING:
+        if (tk_next_typ2(pcb->tkc) == TK_TT_LPAREN) {
+            expr = compile_function_call(pcb, res);
+        } else {
+            *res = ERR_NCX_INVALID_XPATH_EXPR;
+        }
+        break;
+    default:
+        *res = ERR_NCX_WRONG_TKTYPE;
     }
 
-    return val1;
+    return expr;
 
-} /* parse_unary_expr */
+}  /* compile_primary_expr */
 
 
 /********************************************************************
-* FUNCTION parse_multiplicative_expr
+* FUNCTION compile_path_expr
 * 
-* Parse an XPath MultiplicativeExpr sequence
-* It has already been tokenized
-*
-* Error messages are printed by this function!!
-* Do not duplicate error messages upon error return
-*
-* [26] MultiplicativeExpr ::= UnaryExpr 
-*              | MultiplicativeExpr MultiplyOperator UnaryExpr
-*              | MultiplicativeExpr 'div' UnaryExpr
-*              | MultiplicativeExpr 'mod' UnaryExpr
+* Compile an XPath PathExpr sequence
+* Follows parse_path_expr and parse_filter_expr
 *
 * INPUTS:
 *    pcb == parser control block in progress
@@ -8338,162 +10261,92 @@ static xpath_result_t *
 *   *res == function result status
 *
 * RETURNS:
-*   pointer to malloced result struct or NULL if no
-*   result processing in effect 
+*   malloced node or NULL if error
 *********************************************************************/
-static xpath_result_t *
-    parse_multiplicative_expr (xpath_pcb_t *pcb,
-                               status_t *res)
+static xpath_expr_t *
+    compile_path_expr (xpath_pcb_t *pcb,
+                       status_t *res)
 {
-    xpath_result_t  *val1, *val2, *result;
-    ncx_num_t        num1, num2;
-    xpath_exop_t     curop;
-    boolean          done;
-    tk_type_t        nexttyp;
-
-    val1 = NULL;
-    val2 = NULL;
-    result = NULL;
-    curop = XP_EXOP_NONE;
-    done = FALSE;
-
-    ncx_init_num(&num1);
-    ncx_init_num(&num2);
-
-    while (!done && *res == NO_ERR) {
-        val1 = parse_unary_expr(pcb, res);
-
-        if (*res == NO_ERR) {
-            if (val2) {
-                if (pcb->val || pcb->obj) {
-                    /* val2 holds the 1st operand
-                     * val1 holds the 2nd operand
-                     */
-                    if (val1->restype != XP_RT_NUMBER) {
-                        xpath_cvt_number(val1, &num1);
-                    } else {
-                        *res = ncx_copy_num(&val1->r.num,
-                                            &num1, 
-                                            NCX_BT_FLOAT64);
-                    }
-
-                    if (val2->restype != XP_RT_NUMBER) {
-                        xpath_cvt_number(val2, &num2);
-                    } else {
-                        *res = ncx_copy_num(&val2->r.num,
-                                            &num2, 
-                                            NCX_BT_FLOAT64);
-                    }
+    xpath_expr_t  *expr, *filter, *pred;
+    tk_token_t    *nexttk;
+    tk_type_t      nexttyp, nexttyp2;
 
-                    if (*res == NO_ERR) {
-                        result = new_result(pcb, XP_RT_NUMBER);
-                        if (!result) {
-                            *res = ERR_INTERNAL_MEM;
-                        } else {
-                            switch (curop) {
-                            case XP_EXOP_MULTIPLY:
-                                result->r.num.d = num2.d * num1.d;
-                                break;
-                            case XP_EXOP_DIV:
-                                if (ncx_num_zero(&num2, 
-                                                 NCX_BT_FLOAT64)) {
-                                    ncx_set_num_max(&result->r.num,
-                                                    NCX_BT_FLOAT64);
-                                } else {
-                                    result->r.num.d = num2.d / num1.d;
-                                }
-                                break;
-                            case XP_EXOP_MOD:
-                                result->r.num.d = num2.d / num1.d;
-#ifdef HAS_FLOAT
-                                result->r.num.d = trunc(result->r.num.d);
-#endif
-                                break;
-                            default:
-                                *res = SET_ERROR(ERR_INTERNAL_VAL);
-                            }
-                        }
-                    }
-                }
+    /* peek ahead to check the possible next sequence */
+    nexttyp = tk_next_typ(pcb->tkc);
+    switch (nexttyp) {
+    case TK_TT_FSLASH:
+    case TK_TT_DBLFSLASH:
+    case TK_TT_PERIOD:
+    case TK_TT_RANGESEP:
+    case TK_TT_ATSIGN:
+    case TK_TT_STAR:
+    case TK_TT_NCNAME_STAR:
+    case TK_TT_MSTRING:
+        return compile_location_path(pcb, NULL, res);
+    case TK_TT_TSTRING:
+        nexttyp2 = tk_next_typ2(pcb->tkc);
+        nexttk = (tk_token_t *)dlq_nextEntry(TK_CUR(pcb->tkc));
+        if ((nexttyp2==TK_TT_DBLCOLON && get_token_axis_id(nexttk)) ||
+            (nexttyp2==TK_TT_LPAREN && get_token_nodetype_id(nexttk)) ||
+            nexttyp2 != TK_TT_LPAREN) {
+            return compile_location_path(pcb, NULL, res);
+        }
+        break;
+    default:
+        ;
+    }
 
-                if (val1) {
-                    free_result(pcb, val1);
-                    val1 = NULL;
-                }
-                if (val2) {
-                    free_result(pcb, val2);
-                    val2 = NULL;
-                }
+    /* FilterExpr ::= PrimaryExpr Predicate* */
+    expr = compile_primary_expr(pcb, res);
+    if (!expr) {
+        return NULL;
+    }
 
-                if (result) {
-                    val2 = result;
-                    result = NULL;
-                }
-            } else {
-                val2 = val1;
-                val1 = NULL;
-            }
+    if (tk_next_typ(pcb->tkc) == TK_TT_LBRACK) {
+        filter = new_expr_node(pcb, XP_EXTYP_FILTER, res);
+        if (!filter) {
+            xpath_free_expr(expr);
+            return NULL;
+        }
+        filter->left = expr;
+        expr = filter;
 
+        while (tk_next_typ(pcb->tkc) == TK_TT_LBRACK) {
+            *res = xpath_parse_token(pcb, TK_TT_LBRACK);
             if (*res != NO_ERR) {
-                continue;
-            }
-
-            nexttyp = tk_next_typ(pcb->tkc);
-            switch (nexttyp) {
-            case TK_TT_STAR:
-                curop = XP_EXOP_MULTIPLY;
                 break;
-            case TK_TT_TSTRING:
-                if (match_next_token(pcb, TK_TT_TSTRING,
-                                     XP_OP_DIV)) {
-                    curop = XP_EXOP_DIV;
-                } else if (match_next_token(pcb, 
-                                            TK_TT_TSTRING,
-                                            XP_OP_MOD)) {
-                    curop = XP_EXOP_MOD;
-                } else {
-                    done = TRUE;
-                }
+            }
+            pred = compile_expr(pcb, res);
+            if (!pred) {
                 break;
-            default:
-                done = TRUE;
             }
-            if (!done) {
-                *res = xpath_parse_token(pcb, nexttyp);
-                if (*res == NO_ERR) {
-                    if (pcb->flags & XP_FL_INSTANCEID) {
-                        invalid_instanceid_error(pcb);
-                        *res = ERR_NCX_INVALID_INSTANCEID;
-                    }
-                }
+            dlq_enque(pred, &filter->exprQ);
+            *res = xpath_parse_token(pcb, TK_TT_RBRACK);
+            if (*res != NO_ERR) {
+                break;
             }
         }
+        if (*res != NO_ERR) {
+            xpath_free_expr(expr);
+            return NULL;
+        }
     }
 
-    if (val1) {
-        free_result(pcb, val1);
+    nexttyp = tk_next_typ(pcb->tkc);
+    if (nexttyp == TK_TT_FSLASH || nexttyp == TK_TT_DBLFSLASH) {
+        return compile_location_path(pcb, expr, res);
     }
+    return expr;
 
-    ncx_clean_num(NCX_BT_FLOAT64, &num1);
-    ncx_clean_num(NCX_BT_FLOAT64, &num2);
-
-    return val2;
-
-} /* parse_multiplicative_expr */
+}  /* compile_path_expr */
 
 
 /********************************************************************
-* FUNCTION parse_additive_expr
+* FUNCTION compile_unary_expr
 * 
-* Parse an XPath AdditiveExpr sequence
-* It has already been tokenized
-*
-* Error messages are printed by this function!!
-* Do not duplicate error messages upon error return
-*
-* [25] AdditiveExpr ::= MultiplicativeExpr
-*                | AdditiveExpr '+' MultiplicativeExpr
-*                | AdditiveExpr '-' MultiplicativeExpr
+* Compile an XPath UnaryExpr sequence, with the
+* UnionExpr inside it
+* Follows parse_unary_expr and parse_union_expr
 *
 * INPUTS:
 *    pcb == parser control block in progress
@@ -8503,266 +10356,133 @@ static xpath_result_t *
 *   *res == function result status
 *
 * RETURNS:
-*   pointer to malloced result struct or NULL if no
-*   result processing in effect 
+*   malloced node or NULL if error
 *********************************************************************/
-static xpath_result_t *
-    parse_additive_expr (xpath_pcb_t *pcb,
-                           status_t *res)
+static xpath_expr_t *
+    compile_unary_expr (xpath_pcb_t *pcb,
+                        status_t *res)
 {
-    xpath_result_t  *val1, *val2, *result;
-    ncx_num_t        num1, num2;
-    xpath_exop_t     curop;
-    boolean          done;
-    tk_type_t        nexttyp;
-
-    val1 = NULL;
-    val2 = NULL;
-    result = NULL;
-    curop = XP_EXOP_NONE;
-    done = FALSE;
+    xpath_expr_t  *expr, *opexpr, *right;
+    uint32         minuscnt;
 
-    while (!done && *res == NO_ERR) {
-        val1 = parse_multiplicative_expr(pcb, res);
+    minuscnt = 0;
+    while (tk_next_typ(pcb->tkc) == TK_TT_MINUS) {
+        *res = xpath_parse_token(pcb, TK_TT_MINUS);
+        if (*res != NO_ERR) {
+            return NULL;
+        }
+        minuscnt++;
+    }
 
+    expr = compile_path_expr(pcb, res);
+    while (expr && tk_next_typ(pcb->tkc) == TK_TT_BAR) {
+        *res = xpath_parse_token(pcb, TK_TT_BAR);
         if (*res == NO_ERR) {
-            if (val2) {
-                /* val2 holds the 1st operand
-                 * val1 holds the 2nd operand
-                 */
-
-                if (pcb->val || pcb->val) {
-                    if (val1->restype != XP_RT_NUMBER) {
-                        xpath_cvt_number(val1, &num1);
-                    } else {
-                        *res = ncx_copy_num(&val1->r.num,
-                                            &num1, 
-                                            NCX_BT_FLOAT64);
-                    }
-
-                    if (val2->restype != XP_RT_NUMBER) {
-                        xpath_cvt_number(val2, &num2);
-                    } else {
-                        *res = ncx_copy_num(&val2->r.num,
-                                            &num2, 
-                                            NCX_BT_FLOAT64);
-                    }
-
-                    if (*res == NO_ERR) {
-                        result = new_result(pcb, XP_RT_NUMBER);
-                        if (!result) {
-                            *res = ERR_INTERNAL_MEM;
-                        } else {
-                            switch (curop) {
-                            case XP_EXOP_ADD:
-                                result->r.num.d = num2.d + num1.d;
-                                break;
-                            case XP_EXOP_SUBTRACT:
-                                result->r.num.d = num2.d - num1.d;
-                                break;
-                            default:
-                                *res = SET_ERROR(ERR_INTERNAL_VAL);
-                            }
-                        }
-                    }
-                }
-
-                if (val1) {
-                    free_result(pcb, val1);
-                    val1 = NULL;
-                }
-                if (val2) {
-                    free_result(pcb, val2);
-                    val2 = NULL;
-                }
-
-                if (result) {
-                    val2 = result;
-                    result = NULL;
-                }
-            } else {
-                val2 = val1;
-                val1 = NULL;
-            }
-
-            if (*res != NO_ERR) {
-                continue;
-            }
+            opexpr = new_expr_node(pcb, XP_EXTYP_OP, res);
+        } else {
+            opexpr = NULL;
+        }
+        if (!opexpr) {
+            xpath_free_expr(expr);
+            return NULL;
+        }
+        opexpr->exop = XP_EXOP_UNION;
+        opexpr->left = expr;
+        expr = opexpr;
 
-            nexttyp = tk_next_typ(pcb->tkc);
-            switch (nexttyp) {
-            case TK_TT_PLUS:
-                curop = XP_EXOP_ADD;
-                break;
-            case TK_TT_MINUS:
-                curop = XP_EXOP_SUBTRACT;
-                break;
-            default:
-                done = TRUE;
-            }
-            if (!done) {
-                *res = xpath_parse_token(pcb, nexttyp);
-                if (*res == NO_ERR) {
-                    if (pcb->flags & XP_FL_INSTANCEID) {
-                        invalid_instanceid_error(pcb);
-                        *res = ERR_NCX_INVALID_INSTANCEID;
-                    }
-                }
-            }
+        right = compile_path_expr(pcb, res);
+        if (!right) {
+            xpath_free_expr(expr);
+            return NULL;
         }
+        expr->right = right;
     }
 
-    if (val1) {
-        free_result(pcb, val1);
+    if (expr && (minuscnt & 1)) {
+        /* odd number of negate ops requested */
+        opexpr = new_expr_node(pcb, XP_EXTYP_NEGATE, res);
+        if (!opexpr) {
+            xpath_free_expr(expr);
+            return NULL;
+        }
+        opexpr->left = expr;
+        expr = opexpr;
     }
 
-    ncx_clean_num(NCX_BT_FLOAT64, &num1);
-    ncx_clean_num(NCX_BT_FLOAT64, &num2);
-
-    return val2;
+    return expr;
 
-} /* parse_additive_expr */
+}  /* compile_unary_expr */
 
 
 /********************************************************************
-* FUNCTION parse_relational_expr
+* FUNCTION compile_binary_expr
 * 
-* Parse an XPath RelationalExpr sequence
-* It has already been tokenized
-*
-* Error messages are printed by this function!!
-* Do not duplicate error messages upon error return
-*
-* [24]  RelationalExpr ::= AdditiveExpr
-*             | RelationalExpr '<' AdditiveExpr
-*             | RelationalExpr '>' AdditiveExpr
-*             | RelationalExpr '<=' AdditiveExpr
-*             | RelationalExpr '>=' AdditiveExpr
+* Compile the XPath OrExpr, AndExpr, EqualityExpr,
+* RelationalExpr, AdditiveExpr or MultiplicativeExpr sequence
+* Operators of the same level are left associative,
+* like the parse_*_expr functions evaluate them
 *
 * INPUTS:
 *    pcb == parser control block in progress
+*    level == precedence level to compile
 *    res == address of result status
 *
 * OUTPUTS:
 *   *res == function result status
 *
 * RETURNS:
-*   pointer to malloced result struct or NULL if no
-*   result processing in effect 
+*   malloced node or NULL if error
 *********************************************************************/
-static xpath_result_t *
-    parse_relational_expr (xpath_pcb_t *pcb,
-                           status_t *res)
+static xpath_expr_t *
+    compile_binary_expr (xpath_pcb_t *pcb,
+                         uint32 level,
+                         status_t *res)
 {
-    xpath_result_t  *val1, *val2, *result;
-    xpath_exop_t     curop;
-    boolean          done, cmpresult;
-    tk_type_t        nexttyp;
+    xpath_expr_t  *expr, *opexpr, *right;
+    xpath_exop_t   exop;
 
-    val1 = NULL;
-    val2 = NULL;
-    result = NULL;
-    curop = XP_EXOP_NONE;
-    done = FALSE;
+    if (level > EXPR_LEVEL_MULTIPLICATIVE) {
+        return compile_unary_expr(pcb, res);
+    }
 
-    while (!done && *res == NO_ERR) {
-        val1 = parse_additive_expr(pcb, res);
+    expr = compile_binary_expr(pcb, level + 1, res);
+    while (expr) {
+        exop = get_next_exop(pcb, level);
+        if (exop == XP_EXOP_NONE) {
+            break;
+        }
 
+        *res = TK_ADV(pcb->tkc);
         if (*res == NO_ERR) {
-            if (val2) {
-                if (pcb->val || pcb->obj) {
-                    /* val2 holds the 1st operand
-                     * val1 holds the 2nd operand
-                     */
-                    cmpresult = compare_results(pcb, 
-                                                val2, 
-                                                val1, 
-                                                curop,
-                                                res);
-
-                    if (*res == NO_ERR) {
-                        result = new_result(pcb, XP_RT_BOOLEAN);
-                        if (!result) {
-                            *res = ERR_INTERNAL_MEM;
-                        } else {
-                            result->r.boo = cmpresult;
-                        }
-                    }
-                }
-
-                if (val1) {
-                    free_result(pcb, val1);
-                    val1 = NULL;
-                }
-
-                if (val2) {
-                    free_result(pcb, val2);
-                    val2 = NULL;
-                }
-
-                if (result) {
-                    val2 = result;
-                    result = NULL;
-                }
-            } else {
-                val2 = val1;
-                val1 = NULL;
-            }
-
-            if (*res != NO_ERR) {
-                continue;
-            }
-
-            nexttyp = tk_next_typ(pcb->tkc);
-            switch (nexttyp) {
-            case TK_TT_LT:
-                curop = XP_EXOP_LT;
-                break;
-            case TK_TT_GT:
-                curop = XP_EXOP_GT;
-                break;
-            case TK_TT_LEQUAL:
-                curop = XP_EXOP_LEQUAL;
-                break;
-            case TK_TT_GEQUAL:
-                curop = XP_EXOP_GEQUAL;
-                break;
-            default:
-                done = TRUE;
-            }
-            if (!done) {
-                *res = xpath_parse_token(pcb, nexttyp);
-                if (*res == NO_ERR) {
-                    if (pcb->flags & XP_FL_INSTANCEID) {
-                        invalid_instanceid_error(pcb);
-                        *res = ERR_NCX_INVALID_INSTANCEID;
-                    }
-                }
-            }
+            opexpr = new_expr_node(pcb, XP_EXTYP_OP, res);
+        } else {
+            opexpr = NULL;
         }
-    }
+        if (!opexpr) {
+            xpath_free_expr(expr);
+            return NULL;
+        }
+        opexpr->exop = exop;
+        opexpr->left = expr;
+        expr = opexpr;
 
-    if (val1) {
-        free_result(pcb, val1);
+        right = compile_binary_expr(pcb, level + 1, res);
+        if (!right) {
+            xpath_free_expr(expr);
+            return NULL;
+        }
+        expr->right = right;
     }
 
-    return val2;
+    return expr;
 
-}  /* parse_relational_expr */
+}  /* compile_binary_expr */
 
 
 /********************************************************************
-* FUNCTION parse_equality_expr
+* FUNCTION compile_expr
 * 
-* Parse an XPath EqualityExpr sequence
-* It has already been tokenized
-*
-* Error messages are printed by this function!!
-* Do not duplicate error messages upon error return
-*
-* [23] EqualityExpr  ::=   RelationalExpr        
-*                | EqualityExpr '=' RelationalExpr        
-*                | EqualityExpr '!=' RelationalExpr        
+* Compile an XPath Expr sequence into an expression tree
 *
 * INPUTS:
 *    pcb == parser control block in progress
@@ -8772,339 +10492,420 @@ static xpath_result_t *
 *   *res == function result status
 *
 * RETURNS:
-*   pointer to malloced result struct or NULL if no
-*   result processing in effect 
+*   malloced node or NULL if error
 *********************************************************************/
-static xpath_result_t *
-    parse_equality_expr (xpath_pcb_t *pcb,
-                         status_t *res)
+static xpath_expr_t *
+    compile_expr (xpath_pcb_t *pcb,
+                  status_t *res)
 {
-    xpath_result_t  *val1, *val2, *result;
-    xpath_exop_t     curop;
-    boolean          done, cmpresult, equalsdone;
-
-    val1 = NULL;
-    val2 = NULL;
-    result = NULL;
-    curop = XP_EXOP_NONE;
-    equalsdone = FALSE;
-    done = FALSE;
-
-    while (!done && *res == NO_ERR) {
-        val1 = parse_relational_expr(pcb, res);
-
-        if (*res == NO_ERR) {
-            if (val2) {
-                if (pcb->val || pcb->obj) {
-                    /* val2 holds the 1st operand
-                     * val1 holds the 2nd operand
-                     */
-                    if (pcb->flags & XP_FL_INSTANCEID) {
-                        *res = check_instanceid_expr(pcb, 
-                                                     val2, 
-                                                     val1);
-                    }
-
-                    if (*res == NO_ERR) {
-                        cmpresult = compare_results(pcb, 
-                                                    val2, 
-                                                    val1, 
-                                                    curop,
-                                                    res);
-
-                        if (*res == NO_ERR) {
-                            result = new_result(pcb, XP_RT_BOOLEAN);
-                            if (!result) {
-                                *res = ERR_INTERNAL_MEM;
-                            } else {
-                                result->r.boo = cmpresult;
-                            }
-                        }
-                    }
-                }
-
-                if (val1) {
-                    free_result(pcb, val1);
-                    val1 = NULL;
-                }
+    return compile_binary_expr(pcb, EXPR_LEVEL_OR, res);
 
-                if (val2) {
-                    free_result(pcb, val2);
-                    val2 = NULL;
-                }
+}  /* compile_expr */
 
-                if (result) {
-                    val2 = result;
-                    result = NULL;
-                }
-            } else {
-                val2 = val1;
-                val1 = NULL;
-            }
 
-            if (*res != NO_ERR) {
-                continue;
-            }
+/********************************************************************
+* FUNCTION build_expr_tree
+* 
+* Build the expression tree for the pcb, the first time
+* it is evaluated.  If the tokens cannot be compiled
+* (e.g. the expression was never parsed and has an error)
+* the pcb->exprtree is left NULL and the expression
+* is parsed and evaluated from the tokens, which reports
+* the error the usual way.  Instance-identifiers are
+* always parsed, to keep the checks for the restricted syntax
+*
+* INPUTS:
+*    pcb == parser control block to use
+*
+* OUTPUTS:
+*   pcb->exprtree is set if OK
+*   pcb->exprdone is set
+*********************************************************************/
+static void
+    build_expr_tree (xpath_pcb_t *pcb)
+{
+    xpath_expr_t  *expr;
+    boolean        logerrors;
+    status_t       res;
 
-            if (match_next_token(pcb, TK_TT_EQUAL, NULL)) {
-                *res = xpath_parse_token(pcb, TK_TT_EQUAL);
-                if (*res == NO_ERR) {
-                    if (equalsdone) {
-                        if (pcb->flags & XP_FL_INSTANCEID) {
-                            invalid_instanceid_error(pcb);
-                            *res = ERR_NCX_INVALID_INSTANCEID;
-                        }
-                    } else {
-                        equalsdone = TRUE;
-                    }
-                }
-                curop = XP_EXOP_EQUAL;
-            } else if (match_next_token(pcb, TK_TT_NOTEQUAL, NULL)) {
-                *res = xpath_parse_token(pcb, TK_TT_NOTEQUAL);
-                if (*res == NO_ERR) {
-                    if (pcb->flags & XP_FL_INSTANCEID) {
-                        invalid_instanceid_error(pcb);
-                        *res = ERR_NCX_INVALID_INSTANCEID;
-                    }
-                }
-                curop = XP_EXOP_NOTEQUAL;
-            } else {
-                done = TRUE;
-            }
-        }
+    pcb->exprdone = TRUE;
+    if ((pcb->flags & XP_FL_INSTANCEID) ||
+        pcb->source == XP_SRC_INSTANCEID) {
+        return;
     }
+    res = NO_ERR;
 
-    if (val1) {
-        free_result(pcb, val1);
+    logerrors = pcb->logerrors;
+    pcb->logerrors = FALSE;
+    tk_reset_chain(pcb->tkc);
+
+    expr = compile_expr(pcb, &res);
+    if (expr && pcb->tkc->cur && TK_ADV(pcb->tkc) == NO_ERR) {
+        /* extra tokens after the expression */
+        xpath_free_expr(expr);
+        expr = NULL;
     }
 
-    return val2;
+    tk_reset_chain(pcb->tkc);
+    pcb->logerrors = logerrors;
+    pcb->exprtree = expr;
 
-}  /* parse_equality_expr */
+}  /* build_expr_tree */
 
 
 /********************************************************************
-* FUNCTION parse_and_expr
+* FUNCTION eval_predicate
 * 
-* Parse an XPath AndExpr sequence
-* It has already been tokenized
-*
-* Error messages are printed by this function!!
-* Do not duplicate error messages upon error return
-*
-* [22] AndExpr  ::= EqualityExpr
-*                   | AndExpr 'and' EqualityExpr
+* Evaluate a Predicate node
+* Follows parse_predicate
 *
 * INPUTS:
 *    pcb == parser control block in progress
-*    res == address of result status
+*    pred == PredicateExpr node
+*    result == address of result in progress to filter
 *
 * OUTPUTS:
-*   *res == function result status
+*   *result may be pruned based on filter matches
 *
 * RETURNS:
-*   pointer to malloced result struct or NULL if no
-*   result processing in effect 
+*   status
 *********************************************************************/
-static xpath_result_t *
-    parse_and_expr (xpath_pcb_t *pcb,
-                    status_t *res)
+static status_t
+    eval_predicate (xpath_pcb_t *pcb,
+                    xpath_expr_t *pred,
+                    xpath_result_t **result)
 {
-    xpath_result_t  *val1, *val2, *result;
-    boolean          done, bool1, bool2;
-
-    val1 = NULL;
-    val2 = NULL;
-    result = NULL;
-    done = FALSE;
+    xpath_result_t  *val1, *contextset;
+    xpath_resnode_t  lastcontext, *resnode, *nextnode;
+    boolean          boo;
+    status_t         res;
 
-    while (!done && *res == NO_ERR) {
-        val1 = parse_equality_expr(pcb, res);
+    res = NO_ERR;
+    contextset = *result;
+    if (!contextset) {
+        return SET_ERROR(ERR_INTERNAL_VAL);
+    }
 
-        if (*res == NO_ERR) {
-            if (val2) {
-                if (pcb->val || pcb->obj) {
-                    /* val2 holds the 1st operand
-                     * val1 holds the 2nd operand
-                     */
-                    bool1 = xpath_cvt_boolean(val1);
-                    bool2 = xpath_cvt_boolean(val2);
+    if (contextset->restype != XP_RT_NODESET) {
+        /* result is from a primary expression and
+         * is not a nodeset.  It will get cleared
+         * if the predicate evaluates to false
+         */
+        val1 = eval_expr(pcb, pred, &res);
+        boo = (val1 && res == NO_ERR) ? xpath_cvt_boolean(val1) : FALSE;
+        if (val1) {
+            free_result(pcb, val1);
+        }
+        if (res == NO_ERR && !boo) {
+            xpath_clean_result(contextset);
+            xpath_init_result(contextset, XP_RT_NONE);
+        }
+        return res;
+    }
 
-                    result = new_result(pcb, XP_RT_BOOLEAN);
-                    if (!result) {
-                        *res = ERR_INTERNAL_MEM;
-                    } else {
-                        result->r.boo = (bool1 && bool2) 
-                            ? TRUE : FALSE;
-                    }
-                }
+    if (dlq_empty(&contextset->r.nodeQ)) {
+        /* always one pass; do not care about result */
+        val1 = eval_expr(pcb, pred, &res);
+        if (val1) {
+            free_result(pcb, val1);
+        }
+        return res;
+    }
 
-                if (val1) {
-                    free_result(pcb, val1);
-                    val1 = NULL;
-                }
+    lastcontext.node.valptr = pcb->context.node.valptr;
+    lastcontext.position = pcb->context.position;
+    lastcontext.last = pcb->context.last;
+    lastcontext.dblslash = pcb->context.dblslash;
 
-                if (val2) {
-                    free_result(pcb, val2);
-                    val2 = NULL;
-                }
+    for (resnode = (xpath_resnode_t *)
+             dlq_firstEntry(&contextset->r.nodeQ);
+         resnode != NULL && res == NO_ERR;
+         resnode = nextnode) {
 
-                if (result) {
-                    val2 = result;
-                    result = NULL;
-                }
-            } else {
-                val2 = val1;
-                val1 = NULL;
-            }
+        nextnode = (xpath_resnode_t *)dlq_nextEntry(resnode);
 
-            if (*res != NO_ERR) {
-                continue;
-            }
+        /* evaluate the predicate expression again
+         * with the resnode as the current context node
+         */
+        pcb->context.node.valptr = resnode->node.valptr;
+        pcb->context.position = resnode->position;
+        pcb->context.last = contextset->last;
+        pcb->context.dblslash = resnode->dblslash;
 
-            if (match_next_token(pcb, TK_TT_TSTRING, XP_OP_AND)) {
-                *res = xpath_parse_token(pcb, TK_TT_TSTRING);
-            } else {
-                done = TRUE;
+        val1 = eval_expr(pcb, pred, &res);
+        if (res == NO_ERR) {
+            if (!predicate_match(val1, resnode)) {
+                /* predicate expression evaluated to false
+                 * so delete this resnode from the result
+                 */
+                dlq_remove(resnode);
+                free_resnode(pcb, resnode);
             }
         }
+        if (val1) {
+            free_result(pcb, val1);
+        }
     }
 
-    if (val1) {
-        free_result(pcb, val1);
-    }
+    pcb->context.node.valptr = lastcontext.node.valptr;
+    pcb->context.position = lastcontext.position;
+    pcb->context.last = lastcontext.last;
+    pcb->context.dblslash = lastcontext.dblslash;
 
-    return val2;
+    return res;
 
-}  /* parse_and_expr */
+}  /* eval_predicate */
 
 
 /********************************************************************
-* FUNCTION parse_or_expr
+* FUNCTION eval_step
 * 
-* Parse an XPath OrExpr sequence
-* It has already been tokenized
-*
-* Error messages are printed by this function!!
-* Do not duplicate error messages upon error return
-*
-* [21] OrExpr ::= AndExpr        
-*                 | OrExpr 'or' AndExpr
+* Evaluate a step node of a location path
+* Follows parse_step
 *
 * INPUTS:
 *    pcb == parser control block in progress
-*    res == address of result status
+*    step == step node
+*    result == address of the result nodeset in progress
 *
 * OUTPUTS:
-*   *res == function result status
+*   *result pointer is set to malloced result struct
+*    if it is NULL, or used if it is non-NULL
 *
 * RETURNS:
-*   pointer to malloced result struct or NULL if no
-*   result processing in effect 
+*   status
 *********************************************************************/
-static xpath_result_t *
-    parse_or_expr (xpath_pcb_t *pcb,
-                   status_t *res)
+static status_t
+    eval_step (xpath_pcb_t *pcb,
+               xpath_expr_t *step,
+               xpath_result_t **result)
 {
-    xpath_result_t  *val1, *val2, *result;
-    boolean          done, bool1, bool2;
-
-    val1 = NULL;
-    val2 = NULL;
-    result = NULL;
-    done = FALSE;
-
-    while (!done && *res == NO_ERR) {
-        val1 = parse_and_expr(pcb, res);
-
-        if (*res == NO_ERR) {
-            if (val2) {
-                if (pcb->val || pcb->obj) {
-                    /* val2 holds the 1st operand
-                     * val1 holds the 2nd operand
-                     */
-                    bool1 = xpath_cvt_boolean(val1);
-                    bool2 = xpath_cvt_boolean(val2);
-
-                    result = new_result(pcb, XP_RT_BOOLEAN);
-                    if (!result) {
-                        *res = ERR_INTERNAL_MEM;
-                    } else {
-                        result->r.boo = (bool1 || bool2) 
-                            ? TRUE : FALSE;
-                    }
-                }
-                    
-                if (val1) {
-                    free_result(pcb, val1);
-                    val1 = NULL;
-                }
-
-                if (val2) {
-                    free_result(pcb, val2);
-                    val2 = NULL;
-                }
-
-                if (result) {
-                    val2 = result;
-                    result = NULL;
-                }
-            } else {
-                val2 = val1;
-                val1 = NULL;
-            }
+    xpath_expr_t  *pred;
+    status_t       res;
 
-            if (*res != NO_ERR) {
-                continue;
-            }
+    res = NO_ERR;
+    TK_CUR(pcb->tkc) = step->tk;
 
-            if (match_next_token(pcb, TK_TT_TSTRING, XP_OP_OR)) {
-                *res = xpath_parse_token(pcb, TK_TT_TSTRING);
-            } else {
-                done = TRUE;
+    if (step->exop == XP_EXOP_FILTER2) {
+        if (!*result) {
+            *result = new_nodeset(pcb,
+                                  pcb->context.node.objptr,
+                                  pcb->context.node.valptr,
+                                  1, 
+                                  TRUE);
+            if (!*result) {
+                return ERR_INTERNAL_MEM;
             }
         }
+        set_nodeset_dblslash(pcb, *result);
+    } else if (step->exop == XP_EXOP_FILTER1 && !*result) {
+        *result = new_nodeset(pcb, 
+                              pcb->docroot, 
+                              pcb->val_docroot,
+                              1,
+                              FALSE);
+        if (!*result) {
+            return ERR_INTERNAL_MEM;
+        }
     }
 
-    if (val1) {
-        free_result(pcb, val1);
+    switch (step->extyp) {
+    case XP_EXTYP_ROOT:
+        break;
+    case XP_EXTYP_SELF:
+    case XP_EXTYP_PARENT:
+        if (!*result) {
+            *result = new_nodeset(pcb,
+                                  pcb->context.node.objptr,
+                                  pcb->context.node.valptr,
+                                  1, 
+                                  FALSE);
+            if (!*result) {
+                return ERR_INTERNAL_MEM;
+            }
+        }
+        if (step->extyp == XP_EXTYP_PARENT) {
+            res = set_nodeset_parent(pcb, *result, 0, NULL);
+        }
+        break;
+    case XP_EXTYP_STEP:
+        res = apply_node_test(pcb,
+                              step->axis,
+                              step->nodetyp,
+                              step->nsid,
+                              step->name,
+                              result);
+        for (pred = (xpath_expr_t *)dlq_firstEntry(&step->exprQ);
+             pred != NULL && res == NO_ERR;
+             pred = (xpath_expr_t *)dlq_nextEntry(pred)) {
+            res = eval_predicate(pcb, pred, result);
+        }
+        break;
+    default:
+        res = SET_ERROR(ERR_INTERNAL_VAL);
     }
 
-    return val2;
+    return res;
 
-}  /* parse_or_expr */
+}  /* eval_step */
 
 
 /********************************************************************
-* FUNCTION parse_expr
+* FUNCTION eval_expr
 * 
-* Parse an XPath Expr sequence
-* It has already been tokenized
-*
-* Error messages are printed by this function!!
-* Do not duplicate error messages upon error return
-*
-* [14] Expr ::= OrExpr
+* Evaluate an expression tree node
 *
 * INPUTS:
 *    pcb == parser control block in progress
+*    expr == expression tree node to evaluate
 *    res == address of result status
 *
 * OUTPUTS:
 *   *res == function result status
 *
 * RETURNS:
-*   pointer to malloced result struct or NULL if no
-*   result processing in effect 
+*   malloced result struct or NULL if error
 *********************************************************************/
 static xpath_result_t *
-    parse_expr (xpath_pcb_t *pcb,
-                status_t  *res)
+    eval_expr (xpath_pcb_t *pcb,
+               xpath_expr_t *expr,
+               status_t *res)
 {
+    xpath_result_t  *val1, *val2, *result;
+    xpath_expr_t    *child;
+    dlq_hdr_t        parmQ;
 
-    return parse_or_expr(pcb, res);
+    val1 = NULL;
+    val2 = NULL;
+    result = NULL;
 
-}  /* parse_expr */
+    /* errors are printed for the token of this node */
+    if (expr->tk) {
+        TK_CUR(pcb->tkc) = expr->tk;
+    }
+
+    switch (expr->extyp) {
+    case XP_EXTYP_OP:
+        /* val2 holds the 1st operand
+         * val1 holds the 2nd operand
+         */
+        val2 = eval_expr(pcb, expr->left, res);
+        if (*res == NO_ERR) {
+            val1 = eval_expr(pcb, expr->right, res);
+        }
+        if (*res != NO_ERR || !val2) {
+            result = val1;
+            val1 = NULL;
+        } else if (expr->exop == XP_EXOP_UNION) {
+            /* add all the nodes from val1 into val2
+             * that are not already present
+             */
+            merge_nodeset(pcb, val1, val2);
+            result = val2;
+            val2 = NULL;
+        } else {
+            TK_CUR(pcb->tkc) = expr->tk;
+            result = apply_exop(pcb, expr->exop, val2, val1, res);
+        }
+        break;
+    case XP_EXTYP_NEGATE:
+        val1 = eval_expr(pcb, expr->left, res);
+        if (*res == NO_ERR && val1) {
+            result = negate_result(pcb, val1, res);
+            val1 = NULL;
+        }
+        break;
+    case XP_EXTYP_LITERAL:
+        result = new_result(pcb, XP_RT_STRING);
+        if (!result) {
+            *res = ERR_INTERNAL_MEM;
+            break;
+        }
+        result->r.str = xml_strdup((expr->tk->val != NULL) ?
+                                   expr->tk->val : EMPTY_STRING);
+        if (!result->r.str) {
+            *res = ERR_INTERNAL_MEM;
+            malloc_failed_error(pcb);
+        }
+        break;
+    case XP_EXTYP_NUMBER:
+        result = new_result(pcb, XP_RT_NUMBER);
+        if (!result) {
+            *res = ERR_INTERNAL_MEM;
+        } else {
+            *res = ncx_copy_num(&expr->num, &result->r.num, NCX_BT_FLOAT64);
+        }
+        break;
+    case XP_EXTYP_VARBIND:
+        result = get_varbind_result(pcb, res);
+        break;
+    case XP_EXTYP_FNCALL:
+        dlq_createSQue(&parmQ);
+        for (child = (xpath_expr_t *)dlq_firstEntry(&expr->exprQ);
+             child != NULL && *res == NO_ERR;
+             child = (xpath_expr_t *)dlq_nextEntry(child)) {
+            val1 = eval_expr(pcb, child, res);
+            if (val1) {
+                dlq_enque(val1, &parmQ);
+                val1 = NULL;
+            }
+        }
+        if (*res == NO_ERR) {
+            TK_CUR(pcb->tkc) = expr->tk;
+            result = call_function(pcb, expr->fncb, &parmQ, res);
+        }
+        while (!dlq_empty(&parmQ)) {
+            val2 = (xpath_result_t *)dlq_deque(&parmQ);
+            free_result(pcb, val2);
+        }
+        val2 = NULL;
+        break;
+    case XP_EXTYP_FILTER:
+        result = eval_expr(pcb, expr->left, res);
+        if (*res != NO_ERR) {
+            break;
+        }
+        if (!result) {
+            /* predicates are still evaluated once */
+            val1 = new_result(pcb, XP_RT_NODESET);
+            if (!val1) {
+                *res = ERR_INTERNAL_MEM;
+                break;
+            }
+        }
+        for (child = (xpath_expr_t *)dlq_firstEntry(&expr->exprQ);
+             child != NULL && *res == NO_ERR;
+             child = (xpath_expr_t *)dlq_nextEntry(child)) {
+            *res = eval_predicate(pcb, child, (result) ? &result : &val1);
+        }
+        break;
+    case XP_EXTYP_PATH:
+        if (expr->left) {
+            result = eval_expr(pcb, expr->left, res);
+        }
+        for (child = (xpath_expr_t *)dlq_firstEntry(&expr->exprQ);
+             child != NULL && *res == NO_ERR;
+             child = (xpath_expr_t *)dlq_nextEntry(child)) {
+            *res = eval_step(pcb, child, &result);
+        }
+        break;
+    default:
+        *res = SET_ERROR(ERR_INTERNAL_VAL);
+    }
+
+    if (val1) {
+        free_result(pcb, val1);
+    }
+    if (val2) {
+        free_result(pcb, val2);
+    }
+    if (*res != NO_ERR && result) {
+        free_result(pcb, result);
+        result = NULL;
+    }
+    return result;
+
+}  /* eval_expr */
 
 
 /********************************************************************
@@ -9247,6 +11048,11 @@ status_t
     pcb->orig_context.node.valptr = NULL;
     pcb->parseres = NO_ERR;
 
+    /* the tree is built again for the next evaluation */
+    xpath_free_expr(pcb->exprtree);
+    pcb->exprtree = NULL;
+    pcb->exprdone = FALSE;
+
     if (pcb->source == XP_SRC_INSTANCEID) {
         pcb->flags |= XP_FL_INSTANCEID;
         result = parse_location_path(pcb, NULL, &pcb->parseres);
@@ -9573,8 +11379,18 @@ xpath_result_t *
     }
 
     pcb->flags |= XP_FL_USEROOT;
+    pcb->valueres = NO_ERR;
 
-    if (pcb->source == XP_SRC_INSTANCEID) {
+    /* the tokens are only parsed again if no expression tree
+     * could be built for them
+     */
+    if (!pcb->exprdone) {
+        build_expr_tree(pcb);
+    }
+
+    if (pcb->exprtree) {
+        result = eval_expr(pcb, pcb->exprtree, &pcb->valueres);
+    } else if (pcb->source == XP_SRC_INSTANCEID) {
         result = parse_location_path(pcb, NULL, &pcb->valueres);
     } else {
         result = parse_expr(pcb, &pcb->valueres);
@@ -9593,6 +11409,40 @@ xpath_result_t *
 }  /* xpath1_eval_expr */
 
 
+/********************************************************************
+* FUNCTION xpath1_get_expr_tree
+* 
+* Get the expression tree for a parsed XPath expression,
+* building it the first time it is needed.  Callers that
+* analyze an expression (e.g. the nodes it can read) should
+* use the tree instead of the tokens
+*
+* INPUTS:
+*    pcb == parsed XPath parser control block to use
+*
+* RETURNS:
+*   const pointer to the expression tree;
+*   NULL if the expression has no tree: it could not be parsed,
+*   the tokens could not be compiled, or it is an instance-identifier
+*********************************************************************/
+const xpath_expr_t *
+    xpath1_get_expr_tree (xpath_pcb_t *pcb)
+{
+    assert( pcb && "pcb is NULL" );
+
+    if (pcb->tkc == NULL || pcb->parseres != NO_ERR ||
+        pcb->validateres != NO_ERR) {
+        return NULL;
+    }
+
+    if (!pcb->exprdone) {
+        build_expr_tree(pcb);
+    }
+    return pcb->exprtree;
+
+}  /* xpath1_get_expr_tree */
+
+
 /********************************************************************
 * FUNCTION xpath1_eval_xmlexpr
 * 
@@ -9707,9 +11557,19 @@ xpath_result_t *
 
     pcb->flags |= XP_FL_USEROOT;
 
-    result = parse_expr(pcb, &pcb->valueres);
+    if (val && !pcb->exprdone) {
+        build_expr_tree(pcb);
+    }
+
+    if (val && pcb->exprtree) {
+        result = eval_expr(pcb, pcb->exprtree, &pcb->valueres);
+    } else {
+        result = parse_expr(pcb, &pcb->valueres);
+    }
 
-    if (pcb->valueres == NO_ERR && pcb->tkc->cur) {
+    /* the tree is only built if no tokens were left over */
+    if (pcb->valueres == NO_ERR && !(val && pcb->exprtree) &&
+        pcb->tkc->cur) {
         myres = TK_ADV(pcb->tkc);
         if (myres == NO_ERR) {
             pcb->valueres = ERR_NCX_INVALID_XPATH_EXPR;     
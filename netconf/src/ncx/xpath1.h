@@ -249,6 +249,26 @@ extern xpath_result_t *
 		      status_t *res);
 
 
+/********************************************************************
+* FUNCTION xpath1_get_expr_tree
+* 
+* Get the expression tree for a parsed XPath expression,
+* building it the first time it is needed.  Callers that
+* analyze an expression (e.g. the nodes it can read) should
+* use the tree instead of the tokens
+*
+* INPUTS:
+*    pcb == parsed XPath parser control block to use
+*
+* RETURNS:
+*   const pointer to the expression tree;
+*   NULL if the expression has no tree: it could not be parsed,
+*   the tokens could not be compiled, or it is an instance-identifier
+*********************************************************************/
+extern const xpath_expr_t *
+    xpath1_get_expr_tree (xpath_pcb_t *pcb);
+
+
 /********************************************************************
 * FUNCTION xpath1_eval_xmlexpr
 * 
@@ -3970,7 +3970,7 @@ status_t
         /* serialize the file into language tokens
          * !!! need to change this later because it may use too
          * !!! much memory in embedded parsers */
-        res = tk_tokenize_input(tkc, mod);
+        res = tk_tokenize_file(tkc, mod);
         if ( NO_ERR != res ) {
             ncx_free_module(mod);
 
@@ -247,16 +247,28 @@ typedef		long double		LDBL;
 extern uint32  malloc_cnt;
 extern uint32  free_cnt;
 
+/* the counters are updated atomically because the token
+ * prefetch threads and the log writer thread allocate memory
+ * at the same time as the main thread
+ */
+#ifndef m__count
+#if defined(__GNUC__)
+#define m__count(C)    __atomic_fetch_add(&(C), 1, __ATOMIC_RELAXED)
+#else
+#define m__count(C)    (C)++
+#endif
+#endif		/* m__count */
+
 #ifndef m__getMem
-#define m__getMem(X)   malloc(X);malloc_cnt++
+#define m__getMem(X)   malloc(X);m__count(malloc_cnt)
 #endif		/* m__getMem */
 
 #ifndef m__free
-#define m__free(X)    do { if ( X ) { free(X); free_cnt++; } } while(0)
+#define m__free(X)    do { if ( X ) { free(X); m__count(free_cnt); } } while(0)
 #endif		/* m__free */
 
 #ifndef m__getObj
-#define m__getObj(OBJ)	(OBJ *)malloc(sizeof(OBJ));malloc_cnt++
+#define m__getObj(OBJ)	(OBJ *)malloc(sizeof(OBJ));m__count(malloc_cnt)
 #endif		/* m__getObj */
 
 #ifdef __cplusplus
@@ -28,12 +28,14 @@ date         init     comment
 *                     I N C L U D E    F I L E S                    *
 *                                                                   *
 *********************************************************************/
+#define _GNU_SOURCE
 #include <sys/types.h>
 #include <sys/param.h>
 #include <sys/stat.h>
 #include <sys/time.h>
 #include <sys/socket.h>
 #include <sys/un.h>
+#include <sys/uio.h>
 #include <netinet/in.h>
 #include <netinet/tcp.h>
 #include <netdb.h>
@@ -46,6 +48,7 @@ date         init     comment
 #include <stdio.h>
 #include <string.h>
 #include <pwd.h>
+#include <poll.h>
 #include <stdarg.h>
 
 #define _C_main 1
@@ -86,6 +89,38 @@ date         init     comment
 
 #define MAX_READ_TRIES 1000
 
+/* bytes buffered in each relay direction */
+#define RELAY_BUFFLEN  (256 * 1024)
+
+#define RELAY_SPLICE_FLAGS  (SPLICE_F_MOVE | SPLICE_F_NONBLOCK)
+
+/********************************************************************
+*                                                                   *
+*                           T Y P E S                               *
+*                                                                   *
+*********************************************************************/
+
+/* one direction of the relay between the SSH client and ncxserver
+ * In splice mode the data is moved from infd to outfd through
+ * a pipe and never copied to user space; otherwise it is read
+ * into a ring buffer with readv and written with writev.
+ * No more is read until the pending data is written, so a slow
+ * reader on outfd holds back the writer on infd
+ */
+typedef struct relay_t_ {
+    const char *name;
+    int         infd;
+    int         outfd;
+    boolean     usesplice;
+    int         pipefd[2];
+    size_t      pipesize;
+    char       *buff;
+    size_t      start;          /* ring offset of the pending data */
+    size_t      count;      /* bytes pending in the pipe or the ring */
+    boolean     eof;
+    uint64      bytes;                /* bytes written to outfd */
+} relay_t;
+
 /********************************************************************
 *                                                                   *
 *                       V A R I A B L E S                           *
@@ -125,6 +160,9 @@ static FILE *errfile;
 static boolean ncxconnect;
 static char msgbuff[BUFFLEN];
 
+/* --relay=splice (default) or --relay=copy */
+static boolean relay_splice;
+
 /******************************************************************
  * FUNCTION configure_logging
  *
@@ -199,10 +237,15 @@ static status_t
     ncxsock = -1;
     ncxconnect = FALSE;
     ncxport_inet = -1;
+    relay_splice = TRUE;
 
     for(i=1;i<argc;i++) {
     	if(strlen(argv[i])>strlen("--tcp-direct-port=") && 0==memcmp(argv[i],"--tcp-direct-port=",strlen("--tcp-direct-port="))) {
             ncxport_inet = atoi(argv[i]+strlen("--tcp-direct-port=")); 
+        } else if (!strcmp(argv[i], "--relay=copy")) {
+            relay_splice = FALSE;
+        } else if (!strcmp(argv[i], "--relay=splice")) {
+            relay_splice = TRUE;
         }
     }    
 
@@ -371,58 +414,393 @@ static status_t
 
 
 /********************************************************************
-* FUNCTION do_read
+* FUNCTION set_nonblock
 *
-* Read from a FD
+* Set O_NONBLOCK on a FD
 * 
 * INPUTS:
-*              
+*   fd == FD to change
+*   oldflags == address of return file status flags
+*
+* OUTPUTS:
+*   *oldflags == file status flags before the change
+*
 * RETURNS:
-*   return byte count
+*   status
 *********************************************************************/
-static ssize_t
-    do_read (int readfd, 
-             char *readbuff, 
-             size_t readcnt, 
-             status_t *retres)
+static status_t
+    set_nonblock (int fd,
+                  int *oldflags)
 {
-    boolean   readdone;
-    ssize_t   retcnt;
-
-    readdone = FALSE;
-    retcnt = 0;
-    *retres = NO_ERR;
-
-    while (!readdone && *retres == NO_ERR) {
-        retcnt = read(readfd, readbuff, readcnt);
-        if (retcnt < 0) {
-            if (errno != EAGAIN) {
-                SUBSYS_TRACE1( "ERROR: do_read(): read of FD(%d): "
-                               "failed with error: %s\n", 
-                               readfd, strerror( errno  ) );
-                *retres = ERR_NCX_READ_FAILED;
-                continue;
+    *oldflags = fcntl(fd, F_GETFL);
+    if (*oldflags < 0 ||
+        fcntl(fd, F_SETFL, *oldflags | O_NONBLOCK) < 0) {
+        SUBSYS_TRACE1( "ERROR: set_nonblock(): fcntl() of FD(%d) "
+                       "failed with error: %s\n", fd, strerror( errno ) );
+        return ERR_NCX_OPERATION_FAILED;
+    }
+    return NO_ERR;
+
+}  /* set_nonblock */
+
+
+/********************************************************************
+* FUNCTION relay_init
+*
+* Setup one direction of the relay
+* Splice mode is not used if the pipe cannot be created
+* 
+* INPUTS:
+*   relay == relay to setup
+*   name == direction name for trace messages
+*   infd == FD to read from
+*   outfd == FD to write to
+*   usesplice == TRUE to try splice mode
+*
+* RETURNS:
+*   status
+*********************************************************************/
+static status_t
+    relay_init (relay_t *relay,
+                const char *name,
+                int infd,
+                int outfd,
+                boolean usesplice)
+{
+    int  pipesize;
+
+    memset(relay, 0x0, sizeof(relay_t));
+    relay->name = name;
+    relay->infd = infd;
+    relay->outfd = outfd;
+    relay->pipefd[0] = -1;
+    relay->pipefd[1] = -1;
+
+    /* the ring buffer is also needed if splice fails later */
+    relay->buff = m__getMem(RELAY_BUFFLEN);
+    if (!relay->buff) {
+        return ERR_INTERNAL_MEM;
+    }
+
+    if (usesplice) {
+        if (pipe2(relay->pipefd, O_NONBLOCK | O_CLOEXEC) == 0) {
+            /* best effort; the pipe holds 64K if this fails */
+            (void)fcntl(relay->pipefd[1], F_SETPIPE_SZ, RELAY_BUFFLEN);
+            pipesize = fcntl(relay->pipefd[1], F_GETPIPE_SZ);
+            if (pipesize <= 0 || pipesize > RELAY_BUFFLEN) {
+                pipesize = (pipesize <= 0) ? 4096 : RELAY_BUFFLEN;
             }
-        } else if (retcnt == 0) {
-            SUBSYS_TRACE1( "INFO: do_read(): closed connection\n");
-            *retres = ERR_NCX_EOF;
-            readdone = TRUE;
-            continue;
+            relay->pipesize = (size_t)pipesize;
+            relay->usesplice = TRUE;
+        } else {
+            SUBSYS_TRACE1( "ERROR: relay_init(): pipe() failed "
+                           "with error: %s\n", strerror( errno ) );
+        }
+    }
+
+    SUBSYS_TRACE2( "INFO:  relay_init(): %s relay FD %d -> FD %d "
+                   "using %s\n", name, infd, outfd,
+                   relay->usesplice ? "splice" : "readv/writev" );
+
+    return NO_ERR;
+
+}  /* relay_init */
+
+
+/********************************************************************
+* FUNCTION relay_cleanup
+*
+* Free the pipe and buffer of one direction of the relay
+* 
+* INPUTS:
+*   relay == relay to cleanup
+*********************************************************************/
+static void
+    relay_cleanup (relay_t *relay)
+{
+    if (relay->pipefd[0] >= 0) {
+        close(relay->pipefd[0]);
+        relay->pipefd[0] = -1;
+    }
+    if (relay->pipefd[1] >= 0) {
+        close(relay->pipefd[1]);
+        relay->pipefd[1] = -1;
+    }
+    if (relay->buff) {
+        m__free(relay->buff);
+        relay->buff = NULL;
+    }
+
+}  /* relay_cleanup */
+
+
+/********************************************************************
+* FUNCTION relay_stop_splice
+*
+* Switch one direction of the relay to readv/writev, because
+* splice is not supported for one of its FDs.  Any data
+* already in the pipe is moved to the ring buffer
+* 
+* INPUTS:
+*   relay == relay to change
+*
+* RETURNS:
+*   status
+*********************************************************************/
+static status_t
+    relay_stop_splice (relay_t *relay)
+{
+    size_t   got;
+    ssize_t  retcnt;
+
+    SUBSYS_TRACE2( "INFO:  relay_stop_splice(): %s relay using "
+                   "readv/writev: %s\n", relay->name, strerror( errno ) );
+
+    got = 0;
+    while (got < relay->count) {
+        retcnt = read(relay->pipefd[0], &relay->buff[got], 
+                      relay->count - got);
+        if (retcnt <= 0) {
+            return ERR_NCX_READ_FAILED;
+        }
+        got += (size_t)retcnt;
+    }
+    relay->start = 0;
+
+    close(relay->pipefd[0]);
+    close(relay->pipefd[1]);
+    relay->pipefd[0] = -1;
+    relay->pipefd[1] = -1;
+    relay->usesplice = FALSE;
+    return NO_ERR;
+
+}  /* relay_stop_splice */
+
+
+/********************************************************************
+* FUNCTION relay_space
+*
+* Get the number of bytes that can be read into a relay
+* 
+* INPUTS:
+*   relay == relay to check
+*
+* RETURNS:
+*   free space in the pipe or ring buffer
+*********************************************************************/
+static size_t
+    relay_space (const relay_t *relay)
+{
+    if (relay->usesplice) {
+        return relay->pipesize - relay->count;
+    }
+    return RELAY_BUFFLEN - relay->count;
+
+}  /* relay_space */
+
+
+/********************************************************************
+* FUNCTION relay_fill
+*
+* Read as much as fits from the input FD of a relay
+* Sets relay->eof if the input FD is closed
+* 
+* INPUTS:
+*   relay == relay to read into
+*
+* RETURNS:
+*   status
+*********************************************************************/
+static status_t
+    relay_fill (relay_t *relay)
+{
+    struct iovec  iov[2];
+    size_t        space, end;
+    ssize_t       retcnt;
+    int           iovcnt;
+    status_t      res;
+
+    space = relay_space(relay);
+    if (space == 0 || relay->eof) {
+        return NO_ERR;
+    }
+
+    if (relay->usesplice) {
+        retcnt = splice(relay->infd, NULL, relay->pipefd[1], NULL,
+                        space, RELAY_SPLICE_FLAGS);
+        if (retcnt < 0 && (errno == EINVAL || errno == ENOSYS)) {
+            res = relay_stop_splice(relay);
+            if (res != NO_ERR) {
+                return res;
+            }
+            return relay_fill(relay);
+        }
+    } else {
+        end = (relay->start + relay->count) % RELAY_BUFFLEN;
+        iov[0].iov_base = &relay->buff[end];
+        if (end + space > RELAY_BUFFLEN) {
+            iov[0].iov_len = RELAY_BUFFLEN - end;
+            iov[1].iov_base = relay->buff;
+            iov[1].iov_len = space - iov[0].iov_len;
+            iovcnt = 2;
         } else {
-            /* retcnt is the number of bytes read */
-            readdone = TRUE;
+            iov[0].iov_len = space;
+            iovcnt = 1;
+        }
+        retcnt = readv(relay->infd, iov, iovcnt);
+    }
+
+    if (retcnt < 0) {
+        if (errno == EAGAIN || errno == EINTR) {
+            return NO_ERR;
         }
-    }  /*end readdone loop */
+        SUBSYS_TRACE1( "ERROR: relay_fill(): read of FD(%d): "
+                       "failed with error: %s\n", 
+                       relay->infd, strerror( errno ) );
+        return ERR_NCX_READ_FAILED;
+    } else if (retcnt == 0) {
+        SUBSYS_TRACE1( "INFO: relay_fill(): closed connection\n");
+        relay->eof = TRUE;
+    } else {
+        relay->count += (size_t)retcnt;
+    }
+    return NO_ERR;
+
+}  /* relay_fill */
+
+
+/********************************************************************
+* FUNCTION relay_flush
+*
+* Write as much pending data as possible to the output FD
+* of a relay
+* 
+* INPUTS:
+*   relay == relay to write from
+*
+* RETURNS:
+*   status
+*********************************************************************/
+static status_t
+    relay_flush (relay_t *relay)
+{
+    struct iovec  iov[2];
+    ssize_t       retcnt;
+    int           iovcnt;
+    status_t      res;
+
+    if (relay->count == 0) {
+        return NO_ERR;
+    }
+
+    if (relay->usesplice) {
+        retcnt = splice(relay->pipefd[0], NULL, relay->outfd, NULL,
+                        relay->count, RELAY_SPLICE_FLAGS);
+        if (retcnt < 0 && (errno == EINVAL || errno == ENOSYS)) {
+            res = relay_stop_splice(relay);
+            if (res != NO_ERR) {
+                return res;
+            }
+            return relay_flush(relay);
+        }
+    } else {
+        iov[0].iov_base = &relay->buff[relay->start];
+        if (relay->start + relay->count > RELAY_BUFFLEN) {
+            iov[0].iov_len = RELAY_BUFFLEN - relay->start;
+            iov[1].iov_base = relay->buff;
+            iov[1].iov_len = relay->count - iov[0].iov_len;
+            iovcnt = 2;
+        } else {
+            iov[0].iov_len = relay->count;
+            iovcnt = 1;
+        }
+        retcnt = writev(relay->outfd, iov, iovcnt);
+    }
+
+    if (retcnt < 0) {
+        if (errno == EAGAIN || errno == EINTR) {
+            return NO_ERR;
+        }
+        SUBSYS_TRACE1( "ERROR: relay_flush(): write to %s FD(%d) "
+                       "failed with %s\n", relay->name, relay->outfd,
+                       strerror( errno ) );
+        return errno_to_status();
+    }
+
+    relay->count -= (size_t)retcnt;
+    relay->bytes += (uint64)retcnt;
+    if (relay->usesplice || relay->count == 0) {
+        relay->start = 0;
+    } else {
+        relay->start = (relay->start + (size_t)retcnt) % RELAY_BUFFLEN;
+    }
+    return NO_ERR;
+
+}  /* relay_flush */
+
+
+/********************************************************************
+* FUNCTION relay_set_poll
+*
+* Set the poll events for one direction of the relay
+* Input is only polled while there is room to read into,
+* and output only while there is data to write
+* 
+* INPUTS:
+*   relay == relay to check
+*   pfd == array of 2 pollfd entries for infd and outfd
+*********************************************************************/
+static void
+    relay_set_poll (const relay_t *relay,
+                    struct pollfd *pfd)
+{
+    pfd[0].fd = (!relay->eof && relay_space(relay)) ? relay->infd : -1;
+    pfd[0].events = POLLIN;
+    pfd[0].revents = 0;
+    pfd[1].fd = (relay->count) ? relay->outfd : -1;
+    pfd[1].events = POLLOUT;
+    pfd[1].revents = 0;
+
+}  /* relay_set_poll */
+
+
+/********************************************************************
+* FUNCTION relay_do_io
+*
+* Handle the poll events for one direction of the relay
+* Data that was read is written right away if possible
+* 
+* INPUTS:
+*   relay == relay to use
+*   pfd == array of 2 pollfd entries set by relay_set_poll
+*
+* RETURNS:
+*   status
+*********************************************************************/
+static status_t
+    relay_do_io (relay_t *relay,
+                 const struct pollfd *pfd)
+{
+    status_t  res;
 
-    return retcnt;
+    res = NO_ERR;
+    if (pfd[0].revents) {
+        res = relay_fill(relay);
+    }
+    if (res == NO_ERR && (pfd[0].revents || pfd[1].revents)) {
+        res = relay_flush(relay);
+    }
+    return res;
 
-}  /* do_read */
+}  /* relay_do_io */
 
 
 /********************************************************************
 * FUNCTION io_loop
 *
 * Handle the IO for the program
+* Relays data between STDIN/STDOUT and the ncxserver socket
+* until either side closes its connection
 * 
 * INPUTS:
 *              
@@ -432,95 +810,75 @@ static ssize_t
 static status_t
     io_loop (void)
 {
-    status_t  res;
-    boolean   done;
-    fd_set    fds;
-    int       ret;
-    ssize_t   retcnt;
+    relay_t        toserver, toclient;
+    struct pollfd  pfd[4];
+    status_t       res, res2;
+    int            ret, inflags, outflags, sockflags;
+
+    inflags = outflags = -1;
+
+    /* always init both, so both can be cleaned up */
+    res = relay_init(&toserver, "ncxserver", STDIN_FILENO, ncxsock, 
+                     relay_splice);
+    res2 = relay_init(&toclient, "client", ncxsock, STDOUT_FILENO,
+                      relay_splice);
+    if (res == NO_ERR) {
+        res = res2;
+    }
+    if (res == NO_ERR) {
+        res = set_nonblock(STDIN_FILENO, &inflags);
+    }
+    if (res == NO_ERR) {
+        res = set_nonblock(STDOUT_FILENO, &outflags);
+    }
+    if (res == NO_ERR) {
+        res = set_nonblock(ncxsock, &sockflags);
+    }
 
-    res = NO_ERR;
-    done = FALSE;
-    FD_ZERO(&fds);
+    while (res == NO_ERR) {
+        if ((toserver.eof && toserver.count == 0) ||
+            (toclient.eof && toclient.count == 0)) {
+            break;
+        }
 
-    while (!done) {
-        FD_SET(STDIN_FILENO, &fds);
-        FD_SET(ncxsock, &fds);
+        relay_set_poll(&toserver, &pfd[0]);
+        relay_set_poll(&toclient, &pfd[2]);
 
-        ret = select(FD_SETSIZE, &fds, NULL, NULL, NULL);
+        ret = poll(pfd, 4, -1);
         if (ret < 0) {
             if ( errno != EINTR ) {
-                SUBSYS_TRACE1( "ERROR: io_loop(): select() "
+                SUBSYS_TRACE1( "ERROR: io_loop(): poll() "
                                "failed with error: %s\n", strerror( errno ) );
                 res = ERR_NCX_OPERATION_FAILED;
-                done = TRUE;
-            }
-            else
-            {
-                SUBSYS_TRACE2( "INFO: io_loop(): select() "
-                               "failed with error: %s\n", strerror( errno  ) );
+            } else {
+                SUBSYS_TRACE2( "INFO: io_loop(): poll() "
+                               "failed with error: %s\n", strerror( errno ) );
             }
             continue;
-        } else if (ret == 0) {
-            SUBSYS_TRACE1( "ERROR: io_loop(): select() "
-                           "returned 0, exiting...\n" );
-            res = NO_ERR;
-            done = TRUE;
-            continue;
-        } /* else some IO to process */
-
-        /* check any input from client */
-        if (FD_ISSET(STDIN_FILENO, &fds)) {
-            /* get buff from openssh */
-            retcnt = do_read(STDIN_FILENO, 
-                             msgbuff, 
-                             (size_t)BUFFLEN,
-                             &res);
-
-            if (res == ERR_NCX_EOF) {
-                res = NO_ERR;
-                done = TRUE;
-                continue;
-            } else if (res == ERR_NCX_SKIPPED) {
-                res = NO_ERR;
-            } else if (res == NO_ERR && retcnt > 0) {
-                /* send this buffer to the ncxserver */
-                res = send_buff(ncxsock, msgbuff, (size_t)retcnt);
-                if (res != NO_ERR) {
-                    SUBSYS_TRACE1( "ERROR: io_loop(): send_buff() to ncxserver "
-                                   "failed with %s\n", strerror( errno ) );
-                    done = TRUE;
-                    continue;
-                }
-            }
-        }  /* if STDIN set */
-
-        /* check any input from the ncxserver */
-        if (FD_ISSET(ncxsock, &fds)) {
-            res = NO_ERR;
-            retcnt = do_read(ncxsock, 
-                             msgbuff, 
-                             (size_t)BUFFLEN,
-                             &res);
-
-            if (res == ERR_NCX_EOF) {
-                res = NO_ERR;
-                done = TRUE;
-                continue;
-            } else if (res == ERR_NCX_SKIPPED) {
-                res = NO_ERR;
-            } else if (res == NO_ERR && retcnt > 0) {
-                /* send this buffer to STDOUT */
-                res = send_buff(STDOUT_FILENO, msgbuff, (size_t)retcnt);
-                if (res != NO_ERR) {
-                    SUBSYS_TRACE1( "ERROR: io_loop(): send_buff() to client "
-                                   "failed with %s\n", strerror( errno ) );
-                    done = TRUE;
-                    continue;
-                }
-            }
+        }
+
+        res = relay_do_io(&toserver, &pfd[0]);
+        if (res == NO_ERR) {
+            res = relay_do_io(&toclient, &pfd[2]);
         }
     }
 
+    SUBSYS_TRACE1( "INFO: io_loop(): %llu bytes sent to ncxserver, "
+                   "%llu bytes sent to client\n",
+                   (unsigned long long)toserver.bytes,
+                   (unsigned long long)toclient.bytes );
+
+    /* STDIN and STDOUT may be shared with the parent process */
+    if (inflags >= 0) {
+        (void)fcntl(STDIN_FILENO, F_SETFL, inflags);
+    }
+    if (outflags >= 0) {
+        (void)fcntl(STDOUT_FILENO, F_SETFL, outflags);
+    }
+
+    relay_cleanup(&toserver);
+    relay_cleanup(&toclient);
+
     return res;
 
 } /* io_loop */
@@ -44,6 +44,7 @@ date         init     comment
 #include <ctype.h>
 #include <time.h>
 #include <sys/time.h>
+#include <sys/stat.h>
 #include <assert.h>
 
 /* #define MEMORY_DEBUG 1 */
@@ -80,6 +81,7 @@ date         init     comment
 #include "rpc.h"
 #include "runstack.h"
 #include "status.h"
+#include "tk.h"
 #include "val.h"
 #include "val_util.h"
 #include "var.h"
@@ -233,6 +235,11 @@ static uint32          default_timeout;
  */
 static boolean         keep_session_model_copies_after_compilation;
 
+/* directory for the persistent autoload schema cache;
+ * NULL if --schema-cache not present
+ */
+static xmlChar        *schema_cache;
+
 /* default value for val_dump_value display mode */
 static ncx_display_mode_t   display_mode;
 
@@ -475,6 +482,9 @@ void
     if (server_cb->history_line) {
         m__free(server_cb->history_line);
     }
+    if (server_cb->schema_cache_setid) {
+        m__free(server_cb->schema_cache_setid);
+    }
 
     if (server_cb->connect_valset) {
         val_free_value(server_cb->connect_valset);
@@ -666,6 +676,7 @@ server_cb_t *
     server_cb->log_level = log_get_debug_level();
     server_cb->autoload = autoload;
     server_cb->keep_session_model_copies_after_compilation = keep_session_model_copies_after_compilation;
+    server_cb->schema_cache = schema_cache;
     server_cb->fixorder = fixorder;
     server_cb->get_optional = optional;
     server_cb->testoption = testoption;
@@ -712,6 +723,7 @@ void
     server_cb->log_level = log_get_debug_level();
     server_cb->autoload = autoload;
     server_cb->keep_session_model_copies_after_compilation = keep_session_model_copies_after_compilation;
+    server_cb->schema_cache = schema_cache;
     server_cb->fixorder = fixorder;
     server_cb->get_optional = optional;
     server_cb->testoption = testoption;
@@ -2053,6 +2065,32 @@ status_t
 } /* init_config_vars */
 
 
+/********************************************************************
+* FUNCTION setup_schema_cache
+*
+* Create the --schema-cache directory
+*
+* INPUTS:
+*    dir == schema cache directory
+*
+* RETURNS:
+*    status
+*********************************************************************/
+static status_t
+    setup_schema_cache (const xmlChar *dir)
+{
+    if (mkdir((const char *)dir, 0755) != 0 && errno != EEXIST) {
+        log_error("\nError: schema cache directory '%s' not created (%s)",
+                  dir,
+                  strerror(errno));
+        return ERR_NCX_OPERATION_FAILED;
+    }
+
+    return NO_ERR;
+
+}  /* setup_schema_cache */
+
+
 /********************************************************************
 * FUNCTION process_cli_input
 *
@@ -2232,6 +2270,16 @@ status_t
         keep_session_model_copies_after_compilation = FALSE;
     }
 
+    /* get the schema-cache parameter */
+    schema_cache = get_strparm(mgr_cli_valset, YANGCLI_EX_MOD, 
+                               YANGCLI_SCHEMA_CACHE);
+    if (schema_cache) {
+        res = setup_schema_cache(schema_cache);
+        if (res != NO_ERR) {
+            return res;
+        }
+    }
+
     /* get the autouservars parameter */
     parm = val_find_child(mgr_cli_valset, YANGCLI_MOD, YANGCLI_AUTOUSERVARS);
     if (parm && parm->res == NO_ERR) {
@@ -3026,6 +3074,19 @@ void
                   get_error_string(res));
     }
 
+    /* use the schema cache files saved for this module set
+     * instead of <get-schema>, if --schema-cache is present
+     */
+    if (res == NO_ERR &&
+        server_cb->autoload &&
+        server_cb->schema_cache) {
+        res = autoload_schema_cache_lookup(server_cb, scb);
+        if (res != NO_ERR) {
+            log_error("\nError: autoload schema cache lookup failed (%s)",
+                      get_error_string(res));
+        }
+    }
+
     /* go through all the search results (if any)
      * and see if <get-schema> is needed to pre-load
      * the session work directory YANG files
@@ -3792,6 +3853,7 @@ void yangcli_init_module_static_vars()
     connect_valset = NULL;
     confname = NULL;
     default_module = NULL;
+    schema_cache = NULL;
     default_timeout = 30;
     display_mode = NCX_DISPLAY_MODE_PLAIN;
     fixorder = TRUE;
@@ -4173,6 +4235,11 @@ static void
         default_module = NULL;
     }
 
+    if (schema_cache) {
+        m__free(schema_cache);
+        schema_cache = NULL;
+    }
+
     if (confname) {
         m__free(confname);
         confname = NULL;
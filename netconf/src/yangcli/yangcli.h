@@ -231,6 +231,7 @@ extern "C" {
 
 #define YANGCLI_KEEP_SESSION_MODEL_COPIES_AFTER_COMPILATION    (const xmlChar *)"keep-session-model-copies-after-compilation"
 #define YANGCLI_DUMP_SESSION  (const xmlChar *)"dump-session"
+#define YANGCLI_SCHEMA_CACHE  (const xmlChar *)"schema-cache"
 
 /* YANGCLI local RPC commands */
 #define YANGCLI_ALIAS   (const xmlChar *)"alias"
@@ -441,6 +442,7 @@ typedef struct server_cb_t_ {
     log_debug_t          log_level;
     boolean              autoload;
     boolean              keep_session_model_copies_after_compilation;
+    const xmlChar       *schema_cache;
     boolean              fixorder;
     op_testop_t          testoption;
     op_errop_t           erroption;
@@ -503,6 +505,9 @@ typedef struct server_cb_t_ {
     ncxmod_temp_progcb_t *temp_progcb;
     ncxmod_temp_sescb_t  *temp_sescb;
 
+    /* schema cache index key for the current session module set */
+    xmlChar             *schema_cache_setid;
+
     /* runstack context for script processing */
     runstack_context_t  *runstack_context;
 
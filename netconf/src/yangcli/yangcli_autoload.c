@@ -42,6 +42,8 @@ date         init     comment
 #include <stdio.h>
 #include <ctype.h>
 #include <assert.h>
+#include <sys/stat.h>
+#include <openssl/sha.h>
 #include "libtecla.h"
 
 #include "procdefs.h"
@@ -74,6 +76,12 @@ date         init     comment
 #define YANGCLI_AUTOLOAD_DEBUG 1
 #endif
 
+/* length of a schema cache digest string (SHA-1 in hex) */
+#define SCHEMA_CACHE_DIGEST_LEN    (SHA_DIGEST_LENGTH * 2)
+
+/* file name suffix of a schema cache module set index */
+#define SCHEMA_CACHE_INDEX_SUFFIX  ".set"
+
 /********************************************************************
 * FUNCTION make_get_schema_reqdata
 * 
@@ -563,6 +571,481 @@ static status_t
 }   /* copy_module_to_tempdir */
 
 
+/********************************************************************
+* FUNCTION make_schema_cache_fspec
+* 
+* Get a schema cache filespec
+* The file name is <module>@<revision>-<digest><suffix>,
+* or <digest><suffix> if module is NULL
+*
+* INPUTS:
+*   dir == schema cache directory
+*   module == module name (may be NULL)
+*   revision == revision date (may be NULL)
+*   digest == hex digest string
+*   suffix == file name suffix
+*
+* RETURNS:
+*   malloced filespec or NULL if malloc error
+*********************************************************************/
+static xmlChar *
+    make_schema_cache_fspec (const xmlChar *dir,
+                             const xmlChar *module,
+                             const xmlChar *revision,
+                             const char *digest,
+                             const char *suffix)
+{
+    xmlChar  *fspec, *str;
+    uint32    len;
+
+    len = xml_strlen(dir) + strlen(digest) + strlen(suffix) + 1;
+    if (module) {
+        len += xml_strlen(module) + 1;
+        if (revision) {
+            len += xml_strlen(revision) + 1;
+        }
+    }
+
+    fspec = m__getMem(len + 1);
+    if (fspec == NULL) {
+        return NULL;
+    }
+
+    str = fspec;
+    str += xml_strcpy(str, dir);
+    *str++ = '/';
+    if (module) {
+        str += xml_strcpy(str, module);
+        if (revision) {
+            *str++ = '@';
+            str += xml_strcpy(str, revision);
+        }
+        *str++ = '-';
+    }
+    str += xml_strcpy(str, (const xmlChar *)digest);
+    xml_strcpy(str, (const xmlChar *)suffix);
+    return fspec;
+
+}  /* make_schema_cache_fspec */
+
+
+/********************************************************************
+* FUNCTION make_schema_digest
+* 
+* Get the SHA-1 digest of a buffer as a hex string
+*
+* INPUTS:
+*   buff == buffer to check
+*   bufflen == number of bytes in buff
+*   digest == buffer of at least SCHEMA_CACHE_DIGEST_LEN+1 bytes
+*
+* OUTPUTS:
+*   *digest filled in with the zero-terminated hex string
+*********************************************************************/
+static void
+    make_schema_digest (const xmlChar *buff,
+                        size_t bufflen,
+                        char *digest)
+{
+    unsigned char  hash[SHA_DIGEST_LENGTH];
+    uint32         i;
+
+    SHA1(buff, bufflen, hash);
+    for (i = 0; i < SHA_DIGEST_LENGTH; i++) {
+        sprintf(&digest[i*2], "%02x", hash[i]);
+    }
+
+}  /* make_schema_digest */
+
+
+/********************************************************************
+* FUNCTION read_schema_file
+* 
+* Read a YANG file into a buffer and get its digest
+*
+* INPUTS:
+*   filespec == YANG file to read
+*   buff == address of return buffer
+*   bufflen == address of return buffer length
+*   digest == buffer of at least SCHEMA_CACHE_DIGEST_LEN+1 bytes
+*
+* OUTPUTS:
+*   *buff == malloced file contents
+*   *bufflen == length of *buff
+*   *digest filled in with the hex digest of the file
+*
+* RETURNS:
+*   status
+*********************************************************************/
+static status_t
+    read_schema_file (const xmlChar *filespec,
+                      xmlChar **buff,
+                      size_t *bufflen,
+                      char *digest)
+{
+    struct stat   statbuf;
+    FILE         *fp;
+    status_t      res;
+
+    *buff = NULL;
+    *bufflen = 0;
+
+    fp = fopen((const char *)filespec, "r");
+    if (fp == NULL) {
+        return errno_to_status();
+    }
+
+    if (fstat(fileno(fp), &statbuf) != 0) {
+        res = errno_to_status();
+        fclose(fp);
+        return res;
+    }
+
+    *buff = m__getMem((size_t)statbuf.st_size + 1);
+    if (*buff == NULL) {
+        fclose(fp);
+        return ERR_INTERNAL_MEM;
+    }
+
+    *bufflen = fread(*buff, 1, (size_t)statbuf.st_size, fp);
+    fclose(fp);
+    if (*bufflen != (size_t)statbuf.st_size) {
+        m__free(*buff);
+        *buff = NULL;
+        return ERR_FIL_READ;
+    }
+
+    make_schema_digest(*buff, *bufflen, digest);
+    return NO_ERR;
+
+}  /* read_schema_file */
+
+
+/********************************************************************
+* FUNCTION write_schema_cache_file
+* 
+* Write a schema cache file
+* A temporary file is written and renamed, so other
+* yangcli instances never read a partial file
+*
+* INPUTS:
+*   fspec == schema cache file to write
+*   buff == file contents
+*   bufflen == length of buff
+*
+* RETURNS:
+*   status
+*********************************************************************/
+static status_t
+    write_schema_cache_file (const xmlChar *fspec,
+                             const xmlChar *buff,
+                             size_t bufflen)
+{
+    char      *tempname;
+    FILE      *fp;
+    status_t   res;
+
+    tempname = m__getMem(xml_strlen(fspec) + 16);
+    if (tempname == NULL) {
+        return ERR_INTERNAL_MEM;
+    }
+    sprintf(tempname, "%s.%u", (const char *)fspec, (uint32)getpid());
+
+    res = NO_ERR;
+    fp = fopen(tempname, "w");
+    if (fp == NULL) {
+        res = errno_to_status();
+    } else {
+        if (fwrite(buff, 1, bufflen, fp) != bufflen) {
+            res = ERR_FIL_WRITE;
+        }
+        if (fclose(fp) != 0 && res == NO_ERR) {
+            res = ERR_FIL_WRITE;
+        }
+        if (res == NO_ERR &&
+            rename(tempname, (const char *)fspec) != 0) {
+            res = errno_to_status();
+        }
+        if (res != NO_ERR) {
+            unlink(tempname);
+        }
+    }
+
+    m__free(tempname);
+    return res;
+
+}  /* write_schema_cache_file */
+
+
+/********************************************************************
+* FUNCTION make_schema_set_id
+* 
+* Get the schema cache index key for the module set
+* advertised by the server
+*
+* The key is the digest of the yang-library module-set-id,
+* if any, and the module name and revision of each
+* search result record
+*
+* INPUTS:
+*   server_cb == server control block to use
+*   mscb == manager session control block to use
+*   digest == buffer of at least SCHEMA_CACHE_DIGEST_LEN+1 bytes
+*
+* OUTPUTS:
+*   *digest filled in with the hex key string
+*
+* RETURNS:
+*   status
+*********************************************************************/
+static status_t
+    make_schema_set_id (server_cb_t *server_cb,
+                        mgr_scb_t *mscb,
+                        char *digest)
+{
+    ncxmod_search_result_t  *searchresult;
+    val_value_t             *setidval;
+    xmlChar                 *buff, *str;
+    uint32                   len;
+
+    setidval = NULL;
+    if (mscb->modules_state_val) {
+        setidval = val_find_child(mscb->modules_state_val,
+                                  (const xmlChar *)"ietf-yang-library",
+                                  (const xmlChar *)"module-set-id");
+    }
+
+    len = 0;
+    if (setidval) {
+        len += xml_strlen(VAL_STRING(setidval)) + 1;
+    }
+    for (searchresult = (ncxmod_search_result_t *)
+             dlq_firstEntry(&server_cb->searchresultQ);
+         searchresult != NULL;
+         searchresult = (ncxmod_search_result_t *)
+             dlq_nextEntry(searchresult)) {
+        if (searchresult->module) {
+            len += xml_strlen(searchresult->module) + 2;
+        }
+        if (searchresult->revision) {
+            len += xml_strlen(searchresult->revision);
+        }
+    }
+
+    buff = m__getMem(len + 1);
+    if (buff == NULL) {
+        return ERR_INTERNAL_MEM;
+    }
+
+    str = buff;
+    if (setidval) {
+        str += xml_strcpy(str, VAL_STRING(setidval));
+        *str++ = '\n';
+    }
+    for (searchresult = (ncxmod_search_result_t *)
+             dlq_firstEntry(&server_cb->searchresultQ);
+         searchresult != NULL;
+         searchresult = (ncxmod_search_result_t *)
+             dlq_nextEntry(searchresult)) {
+        if (searchresult->module) {
+            str += xml_strcpy(str, searchresult->module);
+            *str++ = '@';
+            if (searchresult->revision) {
+                str += xml_strcpy(str, searchresult->revision);
+            }
+            *str++ = '\n';
+        }
+    }
+
+    make_schema_digest(buff, (size_t)(str - buff), digest);
+    m__free(buff);
+    return NO_ERR;
+
+}  /* make_schema_set_id */
+
+
+/********************************************************************
+* FUNCTION update_schema_cache
+* 
+* Save the modules retrieved with <get-schema> in the
+* schema cache and write the index file for the
+* current module set
+*
+* Errors are reported as warnings; the schema cache
+* is not needed to compile the session modules
+*
+* INPUTS:
+*   server_cb == server control block to use
+*   mscb == manager session control block to use
+*********************************************************************/
+static void
+    update_schema_cache (server_cb_t *server_cb,
+                         mgr_scb_t *mscb)
+{
+    ncxmod_search_result_t  *searchresult;
+    xmlChar                 *buff, *fspec, *indexfspec;
+    const xmlChar           *cachedir, *sesdir;
+    char                    *tempname;
+    FILE                    *fp;
+    size_t                   bufflen;
+    uint32                   cachedirlen, sesdirlen, srclen, retrieved;
+    struct stat              statbuf;
+    boolean                  incache;
+    status_t                 res;
+    char                     digest[SCHEMA_CACHE_DIGEST_LEN+1];
+
+    cachedir = server_cb->schema_cache;
+    if (cachedir == NULL ||
+        server_cb->schema_cache_setid == NULL ||
+        mscb->temp_sescb == NULL) {
+        return;
+    }
+
+    cachedirlen = xml_strlen(cachedir);
+    sesdir = mscb->temp_sescb->source;
+    sesdirlen = xml_strlen(sesdir);
+
+    /* the index only changes if some module was retrieved */
+    retrieved = 0;
+    for (searchresult = (ncxmod_search_result_t *)
+             dlq_firstEntry(&server_cb->searchresultQ);
+         searchresult != NULL;
+         searchresult = (ncxmod_search_result_t *)
+             dlq_nextEntry(searchresult)) {
+        if (searchresult->source &&
+            !xml_strncmp(searchresult->source, sesdir, sesdirlen)) {
+            retrieved++;
+        }
+    }
+    if (retrieved == 0) {
+        return;
+    }
+
+    indexfspec = make_schema_cache_fspec(cachedir,
+                                         NULL,
+                                         NULL,
+                                         (const char *)
+                                         server_cb->schema_cache_setid,
+                                         SCHEMA_CACHE_INDEX_SUFFIX);
+    if (indexfspec == NULL) {
+        log_warn("\nWarning: schema cache not updated (%s)",
+                 get_error_string(ERR_INTERNAL_MEM));
+        return;
+    }
+    tempname = m__getMem(xml_strlen(indexfspec) + 16);
+    if (tempname == NULL) {
+        log_warn("\nWarning: schema cache not updated (%s)",
+                 get_error_string(ERR_INTERNAL_MEM));
+        m__free(indexfspec);
+        return;
+    }
+    sprintf(tempname, "%s.%u", (const char *)indexfspec, (uint32)getpid());
+
+    fp = fopen(tempname, "w");
+    if (fp == NULL) {
+        log_warn("\nWarning: schema cache index '%s' not written (%s)",
+                 tempname,
+                 get_error_string(errno_to_status()));
+        m__free(tempname);
+        m__free(indexfspec);
+        return;
+    }
+
+    res = NO_ERR;
+    for (searchresult = (ncxmod_search_result_t *)
+             dlq_firstEntry(&server_cb->searchresultQ);
+         searchresult != NULL;
+         searchresult = (ncxmod_search_result_t *)
+             dlq_nextEntry(searchresult)) {
+
+        if (searchresult->module == NULL ||
+            searchresult->source == NULL) {
+            continue;
+        }
+
+        /* modules found in the local search path are not cached */
+        incache = (!xml_strncmp(searchresult->source, 
+                                cachedir, 
+                                cachedirlen) &&
+                   searchresult->source[cachedirlen] == '/') ?
+            TRUE : FALSE;
+        if (!incache &&
+            xml_strncmp(searchresult->source, sesdir, sesdirlen)) {
+            continue;
+        }
+
+        if (incache) {
+            /* the digest is part of the cached file name */
+            srclen = xml_strlen(searchresult->source);
+            if (srclen < SCHEMA_CACHE_DIGEST_LEN + 5) {
+                continue;
+            }
+            memcpy(digest,
+                   &searchresult->source[srclen - 
+                                         SCHEMA_CACHE_DIGEST_LEN - 5],
+                   SCHEMA_CACHE_DIGEST_LEN);
+            digest[SCHEMA_CACHE_DIGEST_LEN] = 0;
+        } else {
+            res = read_schema_file(searchresult->source,
+                                   &buff,
+                                   &bufflen,
+                                   digest);
+            if (res != NO_ERR) {
+                log_warn("\nWarning: '%s' not saved in schema cache (%s)",
+                         searchresult->source,
+                         get_error_string(res));
+                continue;
+            }
+
+            fspec = make_schema_cache_fspec(cachedir,
+                                            searchresult->module,
+                                            searchresult->revision,
+                                            digest,
+                                            ".yang");
+            if (fspec == NULL) {
+                res = ERR_INTERNAL_MEM;
+            } else if (stat((const char *)fspec, &statbuf) != 0) {
+                res = write_schema_cache_file(fspec, buff, bufflen);
+                if (res == NO_ERR && LOGDEBUG) {
+                    log_debug("\nautoload: saved '%s' in schema cache",
+                              fspec);
+                }
+            }
+            m__free(buff);
+            if (fspec) {
+                m__free(fspec);
+            }
+            if (res != NO_ERR) {
+                log_warn("\nWarning: '%s' not saved in schema cache (%s)",
+                         searchresult->source,
+                         get_error_string(res));
+                continue;
+            }
+        }
+
+        fprintf(fp, 
+                "%s %s %s\n",
+                searchresult->module,
+                (searchresult->revision) ? 
+                (const char *)searchresult->revision : "-",
+                digest);
+    }
+
+    if (fclose(fp) != 0 ||
+        rename(tempname, (const char *)indexfspec) != 0) {
+        log_warn("\nWarning: schema cache index '%s' not written",
+                 indexfspec);
+        unlink(tempname);
+    } else if (LOGDEBUG) {
+        log_debug("\nautoload: wrote schema cache index '%s'", indexfspec);
+    }
+
+    m__free(tempname);
+    m__free(indexfspec);
+
+}  /* update_schema_cache */
+
+
 /********************************************************************
 * FUNCTION set_temp_ync_features
 * 
@@ -899,6 +1382,200 @@ status_t
 }  /* autoload_setup_tempdir */
 
 
+/********************************************************************
+* FUNCTION autoload_schema_cache_lookup
+* 
+* Check the --schema-cache index file for the module set
+* advertised by the server, and copy the cached YANG files
+* into the session temp files directory
+*
+* The search records for these modules get the 'source'
+* field set to the cached file, so no <get-schema> is
+* sent for them
+*
+* INPUTS:
+*   server_cb == server session control block to use
+*   scb == current session in progress
+*
+* OUTPUTS:
+*   $HOME/.yuma/tmp/<progdir>/<sesdir>/ filled with
+*   the cached YANG files for this module set
+*
+*   server_cb->schema_cache_setid set to the index key
+*   for the module set
+*
+* RETURNS:
+*    status
+*********************************************************************/
+status_t
+    autoload_schema_cache_lookup (server_cb_t *server_cb,
+                                  ses_cb_t *scb)
+{
+    mgr_scb_t               *mscb;
+    ncxmod_search_result_t  *searchresult;
+    xmlChar                 *indexfspec, *fspec, *linebuffer;
+    xmlChar                 *module, *revision, *digest, *str;
+    FILE                    *fp;
+    struct stat              statbuf;
+    uint32                   found;
+    status_t                 res, retres;
+    char                     setid[SCHEMA_CACHE_DIGEST_LEN+1];
+
+#ifdef DEBUG
+    if (!server_cb || !scb) {
+        return SET_ERROR(ERR_INTERNAL_PTR);
+    }
+#endif
+
+    mscb = (mgr_scb_t *)scb->mgrcb;
+
+    if (server_cb->schema_cache_setid) {
+        m__free(server_cb->schema_cache_setid);
+        server_cb->schema_cache_setid = NULL;
+    }
+
+    if (server_cb->schema_cache == NULL ||
+        dlq_empty(&server_cb->searchresultQ)) {
+        return NO_ERR;
+    }
+
+    res = make_schema_set_id(server_cb, mscb, setid);
+    if (res != NO_ERR) {
+        return res;
+    }
+
+    server_cb->schema_cache_setid = xml_strdup((const xmlChar *)setid);
+    if (server_cb->schema_cache_setid == NULL) {
+        return ERR_INTERNAL_MEM;
+    }
+
+    indexfspec = make_schema_cache_fspec(server_cb->schema_cache,
+                                         NULL,
+                                         NULL,
+                                         setid,
+                                         SCHEMA_CACHE_INDEX_SUFFIX);
+    if (indexfspec == NULL) {
+        return ERR_INTERNAL_MEM;
+    }
+
+    fp = fopen((const char *)indexfspec, "r");
+    if (fp == NULL) {
+        if (LOGDEBUG) {
+            log_debug("\nautoload: no schema cache index '%s'",
+                      indexfspec);
+        }
+        m__free(indexfspec);
+        return NO_ERR;
+    }
+
+    linebuffer = m__getMem(NCX_MAX_LINELEN+1);
+    if (linebuffer == NULL) {
+        fclose(fp);
+        m__free(indexfspec);
+        return ERR_INTERNAL_MEM;
+    }
+
+    found = 0;
+    retres = NO_ERR;
+    while (fgets((char *)linebuffer, NCX_MAX_LINELEN, fp)) {
+
+        /* each line is '<module> <revision or -> <digest>' */
+        module = linebuffer;
+        revision = (xmlChar *)strchr((const char *)module, ' ');
+        if (revision == NULL) {
+            continue;
+        }
+        *revision++ = 0;
+        digest = (xmlChar *)strchr((const char *)revision, ' ');
+        if (digest == NULL) {
+            continue;
+        }
+        *digest++ = 0;
+        str = (xmlChar *)strchr((const char *)digest, '\n');
+        if (str) {
+            *str = 0;
+        }
+        if (xml_strlen(digest) != SCHEMA_CACHE_DIGEST_LEN) {
+            continue;
+        }
+        if (!xml_strcmp(revision, (const xmlChar *)"-")) {
+            revision = NULL;
+        }
+
+        /* find the module that would be retrieved with <get-schema> */
+        for (searchresult = (ncxmod_search_result_t *)
+                 dlq_firstEntry(&server_cb->searchresultQ);
+             searchresult != NULL;
+             searchresult = (ncxmod_search_result_t *)
+                 dlq_nextEntry(searchresult)) {
+
+            if (searchresult->source != NULL ||
+                !(searchresult->res == ERR_NCX_WRONG_VERSION ||
+                  searchresult->res == ERR_NCX_MOD_NOT_FOUND)) {
+                continue;
+            }
+            if (searchresult->module == NULL ||
+                xml_strcmp(searchresult->module, module)) {
+                continue;
+            }
+            if (searchresult->revision == NULL && revision == NULL) {
+                break;
+            }
+            if (searchresult->revision && revision &&
+                !xml_strcmp(searchresult->revision, revision)) {
+                break;
+            }
+        }
+        if (searchresult == NULL) {
+            continue;
+        }
+
+        fspec = make_schema_cache_fspec(server_cb->schema_cache,
+                                        module,
+                                        revision,
+                                        (const char *)digest,
+                                        ".yang");
+        if (fspec == NULL) {
+            retres = ERR_INTERNAL_MEM;
+            break;
+        }
+        if (stat((const char *)fspec, &statbuf) != 0) {
+            /* removed from the cache; use <get-schema> */
+            m__free(fspec);
+            continue;
+        }
+
+        res = copy_module_to_tempdir(mscb, module, revision, fspec);
+        if (res != NO_ERR) {
+            searchresult->res = res;
+            retres = res;
+            m__free(fspec);
+            continue;
+        }
+
+        if (LOGDEBUG2) {
+            log_debug2("\nautoload: using schema cache file '%s'", fspec);
+        }
+        searchresult->source = fspec;
+        found++;
+    }
+
+    fclose(fp);
+    m__free(linebuffer);
+    m__free(indexfspec);
+
+    if (found && LOGINFO) {
+        log_info("\nUsing %u module%s from schema cache '%s'\n",
+                 found,
+                 (found == 1) ? "" : "s",
+                 server_cb->schema_cache);
+    }
+
+    return retres;
+
+}  /* autoload_schema_cache_lookup */
+
+
 /********************************************************************
 * FUNCTION autoload_start_get_modules
 * 
@@ -1167,6 +1844,11 @@ status_t
     res = NO_ERR;
     mscb = (mgr_scb_t *)scb->mgrcb;
 
+    /* save any retrieved modules in the schema cache
+     * before the session work directory is removed
+     */
+    update_schema_cache(server_cb, mscb);
+
     /* set the alternate path to point at the
      * session work directory; this will cause
      * the server revision date of each module to be
@@ -87,6 +87,36 @@ extern status_t
                             ses_cb_t *scb);
 
 
+/********************************************************************
+* FUNCTION autoload_schema_cache_lookup
+* 
+* Check the --schema-cache index file for the module set
+* advertised by the server, and copy the cached YANG files
+* into the session temp files directory
+*
+* The search records for these modules get the 'source'
+* field set to the cached file, so no <get-schema> is
+* sent for them
+*
+* INPUTS:
+*   server_cb == server session control block to use
+*   scb == current session in progress
+*
+* OUTPUTS:
+*   $HOME/.yuma/tmp/<progdir>/<sesdir>/ filled with
+*   the cached YANG files for this module set
+*
+*   server_cb->schema_cache_setid set to the index key
+*   for the module set
+*
+* RETURNS:
+*    status
+*********************************************************************/
+extern status_t
+    autoload_schema_cache_lookup (server_cb_t *server_cb,
+                                  ses_cb_t *scb);
+
+
 /********************************************************************
 * FUNCTION autoload_start_get_modules
 * 
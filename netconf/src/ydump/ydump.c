@@ -49,6 +49,7 @@ date         init     comment
 #include "sql.h"
 #include "status.h"
 #include "tg2.h"
+#include "tk.h"
 #include "val.h"
 #include "val_util.h"
 #include "xmlns.h"
@@ -1868,6 +1869,100 @@ static status_t
 }  /* subtree_callback */
 
 
+/********************************************************************
+ * FUNCTION prefetch_callback
+ * 
+ * Queue the current filename in the subtree traversal
+ * for the tokenizer threads
+ *
+ * Follows ncxmod_callback_fn_t template
+ *
+ * INPUTS:
+ *   fullspec == absolute or relative path spec, with filename and ext.
+ *   cookie == yangcli conversion parms
+ *
+ * RETURNS:
+ *    status
+ *********************************************************************/
+static status_t
+    prefetch_callback (const char *fullspec,
+                       void *cookie)
+{
+    (void)cookie;
+
+    /* errors are ignored; the file is tokenized when it is parsed */
+    (void)ncxmod_prefetch_module((const xmlChar *)fullspec, NULL);
+    return NO_ERR;
+
+}  /* prefetch_callback */
+
+
+/********************************************************************
+ * FUNCTION prefetch_modules
+ * 
+ * Queue the files for the --module and --subtree parameters
+ * for the tokenizer threads, if --parse-threads is greater than 1
+ *
+ * INPUTS:
+ *   cp == conversion parameters to use
+ *********************************************************************/
+static void
+    prefetch_modules (yangdump_cvtparms_t *cp)
+{
+    val_value_t      *val;
+    xmlChar          *modname, *savestr, savechar;
+    const xmlChar    *revision;
+    uint32            modlen;
+
+    /* --format=yang and html use the docmode tokens,
+     * which are not prefetched
+     */
+    if (tk_get_prefetch_threads() <= 1 ||
+        cp->format == NCX_CVTTYP_YANG ||
+        cp->format == NCX_CVTTYP_HTML) {
+        return;
+    }
+
+    for (val = val_find_child(cp->cli_val, YANGDUMP_MOD, 
+                              YANGDUMP_PARM_MODULE);
+         val != NULL;
+         val = val_find_next_child(cp->cli_val, YANGDUMP_MOD,
+                                   YANGDUMP_PARM_MODULE, val)) {
+        modname = VAL_STR(val);
+        modlen = 0;
+        revision = NULL;
+        savestr = NULL;
+        savechar = '\0';
+
+        if (yang_split_filename(modname, &modlen)) {
+            savestr = &modname[modlen];
+            savechar = *savestr;
+            *savestr = '\0';
+            revision = savestr + 1;
+        }
+
+        (void)ncxmod_prefetch_module(modname, revision);
+
+        if (savestr != NULL) {
+            *savestr = savechar;
+        }
+    }
+
+    for (val = val_find_child(cp->cli_val, YANGDUMP_MOD, 
+                              YANGDUMP_PARM_SUBTREE);
+         val != NULL;
+         val = val_find_next_child(cp->cli_val, YANGDUMP_MOD,
+                                   YANGDUMP_PARM_SUBTREE, val)) {
+        if (ncxmod_test_subdir(VAL_STR(val))) {
+            (void)ncxmod_process_subtree((const char *)VAL_STR(val),
+                                         prefetch_callback,
+                                         cp);
+        }
+    }
+
+}  /* prefetch_modules */
+
+
 /************    E X T E R N A L    F U N C T I O N S   ************/
 
 
@@ -2083,6 +2178,9 @@ status_t
         ;
     }
 
+    /* start reading the files for one file or N files or 1 subtree */
+    prefetch_modules(cvtparms);
+
     /* convert one file or N files or 1 subtree */
     res = NO_ERR;
     val = val_find_child(cvtparms->cli_val, YANGDUMP_MOD, 
@@ -2146,6 +2244,8 @@ status_t
         }
     }
 
+    tk_prefetch_stop();
+
     if (res == NO_ERR && !done) {
         res = ERR_NCX_MISSING_PARM;
         log_error("\n%s: Error: missing parameter (%s or %s)\n",
@@ -0,0 +1,191 @@
+/*
+    agt-timer: check the millisecond agt_timer API the way the
+    server IO loop drives it, then report the cost of starting,
+    deleting and expiring many timers
+
+    usage: agt-timer <timers>
+
+    The IO loop is emulated by waiting agt_timer_get_timeout()
+    milliseconds and calling agt_timer_handler().  Checked are
+    a 10 msec periodic timer, a 1-shot timer that restarts
+    itself from its callback and a periodic timer that deletes
+    itself from its callback.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <poll.h>
+#include <sys/time.h>
+
+#include "procdefs.h"
+#include "agt_timer.h"
+#include "status.h"
+
+static uint32 periodic_count;
+static uint32 restart_count;
+static uint32 selfdel_count;
+static uint32 expired_count;
+
+static int periodic_fn (uint32 timer_id, void *cookie)
+{
+    periodic_count++;
+    return 0;
+}
+
+static int restart_fn (uint32 timer_id, void *cookie)
+{
+    if (++restart_count < 3) {
+        if (agt_timer_restart_ms(timer_id, 20) != NO_ERR) {
+            fprintf(stderr, "agt_timer_restart_ms in callback failed\n");
+            exit(1);
+        }
+    }
+    return 0;
+}
+
+static int selfdel_fn (uint32 timer_id, void *cookie)
+{
+    if (++selfdel_count == 3) {
+        agt_timer_delete(timer_id);
+    }
+    return 0;
+}
+
+static int expired_fn (uint32 timer_id, void *cookie)
+{
+    expired_count++;
+    return 0;
+}
+
+static double msec_since (const struct timeval *start)
+{
+    struct timeval  now;
+
+    gettimeofday(&now, NULL);
+    return (double)(now.tv_sec - start->tv_sec) * 1000.0 +
+        (double)(now.tv_usec - start->tv_usec) / 1000.0;
+}
+
+/* run the timers for msec milliseconds like the server IO loop */
+static void run_timers (uint32 msec)
+{
+    struct timeval  start;
+    int32           timeout;
+
+    gettimeofday(&start, NULL);
+    while (msec_since(&start) < (double)msec) {
+        timeout = agt_timer_get_timeout();
+        if (timeout < 0 || timeout > 10) {
+            timeout = 10;
+        }
+        (void)poll(NULL, 0, timeout);
+        agt_timer_handler();
+    }
+}
+
+int main(int argc, char **argv)
+{
+    uint32          periodic_id, restart_id, selfdel_id;
+    uint32         *ids, timercount, i, j, tmp;
+    struct timeval  start;
+    double          createms, deletems, expirems;
+
+    if (argc != 2) {
+        fprintf(stderr, "usage: agt-timer <timers>\n");
+        return 1;
+    }
+    timercount = (uint32)atol(argv[1]);
+    ids = calloc(timercount, sizeof(uint32));
+    if (ids == NULL) {
+        fprintf(stderr, "malloc failed\n");
+        return 1;
+    }
+
+    agt_timer_init();
+
+    if (agt_timer_get_timeout() != -1) {
+        fprintf(stderr, "timeout without timers is not -1\n");
+        return 1;
+    }
+
+    if (agt_timer_create_ms(10, TRUE, periodic_fn, NULL, 
+                            &periodic_id) != NO_ERR ||
+        agt_timer_create_ms(20, FALSE, restart_fn, NULL, 
+                            &restart_id) != NO_ERR ||
+        agt_timer_create_ms(5, TRUE, selfdel_fn, NULL, 
+                            &selfdel_id) != NO_ERR) {
+        fprintf(stderr, "agt_timer_create_ms failed\n");
+        return 1;
+    }
+
+    run_timers(200);
+
+    printf("periodic 10 msec timer: %u callbacks in 200 msec\n",
+           periodic_count);
+    if (periodic_count < 10 || periodic_count > 22) {
+        fprintf(stderr, "periodic timer count out of range\n");
+        return 1;
+    }
+    if (restart_count != 3 || 
+        agt_timer_restart_ms(restart_id, 10) != ERR_NCX_NOT_FOUND) {
+        fprintf(stderr, "1-shot timer restarted %u times\n", 
+                restart_count);
+        return 1;
+    }
+    if (selfdel_count != 3 || 
+        agt_timer_restart_ms(selfdel_id, 10) != ERR_NCX_NOT_FOUND) {
+        fprintf(stderr, "self-deleted timer ran %u times\n", 
+                selfdel_count);
+        return 1;
+    }
+    agt_timer_delete(periodic_id);
+
+    /* start many 1-shot timers due within the next 100 msec */
+    srand(1);
+    gettimeofday(&start, NULL);
+    for (i = 0; i < timercount; i++) {
+        if (agt_timer_create_ms(1 + (uint32)(rand() % 100), FALSE, 
+                                expired_fn, NULL, &ids[i]) != NO_ERR) {
+            fprintf(stderr, "agt_timer_create_ms failed\n");
+            return 1;
+        }
+    }
+    createms = msec_since(&start);
+
+    /* delete half of them in random order */
+    for (i = timercount - 1; i > 0; i--) {
+        j = (uint32)rand() % (i + 1);
+        tmp = ids[i];
+        ids[i] = ids[j];
+        ids[j] = tmp;
+    }
+    gettimeofday(&start, NULL);
+    for (i = 0; i < timercount / 2; i++) {
+        agt_timer_delete(ids[i]);
+    }
+    deletems = msec_since(&start);
+
+    gettimeofday(&start, NULL);
+    while (agt_timer_get_timeout() >= 0) {
+        run_timers(10);
+    }
+    expirems = msec_since(&start);
+
+    if (expired_count != timercount - timercount / 2) {
+        fprintf(stderr, "%u of %u timers expired\n", 
+                expired_count, timercount - timercount / 2);
+        return 1;
+    }
+
+    printf("%u timers: create %.1f ns, delete %.1f ns per timer, "
+           "all expired after %.0f msec\n",
+           timercount,
+           createms * 1000000.0 / (double)timercount,
+           deletems * 1000000.0 / (double)(timercount / 2),
+           expirems);
+
+    agt_timer_cleanup();
+    free(ids);
+    return 0;
+}
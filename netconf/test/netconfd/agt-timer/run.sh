@@ -0,0 +1,2 @@
+#!/bin/bash -e
+./agt-timer 100000
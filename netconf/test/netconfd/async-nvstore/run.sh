@@ -0,0 +1,15 @@
+#!/bin/bash -e
+rm -rf tmp || true
+mkdir tmp
+cp startup-cfg.xml tmp
+rm /tmp/ncxserver.sock || true
+/usr/sbin/netconfd --module=ietf-interfaces --module=iana-if-type --startup=tmp/startup-cfg.xml --async-nvstore=true --superuser=$USER 1>tmp/netconfd.stdout 2>tmp/netconfd.stderr &
+
+NETCONFD_PID=$!
+sleep 3
+python session.ncclient.py
+kill $NETCONFD_PID
+cat tmp/netconfd.stdout
+sleep 1
+grep "<description>commit 9</description>" tmp/startup-cfg.xml
+test ! -e tmp/startup-cfg.xml.tmp
@@ -0,0 +1,66 @@
+#!/usr/bin/env python
+from ncclient import manager
+from ncclient.xml_ import *
+import time
+import sys, os
+
+def get_save_state(conn):
+	rpc = """
+<get xmlns="urn:ietf:params:xml:ns:netconf:base:1.0">
+ <filter type="xpath" select="/system-state/yuma/sysStartupSaveTxid | /system-state/yuma/sysStartupSaveTime"/>
+</get>
+"""
+	result = conn.rpc(rpc)
+	txid = result.xpath('//data/system-state/yuma/sysStartupSaveTxid')
+	msec = result.xpath('//data/system-state/yuma/sysStartupSaveTime')
+	assert(len(txid)==1)
+	assert(len(msec)==1)
+	return (int(txid[0].text), int(msec[0].text))
+
+def main():
+	print("""
+#Description: Demonstrate that --async-nvstore=true saves the last commit.
+#Procedure:
+#1 - Commit 10 changes to the description of interface "foo" back to back.
+#2 - Wait until sysStartupSaveTxid reports the txid of the last commit.
+#3 - Verify the last save took a reasonable amount of time.
+""")
+
+	conn = manager.connect(host="127.0.0.1", port=830, username=os.getenv('USER'), password='admin', look_for_keys=True, timeout=10, device_params = {'name':'junos'}, hostkey_verify=False)
+	print("Connected ...")
+
+	for i in range(10):
+		rpc = """
+<edit-config xmlns="urn:ietf:params:xml:ns:netconf:base:1.0">
+ <target>
+  <candidate/>
+ </target>
+ <config>
+  <interfaces xmlns="urn:ietf:params:xml:ns:yang:ietf-interfaces">
+   <interface>
+    <name>foo</name>
+    <description>commit %d</description>
+   </interface>
+  </interfaces>
+ </config>
+</edit-config>
+""" % (i)
+		print("edit-config %d ..." % (i))
+		result = conn.rpc(rpc)
+
+		print("commit ...")
+		result = conn.rpc("<commit/>")
+
+	# the last commit has the highest txid, so wait until it stops changing
+	(txid, msec) = get_save_state(conn)
+	for i in range(10):
+		time.sleep(1)
+		(newtxid, msec) = get_save_state(conn)
+		if newtxid == txid and txid != 0:
+			break
+		txid = newtxid
+	print("txid %d saved in %d msec" % (txid, msec))
+	assert(txid != 0)
+	assert(msec < 10000)
+
+sys.exit(main())
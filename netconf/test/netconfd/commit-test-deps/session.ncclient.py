@@ -0,0 +1,94 @@
+#!/usr/bin/env python
+from ncclient import manager
+from ncclient.xml_ import *
+import time
+import sys, os
+import argparse
+
+NS = "http://yuma123.org/ns/test-commit-test-deps"
+
+def items(count, full=True):
+	return "".join("<item><name>i%d</name>%s<low>1</low><high>5</high></item>" % (i, "<value>10</value><peer>i%d</peer><group>g0</group><level>10</level>" % ((i + 1) % count) if full else "") for i in range(count))
+
+def check_invalid(conn, config, message):
+	conn.edit_config(target="candidate", test_option="set", config="""<config>%s</config>""" % config)
+	for op in (conn.validate, conn.commit):
+		try:
+			if op == conn.validate:
+				op(source="candidate")
+			else:
+				op()
+			assert(0)
+		except Exception as e:
+			print(e)
+			assert(message in str(e))
+	conn.discard_changes()
+
+def main():
+	print("""
+#Description: Verify must-stmt and leafref violations caused by edits to the nodes they read are all reported.
+#Procedure:
+#1 - Commit 10 items with groups g0 and g1, max-value 100 and max-level 100.
+#2 - Set max-value to 5. Verify validate and commit fail.
+#3 - Set low of i3 above its high. Verify validate and commit fail.
+#4 - Delete i4, the peer of i3. Verify validate and commit fail.
+#5 - Delete group g0. Verify validate and commit fail.
+#6 - Set low of i3 without validation, then set high of i7. Verify the second edit reports the invalid i3.
+#7 - Set max-level, read by an absolute path from the level leaf of each item, to 5. Verify validate and commit fail.
+#8 - Commit --items-count items with only the low and high leafs and change the high leaf of 1 item 20 times. Verify each commit takes less than 1 second.
+""")
+
+	parser = argparse.ArgumentParser()
+	parser.add_argument("--items-count", help="count of items to create e.g. 5000")
+	args = parser.parse_args()
+	count = int(args.items_count)
+
+	conn = manager.connect(host="127.0.0.1", port=830, username=os.getenv('USER'), password='admin', look_for_keys=True, timeout=60, device_params = {'name':'junos'}, hostkey_verify=False)
+	print("Connected ...")
+
+	#1
+	conn.edit_config(target="candidate", config="""<config>
+<limits xmlns="%(ns)s"><max-value>100</max-value></limits>
+<group xmlns="%(ns)s"><name>g0</name></group>
+<group xmlns="%(ns)s"><name>g1</name></group>
+<items xmlns="%(ns)s"><settings><max-level>100</max-level></settings>%(items)s</items>
+</config>""" % {'ns':NS, 'items':items(10)})
+	conn.commit()
+
+	#2
+	check_invalid(conn, """<limits xmlns="%s"><max-value>5</max-value></limits>""" % NS, "must-stmt")
+
+	#3
+	check_invalid(conn, """<items xmlns="%s"><item><name>i3</name><low>9</low></item></items>""" % NS, "must-stmt")
+
+	#4
+	check_invalid(conn, """<items xmlns="%s" xmlns:nc="urn:ietf:params:xml:ns:netconf:base:1.0"><item nc:operation="delete"><name>i4</name></item></items>""" % NS, "must-stmt")
+
+	#5
+	check_invalid(conn, """<group xmlns="%s" xmlns:nc="urn:ietf:params:xml:ns:netconf:base:1.0" nc:operation="delete"><name>g0</name></group>""" % NS, "instance")
+
+	#6
+	conn.edit_config(target="candidate", test_option="set", config="""<config><items xmlns="%s"><item><name>i3</name><low>9</low></item></items></config>""" % NS)
+	try:
+		conn.edit_config(target="candidate", config="""<config><items xmlns="%s"><item><name>i7</name><high>6</high></item></items></config>""" % NS)
+		assert(0)
+	except Exception as e:
+		print(e)
+		assert("must-stmt" in str(e))
+	conn.discard_changes()
+
+	#7
+	check_invalid(conn, """<items xmlns="%s"><settings><max-level>5</max-level></settings></items>""" % NS, "must-stmt")
+
+	#8
+	conn.edit_config(target="candidate", config="""<config><items xmlns="%s" xmlns:nc="urn:ietf:params:xml:ns:netconf:base:1.0" nc:operation="replace">%s</items></config>""" % (NS, items(count, full=False)))
+	conn.commit()
+	for i in range(20):
+		conn.edit_config(target="candidate", config="""<config><items xmlns="%s"><item><name>i%d</name><high>%d</high></item></items></config>""" % (NS, (i * 97) % count, 5 + i))
+		start = time.time()
+		conn.commit()
+		duration = time.time() - start
+		print("commit: %.2f s" % duration)
+		assert(duration < 1)
+
+sys.exit(main())
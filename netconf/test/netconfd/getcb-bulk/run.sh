@@ -0,0 +1,15 @@
+#!/bin/bash -e
+rm -rf tmp || true
+mkdir tmp
+for STREAM_OUTPUT in true false ; do
+  killall -KILL netconfd || true
+  rm /tmp/ncxserver.sock || true
+  /usr/sbin/netconfd --module=test-getcb-bulk --stream-output=$STREAM_OUTPUT --no-startup --superuser=$USER 1>tmp/netconfd-$STREAM_OUTPUT.stdout 2>tmp/netconfd-$STREAM_OUTPUT.stderr &
+  NETCONFD_PID=$!
+  sleep 3
+  python session.ncclient.py
+  kill $NETCONFD_PID
+  sleep 1
+  cat tmp/netconfd-$STREAM_OUTPUT.stdout | grep '#' > tmp/output-$STREAM_OUTPUT.txt
+  cmp expected_output.txt tmp/output-$STREAM_OUTPUT.txt
+done
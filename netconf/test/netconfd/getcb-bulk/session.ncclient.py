@@ -0,0 +1,89 @@
+#!/usr/bin/env python
+from ncclient import manager
+from ncclient.xml_ import *
+import time
+import sys, os
+import argparse
+
+TGB_NS = "http://yuma123.org/ns/test-getcb-bulk"
+COUNTERS = 10
+
+# virtual values are cached for VAL_VIRTUAL_CACHE_TIME (3 s)
+CACHE_WAIT = 4
+
+def counter_values(reply):
+	values = {}
+	for counter in reply.data.findall(".//{%s}counter" % TGB_NS):
+		name = counter.find("{%s}name" % TGB_NS).text
+		value = counter.find("{%s}value" % TGB_NS)
+		if value != None:
+			values[name] = int(value.text)
+	return values
+
+def main():
+	print("""
+#Description: Demonstrate that a bulk get callback is called once per request and its snapshot is freed at the end of the request.
+#Procedure:
+#1 - Get all the counters with a subtree filter. Verify all the values come from bulk call 1.
+#2 - Get all the counters with an xpath filter. Verify all the values come from bulk call 2.
+#3 - Get the configuration. Verify there are no counters.
+#4 - Get a single counter. Verify its value comes from bulk call 3.
+""")
+
+	parser = argparse.ArgumentParser()
+	parser.add_argument("--server", help="server name e.g. 127.0.0.1 or server.com (127.0.0.1 if not specified)")
+	parser.add_argument("--user", help="username e.g. admin ($USER if not specified)")
+	parser.add_argument("--port", help="port e.g. 830 (830 if not specified)")
+	parser.add_argument("--password", help="password e.g. mypass123 (passwordless if not specified)")
+
+	args = parser.parse_args()
+
+	if(args.server==None or args.server==""):
+		server="127.0.0.1"
+	else:
+		server=args.server
+
+	if(args.port==None or args.port==""):
+		port=830
+	else:
+		port=int(args.port)
+
+	if(args.user==None or args.user==""):
+		user=os.getenv('USER')
+	else:
+		user=args.user
+
+	if(args.password==None or args.password==""):
+		password=None
+		look_for_keys=True
+	else:
+		password=args.password
+		look_for_keys=False
+
+	conn = manager.connect(host=server, port=port, username=user, password=password, look_for_keys=look_for_keys, timeout=60, device_params = {'name':'junos'}, hostkey_verify=False)
+	print("Connected ...")
+
+	print("#1 - subtree get of all the counters ...")
+	values = counter_values(conn.get(filter=("subtree", """<counters xmlns="%s"/>""" % TGB_NS)))
+	print(values)
+	assert(values == dict([("c%d" % i, 1000+i) for i in range(COUNTERS)]))
+
+	time.sleep(CACHE_WAIT)
+	print("#2 - xpath get of all the counters ...")
+	values = counter_values(conn.get(filter=("xpath", "/counters")))
+	print(values)
+	assert(values == dict([("c%d" % i, 2000+i) for i in range(COUNTERS)]))
+
+	time.sleep(CACHE_WAIT)
+	print("#3 - get-config ...")
+	values = counter_values(conn.get_config(source="running"))
+	print(values)
+	assert(values == {})
+
+	time.sleep(CACHE_WAIT)
+	print("#4 - subtree get of a single counter ...")
+	values = counter_values(conn.get(filter=("subtree", """<counters xmlns="%s"><counter><name>c3</name></counter></counters>""" % TGB_NS)))
+	print(values)
+	assert(values == {"c3": 3003})
+
+sys.exit(main())
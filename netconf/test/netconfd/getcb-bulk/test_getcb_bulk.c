@@ -0,0 +1,187 @@
+/*
+    module test-getcb-bulk (based on test-getcb-bulk.yang)
+
+    /counters/counter has COUNTERS entries with a virtual
+    value leaf.  A bulk callback registered for the counter list
+    collects all the values in one snapshot, which the get
+    callbacks of the value leafs share.  Each bulk call and each
+    freed snapshot is logged to stdout.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include <libxml/xmlstring.h>
+#include "procdefs.h"
+#include "agt.h"
+#include "agt_util.h"
+#include "cfg.h"
+#include "getcb.h"
+#include "ncx.h"
+#include "ncxmod.h"
+#include "ncxtypes.h"
+#include "obj.h"
+#include "status.h"
+#include "val.h"
+#include "val_util.h"
+
+#define TEST_MOD        (const xmlChar *)"test-getcb-bulk"
+#define COUNTERS        10
+
+/* values of all the counters, collected by one bulk call */
+typedef struct counters_snapshot_t_ {
+    uint32  bulkcall;
+    uint32  values[COUNTERS];
+} counters_snapshot_t;
+
+/* module static variables */
+static ncx_module_t   *test_mod;
+static obj_template_t *counter_obj;
+static uint32          bulk_calls;
+
+static status_t
+    get_counters_snapshot (ses_cb_t *scb,
+                           obj_template_t *obj,
+                           void **snapshot)
+{
+    counters_snapshot_t *snap;
+    uint32               i;
+
+    snap = malloc(sizeof(counters_snapshot_t));
+    if (snap == NULL) {
+        return ERR_INTERNAL_MEM;
+    }
+
+    /* each bulk call gets its own values */
+    snap->bulkcall = ++bulk_calls;
+    for (i = 0; i < COUNTERS; i++) {
+        snap->values[i] = snap->bulkcall * 1000 + i;
+    }
+    printf("\n#bulk call %u\n", snap->bulkcall);
+    fflush(stdout);
+
+    *snapshot = snap;
+    return NO_ERR;
+}
+
+static void
+    free_counters_snapshot (void *snapshot)
+{
+    counters_snapshot_t *snap = (counters_snapshot_t *)snapshot;
+
+    printf("\n#snapshot %u freed\n", snap->bulkcall);
+    fflush(stdout);
+    free(snap);
+}
+
+static status_t
+    get_counter_value (ses_cb_t *scb,
+                       getcb_mode_t cbmode,
+                       const val_value_t *virval,
+                       val_value_t *dstval)
+{
+    counters_snapshot_t *snap;
+    val_value_t         *nameval;
+    status_t             res;
+
+    snap = (counters_snapshot_t *)
+        getcb_get_snapshot(scb, counter_obj, &res);
+    if (snap == NULL) {
+        return res;
+    }
+
+    /* the key of entry i is c<i> */
+    nameval = val_find_child(virval->parent, TEST_MOD,
+                             (const xmlChar *)"name");
+    assert(nameval != NULL);
+
+    VAL_UINT(dstval) = snap->values[atoi((const char *)
+                                         VAL_STRING(nameval) + 1)];
+    return NO_ERR;
+}
+
+/* The 3 mandatory callback functions: y_test_getcb_bulk_init, y_test_getcb_bulk_init2, y_test_getcb_bulk_cleanup */
+
+status_t
+    y_test_getcb_bulk_init (
+        const xmlChar *modname,
+        const xmlChar *revision)
+{
+    agt_profile_t *agt_profile;
+    status_t res;
+
+    agt_profile = agt_get_profile();
+
+    res = ncxmod_load_module(
+        TEST_MOD,
+        NULL,
+        &agt_profile->agt_savedevQ,
+        &test_mod);
+    return res;
+}
+
+status_t y_test_getcb_bulk_init2(void)
+{
+    cfg_template_t *runningcfg;
+    obj_template_t *counters_obj;
+    val_value_t    *countersval, *entryval, *childval;
+    xmlChar         name[16];
+    uint32          i;
+    status_t        res;
+
+    runningcfg = cfg_get_config_id(NCX_CFGID_RUNNING);
+    assert(runningcfg != NULL && runningcfg->root != NULL);
+
+    counters_obj = obj_find_template_top(test_mod, TEST_MOD,
+                                         (const xmlChar *)"counters");
+    assert(counters_obj != NULL);
+    counter_obj = obj_find_child(counters_obj, TEST_MOD,
+                                 (const xmlChar *)"counter");
+    assert(counter_obj != NULL);
+
+    res = getcb_register_bulk(counter_obj,
+                              get_counters_snapshot,
+                              free_counters_snapshot);
+    if (res != NO_ERR) {
+        return res;
+    }
+
+    countersval = val_new_value();
+    assert(countersval != NULL);
+    val_init_from_template(countersval, counters_obj);
+
+    for (i = 0; i < COUNTERS; i++) {
+        entryval = val_new_value();
+        assert(entryval != NULL);
+        val_init_from_template(entryval, counter_obj);
+        val_add_child(entryval, countersval);
+
+        snprintf((char *)name, sizeof(name), "c%u", i);
+        childval = agt_make_leaf(counter_obj, (const xmlChar *)"name",
+                                 name, &res);
+        assert(childval != NULL);
+        val_add_child(childval, entryval);
+
+        childval = agt_make_virtual_leaf(counter_obj,
+                                         (const xmlChar *)"value",
+                                         get_counter_value, &res);
+        assert(childval != NULL);
+        val_add_child(childval, entryval);
+
+        res = val_gen_index_chain(counter_obj, entryval);
+        assert(res == NO_ERR);
+    }
+
+    val_add_child_sorted(countersval, runningcfg->root);
+    return NO_ERR;
+}
+
+void y_test_getcb_bulk_cleanup (void)
+{
+    if (counter_obj != NULL) {
+        getcb_unregister_bulk(counter_obj);
+        counter_obj = NULL;
+    }
+}
@@ -0,0 +1,19 @@
+#!/bin/bash -e
+rm -rf tmp || true
+mkdir tmp
+for COUNT in 10000 100000 ; do
+  killall -KILL netconfd || true
+  rm /tmp/ncxserver.sock || true
+  /usr/sbin/netconfd --module=ietf-interfaces --module=iana-if-type --no-startup --superuser=$USER 1>tmp/netconfd-$COUNT.stdout 2>tmp/netconfd-$COUNT.stderr &
+  NETCONFD_PID=$!
+  sleep 3
+  STARTTIME=$(date +%s)
+  python session.ncclient.py --count=$COUNT
+  ENDTIME=$(date +%s)
+  kill $NETCONFD_PID
+  echo "It took $(($ENDTIME-$STARTTIME)) seconds to run the session with $COUNT interfaces"
+  if [ $(($COUNT/1000)) -lt $(($ENDTIME-$STARTTIME)) ] ; then
+    echo "Test failed since the PASS threshold is $(($COUNT/1000)) seconds"
+    exit 1
+  fi
+done
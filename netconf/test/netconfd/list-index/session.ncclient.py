@@ -0,0 +1,149 @@
+#!/usr/bin/env python
+from ncclient import manager
+from ncclient.operations import RPCError
+from ncclient.xml_ import *
+import time
+import sys, os
+import argparse
+
+IF_NS = "urn:ietf:params:xml:ns:yang:ietf-interfaces"
+
+def edit_interfaces(conn, entries):
+	rpc = """
+<edit-config xmlns="urn:ietf:params:xml:ns:netconf:base:1.0">
+ <target>
+  <candidate/>
+ </target>
+ <default-operation>merge</default-operation>
+ <test-option>set</test-option>
+ <config>
+  <interfaces xmlns="%(ns)s" xmlns:nc="urn:ietf:params:xml:ns:netconf:base:1.0" xmlns:ianaift="urn:ietf:params:xml:ns:yang:iana-if-type">
+%(entries)s
+  </interfaces>
+ </config>
+</edit-config>
+""" % {'ns':IF_NS, 'entries':"\n".join(entries)}
+	result = conn.rpc(rpc)
+	conn.rpc("<commit/>")
+	return result
+
+def get_interface(conn, name):
+	rpc = """
+<get-config xmlns="urn:ietf:params:xml:ns:netconf:base:1.0">
+ <source><running/></source>
+ <filter type="subtree">
+  <interfaces xmlns="%(ns)s"><interface><name>%(name)s</name></interface></interfaces>
+ </filter>
+</get-config>
+""" % {'ns':IF_NS, 'name':name}
+	return conn.rpc(rpc)
+
+def get_names(conn):
+	rpc = """
+<get-config xmlns="urn:ietf:params:xml:ns:netconf:base:1.0">
+ <source><running/></source>
+ <filter type="subtree">
+  <interfaces xmlns="%(ns)s"><interface><name/></interface></interfaces>
+ </filter>
+</get-config>
+""" % {'ns':IF_NS}
+	return conn.rpc(rpc).xpath('//data/interfaces/interface/name')
+
+def main():
+	print("""
+#Description: Demonstrate that list entries are found by key in a large list.
+#Procedure:
+#1 - Create COUNT interfaces and commit.
+#2 - Merge a description into every 100th interface and commit.
+#3 - Select the first, a described and the last interface by key. Verify the complete entry is returned.
+#4 - Select an interface that does not exist. Verify the reply is empty.
+#5 - Delete every 100th interface and commit.
+#6 - Verify the deleted interfaces are not returned and COUNT-COUNT/100 names remain.
+#7 - Delete a deleted interface. Verify the edit fails with data-missing.
+""")
+
+	parser = argparse.ArgumentParser()
+	parser.add_argument("--server", help="server name e.g. 127.0.0.1 or server.com (127.0.0.1 if not specified)")
+	parser.add_argument("--user", help="username e.g. admin ($USER if not specified)")
+	parser.add_argument("--port", help="port e.g. 830 (830 if not specified)")
+	parser.add_argument("--password", help="password e.g. mypass123 (passwordless if not specified)")
+	parser.add_argument("--count", help="number of interfaces e.g. 100000 (10000 if not specified)")
+
+	args = parser.parse_args()
+
+	if(args.server==None or args.server==""):
+		server="127.0.0.1"
+	else:
+		server=args.server
+
+	if(args.port==None or args.port==""):
+		port=830
+	else:
+		port=int(args.port)
+
+	if(args.user==None or args.user==""):
+		user=os.getenv('USER')
+	else:
+		user=args.user
+
+	if(args.password==None or args.password==""):
+		password=None
+		look_for_keys=True
+	else:
+		password=args.password
+		look_for_keys=False
+
+	if(args.count==None or args.count==""):
+		count=10000
+	else:
+		count=int(args.count)
+
+	conn = manager.connect(host=server, port=port, username=user, password=password, look_for_keys=look_for_keys, timeout=600, device_params = {'name':'junos'}, hostkey_verify=False)
+	print("Connected ...")
+
+	print("#1 - create %d interfaces ..." % count)
+	start = time.time()
+	edit_interfaces(conn, ["<interface><name>if%d</name><type>ianaift:ethernetCsmacd</type></interface>" % i for i in range(count)])
+	print("took %.2f seconds" % (time.time()-start))
+
+	print("#2 - merge %d descriptions ..." % (count//100))
+	start = time.time()
+	edit_interfaces(conn, ["<interface><name>if%d</name><description>entry %d</description></interface>" % (i, i) for i in range(0, count, 100)])
+	print("took %.2f seconds" % (time.time()-start))
+
+	print("#3 - select by key ...")
+	for i in (0, 100, count-1):
+		result = get_interface(conn, "if%d" % i)
+		assert(len(result.xpath('//data/interfaces/interface/name'))==1)
+		assert(len(result.xpath('//data/interfaces/interface/type'))==1)
+		description = result.xpath('//data/interfaces/interface/description')
+		if(i%100==0):
+			assert(description[0].text=="entry %d" % i)
+		else:
+			assert(len(description)==0)
+
+	print("#4 - select missing key ...")
+	result = get_interface(conn, "if%d" % count)
+	assert(len(result.xpath('//data/interfaces'))==0)
+
+	print("#5 - delete %d interfaces ..." % (count//100))
+	start = time.time()
+	edit_interfaces(conn, ["<interface nc:operation=\"delete\"><name>if%d</name></interface>" % i for i in range(0, count, 100)])
+	print("took %.2f seconds" % (time.time()-start))
+
+	print("#6 - verify remaining interfaces ...")
+	result = get_interface(conn, "if100")
+	assert(len(result.xpath('//data/interfaces'))==0)
+	result = get_interface(conn, "if101")
+	assert(len(result.xpath('//data/interfaces/interface/name'))==1)
+	assert(len(get_names(conn))==count-count//100)
+
+	print("#7 - delete missing interface ...")
+	try:
+		edit_interfaces(conn, ["<interface nc:operation=\"delete\"><name>if0</name></interface>"])
+		assert(False)
+	except RPCError as e:
+		assert(e.tag=="data-missing")
+	conn.discard_changes()
+
+sys.exit(main())
@@ -0,0 +1,198 @@
+/*
+    log-async: check the asynchronous logfile output modes,
+    then report the cost of a log_info call with and without
+    the writer thread
+
+    usage: log-async <logfile> <records>
+
+    Checked are records logged by several threads at once in
+    'block' mode, which must all be in the logfile in the
+    order each thread logged them, a record bigger than the
+    log buffer, a record logged by a forked child, and the
+    drop counter in 'drop' mode.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+
+#include "procdefs.h"
+#include "log.h"
+#include "status.h"
+
+#define THREADS     4
+
+static uint32 records;
+
+static double msec_since (const struct timeval *start)
+{
+    struct timeval  now;
+
+    gettimeofday(&now, NULL);
+    return (double)(now.tv_sec - start->tv_sec) * 1000.0 +
+        (double)(now.tv_usec - start->tv_usec) / 1000.0;
+}
+
+static void *log_thread (void *arg)
+{
+    uint32  thread = (uint32)(unsigned long)arg;
+    uint32  i;
+
+    for (i = 0; i < records; i++) {
+        log_info("\nthread %u record %u", thread, i);
+    }
+    return NULL;
+}
+
+/* time records log_info calls in the current mode */
+static double time_records (void)
+{
+    struct timeval  start;
+    uint32          i;
+
+    gettimeofday(&start, NULL);
+    for (i = 0; i < records; i++) {
+        log_info("\ntimed record %u", i);
+    }
+    log_async_flush();
+    return msec_since(&start);
+}
+
+/* check that each thread's records are all there, in order */
+static int check_logfile (const char *fname)
+{
+    FILE    *fp;
+    char     line[256];
+    uint32   next[THREADS], thread, rec;
+    int      bigfound, childfound;
+
+    memset(next, 0, sizeof(next));
+    bigfound = childfound = 0;
+
+    fp = fopen(fname, "r");
+    if (fp == NULL) {
+        fprintf(stderr, "cannot open %s\n", fname);
+        return 1;
+    }
+    while (fgets(line, sizeof(line), fp)) {
+        if (sscanf(line, "thread %u record %u", &thread, &rec) == 2) {
+            if (thread >= THREADS || rec != next[thread]) {
+                fprintf(stderr, "thread %u record %u out of order\n",
+                        thread, rec);
+                fclose(fp);
+                return 1;
+            }
+            next[thread]++;
+        } else if (!strncmp(line, "big record", 10)) {
+            bigfound++;
+        } else if (!strncmp(line, "child record", 12)) {
+            childfound++;
+        }
+    }
+    fclose(fp);
+
+    for (thread = 0; thread < THREADS; thread++) {
+        if (next[thread] != records) {
+            fprintf(stderr, "thread %u: %u of %u records\n",
+                    thread, next[thread], records);
+            return 1;
+        }
+    }
+    if (bigfound != 1 || childfound != 1) {
+        fprintf(stderr, "big record found %d times, "
+                "child record found %d times\n", bigfound, childfound);
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    pthread_t   threads[THREADS];
+    char       *big;
+    pid_t       pid;
+    int         status;
+    uint32      i;
+    uint64      dropped;
+    double      syncms, asyncms;
+
+    if (argc != 3) {
+        fprintf(stderr, "usage: log-async <logfile> <records>\n");
+        return 1;
+    }
+    records = (uint32)atol(argv[2]);
+
+    log_set_debug_level(LOG_DEBUG_INFO);
+    if (log_open(argv[1], FALSE, FALSE) != NO_ERR) {
+        fprintf(stderr, "cannot open %s\n", argv[1]);
+        return 1;
+    }
+
+    syncms = time_records();
+
+    /* small buffer, so the threads have to wait for the writer */
+    if (log_async_start(LOG_ASYNC_BLOCK, 4096) != NO_ERR ||
+        log_get_async_mode() != LOG_ASYNC_BLOCK) {
+        fprintf(stderr, "log_async_start failed\n");
+        return 1;
+    }
+    for (i = 0; i < THREADS; i++) {
+        pthread_create(&threads[i], NULL, log_thread,
+                       (void *)(unsigned long)i);
+    }
+    for (i = 0; i < THREADS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    big = malloc(8192);
+    memset(big, 'x', 8191);
+    big[8191] = 0;
+    log_info("\nbig record %s", big);
+    free(big);
+
+    pid = fork();
+    if (pid == 0) {
+        log_info("\nchild record");
+        log_close();
+        _exit(0);
+    }
+    waitpid(pid, &status, 0);
+    log_info("\n");
+    log_async_stop();
+
+    if (log_get_async_dropped() != 0) {
+        fprintf(stderr, "records dropped in block mode\n");
+        return 1;
+    }
+    log_close();
+    if (check_logfile(argv[1])) {
+        return 1;
+    }
+    printf("block mode: %u records from %u threads in order\n",
+           records * THREADS, THREADS);
+
+    /* drop mode with a buffer too small for all records */
+    log_open(argv[1], FALSE, FALSE);
+    log_async_start(LOG_ASYNC_DROP, 4096);
+    for (i = 0; i < 10000; i++) {
+        log_info("\ndrop record %u", i);
+    }
+    dropped = log_get_async_dropped();
+    log_async_stop();
+    printf("drop mode: %llu of 10000 records dropped\n",
+           (unsigned long long)dropped);
+
+    log_async_start(LOG_ASYNC_BLOCK, LOG_ASYNC_DEF_BUFFSIZE);
+    asyncms = time_records();
+    log_close();
+
+    printf("log_info: %.0f ns per record, %.0f ns with log-async\n",
+           syncms * 1000000.0 / (double)records,
+           asyncms * 1000000.0 / (double)records);
+
+    return 0;
+}
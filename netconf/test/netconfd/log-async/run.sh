@@ -0,0 +1,4 @@
+#!/bin/bash -e
+rm -f tmp/log-async.log
+mkdir -p tmp
+./log-async tmp/log-async.log 100000
@@ -0,0 +1,12 @@
+#!/bin/bash -e
+rm -rf tmp || true
+mkdir tmp
+sed -e "s/<user-name>USER</<user-name>$USER</" startup-cfg.xml > tmp/startup-cfg.xml
+rm /tmp/ncxserver.sock || true
+/usr/sbin/netconfd --module=ietf-interfaces --module=iana-if-type --startup=tmp/startup-cfg.xml --target=running --superuser=nobody 1>tmp/netconfd.stdout 2>tmp/netconfd.stderr &
+
+NETCONFD_PID=$!
+sleep 3
+python session.ncclient.py
+kill $NETCONFD_PID
+cat tmp/netconfd.stdout
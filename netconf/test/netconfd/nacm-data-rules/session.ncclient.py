@@ -0,0 +1,65 @@
+#!/usr/bin/env python
+from ncclient import manager
+from ncclient.xml_ import *
+import time
+import sys, os
+
+def get_interfaces(conn):
+	rpc = """
+<get-config xmlns="urn:ietf:params:xml:ns:netconf:base:1.0">
+ <source>
+  <running/>
+ </source>
+</get-config>
+"""
+	result = conn.rpc(rpc)
+	names = result.xpath('//data/interfaces/interface/name')
+	descriptions = result.xpath('//data/interfaces/interface/description')
+	return (names, descriptions)
+
+def main():
+	print("""
+#Description: Demonstrate that cached NACM data rule decisions follow the NACM configuration.
+#Procedure:
+#1 - Read the running configuration. Verify only the interface names are returned.
+#2 - Add a data rule permitting the interface descriptions to be read.
+#3 - Read the running configuration. Verify the descriptions are returned.
+""")
+
+	conn = manager.connect(host="127.0.0.1", port=830, username=os.getenv('USER'), password='admin', look_for_keys=True, timeout=10, device_params = {'name':'junos'}, hostkey_verify=False)
+	print("Connected ...")
+
+	(names, descriptions) = get_interfaces(conn)
+	assert(len(names)==20)
+	assert(len(descriptions)==0)
+
+	print("permit reading descriptions ...")
+	rpc = """
+<edit-config xmlns="urn:ietf:params:xml:ns:netconf:base:1.0">
+ <target>
+  <running/>
+ </target>
+ <config>
+  <nacm xmlns="urn:ietf:params:xml:ns:yang:ietf-netconf-acm">
+   <rule-list>
+    <name>test</name>
+    <rule>
+     <name>read-descriptions</name>
+     <path xmlns:if="urn:ietf:params:xml:ns:yang:ietf-interfaces">/if:interfaces/if:interface/if:description</path>
+     <access-operations>read</access-operations>
+     <action>permit</action>
+    </rule>
+   </rule-list>
+  </nacm>
+ </config>
+</edit-config>
+"""
+	result = conn.rpc(rpc)
+	assert(len(result.xpath('//ok'))==1)
+
+	(names, descriptions) = get_interfaces(conn)
+	assert(len(names)==20)
+	assert(len(descriptions)==20)
+	assert(descriptions[0].text=="interface 0")
+
+sys.exit(main())
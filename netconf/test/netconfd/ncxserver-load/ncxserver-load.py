@@ -0,0 +1,189 @@
+#!/usr/bin/env python
+#
+# Open many concurrent NETCONF sessions on the netconfd ncxserver
+# socket and measure the <get-config> round trip time on one of
+# them while the others stay idle.  The per-RPC latency with all
+# the sessions open is compared to the latency with only a few.
+#
+# The latency is measured again while a slow reader session has
+# several <get> replies pending that it has not read yet.  The
+# server must keep serving the other sessions and send the slow
+# reader all of its replies once it reads them.
+#
+# Last a session requests a <get-config> reply that is larger than
+# the stream output queue limit and does not read it.  The server
+# must drop that session while the other sessions keep working.
+#
+import sys
+import time
+import socket
+import argparse
+
+NCX_SERVER_MAGIC = "x56o8937ab17eg922z34rwhobskdbyswfehkpsqq3i55a0an960ccw24a4ek864aOpal1t2p"
+EOM = b"]]>]]>"
+
+NCX_CONNECT = ('<?xml version="1.0" encoding="UTF-8"?>\n'
+               '<ncx-connect xmlns="http://netconfcentral.org/ns/yuma-ncx" '
+               'version="1" user="%s" address="127.0.0.1" magic="%s" '
+               'transport="ssh" port="830" />\n]]>]]>')
+
+HELLO = ('<?xml version="1.0" encoding="UTF-8"?>\n'
+         '<hello xmlns="urn:ietf:params:xml:ns:netconf:base:1.0">'
+         '<capabilities><capability>urn:ietf:params:netconf:base:1.0'
+         '</capability></capabilities></hello>]]>]]>')
+
+GET_CONFIG = ('<rpc message-id="%d" '
+              'xmlns="urn:ietf:params:xml:ns:netconf:base:1.0">'
+              '<get-config><source><running/></source></get-config>'
+              '</rpc>]]>]]>')
+
+
+GET_CONFIG_CANDIDATE = ('<rpc message-id="%d" '
+                        'xmlns="urn:ietf:params:xml:ns:netconf:base:1.0">'
+                        '<get-config><source><candidate/></source>'
+                        '</get-config></rpc>]]>]]>')
+
+EDIT_CONFIG = ('<rpc message-id="%d" '
+               'xmlns="urn:ietf:params:xml:ns:netconf:base:1.0">'
+               '<edit-config><target><candidate/></target><config>'
+               '<interfaces '
+               'xmlns="urn:ietf:params:xml:ns:yang:ietf-interfaces" '
+               'xmlns:ianaift="urn:ietf:params:xml:ns:yang:iana-if-type">'
+               '%s</interfaces></config></edit-config></rpc>]]>]]>')
+
+INTERFACE = ('<interface><name>eth%d</name>'
+             '<description>interface number %d</description>'
+             '<type>ianaift:ethernetCsmacd</type></interface>')
+
+GET = ('<rpc message-id="%d" '
+       'xmlns="urn:ietf:params:xml:ns:netconf:base:1.0">'
+       '<get/></rpc>]]>]]>')
+
+
+def read_reply(sock):
+    data = b""
+    while EOM not in data:
+        chunk = sock.recv(65536)
+        if not chunk:
+            raise Exception("session closed by server")
+        data += chunk
+    return data
+
+
+def open_session(sockname, user):
+    sock = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+    sock.connect(sockname)
+    sock.sendall((NCX_CONNECT % (user, NCX_SERVER_MAGIC)).encode())
+    sock.sendall(HELLO.encode())
+    read_reply(sock)
+    return sock
+
+
+def measure(sessions, rpcs, msgid):
+    latencies = []
+    for i in range(rpcs):
+        sock = sessions[i % len(sessions)]
+        start = time.time()
+        sock.sendall((GET_CONFIG % (msgid + i)).encode())
+        reply = read_reply(sock)
+        latencies.append(time.time() - start)
+        if b"<rpc-error>" in reply:
+            raise Exception("rpc-error in reply: %s" % reply)
+    latencies.sort()
+    return latencies[len(latencies) // 2]
+
+
+def read_replies(sock, count):
+    data = b""
+    while data.count(EOM) < count:
+        chunk = sock.recv(65536)
+        if not chunk:
+            raise Exception("session closed by server")
+        data += chunk
+    return data
+
+
+def read_until_closed(sock):
+    data = b""
+    while True:
+        chunk = sock.recv(65536)
+        if not chunk:
+            return data
+        data += chunk
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--sockname", default="/tmp/ncxserver.sock")
+    parser.add_argument("--user", default="root")
+    parser.add_argument("--sessions", type=int, default=2000)
+    parser.add_argument("--rpcs", type=int, default=200)
+    parser.add_argument("--max-ratio", type=float, default=3.0)
+    parser.add_argument("--slow-gets", type=int, default=20)
+    parser.add_argument("--interfaces", type=int, default=40000)
+    args = parser.parse_args()
+
+    sessions = [open_session(args.sockname, args.user) for i in range(4)]
+    for sock in sessions:
+        sock.settimeout(10)
+    base = measure(sessions, args.rpcs, 1)
+    print("%d sessions: median <get-config> latency %.3f ms" %
+          (len(sessions), base * 1000))
+
+    slow = open_session(args.sockname, args.user)
+    for i in range(args.slow_gets):
+        slow.sendall((GET % (i + 1)).encode())
+    time.sleep(1)
+    pending = measure(sessions, args.rpcs, 1 + args.rpcs)
+    print("%d sessions and a slow reader: median <get-config> latency "
+          "%.3f ms" % (len(sessions), pending * 1000))
+    slow.settimeout(10)
+    replies = read_replies(slow, args.slow_gets)
+    if replies.count(b"</rpc-reply>") != args.slow_gets or \
+            b"<rpc-error>" in replies:
+        raise Exception("slow reader replies are not complete")
+    print("slow reader: %d <get> replies, %d bytes" %
+          (args.slow_gets, len(replies)))
+    slow.close()
+
+    while len(sessions) < args.sessions:
+        sessions.append(open_session(args.sockname, args.user))
+    loaded = measure(sessions, args.rpcs, 1 + 2 * args.rpcs)
+    print("%d sessions: median <get-config> latency %.3f ms" %
+          (len(sessions), loaded * 1000))
+
+    interfaces = "".join([INTERFACE % (i, i)
+                          for i in range(args.interfaces)])
+    sessions[0].sendall((EDIT_CONFIG % (1, interfaces)).encode())
+    reply = read_reply(sessions[0])
+    if b"<ok/>" not in reply:
+        raise Exception("edit-config failed: %s" % reply)
+
+    dropped = open_session(args.sockname, args.user)
+    dropped.sendall((GET_CONFIG_CANDIDATE % 1).encode())
+    time.sleep(2)
+    stalled = measure(sessions, args.rpcs, 1 + 3 * args.rpcs)
+    print("%d sessions and a reader that is dropped: median <get-config> "
+          "latency %.3f ms" % (len(sessions), stalled * 1000))
+    dropped.settimeout(10)
+    data = read_until_closed(dropped)
+    if EOM in data:
+        raise Exception("session with a %d interface reply was not dropped"
+                        % args.interfaces)
+    print("dropped reader: session closed after %d bytes" % len(data))
+    dropped.close()
+
+    for sock in sessions:
+        sock.close()
+
+    if loaded > base * args.max_ratio or \
+            pending > base * args.max_ratio or \
+            stalled > base * args.max_ratio:
+        print("Test failed: latency grew more than %.1f times" %
+              args.max_ratio)
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
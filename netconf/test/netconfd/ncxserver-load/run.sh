@@ -0,0 +1,13 @@
+#!/bin/bash -e
+rm -rf tmp || true
+mkdir tmp
+ulimit -n 8192
+killall -KILL netconfd || true
+rm /tmp/ncxserver.sock || true
+/usr/sbin/netconfd --module=iana-if-type --module=ietf-interfaces --no-startup --superuser=$USER --max-sessions=4096 2>&1 1>tmp/server.log &
+SERVER_PID=$!
+sleep 3
+RES=0
+python ncxserver-load.py --user=$USER --sessions=2000 || RES=$?
+kill -KILL $SERVER_PID
+exit $RES
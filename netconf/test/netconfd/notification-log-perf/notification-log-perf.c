@@ -0,0 +1,150 @@
+/*
+    notification-log-perf: queue notifications into the agt_not
+    replay log the way agt_not_queue_notification does, with many
+    subscriptions reading from it, and report the cost per
+    queued notification
+
+    usage: notification-log-perf <notifications> <subscriptions>
+                                 <eventlog-size>
+
+    Half of the subscriptions read every notification as soon
+    as it is queued.  The other half read 1 notification for
+    every 4 queued, so they fall behind the oldest entry and
+    their position has to be moved past the deleted entries.
+    Every 1000 notifications a replay start time is looked up.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include "procdefs.h"
+#include "agt_not.h"
+#include "agt_not_log.h"
+#include "dlq.h"
+#include "status.h"
+#include "xml_util.h"
+
+/* 1 notification per 10 msec of eventTime */
+static void
+    make_event_time (xmlChar *buff,
+                     uint32 i)
+{
+    uint32 secs = i / 100;
+
+    snprintf((char *)buff, TSTAMP_MIN_SIZE, 
+             "2020-01-%02uT%02u:%02u:%02uZ",
+             1 + secs / 86400, 
+             (secs / 3600) % 24,
+             (secs / 60) % 60, 
+             secs % 60);
+}
+
+int main(int argc, char **argv)
+{
+    agt_not_log_t   notlog;
+    agt_not_msg_t  *msg;
+    uint64         *nextseq;
+    uint32         *lastid;
+    uint32          notcount, subcount, logsize, i, j;
+    uint64          delivered, skipped, firstseq, seq;
+    xmlChar         timebuff[TSTAMP_MIN_SIZE];
+    struct timeval  start, end;
+    double          secs;
+
+    if (argc != 4) {
+        fprintf(stderr, 
+                "usage: notification-log-perf <notifications> "
+                "<subscriptions> <eventlog-size>\n");
+        return 1;
+    }
+    notcount = (uint32)atol(argv[1]);
+    subcount = (uint32)atol(argv[2]);
+    logsize = (uint32)atol(argv[3]);
+    if (subcount == 0 || logsize == 0) {
+        fprintf(stderr, "subscriptions and eventlog-size must be > 0\n");
+        return 1;
+    }
+
+    nextseq = calloc(subcount, sizeof(uint64));
+    lastid = calloc(subcount, sizeof(uint32));
+    if (nextseq == NULL || lastid == NULL) {
+        fprintf(stderr, "malloc failed\n");
+        return 1;
+    }
+
+    agt_not_log_init(&notlog);
+    delivered = 0;
+    skipped = 0;
+
+    gettimeofday(&start, NULL);
+    for (i = 1; i <= notcount; i++) {
+        msg = calloc(1, sizeof(agt_not_msg_t));
+        if (msg == NULL) {
+            fprintf(stderr, "malloc failed\n");
+            return 1;
+        }
+        dlq_createSQue(&msg->payloadQ);
+        msg->msgid = i;
+        make_event_time(msg->eventTime, i);
+
+        if (agt_not_log_count(&notlog) == logsize) {
+            agt_not_free_notification(agt_not_log_remove_first(&notlog));
+        }
+        if (agt_not_log_add(&notlog, msg) != NO_ERR) {
+            fprintf(stderr, "agt_not_log_add failed\n");
+            return 1;
+        }
+
+        firstseq = agt_not_log_first_seq(&notlog);
+        for (j = 0; j < subcount; j++) {
+            if ((j & 1) && (i & 3)) {
+                continue;
+            }
+            if (nextseq[j] < firstseq) {
+                skipped += firstseq - nextseq[j];
+                nextseq[j] = firstseq;
+            }
+            msg = agt_not_log_get(&notlog, nextseq[j]);
+            if (msg) {
+                if (msg->msgid <= lastid[j]) {
+                    fprintf(stderr, "subscription %u: msgid %u after %u\n",
+                            j, msg->msgid, lastid[j]);
+                    return 1;
+                }
+                lastid[j] = msg->msgid;
+                nextseq[j]++;
+                delivered++;
+            }
+        }
+
+        if (i % 1000 == 0 && i > logsize / 2) {
+            make_event_time(timebuff, i - logsize / 2);
+            seq = agt_not_log_find_time(&notlog, timebuff, FALSE);
+            msg = agt_not_log_get(&notlog, seq);
+            if (msg && xml_strcmp(msg->eventTime, timebuff) < 0) {
+                fprintf(stderr, "replay start %s found %s\n",
+                        timebuff, msg->eventTime);
+                return 1;
+            }
+        }
+    }
+    gettimeofday(&end, NULL);
+
+    secs = (double)(end.tv_sec - start.tv_sec) + 
+        (double)(end.tv_usec - start.tv_usec) / 1000000.0;
+
+    printf("%u notifications, %u subscriptions, eventlog-size %u: "
+           "%.3f s, %.1f ns per notification\n"
+           "%llu delivered, %llu deleted before delivery\n",
+           notcount, subcount, logsize, secs, 
+           secs * 1000000000.0 / (double)notcount,
+           (unsigned long long)delivered, 
+           (unsigned long long)skipped);
+
+    agt_not_log_clean(&notlog);
+    free(nextseq);
+    free(lastid);
+    return 0;
+}
@@ -0,0 +1,2 @@
+#!/bin/bash -e
+./notification-log-perf 1000000 500 50000
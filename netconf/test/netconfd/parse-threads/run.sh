@@ -0,0 +1,25 @@
+#!/bin/bash -e
+rm -rf tmp || true
+mkdir tmp
+MODULES=""
+for mod in iana-crypt-hash iana-hardware iana-if-type ietf-datastores \
+  ietf-hardware-state ietf-hardware ietf-inet-types ietf-interfaces ietf-ip \
+  ietf-ipv4-unicast-routing ietf-ipv6-unicast-routing ietf-netconf-acm \
+  ietf-netconf-monitoring ietf-netconf-nmda ietf-netconf-notifications \
+  ietf-netconf-partial-lock ietf-netconf-with-defaults ietf-netconf \
+  ietf-network-state ietf-network-topology-state ietf-network-topology \
+  ietf-network ietf-origin ietf-routing ietf-system ietf-yang-library \
+  ietf-yang-metadata ietf-yang-smiv2 ietf-yang-types ; do
+  MODULES="$MODULES --module=$mod"
+done
+echo "<config/>" > tmp/startup-cfg.xml
+killall -KILL netconfd || true
+rm /tmp/ncxserver.sock || true
+for threads in 1 2 4 ; do
+  STARTTIME=$(date +%s%N)
+  /usr/sbin/netconfd $MODULES --parse-threads=$threads --validate-config-only --startup=tmp/startup-cfg.xml --superuser=$USER 1>tmp/server-$threads.log 2>&1
+  ENDTIME=$(date +%s%N)
+  echo "Startup with $threads parse threads took $((($ENDTIME-$STARTTIME)/1000000)) ms"
+done
+diff tmp/server-1.log tmp/server-2.log
+diff tmp/server-1.log tmp/server-4.log
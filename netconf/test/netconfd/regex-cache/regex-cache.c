@@ -0,0 +1,160 @@
+/*
+    regex-cache: check the compiled regexp cache used by YANG
+    pattern statements and the XPath re-match() function
+
+    usage: regex-cache
+
+    Checked are the hit and miss counters, the eviction of the
+    least recently used idle entries once more than
+    NCX_REGEX_CACHE_MAX are kept, an entry that stays usable
+    while it is referenced during the eviction of all the others,
+    the match results of evicted patterns compiled again, and
+    invalid patterns, which are not cached.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "procdefs.h"
+#include "ncx_regex.h"
+#include "status.h"
+
+#define PATTERNS    (2 * NCX_REGEX_CACHE_MAX)
+
+static int errors;
+
+static void check (int cond, const char *what)
+{
+    if (!cond) {
+        printf("FAILED: %s\n", what);
+        errors++;
+    }
+}
+
+/* get the counters accumulated since the last call */
+static void get_delta (uint32 *hits, uint32 *misses)
+{
+    static uint32  lasthits, lastmisses;
+    uint32         h, m;
+
+    ncx_regex_get_stats(&h, &m);
+    *hits = h - lasthits;
+    *misses = m - lastmisses;
+    lasthits = h;
+    lastmisses = m;
+}
+
+static void make_pattern (char *buff, uint32 i)
+{
+    sprintf(buff, "p%u-[0-9]+", i);
+}
+
+/* check pattern i matches p<i>-123 but not p<i>-abc or p<i+1>-123 */
+static int match_pattern (xmlRegexpPtr regex, uint32 i)
+{
+    char  str[64];
+
+    sprintf(str, "p%u-123", i);
+    if (xmlRegexpExec(regex, (const xmlChar *)str) != 1) {
+        return 0;
+    }
+    sprintf(str, "p%u-abc", i);
+    if (xmlRegexpExec(regex, (const xmlChar *)str) != 0) {
+        return 0;
+    }
+    sprintf(str, "p%u-123", i + 1);
+    return xmlRegexpExec(regex, (const xmlChar *)str) == 0;
+}
+
+/* get, match and release each pattern from first to last */
+static int use_patterns (uint32 first, uint32 last)
+{
+    char          pat[64];
+    xmlRegexpPtr  regex;
+    status_t      res;
+    uint32        i;
+    int           ok;
+
+    ok = 1;
+    for (i = first; i <= last; i++) {
+        make_pattern(pat, i);
+        regex = ncx_regex_get((const xmlChar *)pat, &res);
+        if (regex == NULL || res != NO_ERR) {
+            return 0;
+        }
+        if (!match_pattern(regex, i)) {
+            ok = 0;
+        }
+        ncx_regex_release((const xmlChar *)pat);
+    }
+    return ok;
+}
+
+int main (int argc, char *argv[])
+{
+    const xmlChar *held = (const xmlChar *)"held-[a-z]+";
+    xmlRegexpPtr   regex, again;
+    status_t       res;
+    uint32         hits, misses;
+
+    /* hits and misses */
+    get_delta(&hits, &misses);
+    regex = ncx_regex_get(held, &res);
+    check(regex != NULL && res == NO_ERR, "get held pattern");
+    again = ncx_regex_get(held, &res);
+    check(again == regex, "second get returns the cached regexp");
+    get_delta(&hits, &misses);
+    check(hits == 1 && misses == 1, "1 hit and 1 miss for 2 gets");
+    ncx_regex_release(held);
+
+    /* the held pattern keeps 1 reference while all the other
+     * patterns are used twice: the first pass misses on every
+     * pattern, and the second pass misses again on the first
+     * half, which was evicted by the second half
+     */
+    check(use_patterns(0, PATTERNS - 1), "first pass match results");
+    get_delta(&hits, &misses);
+    check(hits == 0 && misses == PATTERNS, "first pass compiles all");
+
+    check(use_patterns(NCX_REGEX_CACHE_MAX, PATTERNS - 1),
+          "recently used patterns match");
+    get_delta(&hits, &misses);
+    check(hits == NCX_REGEX_CACHE_MAX && misses == 0,
+          "recently used patterns are cached");
+
+    check(use_patterns(0, NCX_REGEX_CACHE_MAX - 1),
+          "evicted patterns match after they are compiled again");
+    get_delta(&hits, &misses);
+    check(hits == 0 && misses == NCX_REGEX_CACHE_MAX,
+          "least recently used patterns were evicted");
+
+    /* the referenced entry was not evicted and is still usable */
+    check(xmlRegexpExec(regex, (const xmlChar *)"held-abc") == 1 &&
+          xmlRegexpExec(regex, (const xmlChar *)"held-123") == 0,
+          "referenced regexp matches after evictions");
+    again = ncx_regex_get(held, &res);
+    get_delta(&hits, &misses);
+    check(again == regex && hits == 1 && misses == 0,
+          "referenced pattern is still cached");
+    ncx_regex_release(held);
+    ncx_regex_release(held);
+
+    /* invalid patterns are reported and not cached */
+    regex = ncx_regex_get((const xmlChar *)"bad-[", &res);
+    check(regex == NULL && res == ERR_NCX_INVALID_PATTERN,
+          "invalid pattern is reported");
+    regex = ncx_regex_get((const xmlChar *)"bad-[", &res);
+    get_delta(&hits, &misses);
+    check(regex == NULL && hits == 0 && misses == 2,
+          "invalid pattern is not cached");
+
+    ncx_regex_cleanup();
+
+    if (errors) {
+        printf("Test failed: %d errors\n", errors);
+        return 1;
+    }
+    printf("regex cache test passed\n");
+    return 0;
+}
@@ -0,0 +1,11 @@
+#!/bin/bash -e
+rm -rf tmp || true
+mkdir tmp
+./regex-cache
+killall -KILL netconfd || true
+rm /tmp/ncxserver.sock || true
+/usr/sbin/netconfd --module=./test-regex-cache.yang --no-startup --superuser=$USER 1>tmp/netconfd.stdout 2>tmp/netconfd.stderr &
+NETCONFD_PID=$!
+sleep 3
+python session.ncclient.py
+kill -KILL $NETCONFD_PID
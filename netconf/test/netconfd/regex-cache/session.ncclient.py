@@ -0,0 +1,118 @@
+#!/usr/bin/env python
+from ncclient import manager
+from ncclient.operations import RPCError
+from ncclient.xml_ import *
+import time
+import sys, os
+import argparse
+
+TRC_NS = "http://yuma123.org/ns/test-regex-cache"
+
+def edit_rules(conn, entries):
+	rpc = """
+<edit-config xmlns="urn:ietf:params:xml:ns:netconf:base:1.0">
+ <target>
+  <candidate/>
+ </target>
+ <default-operation>merge</default-operation>
+ <test-option>set</test-option>
+ <config>
+  <rules xmlns="%(ns)s">
+%(entries)s
+  </rules>
+ </config>
+</edit-config>
+""" % {'ns':TRC_NS, 'entries':"\n".join(entries)}
+	return conn.rpc(rpc)
+
+def rule(i, value):
+	return "<rule><name>r%d</name><pattern>r%d-[0-9]+</pattern><value>%s</value><code>AB12</code></rule>" % (i, i, value)
+
+def expect_commit_error(conn):
+	try:
+		conn.commit()
+		assert(False)
+	except RPCError as e:
+		print(e.tag)
+	conn.discard_changes()
+
+def main():
+	print("""
+#Description: Demonstrate that re-match() and pattern results do not change when the compiled regexps are evicted from the cache.
+#Procedure:
+#1 - Create COUNT rules, each with its own re-match() pattern, and commit.
+#2 - Set a value that does not match the pattern of the first rule. Verify the commit fails.
+#3 - Set a value that matches the pattern of the first rule. Verify the commit succeeds.
+#4 - Set a value of the last rule to a value that matches the pattern of the first rule only. Verify the commit fails.
+#5 - Set a code that does not match the YANG pattern. Verify the edit fails.
+#6 - Set a code that matches the YANG pattern. Verify the commit succeeds.
+""")
+
+	parser = argparse.ArgumentParser()
+	parser.add_argument("--server", help="server name e.g. 127.0.0.1 or server.com (127.0.0.1 if not specified)")
+	parser.add_argument("--user", help="username e.g. admin ($USER if not specified)")
+	parser.add_argument("--port", help="port e.g. 830 (830 if not specified)")
+	parser.add_argument("--password", help="password e.g. mypass123 (passwordless if not specified)")
+	parser.add_argument("--count", help="number of rules e.g. 1000 (600 if not specified)")
+
+	args = parser.parse_args()
+
+	if(args.server==None or args.server==""):
+		server="127.0.0.1"
+	else:
+		server=args.server
+
+	if(args.port==None or args.port==""):
+		port=830
+	else:
+		port=int(args.port)
+
+	if(args.user==None or args.user==""):
+		user=os.getenv('USER')
+	else:
+		user=args.user
+
+	if(args.password==None or args.password==""):
+		password=None
+		look_for_keys=True
+	else:
+		password=args.password
+		look_for_keys=False
+
+	if(args.count==None or args.count==""):
+		count=600
+	else:
+		count=int(args.count)
+
+	conn = manager.connect(host=server, port=port, username=user, password=password, look_for_keys=look_for_keys, timeout=60, device_params = {'name':'junos'}, hostkey_verify=False)
+	print("Connected ...")
+
+	print("#1 - create %d rules ..." % count)
+	edit_rules(conn, [rule(i, "r%d-%d" % (i, i)) for i in range(count)])
+	conn.commit()
+
+	print("#2 - non-matching value of the first rule ...")
+	edit_rules(conn, ["<rule><name>r0</name><value>r0-abc</value></rule>"])
+	expect_commit_error(conn)
+
+	print("#3 - matching value of the first rule ...")
+	edit_rules(conn, ["<rule><name>r0</name><value>r0-999</value></rule>"])
+	conn.commit()
+
+	print("#4 - value of the last rule matching the first pattern ...")
+	edit_rules(conn, ["<rule><name>r%d</name><value>r0-999</value></rule>" % (count-1)])
+	expect_commit_error(conn)
+
+	print("#5 - code not matching the YANG pattern ...")
+	try:
+		edit_rules(conn, ["<rule><name>r0</name><code>ab12</code></rule>"])
+		assert(False)
+	except RPCError as e:
+		print(e.tag)
+	conn.discard_changes()
+
+	print("#6 - code matching the YANG pattern ...")
+	edit_rules(conn, ["<rule><name>r0</name><code>CD34</code></rule>"])
+	conn.commit()
+
+sys.exit(main())
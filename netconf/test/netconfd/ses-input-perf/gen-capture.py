@@ -0,0 +1,27 @@
+# Generate a large <edit-config> capture for ses-input-perf
+# usage: python gen-capture.py <1.0|1.1> <entries-count> > capture.xml
+import sys
+
+framing = sys.argv[1]
+count = int(sys.argv[2])
+
+interfaces = "".join(
+    "<interface><name>eth%d</name>"
+    "<type xmlns:ianaift=\"urn:ietf:params:xml:ns:yang:iana-if-type\">ianaift:ethernetCsmacd</type>"
+    "<description>Interface %d</description><enabled>true</enabled>"
+    "</interface>" % (i, i) for i in range(count))
+
+rpc = ('<?xml version="1.0" encoding="UTF-8"?>'
+       '<rpc message-id="1" xmlns="urn:ietf:params:xml:ns:netconf:base:1.0">'
+       '<edit-config><target><candidate/></target><config>'
+       '<interfaces xmlns="urn:ietf:params:xml:ns:yang:ietf-interfaces">%s</interfaces>'
+       '</config></edit-config></rpc>' % interfaces)
+
+if framing == "1.1":
+    chunks = []
+    for i in range(0, len(rpc), 32768):
+        chunk = rpc[i:i+32768]
+        chunks.append("\n#%d\n%s" % (len(chunk), chunk))
+    sys.stdout.write("".join(chunks) + "\n##\n")
+else:
+    sys.stdout.write(rpc + "]]>]]>")
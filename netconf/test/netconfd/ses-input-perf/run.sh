@@ -0,0 +1,7 @@
+#!/bin/bash -e
+rm -rf tmp || true
+mkdir tmp
+python gen-capture.py 1.0 20000 > tmp/capture-1.0.xml
+python gen-capture.py 1.1 20000 > tmp/capture-1.1.xml
+./ses-input-perf tmp/capture-1.0.xml 1.0 10
+./ses-input-perf tmp/capture-1.1.xml 1.1 10
@@ -0,0 +1,185 @@
+/*
+    ses-input-perf: replay a captured NETCONF input stream through
+    ses_accept_input and the ses_read_cb xmlTextReader front-end
+    and report the input throughput in MB/s
+
+    usage: ses-input-perf <capture-file> [1.0|1.1] [iterations]
+
+    The capture file contains the raw bytes a client sends after
+    the <hello> exchange: a sequence of ]]>]]> terminated messages
+    for base:1.0 or chunk encoded messages for base:1.1
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <libxml/xmlreader.h>
+
+#include "procdefs.h"
+#include "dlq.h"
+#include "ncx.h"
+#include "ses.h"
+#include "ses_msg.h"
+#include "status.h"
+#include "xml_util.h"
+
+/* captured input replayed by the session read function */
+static char   *capture;
+static size_t  capturelen;
+static size_t  capturepos;
+
+static ssize_t
+    replay_read (void *s,
+                 char *buff,
+                 size_t bufflen,
+                 boolean *erragain)
+{
+    size_t len;
+
+    (void)s;
+    if (capturepos == capturelen) {
+        *erragain = TRUE;
+        return -1;
+    }
+
+    len = capturelen - capturepos;
+    if (len > bufflen) {
+        len = bufflen;
+    }
+    memcpy(buff, &capture[capturepos], len);
+    capturepos += len;
+    return (ssize_t)len;
+}
+
+static status_t
+    parse_ready_msgs (ses_cb_t *scb,
+                      uint32 *msgcount,
+                      uint32 *nodecount)
+{
+    ses_msg_t *msg;
+    status_t   res;
+    int        ret;
+
+    while (ses_msg_get_first_inready() != NULL) {
+        ;
+    }
+
+    for (msg = (ses_msg_t *)dlq_firstEntry(&scb->msgQ);
+         msg != NULL && msg->ready;
+         msg = (ses_msg_t *)dlq_firstEntry(&scb->msgQ)) {
+
+        if (scb->reader) {
+            res = xml_reset_reader_for_session(ses_read_cb,
+                                               NULL,
+                                               scb,
+                                               scb->reader);
+        } else {
+            res = xml_get_reader_for_session(ses_read_cb,
+                                             NULL,
+                                             scb,
+                                             &scb->reader);
+        }
+        if (res != NO_ERR) {
+            return res;
+        }
+
+        do {
+            ret = xmlTextReaderRead(scb->reader);
+            if (ret == 1) {
+                (*nodecount)++;
+            }
+        } while (ret == 1);
+        if (ret < 0) {
+            return ERR_XML_READER_INTERNAL;
+        }
+
+        (*msgcount)++;
+        dlq_remove(msg);
+        ses_msg_free_msg(scb, msg);
+    }
+    return NO_ERR;
+}
+
+int main(int argc, char **argv)
+{
+    FILE           *fp;
+    ses_cb_t       *scb;
+    struct timeval  start, end;
+    double          secs, mbytes;
+    uint32          iterations, i, msgcount, nodecount;
+    boolean         framing11;
+    status_t        res;
+
+    if (argc < 2) {
+        fprintf(stderr, 
+                "usage: %s <capture-file> [1.0|1.1] [iterations]\n",
+                argv[0]);
+        return 1;
+    }
+    framing11 = (argc > 2 && !strcmp(argv[2], "1.1"));
+    iterations = (argc > 3) ? (uint32)atoi(argv[3]) : 10;
+
+    fp = fopen(argv[1], "r");
+    if (fp == NULL) {
+        perror(argv[1]);
+        return 1;
+    }
+    fseek(fp, 0, SEEK_END);
+    capturelen = (size_t)ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    capture = malloc(capturelen);
+    if (capture == NULL ||
+        fread(capture, 1, capturelen, fp) != capturelen) {
+        fprintf(stderr, "read of %s failed\n", argv[1]);
+        return 1;
+    }
+    fclose(fp);
+
+    xmlInitParser();
+    ses_msg_init();
+
+    scb = ses_new_scb();
+    if (scb == NULL) {
+        return 1;
+    }
+    scb->type = SES_TYP_NETCONF;
+    scb->transport = SES_TRANSPORT_SSH;
+    scb->state = SES_ST_IDLE;
+    scb->instate = SES_INST_IDLE;
+    scb->rdfn = replay_read;
+    ses_set_protocol(scb, framing11 ? 
+                     NCX_PROTO_NETCONF11 : NCX_PROTO_NETCONF10);
+
+    msgcount = 0;
+    nodecount = 0;
+    gettimeofday(&start, NULL);
+    for (i = 0; i < iterations; i++) {
+        capturepos = 0;
+        while (capturepos < capturelen) {
+            res = ses_accept_input(scb);
+            if (res == NO_ERR) {
+                res = parse_ready_msgs(scb, &msgcount, &nodecount);
+            }
+            if (res != NO_ERR) {
+                fprintf(stderr, "replay failed at offset %u (%s)\n",
+                        (uint32)capturepos, get_error_string(res));
+                return 1;
+            }
+        }
+    }
+    gettimeofday(&end, NULL);
+
+    secs = (double)(end.tv_sec - start.tv_sec) + 
+        (double)(end.tv_usec - start.tv_usec) / 1000000.0;
+    mbytes = (double)capturelen * iterations / (1024.0 * 1024.0);
+
+    printf("%u messages, %u reader nodes, %.2f MB in %.3f s: %.2f MB/s\n",
+           msgcount, nodecount, mbytes, secs, mbytes / secs);
+
+    scb->fd = 0;
+    ses_free_scb(scb);
+    ses_msg_cleanup();
+    free(capture);
+    return 0;
+}
@@ -0,0 +1,39 @@
+#!/bin/bash -e
+rm -rf tmp || true
+mkdir tmp
+cp startup-cfg.xml tmp
+rm /tmp/ncxserver.sock || true
+/usr/sbin/netconfd --module=./test-startup-journal-order.yang --target=running --startup=tmp/startup-cfg.xml --startup-journal=true --superuser=$USER 1>tmp/netconfd.stdout 2>tmp/netconfd.stderr &
+
+NETCONFD_PID=$!
+sleep 3
+python session.ncclient.py commit
+kill $NETCONFD_PID
+cat tmp/netconfd.stdout
+sleep 1
+test -s tmp/startup-cfg.xml.journal
+
+rm /tmp/ncxserver.sock || true
+/usr/sbin/netconfd --module=./test-startup-journal-order.yang --target=running --startup=tmp/startup-cfg.xml --startup-journal=true --superuser=$USER 1>tmp/netconfd2.stdout 2>tmp/netconfd2.stderr &
+
+NETCONFD_PID=$!
+sleep 3
+python session.ncclient.py check
+kill $NETCONFD_PID
+cat tmp/netconfd2.stdout
+sleep 1
+test ! -e tmp/startup-cfg.xml.journal
+
+# a journal written with other prefixes than the startup file
+cp startup-cfg.xml tmp
+cp prefix-journal.xml tmp/startup-cfg.xml.journal
+rm /tmp/ncxserver.sock || true
+/usr/sbin/netconfd --module=./test-startup-journal-order.yang --target=running --startup=tmp/startup-cfg.xml --startup-journal=true --superuser=$USER 1>tmp/netconfd3.stdout 2>tmp/netconfd3.stderr &
+
+NETCONFD_PID=$!
+sleep 3
+python session.ncclient.py check-prefixes
+kill $NETCONFD_PID
+cat tmp/netconfd3.stdout
+sleep 1
+test ! -e tmp/startup-cfg.xml.journal
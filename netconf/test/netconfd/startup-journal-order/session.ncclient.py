@@ -0,0 +1,109 @@
+#!/usr/bin/env python
+from ncclient import manager
+from ncclient.xml_ import *
+import time
+import sys, os
+
+TSJO_NS = "http://yuma123.org/ns/test-startup-journal-order"
+
+def edit(conn, config):
+	rpc = """
+<edit-config xmlns="urn:ietf:params:xml:ns:netconf:base:1.0">
+ <target>
+  <running/>
+ </target>
+ <config>
+  <rules xmlns="%(ns)s" xmlns:tsjo="%(ns)s"
+    xmlns:yang="urn:ietf:params:xml:ns:yang:1">
+   %(config)s
+  </rules>
+ </config>
+</edit-config>
+""" % {'ns':TSJO_NS, 'config':config}
+	result = conn.rpc(rpc)
+
+def rule(kind, name, insert):
+	return """
+   <rule yang:insert="%s">
+    <kind>tsjo:%s</kind>
+    <name>%s</name>
+    <value>new</value>
+   </rule>
+""" % (insert, kind, name)
+
+def get_rules(conn):
+	rpc = """
+<get-config xmlns="urn:ietf:params:xml:ns:netconf:base:1.0">
+ <source>
+  <running/>
+ </source>
+ <filter type="xpath" select="/rules"/>
+</get-config>
+"""
+	result = conn.rpc(rpc)
+	rules = result.xpath('//data/rules/rule')
+	names = [r.find("{%s}name" % TSJO_NS).text for r in rules]
+	values = [r.find("{%s}value" % TSJO_NS).text for r in rules]
+	tags = [t.text.split(":")[-1] for t in result.xpath('//data/rules/tag')]
+	first = result.xpath('//data/rules/first')
+	return (names, values, tags, first)
+
+def commit(conn):
+	print("set leaf last ...")
+	edit(conn, "<last>x</last>")
+	print("insert rule c1 first ...")
+	edit(conn, rule("kind-c", "c1", "first"))
+	print("insert rule d1 first and rule d2 last ...")
+	edit(conn, rule("kind-d", "d1", "first") + rule("kind-d", "d2", "last"))
+	print("create leaf first ...")
+	edit(conn, "<first>y</first>")
+	print("insert tag kind-c first ...")
+	edit(conn, """<tag yang:insert="first">tsjo:kind-c</tag>""")
+	print("change rule b1 ...")
+	edit(conn, """<rule><kind>tsjo:kind-b</kind><name>b1</name><value>changed</value></rule>""")
+
+def check(conn):
+	(names, values, tags, first) = get_rules(conn)
+	print(names, values, tags)
+	assert(names == ["d1", "c1", "a1", "b1", "d2"])
+	assert(values == ["new", "new", "initial", "changed", "new"])
+	assert(tags == ["kind-c", "kind-a", "kind-b"])
+	assert(len(first) == 1 and first[0].text == "y")
+
+	# the merged startup file has the same order
+	startup = parse_root(open("tmp/startup-cfg.xml").read())
+	rules = startup.find("{%s}rules" % TSJO_NS)
+	children = [child.tag.split("}")[-1] for child in rules]
+	assert(children.index("first") < children.index("rule"))
+	names = [r.find("{%s}name" % TSJO_NS).text for r in rules.findall("{%s}rule" % TSJO_NS)]
+	assert(names == ["d1", "c1", "a1", "b1", "d2"])
+
+def check_prefixes(conn):
+	(names, values, tags, first) = get_rules(conn)
+	print(names, values, tags)
+	assert(names == ["c1", "a1"])
+	assert(values == ["new", "replayed"])
+	assert(tags == ["kind-b"])
+
+def main():
+	print("""
+#Description: Demonstrate that the startup journal keeps the order of user ordered lists.
+#Procedure:
+#1 - Insert new entries with identityref keys in a user ordered list first and last, a new leaf and a new leaf-list entry.
+#2 - Restart the server.
+#3 - Verify the running configuration and the startup file have the entries in the same order.
+#4 - Restart the server with a journal using other prefixes than the startup file.
+#5 - Verify the journal entries matched the startup entries by value.
+""")
+
+	conn = manager.connect(host="127.0.0.1", port=830, username=os.getenv('USER'), password='admin', look_for_keys=True, timeout=10, device_params = {'name':'junos'}, hostkey_verify=False)
+	print("Connected ...")
+
+	if sys.argv[1] == "commit":
+		commit(conn)
+	elif sys.argv[1] == "check":
+		check(conn)
+	else:
+		check_prefixes(conn)
+
+sys.exit(main())
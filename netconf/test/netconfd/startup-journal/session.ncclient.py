@@ -0,0 +1,82 @@
+#!/usr/bin/env python
+from ncclient import manager
+from ncclient.xml_ import *
+import time
+import sys, os
+
+def edit(conn, config):
+	rpc = """
+<edit-config xmlns="urn:ietf:params:xml:ns:netconf:base:1.0">
+ <target>
+  <candidate/>
+ </target>
+ <config>
+  <interfaces xmlns="urn:ietf:params:xml:ns:yang:ietf-interfaces"
+    xmlns:nc="urn:ietf:params:xml:ns:netconf:base:1.0">
+   %s
+  </interfaces>
+ </config>
+</edit-config>
+""" % (config)
+	result = conn.rpc(rpc)
+	result = conn.rpc("<commit/>")
+
+def commit(conn):
+	print("create interface bar ...")
+	edit(conn, """
+   <interface>
+    <name>bar</name>
+    <type xmlns:ianaift="urn:ietf:params:xml:ns:yang:iana-if-type">ianaift:ethernetCsmacd</type>
+   </interface>
+""")
+	print("delete interface bar ...")
+	edit(conn, """
+   <interface nc:operation="delete">
+    <name>bar</name>
+   </interface>
+""")
+	for i in range(10):
+		print("commit %d ..." % (i))
+		edit(conn, """
+   <interface>
+    <name>foo</name>
+    <description>commit %d</description>
+   </interface>
+""" % (i))
+
+def check(conn):
+	rpc = """
+<get-config xmlns="urn:ietf:params:xml:ns:netconf:base:1.0">
+ <source>
+  <running/>
+ </source>
+ <filter type="xpath" select="/interfaces"/>
+</get-config>
+"""
+	result = conn.rpc(rpc)
+	names = result.xpath('//data/interfaces/interface/name')
+	descriptions = result.xpath('//data/interfaces/interface/description')
+	assert(len(names)==41)
+	assert("foo" in [name.text for name in names])
+	assert("bar" not in [name.text for name in names])
+	assert(len(descriptions)==1)
+	assert(descriptions[0].text=="commit 9")
+
+def main():
+	print("""
+#Description: Demonstrate that --startup-journal=true saves the committed changes.
+#Procedure:
+#1 - Create and delete interface "bar" and commit 10 changes to the description of interface "foo".
+#2 - Restart the server.
+#3 - Verify the running configuration has all the changes.
+""")
+
+	conn = manager.connect(host="127.0.0.1", port=830, username=os.getenv('USER'), password='admin', look_for_keys=True, timeout=10, device_params = {'name':'junos'}, hostkey_verify=False)
+	print("Connected ...")
+
+	if sys.argv[1] == "commit":
+		commit(conn)
+	else:
+		check(conn)
+
+sys.exit(main())
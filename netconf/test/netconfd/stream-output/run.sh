@@ -0,0 +1,12 @@
+#!/bin/bash -e
+rm -rf tmp || true
+mkdir tmp
+for STREAM_OUTPUT in true false ; do
+  rm /tmp/ncxserver.sock || true
+  /usr/sbin/netconfd --module=ietf-interfaces --module=iana-if-type --startup=startup-cfg.xml --stream-output=$STREAM_OUTPUT --superuser=$USER 1>tmp/netconfd-$STREAM_OUTPUT.stdout 2>tmp/netconfd-$STREAM_OUTPUT.stderr &
+  NETCONFD_PID=$!
+  sleep 3
+  python session.ncclient.py
+  kill $NETCONFD_PID
+  cat tmp/netconfd-$STREAM_OUTPUT.stdout
+done
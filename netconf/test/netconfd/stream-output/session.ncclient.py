@@ -0,0 +1,65 @@
+#!/usr/bin/env python
+from ncclient import manager
+from ncclient.xml_ import *
+import time
+import sys, os
+
+def get_filtered(conn, op, filter):
+	if op == "get-config":
+		source = "<source><running/></source>"
+	else:
+		source = ""
+	rpc = """
+<%(op)s xmlns="urn:ietf:params:xml:ns:netconf:base:1.0">
+ %(source)s
+ <filter type="subtree">
+  %(filter)s
+ </filter>
+</%(op)s>
+""" % {'op':op, 'source':source, 'filter':filter}
+	return conn.rpc(rpc)
+
+def main():
+	print("""
+#Description: Demonstrate that subtree filters select the same data with and without streamed output.
+#Procedure:
+#1 - Select all the interface names. Verify 3 names and nothing else are returned.
+#2 - Select the interfaces with a description content match. Verify the list key is added.
+#3 - Select a single interface by key. Verify the complete entry is returned.
+#4 - Select an interface that does not exist. Verify the reply is empty.
+#5 - Select the sessions in netconf-state. Verify this session is returned.
+#6 - Get all the data without a filter twice. Verify the interfaces and the virtual session data are returned each time.
+""")
+
+	conn = manager.connect(host="127.0.0.1", port=830, username=os.getenv('USER'), password='admin', look_for_keys=True, timeout=10, device_params = {'name':'junos'}, hostkey_verify=False)
+	print("Connected ...")
+
+	for op in ("get", "get-config"):
+		result = get_filtered(conn, op, """<interfaces xmlns="urn:ietf:params:xml:ns:yang:ietf-interfaces"><interface><name/></interface></interfaces>""")
+		assert(len(result.xpath('//data/interfaces/interface/name'))==3)
+		assert(len(result.xpath('//data/interfaces/interface/description'))==0)
+
+		result = get_filtered(conn, op, """<interfaces xmlns="urn:ietf:params:xml:ns:yang:ietf-interfaces"><interface><description>downlink</description></interface></interfaces>""")
+		names = result.xpath('//data/interfaces/interface/name')
+		assert(len(names)==1)
+		assert(names[0].text=="eth1")
+		assert(len(result.xpath('//data/interfaces/interface/type'))==0)
+
+		result = get_filtered(conn, op, """<interfaces xmlns="urn:ietf:params:xml:ns:yang:ietf-interfaces"><interface><name>eth0</name></interface></interfaces>""")
+		assert(len(result.xpath('//data/interfaces/interface/name'))==1)
+		assert(len(result.xpath('//data/interfaces/interface/type'))==1)
+		assert(result.xpath('//data/interfaces/interface/description')[0].text=="uplink")
+
+		result = get_filtered(conn, op, """<interfaces xmlns="urn:ietf:params:xml:ns:yang:ietf-interfaces"><interface><name>eth9</name></interface></interfaces>""")
+		assert(len(result.xpath('//data/interfaces'))==0)
+
+	result = get_filtered(conn, "get", """<netconf-state xmlns="urn:ietf:params:xml:ns:yang:ietf-netconf-monitoring"><sessions/></netconf-state>""")
+	assert(len(result.xpath('//data/netconf-state/sessions/session'))>=1)
+
+	for i in range(2):
+		result = conn.rpc("""<get xmlns="urn:ietf:params:xml:ns:netconf:base:1.0"/>""")
+		assert(len(result.xpath('//data/interfaces/interface/name'))==3)
+		assert(len(result.xpath('//data/netconf-state/sessions/session'))>=1)
+		assert(len(result.xpath('//data/netconf-state/statistics/in-rpcs'))==1)
+
+sys.exit(main())
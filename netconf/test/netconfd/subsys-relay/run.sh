@@ -0,0 +1,4 @@
+#!/bin/bash -e
+SUBSYS=$(command -v netconf-subsystem || echo /usr/sbin/netconf-subsystem)
+./subsys-relay $SUBSYS 100 splice
+./subsys-relay $SUBSYS 100 copy
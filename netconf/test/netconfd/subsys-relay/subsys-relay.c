@@ -0,0 +1,214 @@
+/*
+    subsys-relay: push data through netconf-subsystem in both
+    directions and report the relay throughput
+
+    usage: subsys-relay <netconf-subsystem> <MB> [splice | copy]
+
+    The program plays both sshd and the ncxserver: the
+    subsystem gets one end of a socketpair as STDIN and STDOUT,
+    like a session started by sshd, and connects to an AF_LOCAL
+    socket opened by this program.  After the <ncx-connect>
+    message, MB megabytes are sent from the client side to the
+    server side, then back.  Every byte is checked.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+
+#define CHUNK  (64 * 1024)
+
+static char outbuff[CHUNK + 251];
+static char inbuff[CHUNK];
+
+static double msec_since (const struct timeval *start)
+{
+    struct timeval  now;
+
+    gettimeofday(&now, NULL);
+    return (double)(now.tv_sec - start->tv_sec) * 1000.0 +
+        (double)(now.tv_usec - start->tv_usec) / 1000.0;
+}
+
+/* read the <ncx-connect> message up to the ]]>]]> marker */
+static int read_connect (int fd)
+{
+    char     buff[2048];
+    size_t   len;
+    ssize_t  ret;
+
+    len = 0;
+    while (len < sizeof(buff) - 1) {
+        ret = read(fd, &buff[len], sizeof(buff) - 1 - len);
+        if (ret <= 0) {
+            return 1;
+        }
+        len += (size_t)ret;
+        buff[len] = 0;
+        if (strstr(buff, "]]>]]>")) {
+            return strstr(buff, "<ncx-connect") ? 0 : 1;
+        }
+    }
+    return 1;
+}
+
+/* send total bytes from wfd and check them on rfd */
+static int transfer (int wfd, int rfd, unsigned long long total)
+{
+    struct pollfd       pfd[2];
+    unsigned long long  sent, rcvd, i;
+    ssize_t             ret;
+    size_t              len;
+
+    sent = rcvd = 0;
+    while (rcvd < total) {
+        pfd[0].fd = (sent < total) ? wfd : -1;
+        pfd[0].events = POLLOUT;
+        pfd[1].fd = rfd;
+        pfd[1].events = POLLIN;
+        if (poll(pfd, 2, 10000) <= 0) {
+            fprintf(stderr, "poll timeout at %llu of %llu bytes\n", 
+                    rcvd, total);
+            return 1;
+        }
+        if (pfd[0].revents) {
+            len = (total - sent < CHUNK) ? (size_t)(total - sent) : CHUNK;
+            ret = write(wfd, &outbuff[sent % 251], len);
+            if (ret < 0 && errno != EAGAIN) {
+                perror("write");
+                return 1;
+            } else if (ret > 0) {
+                sent += (unsigned long long)ret;
+            }
+        }
+        if (pfd[1].revents) {
+            ret = read(rfd, inbuff, sizeof(inbuff));
+            if (ret < 0 && errno != EAGAIN) {
+                perror("read");
+                return 1;
+            } else if (ret == 0) {
+                fprintf(stderr, "EOF at %llu of %llu bytes\n", 
+                        rcvd, total);
+                return 1;
+            }
+            for (i = 0; ret > 0 && i < (unsigned long long)ret; i++) {
+                if (inbuff[i] != (char)((rcvd + i) % 251)) {
+                    fprintf(stderr, "wrong byte at offset %llu\n", 
+                            rcvd + i);
+                    return 1;
+                }
+            }
+            if (ret > 0) {
+                rcvd += (unsigned long long)ret;
+            }
+        }
+    }
+    return 0;
+}
+
+int main (int argc, char **argv)
+{
+    struct sockaddr_un  addr;
+    struct timeval      start;
+    unsigned long long  total;
+    char                sockarg[sizeof(addr.sun_path) + 32];
+    char                relayarg[32];
+    const char         *mode;
+    double              upms, downms;
+    int                 sp[2], lsock, ssock, status, i;
+    pid_t               pid;
+
+    if (argc < 3) {
+        fprintf(stderr, 
+                "usage: subsys-relay <netconf-subsystem> <MB> "
+                "[splice | copy]\n");
+        return 1;
+    }
+    total = strtoull(argv[2], NULL, 10) * 1024 * 1024;
+    mode = (argc > 3) ? argv[3] : "splice";
+    for (i = 0; i < (int)sizeof(outbuff); i++) {
+        outbuff[i] = (char)(i % 251);
+    }
+    signal(SIGPIPE, SIG_IGN);
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_LOCAL;
+    snprintf(addr.sun_path, sizeof(addr.sun_path), 
+             "/tmp/subsys-relay.%d.sock", (int)getpid());
+    unlink(addr.sun_path);
+    lsock = socket(AF_LOCAL, SOCK_STREAM, 0);
+    if (lsock < 0 ||
+        bind(lsock, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+        listen(lsock, 1) < 0) {
+        perror("ncxserver socket");
+        return 1;
+    }
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, sp) < 0) {
+        perror("socketpair");
+        return 1;
+    }
+
+    snprintf(sockarg, sizeof(sockarg), "--ncxserver-sockname=830@%s",
+             addr.sun_path);
+    snprintf(relayarg, sizeof(relayarg), "--relay=%s", mode);
+    setenv("SSH_CONNECTION", "127.0.0.1 1234 127.0.0.1 830", 1);
+    setenv("USER", "relay-test", 1);
+
+    pid = fork();
+    if (pid == 0) {
+        dup2(sp[1], STDIN_FILENO);
+        dup2(sp[1], STDOUT_FILENO);
+        close(sp[0]);
+        close(sp[1]);
+        close(lsock);
+        execl(argv[1], argv[1], sockarg, relayarg, (char *)NULL);
+        perror("exec");
+        _exit(1);
+    }
+    close(sp[1]);
+
+    ssock = accept(lsock, NULL, NULL);
+    close(lsock);
+    unlink(addr.sun_path);
+    if (ssock < 0 || read_connect(ssock)) {
+        fprintf(stderr, "no <ncx-connect> from %s\n", argv[1]);
+        return 1;
+    }
+    fcntl(sp[0], F_SETFL, O_NONBLOCK);
+    fcntl(ssock, F_SETFL, O_NONBLOCK);
+
+    gettimeofday(&start, NULL);
+    if (transfer(sp[0], ssock, total)) {
+        return 1;
+    }
+    upms = msec_since(&start);
+
+    gettimeofday(&start, NULL);
+    if (transfer(ssock, sp[0], total)) {
+        return 1;
+    }
+    downms = msec_since(&start);
+
+    close(sp[0]);
+    close(ssock);
+    if (waitpid(pid, &status, 0) != pid || 
+        !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        fprintf(stderr, "netconf-subsystem did not exit cleanly\n");
+        return 1;
+    }
+
+    printf("%s relay, %llu MB: to ncxserver %.0f MB/s, "
+           "to client %.0f MB/s\n", mode, total / (1024 * 1024),
+           (double)total / 1048.576 / upms,
+           (double)total / 1048.576 / downms);
+    return 0;
+}
@@ -0,0 +1,64 @@
+#!/usr/bin/env python
+from ncclient import manager
+from ncclient.xml_ import *
+import time
+import sys, os
+import argparse
+
+NS = "http://yuma123.org/ns/test-unique-stmt"
+
+def servers(tuples):
+	return "".join("<server><name>s%d</name><ip>%s</ip><port>%d</port></server>" % (i, ip, port) for i, (ip, port) in enumerate(tuples))
+
+def error_paths(e):
+	return sorted(err.path.strip() for err in e.errors if err.path)
+
+def main():
+	print("""
+#Description: Verify unique-stmt violations are all reported and a big list is validated quickly.
+#Procedure:
+#1 - Create 7 servers where s0, s2 and s3 share a tuple and s4 and s5 share another. Verify the validation fails with errors for s0, s2 and s4 only.
+#2 - Create 2 groups that each have a member with the same addr. Verify this is not a unique-stmt violation.
+#3 - Create --servers-count servers with different tuples. Verify validate succeeds in less than 10 seconds.
+""")
+
+	parser = argparse.ArgumentParser()
+	parser.add_argument("--servers-count", help="count of servers to create e.g. 20000")
+	args = parser.parse_args()
+	count = int(args.servers_count)
+
+	conn = manager.connect(host="127.0.0.1", port=830, username=os.getenv('USER'), password='admin', look_for_keys=True, timeout=60, device_params = {'name':'junos'}, hostkey_verify=False)
+	print("Connected ...")
+
+	#1
+	conn.edit_config(target="candidate", config="""<config><servers xmlns="%s">%s</servers></config>""" % (NS, servers([('a',1),('b',1),('a',1),('a',1),('c',2),('c',2),('a',2)])))
+	try:
+		conn.validate(source="candidate")
+		assert(0)
+	except Exception as e:
+		print(e)
+		paths = error_paths(e)
+		print(paths)
+		assert(len(paths) == 3)
+		assert("s0" in paths[0] and "s2" in paths[1] and "s4" in paths[2])
+	conn.discard_changes()
+
+	#2
+	conn.edit_config(target="candidate", config="""<config>
+<group xmlns="%(ns)s"><id>1</id><member><name>m1</name><addr>x</addr></member><member><name>m2</name><addr>y</addr></member></group>
+<group xmlns="%(ns)s"><id>2</id><member><name>m1</name><addr>x</addr></member></group>
+</config>""" % {'ns':NS})
+	conn.validate(source="candidate")
+	conn.discard_changes()
+
+	#3
+	tuples = [("10.%d.%d.%d" % (i >> 16, (i >> 8) & 255, i & 255), 80 + i % 3) for i in range(count)]
+	conn.edit_config(target="candidate", config="""<config><servers xmlns="%s">%s</servers></config>""" % (NS, servers(tuples)))
+	start = time.time()
+	conn.validate(source="candidate")
+	duration = time.time() - start
+	print("validate: %.2f s" % duration)
+	assert(duration < 10)
+	conn.discard_changes()
+
+sys.exit(main())
@@ -0,0 +1,14 @@
+#!/bin/bash -e
+rm -rf tmp || true
+mkdir tmp
+for workers in 1 4 ; do
+killall -KILL netconfd || true
+rm /tmp/ncxserver.sock || true
+/usr/sbin/netconfd --module=./test-validate-workers.yang --no-startup --validate-workers=$workers --superuser=$USER 2>&1 1>tmp/server-$workers.log &
+SERVER_PID=$!
+sleep 3
+python session.ncclient.py --items-count=5000 --errors-file=tmp/errors-$workers.txt
+kill -KILL $SERVER_PID
+sleep 1
+done
+diff tmp/errors-1.txt tmp/errors-4.txt
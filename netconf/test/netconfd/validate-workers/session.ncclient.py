@@ -0,0 +1,51 @@
+#!/usr/bin/env python
+from ncclient import manager
+from ncclient.xml_ import *
+import sys, os
+import argparse
+
+NS = "http://yuma123.org/ns/test-validate-workers"
+
+def item(i):
+	value = 200 if i in (7, 1500, 2999) else 10
+	high = 0 if i in (3, 2000) else 5
+	group = "gx" if i == 1234 else "g0"
+	return "<item><name>i%d</name><value>%d</value><group>%s</group><low>1</low><high>%d</high></item>" % (i, value, group, high)
+
+def main():
+	print("""
+#Description: Verify validation split across worker processes reports all errors in order.
+#Procedure:
+#1 - Edit the candidate without validation to hold --items-count items, 6 of them invalid.
+#2 - Validate the candidate. Verify it fails with 6 errors and save the error paths to --errors-file.
+""")
+
+	parser = argparse.ArgumentParser()
+	parser.add_argument("--items-count", help="count of items to create e.g. 5000")
+	parser.add_argument("--errors-file", help="file to save the error paths to")
+	args = parser.parse_args()
+	count = int(args.items_count)
+
+	conn = manager.connect(host="127.0.0.1", port=830, username=os.getenv('USER'), password='admin', look_for_keys=True, timeout=60, device_params = {'name':'junos'}, hostkey_verify=False)
+	print("Connected ...")
+
+	#1
+	conn.edit_config(target="candidate", test_option="set", config="""<config>
+<limits xmlns="%(ns)s"><max-value>100</max-value></limits>
+<group xmlns="%(ns)s"><name>g0</name></group>
+<items xmlns="%(ns)s">%(items)s</items>
+</config>""" % {'ns':NS, 'items':"".join(item(i) for i in range(count))})
+
+	#2
+	try:
+		conn.validate(source="candidate")
+		assert(0)
+	except Exception as e:
+		paths = [err.path.strip() for err in e.errors if err.path]
+		print(paths)
+		assert(len(paths) == 6)
+		with open(args.errors_file, "w") as f:
+			f.write("\n".join(paths) + "\n")
+	conn.discard_changes()
+
+sys.exit(main())
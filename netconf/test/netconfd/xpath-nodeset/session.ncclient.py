@@ -0,0 +1,110 @@
+#!/usr/bin/env python
+from ncclient import manager
+from ncclient.operations import RPCError
+from ncclient.xml_ import *
+import time
+import sys, os
+import argparse
+
+TXN_NS = "http://yuma123.org/ns/test-xpath-nodeset"
+COUNT = 1200
+
+def edit(conn, container, content):
+	rpc = """
+<edit-config xmlns="urn:ietf:params:xml:ns:netconf:base:1.0">
+ <target>
+  <candidate/>
+ </target>
+ <default-operation>merge</default-operation>
+ <test-option>set</test-option>
+ <config>
+  <%(container)s xmlns="%(ns)s">
+%(content)s
+  </%(container)s>
+ </config>
+</edit-config>
+""" % {'ns':TXN_NS, 'container':container, 'content':content}
+	return conn.rpc(rpc)
+
+def set_checks(conn, checks):
+	edit(conn, "checks", "\n".join(["<%s>%d</%s>" % (name, value, name) for (name, value) in checks]))
+
+def main():
+	print("""
+#Description: Demonstrate that XPath node-sets over a large list have no duplicates and keep document order.
+#Procedure:
+#1 - Create %(count)d entries in a user ordered list, in an order that is not the key order.
+#2 - Set each check leaf to the value of its must expression and commit.
+#3 - Set each check leaf to a wrong value. Verify the commit fails.
+""" % {'count':COUNT})
+
+	parser = argparse.ArgumentParser()
+	parser.add_argument("--server", help="server name e.g. 127.0.0.1 or server.com (127.0.0.1 if not specified)")
+	parser.add_argument("--user", help="username e.g. admin ($USER if not specified)")
+	parser.add_argument("--port", help="port e.g. 830 (830 if not specified)")
+	parser.add_argument("--password", help="password e.g. mypass123 (passwordless if not specified)")
+
+	args = parser.parse_args()
+
+	if(args.server==None or args.server==""):
+		server="127.0.0.1"
+	else:
+		server=args.server
+
+	if(args.port==None or args.port==""):
+		port=830
+	else:
+		port=int(args.port)
+
+	if(args.user==None or args.user==""):
+		user=os.getenv('USER')
+	else:
+		user=args.user
+
+	if(args.password==None or args.password==""):
+		password=None
+		look_for_keys=True
+	else:
+		password=args.password
+		look_for_keys=False
+
+	conn = manager.connect(host=server, port=port, username=user, password=password, look_for_keys=look_for_keys, timeout=60, device_params = {'name':'junos'}, hostkey_verify=False)
+	print("Connected ...")
+
+	# 7919 is prime, so this is a permutation of 0..COUNT-1
+	order = [(i*7919) % COUNT for i in range(COUNT)]
+
+	def first(match, after=None):
+		start = 0 if after==None else order.index(after)+1
+		return [i for i in order[start:] if match(i)][0]
+
+	# (check leaf, value of its must expression, wrong values)
+	checks = [
+		("union-count", 900, [1200]),
+		("descendant-count", COUNT, [3*COUNT]),
+		("descendant-first", first(lambda i: i>1000), [1001]),
+		("parent-count", 1, [COUNT]),
+		("parent-child-count", 299, [299*COUNT]),
+		("parent-child-first", first(lambda i: i>0 and i<300), [1]),
+		("sibling-first", first(lambda i: i>0 and i<300, after=238), [239])]
+
+	print("#1 - create %d entries ..." % COUNT)
+	edit(conn, "top", "\n".join(["<entry><id>%d</id><name>entry %d</name></entry>" % (i, i) for i in order]))
+
+	print("#2 - set the check values and commit ...")
+	set_checks(conn, [(name, value) for (name, value, wrong) in checks])
+	conn.commit()
+
+	print("#3 - set wrong check values ...")
+	for (name, value, wrong) in checks:
+		for bad in wrong:
+			print("%s = %d" % (name, bad))
+			set_checks(conn, [(name, bad)])
+			try:
+				conn.commit()
+				assert(False)
+			except RPCError as e:
+				assert(e.tag=="operation-failed")
+			conn.discard_changes()
+
+sys.exit(main())
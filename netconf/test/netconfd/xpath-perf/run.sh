@@ -0,0 +1,20 @@
+#!/bin/bash -e
+rm -rf tmp || true
+mkdir tmp
+killall -KILL netconfd || true
+rm /tmp/ncxserver.sock || true
+/usr/sbin/netconfd --module=./xpath-perf.yang --no-startup --superuser=$USER 2>&1 1>tmp/server.log &
+SERVER_PID=$!
+sleep 3
+
+STARTTIME=$(date +%s)
+time python session.ncclient.py --interfaces-count=2000
+ENDTIME=$(date +%s)
+kill -KILL $SERVER_PID
+wc tmp/server.log
+sleep 1
+echo "It took $(($ENDTIME-$STARTTIME)) seconds to validate and commit the configuration"
+if [ 60 -lt $(($ENDTIME-$STARTTIME)) ] ; then
+  echo "Test failed since the PASS threshold is 60 seconds"
+  exit 1
+fi
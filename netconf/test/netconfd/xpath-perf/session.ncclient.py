@@ -0,0 +1,67 @@
+#!/usr/bin/env python
+from ncclient import manager
+from ncclient.xml_ import *
+import time
+import sys, os
+import argparse
+
+def interface(i):
+	if i % 4 == 3:
+		return """
+<interface>
+ <name>vlan%(i)d</name>
+ <type xmlns:ianaift="urn:ietf:params:xml:ns:yang:iana-if-type">ianaift:l2vlan</type>
+ <vlan xmlns="urn:yuma123:params:xml:ns:yang:xpath-perf"><id>%(id)d</id></vlan>
+</interface>""" % {'i':i, 'id':i % 4094 + 1}
+	return """
+<interface>
+ <name>e%(i)d</name>
+ <type xmlns:ianaift="urn:ietf:params:xml:ns:yang:iana-if-type">ianaift:ethernetCsmacd</type>
+ <mtu xmlns="urn:yuma123:params:xml:ns:yang:xpath-perf">1500</mtu>
+ <speed-mode xmlns="urn:yuma123:params:xml:ns:yang:xpath-perf">fixed</speed-mode>
+ <speed xmlns="urn:yuma123:params:xml:ns:yang:xpath-perf">1000</speed>
+</interface>""" % {'i':i}
+
+def main():
+	print("""
+#Description: Time the evaluation of must and when expressions on a large number of list entries.
+#Procedure:
+#1 - Create --interfaces-count interfaces in the candidate. Verify edit-config succeeds.
+#2 - Validate the candidate 3 times. Verify each validate succeeds.
+#3 - Commit. Verify commit succeeds.
+#4 - Set a speed that violates a must expression. Verify validate fails with the error-message of the must.
+""")
+
+	parser = argparse.ArgumentParser()
+	parser.add_argument("--interfaces-count", help="count of interfaces to create e.g. 2000")
+	args = parser.parse_args()
+	count = int(args.interfaces_count)
+
+	conn = manager.connect(host="127.0.0.1", port=830, username=os.getenv('USER'), password='admin', look_for_keys=True, timeout=600, device_params = {'name':'junos'}, hostkey_verify=False)
+	print("Connected ...")
+
+	config = """<config><interfaces xmlns="urn:ietf:params:xml:ns:yang:ietf-interfaces">%s</interfaces></config>""" % "".join(interface(i) for i in range(count))
+
+	start = time.time()
+	conn.edit_config(target="candidate", config=config)
+	print("edit-config: %.2f s" % (time.time() - start))
+
+	for i in range(3):
+		start = time.time()
+		conn.validate(source="candidate")
+		print("validate: %.2f s" % (time.time() - start))
+
+	start = time.time()
+	conn.commit()
+	print("commit: %.2f s" % (time.time() - start))
+
+	conn.edit_config(target="candidate", config="""<config><interfaces xmlns="urn:ietf:params:xml:ns:yang:ietf-interfaces"><interface><name>e0</name><speed xmlns="urn:yuma123:params:xml:ns:yang:xpath-perf">5</speed></interface></interfaces></config>""")
+	try:
+		conn.validate(source="candidate")
+		assert(0)
+	except Exception as e:
+		print(e)
+		assert("A fixed speed must be at least 10" in str(e))
+	conn.discard_changes()
+
+sys.exit(main())
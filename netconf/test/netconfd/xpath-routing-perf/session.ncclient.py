@@ -0,0 +1,87 @@
+#!/usr/bin/env python
+from ncclient import manager
+from ncclient.xml_ import *
+import time
+import sys, os
+import argparse
+
+def interface(i):
+	return """
+<interface>
+ <name>eth%(i)d</name>
+ <type xmlns:ianaift="urn:ietf:params:xml:ns:yang:iana-if-type">ianaift:ethernetCsmacd</type>
+ <ipv4 xmlns="urn:ietf:params:xml:ns:yang:ietf-ip">
+  <address>
+   <ip>10.%(hi)d.%(lo)d.1</ip>
+   <prefix-length>24</prefix-length>
+  </address>
+ </ipv4>
+</interface>""" % {'i':i, 'hi':i // 256, 'lo':i % 256}
+
+def route(i, outgoing):
+	return """
+<route>
+ <destination-prefix>192.%(hi)d.%(lo)d.0/24</destination-prefix>
+ <next-hop>
+  <outgoing-interface>%(outgoing)s</outgoing-interface>
+  <next-hop-address>10.%(hi)d.%(lo)d.2</next-hop-address>
+ </next-hop>
+</route>""" % {'hi':i // 256, 'lo':i % 256, 'outgoing':outgoing}
+
+def routing(routes):
+	return """
+<routing xmlns="urn:ietf:params:xml:ns:yang:ietf-routing" xmlns:rt="urn:ietf:params:xml:ns:yang:ietf-routing">
+ <control-plane-protocols>
+  <control-plane-protocol>
+   <type>rt:static</type>
+   <name>st0</name>
+   <static-routes>
+    <ipv4 xmlns="urn:ietf:params:xml:ns:yang:ietf-ipv4-unicast-routing">%s
+    </ipv4>
+   </static-routes>
+  </control-plane-protocol>
+ </control-plane-protocols>
+</routing>""" % routes
+
+def main():
+	print("""
+#Description: Time the evaluation of the ietf-interfaces and ietf-routing XPath expressions on a large configuration.
+#Procedure:
+#1 - Create --interfaces-count interfaces with an ipv4 address and a static route through each of them in the candidate. Verify edit-config succeeds.
+#2 - Validate the candidate 3 times. Verify each validate succeeds.
+#3 - Commit. Verify commit succeeds.
+#4 - Add a route with an outgoing-interface that does not exist. Verify edit-config fails.
+""")
+
+	parser = argparse.ArgumentParser()
+	parser.add_argument("--interfaces-count", help="count of interfaces and routes to create e.g. 1000")
+	args = parser.parse_args()
+	count = int(args.interfaces_count)
+
+	conn = manager.connect(host="127.0.0.1", port=830, username=os.getenv('USER'), password='admin', look_for_keys=True, timeout=600, device_params = {'name':'junos'}, hostkey_verify=False)
+	print("Connected ...")
+
+	config = """<config><interfaces xmlns="urn:ietf:params:xml:ns:yang:ietf-interfaces">%s</interfaces>%s</config>""" % ("".join(interface(i) for i in range(count)), routing("".join(route(i, "eth%d" % i) for i in range(count))))
+
+	start = time.time()
+	conn.edit_config(target="candidate", config=config)
+	print("edit-config: %.2f s" % (time.time() - start))
+
+	for i in range(3):
+		start = time.time()
+		conn.validate(source="candidate")
+		print("validate: %.2f s" % (time.time() - start))
+
+	start = time.time()
+	conn.commit()
+	print("commit: %.2f s" % (time.time() - start))
+
+	try:
+		conn.edit_config(target="candidate", config="""<config>%s</config>""" % routing(route(count, "missing0")))
+		assert(0)
+	except Exception as e:
+		print(e)
+		assert("required value instance not found" in str(e))
+	conn.discard_changes()
+
+sys.exit(main())
@@ -0,0 +1,18 @@
+#!/bin/bash -e
+rm -rf tmp || true
+mkdir tmp
+killall -KILL netconfd || true
+export NCSERVER=localhost
+export NCPORT=830
+export NCUSER=${USER}
+export NCPASSWORD=""
+rm /tmp/ncxserver.sock || true
+/usr/sbin/netconfd --module=./test-schema-cache.yang --no-startup --superuser=$USER 2>&1 1>tmp/server.log &
+SERVER_PID=$!
+sleep 3
+expect session.exp "Sending autoload request for 'test-schema-cache'"
+ls tmp/schema-cache/test-schema-cache@2026-10-18-*.yang
+expect session.exp "Using 1 module from schema cache"
+kill -KILL $SERVER_PID
+cat tmp/server.log
+sleep 1